@@ -0,0 +1,264 @@
+// e57bench - reproducible measurements of the library's hot paths
+// SPDX-License-Identifier: MIT
+//
+// Covers the operations where performance regressions have bitten us in the
+// past: file open latency, sequential write and read throughput (read both
+// with and without checksum verification, so the CRC cost is visible on its
+// own), and record seeks. The synthetic scans are deterministic, so two runs
+// on the same machine and build configuration are directly comparable.
+//
+// Usage: e57bench [pointCount]    (default 2000000 points per scan)
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+
+#include "E57Format.h"
+
+namespace
+{
+   using Clock = std::chrono::steady_clock;
+
+   double elapsedSeconds( const Clock::time_point &start )
+   {
+      return std::chrono::duration<double>( Clock::now() - start ).count();
+   }
+
+   // Deterministic value pattern so every run writes identical files
+   int64_t syntheticValue( uint64_t record, unsigned field, int64_t maximum )
+   {
+      return static_cast<int64_t>( ( record * 2654435761ULL + field * 40503ULL ) %
+                                   static_cast<uint64_t>( maximum + 1 ) );
+   }
+
+   uint64_t fileSize( const e57::ustring &fileName )
+   {
+      std::ifstream file( fileName, std::ios::binary | std::ios::ate );
+
+      return static_cast<uint64_t>( file.tellg() );
+   }
+
+   constexpr size_t cBatchSize = 65536;
+
+   /// Write one synthetic scan of pointCount records with three integer
+   /// fields of the given bit width; returns elapsed seconds.
+   double writeScan( const e57::ustring &fileName, uint64_t pointCount, unsigned bits )
+   {
+      const int64_t cMaximum = ( int64_t( 1 ) << bits ) - 1;
+
+      const Clock::time_point start = Clock::now();
+
+      e57::ImageFile imf( fileName, "w" );
+      e57::StructureNode root = imf.root();
+
+      e57::VectorNode data3D( imf, true );
+      root.set( "data3D", data3D );
+
+      e57::StructureNode scan( imf );
+      data3D.append( scan );
+
+      e57::StructureNode proto( imf );
+      proto.set( "cartesianX", e57::IntegerNode( imf, 0, 0, cMaximum ) );
+      proto.set( "cartesianY", e57::IntegerNode( imf, 0, 0, cMaximum ) );
+      proto.set( "cartesianZ", e57::IntegerNode( imf, 0, 0, cMaximum ) );
+
+      e57::VectorNode codecs( imf, true );
+      e57::CompressedVectorNode points( imf, proto, codecs );
+      scan.set( "points", points );
+
+      std::vector<int64_t> x( cBatchSize );
+      std::vector<int64_t> y( cBatchSize );
+      std::vector<int64_t> z( cBatchSize );
+
+      std::vector<e57::SourceDestBuffer> sbufs;
+      sbufs.emplace_back( imf, "cartesianX", x.data(), cBatchSize );
+      sbufs.emplace_back( imf, "cartesianY", y.data(), cBatchSize );
+      sbufs.emplace_back( imf, "cartesianZ", z.data(), cBatchSize );
+
+      e57::CompressedVectorWriter writer = points.writer( sbufs );
+
+      uint64_t written = 0;
+
+      while ( written < pointCount )
+      {
+         const size_t n =
+            static_cast<size_t>( std::min<uint64_t>( cBatchSize, pointCount - written ) );
+
+         for ( size_t i = 0; i < n; ++i )
+         {
+            x[i] = syntheticValue( written + i, 0, cMaximum );
+            y[i] = syntheticValue( written + i, 1, cMaximum );
+            z[i] = syntheticValue( written + i, 2, cMaximum );
+         }
+
+         writer.write( n );
+         written += n;
+      }
+
+      writer.close();
+      imf.close();
+
+      return elapsedSeconds( start );
+   }
+
+   /// Read the whole scan back sequentially; returns elapsed seconds.
+   double readScan( const e57::ustring &fileName, e57::ReadChecksumPolicy policy )
+   {
+      const Clock::time_point start = Clock::now();
+
+      e57::ImageFile imf( fileName, "r", policy );
+      e57::CompressedVectorNode points(
+         e57::StructureNode( e57::VectorNode( imf.root().get( "data3D" ) ).get( 0 ) )
+            .get( "points" ) );
+
+      std::vector<int64_t> x( cBatchSize );
+      std::vector<int64_t> y( cBatchSize );
+      std::vector<int64_t> z( cBatchSize );
+
+      std::vector<e57::SourceDestBuffer> dbufs;
+      dbufs.emplace_back( imf, "cartesianX", x.data(), cBatchSize );
+      dbufs.emplace_back( imf, "cartesianY", y.data(), cBatchSize );
+      dbufs.emplace_back( imf, "cartesianZ", z.data(), cBatchSize );
+
+      e57::CompressedVectorReader reader = points.reader( dbufs );
+
+      while ( reader.read() > 0 )
+      {
+      }
+
+      reader.close();
+      imf.close();
+
+      return elapsedSeconds( start );
+   }
+
+   /// Open and close the file repeatedly; returns elapsed seconds for all opens.
+   double openScan( const e57::ustring &fileName, unsigned repeats )
+   {
+      const Clock::time_point start = Clock::now();
+
+      for ( unsigned i = 0; i < repeats; ++i )
+      {
+         e57::ImageFile imf( fileName, "r" );
+
+         // Touch the tree so lazily parsed sections are included in the cost
+         e57::VectorNode( imf.root().get( "data3D" ) ).childCount();
+
+         imf.close();
+      }
+
+      return elapsedSeconds( start );
+   }
+
+   /// Seek to scattered records, reading one small batch at each; returns
+   /// elapsed seconds for all seeks.
+   double seekScan( const e57::ustring &fileName, uint64_t pointCount, unsigned repeats )
+   {
+      const Clock::time_point start = Clock::now();
+
+      e57::ImageFile imf( fileName, "r" );
+      e57::CompressedVectorNode points(
+         e57::StructureNode( e57::VectorNode( imf.root().get( "data3D" ) ).get( 0 ) )
+            .get( "points" ) );
+
+      constexpr size_t cSeekBatch = 1024;
+
+      std::vector<int64_t> x( cSeekBatch );
+
+      std::vector<e57::SourceDestBuffer> dbufs;
+      dbufs.emplace_back( imf, "cartesianX", x.data(), cSeekBatch );
+
+      e57::CompressedVectorReader reader = points.reader( dbufs );
+
+      // Deterministic scattered record numbers
+      uint64_t state = 12345;
+
+      for ( unsigned i = 0; i < repeats; ++i )
+      {
+         state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+
+         reader.seek( static_cast<int64_t>( state % pointCount ) );
+         reader.read();
+      }
+
+      reader.close();
+      imf.close();
+
+      return elapsedSeconds( start );
+   }
+
+   void benchmarkBitWidth( uint64_t pointCount, unsigned bits )
+   {
+      const e57::ustring cFileName = "./e57bench-" + std::to_string( bits ) + "bit.e57";
+      const double cMillion = 1e6;
+
+      const double writeSec = writeScan( cFileName, pointCount, bits );
+      const uint64_t cFileBytes = fileSize( cFileName );
+
+      std::printf( "write   %2u-bit %5.1f Mpt: %8.1f ms  %6.1f Mrec/s  (file %.1f MB)\n", bits,
+                   pointCount / cMillion, writeSec * 1e3, pointCount / writeSec / cMillion,
+                   cFileBytes / cMillion );
+
+      const double readNoCrcSec = readScan( cFileName, e57::ChecksumNone );
+
+      std::printf( "read    %2u-bit no CRC:    %8.1f ms  %6.1f Mrec/s  %6.2f GB/s\n", bits,
+                   readNoCrcSec * 1e3, pointCount / readNoCrcSec / cMillion,
+                   cFileBytes / readNoCrcSec / 1e9 );
+
+      const double readCrcSec = readScan( cFileName, e57::ChecksumAll );
+
+      std::printf( "read    %2u-bit all CRC:   %8.1f ms  %6.1f Mrec/s  %6.2f GB/s\n", bits,
+                   readCrcSec * 1e3, pointCount / readCrcSec / cMillion,
+                   cFileBytes / readCrcSec / 1e9 );
+
+      constexpr unsigned cOpenRepeats = 25;
+      const double openSec = openScan( cFileName, cOpenRepeats );
+
+      std::printf( "open    %2u-bit:           %8.2f ms per open\n", bits,
+                   openSec * 1e3 / cOpenRepeats );
+
+      constexpr unsigned cSeekRepeats = 200;
+      const double seekSec = seekScan( cFileName, pointCount, cSeekRepeats );
+
+      std::printf( "seek    %2u-bit:           %8.1f us per seek+read\n", bits,
+                   seekSec * 1e6 / cSeekRepeats );
+
+      std::remove( cFileName.c_str() );
+   }
+}
+
+int main( int argc, char **argv )
+{
+   uint64_t pointCount = 2000000;
+
+   if ( argc > 1 )
+   {
+      pointCount = std::strtoull( argv[1], nullptr, 10 );
+
+      if ( pointCount == 0 )
+      {
+         std::fprintf( stderr, "usage: %s [pointCount]\n", argv[0] );
+         return 1;
+      }
+   }
+
+   try
+   {
+      for ( unsigned bits : { 12U, 20U, 24U } )
+      {
+         benchmarkBitWidth( pointCount, bits );
+      }
+   }
+   catch ( e57::E57Exception &ex )
+   {
+      std::fprintf( stderr, "e57bench failed: %s (%s)\n", ex.errorStr().c_str(),
+                    ex.context().c_str() );
+      return 1;
+   }
+
+   return 0;
+}
@@ -138,6 +138,9 @@ namespace e57
       /// passed an invalid value in Data3D pointFields
       ErrorInvalidData3DValue = 52,
 
+      /// a transfer was canceled by a ProgressCallback
+      ErrorTransferCanceled = 53,
+
       /// @deprecated Will be removed in 4.0. Use e57::Success.
       E57_SUCCESS DEPRECATED_ENUM( "Will be removed in 4.0. Use Success." ) = Success,
       /// @deprecated Will be removed in 4.0. Use e57::ErrorBadCVHeader.
@@ -33,6 +33,8 @@
 
 #include <cfloat>
 #include <cstdint>
+#include <functional>
+#include <future>
 #include <memory>
 #include <vector>
 
@@ -153,6 +155,75 @@ namespace e57
    /// @see e57::ChecksumPolicy
    using ReadChecksumPolicy = int;
 
+   /// @brief Process-wide scheduler for the library's CPU-bound parallel work.
+   ///
+   /// All open readers and writers in a process share one bounded set of worker threads for
+   /// parallel decoding and encoding, so many instances don't oversubscribe the host. An
+   /// application with its own scheduler can take over that work with setExecutor.
+   class E57_DLL TaskScheduler
+   {
+   public:
+      /// A unit of library work; runs to completion without blocking on other tasks.
+      using Task = std::function<void()>;
+
+      /// Runs a Task, possibly on another thread; may also run it inline.
+      using Executor = std::function<void( Task )>;
+
+      TaskScheduler() = delete;
+
+      static void setExecutor( Executor executor );
+      static void setWorkerLimit( unsigned workerCount );
+   };
+
+   /// @brief Process-wide budget for the memory held by the library's caches and staging buffers.
+   ///
+   /// With many ImageFiles open at once, packet read caches and pooled staging buffers add up.
+   /// Setting a budget makes that total predictable: shrinkable holdings (pooled buffers waiting
+   /// for reuse) are released under pressure, while active working state is accounted but kept,
+   /// so the budget is a target under load rather than a hard allocation limit. Per-file usage is
+   /// reported through ImageFileStats::memoryUsedBytes.
+   class E57_DLL MemoryBudget
+   {
+   public:
+      MemoryBudget() = delete;
+
+      static void set( uint64_t byteCount );
+      static uint64_t limit();
+      static uint64_t used();
+   };
+
+   /// @brief Opt-in timeline tracing of the library's pipeline stages.
+   ///
+   /// When the library is compiled with E57_ENABLE_TRACE, the pipeline stages (packet fetch,
+   /// checksum verify, per-channel decode and encode, conversion, XML parse, packet flush) emit
+   /// one Span per execution, either to a chrome://tracing JSON file or to a registered sink.
+   /// This shows *when* stages run and whether they overlap, which the counters of
+   /// ImageFile::stats can't. Without E57_ENABLE_TRACE the span macros compile to nothing and
+   /// these calls are no-ops, so tracing has zero cost by default.
+   class E57_DLL Trace
+   {
+   public:
+      /// @brief One completed pipeline stage execution
+      struct Span
+      {
+         const char *name;           ///< stage name, e.g. "packetFetch" (static storage)
+         uint64_t beginMicroseconds; ///< start on the process monotonic clock
+         uint64_t endMicroseconds;   ///< end on the process monotonic clock
+         uint64_t threadId;          ///< id of the thread the stage ran on
+         uint64_t detail;            ///< stage-specific size (bytes or records), 0 if unused
+      };
+
+      /// Receives each completed span; called from the emitting thread, so it must be fast and
+      /// thread safe.
+      using Sink = std::function<void( const Span & )>;
+
+      Trace() = delete;
+
+      static void setSink( Sink sink );
+      static bool startJSON( const ustring &filePath );
+      static void stop();
+   };
+
    /// @name Deprecated Checksum Policies
    /// These have been replaced by the enum e57::ChecksumPolicy.
    ///@{
@@ -206,9 +277,11 @@ namespace e57
    // E57_INTERNAL_IMPLEMENTATION_ENABLE. Normal API users should not define this symbol.
    // Basically the internal version allows access to the pointer to the implementation (impl_)
 #ifdef E57_INTERNAL_IMPLEMENTATION_ENABLE
+// impl() returns by reference so internal read-only traversal does no
+// reference count updates; callers that need ownership copy at their end.
 #define E57_INTERNAL_ACCESS( T )                                                                   \
 public:                                                                                            \
-   std::shared_ptr<T##Impl> impl() const                                                           \
+   const std::shared_ptr<T##Impl> &impl() const                                                    \
    {                                                                                               \
       return ( impl_ );                                                                            \
    }
@@ -410,6 +483,10 @@ public:
       void checkInvariant( bool doRecurse = true ) const;
 
       /// @cond documentNonPublic The following isn't part of the API, and isn't documented.
+      friend class CompressedVectorReaderImpl;
+
+      explicit SourceDestBuffer( std::shared_ptr<SourceDestBufferImpl> sbi );
+
       E57_INTERNAL_ACCESS( SourceDestBuffer )
 
    protected:
@@ -417,6 +494,18 @@ public:
       /// @endcond
    };
 
+   /// Reports progress of a CompressedVectorReader::read or
+   /// CompressedVectorWriter::write call, once per data packet (~64KB).
+   /// @c recordsCompleted is the number of records transferred since the start
+   /// of the vector, @c bytesMoved the bytes of the binary section processed so
+   /// far. Return false to cancel the transfer.
+   using ProgressCallback = std::function<bool( uint64_t recordsCompleted, uint64_t bytesMoved )>;
+
+   /// Per-record predicate for CompressedVectorReader::setFilter. Receives
+   /// the raw (unscaled) stored integer of the filtered field; return false
+   /// to reject the record before it is converted and delivered.
+   using RecordFilter = std::function<bool( int64_t rawValue )>;
+
    class E57_DLL CompressedVectorReader
    {
    public:
@@ -424,7 +513,20 @@ public:
 
       unsigned read();
       unsigned read( std::vector<SourceDestBuffer> &dbufs );
-      void seek( int64_t recordNumber ); // !!! not implemented yet
+      std::future<unsigned> readAsync();
+      std::future<unsigned> readAsync( std::vector<SourceDestBuffer> &dbufs );
+      ErrorCode trySetBuffers( std::vector<SourceDestBuffer> &dbufs ) noexcept;
+      ErrorCode tryRead( unsigned &recordCount ) noexcept;
+      void setProgressCallback( ProgressCallback callback );
+      void seek( int64_t recordNumber );
+      void setStride( int64_t stride );
+      void setRegion( double xMinimum, double xMaximum, double yMinimum, double yMaximum,
+                      double zMinimum, double zMaximum );
+      void setValidOnly();
+      void setGridSynthesis( int64_t rowMinimum, int64_t columnMinimum, int64_t lineLength,
+                             bool byColumn );
+      void setFilter( const ustring &pathName, RecordFilter predicate );
+      void clearFilters();
       void close();
       bool isOpen();
       CompressedVectorNode compressedVectorNode() const;
@@ -452,7 +554,11 @@ public:
 
       void write( size_t recordCount );
       void write( std::vector<SourceDestBuffer> &sbufs, size_t recordCount );
+      ErrorCode trySetBuffers( std::vector<SourceDestBuffer> &sbufs ) noexcept;
+      ErrorCode tryWrite( size_t recordCount ) noexcept;
+      void setProgressCallback( ProgressCallback callback );
       void close();
+      void checkpoint();
       bool isOpen();
       CompressedVectorNode compressedVectorNode() const;
 
@@ -480,6 +586,7 @@ public:
                                      const VectorNode &codecs );
 
       int64_t childCount() const;
+      int64_t validRecordCount() const;
       Node prototype() const;
       VectorNode codecs() const;
 
@@ -487,6 +594,9 @@ public:
       CompressedVectorWriter writer( std::vector<SourceDestBuffer> &sbufs );
       CompressedVectorReader reader( const std::vector<SourceDestBuffer> &dbufs );
 
+      // Copy the vector into another file byte-for-byte, without decoding:
+      CompressedVectorNode rawCopy( const ImageFile &destImageFile ) const;
+
       // Up/Down cast conversion
       operator Node() const;
       explicit CompressedVectorNode( const Node &n );
@@ -725,6 +835,52 @@ public:
       /// @endcond
    };
 
+   /// @brief Caller-supplied byte source for reading an E57 file from
+   /// somewhere other than the local filesystem
+   ///
+   /// An ImageFile constructed from a ReadProvider serves every file access
+   /// through read(), so the provider decides where the bytes come from: an
+   /// HTTP server answering range requests, an object store, an archive
+   /// member, or anything else addressable by byte range. The page checksum
+   /// layer, the deferred XML parse, and the packet cache all sit on top, so
+   /// a provider only transfers the ranges the reader actually touches.
+   class E57_DLL ReadProvider
+   {
+   public:
+      virtual ~ReadProvider() = default;
+
+      /// @brief Total size of the E57 source in bytes
+      virtual uint64_t size() = 0;
+
+      /// @brief Copy @a count bytes starting at byte @a offset into @a buf
+      /// @details The requested range is always inside size(). An
+      /// implementation must fill the whole range or throw; an E57Exception
+      /// propagates to the caller of the read, anything else terminates. May
+      /// be called concurrently from several threads.
+      virtual void read( uint64_t offset, char *buf, size_t count ) = 0;
+   };
+
+   /// @brief Performance counters collected by an ImageFile while enabled
+   /// with ImageFile::statsSetEnabled
+   struct ImageFileStats
+   {
+      uint64_t bytesRead = 0;         ///< logical bytes delivered by file reads
+      uint64_t bytesWritten = 0;      ///< logical bytes submitted to file writes
+      uint64_t pagesChecksummed = 0;  ///< physical pages whose checksum was verified
+      uint64_t packetCacheHits = 0;   ///< packets served from the packet read cache
+      uint64_t packetCacheMisses = 0; ///< packets the cache had to read from the file
+      uint64_t recordsEncoded = 0;    ///< records written through a CompressedVectorWriter
+      uint64_t recordsDecoded = 0;    ///< records read through a CompressedVectorReader
+      /// records whose row/column indexes were computed arithmetically instead of decoded
+      /// (see CompressedVectorReader::setGridSynthesis)
+      uint64_t recordsSynthesized = 0;
+      double xmlParseSeconds = 0.0; ///< time spent parsing the XML section
+
+      /// bytes of packet cache entries and pooled staging buffers this file currently holds;
+      /// tracked even while the counters are disabled (see MemoryBudget)
+      uint64_t memoryUsedBytes = 0;
+   };
+
    class E57_DLL ImageFile
    {
    public:
@@ -733,10 +889,13 @@ public:
                  ReadChecksumPolicy checksumPolicy = ChecksumAll );
       ImageFile( const char *input, uint64_t size,
                  ReadChecksumPolicy checksumPolicy = ChecksumAll );
+      explicit ImageFile( std::shared_ptr<ReadProvider> provider,
+                          ReadChecksumPolicy checksumPolicy = ChecksumAll );
 
       StructureNode root() const;
       void close();
       void cancel();
+      void checkpoint();
       bool isOpen() const;
       bool isWritable() const;
       ustring fileName() const;
@@ -757,6 +916,35 @@ public:
       void elementNameParse( const ustring &elementName, ustring &prefix,
                              ustring &localPart ) const;
 
+      // Process-wide cache of parsed read mode files:
+      static void readCacheSetCapacity( size_t fileCount );
+      static void readCacheClear();
+
+      // Persistent sidecar metadata cache ("file.e57" -> "file.e57i"):
+      static void sidecarCacheSetEnabled( bool enabled );
+
+      // Performance counters:
+      void statsSetEnabled( bool enabled );
+      ImageFileStats stats() const;
+
+      // Packet read cache budget for this file:
+      void packetCacheSetCapacity( size_t sizeMB );
+
+      // Preferred I/O transfer unit for this file:
+      void ioUnitSetSize( size_t sizeMB );
+
+      // CPU pinning for this file's parallel decode workers:
+      void decodeSetPinWorkers( bool pin );
+
+      // Streaming OS page cache policy for this file's reads:
+      void cacheSetStreaming( bool streaming );
+
+      // Huge page backing for this file's encode/decode staging buffers:
+      void stagingSetHugePages( bool enabled );
+
+      // Bulk page CRC validation:
+      std::vector<uint64_t> verifyChecksums( unsigned nThreads = 0 ) const;
+
       // Diagnostic functions:
       void dump( int indent = 0, std::ostream &os = std::cout ) const;
       void checkInvariant( bool doRecurse = true ) const;
@@ -637,6 +637,23 @@ namespace e57
       */
       explicit Data3DPointsData_t( e57::Data3D &data3D );
 
+      /*!
+      @brief Constructor which allocates fixed-size buffers for all valid fields in the given
+      Data3D header.
+
+      @details
+      Like Data3DPointsData_t( e57::Data3D & ), but each buffer holds @a bufferCount elements
+      instead of one per point, so the points can be read in batches with a bounded memory
+      footprint (see Data3DPointsStream_t).
+
+      @param [in] data3D Completed header which indicates the fields we are using
+      @param [in] bufferCount Number of elements to allocate in each buffer
+
+      @throw ::ErrorValueOutOfBounds
+      @throw ::ErrorInvalidNodeType
+      */
+      Data3DPointsData_t( e57::Data3D &data3D, size_t bufferCount );
+
       /// @brief Destructor will delete any memory allocated using the Data3DPointsData_t( const
       /// e57::Data3D & ) constructor
       ~Data3DPointsData_t();
@@ -745,6 +762,236 @@ namespace e57
    extern template struct Data3DPointsData_t<float>;
    extern template struct Data3DPointsData_t<double>;
 
+   /*!
+   @brief Owning variant of Data3DPointsData_t backed by one aligned slab.
+
+   @details
+   The allocating Data3DPointsData_t constructors make one heap allocation per enabled field,
+   which scatters the buffers and leaves their alignment to the allocator. This variant carves
+   every enabled field out of a single 64-byte-aligned allocation instead, so the buffers are
+   cache-line aligned for vectorized consumers, the allocation and free are single calls, and
+   large scans don't fragment the heap. On Linux the slab can optionally be backed by
+   transparent huge pages.
+
+   The field pointers behave exactly as in Data3DPointsData_t; individual pointers must not be
+   freed or reassigned.
+   */
+   template <typename COORDTYPE = float> struct Data3DPointsSlab_t : Data3DPointsData_t<COORDTYPE>
+   {
+      /*!
+      @brief Constructor which allocates buffers for all valid fields in the given Data3D header.
+
+      @details
+      Performs the same header validation and adjustment as the allocating Data3DPointsData_t
+      constructor, but places all buffers in one 64-byte-aligned slab.
+
+      @param [in] data3D Completed header which indicates the fields we are using
+      @param [in] useHugePages Request transparent huge page backing for the slab (Linux only;
+      silently falls back to a normal allocation elsewhere or on failure)
+
+      @throw ::ErrorValueOutOfBounds
+      @throw ::ErrorInvalidNodeType
+      @throw std::bad_alloc
+      */
+      explicit Data3DPointsSlab_t( e57::Data3D &data3D, bool useHugePages = false );
+
+      /*!
+      @brief Constructor which allocates fixed-size buffers for all valid fields in the given
+      Data3D header.
+
+      @details
+      Like Data3DPointsSlab_t( e57::Data3D &, bool ), but each buffer holds @a bufferCount
+      elements instead of one per point, for batched reads with a bounded memory footprint.
+
+      @param [in] data3D Completed header which indicates the fields we are using
+      @param [in] bufferCount Number of elements to allocate in each buffer
+      @param [in] useHugePages Request transparent huge page backing for the slab (Linux only)
+
+      @throw ::ErrorValueOutOfBounds
+      @throw ::ErrorInvalidNodeType
+      @throw std::bad_alloc
+      */
+      Data3DPointsSlab_t( e57::Data3D &data3D, size_t bufferCount, bool useHugePages = false );
+
+      /// @brief Destructor releases the slab (and with it every field buffer) in one free.
+      ~Data3DPointsSlab_t();
+
+      Data3DPointsSlab_t( const Data3DPointsSlab_t & ) = delete;
+      Data3DPointsSlab_t &operator=( const Data3DPointsSlab_t & ) = delete;
+
+   private:
+      /// @brief The single allocation all field buffers point into.
+      void *_slab = nullptr;
+
+      /// @brief Total slab size in bytes, including per-field alignment padding.
+      size_t _slabSize = 0;
+
+      /// @brief True when the slab came from mmap (huge page path) rather than the allocator.
+      bool _slabIsMapped = false;
+   };
+
+   using Data3DPointsSlabFloat = Data3DPointsSlab_t<float>;
+   using Data3DPointsSlabDouble = Data3DPointsSlab_t<double>;
+
+   extern template struct Data3DPointsSlab_t<float>;
+   extern template struct Data3DPointsSlab_t<double>;
+
+   /*!
+   @brief Rescales a batch of decoded intensity values to the range [0, 1] in place.
+
+   @details
+   Decoded intensity arrives in whatever range the producer recorded (see
+   Data3D::intensityLimits). This rescales @a pointCount contiguous values with one
+   multiply-add per element, written as a tight loop over the whole batch so the compiler can
+   vectorize it, rather than folding the scaling into per-element conversion.
+
+   Does nothing if @a intensity is null or the limits describe an empty range (maximum not
+   greater than minimum, e.g. when the file did not record them).
+
+   @param [in] limits Intensity range recorded in the Data3D header
+   @param [in,out] intensity Contiguous buffer of @a pointCount decoded intensity values
+   @param [in] pointCount Number of values to rescale
+   */
+   E57_DLL void NormalizeIntensity( const IntensityLimits &limits, double *intensity,
+                                    size_t pointCount );
+
+   /*!
+   @brief Rescales a batch of decoded color values to the range [0, 255] in place.
+
+   @details
+   Like NormalizeIntensity(), but for the three color channels: each channel is rescaled from
+   the range recorded in Data3D::colorLimits to [0, 255] with one multiply-add per element over
+   the contiguous batch. Channels whose buffer is null or whose limits describe an empty range
+   are left untouched, so partially colorized prototypes are handled without special casing by
+   the caller.
+
+   @param [in] limits Per-channel color ranges recorded in the Data3D header
+   @param [in,out] colorRed Contiguous buffer of @a pointCount decoded red values (may be null)
+   @param [in,out] colorGreen Contiguous buffer of @a pointCount decoded green values (may be
+   null)
+   @param [in,out] colorBlue Contiguous buffer of @a pointCount decoded blue values (may be
+   null)
+   @param [in] pointCount Number of values to rescale per channel
+   */
+   E57_DLL void NormalizeColor( const ColorLimits &limits, uint16_t *colorRed,
+                                uint16_t *colorGreen, uint16_t *colorBlue, size_t pointCount );
+
+   /*!
+   @brief Rescales the intensity and color buffers of a decoded batch in place.
+
+   @details
+   Convenience wrapper which applies NormalizeIntensity() and NormalizeColor() to the buffers
+   of @a buffers using the limits recorded in @a data3D, typically right after a
+   CompressedVectorReader::read() call that filled them. Fields the prototype does not carry
+   (per Data3D::pointFields) are skipped.
+
+   @param [in] data3D Header of the Data3D block the batch was decoded from
+   @param [in,out] buffers Buffers holding the most recently decoded batch
+   @param [in] pointCount Number of points in the batch (the return value of read())
+   */
+   template <typename COORDTYPE>
+   void NormalizeData3DPointsData( const Data3D &data3D, Data3DPointsData_t<COORDTYPE> &buffers,
+                                   size_t pointCount );
+
+   extern template void NormalizeData3DPointsData<float>( const Data3D &,
+                                                          Data3DPointsData_t<float> &, size_t );
+   extern template void NormalizeData3DPointsData<double>( const Data3D &,
+                                                           Data3DPointsData_t<double> &, size_t );
+
+   /*!
+   @brief Converts a batch of decoded spherical coordinates to Cartesian in one fused pass.
+
+   @details
+   Computes x = r&middot;cos(elevation)&middot;cos(azimuth), y =
+   r&middot;cos(elevation)&middot;sin(azimuth), z = r&middot;sin(elevation) for @a pointCount
+   contiguous points (the E57 spherical convention). The three outputs are produced from one
+   walk over the inputs so the conversion runs while the decoded batch is still cache-resident,
+   instead of as a separate full pass per component afterwards.
+
+   @param [in] sphericalRange Contiguous buffer of decoded range values (in meters)
+   @param [in] sphericalAzimuth Contiguous buffer of decoded azimuth angles (in radians)
+   @param [in] sphericalElevation Contiguous buffer of decoded elevation angles (in radians)
+   @param [out] cartesianX Buffer receiving @a pointCount X coordinates (in meters)
+   @param [out] cartesianY Buffer receiving @a pointCount Y coordinates (in meters)
+   @param [out] cartesianZ Buffer receiving @a pointCount Z coordinates (in meters)
+   @param [in] pointCount Number of points to convert
+   */
+   template <typename COORDTYPE>
+   void ConvertSphericalToCartesian( const COORDTYPE *sphericalRange,
+                                     const COORDTYPE *sphericalAzimuth,
+                                     const COORDTYPE *sphericalElevation, COORDTYPE *cartesianX,
+                                     COORDTYPE *cartesianY, COORDTYPE *cartesianZ,
+                                     size_t pointCount );
+
+   /*!
+   @brief Converts the spherical buffers of a decoded batch into its Cartesian buffers.
+
+   @details
+   Convenience wrapper over the pointer form, typically called right after a
+   CompressedVectorReader::read() that filled @a buffers (see also the fused option on
+   Data3DPointsStream_t). Does nothing unless all three spherical and all three Cartesian
+   buffers are present. The spherical buffers keep their decoded values.
+
+   @param [in,out] buffers Buffers holding the most recently decoded batch
+   @param [in] pointCount Number of points in the batch (the return value of read())
+   */
+   template <typename COORDTYPE>
+   void ConvertSphericalToCartesian( Data3DPointsData_t<COORDTYPE> &buffers, size_t pointCount );
+
+   extern template void ConvertSphericalToCartesian<float>( const float *, const float *,
+                                                            const float *, float *, float *,
+                                                            float *, size_t );
+   extern template void ConvertSphericalToCartesian<double>( const double *, const double *,
+                                                             const double *, double *, double *,
+                                                             double *, size_t );
+   extern template void ConvertSphericalToCartesian<float>( Data3DPointsData_t<float> &, size_t );
+   extern template void ConvertSphericalToCartesian<double>( Data3DPointsData_t<double> &,
+                                                             size_t );
+
+   /*!
+   @brief Applies a rigid-body transform to a batch of Cartesian points in place.
+
+   @details
+   Rotates and translates @a pointCount contiguous points by @a pose (p' = R&middot;p + t). The
+   quaternion is expanded to a rotation matrix once, so the per-point work is nine multiply-adds
+   with no cross-iteration dependencies, written to auto-vectorize. Applying a scan's pose this
+   way right after decode brings the points into project coordinates without a separate full
+   read-modify-write pass over the data.
+
+   @param [in] pose The transform, e.g. Data3D::pose
+   @param [in,out] cartesianX Contiguous buffer of @a pointCount X coordinates (in meters)
+   @param [in,out] cartesianY Contiguous buffer of @a pointCount Y coordinates (in meters)
+   @param [in,out] cartesianZ Contiguous buffer of @a pointCount Z coordinates (in meters)
+   @param [in] pointCount Number of points to transform
+   */
+   template <typename COORDTYPE>
+   void ApplyPose( const RigidBodyTransform &pose, COORDTYPE *cartesianX, COORDTYPE *cartesianY,
+                   COORDTYPE *cartesianZ, size_t pointCount );
+
+   /*!
+   @brief Applies the scan's pose to the Cartesian buffers of a decoded batch in place.
+
+   @details
+   Convenience wrapper over the pointer form using Data3D::pose, typically called right after a
+   CompressedVectorReader::read() that filled @a buffers (see also the fused option on
+   Data3DPointsStream_t). Does nothing unless all three Cartesian buffers are present; an
+   identity pose is applied like any other.
+
+   @param [in] data3D Header of the Data3D block the batch was decoded from
+   @param [in,out] buffers Buffers holding the most recently decoded batch
+   @param [in] pointCount Number of points in the batch (the return value of read())
+   */
+   template <typename COORDTYPE>
+   void ApplyPose( const Data3D &data3D, Data3DPointsData_t<COORDTYPE> &buffers,
+                   size_t pointCount );
+
+   extern template void ApplyPose<float>( const RigidBodyTransform &, float *, float *, float *,
+                                          size_t );
+   extern template void ApplyPose<double>( const RigidBodyTransform &, double *, double *,
+                                           double *, size_t );
+   extern template void ApplyPose<float>( const Data3D &, Data3DPointsData_t<float> &, size_t );
+   extern template void ApplyPose<double>( const Data3D &, Data3DPointsData_t<double> &, size_t );
+
    /// @brief Stores an image that is to be used only as a visual reference.
    struct E57_DLL VisualReferenceRepresentation
    {
@@ -35,6 +35,9 @@
 /// @details This includes support for the
 /// [E57_EXT_surface_normals](http://www.libe57.org/E57_EXT_surface_normals.txt) extension.
 
+#include <functional>
+#include <future>
+
 #include "E57SimpleData.h"
 
 namespace e57
@@ -44,6 +47,38 @@ namespace e57
    {
       /// Set how frequently to verify the checksums (see ReadChecksumPolicy).
       ReadChecksumPolicy checksumPolicy = ChecksumAll;
+
+      /// @brief Open for metadata access only, as fast as possible.
+      /// @details Intended for crawlers that only want scan counts, guids, and bounds. Skips all
+      /// checksum verification (overriding checksumPolicy), so only the file header and the XML
+      /// section are touched at open; binary section headers are not read until a point or image
+      /// read is issued, and per-scan XML subtrees are parsed on first access as usual. Point
+      /// and image data read through such a Reader is also unverified.
+      bool headerOnly = false;
+
+      /// @brief Pin parallel decode workers to CPUs (see ImageFile::decodeSetPinWorkers).
+      /// @details Helps multi-socket ingest machines keep decode traffic on one NUMA node;
+      /// combine with a restricted process affinity mask to choose the node. Linux only,
+      /// silently ignored elsewhere.
+      bool pinDecodeWorkers = false;
+   };
+
+   /// One image read of an asynchronous batch (see Reader::ReadImage2DDataAsync).
+   /// The fields mirror the arguments of Reader::ReadImage2DData.
+   struct E57_DLL Image2DDataRequest
+   {
+      /// index of the image. Must be less than Reader::GetImage2DCount()
+      int64_t imageIndex = 0;
+      /// identifies the projection desired
+      Image2DProjection imageProjection = ProjectionNone;
+      /// identifies the image format desired
+      Image2DType imageType = ImageNone;
+      /// pointer to the raw image buffer to fill, at least count bytes
+      void *buffer = nullptr;
+      /// position in the block to start reading
+      int64_t start = 0;
+      /// size of desired chunk or buffer size
+      int64_t count = 0;
    };
 
    /// @brief Used for reading an E57 file using E57 Simple API.
@@ -113,7 +148,21 @@ namespace e57
                             int64_t &imageSize, Image2DType &imageMaskType,
                             Image2DType &imageVisualType ) const;
 
-      /// @brief Reads an image
+      /// @brief Returns the byte count of one image blob without reading it
+      /// @details Unlike GetImage2DSizes(), which reports the projection's primary image, this
+      /// answers for any specific blob of the image (including the mask), so a viewer can size a
+      /// partial fetch before issuing it.
+      /// @param [in] imageIndex index of the image. Must be less than GetImage2DCount()
+      /// @param [in] imageProjection identifies the projection desired.
+      /// @param [in] imageType identifies the image format desired.
+      /// @return Returns the size of the blob in bytes, or 0 if the image does not carry it
+      int64_t GetImage2DDataSize( int64_t imageIndex, Image2DProjection imageProjection,
+                                  Image2DType imageType ) const;
+
+      /// @brief Reads all or part of an image
+      /// @details The read is clamped to the blob, so a fixed-size partial fetch (e.g. the first
+      /// 16KB of a progressive JPEG for a preview) works on images of any size; repeated calls
+      /// with advancing @p start read the blob incrementally.
       /// @param [in] imageIndex index of the image. Must be less than GetImage2DCount()
       /// @param [in] imageProjection identifies the projection desired.
       /// @param [in] imageType identifies the image format desired.
@@ -125,6 +174,21 @@ namespace e57
                                Image2DType imageType, void *buffer, int64_t start,
                                int64_t count ) const;
 
+      /// @brief Reads a batch of images on a background thread
+      /// @details Returns one future per request, in request order, so image
+      ///          decoding can start on the first image while the rest are
+      ///          still being read from disk. Each future yields what the
+      ///          corresponding ReadImage2DData call would have returned (and
+      ///          rethrows any E57Exception the read raised). The background
+      ///          reads are safe alongside other reads of this file; a second
+      ///          batch submitted before the first finishes waits for it.
+      ///          All futures become ready before the Reader closes.
+      /// @param [in] requests the images to read and the buffers to fill;
+      ///             the buffers must stay valid until their futures are ready
+      /// @return one future per request with the number of bytes transferred
+      std::vector<std::future<int64_t>>
+      ReadImage2DDataAsync( const std::vector<Image2DDataRequest> &requests ) const;
+
       ///@}
 
       /// @name Data3D
@@ -170,6 +234,11 @@ namespace e57
       /// @brief Use this to read the actual 3D data
       /// @details All the non-NULL buffers in buffers have number of elements = pointCount.
       ///          Call the CompressedVectorReader::read() until all data is read.
+      ///
+      ///          Scans may be decoded in parallel: set up one CompressedVectorReader per scan
+      ///          (serialized on one thread), then drive each reader from its own thread. Distinct
+      ///          readers share the underlying file safely; a single reader must not be used from
+      ///          more than one thread at a time.
       /// @param [in] dataIndex data block index
       /// @param [in] pointCount size of each element buffer.
       /// @param [in] buffers pointers to user-provided buffers
@@ -211,4 +280,191 @@ namespace e57
       /// @endcond
    }; // end Reader class
 
+   /*!
+   @brief Reads the points of a Data3D block in fixed-size batches through one reusable set of
+   buffers.
+
+   @details
+   Built on CompressedVectorReader's incremental read() semantics, so a scan of any size can be
+   processed in constant memory: choose a batch size that fits the downstream pipeline's working
+   set, call read() until it returns 0, and consume buffers() after each call. The buffers are
+   allocated once in the constructor and overwritten by every read().
+   */
+   template <typename COORDTYPE = float> class Data3DPointsStream_t
+   {
+   public:
+      /// @brief Set up streaming of the points of a Data3D block.
+      /// @param [in] reader An open Reader
+      /// @param [in] dataIndex data block index
+      /// @param [in] batchSize maximum number of points delivered per read() call
+      /// @param [in] convertSphericalToCartesian when the block stores spherical coordinates,
+      /// also allocate cartesianX/Y/Z buffers and fill them by fused conversion
+      /// (ConvertSphericalToCartesian()) inside every read(), while the decoded batch is still
+      /// cache-resident. Any Cartesian values the file itself carries are overwritten. Ignored
+      /// for blocks without spherical coordinates.
+      /// @param [in] applyPose apply the scan's pose (ApplyPose() with the header's
+      /// Data3D::pose) to the Cartesian buffers inside every read(), fused with the decode, so
+      /// the points come out in project coordinates without a separate pass. Applied after the
+      /// spherical conversion when both options are set; ignored when the batch has no Cartesian
+      /// buffers.
+      Data3DPointsStream_t( const Reader &reader, int64_t dataIndex, size_t batchSize,
+                            bool convertSphericalToCartesian = false, bool applyPose = false );
+
+      ~Data3DPointsStream_t();
+
+      Data3DPointsStream_t( const Data3DPointsStream_t & ) = delete;
+      Data3DPointsStream_t &operator=( const Data3DPointsStream_t & ) = delete;
+
+      /// @brief Returns the Data3D header of the streamed block
+      const Data3D &data3DHeader() const
+      {
+         return data3D_;
+      }
+
+      /// @brief Returns the buffers holding the most recently read batch
+      Data3DPointsData_t<COORDTYPE> &buffers()
+      {
+         return buffers_;
+      }
+
+      /// @brief Reads the next batch of points into buffers()
+      /// @return Number of points read, 0 when the block is exhausted
+      uint64_t read();
+
+      /// @brief Releases the underlying CompressedVectorReader (also done by the destructor)
+      void close();
+
+   private:
+      static Data3D _readHeader( const Reader &reader, int64_t dataIndex,
+                                 bool convertSphericalToCartesian );
+
+      Data3D data3D_;
+      Data3DPointsData_t<COORDTYPE> buffers_;
+      CompressedVectorReader reader_;
+      bool convertSphericalToCartesian_ = false;
+      bool applyPose_ = false;
+   };
+
+   using Data3DPointsStreamFloat = Data3DPointsStream_t<float>;
+   using Data3DPointsStreamDouble = Data3DPointsStream_t<double>;
+
+   extern template class Data3DPointsStream_t<float>;
+   extern template class Data3DPointsStream_t<double>;
+
+   class DatasetReaderImpl;
+
+   /// Options to the DatasetReader constructor
+   struct E57_DLL DatasetReaderOptions
+   {
+      /// Options applied to every file in the set.
+      ReaderOptions readerOptions;
+
+      /// @brief Total packet-cache budget in MB, shared across all files.
+      /// @details Split evenly over the files (at least 1 MB each) via
+      /// ImageFile::packetCacheSetCapacity, so opening hundreds of stations does not multiply
+      /// the per-file default cache size. 0 leaves every file at its default.
+      size_t packetCacheTotalMB = 0;
+
+      /// @brief Worker threads for ForEachData3D (0 picks one per core, capped at the file
+      /// count).
+      unsigned threadCount = 0;
+   };
+
+   /// @brief Reads a set of E57 files (e.g. one per scan station) as one virtual dataset.
+   ///
+   /// @details The Data3D tables of all files are merged into a single scan index: scan
+   /// `dataIndex` values run from 0 to GetData3DCount() - 1 in file order, so callers can
+   /// iterate a whole project without tracking which scan lives in which file.
+   /// ForEachData3D() schedules scan jobs across files on a shared thread pool, and the
+   /// packet-cache budget is shared across the set instead of compounding per file.
+   class E57_DLL DatasetReader
+   {
+   public:
+      /// @brief DatasetReader constructor
+      /// @param [in] filePaths Paths to the E57 files making up the dataset, in dataset order
+      /// @param [in] options Options to be used for the file set
+      explicit DatasetReader( const std::vector<ustring> &filePaths,
+                              const DatasetReaderOptions &options = {} );
+
+      /// @brief Returns true if all files in the set are open
+      bool IsOpen() const;
+
+      /// @brief Closes all files in the set
+      bool Close();
+
+      /// @name File information
+      ///@{
+
+      /// @brief Returns the number of files in the set
+      size_t GetFileCount() const;
+
+      /// @brief Returns the Reader for one file of the set, for per-file access (images,
+      /// raw nodes, ...)
+      /// @param [in] fileIndex index of the file. Must be less than GetFileCount().
+      Reader GetFileReader( size_t fileIndex ) const;
+
+      ///@}
+
+      /// @name Data3D
+      ///@{
+
+      /// @brief Returns the total number of Data3D blocks across all files
+      int64_t GetData3DCount() const;
+
+      /// @brief Maps a dataset-wide scan index to its file and the index within that file
+      /// @param [in] dataIndex dataset-wide scan index. Must be less than GetData3DCount().
+      /// @param [out] fileIndex index of the file holding the scan
+      /// @param [out] localIndex index of the scan within that file's Data3D vector
+      /// @return Returns true if successful
+      bool GetData3DLocation( int64_t dataIndex, size_t &fileIndex, int64_t &localIndex ) const;
+
+      /// @brief Returns the Data3D header (see Reader::ReadData3D)
+      /// @param [in] dataIndex dataset-wide scan index. Must be less than GetData3DCount().
+      /// @param [out] data3DHeader Data3D header
+      /// @return Returns true if successful
+      bool ReadData3D( int64_t dataIndex, Data3D &data3DHeader ) const;
+
+      /// @brief Returns the size of the point data (see Reader::GetData3DSizes)
+      bool GetData3DSizes( int64_t dataIndex, int64_t &rowMax, int64_t &columnMax,
+                           int64_t &pointsSize, int64_t &groupsSize, int64_t &countSize,
+                           bool &columnIndex ) const;
+
+      /// @brief Reads the group data into the provided buffers (see
+      /// Reader::ReadData3DGroupsData)
+      bool ReadData3DGroupsData( int64_t dataIndex, int64_t groupCount, int64_t *idElementValue,
+                                 int64_t *startPointIndex, int64_t *pointCount ) const;
+
+      /// @brief Use this to read the actual 3D data (see Reader::SetUpData3DPointsData)
+      /// @param [in] dataIndex dataset-wide scan index
+      /// @param [in] pointCount size of each element buffer
+      /// @param [in] buffers pointers to user-provided buffers
+      /// @return vector reader setup to read the selected data into the provided buffers
+      CompressedVectorReader SetUpData3DPointsData( int64_t dataIndex, size_t pointCount,
+                                                    const Data3DPointsFloat &buffers ) const;
+
+      /// @overload
+      CompressedVectorReader SetUpData3DPointsData( int64_t dataIndex, size_t pointCount,
+                                                    const Data3DPointsDouble &buffers ) const;
+
+      /// @brief Runs a job per scan, scheduled across the files of the set
+      /// @details The jobs are spread over the shared thread pool one file at a time: scans
+      /// from different files run concurrently, while the scans of any single file run
+      /// sequentially on one thread (per-file readers decode in file order most efficiently,
+      /// and a file set large enough to need this class has ample cross-file parallelism).
+      /// The job receives the dataset-wide scan index and may call any const method of this
+      /// class. Blocks until all jobs are done; if any job throws, the first exception is
+      /// rethrown after the batch completes.
+      /// @param [in] dataIndices the scans to process, each less than GetData3DCount()
+      /// @param [in] job called once per requested scan
+      void ForEachData3D( const std::vector<int64_t> &dataIndices,
+                          const std::function<void( int64_t dataIndex )> &job ) const;
+
+      ///@}
+
+      /// @cond documentNonPublic The following isn't part of the API, and isn't documented.
+   protected:
+      std::shared_ptr<DatasetReaderImpl> impl_;
+      /// @endcond
+   }; // end DatasetReader class
+
 } // end namespace e57
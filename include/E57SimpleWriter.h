@@ -37,6 +37,9 @@
 
 #include "E57SimpleData.h"
 
+#include <future>
+#include <memory>
+
 namespace e57
 {
    /// Options to the Writer constructor
@@ -47,6 +50,24 @@ namespace e57
 
       /// Information describing the Coordinate Reference System to be used for the file
       ustring coordinateMetadata;
+
+      /// @brief Shrink scaled-integer field ranges to the data actually written.
+      /// @details Declared min/max ranges are routinely wider than the data, which wastes bits on
+      /// every packed value. When this option is set, SetUpData3DPointsData() inspects the point
+      /// buffers and tightens each scaled-integer prototype field's raw range to the range its
+      /// buffer spans, so the bitpack codec picks the minimal bit width.
+      ///
+      /// Only use this when the buffers already hold the scan's complete data at the first
+      /// SetUpData3DPointsData() call for the scan: points written later that fall outside the
+      /// tightened range fail with ::ErrorValueOutOfBounds.
+      bool tightenScaledIntegerRanges = false;
+
+      /// @brief Maximum number of scans queued by WriteData3DDataAsync() before it blocks.
+      /// @details Bounds the memory held by buffer sets waiting to be encoded and written. When
+      /// this many submissions are pending, the next WriteData3DDataAsync() call blocks until the
+      /// internal write thread finishes one (backpressure). Two is enough to keep capture and
+      /// writing overlapped; raise it if scan sizes vary a lot and the extra memory is acceptable.
+      size_t asyncWriteQueueDepth = 2;
    };
 
    /// @brief Used for writing an E57 file using the E57 Simple API.
@@ -95,6 +116,27 @@ namespace e57
                                 Image2DProjection imageProjection, int64_t startPos, void *buffer,
                                 int64_t byteCount );
 
+      /// @brief Writes the Image2D data on a background thread
+      /// @details Asynchronous form of WriteImage2DData(): the image header is written and its
+      /// blob section reserved on the calling thread, then the (often large) blob write proceeds
+      /// on a background thread whose file writes are safe next to point writes - so a panorama
+      /// lands on disk while WriteData3DDataAsync() (or a CompressedVectorWriter) is still
+      /// writing points. @p buffer must stay valid and unmodified until the returned future is
+      /// ready. One image write runs at a time; a second submission waits for the first to
+      /// finish, and Close() waits for all of them. On platforms without positioned-I/O
+      /// primitives the data is written before this call returns.
+      /// @note @p image2DHeader may be modified (adding a guid or adding missing, required fields).
+      /// @param [in,out] image2DHeader header metadata
+      /// @param [in] imageType identifies the image format
+      /// @param [in] imageProjection identifies the projection
+      /// @param [in] buffer pointer the data buffer, shared with the write thread
+      /// @param [in] byteCount buffer size
+      /// @return Returns a future resolving to the number of bytes written, or to the exception
+      /// the write failed with.
+      std::future<int64_t> WriteImage2DDataAsync( Image2D &image2DHeader, Image2DType imageType,
+                                                  Image2DProjection imageProjection, void *buffer,
+                                                  int64_t byteCount );
+
       /// @brief Writes a new Image2D header
       /// @details The user needs to config a Image2D structure with all the camera information
       /// before making this call.
@@ -143,6 +185,31 @@ namespace e57
       /// @overload
       int64_t WriteData3DData( Data3D &data3DHeader, const Data3DPointsDouble &buffers );
 
+      /// @brief Queues the Data3D data to be written by an internal thread
+      /// @details Asynchronous form of WriteData3DData() for callers that produce scans faster
+      /// than they can be encoded and written (e.g. a scanner driver thread): the call returns as
+      /// soon as the buffer set is queued, and one internal thread performs the encode and write
+      /// of each queued scan in submission order. At most
+      /// WriterOptions::asyncWriteQueueDepth scans may be pending; beyond that the call blocks
+      /// until the write thread catches up.
+      ///
+      /// The buffer set is shared with the write thread, so it must not be modified until the
+      /// returned future is ready. The header is copied when queued: unlike WriteData3DData(),
+      /// fields filled in during the write (such as a generated guid) are not reflected back, so
+      /// set any fields you need to know beforehand.
+      /// @note Do not call the synchronous write functions while asynchronous writes are pending;
+      /// Close() waits for all pending writes to finish.
+      /// @param [in] data3DHeader metadata about what is included in the buffers
+      /// @param [in] buffers buffers containing the actual data, shared with the write thread
+      /// @return Returns a future resolving to the index of the new scan's data3D block, or to
+      /// the exception the write failed with.
+      std::future<int64_t> WriteData3DDataAsync( const Data3D &data3DHeader,
+                                                 std::shared_ptr<const Data3DPointsFloat> buffers );
+
+      /// @overload
+      std::future<int64_t> WriteData3DDataAsync(
+         const Data3D &data3DHeader, std::shared_ptr<const Data3DPointsDouble> buffers );
+
       /// @brief Writes a new Data3D header
       /// @details The user needs to config a Data3D structure with all the scanning information
       /// before making this call.
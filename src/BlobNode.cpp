@@ -361,7 +361,7 @@ BlobNode::BlobNode( const ImageFile &destImageFile, int64_t fileOffset, int64_t
 {
 }
 
-BlobNode::BlobNode( std::shared_ptr<BlobNodeImpl> ni ) : impl_( ni )
+BlobNode::BlobNode( std::shared_ptr<BlobNodeImpl> ni ) : impl_( std::move( ni ) )
 {
 }
 /// @endcond
@@ -62,9 +62,10 @@ namespace e57
       header.dump(); //???
 #endif
 
-      // Write header at beginning of section
-      imf->file_->seek( binarySectionLogicalStart_ );
-      imf->file_->write( reinterpret_cast<char *>( &header ), sizeof( header ) );
+      // Write header at beginning of section. Positional, so constructing a
+      // blob never disturbs the cursor of a writer on another thread.
+      imf->file_->writeAt( binarySectionLogicalStart_, reinterpret_cast<char *>( &header ),
+                           sizeof( header ) );
    }
 
    BlobNodeImpl::BlobNodeImpl( ImageFileImplWeakPtr destImageFile, int64_t fileOffset,
@@ -136,9 +137,11 @@ namespace e57
       }
 
       ImageFileImplSharedPtr imf( destImageFile_ );
-      imf->file_->seek( binarySectionLogicalStart_ + sizeof( BlobSectionHeader ) + start );
-      imf->file_->read( reinterpret_cast<char *>( buf ),
-                        static_cast<size_t>( count ) ); //??? arg1 void* ?
+
+      // One atomic bulk read; safe next to other threads reading the file
+      imf->file_->readAt( binarySectionLogicalStart_ + sizeof( BlobSectionHeader ) + start,
+                          reinterpret_cast<char *>( buf ),
+                          static_cast<size_t>( count ) ); //??? arg1 void* ?
    }
 
    void BlobNodeImpl::write( uint8_t *buf, int64_t start, size_t count )
@@ -166,9 +169,13 @@ namespace e57
       }
 
       ImageFileImplSharedPtr imf( destImageFile_ );
-      imf->file_->seek( binarySectionLogicalStart_ + sizeof( BlobSectionHeader ) + start );
-      imf->file_->write( reinterpret_cast<char *>( buf ),
-                         static_cast<size_t>( count ) ); //??? arg1 void* ?
+
+      // One positional bulk write into the section reserved at construction;
+      // safe next to a CompressedVectorWriter writing packets on another
+      // thread (see CheckedFile::writeAt)
+      imf->file_->writeAt( binarySectionLogicalStart_ + sizeof( BlobSectionHeader ) + start,
+                           reinterpret_cast<char *>( buf ),
+                           static_cast<size_t>( count ) ); //??? arg1 void* ?
    }
 
    void BlobNodeImpl::checkLeavesInSet( const StringSet &pathNames, NodeImplSharedPtr origin )
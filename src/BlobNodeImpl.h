@@ -46,6 +46,12 @@ namespace e57
       bool isDefined( const ustring &pathName ) override;
 
       int64_t byteCount();
+
+      uint64_t getBinarySectionLogicalStart() const
+      {
+         return binarySectionLogicalStart_;
+      }
+
       void read( uint8_t *buf, int64_t start, size_t count );
       void write( uint8_t *buf, int64_t start, size_t count );
 
@@ -0,0 +1,323 @@
+/*
+ * Original work Copyright 2009 - 2010 Kevin Ackley (kackley@gwi.net)
+ * Modified work Copyright 2018 - 2020 Andy Maloney <asmaloney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+
+#if defined( __linux__ )
+#include <sys/mman.h>
+#endif
+
+#include "BufferPool.h"
+#include "Common.h"
+#include "MemoryBudgetImpl.h"
+
+namespace
+{
+   // Enough for the bytestream buffers of one writer or reader with a
+   // generous prototype; buffers released while the pool is at the cap are
+   // freed, bounding idle memory to roughly cap * DATA_PACKET_MAX bytes.
+   constexpr size_t cMaxPooledBuffers = 64;
+
+   // Allocations below one small page aren't worth carving from a slab
+   constexpr size_t cMinChunkBytes = 4096;
+
+   // One slab spans several huge pages so the mapping cost amortizes; must
+   // be a multiple of the 2MB huge page size
+   constexpr size_t cSlabBytes = 16 * 1024 * 1024;
+
+   // Round up to the next power of two, so freed chunks recycle across the
+   // slightly different buffer sizes of successive prototypes
+   size_t _chunkSize( size_t byteCount )
+   {
+      size_t chunk = cMinChunkBytes;
+
+      while ( chunk < byteCount )
+      {
+         chunk *= 2;
+      }
+
+      return chunk;
+   }
+
+   unsigned _chunkClass( size_t chunkBytes )
+   {
+      unsigned sizeClass = 0;
+
+      while ( ( static_cast<size_t>( 1 ) << sizeClass ) < chunkBytes )
+      {
+         sizeClass++;
+      }
+
+      return sizeClass;
+   }
+
+#if defined( __linux__ )
+   char *_mapSlab( size_t byteCount )
+   {
+      void *mem = ::mmap( nullptr, byteCount, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+      if ( mem == MAP_FAILED )
+      {
+         return nullptr;
+      }
+
+      // Advisory only; the kernel backs what it can with huge pages.
+      ::madvise( mem, byteCount, MADV_HUGEPAGE );
+
+      return static_cast<char *>( mem );
+   }
+#endif
+}
+
+namespace e57
+{
+   StagingArena::~StagingArena()
+   {
+#if defined( __linux__ )
+      for ( auto &slab : slabs_ )
+      {
+         ::munmap( slab.first, slab.second );
+      }
+#endif
+   }
+
+   void StagingArena::setUseHugePages( bool enabled )
+   {
+#if defined( __linux__ )
+      std::lock_guard<std::mutex> lock( mutex_ );
+
+      useHugePages_ = enabled;
+#else
+      UNUSED( enabled );
+#endif
+   }
+
+   bool StagingArena::_ownsMemory( const void *memory ) const
+   {
+      for ( const auto &slab : slabs_ )
+      {
+         if ( ( memory >= slab.first ) && ( memory < slab.first + slab.second ) )
+         {
+            return true;
+         }
+      }
+
+      return false;
+   }
+
+   void *StagingArena::allocate( size_t byteCount )
+   {
+#if defined( __linux__ )
+      if ( byteCount >= cMinChunkBytes )
+      {
+         std::lock_guard<std::mutex> lock( mutex_ );
+
+         if ( useHugePages_ )
+         {
+            const size_t cChunk = _chunkSize( byteCount );
+            const unsigned cClass = _chunkClass( cChunk );
+
+            if ( ( cClass < freeLists_.size() ) && !freeLists_[cClass].empty() )
+            {
+               void *memory = freeLists_[cClass].back();
+               freeLists_[cClass].pop_back();
+               return memory;
+            }
+
+            // A chunk bigger than a slab gets a dedicated mapping
+            const size_t cSlab = std::max( cChunk, cSlabBytes );
+
+            if ( slabs_.empty() || ( slabUsed_ + cChunk > slabs_.back().second ) ||
+                 ( cSlab > cSlabBytes ) )
+            {
+               char *slab = _mapSlab( cSlab );
+
+               if ( slab == nullptr )
+               {
+                  // Mapping failed; fall through to the heap
+                  return ::operator new( byteCount );
+               }
+
+               slabs_.emplace_back( slab, cSlab );
+               slabUsed_ = 0;
+            }
+
+            void *memory = slabs_.back().first + slabUsed_;
+            slabUsed_ += cChunk;
+
+            return memory;
+         }
+      }
+#endif
+
+      return ::operator new( byteCount );
+   }
+
+   void StagingArena::deallocate( void *memory, size_t byteCount )
+   {
+#if defined( __linux__ )
+      if ( byteCount >= cMinChunkBytes )
+      {
+         std::lock_guard<std::mutex> lock( mutex_ );
+
+         // The huge page setting may have changed since this chunk was
+         // allocated, so route by ownership, not by the current setting.
+         if ( _ownsMemory( memory ) )
+         {
+            const unsigned cClass = _chunkClass( _chunkSize( byteCount ) );
+
+            if ( freeLists_.size() <= cClass )
+            {
+               freeLists_.resize( cClass + 1 );
+            }
+
+            freeLists_[cClass].push_back( memory );
+
+            return;
+         }
+      }
+#else
+      UNUSED( byteCount );
+#endif
+
+      ::operator delete( memory );
+   }
+
+   BufferPool::BufferPool()
+   {
+      budgetId_ = MemoryBudgetImpl::instance().addParticipant(
+         [this]( uint64_t byteCount ) { return _shrink( byteCount ); } );
+   }
+
+   BufferPool::~BufferPool()
+   {
+      // Blocks until no shrink callback is in flight, so _shrink can't run
+      // on a destroyed pool
+      MemoryBudgetImpl::instance().removeParticipant( budgetId_ );
+   }
+
+   StagingBuffer BufferPool::acquire( size_t byteCount )
+   {
+      StagingBuffer buffer{ StagingAllocator<char>( arena_ ) };
+
+      uint64_t reusedBytes = 0;
+
+      {
+         std::lock_guard<std::mutex> lock( mutex_ );
+
+         if ( !buffers_.empty() )
+         {
+            buffer = std::move( buffers_.back() );
+            buffers_.pop_back();
+
+            reusedBytes = buffer.capacity();
+            retainedBytes_ -= std::min( retainedBytes_, reusedBytes );
+         }
+      }
+
+      if ( reusedBytes > 0 )
+      {
+         MemoryBudgetImpl::instance().release( budgetId_, reusedBytes );
+      }
+
+      // Any bytes beyond a reused buffer's old size are zeroed here, like a
+      // fresh allocation's; the rest keep their stale contents.
+      buffer.resize( byteCount );
+
+      return buffer;
+   }
+
+   void BufferPool::release( StagingBuffer &&buffer )
+   {
+      if ( buffer.capacity() == 0 )
+      {
+         return;
+      }
+
+      uint64_t pooledBytes = 0;
+
+      {
+         std::lock_guard<std::mutex> lock( mutex_ );
+
+         if ( buffers_.size() < cMaxPooledBuffers )
+         {
+            pooledBytes = buffer.capacity();
+            retainedBytes_ += pooledBytes;
+            buffers_.emplace_back( std::move( buffer ) );
+         }
+      }
+
+      // Charge outside our own lock: the budget may respond by calling
+      // _shrink on this thread, which takes the lock again.
+      if ( pooledBytes > 0 )
+      {
+         MemoryBudgetImpl::instance().charge( budgetId_, pooledBytes );
+      }
+   }
+
+   void BufferPool::setUseHugePages( bool enabled )
+   {
+      arena_->setUseHugePages( enabled );
+   }
+
+   uint64_t BufferPool::usedBytes() const
+   {
+      std::lock_guard<std::mutex> lock( mutex_ );
+
+      return retainedBytes_;
+   }
+
+   uint64_t BufferPool::_shrink( uint64_t byteCount )
+   {
+      // Collect the dropped buffers under the lock but destroy them outside
+      // it; freeing can be slow and may take the arena's lock.
+      std::vector<StagingBuffer> dropped;
+      uint64_t released = 0;
+
+      {
+         std::lock_guard<std::mutex> lock( mutex_ );
+
+         while ( ( released < byteCount ) && !buffers_.empty() )
+         {
+            released += buffers_.back().capacity();
+            dropped.emplace_back( std::move( buffers_.back() ) );
+            buffers_.pop_back();
+         }
+
+         retainedBytes_ -= std::min( retainedBytes_, released );
+      }
+
+      dropped.clear();
+
+      if ( released > 0 )
+      {
+         MemoryBudgetImpl::instance().release( budgetId_, released );
+      }
+
+      return released;
+   }
+}
@@ -0,0 +1,192 @@
+/*
+ * Original work Copyright 2009 - 2010 Kevin Ackley (kackley@gwi.net)
+ * Modified work Copyright 2018 - 2020 Andy Maloney <asmaloney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace e57
+{
+   /// Memory source for staging buffers. By default it is a thin shim over
+   /// the general heap; with setUseHugePages(true) (Linux only) allocations
+   /// of a page or more are instead carved from large anonymous mappings
+   /// advised MADV_HUGEPAGE, so the bytestream staging of a wide prototype -
+   /// hundreds of MB across channels - stops costing one dTLB entry per 4KB
+   /// in the pack/unpack loops. Carved chunks are recycled on power-of-two
+   /// free lists and the mappings are only returned to the OS when the arena
+   /// (and so its ImageFileImpl) is destroyed. Thread safe.
+   class StagingArena
+   {
+   public:
+      StagingArena() = default;
+      ~StagingArena();
+
+      // disallow copying, the slab addresses are owned uniquely
+      StagingArena( const StagingArena & ) = delete;
+      StagingArena &operator=( const StagingArena & ) = delete;
+
+      void setUseHugePages( bool enabled );
+
+      void *allocate( size_t byteCount );
+      void deallocate( void *memory, size_t byteCount );
+
+   private:
+      bool _ownsMemory( const void *memory ) const;
+
+      std::mutex mutex_;
+      bool useHugePages_ = false;
+
+      /// Anonymous mappings carved so far (address, length); the last one is
+      /// the current slab with slabUsed_ bytes handed out
+      std::vector<std::pair<char *, size_t>> slabs_;
+      size_t slabUsed_ = 0;
+
+      /// Recycled chunks by power-of-two size class (index = log2 of size)
+      std::vector<std::vector<void *>> freeLists_;
+   };
+
+   /// Minimal allocator handing std::vector storage to a StagingArena; with
+   /// no arena attached it falls through to the global heap. The arena is
+   /// shared so buffers may outlive the BufferPool they were leased from.
+   template <typename T> class StagingAllocator
+   {
+   public:
+      using value_type = T;
+      using propagate_on_container_copy_assignment = std::true_type;
+      using propagate_on_container_move_assignment = std::true_type;
+      using propagate_on_container_swap = std::true_type;
+
+      StagingAllocator() = default;
+
+      explicit StagingAllocator( std::shared_ptr<StagingArena> arena ) :
+         arena_( std::move( arena ) )
+      {
+      }
+
+      template <typename U>
+      StagingAllocator( const StagingAllocator<U> &other ) : arena_( other.arena() )
+      {
+      }
+
+      T *allocate( size_t count )
+      {
+         if ( arena_ )
+         {
+            return static_cast<T *>( arena_->allocate( count * sizeof( T ) ) );
+         }
+
+         return static_cast<T *>( ::operator new( count * sizeof( T ) ) );
+      }
+
+      void deallocate( T *memory, size_t count )
+      {
+         if ( arena_ )
+         {
+            arena_->deallocate( memory, count * sizeof( T ) );
+            return;
+         }
+
+         ::operator delete( memory );
+      }
+
+      const std::shared_ptr<StagingArena> &arena() const
+      {
+         return arena_;
+      }
+
+   private:
+      std::shared_ptr<StagingArena> arena_;
+   };
+
+   template <typename T, typename U>
+   bool operator==( const StagingAllocator<T> &a, const StagingAllocator<U> &b )
+   {
+      return a.arena() == b.arena();
+   }
+
+   template <typename T, typename U>
+   bool operator!=( const StagingAllocator<T> &a, const StagingAllocator<U> &b )
+   {
+      return !( a == b );
+   }
+
+   /// A byte buffer whose storage comes from its pool's StagingArena
+   using StagingBuffer = std::vector<char, StagingAllocator<char>>;
+
+   /// Pool of byte buffers, so code that repeatedly creates and destroys
+   /// buffers of similar sizes (one bytestream buffer per prototype field,
+   /// per CompressedVector written or read) reuses allocations and their
+   /// already-faulted pages instead of paying for fresh ones each time.
+   /// Each ImageFileImpl owns one, shared by its writers and readers.
+   /// Thread safe.
+   class BufferPool
+   {
+   public:
+      BufferPool();
+      ~BufferPool();
+
+      // disallow copying, the pool is registered with the memory budget
+      BufferPool( const BufferPool & ) = delete;
+      BufferPool &operator=( const BufferPool & ) = delete;
+
+      /// Get a buffer resized to byteCount, reusing a released buffer's
+      /// allocation when one is available. The reused portion holds stale
+      /// contents, like memory from an allocator; callers write before they
+      /// read.
+      StagingBuffer acquire( size_t byteCount );
+
+      /// Return a buffer for later reuse; freed instead if the pool is full
+      void release( StagingBuffer &&buffer );
+
+      /// Back buffers allocated from now on with transparent huge pages
+      /// where the platform supports it (see StagingArena)
+      void setUseHugePages( bool enabled );
+
+      /// Bytes currently held by pooled buffers waiting for reuse (see
+      /// ImageFileStats::memoryUsedBytes)
+      uint64_t usedBytes() const;
+
+   private:
+      /// Free pooled buffers until roughly byteCount bytes are released or
+      /// the pool is empty; returns the bytes released. Called by the
+      /// process-wide memory budget under pressure. Buffers backed by the
+      /// huge-page arena return to its free lists rather than the OS.
+      uint64_t _shrink( uint64_t byteCount );
+
+      std::shared_ptr<StagingArena> arena_{ new StagingArena };
+      mutable std::mutex mutex_;
+      std::vector<StagingBuffer> buffers_;
+
+      // Bytes held in buffers_, mirrored into the process-wide memory
+      // budget under account budgetId_
+      uint64_t retainedBytes_ = 0;
+      uint64_t budgetId_ = 0;
+   };
+}
@@ -60,11 +60,69 @@
 #error "no supported OS platform defined"
 #endif
 
+// Read-only files are memory mapped where possible so pages are demand-paged
+// by the OS and shared between processes reading the same file.
+#if defined( __linux__ ) || defined( __APPLE__ ) || defined( __BSD )
+#define E57_HAVE_MMAP
+#include <sys/mman.h>
+#endif
+
+// Positioned reads (pread) read at an explicit offset without touching the
+// shared file cursor, so concurrent readers need no lock around readAt().
+#if defined( __linux__ ) || defined( __APPLE__ ) || defined( __BSD )
+#define E57_HAVE_PREAD
+#endif
+
+// Files opened for writing flush their pages from a background thread using
+// pwrite, which is position-independent and safe next to the main thread's
+// descriptor use.
+#if defined( __linux__ ) || defined( __APPLE__ ) || defined( __BSD )
+#define E57_HAVE_ASYNC_PAGE_WRITER
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#endif
+
+// Page cache advice for streaming scans (see setCacheStreaming). Apple has no
+// posix_fadvise; the mmap backend covers it there with madvise.
+#if defined( __linux__ ) || defined( __BSD )
+#define E57_HAVE_FADVISE
+#endif
+
+// Page runs are submitted with pwritev directly from the queued page buffers,
+// avoiding the gather copy. Not enabled on Apple platforms, where pwritev
+// requires a recent deployment target.
+#if defined( __linux__ ) || defined( __BSD )
+#define E57_HAVE_PWRITEV
+#include <climits>
+#include <sys/uio.h>
+#endif
+
+#include <atomic>
 #include <cmath>
 #include <cstdio>
 #include <cstring>
+#include <thread>
+
 #include <fcntl.h>
 
+// Hardware CRC32C support (SSE4.2 on x86-64, ARMv8 CRC extension on AArch64).
+// Each path is compiled unconditionally and selected at runtime, so a generic
+// build still accelerates checksums on capable machines.
+#if defined( __x86_64__ ) || defined( _M_X64 )
+#define E57_HAVE_X86_CRC32C
+#include <nmmintrin.h>
+#if defined( _MSC_VER )
+#include <intrin.h>
+#endif
+#elif defined( __aarch64__ ) && defined( __linux__ ) && defined( __GNUC__ )
+#define E57_HAVE_ARM_CRC32C
+#include <arm_acle.h>
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#endif
+
 // This is fixed in a newer version of CRCpp.
 //    https://github.com/d-bahr/CRCpp/issues/17
 // TODO: Remove when new CRCpp is released.
@@ -80,6 +138,7 @@
 
 #include "CheckedFile.h"
 #include "StringFunctions.h"
+#include "TraceImpl.h"
 
 // #define E57_CHECK_FILE_DEBUG
 #ifdef E57_CHECK_FILE_DEBUG
@@ -104,15 +163,121 @@ namespace
       return ( val << 16 ) | ( val >> 16 );
    }
 
-   /// Calc CRC32C of given data
-   uint32_t checksum( char *buf, size_t size )
+   /// Calc CRC32C of given data using the CRCpp software table (~1 byte/cycle)
+   uint32_t swCRC( const char *buf, size_t size )
    {
       static const CRC::Parameters<crcpp_uint32, 32> sCRCParams{ 0x1EDC6F41, 0xFFFFFFFF, 0xFFFFFFFF,
                                                                  true, true };
 
       static const CRC::Table<crcpp_uint32, 32> sCRCTable = sCRCParams.MakeTable();
 
-      auto crc = CRC::Calculate<crcpp_uint32, 32>( buf, size, sCRCTable );
+      return CRC::Calculate<crcpp_uint32, 32>( buf, size, sCRCTable );
+   }
+
+#if defined( E57_HAVE_X86_CRC32C )
+   /// Calc CRC32C of given data using the SSE4.2 crc32 instruction
+#if defined( __GNUC__ )
+   __attribute__( ( target( "sse4.2" ) ) )
+#endif
+   uint32_t hwCRC( const char *buf, size_t size )
+   {
+      uint64_t crc = 0xFFFFFFFFU;
+
+      while ( size >= sizeof( uint64_t ) )
+      {
+         uint64_t chunk;
+         memcpy( &chunk, buf, sizeof( chunk ) );
+         crc = _mm_crc32_u64( crc, chunk );
+         buf += sizeof( uint64_t );
+         size -= sizeof( uint64_t );
+      }
+
+      auto crc32 = static_cast<uint32_t>( crc );
+
+      while ( size > 0 )
+      {
+         crc32 = _mm_crc32_u8( crc32, static_cast<unsigned char>( *buf ) );
+         ++buf;
+         --size;
+      }
+
+      return crc32 ^ 0xFFFFFFFFU;
+   }
+
+   bool hwCRCAvailable()
+   {
+#if defined( __GNUC__ )
+      return __builtin_cpu_supports( "sse4.2" ) != 0;
+#elif defined( _MSC_VER )
+      int cpuInfo[4] = { 0, 0, 0, 0 };
+      __cpuid( cpuInfo, 1 );
+      return ( cpuInfo[2] & ( 1 << 20 ) ) != 0;
+#else
+      return false;
+#endif
+   }
+#elif defined( E57_HAVE_ARM_CRC32C )
+   /// Calc CRC32C of given data using the ARMv8 CRC extension
+   __attribute__( ( target( "+crc" ) ) ) uint32_t hwCRC( const char *buf, size_t size )
+   {
+      uint32_t crc = 0xFFFFFFFFU;
+
+      while ( size >= sizeof( uint64_t ) )
+      {
+         uint64_t chunk;
+         memcpy( &chunk, buf, sizeof( chunk ) );
+         crc = __crc32cd( crc, chunk );
+         buf += sizeof( uint64_t );
+         size -= sizeof( uint64_t );
+      }
+
+      while ( size > 0 )
+      {
+         crc = __crc32cb( crc, static_cast<unsigned char>( *buf ) );
+         ++buf;
+         --size;
+      }
+
+      return crc ^ 0xFFFFFFFFU;
+   }
+
+   bool hwCRCAvailable()
+   {
+      return ( getauxval( AT_HWCAP ) & HWCAP_CRC32 ) != 0;
+   }
+#endif
+
+   /// Calc the page sampling interval for a partial verification policy
+   unsigned int checksumModulus( ReadChecksumPolicy policy )
+   {
+      if ( ( policy <= ChecksumNone ) || ( policy >= ChecksumAll ) )
+      {
+         return 0;
+      }
+
+      return static_cast<unsigned int>( std::nearbyint( 100.0 / policy ) );
+   }
+
+   /// Number of physical pages staged per file access in CheckedFile::read().
+   /// 1024 pages is 1 MB, so a large blob read touches the file once per
+   /// megabyte instead of once per kilobyte page.
+   constexpr size_t cReadChunkPages = 1024;
+
+   /// Bound on the write coalescing buffer of
+   /// CheckedFile::beginStreamWrite(); once this much XML has accumulated it
+   /// is flushed through the paged write path in one piece.
+   constexpr size_t cStreamWriteBound = 1024 * 1024;
+
+   /// Calc CRC32C of given data
+   uint32_t checksum( const char *buf, size_t size )
+   {
+#if defined( E57_HAVE_X86_CRC32C ) || defined( E57_HAVE_ARM_CRC32C )
+      static const bool sUseHwCRC = hwCRCAvailable();
+
+      uint32_t crc = sUseHwCRC ? hwCRC( buf, size ) : swCRC( buf, size );
+#else
+      uint32_t crc = swCRC( buf, size );
+#endif
 
       // (Andy) I don't understand why we need to swap bytes here
       crc = swap_uint32( crc );
@@ -164,12 +329,21 @@ public:
 
    void read( char *buffer, uint64_t count )
    {
-      const uint64_t start = cursorStream_;
-      for ( uint64_t i = 0; i < count; ++i )
+      memcpy( buffer, stream_ + cursorStream_, static_cast<size_t>( count ) );
+      cursorStream_ += count;
+   }
+
+   /// Pointer into the buffer at offset, valid for count bytes, or nullptr
+   /// when the range is out of bounds. Lets callers consume large ranges in
+   /// place without staging them through a copy.
+   const char *view( uint64_t offset, uint64_t count ) const
+   {
+      if ( ( offset > streamSize_ ) || ( count > streamSize_ - offset ) )
       {
-         buffer[i] = stream_[start + i];
-         ++cursorStream_;
+         return nullptr;
       }
+
+      return stream_ + offset;
    }
 
 private:
@@ -178,8 +352,284 @@ private:
    const char *stream_;
 };
 
+#if defined( E57_HAVE_ASYNC_PAGE_WRITER )
+/// Background writer with a bounded queue of completed physical pages.
+///
+/// The main thread keeps serializing packets while this thread stamps each
+/// page's CRC and issues the device writes. Write failures are remembered
+/// and rethrown on the next call into the writer.
+class e57::CheckedFile::AsyncPageWriter
+{
+public:
+   AsyncPageWriter( int fd, size_t capacityPages ) : fd_( fd ), capacity_( capacityPages )
+   {
+      thread_ = std::thread( &AsyncPageWriter::writeLoop, this );
+   }
+
+   ~AsyncPageWriter()
+   {
+      {
+         std::lock_guard<std::mutex> lock( mutex_ );
+         stop_ = true;
+      }
+
+      workAvailable_.notify_all();
+      thread_.join();
+   }
+
+   AsyncPageWriter( const AsyncPageWriter & ) = delete;
+   AsyncPageWriter &operator=( const AsyncPageWriter & ) = delete;
+
+   /// Queue one physical page for writing; blocks while the queue is full.
+   void enqueue( uint64_t physicalOffset, const char *pageBuffer )
+   {
+      std::unique_lock<std::mutex> lock( mutex_ );
+
+      rethrowPendingError();
+
+      queueHasRoom_.wait( lock, [this] { return queue_.size() < capacity_; } );
+
+      std::vector<char> page;
+
+      if ( !freeBuffers_.empty() )
+      {
+         page = std::move( freeBuffers_.back() );
+         freeBuffers_.pop_back();
+      }
+      else
+      {
+         page.resize( physicalPageSize );
+      }
+
+      memcpy( page.data(), pageBuffer, physicalPageSize );
+
+      queue_.emplace_back( physicalOffset, std::move( page ) );
+
+      const uint64_t pageEnd = physicalOffset + physicalPageSize;
+
+      if ( pageEnd > pendingEnd_ )
+      {
+         pendingEnd_ = pageEnd;
+      }
+
+      lock.unlock();
+      workAvailable_.notify_one();
+   }
+
+   /// Bound how many contiguous queued pages are merged into one device
+   /// write; 0 restores the default. May change between writes.
+   void setCoalesceBytes( size_t bytes )
+   {
+      std::lock_guard<std::mutex> lock( mutex_ );
+
+      coalesceBytes_ = ( bytes == 0 ) ? cDefaultCoalesceBytes
+                                      : std::max( bytes, physicalPageSize );
+   }
+
+   /// Block until all queued pages have hit the file, rethrowing any write error.
+   void drain()
+   {
+      std::unique_lock<std::mutex> lock( mutex_ );
+
+      queueEmpty_.wait( lock, [this] { return queue_.empty() && !writing_; } );
+
+      rethrowPendingError();
+   }
+
+   /// Physical end of the file once all queued pages are written
+   uint64_t pendingEnd()
+   {
+      std::lock_guard<std::mutex> lock( mutex_ );
+
+      return pendingEnd_;
+   }
+
+private:
+   // Requires mutex_ held
+   void rethrowPendingError()
+   {
+      if ( pendingError_ )
+      {
+         std::exception_ptr error = pendingError_;
+         pendingError_ = nullptr;
+
+         std::rethrow_exception( error );
+      }
+   }
+
+   void writeLoop()
+   {
+      std::unique_lock<std::mutex> lock( mutex_ );
+
+      while ( true )
+      {
+         workAvailable_.wait( lock, [this] { return stop_ || !queue_.empty(); } );
+
+         if ( queue_.empty() )
+         {
+            if ( stop_ )
+            {
+               return;
+            }
+
+            continue;
+         }
+
+         // Pop a run of physically contiguous pages, bounded by
+         // coalesceBytes_, and issue them as one device write. Packet writes
+         // queue pages in file order, so large runs are the common case and
+         // high-latency storage sees far fewer requests.
+         const uint64_t runOffset = queue_.front().first;
+         const size_t maxRunPages = coalesceBytes_ / physicalPageSize;
+
+         std::vector<std::vector<char>> runPages;
+
+         uint64_t nextOffset = runOffset;
+
+         while ( !queue_.empty() && ( runPages.size() < maxRunPages ) &&
+                 ( queue_.front().first == nextOffset ) )
+         {
+            runPages.push_back( std::move( queue_.front().second ) );
+            queue_.pop_front();
+            nextOffset += physicalPageSize;
+         }
+
+         writing_ = true;
+
+         lock.unlock();
+         queueHasRoom_.notify_all();
+
+         // Append checksums. Stamping here instead of on the producer thread
+         // takes the CRC off the serialization critical path.
+         for ( auto &page : runPages )
+         {
+            const uint32_t check_sum = checksum( page.data(), logicalPageSize );
+            *reinterpret_cast<uint32_t *>( &page[logicalPageSize] ) =
+               check_sum; //??? little endian dependency
+         }
+
+         const size_t runBytes = runPages.size() * physicalPageSize;
+
+         std::exception_ptr error;
+
+         size_t written = 0;
+
+#if defined( E57_HAVE_PWRITEV )
+         // Submit the run as a gathered write straight from the queued page
+         // buffers, up to IOV_MAX pages per call, so no merge copy is needed.
+         // A short write restarts mid-page in the first iovec.
+         std::vector<struct iovec> iov(
+            std::min( runPages.size(), static_cast<size_t>( IOV_MAX ) ) );
+
+         while ( written < runBytes )
+         {
+            const size_t firstPage = written / physicalPageSize;
+            const size_t pageRemainder = written % physicalPageSize;
+            const size_t batchPages = std::min( runPages.size() - firstPage, iov.size() );
+
+            iov[0].iov_base = runPages[firstPage].data() + pageRemainder;
+            iov[0].iov_len = physicalPageSize - pageRemainder;
+
+            for ( size_t i = 1; i < batchPages; i++ )
+            {
+               iov[i].iov_base = runPages[firstPage + i].data();
+               iov[i].iov_len = physicalPageSize;
+            }
+
+            const ssize_t result = ::pwritev( fd_, iov.data(), static_cast<int>( batchPages ),
+                                              static_cast<off_t>( runOffset + written ) );
+
+            if ( result < 0 )
+            {
+               error = std::make_exception_ptr(
+                  E57_EXCEPTION2( ErrorWriteFailed, "result=" + toString( result ) ) );
+               break;
+            }
+
+            written += static_cast<size_t>( result );
+         }
+#else
+         // Gather multi-page runs into one contiguous buffer; a lone page is
+         // written from its own buffer.
+         const char *writeBuf = runPages.front().data();
+
+         if ( runPages.size() > 1 )
+         {
+            mergeBuffer_.resize( runBytes );
+
+            for ( size_t i = 0; i < runPages.size(); i++ )
+            {
+               memcpy( mergeBuffer_.data() + i * physicalPageSize, runPages[i].data(),
+                       physicalPageSize );
+            }
+
+            writeBuf = mergeBuffer_.data();
+         }
+
+         while ( written < runBytes )
+         {
+            const ssize_t result = ::pwrite( fd_, writeBuf + written, runBytes - written,
+                                             static_cast<off_t>( runOffset + written ) );
+
+            if ( result < 0 )
+            {
+               error = std::make_exception_ptr(
+                  E57_EXCEPTION2( ErrorWriteFailed, "result=" + toString( result ) ) );
+               break;
+            }
+
+            written += static_cast<size_t>( result );
+         }
+#endif
+
+         lock.lock();
+
+         writing_ = false;
+
+         if ( error && !pendingError_ )
+         {
+            pendingError_ = error;
+         }
+
+         for ( auto &page : runPages )
+         {
+            freeBuffers_.push_back( std::move( page ) );
+         }
+
+         if ( queue_.empty() )
+         {
+            queueEmpty_.notify_all();
+         }
+      }
+   }
+
+   static constexpr size_t cDefaultCoalesceBytes = 16 * 1024 * 1024;
+
+   const int fd_;
+   const size_t capacity_;
+
+   std::mutex mutex_;
+   std::condition_variable workAvailable_;
+   std::condition_variable queueHasRoom_;
+   std::condition_variable queueEmpty_;
+
+   std::deque<std::pair<uint64_t, std::vector<char>>> queue_;
+   std::vector<std::vector<char>> freeBuffers_;
+#if !defined( E57_HAVE_PWRITEV )
+   std::vector<char> mergeBuffer_;
+#endif
+   size_t coalesceBytes_ = cDefaultCoalesceBytes;
+   uint64_t pendingEnd_ = 0;
+   bool writing_ = false;
+   bool stop_ = false;
+   std::exception_ptr pendingError_;
+
+   std::thread thread_;
+};
+#endif
+
 CheckedFile::CheckedFile( const ustring &fileName, Mode mode, ReadChecksumPolicy policy ) :
-   fileName_( fileName ), checkSumPolicy_( policy )
+   fileName_( fileName ), checkSumPolicy_( policy ), checkSumMod_( checksumModulus( policy ) )
 {
    switch ( mode )
    {
@@ -199,6 +649,30 @@ CheckedFile::CheckedFile( const ustring &fileName, Mode mode, ReadChecksumPolicy
          lseek64( 0, SEEK_SET );
 
          logicalLength_ = physicalToLogical( physicalLength_ );
+
+#if defined( E57_HAVE_MMAP )
+         // Try to map the whole file and serve reads through the BufferView
+         // backend. If the mapping fails (address space, special files, ...)
+         // we silently keep the lseek/read path.
+         if ( physicalLength_ > 0 )
+         {
+            void *map = ::mmap( nullptr, static_cast<size_t>( physicalLength_ ), PROT_READ,
+                                MAP_SHARED, fd_, 0 );
+
+            if ( map != MAP_FAILED )
+            {
+               mmap_ = map;
+               mmapLength_ = physicalLength_;
+
+               bufView_ = new BufferView( static_cast<const char *>( map ), physicalLength_ );
+
+               // The mapping keeps the file contents alive; the descriptor is
+               // no longer needed.
+               ::close( fd_ );
+               fd_ = -1;
+            }
+         }
+#endif
       }
       break;
 
@@ -215,13 +689,44 @@ CheckedFile::CheckedFile( const ustring &fileName, Mode mode, ReadChecksumPolicy
 #endif
 
          fd_ = open64( fileName_, writeFlags, writeMode );
+
+#if defined( E57_HAVE_ASYNC_PAGE_WRITER )
+         // Overlap page writes with serialization; up to 16 MB in flight,
+         // so whole coalesced runs can queue while the device is busy.
+         asyncWriter_ = new AsyncPageWriter( fd_, 16 * 1024 );
+#endif
+      }
+      break;
+
+      case Append:
+      {
+         // Existing file kept as-is; reads and writes both allowed
+
+#if defined( _MSC_VER )
+         constexpr int appendFlags = O_RDWR | O_BINARY;
+#else
+         constexpr int appendFlags = O_RDWR;
+#endif
+
+         fd_ = open64( fileName_, appendFlags, 0 );
+
+         physicalLength_ = lseek64( 0LL, SEEK_END );
+         lseek64( 0, SEEK_SET );
+
+         logicalLength_ = physicalToLogical( physicalLength_ );
+
+#if defined( E57_HAVE_ASYNC_PAGE_WRITER )
+         // Overlap page writes with serialization; up to 16 MB in flight,
+         // so whole coalesced runs can queue while the device is busy.
+         asyncWriter_ = new AsyncPageWriter( fd_, 16 * 1024 );
+#endif
       }
       break;
    }
 }
 
 CheckedFile::CheckedFile( const char *input, uint64_t size, ReadChecksumPolicy policy ) :
-   fileName_( "<StreamBuffer>" ), checkSumPolicy_( policy )
+   fileName_( "<StreamBuffer>" ), checkSumPolicy_( policy ), checkSumMod_( checksumModulus( policy ) )
 {
    bufView_ = new BufferView( input, size );
 
@@ -233,6 +738,21 @@ CheckedFile::CheckedFile( const char *input, uint64_t size, ReadChecksumPolicy p
    logicalLength_ = physicalToLogical( physicalLength_ );
 }
 
+CheckedFile::CheckedFile( std::shared_ptr<ReadProvider> provider, ReadChecksumPolicy policy ) :
+   fileName_( "<ReadProvider>" ), checkSumPolicy_( policy ),
+   checkSumMod_( checksumModulus( policy ) ), provider_( std::move( provider ) )
+{
+   if ( !provider_ )
+   {
+      throw E57_EXCEPTION2( ErrorBadAPIArgument, "fileName=" + fileName_ );
+   }
+
+   readOnly_ = true;
+
+   physicalLength_ = provider_->size();
+   logicalLength_ = physicalToLogical( physicalLength_ );
+}
+
 int CheckedFile::open64( const ustring &fileName, int flags, int mode )
 {
 #if defined( _MSC_VER )
@@ -300,55 +820,432 @@ void CheckedFile::read( char *buf, size_t nRead, size_t /*bufSize*/ )
                                               " length=" + toString( logicalLength ) );
    }
 
+   if ( stats_ != nullptr )
+   {
+      stats_->bytesRead += nRead;
+   }
+
    uint64_t page = 0;
    size_t pageOffset = 0;
 
    getCurrentPageAndOffset( page, pageOffset );
 
-   size_t n = std::min( nRead, logicalPageSize - pageOffset );
+   // Make sure queued writes of any page have landed before reading
+   if ( asyncWriter_ != nullptr )
+   {
+      asyncWriter_->drain();
+   }
+
+   // Staging buffer for the descriptor path; the buffer view path below
+   // verifies and copies pages in place without staging them.
+   std::vector<char> chunk_v;
+
+   while ( nRead > 0 )
+   {
+      // Cover as many whole physical pages as possible with one file access
+      const uint64_t pagesLeft = ( pageOffset + nRead + logicalPageSize - 1 ) / logicalPageSize;
+      const auto chunkPages =
+         static_cast<size_t>( std::min( pagesLeft, static_cast<uint64_t>( cReadChunkPages ) ) );
+      const size_t chunkBytes = chunkPages * physicalPageSize;
+
+      const char *chunk = nullptr;
+
+      if ( ( fd_ < 0 ) && ( bufView_ != nullptr ) )
+      {
+         chunk = bufView_->view( page * physicalPageSize, chunkBytes );
+      }
+
+      if ( chunk == nullptr )
+      {
+         chunk_v.resize( chunkBytes );
+
+         seek( page * physicalPageSize, Physical );
+
+         if ( ( fd_ < 0 ) && ( bufView_ != nullptr ) )
+         {
+            bufView_->read( chunk_v.data(), chunkBytes );
+         }
+         else if ( provider_ != nullptr )
+         {
+            provider_->read( page * physicalPageSize, chunk_v.data(), chunkBytes );
+         }
+         else
+         {
+            size_t got = 0;
+
+            while ( got < chunkBytes )
+            {
+#if defined( _MSC_VER )
+               int result =
+                  ::_read( fd_, chunk_v.data() + got, static_cast<unsigned>( chunkBytes - got ) );
+#elif defined( __GNUC__ )
+               ssize_t result = ::read( fd_, chunk_v.data() + got, chunkBytes - got );
+#else
+#error "no supported compiler defined"
+#endif
+               if ( result <= 0 )
+               {
+                  throw E57_EXCEPTION2( ErrorReadFailed, "fileName=" + fileName_ +
+                                                            " result=" + toString( result ) );
+               }
+
+               got += static_cast<size_t>( result );
+            }
+         }
+
+         chunk = chunk_v.data();
+      }
+
+      // Verify and copy out the logical payload of each page in the chunk
+      E57_TRACE_SPAN_SIZED( "crcVerify", chunkBytes );
+
+      for ( size_t i = 0; i < chunkPages; ++i )
+      {
+         const char *page_buffer = chunk + i * physicalPageSize;
+
+         switch ( checkSumPolicy_ )
+         {
+            case ChecksumPolicy::ChecksumNone:
+               break;
+
+            case ChecksumPolicy::ChecksumAll:
+               verifyChecksum( page_buffer, page );
+               break;
+
+            default:
+            {
+               if ( !( page % checkSumMod_ ) || ( nRead < physicalPageSize ) )
+               {
+                  verifyChecksum( page_buffer, page );
+               }
+            }
+            break;
+         }
+
+         const size_t n = std::min( nRead, logicalPageSize - pageOffset );
+
+         memcpy( buf, page_buffer + pageOffset, n );
+
+         buf += n;
+         nRead -= n;
+         pageOffset = 0;
+         ++page;
+      }
+   }
+
+   // When done, leave cursor just past end of last byte read
+   seek( end, Logical );
+}
+
+void CheckedFile::readAt( uint64_t logicalOffset, char *buf, size_t nRead )
+{
+   E57_TRACE_SPAN_SIZED( "fileRead", nRead );
+
+#if !defined( E57_HAVE_PREAD )
+   if ( fd_ >= 0 )
+   {
+      // No positioned-read primitive on this platform; serialize the cursor
+      // movement instead.
+      std::lock_guard<std::mutex> lock( ioMutex_ );
+
+      seek( logicalOffset, Logical );
+      read( buf, nRead );
+
+      return;
+   }
+#endif
+
+   // Stateless positioned read: each call computes its own page range and
+   // reads it with pread (or straight out of the mapping), never touching
+   // the shared cursor, so N reader threads share this file with no mutual
+   // exclusion on the hot path.
+   const uint64_t end = logicalOffset + nRead;
+
+   if ( end > logicalLength_ )
+   {
+      throw E57_EXCEPTION2( ErrorInternal, "fileName=" + fileName_ + " end=" + toString( end ) +
+                                              " length=" + toString( logicalLength_ ) );
+   }
+
+   if ( stats_ != nullptr )
+   {
+      stats_->bytesRead += nRead;
+   }
+
+   // Only Write and Append mode files have an async writer; make sure queued
+   // pages have landed before reading them back. Read mode files skip this.
+   if ( asyncWriter_ != nullptr )
+   {
+      asyncWriter_->drain();
+   }
+
+   uint64_t page = logicalOffset / logicalPageSize;
+   auto pageOffset = static_cast<size_t>( logicalOffset - page * logicalPageSize );
+
+   // Staging buffer for the descriptor path; the buffer view path below
+   // verifies and copies pages in place without staging them.
+   std::vector<char> chunk_v;
+
+   while ( nRead > 0 )
+   {
+      // Cover as many whole physical pages as possible with one file access
+      const uint64_t pagesLeft = ( pageOffset + nRead + logicalPageSize - 1 ) / logicalPageSize;
+      const auto chunkPages =
+         static_cast<size_t>( std::min( pagesLeft, static_cast<uint64_t>( cReadChunkPages ) ) );
+      const size_t chunkBytes = chunkPages * physicalPageSize;
+
+      const char *chunk = nullptr;
+
+      if ( ( fd_ < 0 ) && ( bufView_ != nullptr ) )
+      {
+         chunk = bufView_->view( page * physicalPageSize, chunkBytes );
+      }
+      else if ( provider_ != nullptr )
+      {
+         // Providers allow concurrent read() calls, so this path is as
+         // cursor-free as pread below
+         chunk_v.resize( chunkBytes );
+
+         provider_->read( page * physicalPageSize, chunk_v.data(), chunkBytes );
+
+         chunk = chunk_v.data();
+      }
+#if defined( E57_HAVE_PREAD )
+      else if ( fd_ >= 0 )
+      {
+         chunk_v.resize( chunkBytes );
+
+         size_t got = 0;
+
+         while ( got < chunkBytes )
+         {
+            const ssize_t result =
+               ::pread( fd_, chunk_v.data() + got, chunkBytes - got,
+                        static_cast<off_t>( page * physicalPageSize + got ) );
+
+            if ( result <= 0 )
+            {
+               throw E57_EXCEPTION2( ErrorReadFailed,
+                                     "fileName=" + fileName_ + " result=" + toString( result ) );
+            }
+
+            got += static_cast<size_t>( result );
+         }
+
+         chunk = chunk_v.data();
+      }
+#endif
+
+      if ( chunk == nullptr )
+      {
+         throw E57_EXCEPTION2( ErrorReadFailed,
+                               "fileName=" + fileName_ + " page=" + toString( page ) );
+      }
+
+      // Verify and copy out the logical payload of each page in the chunk
+      E57_TRACE_SPAN_SIZED( "crcVerify", chunkBytes );
+
+      for ( size_t i = 0; i < chunkPages; ++i )
+      {
+         const char *page_buffer = chunk + i * physicalPageSize;
+
+         switch ( checkSumPolicy_ )
+         {
+            case ChecksumPolicy::ChecksumNone:
+               break;
+
+            case ChecksumPolicy::ChecksumAll:
+               verifyChecksum( page_buffer, page );
+               break;
+
+            default:
+            {
+               if ( !( page % checkSumMod_ ) || ( nRead < physicalPageSize ) )
+               {
+                  verifyChecksum( page_buffer, page );
+               }
+            }
+            break;
+         }
+
+         const size_t n = std::min( nRead, logicalPageSize - pageOffset );
+
+         memcpy( buf, page_buffer + pageOffset, n );
+
+         buf += n;
+         nRead -= n;
+         pageOffset = 0;
+         ++page;
+      }
+   }
+}
+
+std::vector<uint64_t> CheckedFile::verifyChecksums( unsigned nThreads )
+{
+   // Make sure queued writes have landed so every page is final on disk
+   if ( asyncWriter_ != nullptr )
+   {
+      asyncWriter_->drain();
+   }
+
+   const uint64_t pageCount = length( Physical ) / physicalPageSize;
+
+   std::vector<uint64_t> badOffsets;
+
+   if ( pageCount == 0 )
+   {
+      return badOffsets;
+   }
+
+   if ( nThreads == 0 )
+   {
+      nThreads = std::max( 1U, std::thread::hardware_concurrency() );
+   }
+
+   // Workers claim 1 MB chunks of consecutive pages, so reads stay
+   // sequential per claim even when verification is spread across cores.
+   const uint64_t chunkCount = ( pageCount + cReadChunkPages - 1 ) / cReadChunkPages;
+
+   nThreads = static_cast<unsigned>(
+      std::min( static_cast<uint64_t>( nThreads ), chunkCount ) );
+
+   const uint64_t savedPosition = position( Physical );
+
+   std::atomic<uint64_t> nextChunk( 0 );
+   std::mutex resultMutex;
+   std::exception_ptr firstError;
+
+   auto verifyChunks = [&]() {
+      std::vector<char> chunk_v;
+      std::vector<uint64_t> localBad;
+
+      try
+      {
+         for ( uint64_t chunkIndex = nextChunk++; chunkIndex < chunkCount;
+               chunkIndex = nextChunk++ )
+         {
+            const uint64_t firstPage = chunkIndex * cReadChunkPages;
+            const auto chunkPages = static_cast<size_t>(
+               std::min( static_cast<uint64_t>( cReadChunkPages ), pageCount - firstPage ) );
+            const size_t chunkBytes = chunkPages * physicalPageSize;
+
+            const char *chunk = nullptr;
+
+            if ( ( fd_ < 0 ) && ( bufView_ != nullptr ) )
+            {
+               // Memory mapped: verify in place, concurrent views are safe
+               chunk = bufView_->view( firstPage * physicalPageSize, chunkBytes );
+            }
+            else if ( provider_ != nullptr )
+            {
+               // Providers allow concurrent read() calls, no cursor to claim
+               chunk_v.resize( chunkBytes );
+
+               provider_->read( firstPage * physicalPageSize, chunk_v.data(), chunkBytes );
+
+               chunk = chunk_v.data();
+            }
+
+            if ( chunk == nullptr )
+            {
+               chunk_v.resize( chunkBytes );
+
+               // The descriptor cursor is shared, so claim it per chunk
+               std::lock_guard<std::mutex> lock( ioMutex_ );
+
+               seek( firstPage * physicalPageSize, Physical );
+
+               size_t got = 0;
+
+               while ( got < chunkBytes )
+               {
+#if defined( _MSC_VER )
+                  int result =
+                     ::_read( fd_, chunk_v.data() + got, static_cast<unsigned>( chunkBytes - got ) );
+#elif defined( __GNUC__ )
+                  ssize_t result = ::read( fd_, chunk_v.data() + got, chunkBytes - got );
+#else
+#error "no supported compiler defined"
+#endif
+                  if ( result <= 0 )
+                  {
+                     throw E57_EXCEPTION2( ErrorReadFailed, "fileName=" + fileName_ + " result=" +
+                                                               toString( result ) );
+                  }
+
+                  got += static_cast<size_t>( result );
+               }
+
+               chunk = chunk_v.data();
+            }
+
+            for ( size_t i = 0; i < chunkPages; ++i )
+            {
+               const char *page_buffer = chunk + i * physicalPageSize;
+
+               const uint32_t check_sum = checksum( page_buffer, logicalPageSize );
+               const uint32_t check_sum_in_page =
+                  *reinterpret_cast<const uint32_t *>( &page_buffer[logicalPageSize] );
+
+               if ( check_sum_in_page != check_sum )
+               {
+                  localBad.push_back( ( firstPage + i ) * physicalPageSize );
+               }
+            }
+
+            if ( stats_ != nullptr )
+            {
+               stats_->pagesChecksummed += chunkPages;
+            }
+         }
+      }
+      catch ( ... )
+      {
+         std::lock_guard<std::mutex> lock( resultMutex );
+
+         if ( !firstError )
+         {
+            firstError = std::current_exception();
+         }
+      }
+
+      std::lock_guard<std::mutex> lock( resultMutex );
 
-   // Allocate temp page buffer
-   std::vector<char> page_buffer_v( physicalPageSize );
-   char *page_buffer = page_buffer_v.data();
+      badOffsets.insert( badOffsets.end(), localBad.begin(), localBad.end() );
+   };
 
-   while ( nRead > 0 )
+   if ( nThreads < 2 )
    {
-      readPhysicalPage( page_buffer, page );
-
-      switch ( checkSumPolicy_ )
-      {
-         case ChecksumPolicy::ChecksumNone:
-            break;
-
-         case ChecksumPolicy::ChecksumAll:
-            verifyChecksum( page_buffer, page );
-            break;
+      verifyChunks();
+   }
+   else
+   {
+      std::vector<std::thread> workers;
 
-         default:
-         {
-            const auto checksumMod =
-               static_cast<unsigned int>( std::nearbyint( 100.0 / checkSumPolicy_ ) );
+      workers.reserve( nThreads );
 
-            if ( !( page % checksumMod ) || ( nRead < physicalPageSize ) )
-            {
-               verifyChecksum( page_buffer, page );
-            }
-         }
-         break;
+      for ( unsigned i = 0; i < nThreads; ++i )
+      {
+         workers.emplace_back( verifyChunks );
       }
 
-      memcpy( buf, page_buffer + pageOffset, n );
+      for ( auto &worker : workers )
+      {
+         worker.join();
+      }
+   }
 
-      buf += n;
-      nRead -= n;
-      pageOffset = 0;
-      ++page;
+   seek( savedPosition, Physical );
 
-      n = std::min( nRead, logicalPageSize );
+   if ( firstError )
+   {
+      std::rethrow_exception( firstError );
    }
 
-   // When done, leave cursor just past end of last byte read
-   seek( end, Logical );
+   // Workers finish out of order, so put the report back in file order
+   std::sort( badOffsets.begin(), badOffsets.end() );
+
+   return badOffsets;
 }
 
 void CheckedFile::write( const char *buf, size_t nWrite )
@@ -362,6 +1259,23 @@ void CheckedFile::write( const char *buf, size_t nWrite )
       throw E57_EXCEPTION2( ErrorFileReadOnly, "fileName=" + fileName_ );
    }
 
+   if ( streaming_ )
+   {
+      streamBuffer_.append( buf, nWrite );
+
+      if ( streamBuffer_.size() >= cStreamWriteBound )
+      {
+         flushStreamBuffer();
+      }
+
+      return;
+   }
+
+   if ( stats_ != nullptr )
+   {
+      stats_->bytesWritten += nWrite;
+   }
+
    uint64_t end = position( Logical ) + nWrite;
 
    uint64_t page = 0;
@@ -375,6 +1289,10 @@ void CheckedFile::write( const char *buf, size_t nWrite )
    std::vector<char> page_buffer_v( physicalPageSize );
    char *page_buffer = page_buffer_v.data();
 
+   // A concurrent writeAt() may be filling a neighbouring section whose
+   // boundary page we share; serialize the page read-modify-writes.
+   std::lock_guard<std::mutex> lock( writeMutex_ );
+
    while ( nWrite > 0 )
    {
       const uint64_t physicalLength = length( Physical );
@@ -412,6 +1330,221 @@ void CheckedFile::write( const char *buf, size_t nWrite )
    seek( end, Logical );
 }
 
+void CheckedFile::writeAt( uint64_t logicalOffset, const char *buf, size_t nWrite )
+{
+   if ( readOnly_ )
+   {
+      throw E57_EXCEPTION2( ErrorFileReadOnly, "fileName=" + fileName_ );
+   }
+
+   if ( streaming_ )
+   {
+      throw E57_EXCEPTION2( ErrorInternal, "fileName=" + fileName_ );
+   }
+
+   // The destination must be reserved up front (see extend()); growing the
+   // file is left to the cursor path so the two never fight over the length.
+   const uint64_t end = logicalOffset + nWrite;
+
+   if ( end > logicalLength_ )
+   {
+      throw E57_EXCEPTION2( ErrorInternal, "fileName=" + fileName_ + " end=" + toString( end ) +
+                                              " length=" + toString( logicalLength_ ) );
+   }
+
+   if ( stats_ != nullptr )
+   {
+      stats_->bytesWritten += nWrite;
+   }
+
+   uint64_t page = logicalOffset / logicalPageSize;
+   auto pageOffset = static_cast<size_t>( logicalOffset - page * logicalPageSize );
+
+   size_t n = std::min( nWrite, logicalPageSize - pageOffset );
+
+   // Allocate temp page buffer
+   std::vector<char> page_buffer_v( physicalPageSize );
+   char *page_buffer = page_buffer_v.data();
+
+   // Hold the lock across the whole range: a page at a section boundary may
+   // also be touched by the cursor path, and the read-modify-write of each
+   // page must not interleave with it.
+   std::lock_guard<std::mutex> lock( writeMutex_ );
+
+   while ( nWrite > 0 )
+   {
+      // Whole-page stores don't need the page's old content read back
+      if ( n < logicalPageSize )
+      {
+         readPhysicalPageAt( page_buffer, page );
+      }
+
+      memcpy( page_buffer + pageOffset, buf, n );
+      writePhysicalPageAt( page_buffer, page );
+
+      buf += n;
+      nWrite -= n;
+      pageOffset = 0;
+      ++page;
+      n = std::min( nWrite, logicalPageSize );
+   }
+}
+
+bool CheckedFile::positionedWritesSupported()
+{
+#if defined( E57_HAVE_PREAD ) && defined( E57_HAVE_ASYNC_PAGE_WRITER )
+   return true;
+#else
+   return false;
+#endif
+}
+
+void CheckedFile::setWriteCoalesceBytes( size_t bytes )
+{
+   if ( asyncWriter_ != nullptr )
+   {
+      asyncWriter_->setCoalesceBytes( bytes );
+   }
+}
+
+void CheckedFile::setCacheStreaming( bool streaming )
+{
+   cacheStreaming_ = streaming;
+
+   if ( !streaming )
+   {
+      return;
+   }
+
+#if defined( E57_HAVE_MMAP )
+   if ( mmap_ != nullptr )
+   {
+      ::madvise( mmap_, static_cast<size_t>( mmapLength_ ), MADV_SEQUENTIAL );
+      return;
+   }
+#endif
+
+#if defined( E57_HAVE_FADVISE )
+   if ( fd_ >= 0 )
+   {
+      ::posix_fadvise( fd_, 0, 0, POSIX_FADV_SEQUENTIAL );
+   }
+#endif
+}
+
+void CheckedFile::adviseWillNeed( uint64_t physicalOffset, uint64_t count )
+{
+   if ( !cacheStreaming_ || ( count == 0 ) )
+   {
+      return;
+   }
+
+#if defined( E57_HAVE_MMAP )
+   if ( mmap_ != nullptr )
+   {
+      if ( physicalOffset >= mmapLength_ )
+      {
+         return;
+      }
+
+      count = std::min( count, mmapLength_ - physicalOffset );
+
+      // madvise requires a page-aligned start address
+      const uint64_t aligned = physicalOffset & ~static_cast<uint64_t>( 4095 );
+
+      ::madvise( static_cast<char *>( mmap_ ) + aligned,
+                 static_cast<size_t>( count + ( physicalOffset - aligned ) ), MADV_WILLNEED );
+      return;
+   }
+#endif
+
+#if defined( E57_HAVE_FADVISE )
+   if ( fd_ >= 0 )
+   {
+      ::posix_fadvise( fd_, static_cast<off_t>( physicalOffset ), static_cast<off_t>( count ),
+                       POSIX_FADV_WILLNEED );
+   }
+#else
+   UNUSED( physicalOffset );
+#endif
+}
+
+void CheckedFile::adviseDone( uint64_t physicalOffset, uint64_t count )
+{
+   if ( !cacheStreaming_ || ( count == 0 ) )
+   {
+      return;
+   }
+
+#if defined( E57_HAVE_MMAP )
+   if ( mmap_ != nullptr )
+   {
+      if ( physicalOffset >= mmapLength_ )
+      {
+         return;
+      }
+
+      count = std::min( count, mmapLength_ - physicalOffset );
+
+      // madvise requires a page-aligned start address; MADV_DONTNEED on a
+      // read-only shared file mapping just drops clean pages.
+      const uint64_t aligned = physicalOffset & ~static_cast<uint64_t>( 4095 );
+
+      ::madvise( static_cast<char *>( mmap_ ) + aligned,
+                 static_cast<size_t>( count + ( physicalOffset - aligned ) ), MADV_DONTNEED );
+      return;
+   }
+#endif
+
+#if defined( E57_HAVE_FADVISE )
+   if ( fd_ >= 0 )
+   {
+      ::posix_fadvise( fd_, static_cast<off_t>( physicalOffset ), static_cast<off_t>( count ),
+                       POSIX_FADV_DONTNEED );
+   }
+#else
+   UNUSED( physicalOffset );
+#endif
+}
+
+void CheckedFile::beginStreamWrite()
+{
+   streaming_ = true;
+}
+
+void CheckedFile::endStreamWrite()
+{
+   flushStreamBuffer();
+   streaming_ = false;
+}
+
+void CheckedFile::flushStreamBuffer()
+{
+   if ( streamBuffer_.empty() )
+   {
+      return;
+   }
+
+   // Swap the pending bytes out so the recursive write() call below takes the
+   // normal paged path; serialization refills a fresh buffer meanwhile.
+   std::string pending;
+
+   pending.swap( streamBuffer_ );
+   streaming_ = false;
+
+   try
+   {
+      write( pending.data(), pending.size() );
+   }
+   catch ( ... )
+   {
+      streaming_ = true;
+      throw;
+   }
+
+   streaming_ = true;
+}
+
 CheckedFile &CheckedFile::operator<<( const ustring &s )
 {
    write( s.c_str(), s.length() ); //??? should be times size of uchar?
@@ -485,6 +1618,36 @@ uint64_t CheckedFile::lseek64( int64_t offset, int whence )
                                                 " whence=" + toString( whence ) );
    }
 
+   if ( ( fd_ < 0 ) && ( provider_ != nullptr ) )
+   {
+      // No backend cursor; track the position locally like BufferView does
+      uint64_t pos = providerPos_;
+
+      if ( whence == SEEK_SET )
+      {
+         pos = static_cast<uint64_t>( offset );
+      }
+      else if ( whence == SEEK_CUR )
+      {
+         pos += static_cast<uint64_t>( offset );
+      }
+      else if ( whence == SEEK_END )
+      {
+         pos = physicalLength_ - static_cast<uint64_t>( offset );
+      }
+
+      if ( pos > physicalLength_ )
+      {
+         throw E57_EXCEPTION2( ErrorSeekFailed, "fileName=" + fileName_ +
+                                                   " offset=" + toString( offset ) +
+                                                   " whence=" + toString( whence ) );
+      }
+
+      providerPos_ = pos;
+
+      return pos;
+   }
+
 #if defined( _WIN32 )
    __int64 result = _lseeki64( fd_, offset, whence );
 #elif defined( __linux__ )
@@ -536,6 +1699,12 @@ uint64_t CheckedFile::length( OffsetMode omode )
       // Restore original position
       lseek64( original_pos, SEEK_SET );
 
+      // Queued pages may extend past what has hit the device so far
+      if ( asyncWriter_ != nullptr )
+      {
+         end_pos = std::max( end_pos, asyncWriter_->pendingEnd() );
+      }
+
       return end_pos;
    }
 
@@ -577,13 +1746,8 @@ void CheckedFile::extend( uint64_t newLength, OffsetMode omode )
    // Calc how may zero bytes we have to add to end
    uint64_t nWrite = newLogicalLength - currentLogicalLength;
 
-   // Seek to current end of file
-   seek( currentLogicalLength, Logical );
-
-   uint64_t page = 0;
-   size_t pageOffset = 0;
-
-   getCurrentPageAndOffset( page, pageOffset );
+   uint64_t page = currentLogicalLength / logicalPageSize;
+   auto pageOffset = static_cast<size_t>( currentLogicalLength - page * logicalPageSize );
 
    // Calc first write size (may be partial page)
    // Watch out for different int sizes here.
@@ -602,13 +1766,16 @@ void CheckedFile::extend( uint64_t newLength, OffsetMode omode )
    std::vector<char> page_buffer_v( physicalPageSize );
    char *page_buffer = page_buffer_v.data();
 
+   // Same boundary-page coordination as write() and writeAt()
+   std::lock_guard<std::mutex> lock( writeMutex_ );
+
    while ( nWrite > 0 )
    {
-      const uint64_t physicalLength = length( Physical );
-
-      if ( page * physicalPageSize < physicalLength )
+      // Only a partial first page is already on disk; every following page
+      // is past the old end of file.
+      if ( pageOffset > 0 )
       {
-         readPhysicalPage( page_buffer, page );
+         readPhysicalPageAt( page_buffer, page );
       }
 
 #ifdef E57_VERBOSE
@@ -617,7 +1784,7 @@ void CheckedFile::extend( uint64_t newLength, OffsetMode omode )
       // //???
 #endif
       memset( page_buffer + pageOffset, 0, n );
-      writePhysicalPage( page_buffer, page );
+      writePhysicalPageAt( page_buffer, page );
 
       nWrite -= n;
       pageOffset = 0;
@@ -635,13 +1802,19 @@ void CheckedFile::extend( uint64_t newLength, OffsetMode omode )
 
    //??? what if loop above throws, logicalLength_ may be wrong
    logicalLength_ = newLogicalLength;
-
-   // When done, leave cursor at end of file
-   seek( newLogicalLength, Logical );
 }
 
 void CheckedFile::close()
 {
+   if ( asyncWriter_ != nullptr )
+   {
+      // Surface any deferred write error before the file is considered closed
+      asyncWriter_->drain();
+
+      delete asyncWriter_;
+      asyncWriter_ = nullptr;
+   }
+
    if ( fd_ >= 0 )
    {
 #if defined( _MSC_VER )
@@ -668,6 +1841,19 @@ void CheckedFile::close()
       // WARNING: do NOT delete buffer of bufView_ because
       // pointer is handled by user !!
    }
+
+   // Release the caller's byte source
+   provider_.reset();
+
+#if defined( E57_HAVE_MMAP )
+   if ( mmap_ != nullptr )
+   {
+      ::munmap( mmap_, static_cast<size_t>( mmapLength_ ) );
+
+      mmap_ = nullptr;
+      mmapLength_ = 0;
+   }
+#endif
 }
 
 void CheckedFile::unlink()
@@ -686,11 +1872,16 @@ void CheckedFile::unlink()
 #endif
 }
 
-void CheckedFile::verifyChecksum( char *page_buffer, size_t page )
+void CheckedFile::verifyChecksum( const char *page_buffer, size_t page )
 {
+   if ( stats_ != nullptr )
+   {
+      ++stats_->pagesChecksummed;
+   }
+
    const uint32_t check_sum = checksum( page_buffer, logicalPageSize );
    const uint32_t check_sum_in_page =
-      *reinterpret_cast<uint32_t *>( &page_buffer[logicalPageSize] );
+      *reinterpret_cast<const uint32_t *>( &page_buffer[logicalPageSize] );
 
    if ( check_sum_in_page != check_sum )
    {
@@ -731,6 +1922,12 @@ void CheckedFile::readPhysicalPage( char *page_buffer, uint64_t page )
    assert( page * physicalPageSize < physicalLength );
 #endif
 
+   // Make sure queued writes of this (or any) page have landed before reading
+   if ( asyncWriter_ != nullptr )
+   {
+      asyncWriter_->drain();
+   }
+
    // Seek to start of physical page
    seek( page * physicalPageSize, Physical );
 
@@ -761,6 +1958,14 @@ void CheckedFile::writePhysicalPage( char *page_buffer, uint64_t page )
    // cout << "writePhysicalPage, page:" << page << std::endl;
 #endif
 
+   // Hand the completed page to the background writer, which stamps the
+   // checksum just before issuing the write
+   if ( asyncWriter_ != nullptr )
+   {
+      asyncWriter_->enqueue( page * physicalPageSize, page_buffer );
+      return;
+   }
+
    // Append checksum
    uint32_t check_sum = checksum( page_buffer, logicalPageSize );
    *reinterpret_cast<uint32_t *>( &page_buffer[logicalPageSize] ) =
@@ -783,3 +1988,59 @@ void CheckedFile::writePhysicalPage( char *page_buffer, uint64_t page )
                             "fileName=" + fileName_ + " result=" + toString( result ) );
    }
 }
+
+void CheckedFile::readPhysicalPageAt( char *page_buffer, uint64_t page )
+{
+   // Make sure queued writes of this (or any) page have landed before reading
+   if ( asyncWriter_ != nullptr )
+   {
+      asyncWriter_->drain();
+   }
+
+#if defined( E57_HAVE_PREAD )
+   size_t got = 0;
+
+   while ( got < physicalPageSize )
+   {
+      const ssize_t result = ::pread( fd_, page_buffer + got, physicalPageSize - got,
+                                      static_cast<off_t>( page * physicalPageSize + got ) );
+
+      if ( result <= 0 )
+      {
+         throw E57_EXCEPTION2( ErrorReadFailed,
+                               "fileName=" + fileName_ + " result=" + toString( result ) );
+      }
+
+      got += static_cast<size_t>( result );
+   }
+#else
+   // No positioned-read primitive; borrow the cursor and put it back.
+   std::lock_guard<std::mutex> lock( ioMutex_ );
+
+   const uint64_t savedPosition = lseek64( 0LL, SEEK_CUR );
+
+   readPhysicalPage( page_buffer, page );
+
+   lseek64( static_cast<int64_t>( savedPosition ), SEEK_SET );
+#endif
+}
+
+void CheckedFile::writePhysicalPageAt( char *page_buffer, uint64_t page )
+{
+   // The background writer is already positional (pwrite), so handing the
+   // page over leaves the cursor alone
+   if ( asyncWriter_ != nullptr )
+   {
+      asyncWriter_->enqueue( page * physicalPageSize, page_buffer );
+      return;
+   }
+
+   // Synchronous fallback; borrow the cursor and put it back.
+   std::lock_guard<std::mutex> lock( ioMutex_ );
+
+   const uint64_t savedPosition = lseek64( 0LL, SEEK_CUR );
+
+   writePhysicalPage( page_buffer, page );
+
+   lseek64( static_cast<int64_t>( savedPosition ), SEEK_SET );
+}
@@ -28,6 +28,8 @@
 #pragma once
 
 #include <algorithm>
+#include <memory>
+#include <mutex>
 
 #include "Common.h"
 
@@ -53,6 +55,9 @@ namespace e57
       {
          Read,
          Write,
+
+         // Open an existing file read/write without truncating it
+         Append,
       };
 
       enum OffsetMode
@@ -63,10 +68,38 @@ namespace e57
 
       CheckedFile( const e57::ustring &fileName, Mode mode, ReadChecksumPolicy policy );
       CheckedFile( const char *input, uint64_t size, ReadChecksumPolicy policy );
+      CheckedFile( std::shared_ptr<ReadProvider> provider, ReadChecksumPolicy policy );
       ~CheckedFile();
 
       void read( char *buf, size_t nRead, size_t bufSize = 0 );
+
+      /// Read nRead bytes at logicalOffset without touching the shared file
+      /// cursor (pread, or directly out of the memory mapping), so several
+      /// threads reading the same file don't serialize. Platforms without a
+      /// positioned-read primitive fall back to a locked seek()/read() pair.
+      void readAt( uint64_t logicalOffset, char *buf, size_t nRead );
+
+      /// Verify the CRC of every physical page in the file with nThreads
+      /// parallel workers (0 for one per hardware thread), regardless of the
+      /// file's checksum policy. Returns the physical byte offsets of the
+      /// pages whose checksum does not match, in ascending order.
+      std::vector<uint64_t> verifyChecksums( unsigned nThreads );
+
       void write( const char *buf, size_t nWrite );
+
+      /// Write nWrite bytes at logicalOffset without touching the shared file
+      /// cursor. Page updates are coordinated with the cursor write path, so
+      /// a background thread can fill a pre-reserved section (a blob) while
+      /// another thread writes packets through the cursor. The whole range
+      /// must already be inside the file (see extend()). Platforms without
+      /// positioned-I/O primitives fall back to cursor seeks that are put
+      /// back afterwards; see positionedWritesSupported().
+      void writeAt( uint64_t logicalOffset, const char *buf, size_t nWrite );
+
+      /// True when writeAt() never moves the shared cursor, so blob writes
+      /// may safely overlap cursor writes from another thread.
+      static bool positionedWritesSupported();
+
       CheckedFile &operator<<( const e57::ustring &s );
       CheckedFile &operator<<( int64_t i );
       CheckedFile &operator<<( uint64_t i );
@@ -75,6 +108,9 @@ namespace e57
       void seek( uint64_t offset, OffsetMode omode = Logical );
       uint64_t position( OffsetMode omode = Logical );
       uint64_t length( OffsetMode omode = Logical );
+      /// Zero-fill the file out to newLength. Purely positional: the file
+      /// cursor is left where it was, so reserving a section from one thread
+      /// doesn't disturb another thread's cursor writes.
       void extend( uint64_t newLength, OffsetMode omode = Logical );
 
       e57::ustring fileName() const
@@ -82,14 +118,51 @@ namespace e57
          return fileName_;
       }
 
+      /// Bound in bytes on how many contiguous pages the background page
+      /// writer merges into one device write; 0 restores the default (1 MB).
+      /// No-op when writes are synchronous.
+      void setWriteCoalesceBytes( size_t bytes );
+
+      /// OS page cache policy for this file's reads (see
+      /// ImageFile::cacheSetStreaming). Enabling tells the kernel the file is
+      /// read sequentially; the advise calls below are no-ops while disabled
+      /// or where unsupported.
+      void setCacheStreaming( bool streaming );
+
+      /// Hint that the given physical range is about to be read sequentially
+      void adviseWillNeed( uint64_t physicalOffset, uint64_t count );
+
+      /// Hint that the given physical range will not be read again, so the
+      /// kernel may drop its pages from the cache
+      void adviseDone( uint64_t physicalOffset, uint64_t count );
+
+      /// Between these calls write() coalesces into a bounded in-memory
+      /// buffer that is flushed in large chunks, so a burst of tiny writes
+      /// (the XML section at close) touches each physical page once instead
+      /// of rewriting it per write. The cursor must not be moved or queried
+      /// while the buffer is active.
+      void beginStreamWrite();
+      void endStreamWrite();
+
       void close();
       void unlink();
 
+      /// Counter block to update during reads and writes, or nullptr to
+      /// collect nothing (see ImageFile::stats())
+      void setStatsData( ImageFileStatsData *stats )
+      {
+         stats_ = stats;
+      }
+
       static inline uint64_t logicalToPhysical( uint64_t logicalOffset );
       static inline uint64_t physicalToLogical( uint64_t physicalOffset );
 
    private:
-      void verifyChecksum( char *page_buffer, size_t page );
+      class AsyncPageWriter;
+
+      void verifyChecksum( const char *page_buffer, size_t page );
+
+      void flushStreamBuffer();
 
       template <class FTYPE> CheckedFile &writeFloatingPoint( FTYPE value, int precision );
 
@@ -97,6 +170,8 @@ namespace e57
                                     OffsetMode omode = Logical );
       void readPhysicalPage( char *page_buffer, uint64_t page );
       void writePhysicalPage( char *page_buffer, uint64_t page );
+      void readPhysicalPageAt( char *page_buffer, uint64_t page );
+      void writePhysicalPageAt( char *page_buffer, uint64_t page );
       int open64( const e57::ustring &fileName, int flags, int mode );
       uint64_t lseek64( int64_t offset, int whence );
 
@@ -106,9 +181,52 @@ namespace e57
 
       ReadChecksumPolicy checkSumPolicy_ = ChecksumPolicy::ChecksumAll;
 
+      // Verify every Nth page when sampling (policy between ChecksumNone and ChecksumAll).
+      // Calculated once at open time so the read loop avoids per-page arithmetic.
+      unsigned int checkSumMod_ = 0;
+
       int fd_ = -1;
       BufferView *bufView_ = nullptr;
       bool readOnly_ = false;
+
+      // Caller-supplied byte source of a read-only file (see ReadProvider);
+      // reads are then staged through provider_->read() range requests, with
+      // the page/CRC layer on top as for any other backend. The cursor of
+      // such a file is providerPos_.
+      std::shared_ptr<ReadProvider> provider_;
+      uint64_t providerPos_ = 0;
+
+      // Streaming page cache policy (see setCacheStreaming)
+      bool cacheStreaming_ = false;
+
+      // Coalescing buffer for beginStreamWrite()/endStreamWrite()
+      std::string streamBuffer_;
+      bool streaming_ = false;
+
+      // Serializes the cursor movement of readAt() on platforms without a
+      // positioned-read primitive; unused elsewhere.
+      std::mutex ioMutex_;
+
+      // Serializes page read-modify-write between the cursor path (write(),
+      // extend()) and the positional path (writeAt()), so two streams that
+      // share a boundary page can't lose each other's bytes. Sections are
+      // 4-byte aligned, not page aligned, so such pages do occur.
+      std::mutex writeMutex_;
+
+      // Memory mapping of a read-only file (when supported); reads are then
+      // served through bufView_ without any syscalls.
+      void *mmap_ = nullptr;
+      uint64_t mmapLength_ = 0;
+
+      // Performance counters owned by the ImageFileImpl, nullptr while
+      // collection is disabled
+      ImageFileStatsData *stats_ = nullptr;
+
+      // Background page writer (when supported); completed physical pages are
+      // queued with a bounded depth, CRC-stamped off the producer thread, and
+      // written with pwrite, so packet serialization overlaps both the
+      // checksums and the device writes.
+      AsyncPageWriter *asyncWriter_ = nullptr;
    };
 
    inline uint64_t CheckedFile::logicalToPhysical( uint64_t logicalOffset )
@@ -27,6 +27,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <set>
 #include <string>
 #include <vector>
@@ -45,6 +46,16 @@
 // Used to mark unused parameters to indicate intent and supress warnings.
 #define UNUSED( expr ) (void)( expr )
 
+// Non-aliasing hint for pointers in the bulk conversion loops, so the
+// compiler can keep loop-invariant loads hoisted and vectorize the body.
+#if defined( _MSC_VER )
+#define E57_RESTRICT __restrict
+#elif defined( __GNUC__ )
+#define E57_RESTRICT __restrict__
+#else
+#define E57_RESTRICT
+#endif
+
 // For readability of preprocessor using E57_VALIDATION_LEVEL
 #define VALIDATION_OFF 0
 #define VALIDATION_BASIC 1
@@ -70,6 +81,34 @@ namespace e57
    using StringList = std::vector<std::string>;
    using StringSet = std::set<std::string>;
 
+   /// Counter block behind ImageFile::stats(). Hot paths hold a pointer to
+   /// one of these that is nullptr while collection is disabled, so the
+   /// disabled cost is a single branch.
+   struct ImageFileStatsData
+   {
+      std::atomic<uint64_t> bytesRead{ 0 };
+      std::atomic<uint64_t> bytesWritten{ 0 };
+      std::atomic<uint64_t> pagesChecksummed{ 0 };
+      std::atomic<uint64_t> packetCacheHits{ 0 };
+      std::atomic<uint64_t> packetCacheMisses{ 0 };
+      std::atomic<uint64_t> recordsEncoded{ 0 };
+      std::atomic<uint64_t> recordsDecoded{ 0 };
+      std::atomic<uint64_t> recordsSynthesized{ 0 };
+
+      // Current bytes, not a counter: packet cache entries held by this
+      // file's open readers. Tracked even while collection is disabled so
+      // the memory report stays balanced (see ImageFileStats::memoryUsedBytes).
+      std::atomic<uint64_t> memoryUsedBytes{ 0 };
+   };
+
+   /// Byte range of one element (start tag through end tag) in the XML section
+   /// of a file, used when parts of the section are parsed lazily.
+   struct XmlByteRange
+   {
+      uint64_t logicalOffset = 0;
+      uint64_t logicalLength = 0;
+   };
+
    /// generates a new random GUID
    std::string generateRandomGUID();
 }
@@ -285,6 +285,33 @@ int64_t CompressedVectorNode::childCount() const
    return impl_->childCount();
 }
 
+/*!
+@brief Get the number of valid records recorded by the "vidx" valid-point summary.
+
+@details
+A file written with the "vidx" extension registered (extensionsAdd( "vidx", uri ) before creating
+the points) carries a per-block summary of how many records have invalid state 0. This function
+returns the summary's total, so a caller can size its output allocations to the true point count
+without decoding the vector to count the invalid records itself.
+
+Returns -1 when the file carries no summary; the count is then only available by decoding.
+
+@pre The destination ImageFile must be open (i.e. destImageFile().isOpen()).
+@post No visible state is modified.
+
+@return Number of records with invalid state 0, or -1 when the file has no "vidx" summary.
+
+@throw ::ErrorImageFileNotOpen
+@throw ::ErrorInternal All objects in undocumented state
+
+@see CompressedVectorNode::childCount, CompressedVectorReader::setValidOnly,
+ImageFile::extensionsAdd
+*/
+int64_t CompressedVectorNode::validRecordCount() const
+{
+   return impl_->validRecordCount();
+}
+
 /*!
 @brief Get the prototype tree that describes the types in the record.
 
@@ -389,7 +416,7 @@ CompressedVectorNode::CompressedVectorNode( const Node &n )
 
 /// @cond documentNonPublic The following isn't part of the API, and isn't documented.
 CompressedVectorNode::CompressedVectorNode( std::shared_ptr<CompressedVectorNodeImpl> ni ) :
-   impl_( ni )
+   impl_( std::move( ni ) )
 {
 }
 /// @endcond
@@ -412,11 +439,18 @@ the same terminal node in the prototype.
 It is an error to call this function if the CompressedVectorNode already has any records (i.e. a
 CompressedVectorNode cannot be set twice).
 
+Several writers may be open on the same ImageFile at once, so scans produced by parallel capture
+or conversion threads can be encoded and written concurrently. Only the first writer appends to
+the file directly; each further writer encodes into a temporary spill file next to the main one,
+and its finished binary section is copied into the main file (byte for byte, without re-encoding)
+when the ImageFile is closed. Two things to note: creating the writers must still be serialized
+by the caller (only writing through them is thread-safe), and the optional "tidx"/"vidx" sidecar
+blobs are only collected by the first writer.
+
 @pre @a sbufs can't be empty (i.e. sbufs.length() > 0).
 @pre The destination ImageFile must be open (i.e. destImageFile().isOpen()).
 @pre The @a destImageFile must have been opened in write mode (i.e. destImageFile.isWritable()).
-@pre The destination ImageFile can't have any readers or writers open
-(destImageFile().readerCount()==0 && destImageFile().writerCount()==0)
+@pre The destination ImageFile can't have any readers open (destImageFile().readerCount()==0)
 @pre This CompressedVectorNode must be attached (i.e. isAttached()).
 @pre This CompressedVectorNode must have no records (i.e. childCount() == 0).
 
@@ -426,7 +460,6 @@ CompressedVectorNode cannot be set twice).
 @throw ::ErrorImageFileNotOpen
 @throw ::ErrorFileReadOnly
 @throw ::ErrorSetTwice
-@throw ::ErrorTooManyWriters
 @throw ::ErrorTooManyReaders
 @throw ::ErrorNodeUnattached
 @throw ::ErrorPathUndefined
@@ -454,6 +487,16 @@ IntegerNode, ScaledIntegerNode, FloatNode, StringNode) in this CompressedVectorN
 is an error for two SourceDestBuffers in @a dbufs to identify the same terminal node in the
 prototype. It is not an error to create a CompressedVectorReader for an empty CompressedVectorNode.
 
+It is not an error for @a dbufs to cover only a subset of the terminal nodes in the prototype.
+Fields without a SourceDestBuffer are skipped entirely during the read (their bytestreams are never
+decoded), so requesting only the fields actually needed reduces the decode cost proportionally.
+
+Distinct CompressedVectorReader objects on the same ImageFile may be driven from different threads
+concurrently (e.g. one thread per CompressedVectorNode); each reader has its own packet cache and
+decode state, and file access is coordinated internally. Creating the readers, and all other
+operations on the ImageFile and its nodes, must still be serialized by the caller, and a single
+reader must not be used from more than one thread at a time.
+
 @pre @a dbufs can't be empty
 @pre The destination ImageFile must be open (i.e. destImageFile().isOpen()).
 @pre The destination ImageFile can't have any writers open (destImageFile().writerCount()==0)
@@ -478,3 +521,118 @@ CompressedVectorReader CompressedVectorNode::reader( const std::vector<SourceDes
 {
    return CompressedVectorReader( impl_->reader( dbufs ) );
 }
+
+namespace
+{
+   /// Recursively rebuild a prototype/codecs subtree in another ImageFile.
+   /// Only the node types legal below a prototype can appear here.
+   Node copyNodeTree( const Node &source, const ImageFile &dest )
+   {
+      switch ( source.type() )
+      {
+         case TypeStructure:
+         {
+            const StructureNode sourceStruct( source );
+            StructureNode copy( dest );
+
+            for ( int64_t i = 0; i < sourceStruct.childCount(); ++i )
+            {
+               const Node child = sourceStruct.get( i );
+
+               copy.set( child.elementName(), copyNodeTree( child, dest ) );
+            }
+
+            return copy;
+         }
+         case TypeVector:
+         {
+            const VectorNode sourceVector( source );
+            VectorNode copy( dest, sourceVector.allowHeteroChildren() );
+
+            for ( int64_t i = 0; i < sourceVector.childCount(); ++i )
+            {
+               copy.append( copyNodeTree( sourceVector.get( i ), dest ) );
+            }
+
+            return copy;
+         }
+         case TypeInteger:
+         {
+            const IntegerNode sourceInteger( source );
+
+            return IntegerNode( dest, sourceInteger.value(), sourceInteger.minimum(),
+                                sourceInteger.maximum() );
+         }
+         case TypeScaledInteger:
+         {
+            const ScaledIntegerNode sourceScaled( source );
+
+            return ScaledIntegerNode( dest, sourceScaled.rawValue(), sourceScaled.minimum(),
+                                      sourceScaled.maximum(), sourceScaled.scale(),
+                                      sourceScaled.offset() );
+         }
+         case TypeFloat:
+         {
+            const FloatNode sourceFloat( source );
+
+            return FloatNode( dest, sourceFloat.value(), sourceFloat.precision(),
+                              sourceFloat.minimum(), sourceFloat.maximum() );
+         }
+         case TypeString:
+         {
+            return StringNode( dest, StringNode( source ).value() );
+         }
+         default:
+            throw E57_EXCEPTION2( ErrorInvalidNodeType, "pathName=" + source.pathName() );
+      }
+   }
+}
+
+/*!
+@brief Copy this CompressedVectorNode into another ImageFile without decoding the records.
+
+@param [in] destImageFile The ImageFile (open for writing) to copy the vector into.
+
+@details
+Repackaging jobs (merging stations into one file, dropping bad scans) don't change the point
+records, so decoding and re-encoding them through a CompressedVectorReader/CompressedVectorWriter
+pair burns CPU to reproduce byte-identical packets. This function instead copies the vector's
+binary section as raw bytes, running at disk speed regardless of record count.
+
+The prototype and codecs trees are rebuilt in @a destImageFile, the packet bytes are copied
+unchanged (every page is re-checksummed as it lands in the destination's layout), and the absolute
+physical offsets in the copied section header and seek index are patched to the section's new
+location. The returned CompressedVectorNode is not yet attached; attach it with StructureNode::set
+like a freshly written vector. Associated elements outside the vector itself (the enclosing scan
+header, blobs such as a tile index) are not copied.
+
+This CompressedVectorNode must have been completely written (its writer closed, or read from a
+file); an empty or in-progress vector has no binary section to copy.
+
+@pre The source and destination ImageFiles must be open.
+@pre @a destImageFile must have been opened for writing.
+@pre This CompressedVectorNode must be attached and completely written.
+
+@return A new unattached CompressedVectorNode in @a destImageFile referencing the copied section.
+
+@throw ::ErrorImageFileNotOpen
+@throw ::ErrorFileReadOnly
+@throw ::ErrorBadCVPacket
+@throw ::ErrorSeekFailed
+@throw ::ErrorReadFailed
+@throw ::ErrorWriteFailed
+@throw ::ErrorInternal All objects in undocumented state
+
+@see CompressedVectorNode::writer, CompressedVectorNode::reader
+*/
+CompressedVectorNode CompressedVectorNode::rawCopy( const ImageFile &destImageFile ) const
+{
+   const Node protoCopy = copyNodeTree( prototype(), destImageFile );
+   const VectorNode codecsCopy( copyNodeTree( codecs(), destImageFile ) );
+
+   CompressedVectorNode copy( destImageFile, protoCopy, codecsCopy );
+
+   impl_->rawCopySectionTo( copy.impl_ );
+
+   return copy;
+}
@@ -25,12 +25,22 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <atomic>
+
 #include "CompressedVectorNodeImpl.h"
 #include "CheckedFile.h"
 #include "CompressedVectorReaderImpl.h"
 #include "CompressedVectorWriterImpl.h"
+#include "FloatNodeImpl.h"
 #include "ImageFileImpl.h"
+#include "IntegerNodeImpl.h"
+#include "Packet.h"
+#include "ScaledIntegerNodeImpl.h"
+#include "SectionHeaders.h"
 #include "StringFunctions.h"
+#include "StringNodeImpl.h"
+#include "StructureNodeImpl.h"
+#include "ValidIndex.h"
 #include "VectorNodeImpl.h"
 
 namespace e57
@@ -193,6 +203,32 @@ namespace e57
       return ( recordCount_ );
    }
 
+   // Number of records whose invalid-state field is 0, as recorded by the
+   // optional "vidx" valid-point summary next to this vector, or -1 when
+   // the file doesn't carry one.
+   int64_t CompressedVectorNodeImpl::validRecordCount()
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      auto parentStruct = std::dynamic_pointer_cast<StructureNodeImpl>( parent() );
+
+      const ustring cCountPathName = ustring( VALID_INDEX_ELEMENT ) + "/validCount";
+
+      if ( !parentStruct || !parentStruct->isDefined( cCountPathName ) )
+      {
+         return -1;
+      }
+
+      auto count = std::dynamic_pointer_cast<IntegerNodeImpl>( parentStruct->get( cCountPathName ) );
+
+      if ( !count )
+      {
+         return -1;
+      }
+
+      return count->value();
+   }
+
    void CompressedVectorNodeImpl::checkLeavesInSet( const StringSet & /*pathNames*/,
                                                     NodeImplSharedPtr /*origin*/ )
    {
@@ -265,6 +301,82 @@ namespace e57
    }
 #endif
 
+   namespace
+   {
+      /// Deep copy a node tree (a prototype or codecs vector) into another
+      /// ImageFile. The impl-level twin of the helper behind
+      /// CompressedVectorNode::rawCopy(), for trees that only exist below
+      /// the public API (the spill file of a concurrent writer).
+      NodeImplSharedPtr copyTree( const NodeImplSharedPtr &source,
+                                  const ImageFileImplSharedPtr &dest )
+      {
+         switch ( source->type() )
+         {
+            case TypeStructure:
+            {
+               auto sourceStruct = std::static_pointer_cast<StructureNodeImpl>( source );
+               std::shared_ptr<StructureNodeImpl> copy( new StructureNodeImpl( dest ) );
+
+               const int64_t cChildCount = sourceStruct->childCount();
+
+               for ( int64_t i = 0; i < cChildCount; ++i )
+               {
+                  NodeImplSharedPtr child = sourceStruct->get( i );
+
+                  copy->set( child->elementName(), copyTree( child, dest ) );
+               }
+
+               return copy;
+            }
+            case TypeVector:
+            {
+               auto sourceVector = std::static_pointer_cast<VectorNodeImpl>( source );
+               std::shared_ptr<VectorNodeImpl> copy(
+                  new VectorNodeImpl( dest, sourceVector->allowHeteroChildren() ) );
+
+               const int64_t cChildCount = sourceVector->childCount();
+
+               for ( int64_t i = 0; i < cChildCount; ++i )
+               {
+                  copy->append( copyTree( sourceVector->get( i ), dest ) );
+               }
+
+               return copy;
+            }
+            case TypeInteger:
+            {
+               auto node = std::static_pointer_cast<IntegerNodeImpl>( source );
+
+               return NodeImplSharedPtr(
+                  new IntegerNodeImpl( dest, node->value(), node->minimum(), node->maximum() ) );
+            }
+            case TypeScaledInteger:
+            {
+               auto node = std::static_pointer_cast<ScaledIntegerNodeImpl>( source );
+
+               return NodeImplSharedPtr(
+                  new ScaledIntegerNodeImpl( dest, node->rawValue(), node->minimum(),
+                                             node->maximum(), node->scale(), node->offset() ) );
+            }
+            case TypeFloat:
+            {
+               auto node = std::static_pointer_cast<FloatNodeImpl>( source );
+
+               return NodeImplSharedPtr( new FloatNodeImpl(
+                  dest, node->value(), node->precision(), node->minimum(), node->maximum() ) );
+            }
+            case TypeString:
+            {
+               auto node = std::static_pointer_cast<StringNodeImpl>( source );
+
+               return NodeImplSharedPtr( new StringNodeImpl( dest, node->value() ) );
+            }
+            default:
+               throw E57_EXCEPTION2( ErrorInvalidNodeType, "pathName=" + source->pathName() );
+         }
+      }
+   }
+
    std::shared_ptr<CompressedVectorWriterImpl> CompressedVectorNodeImpl::writer(
       std::vector<SourceDestBuffer> sbufs )
    {
@@ -272,14 +384,7 @@ namespace e57
 
       ImageFileImplSharedPtr destImageFile( destImageFile_ );
 
-      // Check don't have any writers/readers open for this ImageFile
-      if ( destImageFile->writerCount() > 0 )
-      {
-         throw E57_EXCEPTION2( ErrorTooManyWriters,
-                               "fileName=" + destImageFile->fileName() +
-                                  " writerCount=" + toString( destImageFile->writerCount() ) +
-                                  " readerCount=" + toString( destImageFile->readerCount() ) );
-      }
+      // Check don't have any readers open for this ImageFile
       if ( destImageFile->readerCount() > 0 )
       {
          throw E57_EXCEPTION2( ErrorTooManyReaders,
@@ -304,6 +409,19 @@ namespace e57
          throw E57_EXCEPTION2( ErrorNodeUnattached, "fileName=" + destImageFile->fileName() );
       }
 
+      // Only one writer can append packets to the file itself: a section's
+      // length is measured from the free-space mark when its writer closes,
+      // so a second section growing concurrently would end up inside the
+      // first. Further writers therefore encode into a private spill file,
+      // and their finished section is transplanted into this file when it
+      // closes. Opening the writers must still be serialized by the caller
+      // (the counts below are not a reservation); writing through them can
+      // then proceed concurrently.
+      if ( destImageFile->writerCount() > 0 )
+      {
+         return ( spillWriter( sbufs ) );
+      }
+
       // Get pointer to me (really shared_ptr<CompressedVectorNodeImpl>)
       NodeImplSharedPtr ni( shared_from_this() );
 
@@ -317,6 +435,70 @@ namespace e57
       return ( cvwi );
    }
 
+   std::shared_ptr<CompressedVectorWriterImpl> CompressedVectorNodeImpl::spillWriter(
+      std::vector<SourceDestBuffer> &sbufs )
+   {
+      ImageFileImplSharedPtr destImageFile( destImageFile_ );
+
+      // Unique name next to the main file; the spill is deleted after the
+      // transplant (or when the main file is cancelled)
+      static std::atomic<unsigned> spillCount{ 0 };
+      const ustring cSpillName = destImageFile->fileName() + ".spill" + toString( spillCount++ );
+
+      ImageFileImplSharedPtr spillImf( new ImageFileImpl( ChecksumAll ) );
+      spillImf->construct2( cSpillName, "w" );
+
+      std::shared_ptr<CompressedVectorWriterImpl> cvwi;
+
+      try
+      {
+         // Same extensions as the main file, so prefixed element names in
+         // the codecs copy below stay well formed
+         const size_t cExtensionsCount = destImageFile->extensionsCount();
+
+         for ( size_t i = 0; i < cExtensionsCount; ++i )
+         {
+            spillImf->extensionsAdd( destImageFile->extensionsPrefix( i ),
+                                     destImageFile->extensionsUri( i ) );
+         }
+
+         // Give the scratch vector an equivalent prototype and codecs, so
+         // its encoders produce exactly the packet bytes this file's tree
+         // describes
+         std::shared_ptr<CompressedVectorNodeImpl> scratch(
+            new CompressedVectorNodeImpl( spillImf ) );
+
+         scratch->setPrototype( copyTree( prototype_, spillImf ) );
+
+         if ( codecs_ )
+         {
+            scratch->setCodecs(
+               std::static_pointer_cast<VectorNodeImpl>( copyTree( codecs_, spillImf ) ) );
+         }
+
+         // Attach it, so pathName() works in exception messages
+         spillImf->root()->set( "spill", scratch );
+
+         cvwi.reset( new CompressedVectorWriterImpl( scratch, sbufs ) );
+
+         std::shared_ptr<CompressedVectorNodeImpl> target(
+            std::static_pointer_cast<CompressedVectorNodeImpl>( shared_from_this() ) );
+
+         cvwi->setSectionTransplant( target );
+      }
+      catch ( ... )
+      {
+         spillImf->cancel();
+         throw;
+      }
+
+      // The spill writer counts against the main file too, so readers stay
+      // excluded until every outstanding section has been handed over
+      destImageFile->incrWriterCount();
+
+      return ( cvwi );
+   }
+
    std::shared_ptr<CompressedVectorReaderImpl> CompressedVectorNodeImpl::reader(
       std::vector<SourceDestBuffer> dbufs )
    {
@@ -371,4 +553,153 @@ namespace e57
          new CompressedVectorReaderImpl( cai, dbufs ) );
       return ( cvri );
    }
+
+   namespace
+   {
+      /// Adjust the absolute physical offsets stored in a copied seek-index
+      /// tree by the constant distance the section moved. packetPhysicalOffset
+      /// is the packet's location in the destination file; entries of
+      /// upper-level packets address lower index packets, which are patched
+      /// first.
+      void _patchIndexPacket( CheckedFile *file, uint64_t packetPhysicalOffset, int64_t delta )
+      {
+         const uint64_t cPacketLogicalOffset =
+            CheckedFile::physicalToLogical( packetPhysicalOffset );
+         constexpr size_t cHeaderLength =
+            sizeof( IndexPacket ) - sizeof( IndexPacket::entries );
+
+         // Packets can recurse several levels deep and are up to 64KB, so
+         // keep them off the stack.
+         std::unique_ptr<IndexPacket> packet( new IndexPacket );
+
+         file->readAt( cPacketLogicalOffset, reinterpret_cast<char *>( packet.get() ),
+                       cHeaderLength );
+
+         if ( packet->packetType != INDEX_PACKET )
+         {
+            throw E57_EXCEPTION2( ErrorBadCVPacket,
+                                  "packetPhysicalOffset=" + toString( packetPhysicalOffset ) +
+                                     " packetType=" + toString( packet->packetType ) );
+         }
+
+         const size_t cEntriesLength =
+            packet->entryCount * sizeof( IndexPacket::IndexPacketEntry );
+
+         file->readAt( cPacketLogicalOffset + cHeaderLength,
+                       reinterpret_cast<char *>( packet->entries ), cEntriesLength );
+
+         for ( unsigned i = 0; i < packet->entryCount; ++i )
+         {
+            if ( packet->indexLevel > 0 )
+            {
+               _patchIndexPacket( file, packet->entries[i].chunkPhysicalOffset + delta, delta );
+            }
+
+            packet->entries[i].chunkPhysicalOffset += delta;
+         }
+
+         // The header is position independent; rewrite the entries only.
+         file->seek( cPacketLogicalOffset + cHeaderLength );
+         file->write( reinterpret_cast<char *>( packet->entries ), cEntriesLength );
+      }
+   }
+
+   void CompressedVectorNodeImpl::rawCopySectionTo(
+      const std::shared_ptr<CompressedVectorNodeImpl> &dest ) const
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      ImageFileImplSharedPtr srcImf( destImageFile_ );
+      ImageFileImplSharedPtr destImf( dest->destImageFile() );
+
+      if ( !destImf->isWriter() )
+      {
+         throw E57_EXCEPTION2( ErrorFileReadOnly, "fileName=" + destImf->fileName() );
+      }
+
+      if ( binarySectionLogicalStart_ == 0 )
+      {
+         // Vector was never written, there is no section to copy
+         throw E57_EXCEPTION2( ErrorInternal, "imageFileName=" + imageFileName() +
+                                                 " cvPathName=" + pathName() );
+      }
+
+      CompressedVectorSectionHeader header;
+
+      srcImf->file()->readAt( binarySectionLogicalStart_, reinterpret_cast<char *>( &header ),
+                              sizeof( header ) );
+
+#if VALIDATE_BASIC
+      header.verify( srcImf->file()->length( CheckedFile::Physical ) );
+#endif
+
+      // The section header and seek index store absolute physical offsets.
+      // Pad the destination with zeros until its free space has the same
+      // offset within a logical page as the source section, so every
+      // physical offset in the copy differs from its source by one constant
+      // and can be patched by addition.
+      const uint64_t cPageSize = CheckedFile::logicalPageSize;
+      const uint64_t cSourcePhase = binarySectionLogicalStart_ % cPageSize;
+      const uint64_t cDestPhase = destImf->allocateSpace( 0, false ) % cPageSize;
+      const auto cPadding =
+         static_cast<size_t>( ( cSourcePhase + cPageSize - cDestPhase ) % cPageSize );
+
+      if ( cPadding > 0 )
+      {
+         const std::vector<char> zeroes( cPadding, 0 );
+         const uint64_t cPadLogicalOffset = destImf->allocateSpace( cPadding, false );
+
+         destImf->file()->seek( cPadLogicalOffset );
+         destImf->file()->write( zeroes.data(), cPadding );
+      }
+
+      const uint64_t cDestSectionStart =
+         destImf->allocateSpace( header.sectionLogicalLength, false );
+
+      // Copy the section bytes. Reading goes through the source's checksum
+      // policy as usual; CheckedFile re-CRCs every page as it lands in the
+      // destination's layout.
+      constexpr size_t cChunkSize = 1 << 20;
+      std::vector<char> buffer(
+         static_cast<size_t>( std::min<uint64_t>( header.sectionLogicalLength, cChunkSize ) ) );
+
+      for ( uint64_t copied = 0; copied < header.sectionLogicalLength; )
+      {
+         const auto cByteCount = static_cast<size_t>(
+            std::min<uint64_t>( header.sectionLogicalLength - copied, cChunkSize ) );
+
+         srcImf->file()->readAt( binarySectionLogicalStart_ + copied, buffer.data(),
+                                 cByteCount );
+         destImf->file()->seek( cDestSectionStart + copied );
+         destImf->file()->write( buffer.data(), cByteCount );
+
+         copied += cByteCount;
+      }
+
+      // Every physical offset in the copy moved by this constant (the page
+      // phases match, see above).
+      const int64_t cDelta =
+         static_cast<int64_t>( CheckedFile::logicalToPhysical( cDestSectionStart ) ) -
+         static_cast<int64_t>( CheckedFile::logicalToPhysical( binarySectionLogicalStart_ ) );
+
+      if ( header.dataPhysicalOffset != 0 )
+      {
+         header.dataPhysicalOffset += cDelta;
+      }
+      if ( header.indexPhysicalOffset != 0 )
+      {
+         header.indexPhysicalOffset += cDelta;
+      }
+
+      destImf->file()->seek( cDestSectionStart );
+      destImf->file()->write( reinterpret_cast<char *>( &header ), sizeof( header ) );
+
+      if ( ( header.indexPhysicalOffset != 0 ) && ( cDelta != 0 ) )
+      {
+         _patchIndexPacket( destImf->file(), header.indexPhysicalOffset, cDelta );
+      }
+
+      dest->setRecordCount( recordCount_ );
+      dest->setBinarySectionLogicalStart( cDestSectionStart );
+   }
 }
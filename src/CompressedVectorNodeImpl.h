@@ -51,6 +51,7 @@ namespace e57
       std::shared_ptr<VectorNodeImpl> getCodecs() const;
 
       int64_t childCount() const;
+      int64_t validRecordCount();
 
       void checkLeavesInSet( const StringSet &pathNames, NodeImplSharedPtr origin ) override;
 
@@ -61,6 +62,12 @@ namespace e57
       std::shared_ptr<CompressedVectorWriterImpl> writer( std::vector<SourceDestBuffer> sbufs );
       std::shared_ptr<CompressedVectorReaderImpl> reader( std::vector<SourceDestBuffer> dbufs );
 
+      /// Byte-for-byte copy of this vector's binary section into dest's
+      /// (writable) ImageFile, patching the absolute physical offsets in the
+      /// copied section header and seek index. dest must already hold an
+      /// equivalent prototype; see CompressedVectorNode::rawCopy().
+      void rawCopySectionTo( const std::shared_ptr<CompressedVectorNodeImpl> &dest ) const;
+
       int64_t getRecordCount() const
       {
          return ( recordCount_ );
@@ -88,6 +95,13 @@ namespace e57
    private:
       friend class CompressedVectorReaderImpl;
 
+      /// Writer factory for the case where another writer is already open on
+      /// the ImageFile: the returned writer encodes into a private spill
+      /// file, whose finished section is transplanted into this vector when
+      /// the ImageFile closes. See writer().
+      std::shared_ptr<CompressedVectorWriterImpl> spillWriter(
+         std::vector<SourceDestBuffer> &sbufs );
+
       NodeImplSharedPtr prototype_;
       std::shared_ptr<VectorNodeImpl> codecs_;
 
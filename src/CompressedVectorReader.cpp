@@ -31,6 +31,7 @@
 /// @file CompressedVectorReader.cpp
 
 #include "CompressedVectorReaderImpl.h"
+#include "TaskSchedulerImpl.h"
 
 using namespace e57;
 
@@ -125,7 +126,7 @@ externally visible state for consistency and throws an exception if the invarian
 
 /// @cond documentNonPublic The following isn't part of the API, and isn't documented.
 CompressedVectorReader::CompressedVectorReader( std::shared_ptr<CompressedVectorReaderImpl> ni ) :
-   impl_( ni )
+   impl_( std::move( ni ) )
 {
 }
 /// @endcond
@@ -157,6 +158,11 @@ represented in the SourceDestBuffers still exist when this function is called.
 The E57 Foundation Implementation cannot detect that a memory buffer been
 destroyed.
 
+The decoded values are stored directly into the registered destination memory;
+see the SourceDestBuffer external memory contract for the exact guarantees
+(no reallocation or temporary substitution, which bytes are written, and the
+required alignment).
+
 @pre The associated ImageFile must be open.
 @pre This CompressedVectorReader must be open (i.e isOpen())
 
@@ -254,6 +260,194 @@ unsigned CompressedVectorReader::read( std::vector<SourceDestBuffer> &dbufs )
    return impl_->read( dbufs );
 }
 
+/*!
+@brief Request transfer of the next block of records without blocking the calling thread.
+
+@details
+Performs the same transfer as CompressedVectorReader::read(), but on the shared TaskScheduler
+instead of the calling thread, and reports the record count through the returned future. With many
+scans in flight this multiplexes the reads over the scheduler's bounded set of workers (or over an
+application executor injected with TaskScheduler::setExecutor), instead of parking one blocked
+thread per scan. The packet cache's read-ahead thread keeps most packet I/O off the workers, so the
+scheduled task is largely decode work.
+
+At most one transfer per reader may be in flight: the reader, its buffers, and the associated
+ImageFile must not be touched between this call and the future becoming ready. Different readers
+(including readers on the same ImageFile) may have transfers in flight concurrently. An exception
+the transfer would have thrown is rethrown from the future's get(); the reader is then in the same
+undocumented state the synchronous call would have left it in.
+
+@pre The associated ImageFile must be open.
+@pre This CompressedVectorReader must be open (i.e isOpen())
+
+@return A future yielding the number of records read.
+
+@see CompressedVectorReader::read(), TaskScheduler
+*/
+std::future<unsigned> CompressedVectorReader::readAsync()
+{
+   // A packaged_task is move-only; the scheduler's tasks must be copyable
+   auto task = std::make_shared<std::packaged_task<unsigned()>>(
+      [impl = impl_]() { return impl->read(); } );
+
+   std::future<unsigned> result = task->get_future();
+
+   TaskSchedulerImpl::instance().submit( [task]() { ( *task )(); } );
+
+   return result;
+}
+
+/*!
+@brief Request transfer of the next block of records into given destination buffers without
+blocking the calling thread.
+
+@param [in] dbufs Vector of memory buffers that will receive data read from a
+CompressedVectorNode.
+
+@details
+The asynchronous equivalent of CompressedVectorReader::read(std::vector<SourceDestBuffer>&); the
+buffer designation rules documented there apply, and everything said for
+CompressedVectorReader::readAsync() about scheduling, in-flight limits, and exceptions applies
+here.
+
+@pre The associated ImageFile must be open.
+@pre This CompressedVectorReader must be open (i.e isOpen())
+
+@return A future yielding the number of records read.
+
+@see CompressedVectorReader::readAsync(), CompressedVectorReader::read(std::vector<SourceDestBuffer>&)
+*/
+std::future<unsigned> CompressedVectorReader::readAsync( std::vector<SourceDestBuffer> &dbufs )
+{
+   auto task = std::make_shared<std::packaged_task<unsigned()>>(
+      [impl = impl_, dbufs]() mutable { return impl->read( dbufs ); } );
+
+   std::future<unsigned> result = task->get_future();
+
+   TaskSchedulerImpl::instance().submit( [task]() { ( *task )(); } );
+
+   return result;
+}
+
+/*!
+@brief Designate new destination buffers for subsequent reads, without throwing.
+
+@param [in] dbufs Vector of memory buffers that will receive data read from a
+CompressedVectorNode.
+
+@details
+This performs the same buffer validation and association as
+CompressedVectorReader::read(std::vector<SourceDestBuffer>&) but reports failure
+through the returned ::ErrorCode instead of an E57Exception. It is intended to
+be paired with CompressedVectorReader::tryRead: all per-buffer validation (path
+names, capacities, compatibility with previously designated buffers) happens
+here at setup time, so a steady-state read loop needs no try/catch machinery.
+
+@pre The associated ImageFile must be open.
+@pre This CompressedVectorReader must be open (i.e isOpen())
+
+@return ::Success, or the ::ErrorCode of the E57Exception the throwing
+equivalent would have raised.
+
+@see CompressedVectorReader::tryRead, CompressedVectorReader::read(std::vector<SourceDestBuffer>&)
+*/
+ErrorCode CompressedVectorReader::trySetBuffers( std::vector<SourceDestBuffer> &dbufs ) noexcept
+{
+   try
+   {
+      impl_->setBuffers( dbufs );
+      return Success;
+   }
+   catch ( E57Exception &ex )
+   {
+      return ex.errorCode();
+   }
+   catch ( ... )
+   {
+      return ErrorInternal;
+   }
+}
+
+/*!
+@brief Request transfer of blocks of data into the previously designated
+destination buffers, without throwing.
+
+@param [out] recordCount The number of records read; 0 on failure or at the end
+of the CompressedVectorNode.
+
+@details
+The non-throwing equivalent of CompressedVectorReader::read(). The
+SourceDestBuffers are those designated in CompressedVectorNode::reader, in
+CompressedVectorReader::trySetBuffers, or in the last call to
+CompressedVectorReader::read(std::vector<SourceDestBuffer>&); like read(), it is
+not an error to call this function after all records have been read.
+
+On failure the same state caveats apply as for read(): after a conversion or
+bounds error the CompressedVectorReader is in an undocumented state, and after a
+file I/O or checksum error so is the associated ImageFile.
+
+@pre The associated ImageFile must be open.
+@pre This CompressedVectorReader must be open (i.e isOpen())
+
+@return ::Success, or the ::ErrorCode of the E57Exception the throwing
+equivalent would have raised.
+
+@see CompressedVectorReader::read(), CompressedVectorReader::trySetBuffers
+*/
+ErrorCode CompressedVectorReader::tryRead( unsigned &recordCount ) noexcept
+{
+   recordCount = 0;
+
+   try
+   {
+      recordCount = impl_->read();
+      return Success;
+   }
+   catch ( E57Exception &ex )
+   {
+      return ex.errorCode();
+   }
+   catch ( ... )
+   {
+      return ErrorInternal;
+   }
+}
+
+/*!
+@brief Set a function called periodically during read, which can cancel it.
+
+@param [in] callback Function invoked once per data packet processed, or an
+empty std::function to remove a previously set callback.
+
+@details
+A read of a large CompressedVectorNode can take a long time, and with large
+destination buffers a single CompressedVectorReader::read call can too. The
+given @a callback is invoked from inside read() roughly once per data packet
+(~64KB of compressed data), with the number of records decoded since the start
+of the CompressedVectorNode and the number of bytes of the binary section
+processed so far, so a caller can drive a progress display at negligible cost.
+
+If the callback returns false the read is canceled: read() stops at the nearest
+record boundary and returns the number of records actually transferred, which
+may be less than the size of the destination buffers. The CompressedVectorReader
+remains open, and a subsequent read() or seek() behaves exactly as if the
+returned record count had filled the buffers.
+
+The callback must not call back into this CompressedVectorReader.
+
+@pre The associated ImageFile must be open.
+@pre This CompressedVectorReader must be open (i.e isOpen())
+
+@throw ::ErrorImageFileNotOpen
+@throw ::ErrorReaderNotOpen
+
+@see CompressedVectorReader::read(), CompressedVectorWriter::setProgressCallback
+*/
+void CompressedVectorReader::setProgressCallback( ProgressCallback callback )
+{
+   impl_->setProgressCallback( std::move( callback ) );
+}
+
 /*!
 @brief Set record number of CompressedVectorNode where next read will start.
 
@@ -272,6 +466,7 @@ childCount() (i.e. to one record past end of CompressedVectorNode).
 @throw ::ErrorBadAPIArgument
 @throw ::ErrorImageFileNotOpen
 @throw ::ErrorReaderNotOpen
+@throw ::ErrorNotImplemented The prototype contains a String element
 @throw ::ErrorBadCVPacket
 @throw ::ErrorSeekFailed
 @throw ::ErrorReadFailed
@@ -285,6 +480,228 @@ void CompressedVectorReader::seek( int64_t recordNumber )
    impl_->seek( recordNumber );
 }
 
+/*!
+@brief Deliver only every strideth record on subsequent reads.
+
+@param [in] stride Records whose index is a multiple of @a stride are delivered; the rest are
+skipped. 1 restores normal full-density reading.
+
+@details
+This puts the reader into a subsampling mode for level-of-detail previews: a read() fills the
+destination buffers with every strideth record of the CompressedVectorNode, and the skipped records
+cost only a bit offset advance in each bytestream instead of a full unpack and conversion. Decoding
+a 1-of-20 preview therefore takes roughly 1/20th of the decode time (packet reads still cover the
+whole section).
+
+The stride applies to record indexes within the CompressedVectorNode, not to the count of records
+already delivered, so it composes with seek().
+
+@pre @a stride >= 1.
+@pre The associated ImageFile must be open.
+@pre This CompressedVectorReader must be open (i.e isOpen())
+
+@throw ::ErrorBadAPIArgument
+@throw ::ErrorImageFileNotOpen
+@throw ::ErrorReaderNotOpen
+@throw ::ErrorNotImplemented The prototype contains a String element
+@throw ::ErrorInternal All objects in undocumented state
+
+@see CompressedVectorReader::read(), CompressedVectorReader::seek
+*/
+void CompressedVectorReader::setStride( int64_t stride )
+{
+   impl_->setStride( stride );
+}
+
+/*!
+@brief Restrict subsequent reads to records that may fall inside an axis-aligned box.
+
+@param [in] xMinimum Lower x bound of the query box (inclusive).
+@param [in] xMaximum Upper x bound of the query box (inclusive).
+@param [in] yMinimum Lower y bound of the query box.
+@param [in] yMaximum Upper y bound of the query box.
+@param [in] zMinimum Lower z bound of the query box.
+@param [in] zMaximum Upper z bound of the query box.
+
+@details
+This puts the reader into a region query mode for extracting tiles from large scans. Subsequent
+read() calls deliver only the records of the CompressedVectorNode that may have cartesian
+coordinates inside the box, seeking over the rest, until read() returns 0.
+
+The pruning uses the optional "tidx" spatial index, which records the coordinate bounds of
+fixed-size blocks of records. It is written automatically when the file was created with the
+extension registered — extensionsAdd( "tidx", uri ) before creating the points — and the prototype
+contains cartesianX/cartesianY/cartesianZ. The delivered records are the whole blocks that
+intersect the box, so they are a superset of the exact answer and the caller still filters each
+point against the box; the win is that blocks entirely outside the box are never read or decoded.
+On a file without the index, every record is delivered, which is the same superset semantics
+without the skipping.
+
+The reader's position is controlled by the region ranges; interleaving seek() calls with region
+mode reads is not supported.
+
+@pre Each minimum must be <= the corresponding maximum.
+@pre The associated ImageFile must be open.
+@pre This CompressedVectorReader must be open (i.e isOpen())
+
+@throw ::ErrorBadAPIArgument
+@throw ::ErrorImageFileNotOpen
+@throw ::ErrorReaderNotOpen
+@throw ::ErrorNotImplemented The prototype contains a String element
+@throw ::ErrorInternal All objects in undocumented state
+
+@see CompressedVectorReader::read(), ImageFile::extensionsAdd
+*/
+void CompressedVectorReader::setRegion( double xMinimum, double xMaximum, double yMinimum,
+                                        double yMaximum, double zMinimum, double zMaximum )
+{
+   impl_->setRegion( xMinimum, xMaximum, yMinimum, yMaximum, zMinimum, zMaximum );
+}
+
+/*!
+@brief Restrict subsequent reads to the blocks of records that contain valid points.
+
+@details
+This puts the reader into a range mode like setRegion(), driven by the "vidx" valid-point summary
+instead of a query box: subsequent read() calls deliver only the blocks of records that contain at
+least one record with invalid state 0, seeking over the blocks that are entirely invalid, until
+read() returns 0. Scans with long runs of invalid padding (line gaps, dropouts) skip those runs in
+constant time, without reading or decoding them.
+
+The summary is written automatically when the file was created with the extension registered —
+extensionsAdd( "vidx", uri ) before creating the points — and the prototype contains
+cartesianInvalidState or sphericalInvalidState. The delivered blocks may still contain some invalid
+records, so the caller still filters each record (setFilter() on the invalid-state field composes
+well); the win is the skipping. On a file without the summary, every record is delivered, which is
+the same superset semantics without the skipping.
+
+The reader's position is controlled by the selected ranges; interleaving seek() calls or combining
+with setRegion() is not supported.
+
+@pre The associated ImageFile must be open.
+@pre This CompressedVectorReader must be open (i.e isOpen())
+
+@throw ::ErrorBadAPIArgument
+@throw ::ErrorImageFileNotOpen
+@throw ::ErrorReaderNotOpen
+@throw ::ErrorNotImplemented The prototype contains a String element
+@throw ::ErrorInternal All objects in undocumented state
+
+@see CompressedVectorNode::validRecordCount, CompressedVectorReader::setFilter,
+ImageFile::extensionsAdd
+*/
+void CompressedVectorReader::setValidOnly()
+{
+   impl_->setValidOnly();
+}
+
+/*!
+@brief Synthesize rowIndex/columnIndex arithmetically instead of decoding them.
+
+@param [in] rowMinimum Smallest rowIndex of the grid (indexBounds/rowMinimum).
+@param [in] columnMinimum Smallest columnIndex of the grid (indexBounds/columnMinimum).
+@param [in] lineLength Number of records in one line of the raster.
+@param [in] byColumn true when the records are stored line by line with each line being a column
+(the rowIndex varies within a line); false when each line is a row.
+
+@details
+On a gridded scan stored in raster order, rowIndex and columnIndex are fully determined by the
+record number: record n of a column-major grid has rowIndex = @a rowMinimum + n % @a lineLength and
+columnIndex = @a columnMinimum + n / @a lineLength (transposed for row-major). This function drops
+the decode channels of both fields and has read() compute the indexes directly into their
+destination buffers, saving the bit-unpack of two of the widest channels. The caller asserts the
+raster layout; the library does not verify it against the stored bytestreams.
+ReaderImpl::SetUpData3DPointsData() engages this automatically when the Data3D header pins the
+raster down exactly.
+
+Destination buffers for other fields are decoded normally, and at least one such field must be
+present. Must be called before the first read() or seek(); seek() afterwards is fine (the
+synthesized indexes restart from the new position), but setStride(), setRegion(), setValidOnly()
+and setFilter() deliver records out of plain record order and can't be combined with synthesis.
+
+@pre @a lineLength >= 1.
+@pre No read() or seek() has been issued yet.
+@pre The associated ImageFile must be open.
+@pre This CompressedVectorReader must be open (i.e isOpen())
+
+@throw ::ErrorBadAPIArgument
+@throw ::ErrorImageFileNotOpen
+@throw ::ErrorReaderNotOpen
+@throw ::ErrorInternal All objects in undocumented state
+
+@see CompressedVectorReader::read(), Reader::SetUpData3DPointsData
+*/
+void CompressedVectorReader::setGridSynthesis( int64_t rowMinimum, int64_t columnMinimum,
+                                               int64_t lineLength, bool byColumn )
+{
+   impl_->setGridSynthesis( rowMinimum, columnMinimum, lineLength, byColumn );
+}
+
+/*!
+@brief Reject records during decode by a predicate on one field's raw stored value.
+
+@param [in] pathName Pathname of an Integer or ScaledInteger element in the prototype, relative to
+the prototype root, that the predicate examines.
+@param [in] predicate Called once per record with the raw (unscaled) stored integer of @a pathName;
+returning false rejects the record.
+
+@details
+This pushes record filtering below the conversion layer for queries that discard most points (e.g.
+by cartesianInvalidState, an intensity threshold, or returnIndex). The predicate runs on the raw
+integer right after bit-unpacking, before any scaling, type conversion, or write into the
+destination buffers, so a rejected record costs only the unpack. Subsequent read() calls deliver
+only the surviving records, densely packed, and return the survivor count; read() returns 0 only at
+the true end of the CompressedVectorNode.
+
+The filtered field does not have to appear in the destination buffers — filtering on
+cartesianInvalidState while reading only coordinates works. Calling setFilter() again with another
+pathname adds a second predicate; a record must satisfy all of them. ScaledInteger predicates see
+the raw value; apply the inverse scaling to the threshold instead of scaling every record.
+
+All filters must be in place before the first read() or seek() on this CompressedVectorReader.
+
+@pre @a predicate is callable.
+@pre @a pathName designates an Integer or ScaledInteger element of the prototype.
+@pre No read() or seek() has been issued yet.
+@pre The associated ImageFile must be open.
+@pre This CompressedVectorReader must be open (i.e isOpen())
+
+@throw ::ErrorBadAPIArgument
+@throw ::ErrorPathUndefined
+@throw ::ErrorImageFileNotOpen
+@throw ::ErrorReaderNotOpen
+@throw ::ErrorNotImplemented The prototype contains a String element
+@throw ::ErrorInternal All objects in undocumented state
+
+@see CompressedVectorReader::clearFilters, CompressedVectorReader::read()
+*/
+void CompressedVectorReader::setFilter( const ustring &pathName, RecordFilter predicate )
+{
+   impl_->setFilter( pathName, std::move( predicate ) );
+}
+
+/*!
+@brief Remove all predicates installed by setFilter and restore full-density reading.
+
+@details
+Like setFilter(), this is only allowed before the first read() or seek().
+
+@pre No read() or seek() has been issued yet.
+@pre The associated ImageFile must be open.
+@pre This CompressedVectorReader must be open (i.e isOpen())
+
+@throw ::ErrorBadAPIArgument
+@throw ::ErrorImageFileNotOpen
+@throw ::ErrorReaderNotOpen
+@throw ::ErrorInternal All objects in undocumented state
+
+@see CompressedVectorReader::setFilter
+*/
+void CompressedVectorReader::clearFilters()
+{
+   impl_->clearFilters();
+}
+
 /*!
 @brief End the read operation.
 
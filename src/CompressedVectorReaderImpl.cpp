@@ -25,14 +25,25 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
+
 #include "CompressedVectorReaderImpl.h"
+#include "BlobNodeImpl.h"
 #include "CheckedFile.h"
 #include "CompressedVectorNodeImpl.h"
+#include "FloatNodeImpl.h"
 #include "ImageFileImpl.h"
 #include "Packet.h"
+#include "ScaledIntegerNodeImpl.h"
 #include "SectionHeaders.h"
 #include "SourceDestBufferImpl.h"
 #include "StringFunctions.h"
+#include "StructureNodeImpl.h"
+#include "TaskSchedulerImpl.h"
+#include "ThreadPool.h"
+#include "TileIndex.h"
+#include "TraceImpl.h"
+#include "ValidIndex.h"
 
 namespace e57
 {
@@ -64,31 +75,14 @@ namespace e57
       // type)
       proto_ = cVector_->getPrototype();
 
-      // Check dbufs well formed (matches proto exactly)
+      // Check dbufs well formed (no dups or extras; prototype fields may be
+      // omitted, their bytestreams are then skipped without being decoded)
       setBuffers( dbufs );
 
       // For each dbuf, create an appropriate Decoder based on the cVector_
-      // attributes
-      for ( unsigned i = 0; i < dbufs_.size(); i++ )
-      {
-         std::vector<SourceDestBuffer> theDbuf;
-         theDbuf.push_back( dbufs.at( i ) );
-
-         std::shared_ptr<Decoder> decoder =
-            Decoder::DecoderFactory( i, cVector_.get(), theDbuf, ustring() );
-
-         // Calc which stream the given path belongs to.  This depends on position
-         // of the node in the proto tree.
-         NodeImplSharedPtr readNode = proto_->get( dbufs.at( i ).pathName() );
-         uint64_t bytestreamNumber = 0;
-         if ( !proto_->findTerminalPosition( readNode, bytestreamNumber ) )
-         {
-            throw E57_EXCEPTION2( ErrorInternal, "dbufIndex=" + toString( i ) );
-         }
-
-         channels_.emplace_back( dbufs.at( i ), decoder, static_cast<unsigned>( bytestreamNumber ),
-                                 cVector_->childCount() );
-      }
+      // attributes. Only requested fields get a channel and a decoder, so a
+      // subset of the prototype costs only that subset's unpack work.
+      buildChannels();
 
       recordCount_ = 0;
 
@@ -97,8 +91,54 @@ namespace e57
 
       ImageFileImplSharedPtr imf( cVector_->destImageFile_ );
 
+      // Size the packet cache from the file's configured budget (in bytes);
+      // default is 32 packets (2 MB), enough for sequential decode but small
+      // for interleaved multi-channel or windowed access.
+      unsigned packetCount = 32;
+
+      const size_t cCacheBytes = imf->packetCacheBytes();
+
+      if ( cCacheBytes > 0 )
+      {
+         packetCount = static_cast<unsigned>(
+            std::max<size_t>( 4, cCacheBytes / static_cast<size_t>( DATA_PACKET_MAX ) ) );
+      }
+
       //??? what if fault in this constructor?
-      cache_ = new PacketReadCache( imf->file_, 32 );
+      cache_ = new PacketReadCache( imf->file_, packetCount );
+      cache_->setStatsData( imf->statsData() );
+
+      // Tracked regardless of the counter toggle: this reports current
+      // bytes held, not activity (see ImageFileStats::memoryUsedBytes)
+      imf->statsData_.memoryUsedBytes += cache_->memoryBytes();
+
+      // Large fetch units amortize request latency on cloud-backed storage
+      // (see ImageFile::ioUnitSetSize); 0 keeps packet-sized reads.
+      cache_->setFetchUnit( imf->ioUnitBytes() );
+
+      // Decoding is independent per bytestream, so spread multi-channel
+      // records over the available cores. Normally the shared scheduler
+      // supplies the threads (see TaskSchedulerImpl); pinned decode keeps a
+      // private pool, since per-file CPU pinning can't be applied to workers
+      // shared by the whole process.
+      if ( channels_.size() > 1 )
+      {
+         const unsigned hwThreads = std::max( 1U, std::thread::hardware_concurrency() );
+         const unsigned workerCount =
+            std::min( static_cast<unsigned>( channels_.size() ), hwThreads ) - 1;
+
+         if ( workerCount > 0 )
+         {
+            if ( imf->decodePinWorkers() )
+            {
+               pool_ = new ThreadPool( workerCount, true );
+            }
+            else
+            {
+               useSharedScheduler_ = true;
+            }
+         }
+      }
 
       // Read CompressedVector section header
       CompressedVectorSectionHeader sectionHeader;
@@ -111,8 +151,8 @@ namespace e57
          throw E57_EXCEPTION2( ErrorInternal, "imageFileName=" + cVector_->imageFileName() +
                                                  " cvPathName=" + cVector_->pathName() );
       }
-      imf->file_->seek( sectionLogicalStart, CheckedFile::Logical );
-      imf->file_->read( reinterpret_cast<char *>( &sectionHeader ), sizeof( sectionHeader ) );
+      imf->file_->readAt( sectionLogicalStart, reinterpret_cast<char *>( &sectionHeader ),
+                          sizeof( sectionHeader ) );
 
 #if VALIDATE_BASIC
       sectionHeader.verify( imf->file_->length( CheckedFile::Physical ) );
@@ -122,14 +162,32 @@ namespace e57
       sectionEndLogicalOffset_ = sectionLogicalStart + sectionHeader.sectionLogicalLength;
 
       // Convert physical offset to first data packet to logical
-      uint64_t dataLogicalOffset =
-         imf->file_->physicalToLogical( sectionHeader.dataPhysicalOffset );
+      dataLogicalOffset_ = imf->file_->physicalToLogical( sectionHeader.dataPhysicalOffset );
+
+      // Sequential reads walk the section front to back, so warm the page
+      // cache ahead of the decoders.
+      cache_->startReadAhead( dataLogicalOffset_, sectionEndLogicalOffset_ );
+
+      // In streaming cache mode, hint at the start of the scan; read() then
+      // drops the scanned-past range behind the decoders (see
+      // ImageFile::cacheSetStreaming).
+      adviseDoneLogicalOffset_ = dataLogicalOffset_;
+
+      if ( imf->cacheStreaming() )
+      {
+         const uint64_t cPhysicalStart = CheckedFile::logicalToPhysical( dataLogicalOffset_ );
+         const uint64_t cPhysicalEnd = CheckedFile::logicalToPhysical( sectionEndLogicalOffset_ );
+
+         imf->file_->adviseWillNeed(
+            cPhysicalStart, std::min( cPhysicalEnd - cPhysicalStart,
+                                      static_cast<uint64_t>( 8 * 1024 * 1024 ) ) );
+      }
 
       // Verify that packet given by dataPhysicalOffset is actually a data packet,
       // init channels
       {
          char *anyPacket = nullptr;
-         std::unique_ptr<PacketLock> packetLock = cache_->lock( dataLogicalOffset, anyPacket );
+         std::unique_ptr<PacketLock> packetLock = cache_->lock( dataLogicalOffset_, anyPacket );
 
          auto dpkt = reinterpret_cast<DataPacket *>( anyPacket );
 
@@ -143,7 +201,7 @@ namespace e57
          // Have good packet, initialize channels
          for ( auto &channel : channels_ )
          {
-            channel.currentPacketLogicalOffset = dataLogicalOffset;
+            channel.currentPacketLogicalOffset = dataLogicalOffset_;
             channel.currentBytestreamBufferIndex = 0;
             channel.currentBytestreamBufferLength =
                dpkt->getBytestreamBufferLength( channel.bytestreamNumber );
@@ -178,6 +236,181 @@ namespace e57
       }
    }
 
+   /// Create one channel (with its decoder) per dbuf, decoding straight into
+   /// the caller's buffers.
+   void CompressedVectorReaderImpl::buildChannels()
+   {
+      channels_.clear();
+
+      for ( unsigned i = 0; i < dbufs_.size(); i++ )
+      {
+         // Grid synthesis computes these indexes from the record number, so
+         // they get no decode channel (see setGridSynthesis())
+         if ( gridSynthesisActive_ && ( dbufs_.at( i ).pathName() == "rowIndex" ||
+                                        dbufs_.at( i ).pathName() == "columnIndex" ) )
+         {
+            continue;
+         }
+
+         std::vector<SourceDestBuffer> theDbuf;
+         theDbuf.push_back( dbufs_.at( i ) );
+
+         // Calc which stream the given path belongs to.  This depends on position
+         // of the node in the proto tree.
+         NodeImplSharedPtr readNode = proto_->get( dbufs_.at( i ).pathName() );
+         uint64_t bytestreamNumber = 0;
+         if ( !proto_->findTerminalPosition( readNode, bytestreamNumber ) )
+         {
+            throw E57_EXCEPTION2( ErrorInternal, "dbufIndex=" + toString( i ) );
+         }
+
+         std::shared_ptr<Decoder> decoder = Decoder::DecoderFactory(
+            static_cast<unsigned>( bytestreamNumber ), cVector_.get(), theDbuf, ustring() );
+
+         channels_.emplace_back( dbufs_.at( i ), decoder, static_cast<unsigned>( bytestreamNumber ),
+                                 cVector_->childCount() );
+      }
+   }
+
+   /// Rebuild the channels so they decode raw values into internal staging
+   /// buffers instead of the caller's buffers: one channel per dbuf (same
+   /// order) plus one per filtered field that is not also an output. Only
+   /// valid before any decoding has happened (see setFilter()).
+   void CompressedVectorReaderImpl::rebuildChannelsForFilters()
+   {
+      const size_t cCapacity = dbufs_.at( 0 ).impl()->capacity();
+
+      // Output fields first, so channel index == dbuf index; then the
+      // filter-only fields
+      std::vector<ustring> paths;
+
+      for ( auto &dbuf : dbufs_ )
+      {
+         paths.push_back( dbuf.pathName() );
+      }
+
+      for ( auto &term : filters_ )
+      {
+         const auto found = std::find( paths.begin(), paths.end(), term.pathName );
+
+         if ( found == paths.end() )
+         {
+            term.channelIndex = paths.size();
+            paths.push_back( term.pathName );
+         }
+         else
+         {
+            term.channelIndex = static_cast<size_t>( found - paths.begin() );
+         }
+      }
+
+      channels_.clear();
+      staging_.clear();
+
+      for ( size_t i = 0; i < paths.size(); i++ )
+      {
+         NodeImplSharedPtr readNode = proto_->get( paths[i] );
+
+         StagingChannel schan;
+         std::shared_ptr<SourceDestBufferImpl> sbi( new SourceDestBufferImpl(
+            cVector_->destImageFile_, paths[i], cCapacity ) );
+
+         switch ( readNode->type() )
+         {
+            case TypeInteger:
+               schan.intValues.resize( cCapacity );
+               sbi->setTypeInfo<int64_t>( schan.intValues.data() );
+               break;
+
+            case TypeScaledInteger:
+            {
+               std::shared_ptr<ScaledIntegerNodeImpl> sini =
+                  std::static_pointer_cast<ScaledIntegerNodeImpl>( readNode );
+
+               // Stage the raw integers (no scaling requested on sbi); the
+               // scale is applied when the survivors are delivered
+               schan.isScaled = true;
+               schan.scale = sini->scale();
+               schan.offset = sini->offset();
+               schan.intValues.resize( cCapacity );
+               sbi->setTypeInfo<int64_t>( schan.intValues.data() );
+            }
+            break;
+
+            case TypeFloat:
+            {
+               std::shared_ptr<FloatNodeImpl> fni =
+                  std::static_pointer_cast<FloatNodeImpl>( readNode );
+
+               if ( fni->precision() == PrecisionSingle )
+               {
+                  schan.floatValues.resize( cCapacity );
+                  sbi->setTypeInfo<float>( schan.floatValues.data() );
+               }
+               else
+               {
+                  schan.doubleValues.resize( cCapacity );
+                  sbi->setTypeInfo<double>( schan.doubleValues.data() );
+               }
+            }
+            break;
+
+            default:
+               // Variable width fields (strings) can't be staged and
+               // compacted by record index
+               throw E57_EXCEPTION2( ErrorNotImplemented, "pathName=" + paths[i] );
+         }
+
+         const SourceDestBuffer cStagingDbuf( sbi );
+
+         std::vector<SourceDestBuffer> theDbuf;
+         theDbuf.push_back( cStagingDbuf );
+
+         uint64_t bytestreamNumber = 0;
+         if ( !proto_->findTerminalPosition( readNode, bytestreamNumber ) )
+         {
+            throw E57_EXCEPTION2( ErrorInternal, "pathName=" + paths[i] );
+         }
+
+         std::shared_ptr<Decoder> decoder = Decoder::DecoderFactory(
+            static_cast<unsigned>( bytestreamNumber ), cVector_.get(), theDbuf, ustring() );
+
+         channels_.emplace_back( cStagingDbuf, decoder, static_cast<unsigned>( bytestreamNumber ),
+                                 cVector_->childCount() );
+
+         staging_.push_back( std::move( schan ) );
+      }
+
+      // Position the new channels at the first data packet, the same way the
+      // constructor does
+      {
+         char *anyPacket = nullptr;
+         std::unique_ptr<PacketLock> packetLock = cache_->lock( dataLogicalOffset_, anyPacket );
+
+         auto dpkt = reinterpret_cast<DataPacket *>( anyPacket );
+
+         for ( auto &channel : channels_ )
+         {
+            channel.currentPacketLogicalOffset = dataLogicalOffset_;
+            channel.currentBytestreamBufferIndex = 0;
+            channel.currentBytestreamBufferLength =
+               dpkt->getBytestreamBufferLength( channel.bytestreamNumber );
+         }
+      }
+
+      // The filter may have added channels; revisit the parallel decode
+      // decision made in the constructor (pinned pools are kept as is)
+      if ( pool_ == nullptr && !useSharedScheduler_ && channels_.size() > 1 )
+      {
+         ImageFileImplSharedPtr imf( cVector_->destImageFile_ );
+
+         if ( !imf->decodePinWorkers() )
+         {
+            useSharedScheduler_ = true;
+         }
+      }
+   }
+
    void CompressedVectorReaderImpl::setBuffers( std::vector<SourceDestBuffer> &dbufs )
    {
       // don't checkImageFileOpen
@@ -236,31 +469,138 @@ namespace e57
          dbuf.impl()->rewind();
       }
 
-      // Allow decoders to use data they already have in their queue to fill newly
-      // empty dbufs This helps to keep decoder input queues smaller, which
-      // reduces backtracking in the packet cache.
-      for ( auto &channel : channels_ )
+      // Decoding is about to start, so the channel layout is final
+      filtersLocked_ = true;
+
+      unsigned outputCount = 0;
+      uint64_t decodedCount = 0;
+
+      if ( filters_.empty() )
       {
-         channel.decoder->inputProcess( nullptr, 0 );
+         bool canceled = false;
+
+         outputCount = fillRecords( canceled );
+         decodedCount = outputCount;
+
+         if ( gridSynthesisActive_ && ( outputCount > 0 ) )
+         {
+            fillSynthesizedIndexes( outputCount );
+         }
+      }
+      else
+      {
+         outputCount = readFiltered( decodedCount );
       }
 
-      // Loop until every dbuf is full or we have reached end of the binary
-      // section.
-      while ( true )
       {
-         // Find the earliest packet position for channels that are still hungry
-         // It's important to call inputProcess of the decoders before this call,
-         // so current hungriness level is reflected.
-         uint64_t earliestPacketLogicalOffset = earliestPacketNeededForInput();
+         ImageFileImplSharedPtr imf( cVector_->destImageFile_ );
+         ImageFileStatsData *stats = imf->statsData();
 
-         // If nobody's hungry, we are done with the read
-         if ( earliestPacketLogicalOffset == UINT64_MAX )
+         if ( stats != nullptr )
          {
-            break;
+            stats->recordsDecoded += decodedCount;
+
+            if ( gridSynthesisActive_ )
+            {
+               stats->recordsSynthesized += outputCount;
+            }
          }
 
-         // Feed packet to the hungry decoders
-         feedPacketToDecoders( earliestPacketLogicalOffset );
+         // In streaming cache mode, drop the part of the section every
+         // channel has scanned past from the OS page cache, in 16 MB steps
+         // to keep the syscall rate trivial.
+         if ( imf->cacheStreaming() )
+         {
+            constexpr uint64_t cDropBehindBytes = 16 * 1024 * 1024;
+
+            uint64_t earliestPacketLogicalOffset = UINT64_MAX;
+
+            for ( const auto &channel : channels_ )
+            {
+               earliestPacketLogicalOffset =
+                  std::min( earliestPacketLogicalOffset, channel.currentPacketLogicalOffset );
+            }
+
+            if ( ( earliestPacketLogicalOffset != UINT64_MAX ) &&
+                 ( earliestPacketLogicalOffset > adviseDoneLogicalOffset_ + cDropBehindBytes ) )
+            {
+               const uint64_t cPhysicalStart =
+                  CheckedFile::logicalToPhysical( adviseDoneLogicalOffset_ );
+               const uint64_t cPhysicalEnd =
+                  CheckedFile::logicalToPhysical( earliestPacketLogicalOffset );
+
+               imf->file_->adviseDone( cPhysicalStart, cPhysicalEnd - cPhysicalStart );
+
+               adviseDoneLogicalOffset_ = earliestPacketLogicalOffset;
+            }
+         }
+      }
+
+      // Return number of records transferred to each dbuf.
+      return outputCount;
+   }
+
+   /// Fill each channel's bound dest buffer from the current position (the
+   /// caller's buffers, or the raw staging buffers when filtering) and
+   /// return the record count they all produced. canceled reports whether a
+   /// progress callback stopped the fill early.
+   unsigned CompressedVectorReaderImpl::fillRecords( bool &canceled )
+   {
+      if ( !regionActive_ )
+      {
+         // A canceled fill already stopped at a consistent record boundary,
+         // so it needs no special handling here.
+         canceled = fillDestBuffers();
+      }
+      else
+      {
+         // Deliver only the record ranges selected by setRegion(), seeking
+         // over the gaps between them. A range boundary in the middle of the
+         // dest buffers just continues filling from the next range.
+         const size_t cCapacity = channels_.at( 0 ).dbuf.impl()->capacity();
+
+         while ( regionRangeIndex_ < regionRanges_.size() )
+         {
+            const std::pair<uint64_t, uint64_t> &range = regionRanges_[regionRangeIndex_];
+
+            if ( !regionPositioned_ )
+            {
+               seek( range.first );
+
+               for ( auto &channel : channels_ )
+               {
+                  channel.decoder->setLimitRecord( range.second );
+               }
+
+               regionPositioned_ = true;
+            }
+
+            canceled = fillDestBuffers();
+
+            if ( canceled )
+            {
+               // Deliver what was decoded so far; the next read() picks this
+               // range up again where the channels stopped.
+               break;
+            }
+
+            if ( channels_.at( 0 ).decoder->totalRecordsCompleted() >= range.second )
+            {
+               // Finished this range; position on the next one when needed
+               regionRangeIndex_++;
+               regionPositioned_ = false;
+            }
+            else
+            {
+               // Dest buffers are full, or the section ran out of data
+               break;
+            }
+
+            if ( channels_.at( 0 ).dbuf.impl()->nextIndex() == cCapacity )
+            {
+               break;
+            }
+         }
       }
 
       // Verify that each channel produced the same number of records
@@ -283,54 +623,283 @@ namespace e57
          }
       }
 
-      // Return number of records transferred to each dbuf.
       return outputCount;
    }
 
-   uint64_t CompressedVectorReaderImpl::earliestPacketNeededForInput() const
+   /// read() with filters set: stage raw batches, reject records, and pack
+   /// the survivors into the caller's buffers until they are full or the
+   /// input ends. decodedCount reports the records actually decoded (staged),
+   /// which is what the stats should count.
+   unsigned CompressedVectorReaderImpl::readFiltered( uint64_t &decodedCount )
    {
-      uint64_t earliestPacketLogicalOffset = UINT64_MAX;
-#ifdef E57_VERBOSE
-      unsigned earliestChannel = 0;
-#endif
+      const size_t cCapacity = dbufs_.at( 0 ).impl()->capacity();
 
-      for ( unsigned i = 0; i < channels_.size(); i++ )
-      {
-         const DecodeChannel *chan = &channels_[i];
+      size_t produced = 0;
+      bool endOfInput = false;
 
-         // Test if channel needs more input.
-         // Important to call inputProcess just before this, so these tests work.
-         if ( !chan->isOutputBlocked() && !chan->inputFinished )
+      while ( produced < cCapacity )
+      {
+         if ( carryOffset_ == carryCount_ )
          {
-            // Check if earliest so far
-            if ( chan->currentPacketLogicalOffset < earliestPacketLogicalOffset )
+            if ( endOfInput )
             {
-               earliestPacketLogicalOffset = chan->currentPacketLogicalOffset;
-#ifdef E57_VERBOSE
-               earliestChannel = i;
-#endif
+               break;
             }
+
+            // Stage the next batch of raw records
+            for ( auto &channel : channels_ )
+            {
+               channel.dbuf.impl()->rewind();
+            }
+
+            bool canceled = false;
+            const unsigned cStaged = fillRecords( canceled );
+
+            if ( cStaged == 0 )
+            {
+               break;
+            }
+
+            decodedCount += cStaged;
+
+            if ( canceled )
+            {
+               // Deliver the survivors staged so far, then stop
+               endOfInput = true;
+            }
+
+            compactSurvivors( cStaged );
+            continue;
          }
+
+         const size_t cTake = std::min( carryCount_ - carryOffset_, cCapacity - produced );
+
+         appendSurvivors( carryOffset_, cTake );
+
+         carryOffset_ += cTake;
+         produced += cTake;
       }
-#ifdef E57_VERBOSE
-      if ( earliestPacketLogicalOffset == UINT64_MAX )
-      {
-         std::cout << "earliestPacketNeededForInput returning none found" << std::endl;
-      }
-      else
-      {
-         std::cout << "earliestPacketNeededForInput returning " << earliestPacketLogicalOffset
-                   << " for channel[" << earliestChannel << "]" << std::endl;
-      }
-#endif
-      return earliestPacketLogicalOffset;
+
+      return static_cast<unsigned>( produced );
    }
 
-   DataPacket *CompressedVectorReaderImpl::dataPacket( uint64_t inLogicalOffset ) const
+   /// Run the filter predicates over a staged batch and pack the surviving
+   /// records of every output channel to the front of its staging buffer
+   void CompressedVectorReaderImpl::compactSurvivors( unsigned stagedCount )
    {
-      char *packet = nullptr;
+      acceptMask_.assign( stagedCount, 1 );
 
-      std::unique_ptr<PacketLock> packetLock = cache_->lock( inLogicalOffset, packet );
+      for ( const auto &term : filters_ )
+      {
+         const int64_t *cValues = staging_[term.channelIndex].intValues.data();
+
+         for ( unsigned i = 0; i < stagedCount; ++i )
+         {
+            if ( acceptMask_[i] != 0 && !term.predicate( cValues[i] ) )
+            {
+               acceptMask_[i] = 0;
+            }
+         }
+      }
+
+      // Filter-only channels are never delivered, so they are not compacted
+      size_t survivors = 0;
+
+      for ( size_t k = 0; k < dbufs_.size(); ++k )
+      {
+         StagingChannel &schan = staging_[k];
+         size_t write = 0;
+
+         for ( unsigned i = 0; i < stagedCount; ++i )
+         {
+            if ( acceptMask_[i] == 0 )
+            {
+               continue;
+            }
+
+            if ( !schan.intValues.empty() )
+            {
+               schan.intValues[write] = schan.intValues[i];
+            }
+            else if ( !schan.floatValues.empty() )
+            {
+               schan.floatValues[write] = schan.floatValues[i];
+            }
+            else
+            {
+               schan.doubleValues[write] = schan.doubleValues[i];
+            }
+
+            ++write;
+         }
+
+         survivors = write;
+      }
+
+      carryCount_ = survivors;
+      carryOffset_ = 0;
+   }
+
+   /// Convert count staged survivors (starting at offset) of every output
+   /// channel and append them to the caller's buffers. This is the only
+   /// place rejected batches never reach: conversion and output writes
+   /// happen for survivors alone.
+   void CompressedVectorReaderImpl::appendSurvivors( size_t offset, size_t count )
+   {
+      for ( size_t k = 0; k < dbufs_.size(); ++k )
+      {
+         SourceDestBufferImpl *dest = dbufs_[k].impl().get();
+         const StagingChannel &schan = staging_[k];
+
+         if ( !schan.intValues.empty() )
+         {
+            if ( schan.isScaled )
+            {
+               dest->setNextInt64N( schan.intValues.data() + offset, count, schan.scale,
+                                    schan.offset );
+            }
+            else
+            {
+               dest->setNextInt64N( schan.intValues.data() + offset, count );
+            }
+         }
+         else if ( !schan.floatValues.empty() )
+         {
+            dest->setNextFloatN( schan.floatValues.data() + offset, count );
+         }
+         else
+         {
+            dest->setNextDoubleN( schan.doubleValues.data() + offset, count );
+         }
+      }
+   }
+
+   /// Returns true if a progress callback canceled the fill early.
+   bool CompressedVectorReaderImpl::fillDestBuffers()
+   {
+      bool canceled = false;
+      uint64_t priorLimitRecord = UINT64_MAX;
+
+      // Allow decoders to use data they already have in their queue to fill newly
+      // empty dbufs This helps to keep decoder input queues smaller, which
+      // reduces backtracking in the packet cache.
+      for ( auto &channel : channels_ )
+      {
+         channel.decoder->inputProcess( nullptr, 0 );
+      }
+
+      // Loop until every dbuf is full or we have reached end of the binary
+      // section.
+      while ( true )
+      {
+         // Find the earliest packet position for channels that are still hungry
+         // It's important to call inputProcess of the decoders before this call,
+         // so current hungriness level is reflected.
+         uint64_t earliestPacketLogicalOffset = earliestPacketNeededForInput();
+
+         // If nobody's hungry, we are done with the read
+         if ( earliestPacketLogicalOffset == UINT64_MAX )
+         {
+            break;
+         }
+
+         // Feed packet to the hungry decoders
+         feedPacketToDecoders( earliestPacketLogicalOffset );
+
+         if ( progressCallback_ && !canceled )
+         {
+            // Report the record every channel has completed and how far into
+            // the binary section the scan has reached.
+            uint64_t recordsCompleted = UINT64_MAX;
+            for ( auto &channel : channels_ )
+            {
+               recordsCompleted =
+                  std::min( recordsCompleted, channel.decoder->totalRecordsCompleted() );
+            }
+
+            if ( !progressCallback_( recordsCompleted,
+                                     earliestPacketLogicalOffset - dataLogicalOffset_ ) )
+            {
+               // Canceled. The channels may have decoded unequal record
+               // counts, so stop at the nearest consistent point: clamp every
+               // channel to the record the furthest-ahead channel has
+               // completed and keep looping until they all reach it. The
+               // dbufs then hold the same number of records in every channel,
+               // and the next read() resumes right after them, so the reader
+               // stays open and seekable.
+               canceled = true;
+               priorLimitRecord = channels_.at( 0 ).decoder->limitRecord();
+
+               uint64_t stopRecord = 0;
+               for ( auto &channel : channels_ )
+               {
+                  stopRecord = std::max( stopRecord, channel.decoder->totalRecordsCompleted() );
+               }
+
+               for ( auto &channel : channels_ )
+               {
+                  channel.decoder->setLimitRecord( std::min( stopRecord, priorLimitRecord ) );
+               }
+            }
+         }
+      }
+
+      if ( canceled )
+      {
+         // Undo the clamp so a later read() can continue past the stop point
+         for ( auto &channel : channels_ )
+         {
+            channel.decoder->setLimitRecord( priorLimitRecord );
+         }
+      }
+
+      return canceled;
+   }
+
+   uint64_t CompressedVectorReaderImpl::earliestPacketNeededForInput() const
+   {
+      uint64_t earliestPacketLogicalOffset = UINT64_MAX;
+#ifdef E57_VERBOSE
+      unsigned earliestChannel = 0;
+#endif
+
+      for ( unsigned i = 0; i < channels_.size(); i++ )
+      {
+         const DecodeChannel *chan = &channels_[i];
+
+         // Test if channel needs more input.
+         // Important to call inputProcess just before this, so these tests work.
+         if ( !chan->isOutputBlocked() && !chan->inputFinished )
+         {
+            // Check if earliest so far
+            if ( chan->currentPacketLogicalOffset < earliestPacketLogicalOffset )
+            {
+               earliestPacketLogicalOffset = chan->currentPacketLogicalOffset;
+#ifdef E57_VERBOSE
+               earliestChannel = i;
+#endif
+            }
+         }
+      }
+#ifdef E57_VERBOSE
+      if ( earliestPacketLogicalOffset == UINT64_MAX )
+      {
+         std::cout << "earliestPacketNeededForInput returning none found" << std::endl;
+      }
+      else
+      {
+         std::cout << "earliestPacketNeededForInput returning " << earliestPacketLogicalOffset
+                   << " for channel[" << earliestChannel << "]" << std::endl;
+      }
+#endif
+      return earliestPacketLogicalOffset;
+   }
+
+   DataPacket *CompressedVectorReaderImpl::dataPacket( uint64_t inLogicalOffset ) const
+   {
+      char *packet = nullptr;
+
+      std::unique_ptr<PacketLock> packetLock = cache_->lock( inLogicalOffset, packet );
 
       return reinterpret_cast<DataPacket *>( packet );
    }
@@ -358,15 +927,24 @@ namespace e57
       bool anyChannelHasExhaustedPacket = false;
       uint64_t nextPacketLogicalOffset = UINT64_MAX;
 
-      // Feed bytestreams to channels with unblocked output that are reading from this packet
+      // Collect channels with unblocked output that are reading from this packet
+      std::vector<DecodeChannel *> hungryChannels;
+
+      hungryChannels.reserve( channels_.size() );
+
       for ( DecodeChannel &channel : channels_ )
       {
          // Skip channels that have already read this packet.
-         if ( _alreadyReadPacket( channel, currentPacketLogicalOffset ) )
+         if ( !_alreadyReadPacket( channel, currentPacketLogicalOffset ) )
          {
-            continue;
+            hungryChannels.push_back( &channel );
          }
+      }
 
+      // Feed the packet's bytestream to a channel's decoder.
+      // Each channel touches only its own decoder and dbuf, so hungry channels
+      // can be processed concurrently.
+      auto feedChannel = [dpkt]( DecodeChannel &channel ) {
          // Get bytestream buffer for this channel from packet
          unsigned int bsbLength = 0;
          const char *bsbStart = dpkt->getBytestream( channel.bytestreamNumber, bsbLength );
@@ -391,6 +969,8 @@ namespace e57
          }
 
          // Feed into decoder
+         E57_TRACE_SPAN_SIZED( "channelDecode", uneatenLength );
+
          const size_t bytesProcessed = channel.decoder->inputProcess( uneatenStart, uneatenLength );
 
 #ifdef E57_VERBOSE
@@ -408,13 +988,43 @@ namespace e57
 
          // Adjust counts of bytestream location
          channel.currentBytestreamBufferIndex += bytesProcessed;
+      };
 
-         // Check if this channel has exhausted its bytestream buffer in this
-         // packet
-         if ( channel.isInputBlocked() )
+      if ( ( pool_ != nullptr ) && ( hungryChannels.size() > 1 ) )
+      {
+         pool_->parallelFor( hungryChannels.size(),
+                             [&]( size_t i ) { feedChannel( *hungryChannels[i] ); } );
+      }
+      else if ( useSharedScheduler_ && ( hungryChannels.size() > 1 ) )
+      {
+         TaskSchedulerImpl::instance().parallelFor(
+            hungryChannels.size(), [&]( size_t i ) { feedChannel( *hungryChannels[i] ); } );
+      }
+      else if ( hungryChannels.size() > 1 )
+      {
+         // Feed the channels round-robin in bounded record blocks, so every
+         // field of a block is written while its destination cache lines are
+         // still hot. With interleaved (AoS) destinations all channels write
+         // into the same lines, and channel-at-a-time passes over a whole
+         // packet's records re-fetch each line once per field.
+         feedChannelsInterleaved( hungryChannels, dpkt );
+      }
+      else
+      {
+         for ( DecodeChannel *channel : hungryChannels )
+         {
+            feedChannel( *channel );
+         }
+      }
+
+      // Check which channels have exhausted their bytestream buffer in this
+      // packet
+      for ( DecodeChannel *channel : hungryChannels )
+      {
+         if ( channel->isInputBlocked() )
          {
 #ifdef E57_VERBOSE
-            std::cout << "  stream[" << channel.bytestreamNumber
+            std::cout << "  stream[" << channel->bytestreamNumber
                       << "] has exhausted its input in current packet" << std::endl;
 #endif
             anyChannelHasExhaustedPacket = true;
@@ -491,6 +1101,89 @@ namespace e57
       }
    }
 
+   void CompressedVectorReaderImpl::feedChannelsInterleaved(
+      std::vector<DecodeChannel *> &hungryChannels, DataPacket *dpkt )
+   {
+      const size_t channelCount = hungryChannels.size();
+
+      // Size the record blocks so one block's output region, which every
+      // channel writes a field of, stays cache resident across the passes
+      const size_t cWindowBytes = 32 * 1024;
+
+      size_t maxRecordStride = 1;
+      for ( DecodeChannel *channel : hungryChannels )
+      {
+         maxRecordStride = std::max( maxRecordStride, channel->dbuf.impl()->stride() );
+      }
+
+      size_t blockRecords = cWindowBytes / maxRecordStride;
+      blockRecords = std::max<size_t>( blockRecords, 256 );
+
+      // Bytes of bytestream input holding roughly one block of records.
+      // Variable width channels (strings) get no slice limit; they make the
+      // interleaving approximate, not incorrect.
+      std::vector<size_t> sliceBytes( channelCount, SIZE_MAX );
+      for ( size_t i = 0; i < channelCount; i++ )
+      {
+         unsigned bits = 0;
+         if ( hungryChannels[i]->decoder->fixedRecordBits( bits ) && bits > 0 )
+         {
+            sliceBytes[i] = std::max<size_t>( ( blockRecords * bits ) / 8, 1 );
+         }
+      }
+
+      // Keep cycling through the channels, a slice each, until none can make
+      // progress (input exhausted, or decoder blocked on full output)
+      bool firstPass = true;
+      bool anyProgress = true;
+      while ( anyProgress || firstPass )
+      {
+         anyProgress = false;
+
+         for ( size_t i = 0; i < channelCount; i++ )
+         {
+            DecodeChannel &channel = *hungryChannels[i];
+
+            // Get bytestream buffer for this channel from packet
+            unsigned int bsbLength = 0;
+            const char *bsbStart = dpkt->getBytestream( channel.bytestreamNumber, bsbLength );
+
+            // Double check we are not off end of buffer
+            if ( channel.currentBytestreamBufferIndex > bsbLength )
+            {
+               throw E57_EXCEPTION2( ErrorInternal, "currentBytestreamBufferIndex =" +
+                                                       toString(
+                                                          channel.currentBytestreamBufferIndex ) +
+                                                       " bsbLength=" + toString( bsbLength ) );
+            }
+
+            const char *uneatenStart = &bsbStart[channel.currentBytestreamBufferIndex];
+            const size_t uneatenLength = bsbLength - channel.currentBytestreamBufferIndex;
+
+            // A zero-length feed still lets a decoder drain queued input, so
+            // every channel is fed at least once
+            if ( uneatenLength == 0 && !firstPass )
+            {
+               continue;
+            }
+
+            const size_t feedLength = std::min( uneatenLength, sliceBytes[i] );
+
+            const size_t bytesProcessed =
+               channel.decoder->inputProcess( uneatenStart, feedLength );
+
+            channel.currentBytestreamBufferIndex += bytesProcessed;
+
+            if ( bytesProcessed > 0 )
+            {
+               anyProgress = true;
+            }
+         }
+
+         firstPass = false;
+      }
+   }
+
    uint64_t CompressedVectorReaderImpl::findNextDataPacket( uint64_t nextPacketLogicalOffset )
    {
 #ifdef E57_VERBOSE
@@ -529,12 +1222,564 @@ namespace e57
       return UINT64_MAX;
    }
 
-   void CompressedVectorReaderImpl::seek( uint64_t /*recordNumber*/ )
+   void CompressedVectorReaderImpl::seek( uint64_t recordNumber )
+   {
+#ifdef E57_VERBOSE
+      std::cout << "CompressedVectorReaderImpl::seek() called, recordNumber=" << recordNumber
+                << std::endl; //???
+#endif
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+      checkReaderOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      // Repositioning fixes the channel layout too (see setFilter), and any
+      // staged survivors belong to the old position
+      filtersLocked_ = true;
+      carryCount_ = 0;
+      carryOffset_ = 0;
+
+      // Synthesized indexes restart from the new position
+      gridNextRecord_ = recordNumber;
+
+      // Allow seeking to one past the last record, so next read() returns 0
+      if ( recordNumber > maxRecordCount_ )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument, "recordNumber=" + toString( recordNumber ) +
+                                                       " recordCount=" +
+                                                       toString( maxRecordCount_ ) );
+      }
+
+      // Every record occupies a fixed number of bits in each bytestream (only
+      // strings are variable width), so the target record starts at bit
+      // recordNumber*bitsPerRecord of each stream. Walk the data packet
+      // headers, accumulating per-stream byte counts, until the byte holding
+      // each stream's target bit is found. Only packet headers are touched;
+      // no records are decoded.
+      const size_t cNumChannels = channels_.size();
+      std::vector<uint64_t> targetBit( cNumChannels );
+      std::vector<uint64_t> streamByteCount( cNumChannels, 0 );
+      std::vector<bool> placed( cNumChannels, false );
+      size_t placedCount = 0;
+
+      for ( size_t i = 0; i < cNumChannels; i++ )
+      {
+         unsigned bits = 0;
+
+         if ( !channels_[i].decoder->fixedRecordBits( bits ) )
+         {
+            // Variable width streams (strings) can't be repositioned without
+            // decoding every record before the target.
+            throw E57_EXCEPTION2( ErrorNotImplemented,
+                                  "pathName=" + channels_[i].dbuf.pathName() );
+         }
+
+         targetBit.at( i ) = recordNumber * bits;
+      }
+
+      uint64_t packetLogicalOffset = findNextDataPacket( dataLogicalOffset_ );
+      const bool cIsFirstPacket = ( packetLogicalOffset != UINT64_MAX );
+
+      while ( placedCount < cNumChannels && packetLogicalOffset != UINT64_MAX )
+      {
+         unsigned packetLength = 0;
+
+         {
+            char *anyPacket = nullptr;
+            std::unique_ptr<PacketLock> packetLock =
+               cache_->lock( packetLogicalOffset, anyPacket );
+
+            auto dpkt = reinterpret_cast<DataPacket *>( anyPacket );
+
+            packetLength = dpkt->header.packetLogicalLengthMinus1 + 1;
+
+            for ( size_t i = 0; i < cNumChannels; i++ )
+            {
+               if ( placed.at( i ) )
+               {
+                  continue;
+               }
+
+               DecodeChannel &channel = channels_[i];
+               const unsigned cBsbLength =
+                  dpkt->getBytestreamBufferLength( channel.bytestreamNumber );
+               const uint64_t cTargetByte = targetBit.at( i ) / 8;
+
+               // Zero-width streams (constant integers) carry no bytes; park
+               // them on the first data packet so read() still drives their
+               // decoder. Other streams are placed when this packet contains
+               // the byte holding the record's first bit.
+               if ( ( targetBit.at( i ) == 0 && cIsFirstPacket ) ||
+                    cTargetByte < streamByteCount.at( i ) + cBsbLength )
+               {
+                  channel.currentPacketLogicalOffset = packetLogicalOffset;
+                  channel.currentBytestreamBufferIndex =
+                     static_cast<unsigned>( cTargetByte - streamByteCount.at( i ) );
+                  channel.currentBytestreamBufferLength = cBsbLength;
+                  channel.inputFinished = false;
+
+                  channel.decoder->seekToRecord(
+                     recordNumber, static_cast<unsigned>( targetBit.at( i ) % 8 ) );
+
+                  placed.at( i ) = true;
+                  placedCount++;
+               }
+               else
+               {
+                  streamByteCount.at( i ) += cBsbLength;
+               }
+            }
+         }
+
+         packetLogicalOffset = findNextDataPacket( packetLogicalOffset + packetLength );
+      }
+
+      // Channels still unplaced were positioned at the very end of the vector
+      // (recordNumber == childCount), so they have no input left to read.
+      for ( size_t i = 0; i < cNumChannels; i++ )
+      {
+         if ( !placed.at( i ) )
+         {
+            DecodeChannel &channel = channels_[i];
+
+            channel.currentBytestreamBufferIndex = 0;
+            channel.currentBytestreamBufferLength = 0;
+            channel.inputFinished = true;
+
+            channel.decoder->seekToRecord( recordNumber, 0 );
+         }
+      }
+   }
+
+   void CompressedVectorReaderImpl::setStride( int64_t stride )
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+      checkReaderOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      if ( stride < 1 )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument, "stride=" + toString( stride ) );
+      }
+
+      // The synthesized index channels have no decoders to stride
+      if ( gridSynthesisActive_ )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                               "setStride() can't be combined with setGridSynthesis()" );
+      }
+
+      // Variable width streams (strings) can't skip records without decoding
+      // them, so striding them would not deliver the expected speedup.
+      for ( auto &channel : channels_ )
+      {
+         unsigned bits = 0;
+
+         if ( !channel.decoder->fixedRecordBits( bits ) )
+         {
+            throw E57_EXCEPTION2( ErrorNotImplemented, "pathName=" + channel.dbuf.pathName() );
+         }
+      }
+
+      for ( auto &channel : channels_ )
+      {
+         channel.decoder->setStride( static_cast<uint64_t>( stride ) );
+      }
+   }
+
+   void CompressedVectorReaderImpl::setRegion( double xMinimum, double xMaximum, double yMinimum,
+                                               double yMaximum, double zMinimum, double zMaximum )
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+      checkReaderOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      if ( xMinimum > xMaximum || yMinimum > yMaximum || zMinimum > zMaximum )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                               "xMinimum=" + toString( xMinimum ) + " xMaximum=" +
+                                  toString( xMaximum ) + " yMinimum=" + toString( yMinimum ) +
+                                  " yMaximum=" + toString( yMaximum ) + " zMinimum=" +
+                                  toString( zMinimum ) + " zMaximum=" + toString( zMaximum ) );
+      }
+
+      // Region reads reposition with seek(), which variable width streams
+      // (strings) don't support.
+      for ( auto &channel : channels_ )
+      {
+         unsigned bits = 0;
+
+         if ( !channel.decoder->fixedRecordBits( bits ) )
+         {
+            throw E57_EXCEPTION2( ErrorNotImplemented, "pathName=" + channel.dbuf.pathName() );
+         }
+      }
+
+      // The synthesized indexes follow the plain record order
+      if ( gridSynthesisActive_ )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                               "setRegion() can't be combined with setGridSynthesis()" );
+      }
+
+      regionRanges_.clear();
+      regionRangeIndex_ = 0;
+      regionPositioned_ = false;
+
+      // Use the "tidx" spatial index stored next to the vector, when there is
+      // one, to keep only the blocks of records whose bounds intersect the
+      // query box. Without an index every record qualifies: the caller still
+      // gets a superset it must filter exactly, just without the skipping.
+      bool haveIndex = false;
+
+      auto parentStruct = std::dynamic_pointer_cast<StructureNodeImpl>( cVector_->parent() );
+
+      const ustring cBlocksPathName = ustring( TILE_INDEX_ELEMENT ) + "/blocks";
+
+      if ( parentStruct && parentStruct->isDefined( cBlocksPathName ) )
+      {
+         auto blob = std::dynamic_pointer_cast<BlobNodeImpl>( parentStruct->get( cBlocksPathName ) );
+
+         if ( blob )
+         {
+            const size_t cBlockCount =
+               static_cast<size_t>( blob->byteCount() ) / sizeof( TileIndexBlock );
+
+            std::vector<TileIndexBlock> blocks( cBlockCount );
+            blob->read( reinterpret_cast<uint8_t *>( blocks.data() ), 0,
+                        cBlockCount * sizeof( TileIndexBlock ) );
+
+            haveIndex = true;
+
+            for ( const TileIndexBlock &block : blocks )
+            {
+               if ( block.minimum[0] > xMaximum || block.maximum[0] < xMinimum ||
+                    block.minimum[1] > yMaximum || block.maximum[1] < yMinimum ||
+                    block.minimum[2] > zMaximum || block.maximum[2] < zMinimum )
+               {
+                  continue;
+               }
+
+               const uint64_t cStart = std::min( block.recordStart, maxRecordCount_ );
+               const uint64_t cEnd =
+                  std::min( block.recordStart + block.recordCount, maxRecordCount_ );
+
+               if ( cStart >= cEnd )
+               {
+                  continue;
+               }
+
+               // Blocks come in record order, so touching ranges can merge
+               if ( !regionRanges_.empty() && regionRanges_.back().second >= cStart )
+               {
+                  regionRanges_.back().second = std::max( regionRanges_.back().second, cEnd );
+               }
+               else
+               {
+                  regionRanges_.emplace_back( cStart, cEnd );
+               }
+            }
+         }
+      }
+
+      if ( !haveIndex )
+      {
+         regionRanges_.emplace_back( 0, maxRecordCount_ );
+      }
+
+      regionActive_ = true;
+   }
+
+   void CompressedVectorReaderImpl::setValidOnly()
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+      checkReaderOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      // Range reads reposition with seek(), which variable width streams
+      // (strings) don't support.
+      for ( auto &channel : channels_ )
+      {
+         unsigned bits = 0;
+
+         if ( !channel.decoder->fixedRecordBits( bits ) )
+         {
+            throw E57_EXCEPTION2( ErrorNotImplemented, "pathName=" + channel.dbuf.pathName() );
+         }
+      }
+
+      // Both range modes own the reader's position
+      if ( regionActive_ )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                               "setValidOnly() can't be combined with setRegion()" );
+      }
+
+      // The synthesized indexes follow the plain record order
+      if ( gridSynthesisActive_ )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                               "setValidOnly() can't be combined with setGridSynthesis()" );
+      }
+
+      regionRanges_.clear();
+      regionRangeIndex_ = 0;
+      regionPositioned_ = false;
+
+      // Use the "vidx" valid-point summary stored next to the vector, when
+      // there is one, to keep only the blocks of records that contain at
+      // least one valid point. Without a summary every record qualifies: the
+      // caller still gets a superset it must filter exactly, just without
+      // the skipping.
+      bool haveIndex = false;
+
+      auto parentStruct = std::dynamic_pointer_cast<StructureNodeImpl>( cVector_->parent() );
+
+      const ustring cBlocksPathName = ustring( VALID_INDEX_ELEMENT ) + "/blocks";
+
+      if ( parentStruct && parentStruct->isDefined( cBlocksPathName ) )
+      {
+         auto blob = std::dynamic_pointer_cast<BlobNodeImpl>( parentStruct->get( cBlocksPathName ) );
+
+         if ( blob )
+         {
+            const size_t cBlockCount =
+               static_cast<size_t>( blob->byteCount() ) / sizeof( ValidIndexBlock );
+
+            std::vector<ValidIndexBlock> blocks( cBlockCount );
+            blob->read( reinterpret_cast<uint8_t *>( blocks.data() ), 0,
+                        cBlockCount * sizeof( ValidIndexBlock ) );
+
+            haveIndex = true;
+
+            for ( const ValidIndexBlock &block : blocks )
+            {
+               if ( block.validCount == 0 )
+               {
+                  continue;
+               }
+
+               const uint64_t cStart = std::min( block.recordStart, maxRecordCount_ );
+               const uint64_t cEnd =
+                  std::min( block.recordStart + block.recordCount, maxRecordCount_ );
+
+               if ( cStart >= cEnd )
+               {
+                  continue;
+               }
+
+               // Blocks come in record order, so touching ranges can merge
+               if ( !regionRanges_.empty() && regionRanges_.back().second >= cStart )
+               {
+                  regionRanges_.back().second = std::max( regionRanges_.back().second, cEnd );
+               }
+               else
+               {
+                  regionRanges_.emplace_back( cStart, cEnd );
+               }
+            }
+         }
+      }
+
+      if ( !haveIndex )
+      {
+         regionRanges_.emplace_back( 0, maxRecordCount_ );
+      }
+
+      regionActive_ = true;
+   }
+
+   void CompressedVectorReaderImpl::setGridSynthesis( int64_t rowMinimum, int64_t columnMinimum,
+                                                      int64_t lineLength, bool byColumn )
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+      checkReaderOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      if ( lineLength < 1 )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument, "lineLength=" + toString( lineLength ) );
+      }
+
+      // The index channels are rebuilt without decoders, which resets their
+      // decode state, so synthesis can only be installed on a fresh reader
+      if ( filtersLocked_ )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                               "setGridSynthesis() must be called before the first read() or "
+                               "seek()" );
+      }
+
+      // The synthesized indexes follow the plain record order; the modes
+      // below deliver records out of that order
+      if ( !filters_.empty() || regionActive_ )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument, "setGridSynthesis() can't be combined with "
+                                                    "setFilter() or setRegion()" );
+      }
+
+      gridSynthesisActive_ = true;
+      gridRowMinimum_ = rowMinimum;
+      gridColumnMinimum_ = columnMinimum;
+      gridLineLength_ = static_cast<uint64_t>( lineLength );
+      gridByColumn_ = byColumn;
+      gridNextRecord_ = 0;
+
+      // Rebuild without the index channels and position the rest at the
+      // first data packet, the same way the constructor does
+      buildChannels();
+
+      if ( channels_.empty() )
+      {
+         // Nothing left to decode would make read() return 0 immediately;
+         // reading only the indexes doesn't need a reader at all.
+         gridSynthesisActive_ = false;
+         buildChannels();
+
+         throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                               "setGridSynthesis() needs at least one decoded field" );
+      }
+
+      {
+         char *anyPacket = nullptr;
+         std::unique_ptr<PacketLock> packetLock = cache_->lock( dataLogicalOffset_, anyPacket );
+
+         auto dpkt = reinterpret_cast<DataPacket *>( anyPacket );
+
+         for ( auto &channel : channels_ )
+         {
+            channel.currentPacketLogicalOffset = dataLogicalOffset_;
+            channel.currentBytestreamBufferIndex = 0;
+            channel.currentBytestreamBufferLength =
+               dpkt->getBytestreamBufferLength( channel.bytestreamNumber );
+         }
+      }
+   }
+
+   /// Fill the rowIndex/columnIndex dest buffers for the outputCount records
+   /// the decoded channels just delivered, computing the indexes from the
+   /// record number instead of decoding them (see setGridSynthesis()).
+   void CompressedVectorReaderImpl::fillSynthesizedIndexes( unsigned outputCount )
+   {
+      for ( auto &dbuf : dbufs_ )
+      {
+         const bool cIsRow = ( dbuf.pathName() == "rowIndex" );
+
+         if ( !cIsRow && dbuf.pathName() != "columnIndex" )
+         {
+            continue;
+         }
+
+         SourceDestBufferImpl *dest = dbuf.impl().get();
+
+         for ( unsigned i = 0; i < outputCount; i++ )
+         {
+            const uint64_t cRecord = gridNextRecord_ + i;
+            const uint64_t cAlong = cRecord % gridLineLength_;  // position within a line
+            const uint64_t cAcross = cRecord / gridLineLength_; // which line
+
+            // When the lines are columns (byColumn), the row index varies
+            // within a line and the column index counts the lines
+            int64_t value = 0;
+
+            if ( cIsRow == gridByColumn_ )
+            {
+               value = ( cIsRow ? gridRowMinimum_ : gridColumnMinimum_ ) +
+                       static_cast<int64_t>( cAlong );
+            }
+            else
+            {
+               value = ( cIsRow ? gridRowMinimum_ : gridColumnMinimum_ ) +
+                       static_cast<int64_t>( cAcross );
+            }
+
+            dest->setNextInt64( value );
+         }
+      }
+
+      gridNextRecord_ += outputCount;
+   }
+
+   void CompressedVectorReaderImpl::setFilter( const ustring &pathName, RecordFilter predicate )
    {
       checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+      checkReaderOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      if ( !predicate )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument, "pathName=" + pathName );
+      }
+
+      // The channels are rebuilt around staging buffers, which resets their
+      // decode state, so filters can only be installed on a fresh reader
+      if ( filtersLocked_ )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                               "setFilter() must be called before the first read() or seek()" );
+      }
+
+      // The filtered path rebuilds every channel around a staging buffer,
+      // which the synthesized index channels don't have
+      if ( gridSynthesisActive_ )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                               "setFilter() can't be combined with setGridSynthesis()" );
+      }
+
+      // Predicates run per record, so they are restricted to the fields that
+      // are cheap to evaluate raw: integers and scaled integers
+      NodeImplSharedPtr filterNode = proto_->get( pathName );
+
+      if ( filterNode->type() != TypeInteger && filterNode->type() != TypeScaledInteger )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument, "pathName=" + pathName );
+      }
 
-      // !!! implement
-      throw E57_EXCEPTION1( ErrorNotImplemented );
+      filters_.push_back( { pathName, std::move( predicate ), 0 } );
+
+      rebuildChannelsForFilters();
+   }
+
+   void CompressedVectorReaderImpl::clearFilters()
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+      checkReaderOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      if ( filtersLocked_ )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                               "clearFilters() must be called before the first read() or seek()" );
+      }
+
+      if ( filters_.empty() )
+      {
+         return;
+      }
+
+      filters_.clear();
+      staging_.clear();
+      carryCount_ = 0;
+      carryOffset_ = 0;
+
+      // Bind the channels back to the caller's buffers
+      buildChannels();
+
+      {
+         char *anyPacket = nullptr;
+         std::unique_ptr<PacketLock> packetLock = cache_->lock( dataLogicalOffset_, anyPacket );
+
+         auto dpkt = reinterpret_cast<DataPacket *>( anyPacket );
+
+         for ( auto &channel : channels_ )
+         {
+            channel.currentPacketLogicalOffset = dataLogicalOffset_;
+            channel.currentBytestreamBufferIndex = 0;
+            channel.currentBytestreamBufferLength =
+               dpkt->getBytestreamBufferLength( channel.bytestreamNumber );
+         }
+      }
+   }
+
+   void CompressedVectorReaderImpl::setProgressCallback( ProgressCallback callback )
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+      checkReaderOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      progressCallback_ = std::move( callback );
    }
 
    bool CompressedVectorReaderImpl::isOpen() const
@@ -567,9 +1812,17 @@ namespace e57
       // Destroy decoders
       channels_.clear();
 
+      if ( cache_ != nullptr )
+      {
+         imf->statsData_.memoryUsedBytes -= cache_->memoryBytes();
+      }
+
       delete cache_;
       cache_ = nullptr;
 
+      delete pool_;
+      pool_ = nullptr;
+
       isOpen_ = false;
    }
 
@@ -32,6 +32,7 @@ namespace e57
 {
    class DataPacket;
    class PacketReadCache;
+   class ThreadPool;
 
    class CompressedVectorReaderImpl
    {
@@ -42,7 +43,17 @@ namespace e57
 
       unsigned read();
       unsigned read( std::vector<SourceDestBuffer> &dbufs );
+      void setBuffers( std::vector<SourceDestBuffer> &dbufs );
       void seek( uint64_t recordNumber );
+      void setStride( int64_t stride );
+      void setRegion( double xMinimum, double xMaximum, double yMinimum, double yMaximum,
+                      double zMinimum, double zMaximum );
+      void setValidOnly();
+      void setGridSynthesis( int64_t rowMinimum, int64_t columnMinimum, int64_t lineLength,
+                             bool byColumn );
+      void setFilter( const ustring &pathName, RecordFilter predicate );
+      void clearFilters();
+      void setProgressCallback( ProgressCallback callback );
       bool isOpen() const;
       std::shared_ptr<CompressedVectorNodeImpl> compressedVectorNode() const;
       void close();
@@ -56,11 +67,21 @@ namespace e57
                                const char *srcFunctionName ) const;
       void checkReaderOpen( const char *srcFileName, int srcLineNumber,
                             const char *srcFunctionName ) const;
-      void setBuffers( std::vector<SourceDestBuffer> &dbufs ); //???needed?
+      void buildChannels();
+      unsigned fillRecords( bool &canceled );
+      bool fillDestBuffers();
       uint64_t earliestPacketNeededForInput() const;
 
+      void rebuildChannelsForFilters();
+      unsigned readFiltered( uint64_t &decodedCount );
+      void compactSurvivors( unsigned stagedCount );
+      void appendSurvivors( size_t offset, size_t count );
+      void fillSynthesizedIndexes( unsigned outputCount );
+
       DataPacket *dataPacket( uint64_t inLogicalOffset ) const;
       void feedPacketToDecoders( uint64_t currentPacketLogicalOffset );
+      void feedChannelsInterleaved( std::vector<DecodeChannel *> &hungryChannels,
+                                    DataPacket *dpkt );
       uint64_t findNextDataPacket( uint64_t nextPacketLogicalOffset );
 
       //??? no default ctor, copy, assignment?
@@ -72,8 +93,80 @@ namespace e57
       std::vector<DecodeChannel> channels_;
       PacketReadCache *cache_;
 
+      // Decodes the per-packet bytestreams of multi-channel records in
+      // parallel. Only set when decode workers are pinned to cores (see
+      // ImageFile::decodeSetPinWorkers); otherwise useSharedScheduler_ sends
+      // the same work to the process-wide TaskSchedulerImpl. Both false/null
+      // when a single thread is enough.
+      ThreadPool *pool_ = nullptr;
+      bool useSharedScheduler_ = false;
+
+      // Region query (setRegion): half-open record ranges that may contain
+      // points inside the query box, in increasing order. read() delivers
+      // only these ranges, seeking over the gaps between them.
+      std::vector<std::pair<uint64_t, uint64_t>> regionRanges_;
+      size_t regionRangeIndex_ = 0;
+      bool regionActive_ = false;
+      bool regionPositioned_ = false;
+
+      // Invoked once per data packet during read(); a false return cancels
+      // the read at the nearest record boundary (see setProgressCallback).
+      ProgressCallback progressCallback_;
+
+      // Predicate pushdown (setFilter): the channels decode raw values into
+      // internal staging buffers, the predicates run on the staged integers
+      // right after bit-unpack, and only the surviving records are converted
+      // and packed densely into the caller's buffers. Rejected records cost
+      // no conversion and no output memory traffic.
+      struct FilterTerm
+      {
+         ustring pathName;
+         RecordFilter predicate;
+         size_t channelIndex = 0; // resolved by rebuildChannelsForFilters()
+      };
+
+      // Raw staging for one channel; which vector is used depends on the
+      // prototype field type. Scale/offset are applied on survivor output
+      // for ScaledInteger fields, matching what the decoder would have done.
+      struct StagingChannel
+      {
+         std::vector<int64_t> intValues;
+         std::vector<float> floatValues;
+         std::vector<double> doubleValues;
+         double scale = 1.0;
+         double offset = 0.0;
+         bool isScaled = false;
+      };
+
+      std::vector<FilterTerm> filters_;
+      std::vector<StagingChannel> staging_; // parallel to channels_ when filtering
+
+      // Filters must be in place before decoding starts; set by read()/seek()
+      bool filtersLocked_ = false;
+
+      // Staged survivors not yet delivered to the caller's buffers
+      size_t carryCount_ = 0;
+      size_t carryOffset_ = 0;
+      std::vector<uint8_t> acceptMask_;
+
+      // Grid synthesis (setGridSynthesis): on gridded scans rowIndex and
+      // columnIndex are fully determined by the record number, so those
+      // channels get no decoders; read() computes the indexes arithmetically
+      // into their dest buffers instead.
+      bool gridSynthesisActive_ = false;
+      int64_t gridRowMinimum_ = 0;
+      int64_t gridColumnMinimum_ = 0;
+      uint64_t gridLineLength_ = 0;
+      bool gridByColumn_ = false;
+      uint64_t gridNextRecord_ = 0; // record number of the next synthesized index
+
       uint64_t recordCount_; /// number of records written so far
       uint64_t maxRecordCount_;
       uint64_t sectionEndLogicalOffset_;
+      uint64_t dataLogicalOffset_; /// start of first data packet
+
+      /// End of the range already dropped from the OS page cache behind the
+      /// scan, in streaming cache mode (see ImageFile::cacheSetStreaming)
+      uint64_t adviseDoneLogicalOffset_ = 0;
    };
 }
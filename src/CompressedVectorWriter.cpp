@@ -124,7 +124,7 @@ throws an exception if the invariant is violated:
 
 /// @cond documentNonPublic The following isn't part of the API, and isn't documented.
 CompressedVectorWriter::CompressedVectorWriter( std::shared_ptr<CompressedVectorWriterImpl> ni ) :
-   impl_( ni )
+   impl_( std::move( ni ) )
 {
 }
 /// @endcond
@@ -253,6 +253,123 @@ void CompressedVectorWriter::write( std::vector<SourceDestBuffer> &sbufs, const
    impl_->write( sbufs, recordCount );
 }
 
+/*!
+@brief Designate new source buffers for subsequent writes, without throwing.
+
+@param [in] sbufs Vector of memory buffers that will be written to the
+CompressedVectorNode.
+
+@details
+This performs the same buffer validation and association as
+CompressedVectorWriter::write(std::vector<SourceDestBuffer>&,size_t) but
+reports failure through the returned ::ErrorCode instead of an E57Exception. It
+is intended to be paired with CompressedVectorWriter::tryWrite: all per-buffer
+validation (path names, capacities, compatibility with previously designated
+buffers) happens here at setup time, so a steady-state write loop needs no
+try/catch machinery.
+
+@pre The associated ImageFile must be open.
+@pre This CompressedVectorWriter must be open (i.e isOpen())
+
+@return ::Success, or the ::ErrorCode of the E57Exception the throwing
+equivalent would have raised.
+
+@see CompressedVectorWriter::tryWrite, CompressedVectorWriter::write(std::vector<SourceDestBuffer>&,size_t)
+*/
+ErrorCode CompressedVectorWriter::trySetBuffers( std::vector<SourceDestBuffer> &sbufs ) noexcept
+{
+   try
+   {
+      impl_->setBuffers( sbufs );
+      return Success;
+   }
+   catch ( E57Exception &ex )
+   {
+      return ex.errorCode();
+   }
+   catch ( ... )
+   {
+      return ErrorInternal;
+   }
+}
+
+/*!
+@brief Request transfer of blocks of data from the previously designated source
+buffers, without throwing.
+
+@param [in] recordCount The number of records to write.
+
+@details
+The non-throwing equivalent of CompressedVectorWriter::write(size_t). The
+SourceDestBuffers are those designated in CompressedVectorNode::writer, in
+CompressedVectorWriter::trySetBuffers, or in the last call to
+CompressedVectorWriter::write(std::vector<SourceDestBuffer>&,size_t).
+
+On failure the same state caveats apply as for write(): after a conversion or
+bounds error the CompressedVectorWriter is in an undocumented state, and after
+a file I/O error so is the associated ImageFile.
+
+@pre The associated ImageFile must be open.
+@pre This CompressedVectorWriter must be open (i.e isOpen())
+
+@return ::Success, or the ::ErrorCode of the E57Exception the throwing
+equivalent would have raised.
+
+@see CompressedVectorWriter::write(size_t), CompressedVectorWriter::trySetBuffers
+*/
+ErrorCode CompressedVectorWriter::tryWrite( const size_t recordCount ) noexcept
+{
+   try
+   {
+      impl_->write( recordCount );
+      return Success;
+   }
+   catch ( E57Exception &ex )
+   {
+      return ex.errorCode();
+   }
+   catch ( ... )
+   {
+      return ErrorInternal;
+   }
+}
+
+/*!
+@brief Set a function called periodically during write, which can cancel it.
+
+@param [in] callback Function invoked once per data packet written, or an
+empty std::function to remove a previously set callback.
+
+@details
+The given @a callback is invoked from inside CompressedVectorWriter::write each
+time a data packet (~64KB of compressed data) is sent to the file, with the
+number of records encoded since the start of the CompressedVectorNode and the
+number of bytes written to the binary section so far, so a caller can drive a
+progress display at negligible cost.
+
+If the callback returns false the write is canceled: write() stops encoding at
+the next packet boundary and throws ::ErrorTransferCanceled (which
+CompressedVectorWriter::tryWrite returns instead). Records from the canceled
+call are not counted in the CompressedVectorNode. The only valid operation on
+the CompressedVectorWriter afterwards is CompressedVectorWriter::close, which
+still produces a valid file containing the records from all completed write()
+calls.
+
+The callback must not call back into this CompressedVectorWriter.
+
+@pre The associated ImageFile must be open.
+@pre This CompressedVectorWriter must be open (i.e isOpen())
+
+@throw ::ErrorImageFileNotOpen
+@throw ::ErrorWriterNotOpen
+
+@see CompressedVectorWriter::write(size_t), CompressedVectorReader::setProgressCallback
+*/
+void CompressedVectorWriter::setProgressCallback( ProgressCallback callback )
+{
+   impl_->setProgressCallback( std::move( callback ) );
+}
+
 /*!
 @brief End the write operation.
 
@@ -283,6 +400,45 @@ void CompressedVectorWriter::close()
    impl_->close();
 }
 
+/*!
+@brief Make the records written so far durable without closing the writer.
+
+@details
+Flushes the completed packet bytes to the file, writes a provisional binary section header, and has
+the associated ImageFile write a provisional XML snapshot and file header (see
+ImageFile::checkpoint). If the process crashes afterwards, the file on disk is a readable E57 file
+containing every previously completed section and the records of this CompressedVectorNode whose
+bits were entirely flushed at the checkpoint. Records still buffered in the encoders (at most a few
+per field) stay pending until the next checkpoint or CompressedVectorWriter::close. When any field
+has a variable record width (strings), the in-progress vector appears empty in the snapshot;
+completed sections are still covered.
+
+A snapshot also lets another process start reading completed data while this writer keeps going.
+Note that the snapshot is written in what is still free space, so it remains valid only until this
+writer resumes writing; checkpoint periodically, and treat a snapshot as superseded as soon as more
+data is written.
+
+Writing continues normally after this call. CompressedVectorWriter::close supersedes the snapshot
+with the final section header and XML section.
+
+@pre The associated ImageFile must be open.
+@pre This CompressedVectorWriter must be open (i.e isOpen())
+
+@throw ::ErrorImageFileNotOpen
+@throw ::ErrorWriterNotOpen
+@throw ::ErrorSeekFailed This CompressedVectorWriter, associated ImageFile in undocumented state
+@throw ::ErrorReadFailed  This CompressedVectorWriter, associated ImageFile in undocumented state
+@throw ::ErrorWriteFailed This CompressedVectorWriter, associated ImageFile in undocumented state
+@throw ::ErrorBadChecksum This CompressedVectorWriter, associated ImageFile in undocumented state
+@throw ::ErrorInternal All objects in undocumented state
+
+@see ImageFile::checkpoint, CompressedVectorWriter::close
+*/
+void CompressedVectorWriter::checkpoint()
+{
+   impl_->checkpoint();
+}
+
 /*!
 @brief Test whether CompressedVectorWriter is still open for writing.
 
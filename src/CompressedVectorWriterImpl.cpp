@@ -25,16 +25,27 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <numeric>
 
+#include "BlobNodeImpl.h"
 #include "CheckedFile.h"
 #include "CompressedVectorNodeImpl.h"
 #include "CompressedVectorWriterImpl.h"
 #include "ImageFileImpl.h"
+#include "IntegerNodeImpl.h"
+#include "ScaledIntegerNodeImpl.h"
 #include "SectionHeaders.h"
 #include "SourceDestBufferImpl.h"
+#include "StreamCompression.h"
 #include "StringFunctions.h"
+#include "StringNodeImpl.h"
+#include "StructureNodeImpl.h"
+#include "TaskSchedulerImpl.h"
+#include "TraceImpl.h"
+#include "VectorNodeImpl.h"
 
 namespace e57
 {
@@ -109,8 +120,49 @@ namespace e57
       }
 #endif
 
+      // The seek index needs each stream's exact record width; disable it if
+      // any stream is variable width (strings).
+      streamFixedBits_.resize( bytestreams_.size(), 0 );
+      streamBitsWritten_.assign( bytestreams_.size(), 0 );
+      for ( unsigned i = 0; i < bytestreams_.size(); i++ )
+      {
+         seekIndexValid_ =
+            seekIndexValid_ && bytestreams_.at( i )->fixedRecordBits( streamFixedBits_.at( i ) );
+      }
+
       ImageFileImplSharedPtr imf( ni->destImageFile_ );
 
+      // Collect the optional "tidx" spatial index only when the file has the
+      // extension prefix registered and the prototype carries cartesian
+      // coordinates.
+      {
+         ustring uri;
+         tileIndexEnabled_ = imf->extensionsLookupPrefix( TILE_INDEX_PREFIX, uri ) &&
+                             proto_->isDefined( "cartesianX" ) &&
+                             proto_->isDefined( "cartesianY" ) && proto_->isDefined( "cartesianZ" );
+      }
+
+      // Collect the optional "vidx" valid-point summary only when the file
+      // has the extension prefix registered and the prototype says which
+      // points are invalid.
+      {
+         ustring uri;
+
+         if ( imf->extensionsLookupPrefix( VALID_INDEX_PREFIX, uri ) )
+         {
+            if ( proto_->isDefined( "cartesianInvalidState" ) )
+            {
+               validIndexEnabled_ = true;
+               validIndexPathName_ = "cartesianInvalidState";
+            }
+            else if ( proto_->isDefined( "sphericalInvalidState" ) )
+            {
+               validIndexEnabled_ = true;
+               validIndexPathName_ = "sphericalInvalidState";
+            }
+         }
+      }
+
       // Reserve space for CompressedVector binary section header, record location
       // so can save to when writer closes. Request that file be extended with
       // zeros since we will write to it at a later time (when writer closes).
@@ -149,6 +201,16 @@ namespace e57
       {
          //??? report?
       }
+
+      // Never leave the flush thread running, even if close() failed part way
+      try
+      {
+         stopPacketFlushThread();
+      }
+      catch ( ... )
+      {
+         //??? report?
+      }
    }
 
    void CompressedVectorWriterImpl::close()
@@ -161,6 +223,13 @@ namespace e57
       // Before anything that can throw, decrement writer count
       imf->decrWriterCount();
 
+      // A spill writer counts against the main file too (see
+      // CompressedVectorNodeImpl::writer)
+      if ( transplantTarget_ != nullptr )
+      {
+         transplantTarget_->destImageFile()->decrWriterCount();
+      }
+
       checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
       // don't call checkWriterOpen();
 
@@ -184,6 +253,12 @@ namespace e57
          flush();
       }
 
+      // Wait for the last packet to land before touching the file below
+      stopPacketFlushThread();
+
+      // Write the seek index packets (if any) at the end of the section
+      writeSeekIndex();
+
       // Compute length of whole section we just wrote (from section start to
       // current start of free space).
       sectionLogicalLength_ = imf->unusedLogicalStart_ - sectionHeaderLogicalStart_;
@@ -217,6 +292,24 @@ namespace e57
       cVector_->setRecordCount( recordCount_ );
       cVector_->setBinarySectionLogicalStart( sectionHeaderLogicalStart_ );
 
+      // Emit the collected tile index and valid-point summary, if any. Must
+      // happen after the binary section above is finalized, so the index
+      // blobs' sections don't land inside it.
+      tileIndexWrite();
+      validIndexWrite();
+
+      // A spill writer's section is now complete in the spill file. Park it
+      // with the main file, which transplants it (rawCopySectionTo) when its
+      // own close() runs and no other section can still be growing.
+      if ( transplantTarget_ != nullptr )
+      {
+         transplantTarget_->destImageFile()->queueSectionTransplant( imf, cVector_,
+                                                                     transplantTarget_ );
+
+         // The queue entry keeps the spill file alive from here
+         spillImf_.reset();
+      }
+
       // Free channels
       bytestreams_.clear();
 
@@ -226,6 +319,70 @@ namespace e57
 #endif
    }
 
+   void CompressedVectorWriterImpl::checkpoint()
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+      checkWriterOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      ImageFileImplSharedPtr imf( cVector_->destImageFile_ );
+
+      // Write out the whole bytes the encoders have completed. The partial
+      // words still in the encoder registers are deliberately NOT flushed:
+      // padding them mid-stream (as close() does at the true end) would
+      // corrupt the bitstream the decoders see in the final file. The records
+      // they hold stay pending until the next checkpoint() or close().
+      while ( totalOutputAvailable() > 0 )
+      {
+         packetWrite();
+      }
+
+      // Wait for the last packet to land before writing behind it
+      stopPacketFlushThread();
+
+      // The snapshot only advertises records whose bits are completely
+      // contained in the flushed packets. When any stream is variable width
+      // (strings) that count can't be bounded, so the in-progress vector
+      // appears empty in the snapshot; completed sections are still covered.
+      uint64_t safeRecordCount = 0;
+
+      if ( seekIndexValid_ )
+      {
+         safeRecordCount = recordCount_;
+
+         for ( unsigned i = 0; i < bytestreams_.size(); i++ )
+         {
+            const uint64_t cBits = streamFixedBits_.at( i );
+
+            if ( cBits > 0 )
+            {
+               safeRecordCount = std::min( safeRecordCount, streamBitsWritten_.at( i ) / cBits );
+            }
+         }
+      }
+
+      // Provisional section header covering what is on disk now; close()
+      // rewrites it with the final values. No seek index yet, that is only
+      // written when the section is complete.
+      CompressedVectorSectionHeader header;
+      header.sectionLogicalLength = imf->unusedLogicalStart_ - sectionHeaderLogicalStart_;
+      header.dataPhysicalOffset = dataPhysicalOffset_;
+      header.indexPhysicalOffset = 0;
+
+#if VALIDATE_BASIC
+      // Verify OK before write it.
+      header.verify( imf->file_->length( CheckedFile::Physical ) );
+#endif
+
+      imf->file_->seek( sectionHeaderLogicalStart_ );
+      imf->file_->write( reinterpret_cast<char *>( &header ), sizeof( header ) );
+
+      // Provisional node state for the XML snapshot; close() supersedes it
+      cVector_->setRecordCount( safeRecordCount );
+      cVector_->setBinarySectionLogicalStart( sectionHeaderLogicalStart_ );
+
+      imf->checkpoint();
+   }
+
    bool CompressedVectorWriterImpl::isOpen() const
    {
       // don't checkImageFileOpen(__FILE__, __LINE__, __FUNCTION__), or
@@ -272,6 +429,29 @@ namespace e57
       sbufs_ = sbufs;
    }
 
+   void CompressedVectorWriterImpl::setSectionTransplant(
+      const std::shared_ptr<CompressedVectorNodeImpl> &target )
+   {
+      transplantTarget_ = target;
+
+      // Keep the spill file alive while this writer fills it
+      spillImf_ = cVector_->destImageFile();
+
+      // The optional sidecar blobs would land in the spill file and be
+      // discarded with it; only a writer appending to the main file
+      // directly can emit them
+      tileIndexEnabled_ = false;
+      validIndexEnabled_ = false;
+   }
+
+   void CompressedVectorWriterImpl::setProgressCallback( ProgressCallback callback )
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+      checkWriterOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      progressCallback_ = std::move( callback );
+   }
+
    void CompressedVectorWriterImpl::write( std::vector<SourceDestBuffer> &sbufs,
                                            const size_t requestedRecordCount )
    {
@@ -306,6 +486,34 @@ namespace e57
          sbuf.impl()->rewind();
       }
 
+      // Take cartesian bounds of this batch for the tile index before the
+      // encoders consume the buffers
+      if ( tileIndexEnabled_ )
+      {
+         tileIndexTrack( requestedRecordCount );
+      }
+
+      // Count the valid points of this batch for the valid-point summary,
+      // also before the encoders consume the buffers
+      if ( validIndexEnabled_ )
+      {
+         validIndexTrack( requestedRecordCount );
+      }
+
+      // The first batch is the only chance to pick per-stream codecs: once a
+      // record has been encoded the stream formats are committed.
+      if ( !codecsAdapted_ )
+      {
+         adaptCodecs( requestedRecordCount );
+         codecsAdapted_ = true;
+      }
+
+      // Parallel encoding pays off only with several streams and several
+      // cores; the shared scheduler supplies the threads (see
+      // TaskSchedulerImpl)
+      encodeParallel_ =
+         std::min<size_t>( std::thread::hardware_concurrency(), bytestreams_.size() ) >= 2;
+
       // Loop until all channels have completed requestedRecordCount transfers
       uint64_t endRecordIndex = recordCount_ + requestedRecordCount;
       while ( true )
@@ -349,6 +557,33 @@ namespace e57
          if ( currentPacketSize() >= E57_TARGET_PACKET_SIZE )
          { //???
             packetWrite();
+
+            if ( progressCallback_ )
+            {
+               // Report the record every stream has finished encoding and how
+               // many bytes the binary section holds so far.
+               uint64_t recordsCompleted = UINT64_MAX;
+               for ( auto &bytestream : bytestreams_ )
+               {
+                  recordsCompleted = std::min( recordsCompleted, bytestream->currentRecordIndex() );
+               }
+
+               ImageFileImplSharedPtr imf( cVector_->destImageFile_ );
+
+               if ( !progressCallback_( recordsCompleted, imf->unusedLogicalStart_ -
+                                                             sectionHeaderLogicalStart_ ) )
+               {
+                  // Stop encoding at this packet boundary. The records of this
+                  // write() call are not counted in recordCount_, and the only
+                  // valid operation afterwards is close(), which still
+                  // produces a valid file with the records of the completed
+                  // write() calls.
+                  throw E57_EXCEPTION2( ErrorTransferCanceled,
+                                        "imageFileName=" + cVector_->imageFileName() +
+                                           " cvPathName=" + cVector_->pathName() );
+               }
+            }
+
             continue; // restart loop so recalc statistics (packet size may not be
                       // zero after write, if have too much data)
          }
@@ -372,23 +607,23 @@ namespace e57
          // Don't allow a single channel to get too far ahead ???
          // Process channels that are furthest behind first. ???
 
-         // !!!! For now just process one record per loop until packet is full
-         // enough, or completed request
-         for ( auto &bytestream : bytestreams_ )
-         {
-            if ( bytestream->currentRecordIndex() < endRecordIndex )
-            {
-               // !!! For now, process up to 50 records at a time
-               uint64_t recordCount = endRecordIndex - bytestream->currentRecordIndex();
-               recordCount =
-                  ( recordCount < 50ULL ) ? recordCount : 50ULL; // min(recordCount, 50ULL);
-               bytestream->processRecords( static_cast<unsigned>( recordCount ) );
-            }
-         }
+         // Encode the next batch of records in every stream, on the worker
+         // pool when one is running
+         processStreams( endRecordIndex );
       }
 
       recordCount_ += requestedRecordCount;
 
+      {
+         ImageFileImplSharedPtr imf( cVector_->destImageFile_ );
+         ImageFileStatsData *stats = imf->statsData();
+
+         if ( stats != nullptr )
+         {
+            stats->recordsEncoded += requestedRecordCount;
+         }
+      }
+
       // When we leave this function, will likely still have data in channel
       // ioBuffers as well as partial words in Encoder registers.
    }
@@ -425,6 +660,8 @@ namespace e57
          return ( 0 );
       }
 
+      E57_TRACE_SPAN_SIZED( "packetWrite", cTotalOutput );
+
       // const bytestreams_ so it's clear it isn't modified in this function
       const auto &cStreams = bytestreams_;
       const auto cNumByteStreams = cStreams.size();
@@ -580,12 +817,31 @@ namespace e57
       // Double check that data packet is well formed
       dataPacket_.verify( packetLength );
 
-      // Write whole data packet at beginning of free space in file
+      // Write whole data packet at beginning of free space in file.
+      // allocateSpace() with doExtendNow=false only adjusts bookkeeping, so it
+      // is safe while the flush thread is writing the previous packet.
       uint64_t packetLogicalOffset = imf->allocateSpace( packetLength, false );
       uint64_t packetPhysicalOffset = imf->file_->logicalToPhysical( packetLogicalOffset );
-      imf->file_->seek( packetLogicalOffset ); //??? have seekLogical and seekPhysical instead?
-                                               // more explicit
-      imf->file_->write( packet, packetLength );
+
+      // Hand the completed packet over to the flush thread and keep encoding
+      if ( !packetFlushThread_.joinable() )
+      {
+         packetFlushThread_ = std::thread( &CompressedVectorWriterImpl::packetFlushLoop, this );
+      }
+
+      waitForPacketFlush();
+
+      {
+         std::lock_guard<std::mutex> lock( packetFlushMutex_ );
+
+         memcpy( reinterpret_cast<char *>( &flushPacket_ ), packet, packetLength );
+
+         flushLogicalOffset_ = packetLogicalOffset;
+         flushPacketLength_ = packetLength;
+         flushPending_ = true;
+      }
+
+      packetFlushWake_.notify_one();
 
 #ifdef E57_VERBOSE
 //  std::cout << "data packet:" << std::endl;
@@ -604,12 +860,511 @@ namespace e57
       }
       dataPacketsCount_++;
 
-      // !!! update seekIndex here? if started new chunk?
+      // Remember where this packet's records begin, for the seek index. The
+      // first record that starts in this packet (or later) is the smallest one
+      // whose bits haven't all been written yet in any stream.
+      if ( seekIndexValid_ )
+      {
+         uint64_t chunkRecordNumber = 0;
+
+         for ( unsigned i = 0; i < cNumByteStreams; ++i )
+         {
+            const uint64_t cBits = streamFixedBits_.at( i );
+
+            if ( cBits > 0 )
+            {
+               const uint64_t cFirstNewRecord = ( streamBitsWritten_.at( i ) + cBits - 1 ) / cBits;
+
+               chunkRecordNumber = std::max( chunkRecordNumber, cFirstNewRecord );
+            }
+
+            streamBitsWritten_.at( i ) += 8 * static_cast<uint64_t>( count.at( i ) );
+         }
+
+         // Only start a new chunk if this packet begins a new record
+         if ( seekIndex_.empty() || chunkRecordNumber > seekIndex_.back().chunkRecordNumber )
+         {
+            IndexPacket::IndexPacketEntry entry;
+
+            entry.chunkRecordNumber = chunkRecordNumber;
+            entry.chunkPhysicalOffset = packetPhysicalOffset;
+
+            seekIndex_.push_back( entry );
+         }
+      }
 
       // Return physical offset of data packet for potential use in seekIndex
       return ( packetPhysicalOffset ); //??? needed
    }
 
+   /// Write the accumulated seek index at the end of the binary section, as a
+   /// tree of E57 index packets (bottom level addresses data packets, upper
+   /// levels address the index packets below them). Sets
+   /// topIndexPhysicalOffset_, which close() records in the section header.
+   void CompressedVectorWriterImpl::writeSeekIndex()
+   {
+      if ( !seekIndexValid_ || seekIndex_.empty() )
+      {
+         return;
+      }
+
+      // Entries were computed before the final record count was known, so
+      // drop any that point past the end of the vector.
+      while ( !seekIndex_.empty() && seekIndex_.back().chunkRecordNumber >= recordCount_ )
+      {
+         seekIndex_.pop_back();
+      }
+
+      ImageFileImplSharedPtr imf( cVector_->destImageFile_ );
+
+      std::vector<IndexPacket::IndexPacketEntry> level = seekIndex_;
+      unsigned indexLevel = 0;
+
+      while ( !level.empty() )
+      {
+         std::vector<IndexPacket::IndexPacketEntry> parents;
+
+         for ( size_t first = 0; first < level.size(); first += IndexPacket::MAX_ENTRIES )
+         {
+            const size_t cEntryCount =
+               std::min<size_t>( level.size() - first, IndexPacket::MAX_ENTRIES );
+
+            IndexPacket pkt;
+
+            pkt.entryCount = static_cast<uint16_t>( cEntryCount );
+            pkt.indexLevel = static_cast<uint8_t>( indexLevel );
+
+            for ( size_t i = 0; i < cEntryCount; ++i )
+            {
+               pkt.entries[i] = level.at( first + i );
+            }
+
+            const auto cPacketLength = static_cast<unsigned>(
+               sizeof( IndexPacket ) - sizeof( pkt.entries ) +
+               cEntryCount * sizeof( IndexPacket::IndexPacketEntry ) );
+
+            pkt.packetLogicalLengthMinus1 = static_cast<uint16_t>( cPacketLength - 1 );
+
+#if VALIDATE_BASIC
+            // Double check that index packet is well formed
+            pkt.verify( cPacketLength );
+#endif
+
+            const uint64_t cPacketLogicalOffset = imf->allocateSpace( cPacketLength, false );
+
+            imf->file_->seek( cPacketLogicalOffset );
+            imf->file_->write( reinterpret_cast<char *>( &pkt ), cPacketLength );
+
+            topIndexPhysicalOffset_ = imf->file_->logicalToPhysical( cPacketLogicalOffset );
+            indexPacketsCount_++;
+
+            IndexPacket::IndexPacketEntry parent;
+
+            parent.chunkRecordNumber = level.at( first ).chunkRecordNumber;
+            parent.chunkPhysicalOffset = topIndexPhysicalOffset_;
+
+            parents.push_back( parent );
+         }
+
+         // A single packet at this level is the top of the index
+         if ( parents.size() <= 1 )
+         {
+            break;
+         }
+
+         level = std::move( parents );
+         indexLevel++;
+      }
+   }
+
+   // Accumulate the cartesian bounds of the records about to be encoded into
+   // fixed-size blocks of the tile index. Scaled integer prototypes need raw
+   // source values mapped back to world coordinates, unless the caller
+   // already works in scaled space (doScaling).
+   void CompressedVectorWriterImpl::tileIndexTrack( const size_t recordCount )
+   {
+      static const char *const cCartesianNames[3] = { "cartesianX", "cartesianY", "cartesianZ" };
+
+      std::shared_ptr<SourceDestBufferImpl> coords[3];
+      double scales[3] = { 1.0, 1.0, 1.0 };
+      double offsets[3] = { 0.0, 0.0, 0.0 };
+
+      for ( unsigned axis = 0; axis < 3; axis++ )
+      {
+         for ( auto &sbuf : sbufs_ )
+         {
+            if ( sbuf.pathName() == cCartesianNames[axis] )
+            {
+               coords[axis] = sbuf.impl();
+               break;
+            }
+         }
+
+         // Shouldn't happen, setBuffers() requires every prototype field
+         if ( !coords[axis] )
+         {
+            tileIndexEnabled_ = false;
+            return;
+         }
+
+         auto scaledNode = std::dynamic_pointer_cast<ScaledIntegerNodeImpl>(
+            proto_->get( cCartesianNames[axis] ) );
+
+         if ( scaledNode && !coords[axis]->doScaling() )
+         {
+            scales[axis] = scaledNode->scale();
+            offsets[axis] = scaledNode->offset();
+         }
+      }
+
+      for ( size_t i = 0; i < recordCount; i++ )
+      {
+         double value[3];
+
+         for ( unsigned axis = 0; axis < 3; axis++ )
+         {
+            value[axis] = coords[axis]->valueAsDouble( i ) * scales[axis] + offsets[axis];
+         }
+
+         if ( tileIndexCurrent_.recordCount == 0 )
+         {
+            tileIndexCurrent_.recordStart = recordCount_ + i;
+
+            for ( unsigned axis = 0; axis < 3; axis++ )
+            {
+               tileIndexCurrent_.minimum[axis] = value[axis];
+               tileIndexCurrent_.maximum[axis] = value[axis];
+            }
+         }
+         else
+         {
+            for ( unsigned axis = 0; axis < 3; axis++ )
+            {
+               tileIndexCurrent_.minimum[axis] =
+                  std::min( tileIndexCurrent_.minimum[axis], value[axis] );
+               tileIndexCurrent_.maximum[axis] =
+                  std::max( tileIndexCurrent_.maximum[axis], value[axis] );
+            }
+         }
+
+         if ( ++tileIndexCurrent_.recordCount == TILE_INDEX_BLOCK_RECORDS )
+         {
+            tileIndexBlocks_.push_back( tileIndexCurrent_ );
+            tileIndexCurrent_.recordCount = 0;
+         }
+      }
+   }
+
+   // Store the collected tile index blocks as a blob under a "tidx:tileIndex"
+   // structure next to the vector, where setRegion() expects to find them.
+   void CompressedVectorWriterImpl::tileIndexWrite()
+   {
+      if ( !tileIndexEnabled_ )
+      {
+         return;
+      }
+
+      if ( tileIndexCurrent_.recordCount > 0 )
+      {
+         tileIndexBlocks_.push_back( tileIndexCurrent_ );
+         tileIndexCurrent_.recordCount = 0;
+      }
+
+      if ( tileIndexBlocks_.empty() )
+      {
+         return;
+      }
+
+      // The index hangs off the vector's parent structure (the scan). Nodes
+      // are set-once, so a parent that already has one keeps it.
+      auto parentStruct = std::dynamic_pointer_cast<StructureNodeImpl>( cVector_->parent() );
+      if ( !parentStruct || parentStruct->isDefined( TILE_INDEX_ELEMENT ) )
+      {
+         return;
+      }
+
+      ImageFileImplSharedPtr imf( cVector_->destImageFile_ );
+
+      const size_t cByteCount = tileIndexBlocks_.size() * sizeof( TileIndexBlock );
+
+      std::shared_ptr<BlobNodeImpl> blob(
+         new BlobNodeImpl( imf, static_cast<int64_t>( cByteCount ) ) );
+      blob->write( reinterpret_cast<uint8_t *>( tileIndexBlocks_.data() ), 0, cByteCount );
+
+      std::shared_ptr<StructureNodeImpl> index( new StructureNodeImpl( imf ) );
+      index->set( "blocks", blob );
+
+      parentStruct->set( TILE_INDEX_ELEMENT, index );
+   }
+
+   // Count the records about to be encoded whose invalid-state field is 0
+   // (fully valid) into fixed-size blocks of the valid-point summary.
+   void CompressedVectorWriterImpl::validIndexTrack( const size_t recordCount )
+   {
+      std::shared_ptr<SourceDestBufferImpl> states;
+
+      for ( auto &sbuf : sbufs_ )
+      {
+         if ( sbuf.pathName() == validIndexPathName_ )
+         {
+            states = sbuf.impl();
+            break;
+         }
+      }
+
+      // Shouldn't happen, setBuffers() requires every prototype field
+      if ( !states )
+      {
+         validIndexEnabled_ = false;
+         return;
+      }
+
+      for ( size_t i = 0; i < recordCount; i++ )
+      {
+         if ( validIndexCurrent_.recordCount == 0 )
+         {
+            validIndexCurrent_.recordStart = recordCount_ + i;
+            validIndexCurrent_.validCount = 0;
+         }
+
+         if ( states->valueAsDouble( i ) == 0.0 )
+         {
+            validIndexCurrent_.validCount++;
+         }
+
+         if ( ++validIndexCurrent_.recordCount == VALID_INDEX_BLOCK_RECORDS )
+         {
+            validIndexBlocks_.push_back( validIndexCurrent_ );
+            validIndexCurrent_.recordCount = 0;
+         }
+      }
+   }
+
+   // Store the collected valid-point summary as a blob of blocks plus the
+   // total valid count under a "vidx:validIndex" structure next to the
+   // vector, where setValidOnly() and validRecordCount() expect to find it.
+   void CompressedVectorWriterImpl::validIndexWrite()
+   {
+      if ( !validIndexEnabled_ )
+      {
+         return;
+      }
+
+      if ( validIndexCurrent_.recordCount > 0 )
+      {
+         validIndexBlocks_.push_back( validIndexCurrent_ );
+         validIndexCurrent_.recordCount = 0;
+      }
+
+      if ( validIndexBlocks_.empty() )
+      {
+         return;
+      }
+
+      // The summary hangs off the vector's parent structure (the scan).
+      // Nodes are set-once, so a parent that already has one keeps it.
+      auto parentStruct = std::dynamic_pointer_cast<StructureNodeImpl>( cVector_->parent() );
+      if ( !parentStruct || parentStruct->isDefined( VALID_INDEX_ELEMENT ) )
+      {
+         return;
+      }
+
+      ImageFileImplSharedPtr imf( cVector_->destImageFile_ );
+
+      uint64_t totalValidCount = 0;
+      for ( const ValidIndexBlock &block : validIndexBlocks_ )
+      {
+         totalValidCount += block.validCount;
+      }
+
+      const size_t cByteCount = validIndexBlocks_.size() * sizeof( ValidIndexBlock );
+
+      std::shared_ptr<BlobNodeImpl> blob(
+         new BlobNodeImpl( imf, static_cast<int64_t>( cByteCount ) ) );
+      blob->write( reinterpret_cast<uint8_t *>( validIndexBlocks_.data() ), 0, cByteCount );
+
+      std::shared_ptr<StructureNodeImpl> index( new StructureNodeImpl( imf ) );
+      index->set( "blocks", blob );
+      index->set( "validCount",
+                  std::make_shared<IntegerNodeImpl>( imf, static_cast<int64_t>( totalValidCount ),
+                                                     0, static_cast<int64_t>( recordCount_ ) ) );
+
+      parentStruct->set( VALID_INDEX_ELEMENT, index );
+   }
+
+   // Decide from the first batch whether any integer stream should be
+   // written with the "dlta" delta codec instead of plain bitpacking. A
+   // bitpacked stream's width is fixed by the prototype bounds, so an
+   // all-zero or slowly varying channel still costs its worst-case bits per
+   // record; delta blocks track the data instead, and a constant channel
+   // costs almost nothing. Adapting is only legal before the first record
+   // is encoded, and only when the file has the extension prefix registered
+   // - the choice is recorded in the codecs vector, where readers negotiate
+   // the decoder (see streamDeltaRequested()).
+   void CompressedVectorWriterImpl::adaptCodecs( const size_t recordCount )
+   {
+      // A spill writer can't adapt: the codec choice would have to be
+      // recorded in the main tree's codecs vector, which stays as the
+      // caller built it
+      if ( transplantTarget_ != nullptr )
+      {
+         return;
+      }
+
+      ImageFileImplSharedPtr imf( cVector_->destImageFile_ );
+
+      ustring uri;
+      if ( !imf->extensionsLookupPrefix( DELTA_STREAM_PREFIX, uri ) || ( recordCount < 2 ) )
+      {
+         return;
+      }
+
+      std::shared_ptr<VectorNodeImpl> codecs = cVector_->getCodecs();
+      if ( !codecs )
+      {
+         return;
+      }
+
+      // Per-record cost of the delta block headers
+      const double cHeaderBits =
+         ( DELTA_STREAM_HEADER_SIZE * 8.0 ) / static_cast<double>( DELTA_STREAM_BLOCK_RECORDS );
+
+      std::vector<ustring> adopted;
+
+      for ( auto &sbuf : sbufs_ )
+      {
+         const ustring cPathName = sbuf.pathName();
+         NodeImplSharedPtr field = proto_->get( cPathName );
+
+         int64_t minimum = 0;
+         int64_t maximum = 0;
+         double unitsPerRaw = 1.0; // memory units per raw integer step
+
+         switch ( field->type() )
+         {
+            case TypeInteger:
+            {
+               auto integer = std::static_pointer_cast<IntegerNodeImpl>( field );
+               minimum = integer->minimum();
+               maximum = integer->maximum();
+               break;
+            }
+            case TypeScaledInteger:
+            {
+               auto scaled = std::static_pointer_cast<ScaledIntegerNodeImpl>( field );
+               minimum = scaled->minimum();
+               maximum = scaled->maximum();
+               if ( sbuf.impl()->doScaling() )
+               {
+                  unitsPerRaw = scaled->scale();
+               }
+               break;
+            }
+            default:
+               continue;
+         }
+
+         const unsigned cAbsoluteBits = ImageFileImpl::bitsNeeded( minimum, maximum );
+
+         // Zero-width streams have no bytestream content to shrink, and an
+         // explicit codecs entry is the caller's choice to keep
+         if ( ( cAbsoluteBits == 0 ) || streamDeltaRequested( cVector_.get(), cPathName ) )
+         {
+            continue;
+         }
+
+         // Estimate the mean zigzag delta width over (a prefix of) the batch
+         const size_t cSampleCount = std::min<size_t>( recordCount, 4096 );
+         std::shared_ptr<SourceDestBufferImpl> values = sbuf.impl();
+
+         double totalBits = 0.;
+         double previous = values->valueAsDouble( 0 );
+
+         for ( size_t i = 1; i < cSampleCount; i++ )
+         {
+            const double cValue = values->valueAsDouble( i );
+            const double cDelta = std::fabs( cValue - previous ) / unitsPerRaw;
+
+            previous = cValue;
+
+            const auto cZigzag = static_cast<int64_t>( std::ceil( cDelta ) * 2.0 );
+            totalBits += ImageFileImpl::bitsNeeded( 0, cZigzag );
+         }
+
+         const double cDeltaBits =
+            totalBits / static_cast<double>( cSampleCount - 1 ) + cHeaderBits;
+
+         // Only adopt a clear win; the first batch may not represent the rest
+         if ( cDeltaBits < 0.875 * cAbsoluteBits )
+         {
+            adopted.push_back( cPathName );
+         }
+      }
+
+      if ( adopted.empty() )
+      {
+         return;
+      }
+
+      // Record the choice where readers negotiate the decoder: one codecs
+      // entry naming the adopted fields, standard codec shape
+      std::shared_ptr<StructureNodeImpl> entry( new StructureNodeImpl( imf ) );
+      std::shared_ptr<VectorNodeImpl> inputs( new VectorNodeImpl( imf, true ) );
+
+      for ( const ustring &pathName : adopted )
+      {
+         inputs->append( std::make_shared<StringNodeImpl>( imf, pathName ) );
+      }
+
+      entry->set( "inputs", inputs );
+      entry->set( DELTA_STREAM_CODEC, std::make_shared<StructureNodeImpl>( imf ) );
+      codecs->append( entry );
+
+      // Rebuild the adopted encoders; EncoderFactory now sees the codecs
+      // entry and picks DeltaIntegerEncoder (re-wrapping for lzbs if that
+      // was requested too)
+      for ( const ustring &pathName : adopted )
+      {
+         std::vector<SourceDestBuffer> vTemp;
+
+         for ( auto &sbuf : sbufs_ )
+         {
+            if ( sbuf.pathName() == pathName )
+            {
+               vTemp.push_back( sbuf );
+               break;
+            }
+         }
+
+         ustring codecPath = pathName;
+
+         NodeImplSharedPtr readNode = proto_->get( pathName );
+         uint64_t bytestreamNumber = 0;
+         if ( !proto_->findTerminalPosition( readNode, bytestreamNumber ) )
+         {
+            throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName );
+         }
+
+         for ( auto &bytestream : bytestreams_ )
+         {
+            if ( bytestream->bytestreamNumber() == bytestreamNumber )
+            {
+               bytestream = Encoder::EncoderFactory( static_cast<unsigned>( bytestreamNumber ),
+                                                     cVector_, vTemp, codecPath );
+               break;
+            }
+         }
+      }
+
+      // Delta streams are variable width, so redo the seek index decision
+      seekIndexValid_ = true;
+      for ( unsigned i = 0; i < bytestreams_.size(); i++ )
+      {
+         seekIndexValid_ =
+            seekIndexValid_ && bytestreams_.at( i )->fixedRecordBits( streamFixedBits_.at( i ) );
+      }
+   }
+
    void CompressedVectorWriterImpl::flush()
    {
       for ( auto &bytestream : bytestreams_ )
@@ -618,6 +1373,142 @@ namespace e57
       }
    }
 
+   /// Encode up to 50 records of each stream that is behind endRecordIndex.
+   /// With several streams and several cores the streams are handed out as
+   /// one batch on the shared scheduler (each encoder is touched by exactly
+   /// one thread per pass); otherwise they are processed sequentially as
+   /// before.
+   void CompressedVectorWriterImpl::processStreams( uint64_t endRecordIndex )
+   {
+      E57_TRACE_SPAN( "encode" );
+
+      if ( !encodeParallel_ )
+      {
+         // !!!! For now just process one record per loop until packet is full
+         // enough, or completed request
+         for ( auto &bytestream : bytestreams_ )
+         {
+            if ( bytestream->currentRecordIndex() < endRecordIndex )
+            {
+               // !!! For now, process up to 50 records at a time
+               uint64_t recordCount = endRecordIndex - bytestream->currentRecordIndex();
+               recordCount =
+                  ( recordCount < 50ULL ) ? recordCount : 50ULL; // min(recordCount, 50ULL);
+               bytestream->processRecords( static_cast<unsigned>( recordCount ) );
+            }
+         }
+
+         return;
+      }
+
+      TaskSchedulerImpl::instance().parallelFor( bytestreams_.size(), [&]( size_t i ) {
+         auto &bytestream = bytestreams_.at( i );
+
+         if ( bytestream->currentRecordIndex() < endRecordIndex )
+         {
+            uint64_t recordCount = endRecordIndex - bytestream->currentRecordIndex();
+            recordCount = ( recordCount < 50ULL ) ? recordCount : 50ULL;
+            bytestream->processRecords( static_cast<unsigned>( recordCount ) );
+         }
+      } );
+   }
+
+   void CompressedVectorWriterImpl::packetFlushLoop()
+   {
+      std::unique_lock<std::mutex> lock( packetFlushMutex_ );
+
+      while ( true )
+      {
+         packetFlushWake_.wait( lock, [this] { return stopPacketFlush_ || flushPending_; } );
+
+         if ( !flushPending_ )
+         {
+            if ( stopPacketFlush_ )
+            {
+               return;
+            }
+
+            continue;
+         }
+
+         lock.unlock();
+
+         std::exception_ptr error;
+
+         try
+         {
+            E57_TRACE_SPAN_SIZED( "packetFlush", flushPacketLength_ );
+
+            ImageFileImplSharedPtr imf( cVector_->destImageFile_ );
+
+            imf->file_->seek( flushLogicalOffset_ );
+            imf->file_->write( reinterpret_cast<char *>( &flushPacket_ ), flushPacketLength_ );
+         }
+         catch ( ... )
+         {
+            error = std::current_exception();
+         }
+
+         lock.lock();
+
+         if ( error && !packetFlushError_ )
+         {
+            packetFlushError_ = error;
+         }
+
+         flushPending_ = false;
+         packetFlushIdle_.notify_all();
+      }
+   }
+
+   // Block until the flush thread has written the packet in flight (if any),
+   // rethrowing any error it hit.
+   void CompressedVectorWriterImpl::waitForPacketFlush()
+   {
+      std::unique_lock<std::mutex> lock( packetFlushMutex_ );
+
+      packetFlushIdle_.wait( lock, [this] { return !flushPending_; } );
+
+      if ( packetFlushError_ )
+      {
+         std::exception_ptr error = packetFlushError_;
+         packetFlushError_ = nullptr;
+
+         std::rethrow_exception( error );
+      }
+   }
+
+   void CompressedVectorWriterImpl::stopPacketFlushThread()
+   {
+      if ( !packetFlushThread_.joinable() )
+      {
+         return;
+      }
+
+      // Always join before surfacing any error, so the thread is never left
+      // running if the caller is unwinding.
+      {
+         std::unique_lock<std::mutex> lock( packetFlushMutex_ );
+
+         packetFlushIdle_.wait( lock, [this] { return !flushPending_; } );
+
+         stopPacketFlush_ = true;
+      }
+
+      packetFlushWake_.notify_all();
+      packetFlushThread_.join();
+
+      stopPacketFlush_ = false;
+
+      if ( packetFlushError_ )
+      {
+         std::exception_ptr error = packetFlushError_;
+         packetFlushError_ = nullptr;
+
+         std::rethrow_exception( error );
+      }
+   }
+
    void CompressedVectorWriterImpl::checkImageFileOpen( const char *srcFileName, int srcLineNumber,
                                                         const char *srcFunctionName ) const
    {
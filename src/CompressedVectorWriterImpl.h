@@ -26,8 +26,14 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 #include "Encoder.h"
 #include "Packet.h"
+#include "TileIndex.h"
+#include "ValidIndex.h"
 
 namespace e57
 {
@@ -40,10 +46,24 @@ namespace e57
 
       void write( size_t requestedRecordCount );
       void write( std::vector<SourceDestBuffer> &sbufs, size_t requestedRecordCount );
+      void setBuffers( std::vector<SourceDestBuffer> &sbufs );
+      void setProgressCallback( ProgressCallback callback );
       bool isOpen() const;
       std::shared_ptr<CompressedVectorNodeImpl> compressedVectorNode() const;
       void close();
 
+      /// Make the records written so far durable without closing: flush the
+      /// completed packet bytes, write a provisional section header, and have
+      /// the ImageFile emit a provisional XML snapshot. Writing continues
+      /// afterwards and close() supersedes the snapshot.
+      void checkpoint();
+
+      /// Mark this writer as a spill writer (see
+      /// CompressedVectorNodeImpl::writer): cVector_ is a scratch vector in
+      /// a spill file, and close() hands the finished section to @a target's
+      /// ImageFile for transplanting when that file closes.
+      void setSectionTransplant( const std::shared_ptr<CompressedVectorNodeImpl> &target );
+
 #ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
       void dump( int indent = 0, std::ostream &os = std::cout );
 #endif
@@ -53,11 +73,20 @@ namespace e57
                                const char *srcFunctionName ) const;
       void checkWriterOpen( const char *srcFileName, int srcLineNumber,
                             const char *srcFunctionName ) const;
-      void setBuffers( std::vector<SourceDestBuffer> &sbufs ); //???needed?
       size_t totalOutputAvailable() const;
       size_t currentPacketSize() const;
       uint64_t packetWrite();
+      void writeSeekIndex();
+      void tileIndexTrack( size_t recordCount );
+      void tileIndexWrite();
+      void validIndexTrack( size_t recordCount );
+      void validIndexWrite();
+      void adaptCodecs( size_t recordCount );
       void flush();
+      void processStreams( uint64_t endRecordIndex );
+      void packetFlushLoop();
+      void waitForPacketFlush();
+      void stopPacketFlushThread();
 
       std::vector<SourceDestBuffer> sbufs_;
       std::shared_ptr<CompressedVectorNodeImpl> cVector_;
@@ -66,6 +95,76 @@ namespace e57
       std::vector<std::shared_ptr<Encoder>> bytestreams_;
       DataPacket dataPacket_;
 
+      // Seek index: one candidate entry per data packet (the first record
+      // whose bits all begin in that packet or later), written out as E57
+      // index packets when the writer closes. Disabled when any bytestream
+      // is variable width (strings), since record positions can't be
+      // computed for those.
+      std::vector<IndexPacket::IndexPacketEntry> seekIndex_;
+      std::vector<unsigned> streamFixedBits_;
+      std::vector<uint64_t> streamBitsWritten_;
+      bool seekIndexValid_ = true;
+
+      // Optional "tidx" spatial index: cartesian bounds of fixed-size blocks
+      // of records, collected as they stream through write() and emitted as
+      // a blob next to the vector when the writer closes. Enabled when the
+      // file has the tidx extension prefix registered and the prototype
+      // carries cartesian coordinates.
+      bool tileIndexEnabled_ = false;
+      std::vector<TileIndexBlock> tileIndexBlocks_;
+      TileIndexBlock tileIndexCurrent_;
+
+      // Optional "vidx" valid-point summary: the count of records with
+      // invalid state 0 in fixed-size blocks, collected as they stream
+      // through write() and emitted next to the vector when the writer
+      // closes. Enabled when the file has the vidx extension prefix
+      // registered and the prototype carries an invalid-state field.
+      bool validIndexEnabled_ = false;
+      ustring validIndexPathName_;
+      std::vector<ValidIndexBlock> validIndexBlocks_;
+      ValidIndexBlock validIndexCurrent_;
+
+      // One-shot codec adaptation: before the first batch is encoded,
+      // sample it and opt suitable integer streams into the "dlta" codec
+      // (see adaptCodecs). True once the first write() has decided, whether
+      // or not any stream was adapted.
+      bool codecsAdapted_ = false;
+
+      // Non-null for a spill writer (see setSectionTransplant): the attached
+      // vector in the main file that receives this writer's section when
+      // that file closes. Nodes only hold their ImageFileImpl weakly and a
+      // spill file has no public ImageFile handle, so the writer keeps it
+      // alive (until close() parks it in the main file's transplant queue).
+      std::shared_ptr<CompressedVectorNodeImpl> transplantTarget_;
+      ImageFileImplSharedPtr spillImf_;
+
+      // Packet flush pipeline: a completed packet is copied to flushPacket_
+      // and written by the flush thread while the caller keeps encoding the
+      // next batch. Only one packet is in flight, and the file is never
+      // touched by both threads at once.
+      DataPacket flushPacket_;
+      std::thread packetFlushThread_;
+      std::mutex packetFlushMutex_;
+      std::condition_variable packetFlushWake_;
+      std::condition_variable packetFlushIdle_;
+      uint64_t flushLogicalOffset_ = 0;
+      unsigned flushPacketLength_ = 0;
+      bool flushPending_ = false;
+      bool stopPacketFlush_ = false;
+      std::exception_ptr packetFlushError_;
+
+      // Encode each pass over the bytestreams in parallel on the process-
+      // wide TaskSchedulerImpl, so separate fields encode on separate cores
+      // without this writer owning threads. Encoders are independent until
+      // packet assembly (each reads its own SourceDestBuffer and fills its
+      // own output buffer), which stays on the calling thread. False with a
+      // single stream or a single core.
+      bool encodeParallel_ = false;
+
+      // Invoked once per data packet during write(); a false return cancels
+      // the write with ErrorTransferCanceled (see setProgressCallback).
+      ProgressCallback progressCallback_;
+
       bool isOpen_;
       uint64_t sectionHeaderLogicalStart_; /// start of CompressedVector binary section
       uint64_t sectionLogicalLength_;      /// total length of CompressedVector binary section
@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) 2010 Stan Coleby (scoleby@intelisum.com)
+ * Copyright (c) 2020 PTC Inc.
+ * Copyright (c) 2022 Andy Maloney <asmaloney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+
+#include "Common.h"
+#include "DatasetReaderImpl.h"
+#include "StringFunctions.h"
+#include "TaskSchedulerImpl.h"
+
+namespace e57
+{
+   DatasetReaderImpl::DatasetReaderImpl( const std::vector<ustring> &filePaths,
+                                         const DatasetReaderOptions &options )
+   {
+      if ( filePaths.empty() )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument, "filePaths is empty" );
+      }
+
+      // Split the packet-cache budget evenly over the files. Each file's
+      // PacketReadCache then stays within its share, so opening hundreds of
+      // stations costs the configured total instead of fileCount times the
+      // per-file default.
+      size_t perFileCacheMB = 0;
+      if ( options.packetCacheTotalMB > 0 )
+      {
+         perFileCacheMB = std::max<size_t>( 1, options.packetCacheTotalMB / filePaths.size() );
+      }
+
+      readers_.reserve( filePaths.size() );
+      firstDataIndex_.reserve( filePaths.size() + 1 );
+
+      int64_t totalCount = 0;
+
+      for ( const auto &filePath : filePaths )
+      {
+         readers_.emplace_back( filePath, options.readerOptions );
+
+         if ( perFileCacheMB > 0 )
+         {
+            readers_.back().GetRawIMF().packetCacheSetCapacity( perFileCacheMB );
+         }
+
+         firstDataIndex_.push_back( totalCount );
+         totalCount += readers_.back().GetData3DCount();
+      }
+
+      firstDataIndex_.push_back( totalCount );
+
+      const unsigned hwThreads = std::max( 1U, std::thread::hardware_concurrency() );
+      threadCount_ = ( options.threadCount > 0 )
+                        ? options.threadCount
+                        : std::min( hwThreads, static_cast<unsigned>( filePaths.size() ) );
+   }
+
+   bool DatasetReaderImpl::IsOpen() const
+   {
+      for ( const auto &reader : readers_ )
+      {
+         if ( !reader.IsOpen() )
+         {
+            return false;
+         }
+      }
+
+      return !readers_.empty();
+   }
+
+   bool DatasetReaderImpl::Close()
+   {
+      bool closedAll = !readers_.empty();
+
+      for ( auto &reader : readers_ )
+      {
+         closedAll = reader.Close() && closedAll;
+      }
+
+      return closedAll;
+   }
+
+   size_t DatasetReaderImpl::GetFileCount() const
+   {
+      return readers_.size();
+   }
+
+   Reader DatasetReaderImpl::GetFileReader( size_t fileIndex ) const
+   {
+      if ( fileIndex >= readers_.size() )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument, "fileIndex=" + toString( fileIndex ) +
+                                                       " fileCount=" +
+                                                       toString( readers_.size() ) );
+      }
+
+      return readers_[fileIndex];
+   }
+
+   int64_t DatasetReaderImpl::GetData3DCount() const
+   {
+      return firstDataIndex_.back();
+   }
+
+   bool DatasetReaderImpl::locate( int64_t dataIndex, size_t &fileIndex,
+                                   int64_t &localIndex ) const
+   {
+      if ( ( dataIndex < 0 ) || ( dataIndex >= GetData3DCount() ) )
+      {
+         return false;
+      }
+
+      // Files without scans leave duplicate entries in firstDataIndex_;
+      // upper_bound skips past them to the file that actually holds the scan.
+      const auto position =
+         std::upper_bound( firstDataIndex_.begin(), firstDataIndex_.end(), dataIndex );
+
+      fileIndex = static_cast<size_t>( position - firstDataIndex_.begin() ) - 1;
+      localIndex = dataIndex - firstDataIndex_[fileIndex];
+
+      return true;
+   }
+
+   bool DatasetReaderImpl::GetData3DLocation( int64_t dataIndex, size_t &fileIndex,
+                                              int64_t &localIndex ) const
+   {
+      return locate( dataIndex, fileIndex, localIndex );
+   }
+
+   bool DatasetReaderImpl::ReadData3D( int64_t dataIndex, Data3D &data3DHeader ) const
+   {
+      size_t fileIndex = 0;
+      int64_t localIndex = 0;
+
+      if ( !locate( dataIndex, fileIndex, localIndex ) )
+      {
+         return false;
+      }
+
+      return readers_[fileIndex].ReadData3D( localIndex, data3DHeader );
+   }
+
+   bool DatasetReaderImpl::GetData3DSizes( int64_t dataIndex, int64_t &rowMax,
+                                           int64_t &columnMax, int64_t &pointsSize,
+                                           int64_t &groupsSize, int64_t &countSize,
+                                           bool &columnIndex ) const
+   {
+      size_t fileIndex = 0;
+      int64_t localIndex = 0;
+
+      if ( !locate( dataIndex, fileIndex, localIndex ) )
+      {
+         return false;
+      }
+
+      return readers_[fileIndex].GetData3DSizes( localIndex, rowMax, columnMax, pointsSize,
+                                                 groupsSize, countSize, columnIndex );
+   }
+
+   bool DatasetReaderImpl::ReadData3DGroupsData( int64_t dataIndex, int64_t groupCount,
+                                                 int64_t *idElementValue,
+                                                 int64_t *startPointIndex,
+                                                 int64_t *pointCount ) const
+   {
+      size_t fileIndex = 0;
+      int64_t localIndex = 0;
+
+      if ( !locate( dataIndex, fileIndex, localIndex ) )
+      {
+         return false;
+      }
+
+      return readers_[fileIndex].ReadData3DGroupsData( localIndex, groupCount, idElementValue,
+                                                       startPointIndex, pointCount );
+   }
+
+   CompressedVectorReader DatasetReaderImpl::SetUpData3DPointsData(
+      int64_t dataIndex, size_t pointCount, const Data3DPointsFloat &buffers ) const
+   {
+      size_t fileIndex = 0;
+      int64_t localIndex = 0;
+
+      if ( !locate( dataIndex, fileIndex, localIndex ) )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument, "dataIndex=" + toString( dataIndex ) );
+      }
+
+      return readers_[fileIndex].SetUpData3DPointsData( localIndex, pointCount, buffers );
+   }
+
+   CompressedVectorReader DatasetReaderImpl::SetUpData3DPointsData(
+      int64_t dataIndex, size_t pointCount, const Data3DPointsDouble &buffers ) const
+   {
+      size_t fileIndex = 0;
+      int64_t localIndex = 0;
+
+      if ( !locate( dataIndex, fileIndex, localIndex ) )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument, "dataIndex=" + toString( dataIndex ) );
+      }
+
+      return readers_[fileIndex].SetUpData3DPointsData( localIndex, pointCount, buffers );
+   }
+
+   void DatasetReaderImpl::ForEachData3D( const std::vector<int64_t> &dataIndices,
+                                          const std::function<void( int64_t dataIndex )> &job ) const
+   {
+      // Group the requested scans by file, keeping each file's scans in
+      // request order. Per-file Readers are not safe to drive from several
+      // threads at once, and decoding a file's scans in order lets its
+      // PacketReadCache and read-ahead work sequentially; with whole files as
+      // the unit of parallelism a dataset of dozens of stations keeps every
+      // core busy anyway.
+      std::vector<std::vector<int64_t>> perFileIndices( readers_.size() );
+
+      for ( const int64_t dataIndex : dataIndices )
+      {
+         size_t fileIndex = 0;
+         int64_t localIndex = 0;
+
+         if ( !locate( dataIndex, fileIndex, localIndex ) )
+         {
+            throw E57_EXCEPTION2( ErrorBadAPIArgument, "dataIndex=" + toString( dataIndex ) );
+         }
+
+         perFileIndices[fileIndex].push_back( dataIndex );
+      }
+
+      std::vector<const std::vector<int64_t> *> fileJobs;
+
+      for ( const auto &indices : perFileIndices )
+      {
+         if ( !indices.empty() )
+         {
+            fileJobs.push_back( &indices );
+         }
+      }
+
+      if ( fileJobs.empty() )
+      {
+         return;
+      }
+
+      // The shared scheduler supplies the threads; threadCount_ caps how
+      // many (including the calling thread) work on this dataset at once.
+      TaskSchedulerImpl::instance().parallelFor(
+         fileJobs.size(),
+         [&]( size_t jobIndex ) {
+            for ( const int64_t dataIndex : *fileJobs[jobIndex] )
+            {
+               job( dataIndex );
+            }
+         },
+         threadCount_ );
+   }
+}
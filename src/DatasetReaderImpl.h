@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2010 Stan Coleby (scoleby@intelisum.com)
+ * Copyright (c) 2020 PTC Inc.
+ * Copyright (c) 2022 Andy Maloney <asmaloney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory>
+
+#include "E57SimpleReader.h"
+
+namespace e57
+{
+   class DatasetReaderImpl
+   {
+   public:
+      DatasetReaderImpl( const std::vector<ustring> &filePaths,
+                         const DatasetReaderOptions &options );
+
+      // disallow copying a DatasetReaderImpl
+      DatasetReaderImpl( const DatasetReaderImpl & ) = delete;
+      DatasetReaderImpl &operator=( const DatasetReaderImpl & ) = delete;
+
+      bool IsOpen() const;
+
+      bool Close();
+
+      size_t GetFileCount() const;
+
+      Reader GetFileReader( size_t fileIndex ) const;
+
+      int64_t GetData3DCount() const;
+
+      bool GetData3DLocation( int64_t dataIndex, size_t &fileIndex, int64_t &localIndex ) const;
+
+      bool ReadData3D( int64_t dataIndex, Data3D &data3DHeader ) const;
+
+      bool GetData3DSizes( int64_t dataIndex, int64_t &rowMax, int64_t &columnMax,
+                           int64_t &pointsSize, int64_t &groupsSize, int64_t &countSize,
+                           bool &columnIndex ) const;
+
+      bool ReadData3DGroupsData( int64_t dataIndex, int64_t groupCount, int64_t *idElementValue,
+                                 int64_t *startPointIndex, int64_t *pointCount ) const;
+
+      CompressedVectorReader SetUpData3DPointsData( int64_t dataIndex, size_t pointCount,
+                                                    const Data3DPointsFloat &buffers ) const;
+
+      CompressedVectorReader SetUpData3DPointsData( int64_t dataIndex, size_t pointCount,
+                                                    const Data3DPointsDouble &buffers ) const;
+
+      void ForEachData3D( const std::vector<int64_t> &dataIndices,
+                          const std::function<void( int64_t dataIndex )> &job ) const;
+
+   private:
+      // Resolves a dataset-wide scan index to its file; returns false when out of range.
+      bool locate( int64_t dataIndex, size_t &fileIndex, int64_t &localIndex ) const;
+
+      std::vector<Reader> readers_;
+
+      // firstDataIndex_[i] is the dataset-wide index of file i's first scan;
+      // one extra trailing entry holds the total scan count.
+      std::vector<int64_t> firstDataIndex_;
+
+      // Concurrency cap for ForEachData3D batches on the shared scheduler
+      // (see TaskSchedulerImpl).
+      unsigned threadCount_ = 0;
+   };
+}
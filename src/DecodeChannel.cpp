@@ -51,6 +51,12 @@ namespace e57
          return ( true );
       }
 
+      // If a region query capped this channel, stop at the cap
+      if ( decoder->totalRecordsCompleted() >= decoder->limitRecord() )
+      {
+         return ( true );
+      }
+
       // If we have filled the dest buffer, we are blocked
       return ( dbuf.impl()->nextIndex() == dbuf.impl()->capacity() );
    }
@@ -28,6 +28,14 @@
 #include <algorithm>
 #include <cstring>
 
+// Vectorized bit-unpacking for the common narrow integer widths. The kernel
+// works on raw little-endian bytes, so it is independent of the decoder's
+// register type, and is selected at runtime.
+#if defined( __x86_64__ ) && defined( __GNUC__ )
+#define E57_HAVE_AVX2_UNPACK
+#include <immintrin.h>
+#endif
+
 #include "CompressedVectorNodeImpl.h"
 #include "Decoder.h"
 #include "FloatNodeImpl.h"
@@ -35,14 +43,94 @@
 #include "IntegerNodeImpl.h"
 #include "ScaledIntegerNodeImpl.h"
 #include "SourceDestBufferImpl.h"
+#include "StreamCompression.h"
 #include "StringFunctions.h"
 
 using namespace e57;
 
+#if defined( E57_HAVE_AVX2_UNPACK )
+namespace
+{
+   /// Unpack bit-packed values (<= 32 bits wide) starting at firstBit into
+   /// out[0..recordCount), four records per iteration, using AVX2 gathers and
+   /// variable shifts. Stops early if a gather would read past safeEndByte.
+   /// Returns the number of records actually unpacked.
+   __attribute__( ( target( "avx2" ) ) ) size_t unpackAVX2( const char *inbuf, size_t firstBit,
+                                                            size_t recordCount,
+                                                            unsigned bitsPerRecord, uint32_t mask,
+                                                            size_t safeEndByte, uint64_t *out )
+   {
+      const __m256i vMask = _mm256_set1_epi64x( mask );
+
+      size_t i = 0;
+
+      for ( ; i + 4 <= recordCount; i += 4 )
+      {
+         const size_t bit0 = firstBit + i * bitsPerRecord;
+         const size_t bit1 = bit0 + bitsPerRecord;
+         const size_t bit2 = bit1 + bitsPerRecord;
+         const size_t bit3 = bit2 + bitsPerRecord;
+
+         // Each record is read with an unaligned 8-byte load; make sure the
+         // furthest load stays inside the valid input.
+         if ( ( bit3 >> 3 ) + 8 > safeEndByte )
+         {
+            break;
+         }
+
+         const __m128i vOffsets =
+            _mm_set_epi32( static_cast<int>( bit3 >> 3 ), static_cast<int>( bit2 >> 3 ),
+                           static_cast<int>( bit1 >> 3 ), static_cast<int>( bit0 >> 3 ) );
+
+         __m256i vValues =
+            _mm256_i32gather_epi64( reinterpret_cast<const long long *>( inbuf ), vOffsets, 1 );
+
+         const __m256i vShifts =
+            _mm256_set_epi64x( static_cast<long long>( bit3 & 7 ),
+                               static_cast<long long>( bit2 & 7 ),
+                               static_cast<long long>( bit1 & 7 ),
+                               static_cast<long long>( bit0 & 7 ) );
+
+         vValues = _mm256_srlv_epi64( vValues, vShifts );
+         vValues = _mm256_and_si256( vValues, vMask );
+
+         _mm256_storeu_si256( reinterpret_cast<__m256i *>( &out[i] ), vValues );
+      }
+
+      return i;
+   }
+
+   bool canUseAVX2()
+   {
+      static const bool sHaveAVX2 = ( __builtin_cpu_supports( "avx2" ) != 0 );
+
+      return sHaveAVX2;
+   }
+}
+#endif
+
 std::shared_ptr<Decoder> Decoder::DecoderFactory( unsigned bytestreamNumber, //!!! name ok?
                                                   const CompressedVectorNodeImpl *cVector,
                                                   std::vector<SourceDestBuffer> &dbufs,
-                                                  const ustring & /*codecPath*/ )
+                                                  const ustring &codecPath )
+{
+   std::shared_ptr<Decoder> decoder =
+      baseDecoderFactory( bytestreamNumber, cVector, dbufs, codecPath );
+
+   // Opt-in "lzbs" extension: the writer compressed this bytestream in
+   // blocks, so decompress them ahead of the decoder (see StreamCompression.h)
+   if ( streamCompressionRequested( cVector, dbufs.at( 0 ).pathName() ) )
+   {
+      decoder = std::shared_ptr<Decoder>( new CompressedStreamDecoder( decoder ) );
+   }
+
+   return decoder;
+}
+
+std::shared_ptr<Decoder> Decoder::baseDecoderFactory( unsigned bytestreamNumber,
+                                                      const CompressedVectorNodeImpl *cVector,
+                                                      std::vector<SourceDestBuffer> &dbufs,
+                                                      const ustring & /*codecPath*/ )
 {
    // !!! verify single dbuf
 
@@ -83,6 +171,15 @@ std::shared_ptr<Decoder> Decoder::DecoderFactory( unsigned bytestreamNumber, //!
             return decoder;
          }
 
+         // Opt-in "dlta" extension: the writer delta-coded this bytestream
+         // (see StreamCompression.h)
+         if ( streamDeltaRequested( cVector, path ) )
+         {
+            std::shared_ptr<Decoder> decoder( new DeltaIntegerDecoder(
+               false, bytestreamNumber, dbufs.at( 0 ), ini->minimum(), 1.0, 0.0, maxRecordCount ) );
+            return decoder;
+         }
+
          if ( bitsPerRecord <= 8 )
          {
             std::shared_ptr<Decoder> decoder( new BitpackIntegerDecoder<uint8_t>(
@@ -138,6 +235,16 @@ std::shared_ptr<Decoder> Decoder::DecoderFactory( unsigned bytestreamNumber, //!
             return decoder;
          }
 
+         // Opt-in "dlta" extension: the writer delta-coded this bytestream
+         // (see StreamCompression.h)
+         if ( streamDeltaRequested( cVector, path ) )
+         {
+            std::shared_ptr<Decoder> decoder(
+               new DeltaIntegerDecoder( true, bytestreamNumber, dbufs.at( 0 ), sini->minimum(),
+                                        sini->scale(), sini->offset(), maxRecordCount ) );
+            return decoder;
+         }
+
          if ( bitsPerRecord <= 8 )
          {
             std::shared_ptr<Decoder> decoder( new BitpackIntegerDecoder<uint8_t>(
@@ -201,10 +308,20 @@ BitpackDecoder::BitpackDecoder( unsigned bytestreamNumber, SourceDestBuffer &dbu
                                 unsigned alignmentSize, uint64_t maxRecordCount ) :
    Decoder( bytestreamNumber ),
    maxRecordCount_( maxRecordCount ), destBuffer_( dbuf.impl() ),
-   inBuffer_( 1024 ), // !!! need to pick smarter channel buffer sizes
    inBufferAlignmentSize_( alignmentSize ), bitsPerWord_( 8 * alignmentSize ),
    bytesPerWord_( alignmentSize )
 {
+   // Lease the channel input buffer from the file's pool, so consecutive
+   // readers against the same file reuse each other's allocations
+   ImageFileImplSharedPtr imf( destBuffer_->destImageFile() );
+
+   bufferPool_ = imf->bufferPool();
+   inBuffer_ = bufferPool_->acquire( 1024 ); // !!! need to pick smarter channel buffer sizes
+}
+
+BitpackDecoder::~BitpackDecoder()
+{
+   bufferPool_->release( std::move( inBuffer_ ) );
 }
 
 void BitpackDecoder::destBufferSetNew( std::vector<SourceDestBuffer> &dbufs )
@@ -227,6 +344,15 @@ size_t BitpackDecoder::inputProcess( const char *source, const size_t availableB
    size_t bitsEaten = 0;
    do
    {
+      // Compact only when the tail of inBuffer_ is exhausted and more input
+      // is waiting; the bit cursor advances through the buffer without
+      // moving bytes, so the memmove tax is paid once per buffer fill (and
+      // then only for the uneaten sub-word tail) instead of on every refill.
+      if ( ( inBufferEndByte_ == inBuffer_.size() ) && ( bytesUnsaved > 0 ) )
+      {
+         inBufferShiftDown();
+      }
+
       size_t byteCount =
          std::min( bytesUnsaved, inBuffer_.size() - static_cast<size_t>( inBufferEndByte_ ) );
 
@@ -273,8 +399,10 @@ size_t BitpackDecoder::inputProcess( const char *source, const size_t availableB
       std::cout << "  feeding aligned decoder " << endBit - inBufferFirstBit_ << " bits."
                 << std::endl;
 #endif
+      // data() + offset rather than operator[]: the window is empty (and its
+      // start one past the end) when a full buffer was eaten completely
       bitsEaten =
-         inputProcessAligned( &inBuffer_[firstWord * bytesPerWord_],
+         inputProcessAligned( inBuffer_.data() + firstWord * bytesPerWord_,
                               inBufferFirstBit_ - firstNaturalBit, endBit - firstNaturalBit );
 #ifdef E57_VERBOSE
       std::cout << "  bitsEaten=" << bitsEaten << " firstWord=" << firstWord
@@ -291,10 +419,6 @@ size_t BitpackDecoder::inputProcess( const char *source, const size_t availableB
 #endif
       inBufferFirstBit_ += bitsEaten;
 
-      // Shift uneaten data to beginning of inBuffer_, keep on natural word
-      // boundaries.
-      inBufferShiftDown();
-
       // If the lower level processing didn't eat anything on this iteration,
       // stop looping and tell caller how much we ate or stored.
    } while ( bytesUnsaved > 0 && bitsEaten > 0 );
@@ -309,6 +433,17 @@ void BitpackDecoder::stateReset()
    inBufferEndByte_ = 0;
 }
 
+void BitpackDecoder::seekToRecord( uint64_t recordIndex, unsigned firstBitOffset )
+{
+   // Discard any buffered input. The caller repositions the packet stream so
+   // the next byte fed in is the one containing the record's first bit; the
+   // leading firstBitOffset bits of it belong to the previous record's tail
+   // and get skipped.
+   inBufferFirstBit_ = firstBitOffset;
+   inBufferEndByte_ = 0;
+   currentRecordIndex_ = recordIndex;
+}
+
 void BitpackDecoder::inBufferShiftDown()
 {
    // Move uneaten data down to beginning of inBuffer_.
@@ -317,6 +452,13 @@ void BitpackDecoder::inBufferShiftDown()
    size_t firstWord = inBufferFirstBit_ / bitsPerWord_;
    size_t firstNaturalByte = firstWord * bytesPerWord_;
 
+   // Already at the front (possible when the buffer fills before anything
+   // was eaten): nothing to move
+   if ( firstNaturalByte == 0 )
+   {
+      return;
+   }
+
 #if VALIDATE_BASIC
    if ( firstNaturalByte > inBufferEndByte_ )
    {
@@ -416,49 +558,72 @@ size_t BitpackFloatDecoder::inputProcessAligned( const char *inbuf, const size_t
       n = maxInputRecords;
    }
 
-   // Can't process more than defined in input file
-   if ( n > maxRecordCount_ - currentRecordIndex_ )
+   // Can't process more than defined in input file, or past a region query's
+   // record limit
+   const uint64_t cMaxRecord = std::min( maxRecordCount_, limitRecord_ );
+   const uint64_t cRecordsRemaining =
+      ( cMaxRecord > currentRecordIndex_ ) ? cMaxRecord - currentRecordIndex_ : 0;
+   if ( n > cRecordsRemaining )
    {
-      n = static_cast<unsigned>( maxRecordCount_ - currentRecordIndex_ );
+      n = static_cast<size_t>( cRecordsRemaining );
    }
 
 #ifdef E57_VERBOSE
    std::cout << "  n:" << n << std::endl; //???
 #endif
 
-   if ( precision_ == PrecisionSingle )
+   if ( stride_ > 1 )
    {
-      // Form the starting address for first data location in inBuffer
-      auto inp = reinterpret_cast<const float *>( inbuf );
-
-      // Copy floats from inbuf to destBuffer_
-      for ( unsigned i = 0; i < n; i++ )
+      // Preview mode: records are whole floats/doubles, so skipped records
+      // cost only a pointer advance.
+      const uint64_t cur = currentRecordIndex_;
+      const uint64_t avail =
+         std::min( static_cast<uint64_t>( maxInputRecords ), cRecordsRemaining );
+      const size_t destRecords = destBuffer_->capacity() - destBuffer_->nextIndex();
+      const uint64_t firstWantedDelta =
+         ( cur % stride_ == 0 ) ? 0 : stride_ - ( cur % stride_ );
+
+      uint64_t consume = 0;
+
+      if ( destRecords == 0 )
       {
-         float value = *inp;
-
-#ifdef E57_VERBOSE
-         std::cout << "  got float value=" << value << std::endl;
-#endif
-         destBuffer_->setNextFloat( value );
-         inp++;
+         consume = std::min( avail, firstWantedDelta );
       }
-   }
-   else
-   { // Double precision
-      // Form the starting address for first data location in inBuffer
-      auto inp = reinterpret_cast<const double *>( inbuf );
-
-      // Copy doubles from inbuf to destBuffer_
-      for ( unsigned i = 0; i < n; i++ )
+      else
       {
-         double value = *inp;
+         consume = std::min( avail, firstWantedDelta + ( destRecords - 1 ) * stride_ + 1 );
+      }
 
-#ifdef E57_VERBOSE
-         std::cout << "  got double value=" << value << std::endl;
-#endif
-         destBuffer_->setNextDouble( value );
-         inp++;
+      for ( uint64_t delta = firstWantedDelta; delta < consume; delta += stride_ )
+      {
+         if ( precision_ == PrecisionSingle )
+         {
+            destBuffer_->setNextFloat(
+               reinterpret_cast<const float *>( inbuf )[static_cast<size_t>( delta )] );
+         }
+         else
+         {
+            destBuffer_->setNextDouble(
+               reinterpret_cast<const double *>( inbuf )[static_cast<size_t>( delta )] );
+         }
       }
+
+      currentRecordIndex_ += consume;
+
+      return ( static_cast<size_t>( consume ) * 8 * typeSize );
+   }
+
+   // Records are byte-aligned full-width IEEE values, so the whole run can
+   // be handed to the destination buffer in one call; a matching
+   // representation is then a single memcpy (or a blocked strided copy)
+   // instead of per-record extraction.
+   if ( precision_ == PrecisionSingle )
+   {
+      destBuffer_->setNextFloatN( reinterpret_cast<const float *>( inbuf ), n );
+   }
+   else
+   {
+      destBuffer_->setNextDoubleN( reinterpret_cast<const double *>( inbuf ), n );
    }
 
    // Update counts of records processed
@@ -485,6 +650,24 @@ void BitpackFloatDecoder::dump( int indent, std::ostream &os )
 
 //================================================================
 
+namespace
+{
+   /// Extract a string length from b63-b1 of an eight byte prefix. Little
+   /// endian ordering. Removing the least significant bit (which says this is
+   /// a long prefix).
+   uint64_t longStringPrefixLength( const uint8_t *prefixBytes )
+   {
+      return ( static_cast<uint64_t>( prefixBytes[0] ) >> 1 ) +
+             ( static_cast<uint64_t>( prefixBytes[1] ) << ( 1 * 8 - 1 ) ) +
+             ( static_cast<uint64_t>( prefixBytes[2] ) << ( 2 * 8 - 1 ) ) +
+             ( static_cast<uint64_t>( prefixBytes[3] ) << ( 3 * 8 - 1 ) ) +
+             ( static_cast<uint64_t>( prefixBytes[4] ) << ( 4 * 8 - 1 ) ) +
+             ( static_cast<uint64_t>( prefixBytes[5] ) << ( 5 * 8 - 1 ) ) +
+             ( static_cast<uint64_t>( prefixBytes[6] ) << ( 6 * 8 - 1 ) ) +
+             ( static_cast<uint64_t>( prefixBytes[7] ) << ( 7 * 8 - 1 ) );
+   }
+}
+
 BitpackStringDecoder::BitpackStringDecoder( unsigned bytestreamNumber, SourceDestBuffer &dbuf,
                                             uint64_t maxRecordCount ) :
    BitpackDecoder( bytestreamNumber, dbuf, sizeof( char ), maxRecordCount )
@@ -522,6 +705,39 @@ size_t BitpackStringDecoder::inputProcessAligned( const char *inbuf, const size_
                 << " prefixLength=" << prefixLength_ << " nBytesPrefixRead=" << nBytesPrefixRead_
                 << " nBytesStringRead=" << nBytesStringRead_ << std::endl;
 #endif
+      // Fast path: at a record boundary with the whole record (prefix and
+      // contents) available, assign the string straight out of inbuf and skip
+      // the incremental machinery below. Short per-record string fields
+      // (classification labels etc.) nearly always land here; only a record
+      // split across input buffers takes the stateful path.
+      if ( readingPrefix_ && ( nBytesPrefixRead_ == 0 ) )
+      {
+         const size_t nBytesLeft = nBytesAvailable - nBytesRead;
+         const size_t prefixLength = ( *inbuf & 0x01 ) ? 8 : 1;
+
+         if ( prefixLength <= nBytesLeft )
+         {
+            const uint64_t length =
+               ( prefixLength == 1 )
+                  ? static_cast<uint64_t>( static_cast<uint8_t>( *inbuf ) >> 1 )
+                  : longStringPrefixLength( reinterpret_cast<const uint8_t *>( inbuf ) );
+
+            if ( length <= nBytesLeft - prefixLength )
+            {
+               destBuffer_->setNextString( inbuf + prefixLength,
+                                           static_cast<size_t>( length ) );
+               currentRecordIndex_++;
+
+               const size_t nBytesRecord = prefixLength + static_cast<size_t>( length );
+
+               inbuf += nBytesRecord;
+               nBytesRead += nBytesRecord;
+
+               continue;
+            }
+         }
+      }
+
       if ( readingPrefix_ )
       {
          // Try to read more prefix bytes
@@ -566,17 +782,8 @@ size_t BitpackStringDecoder::inputProcessAligned( const char *inbuf, const size_
             }
             else
             {
-               // Eight byte prefix, extract length from b63-b1. Little endian
-               // ordering. Removing the least significant bit (which says this
-               // is a long prefix).
-               stringLength_ = ( static_cast<uint64_t>( prefixBytes_[0] ) >> 1 ) +
-                               ( static_cast<uint64_t>( prefixBytes_[1] ) << ( 1 * 8 - 1 ) ) +
-                               ( static_cast<uint64_t>( prefixBytes_[2] ) << ( 2 * 8 - 1 ) ) +
-                               ( static_cast<uint64_t>( prefixBytes_[3] ) << ( 3 * 8 - 1 ) ) +
-                               ( static_cast<uint64_t>( prefixBytes_[4] ) << ( 4 * 8 - 1 ) ) +
-                               ( static_cast<uint64_t>( prefixBytes_[5] ) << ( 5 * 8 - 1 ) ) +
-                               ( static_cast<uint64_t>( prefixBytes_[6] ) << ( 6 * 8 - 1 ) ) +
-                               ( static_cast<uint64_t>( prefixBytes_[7] ) << ( 7 * 8 - 1 ) );
+               // Eight byte prefix, extract length from b63-b1.
+               stringLength_ = longStringPrefixLength( prefixBytes_ );
             }
             // Get ready to read string contents
             readingPrefix_ = false;
@@ -721,10 +928,14 @@ size_t BitpackIntegerDecoder<RegisterT>::inputProcessAligned( const char *inbuf,
    // available in input.
    size_t recordCount = std::min( destRecords, maxInputRecords );
 
-   // Can't process more than defined in input file
-   if ( static_cast<uint64_t>( recordCount ) > maxRecordCount_ - currentRecordIndex_ )
+   // Can't process more than defined in input file, or past a region query's
+   // record limit
+   const uint64_t cMaxRecord = std::min( maxRecordCount_, limitRecord_ );
+   const uint64_t cRecordsRemaining =
+      ( cMaxRecord > currentRecordIndex_ ) ? cMaxRecord - currentRecordIndex_ : 0;
+   if ( static_cast<uint64_t>( recordCount ) > cRecordsRemaining )
    {
-      recordCount = static_cast<unsigned>( maxRecordCount_ - currentRecordIndex_ );
+      recordCount = static_cast<size_t>( cRecordsRemaining );
    }
 
 #ifdef E57_VERBOSE
@@ -747,8 +958,174 @@ size_t BitpackIntegerDecoder<RegisterT>::inputProcessAligned( const char *inbuf,
    // clang-format on
 
    size_t bitOffset = firstBit;
+   size_t recordIndex = 0;
+
+   if ( stride_ > 1 )
+   {
+      // Preview mode: unpack only the records whose index is a multiple of
+      // the stride; each skipped record costs just a bit offset advance.
+      const uint64_t cur = currentRecordIndex_;
+      const uint64_t avail =
+         std::min( static_cast<uint64_t>( maxInputRecords ), cRecordsRemaining );
+      const uint64_t firstWantedDelta =
+         ( cur % stride_ == 0 ) ? 0 : stride_ - ( cur % stride_ );
+
+      uint64_t consume = 0;
+
+      if ( destRecords == 0 )
+      {
+         // Output is full; just consume input up to the next wanted record
+         consume = std::min( avail, firstWantedDelta );
+      }
+      else
+      {
+         consume = std::min( avail, firstWantedDelta + ( destRecords - 1 ) * stride_ + 1 );
+      }
+
+      constexpr size_t cStrideChunk = 512;
+
+      int64_t decoded[cStrideChunk];
+      size_t decodedCount = 0;
+
+      for ( uint64_t delta = firstWantedDelta; delta < consume; delta += stride_ )
+      {
+         const size_t bitPosition = firstBit + static_cast<size_t>( delta ) * bitsPerRecord_;
+         const size_t wordPos = bitPosition / RegisterBits;
+         const size_t offset = bitPosition % RegisterBits;
+
+         const RegisterT low = inp[wordPos];
+
+         RegisterT w;
+         if ( offset == 0 )
+         {
+            w = low;
+         }
+         else if ( offset + bitsPerRecord_ <= RegisterBits )
+         {
+            w = low >> offset;
+         }
+         else
+         {
+            const RegisterT high = inp[wordPos + 1];
+
+            w = ( high << ( RegisterBits - offset ) ) | ( low >> offset );
+         }
+
+         w &= destBitMask_;
+
+         decoded[decodedCount++] = minimum_ + static_cast<uint64_t>( w );
+
+         if ( decodedCount == cStrideChunk )
+         {
+            if ( isScaledInteger_ )
+            {
+               destBuffer_->setNextInt64N( decoded, decodedCount, scale_, offset_ );
+            }
+            else
+            {
+               destBuffer_->setNextInt64N( decoded, decodedCount );
+            }
+
+            decodedCount = 0;
+         }
+      }
+
+      if ( decodedCount > 0 )
+      {
+         if ( isScaledInteger_ )
+         {
+            destBuffer_->setNextInt64N( decoded, decodedCount, scale_, offset_ );
+         }
+         else
+         {
+            destBuffer_->setNextInt64N( decoded, decodedCount );
+         }
+      }
+
+      currentRecordIndex_ += consume;
+
+      return ( static_cast<size_t>( consume ) * bitsPerRecord_ );
+   }
+
+   // Zero-copy path: when the records are full register words with no bias
+   // and the destination is a matching integer representation, the packed
+   // bytes already are the destination bytes, so the whole run skips the
+   // conversion layer.
+   if ( ( bitsPerRecord_ == RegisterBits ) && ( minimum_ == 0 ) && ( bitOffset == 0 ) &&
+        !( isScaledInteger_ && destBuffer_->doScaling() ) &&
+        destBuffer_->isRawCopyCompatible( sizeof( RegisterT ), minimum_, maximum_ ) )
+   {
+      destBuffer_->setNextRawN( inbuf, recordCount, sizeof( RegisterT ) );
+      recordIndex = recordCount;
+   }
+
+#if defined( E57_HAVE_AVX2_UNPACK )
+   // Fast path for the common narrow widths: gather/shift four records at a
+   // time into a scratch buffer, then hand the values to the dest buffer.
+   if ( canUseAVX2() && ( bitsPerRecord_ <= 32 ) && ( recordCount >= 8 ) )
+   {
+      constexpr size_t cChunkSize = 512;
+
+      uint64_t unpacked[cChunkSize];
+
+      // The kernel reads whole 8-byte words, so it must stop short of the
+      // last full byte of valid input; leftovers go through the scalar loop.
+      const size_t safeEndByte = endBit >> 3;
+
+      while ( recordIndex < recordCount )
+      {
+         const size_t chunk = std::min( recordCount - recordIndex, cChunkSize );
+         const size_t done =
+            unpackAVX2( inbuf, firstBit + recordIndex * bitsPerRecord_, chunk, bitsPerRecord_,
+                        static_cast<uint32_t>( destBitMask_ ), safeEndByte, unpacked );
+
+         if ( done == 0 )
+         {
+            break;
+         }
+
+         // Add the minimum in place, then hand the whole run to the dest
+         // buffer in one call.
+         for ( size_t j = 0; j < done; ++j )
+         {
+            unpacked[j] += static_cast<uint64_t>( minimum_ );
+         }
+
+         const auto *values = reinterpret_cast<const int64_t *>( unpacked );
+
+         if ( isScaledInteger_ )
+         {
+            destBuffer_->setNextInt64N( values, done, scale_, offset_ );
+         }
+         else
+         {
+            destBuffer_->setNextInt64N( values, done );
+         }
+
+         recordIndex += done;
+
+         if ( done < chunk )
+         {
+            break;
+         }
+      }
+
+      // Resynchronize the scalar word/bit position for any remaining records
+      const size_t nextBit = firstBit + recordIndex * bitsPerRecord_;
+
+      wordPosition = static_cast<unsigned>( nextBit / RegisterBits );
+      bitOffset = nextBit % RegisterBits;
+   }
+#endif
+
+   // Batch the unpacked values so the destination conversion switch runs
+   // once per chunk instead of once per record (mirrors the AVX2 path).
+   constexpr size_t cScalarChunk = 512;
 
-   for ( size_t i = 0; i < recordCount; i++ )
+   int64_t decoded[cScalarChunk];
+   size_t decodedCount = 0;
+
+   for ( size_t i = recordIndex; i < recordCount; i++ )
    {
       // Get lower word (contains at least the LSbit of the value),
       RegisterT low = inp[wordPosition];
@@ -800,15 +1177,22 @@ size_t BitpackIntegerDecoder<RegisterT>::inputProcessAligned( const char *inbuf,
       std::cout << "  Storing value=" << value << std::endl;
 #endif
 
+      decoded[decodedCount++] = value;
+
       // The parameter isScaledInteger_ determines which version of
-      // setNextInt64 gets called
-      if ( isScaledInteger_ )
-      {
-         destBuffer_->setNextInt64( value, scale_, offset_ );
-      }
-      else
+      // setNextInt64N gets called
+      if ( decodedCount == cScalarChunk )
       {
-         destBuffer_->setNextInt64( value );
+         if ( isScaledInteger_ )
+         {
+            destBuffer_->setNextInt64N( decoded, decodedCount, scale_, offset_ );
+         }
+         else
+         {
+            destBuffer_->setNextInt64N( decoded, decodedCount );
+         }
+
+         decodedCount = 0;
       }
 
       // Store the result in next available position in the user's dest buffer
@@ -827,6 +1211,18 @@ size_t BitpackIntegerDecoder<RegisterT>::inputProcessAligned( const char *inbuf,
 #endif
    }
 
+   if ( decodedCount > 0 )
+   {
+      if ( isScaledInteger_ )
+      {
+         destBuffer_->setNextInt64N( decoded, decodedCount, scale_, offset_ );
+      }
+      else
+      {
+         destBuffer_->setNextInt64N( decoded, decodedCount );
+      }
+   }
+
    // Update counts of records processed
    currentRecordIndex_ += recordCount;
 
@@ -885,27 +1281,65 @@ size_t ConstantIntegerDecoder::inputProcess( const char *source, const size_t av
    // We don't need any input bytes to produce output, so ignore source and
    // availableByteCount.
 
-   // Fill dest buffer unless get to maxRecordCount
+   // Fill dest buffer unless get to maxRecordCount or a region query's
+   // record limit
    size_t count = destBuffer_->capacity() - destBuffer_->nextIndex();
-   uint64_t remainingRecordCount = maxRecordCount_ - currentRecordIndex_;
+   const uint64_t cMaxRecord = std::min( maxRecordCount_, limitRecord_ );
+   const uint64_t remainingRecordCount =
+      ( cMaxRecord > currentRecordIndex_ ) ? cMaxRecord - currentRecordIndex_ : 0;
    if ( static_cast<uint64_t>( count ) > remainingRecordCount )
    {
       count = static_cast<unsigned>( remainingRecordCount );
    }
 
-   if ( isScaledInteger_ )
+   if ( stride_ > 1 )
    {
-      for ( size_t i = 0; i < count; i++ )
+      // Preview mode: the stream carries no bytes, so skipping is pure
+      // bookkeeping; only the wanted records are stored.
+      const uint64_t cur = currentRecordIndex_;
+      const size_t destRecords = destBuffer_->capacity() - destBuffer_->nextIndex();
+      const uint64_t firstWantedDelta =
+         ( cur % stride_ == 0 ) ? 0 : stride_ - ( cur % stride_ );
+
+      uint64_t consume = 0;
+
+      if ( destRecords == 0 )
+      {
+         consume = std::min( remainingRecordCount, firstWantedDelta );
+      }
+      else
+      {
+         consume = std::min( remainingRecordCount,
+                             firstWantedDelta + ( destRecords - 1 ) * stride_ + 1 );
+      }
+
+      for ( uint64_t delta = firstWantedDelta; delta < consume; delta += stride_ )
       {
-         destBuffer_->setNextInt64( minimum_, scale_, offset_ );
+         if ( isScaledInteger_ )
+         {
+            destBuffer_->setNextInt64( minimum_, scale_, offset_ );
+         }
+         else
+         {
+            destBuffer_->setNextInt64( minimum_ );
+         }
       }
+
+      currentRecordIndex_ += consume;
+
+      return ( static_cast<size_t>( consume ) );
+   }
+
+   // The stored element never changes, so the whole request is one broadcast
+   // fill: the constant is converted and range-checked once and the result
+   // replicated over the run (a memset for packed one-byte destinations).
+   if ( isScaledInteger_ )
+   {
+      destBuffer_->setNextInt64Fill( minimum_, count, scale_, offset_ );
    }
    else
    {
-      for ( size_t i = 0; i < count; i++ )
-      {
-         destBuffer_->setNextInt64( minimum_ );
-      }
+      destBuffer_->setNextInt64Fill( minimum_, count );
    }
    currentRecordIndex_ += count;
    return ( count );
@@ -929,3 +1363,338 @@ void ConstantIntegerDecoder::dump( int indent, std::ostream &os )
    destBuffer_->dump( indent + 4, os );
 }
 #endif
+
+//================================================================
+
+DeltaIntegerDecoder::DeltaIntegerDecoder( bool isScaledInteger, unsigned bytestreamNumber,
+                                          SourceDestBuffer &dbuf, int64_t minimum, double scale,
+                                          double offset, uint64_t maxRecordCount ) :
+   Decoder( bytestreamNumber ),
+   maxRecordCount_( maxRecordCount ), destBuffer_( dbuf.impl() ),
+   isScaledInteger_( isScaledInteger ), minimum_( minimum ), scale_( scale ), offset_( offset )
+{
+}
+
+void DeltaIntegerDecoder::destBufferSetNew( std::vector<SourceDestBuffer> &dbufs )
+{
+   if ( dbufs.size() != 1 )
+   {
+      throw E57_EXCEPTION2( ErrorInternal, "dbufsSize=" + toString( dbufs.size() ) );
+   }
+
+   destBuffer_ = dbufs.at( 0 ).impl();
+}
+
+bool DeltaIntegerDecoder::deliverPending()
+{
+   const uint64_t cMaxRecord = std::min( maxRecordCount_, limitRecord_ );
+
+   while ( pendingFirst_ < pendingValues_.size() )
+   {
+      // Records past maxRecordCount or a region query's record limit, and
+      // the ones a stride skips over, are consumed without being stored
+      const bool cWanted =
+         ( currentRecordIndex_ < cMaxRecord ) && ( currentRecordIndex_ % stride_ == 0 );
+
+      if ( cWanted )
+      {
+         if ( destBuffer_->nextIndex() >= destBuffer_->capacity() )
+         {
+            return false;
+         }
+
+         if ( isScaledInteger_ )
+         {
+            destBuffer_->setNextInt64( pendingValues_[pendingFirst_], scale_, offset_ );
+         }
+         else
+         {
+            destBuffer_->setNextInt64( pendingValues_[pendingFirst_] );
+         }
+      }
+
+      ++pendingFirst_;
+      ++currentRecordIndex_;
+   }
+
+   pendingValues_.clear();
+   pendingFirst_ = 0;
+
+   return true;
+}
+
+void DeltaIntegerDecoder::decodeBlock()
+{
+   uint64_t values[DELTA_STREAM_BLOCK_RECORDS];
+   const size_t cRecordCount = unpackDeltaBlock( blockBuffer_.data(), blockByteCount_, values );
+
+   pendingValues_.clear();
+   pendingFirst_ = 0;
+   pendingValues_.reserve( cRecordCount );
+
+   for ( size_t i = 0; i < cRecordCount; ++i )
+   {
+      // Undo the bias by the field minimum; wrap-safe unsigned arithmetic
+      pendingValues_.push_back(
+         static_cast<int64_t>( values[i] + static_cast<uint64_t>( minimum_ ) ) );
+   }
+}
+
+size_t DeltaIntegerDecoder::inputProcess( const char *source, const size_t availableByteCount )
+{
+#ifdef E57_VERBOSE
+   std::cout << "DeltaIntegerDecoder::inputProcess() called, source=" << (void *)( source )
+             << " availableByteCount=" << availableByteCount << std::endl;
+#endif
+
+   size_t consumed = 0;
+
+   while ( true )
+   {
+      // Deliver the previous block before consuming more input, so
+      // unconsumed bytes stay with the caller while the destination is full
+      if ( !deliverPending() )
+      {
+         break;
+      }
+
+      if ( consumed == availableByteCount )
+      {
+         break;
+      }
+
+      if ( blockFill_ < DELTA_STREAM_HEADER_SIZE )
+      {
+         if ( blockBuffer_.size() < DELTA_STREAM_HEADER_SIZE )
+         {
+            blockBuffer_.resize( DELTA_STREAM_HEADER_SIZE );
+         }
+
+         const size_t cByteCount =
+            std::min( DELTA_STREAM_HEADER_SIZE - blockFill_, availableByteCount - consumed );
+
+         memcpy( &blockBuffer_[blockFill_], source + consumed, cByteCount );
+         blockFill_ += cByteCount;
+         consumed += cByteCount;
+
+         if ( blockFill_ < DELTA_STREAM_HEADER_SIZE )
+         {
+            continue;
+         }
+
+         // Validates the header and sizes the rest of the block
+         blockByteCount_ = deltaBlockByteCount( blockBuffer_.data() );
+         blockBuffer_.resize( blockByteCount_ );
+      }
+      else
+      {
+         const size_t cByteCount =
+            std::min( blockByteCount_ - blockFill_, availableByteCount - consumed );
+
+         memcpy( &blockBuffer_[blockFill_], source + consumed, cByteCount );
+         blockFill_ += cByteCount;
+         consumed += cByteCount;
+      }
+
+      if ( blockFill_ == blockByteCount_ )
+      {
+         decodeBlock();
+         blockFill_ = 0;
+         blockByteCount_ = 0;
+      }
+   }
+
+   return consumed;
+}
+
+void DeltaIntegerDecoder::stateReset()
+{
+   blockFill_ = 0;
+   blockByteCount_ = 0;
+   pendingValues_.clear();
+   pendingFirst_ = 0;
+}
+
+void DeltaIntegerDecoder::seekToRecord( uint64_t recordIndex, unsigned firstBitOffset )
+{
+   // The delta stream is not bit addressable, so only a full rewind is
+   // supported (fixedRecordBits() returns false, no seek index is built)
+   if ( ( recordIndex != 0 ) || ( firstBitOffset != 0 ) )
+   {
+      throw E57_EXCEPTION2( ErrorInternal, "recordIndex=" + toString( recordIndex ) +
+                                              " firstBitOffset=" + toString( firstBitOffset ) );
+   }
+
+   currentRecordIndex_ = 0;
+   stateReset();
+}
+
+#ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
+void DeltaIntegerDecoder::dump( int indent, std::ostream &os )
+{
+   os << space( indent ) << "bytestreamNumber:   " << bytestreamNumber_ << std::endl;
+   os << space( indent ) << "currentRecordIndex: " << currentRecordIndex_ << std::endl;
+   os << space( indent ) << "maxRecordCount:     " << maxRecordCount_ << std::endl;
+   os << space( indent ) << "isScaledInteger:    " << isScaledInteger_ << std::endl;
+   os << space( indent ) << "minimum:            " << minimum_ << std::endl;
+   os << space( indent ) << "scale:              " << scale_ << std::endl;
+   os << space( indent ) << "offset:             " << offset_ << std::endl;
+   os << space( indent ) << "blockFill:          " << blockFill_ << std::endl;
+   os << space( indent ) << "blockByteCount:     " << blockByteCount_ << std::endl;
+   os << space( indent ) << "pendingValues:      " << pendingValues_.size() << std::endl;
+   os << space( indent ) << "pendingFirst:       " << pendingFirst_ << std::endl;
+   os << space( indent ) << "destBuffer:" << std::endl;
+   destBuffer_->dump( indent + 4, os );
+}
+#endif
+
+//================================================================
+
+CompressedStreamDecoder::CompressedStreamDecoder( std::shared_ptr<Decoder> inner ) :
+   Decoder( inner->bytestreamNumber() ), inner_( std::move( inner ) )
+{
+}
+
+void CompressedStreamDecoder::destBufferSetNew( std::vector<SourceDestBuffer> &dbufs )
+{
+   inner_->destBufferSetNew( dbufs );
+}
+
+bool CompressedStreamDecoder::feedInner()
+{
+   while ( rawBlockFirst_ < rawBlock_.size() )
+   {
+      const size_t cFedCount =
+         inner_->inputProcess( reinterpret_cast<const char *>( rawBlock_.data() ) + rawBlockFirst_,
+                               rawBlock_.size() - rawBlockFirst_ );
+
+      rawBlockFirst_ += cFedCount;
+
+      if ( cFedCount == 0 )
+      {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+size_t CompressedStreamDecoder::inputProcess( const char *source, size_t availableByteCount )
+{
+   size_t consumed = 0;
+
+   while ( true )
+   {
+      // The wrapped decoder must accept the previous block before the next
+      // frame is consumed, so unconsumed input stays with the caller while
+      // the destination buffers are full
+      if ( !feedInner() )
+      {
+         break;
+      }
+
+      if ( consumed == availableByteCount )
+      {
+         break;
+      }
+
+      if ( frameHeaderFill_ < sizeof( frameHeader_ ) )
+      {
+         const size_t cByteCount = std::min( sizeof( frameHeader_ ) - frameHeaderFill_,
+                                             availableByteCount - consumed );
+
+         memcpy( &frameHeader_[frameHeaderFill_], source + consumed, cByteCount );
+         frameHeaderFill_ += cByteCount;
+         consumed += cByteCount;
+
+         if ( frameHeaderFill_ < sizeof( frameHeader_ ) )
+         {
+            continue;
+         }
+
+         memcpy( &rawLength_, &frameHeader_[0], sizeof( rawLength_ ) );
+         memcpy( &storedLength_, &frameHeader_[sizeof( rawLength_ )], sizeof( storedLength_ ) );
+
+         // The writer never stores more bytes than the block held, and
+         // never frames an empty block
+         if ( ( rawLength_ == 0 ) || ( storedLength_ == 0 ) || ( storedLength_ > rawLength_ ) ||
+              ( rawLength_ > 16 * COMPRESSED_STREAM_BLOCK_SIZE ) )
+         {
+            throw E57_EXCEPTION2( ErrorBadCVPacket, "rawLength=" + toString( rawLength_ ) +
+                                                       " storedLength=" +
+                                                       toString( storedLength_ ) );
+         }
+
+         storedBlock_.resize( storedLength_ );
+         storedFill_ = 0;
+         continue;
+      }
+
+      const size_t cByteCount =
+         std::min<size_t>( storedLength_ - storedFill_, availableByteCount - consumed );
+
+      memcpy( &storedBlock_[storedFill_], source + consumed, cByteCount );
+      storedFill_ += cByteCount;
+      consumed += cByteCount;
+
+      if ( storedFill_ == storedLength_ )
+      {
+         rawBlock_.resize( rawLength_ );
+
+         if ( storedLength_ == rawLength_ )
+         {
+            // Block was incompressible and is stored raw
+            memcpy( rawBlock_.data(), storedBlock_.data(), rawLength_ );
+         }
+         else
+         {
+            decompressBlock( storedBlock_.data(), storedLength_, rawBlock_.data(), rawLength_ );
+         }
+
+         rawBlockFirst_ = 0;
+         frameHeaderFill_ = 0;
+      }
+   }
+
+   return consumed;
+}
+
+void CompressedStreamDecoder::stateReset()
+{
+   frameHeaderFill_ = 0;
+   storedFill_ = 0;
+   rawBlock_.clear();
+   rawBlockFirst_ = 0;
+   inner_->stateReset();
+}
+
+void CompressedStreamDecoder::seekToRecord( uint64_t recordIndex, unsigned firstBitOffset )
+{
+   // The compressed stream is not bit addressable, so only a full rewind is
+   // supported (fixedRecordBits() returns false, no seek index is built)
+   if ( ( recordIndex != 0 ) || ( firstBitOffset != 0 ) )
+   {
+      throw E57_EXCEPTION2( ErrorInternal, "recordIndex=" + toString( recordIndex ) +
+                                              " firstBitOffset=" + toString( firstBitOffset ) );
+   }
+
+   frameHeaderFill_ = 0;
+   storedFill_ = 0;
+   rawBlock_.clear();
+   rawBlockFirst_ = 0;
+   inner_->seekToRecord( 0, 0 );
+}
+
+#ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
+void CompressedStreamDecoder::dump( int indent, std::ostream &os )
+{
+   os << space( indent ) << "bytestreamNumber:   " << bytestreamNumber_ << std::endl;
+   os << space( indent ) << "frameHeaderFill:    " << frameHeaderFill_ << std::endl;
+   os << space( indent ) << "rawLength:          " << rawLength_ << std::endl;
+   os << space( indent ) << "storedLength:       " << storedLength_ << std::endl;
+   os << space( indent ) << "storedFill:         " << storedFill_ << std::endl;
+   os << space( indent ) << "rawBlockFirst:      " << rawBlockFirst_ << std::endl;
+   os << space( indent ) << "inner:" << std::endl;
+   inner_->dump( indent + 4, os );
+}
+#endif
@@ -27,6 +27,7 @@
 
 #pragma once
 
+#include "BufferPool.h"
 #include "Common.h"
 
 namespace e57
@@ -38,6 +39,17 @@ namespace e57
                                                       const CompressedVectorNodeImpl *cVector,
                                                       std::vector<SourceDestBuffer> &dbufs,
                                                       const ustring &codecPath );
+
+   private:
+      /// Pick the bitpack/constant decoder for the field's prototype node;
+      /// DecoderFactory() wraps the result when the codecs vector names the
+      /// "lzbs" block compressor (see StreamCompression.h).
+      static std::shared_ptr<Decoder> baseDecoderFactory( unsigned bytestreamNumber,
+                                                          const CompressedVectorNodeImpl *cVector,
+                                                          std::vector<SourceDestBuffer> &dbufs,
+                                                          const ustring &codecPath );
+
+   public:
       Decoder() = delete;
       virtual ~Decoder() = default;
 
@@ -46,11 +58,46 @@ namespace e57
       virtual size_t inputProcess( const char *source, size_t count ) = 0;
       virtual void stateReset() = 0;
 
+      /// Get number of bits each record occupies in the bytestream, when
+      /// every record has the same width. Returns false for variable-width
+      /// streams (strings), whose record positions cannot be computed.
+      virtual bool fixedRecordBits( unsigned &bits ) = 0;
+
+      /// Reposition the decoder so the next record decoded is recordIndex.
+      /// The caller must then feed input starting at the byte containing the
+      /// record's first bit; firstBitOffset gives the bit position within
+      /// that byte.
+      virtual void seekToRecord( uint64_t recordIndex, unsigned firstBitOffset ) = 0;
+
       unsigned bytestreamNumber() const
       {
          return bytestreamNumber_;
       }
 
+      /// Deliver only the records whose index is a multiple of stride; the
+      /// rest are skipped as cheaply as the stream allows (a bit offset
+      /// advance for fixed width streams). 1, the default, delivers every
+      /// record. Virtual so wrapping decoders can forward to the decoder
+      /// doing the record accounting.
+      virtual void setStride( uint64_t stride )
+      {
+         stride_ = stride;
+      }
+
+      /// Decode no records at or beyond limitRecord; region queries use this
+      /// to stop a channel at the end of a record range. UINT64_MAX, the
+      /// default, means no limit. Variable width decoders (strings) ignore
+      /// the limit, since region queries reject them up front.
+      virtual void setLimitRecord( uint64_t limitRecord )
+      {
+         limitRecord_ = limitRecord;
+      }
+
+      uint64_t limitRecord() const
+      {
+         return limitRecord_;
+      }
+
 #ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
       virtual void dump( int indent = 0, std::ostream &os = std::cout ) = 0;
 #endif
@@ -59,11 +106,15 @@ namespace e57
       explicit Decoder( unsigned bytestreamNumber );
 
       unsigned int bytestreamNumber_;
+      uint64_t stride_ = 1;
+      uint64_t limitRecord_ = UINT64_MAX;
    };
 
    class BitpackDecoder : public Decoder
    {
    public:
+      ~BitpackDecoder() override;
+
       void destBufferSetNew( std::vector<SourceDestBuffer> &dbufs ) override;
 
       uint64_t totalRecordsCompleted() override
@@ -76,6 +127,8 @@ namespace e57
 
       void stateReset() override;
 
+      void seekToRecord( uint64_t recordIndex, unsigned firstBitOffset ) override;
+
 #ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
       void dump( int indent = 0, std::ostream &os = std::cout ) override;
 #endif
@@ -91,7 +144,10 @@ namespace e57
 
       std::shared_ptr<SourceDestBufferImpl> destBuffer_;
 
-      std::vector<char> inBuffer_;
+      // The channel input buffer is leased from the image file's pool at
+      // construction and returned by the destructor
+      std::shared_ptr<BufferPool> bufferPool_;
+      StagingBuffer inBuffer_;
       size_t inBufferFirstBit_ = 0;
       size_t inBufferEndByte_ = 0;
       unsigned int inBufferAlignmentSize_;
@@ -107,6 +163,12 @@ namespace e57
 
       size_t inputProcessAligned( const char *inbuf, size_t firstBit, size_t endBit ) override;
 
+      bool fixedRecordBits( unsigned &bits ) override
+      {
+         bits = ( precision_ == PrecisionSingle ) ? 32 : 64;
+         return true;
+      }
+
 #ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
       void dump( int indent = 0, std::ostream &os = std::cout ) override;
 #endif
@@ -123,6 +185,12 @@ namespace e57
 
       size_t inputProcessAligned( const char *inbuf, size_t firstBit, size_t endBit ) override;
 
+      // Strings are variable width, so record positions can't be computed
+      bool fixedRecordBits( unsigned & /*bits*/ ) override
+      {
+         return false;
+      }
+
 #ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
       void dump( int indent = 0, std::ostream &os = std::cout ) override;
 #endif
@@ -146,6 +214,12 @@ namespace e57
 
       size_t inputProcessAligned( const char *inbuf, size_t firstBit, size_t endBit ) override;
 
+      bool fixedRecordBits( unsigned &bits ) override
+      {
+         bits = bitsPerRecord_;
+         return true;
+      }
+
 #ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
       void dump( int indent = 0, std::ostream &os = std::cout ) override;
 #endif
@@ -177,6 +251,18 @@ namespace e57
       size_t inputProcess( const char *source, size_t availableByteCount ) override;
       void stateReset() override;
 
+      // The bytestream carries no bytes at all
+      bool fixedRecordBits( unsigned &bits ) override
+      {
+         bits = 0;
+         return true;
+      }
+
+      void seekToRecord( uint64_t recordIndex, unsigned /*firstBitOffset*/ ) override
+      {
+         currentRecordIndex_ = recordIndex;
+      }
+
 #ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
       void dump( int indent = 0, std::ostream &os = std::cout ) override;
 #endif
@@ -192,4 +278,127 @@ namespace e57
       double scale_;
       double offset_;
    };
+
+   /// Decodes the byte-aligned zigzag delta blocks a DeltaIntegerEncoder
+   /// produced (see StreamCompression.h). Negotiated by DecoderFactory()
+   /// from the CompressedVector's codecs vector when the "dlta" extension is
+   /// in use. The per-block width makes record positions variable, so
+   /// fixedRecordBits() reports false and seeking supports only a full
+   /// rewind.
+   class DeltaIntegerDecoder : public Decoder
+   {
+   public:
+      DeltaIntegerDecoder( bool isScaledInteger, unsigned bytestreamNumber, SourceDestBuffer &dbuf,
+                           int64_t minimum, double scale, double offset, uint64_t maxRecordCount );
+
+      void destBufferSetNew( std::vector<SourceDestBuffer> &dbufs ) override;
+
+      uint64_t totalRecordsCompleted() override
+      {
+         return currentRecordIndex_;
+      }
+
+      size_t inputProcess( const char *source, size_t availableByteCount ) override;
+      void stateReset() override;
+
+      // The per-block width makes record positions variable
+      bool fixedRecordBits( unsigned & ) override
+      {
+         return false;
+      }
+
+      void seekToRecord( uint64_t recordIndex, unsigned firstBitOffset ) override;
+
+#ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
+      void dump( int indent = 0, std::ostream &os = std::cout ) override;
+#endif
+
+   protected:
+      /// Unpack the completed block in blockBuffer_ into pendingValues_
+      void decodeBlock();
+      /// Move pending decoded records to the destination buffer; returns
+      /// false when it fills up.
+      bool deliverPending();
+
+      uint64_t currentRecordIndex_ = 0;
+      uint64_t maxRecordCount_;
+
+      std::shared_ptr<SourceDestBufferImpl> destBuffer_;
+
+      bool isScaledInteger_;
+      int64_t minimum_;
+      double scale_;
+      double offset_;
+
+      // One block in flight: header and packed bytes accumulate in
+      // blockBuffer_ (blockByteCount_ is 0 until the header is complete),
+      // then decode into pendingValues_ for delivery
+      std::vector<uint8_t> blockBuffer_;
+      size_t blockFill_ = 0;
+      size_t blockByteCount_ = 0;
+      std::vector<int64_t> pendingValues_;
+      size_t pendingFirst_ = 0;
+   };
+
+   /// Wraps another decoder, reassembling and decompressing the framed
+   /// LZ77 blocks a CompressedStreamEncoder produced before feeding the
+   /// wrapped decoder (see StreamCompression.h). Negotiated by
+   /// DecoderFactory() from the CompressedVector's codecs vector.
+   class CompressedStreamDecoder : public Decoder
+   {
+   public:
+      explicit CompressedStreamDecoder( std::shared_ptr<Decoder> inner );
+
+      void destBufferSetNew( std::vector<SourceDestBuffer> &dbufs ) override;
+
+      uint64_t totalRecordsCompleted() override
+      {
+         return inner_->totalRecordsCompleted();
+      }
+
+      size_t inputProcess( const char *source, size_t availableByteCount ) override;
+      void stateReset() override;
+
+      // Record positions can't be computed in the compressed stream
+      bool fixedRecordBits( unsigned & ) override
+      {
+         return false;
+      }
+
+      void seekToRecord( uint64_t recordIndex, unsigned firstBitOffset ) override;
+
+      void setStride( uint64_t stride ) override
+      {
+         Decoder::setStride( stride );
+         inner_->setStride( stride );
+      }
+
+      void setLimitRecord( uint64_t limitRecord ) override
+      {
+         Decoder::setLimitRecord( limitRecord );
+         inner_->setLimitRecord( limitRecord );
+      }
+
+#ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
+      void dump( int indent = 0, std::ostream &os = std::cout ) override;
+#endif
+
+   protected:
+      /// Feed pending decompressed bytes to the wrapped decoder; returns
+      /// false when it stalls (its destination buffers are full).
+      bool feedInner();
+
+      std::shared_ptr<Decoder> inner_;
+
+      // One frame in flight: its 8 byte header (raw and stored counts),
+      // then the stored payload, then the decompressed block being fed
+      uint8_t frameHeader_[8] = {};
+      size_t frameHeaderFill_ = 0;
+      uint32_t rawLength_ = 0;
+      uint32_t storedLength_ = 0;
+      std::vector<uint8_t> storedBlock_;
+      size_t storedFill_ = 0;
+      std::vector<uint8_t> rawBlock_;
+      size_t rawBlockFirst_ = 0;
+   };
 }
@@ -359,6 +359,9 @@ namespace e57
          case ErrorInvalidData3DValue:
             return "an invalid value was passed in Data3D pointFields";
 
+         case ErrorTransferCanceled:
+            return "a transfer was canceled by a progress callback";
+
          default:
             return "unknown error (" + std::to_string( ecode ) + ")";
       }
@@ -13,6 +13,15 @@
 #include "Common.h"
 #include "StringFunctions.h"
 
+#include <cstdlib>
+#include <new>
+
+#if defined( __linux__ )
+#include <sys/mman.h>
+#elif defined( _MSC_VER )
+#include <malloc.h>
+#endif
+
 namespace e57
 {
    /// Validates a Data3D and throws on error.
@@ -49,11 +58,11 @@ namespace e57
       elevationMaximum = HALF_PI;
    }
 
-   template <typename COORDTYPE>
-   Data3DPointsData_t<COORDTYPE>::Data3DPointsData_t( Data3D &data3D ) : _selfAllocated( true )
+   /// Validates a Data3D and adjusts its pointFields for the memory representation COORDTYPE:
+   /// min/max bounds for floats, and the floating point node types when not ScaledInteger.
+   /// Shared by the allocating Data3DPointsData_t and Data3DPointsSlab_t constructors.
+   template <typename COORDTYPE> static void _prepareData3DHeader( Data3D &data3D )
    {
-      static_assert( std::is_floating_point<COORDTYPE>::value, "Floating point type required." );
-
       _validateData3D( data3D );
 
       constexpr bool cIsFloat = std::is_same<COORDTYPE, float>::value;
@@ -84,8 +93,23 @@ namespace e57
          data3D.pointFields.angleNodeType =
             ( cIsFloat ? NumericalNodeType::Float : NumericalNodeType::Double );
       }
+   }
+
+   template <typename COORDTYPE>
+   Data3DPointsData_t<COORDTYPE>::Data3DPointsData_t( Data3D &data3D ) :
+      Data3DPointsData_t( data3D, static_cast<size_t>( data3D.pointCount ) )
+   {
+   }
 
-      const auto cPointCount = data3D.pointCount;
+   template <typename COORDTYPE>
+   Data3DPointsData_t<COORDTYPE>::Data3DPointsData_t( Data3D &data3D, size_t bufferCount ) :
+      _selfAllocated( true )
+   {
+      static_assert( std::is_floating_point<COORDTYPE>::value, "Floating point type required." );
+
+      _prepareData3DHeader<COORDTYPE>( data3D );
+
+      const auto cPointCount = bufferCount;
 
       if ( data3D.pointFields.cartesianXField )
       {
@@ -247,11 +271,390 @@ namespace e57
       *this = Data3DPointsData_t<COORDTYPE>();
    }
 
+   namespace
+   {
+      // Per-field alignment inside the slab: one cache line, which also covers the widest
+      // SIMD loads the decoders issue.
+      constexpr size_t cSlabAlignment = 64;
+
+      void *_allocateSlab( size_t size, bool useHugePages, bool &isMapped )
+      {
+         isMapped = false;
+
+#if defined( __linux__ )
+         if ( useHugePages )
+         {
+            void *mem = ::mmap( nullptr, size, PROT_READ | PROT_WRITE,
+                                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+            if ( mem != MAP_FAILED )
+            {
+               // Advisory only; the kernel backs what it can with huge pages.
+               ::madvise( mem, size, MADV_HUGEPAGE );
+               isMapped = true;
+               return mem;
+            }
+
+            // Fall through to the normal allocator if the mapping failed.
+         }
+#else
+         UNUSED( useHugePages );
+#endif
+
+#if defined( _MSC_VER )
+         void *mem = _aligned_malloc( size, cSlabAlignment );
+         if ( mem == nullptr )
+         {
+            throw std::bad_alloc();
+         }
+#else
+         void *mem = nullptr;
+         if ( posix_memalign( &mem, cSlabAlignment, size ) != 0 )
+         {
+            throw std::bad_alloc();
+         }
+#endif
+         return mem;
+      }
+
+      void _freeSlab( void *slab, size_t size, bool isMapped )
+      {
+#if defined( __linux__ )
+         if ( isMapped )
+         {
+            ::munmap( slab, size );
+            return;
+         }
+#else
+         UNUSED( isMapped );
+#endif
+         UNUSED( size );
+
+#if defined( _MSC_VER )
+         _aligned_free( slab );
+#else
+         free( slab );
+#endif
+      }
+   }
+
+   template <typename COORDTYPE>
+   Data3DPointsSlab_t<COORDTYPE>::Data3DPointsSlab_t( Data3D &data3D, bool useHugePages ) :
+      Data3DPointsSlab_t( data3D, static_cast<size_t>( data3D.pointCount ), useHugePages )
+   {
+   }
+
+   template <typename COORDTYPE>
+   Data3DPointsSlab_t<COORDTYPE>::Data3DPointsSlab_t( Data3D &data3D, size_t bufferCount,
+                                                      bool useHugePages )
+   {
+      static_assert( std::is_floating_point<COORDTYPE>::value, "Floating point type required." );
+
+      _prepareData3DHeader<COORDTYPE>( data3D );
+
+      const auto cPointCount = bufferCount;
+      const auto &cFields = data3D.pointFields;
+
+      // Walked twice: first with a null base to measure the slab, then again to carve the
+      // field buffers out of it. Each enabled field starts on a cSlabAlignment boundary.
+      char *slabBase = nullptr;
+      size_t total = 0;
+
+      auto place = [&]( auto *&pointer, bool enabled ) {
+         using ElementType = typename std::remove_reference<decltype( *pointer )>::type;
+
+         if ( !enabled )
+         {
+            return;
+         }
+
+         if ( slabBase != nullptr )
+         {
+            pointer = reinterpret_cast<ElementType *>( slabBase + total );
+         }
+
+         total += ( sizeof( ElementType ) * cPointCount + cSlabAlignment - 1 ) &
+                  ~( cSlabAlignment - 1 );
+      };
+
+      auto placeAll = [&]() {
+         total = 0;
+
+         place( this->cartesianX, cFields.cartesianXField );
+         place( this->cartesianY, cFields.cartesianYField );
+         place( this->cartesianZ, cFields.cartesianZField );
+         place( this->cartesianInvalidState, cFields.cartesianInvalidStateField );
+
+         place( this->intensity, cFields.intensityField );
+         place( this->isIntensityInvalid, cFields.isIntensityInvalidField );
+
+         place( this->colorRed, cFields.colorRedField );
+         place( this->colorGreen, cFields.colorGreenField );
+         place( this->colorBlue, cFields.colorBlueField );
+         place( this->isColorInvalid, cFields.isColorInvalidField );
+
+         place( this->sphericalRange, cFields.sphericalRangeField );
+         place( this->sphericalAzimuth, cFields.sphericalAzimuthField );
+         place( this->sphericalElevation, cFields.sphericalElevationField );
+         place( this->sphericalInvalidState, cFields.sphericalInvalidStateField );
+
+         place( this->rowIndex, cFields.rowIndexField );
+         place( this->columnIndex, cFields.columnIndexField );
+
+         place( this->returnIndex, cFields.returnIndexField );
+         place( this->returnCount, cFields.returnCountField );
+
+         place( this->timeStamp, cFields.timeStampField );
+         place( this->isTimeStampInvalid, cFields.isTimeStampInvalidField );
+
+         place( this->normalX, cFields.normalXField );
+         place( this->normalY, cFields.normalYField );
+         place( this->normalZ, cFields.normalZField );
+      };
+
+      placeAll();
+
+      if ( total == 0 )
+      {
+         return;
+      }
+
+      _slabSize = total;
+      _slab = _allocateSlab( _slabSize, useHugePages, _slabIsMapped );
+
+      slabBase = static_cast<char *>( _slab );
+      placeAll();
+   }
+
+   template <typename COORDTYPE> Data3DPointsSlab_t<COORDTYPE>::~Data3DPointsSlab_t()
+   {
+      // The base destructor is a no-op here (it only frees per-field allocations); every
+      // field buffer lives in the slab and goes away with it.
+      if ( _slab != nullptr )
+      {
+         _freeSlab( _slab, _slabSize, _slabIsMapped );
+         _slab = nullptr;
+      }
+   }
+
+   void NormalizeIntensity( const IntensityLimits &limits, double *intensity, size_t pointCount )
+   {
+      const double cRange = limits.intensityMaximum - limits.intensityMinimum;
+
+      if ( ( intensity == nullptr ) || !( cRange > 0.0 ) )
+      {
+         return;
+      }
+
+      // One fused multiply-add per element over the contiguous batch; hoisting the
+      // constants and restricting the pointer keeps the loop trivially vectorizable.
+      const double cScale = 1.0 / cRange;
+      const double cOffset = -limits.intensityMinimum * cScale;
+      double *E57_RESTRICT out = intensity;
+
+      for ( size_t i = 0; i < pointCount; i++ )
+      {
+         out[i] = out[i] * cScale + cOffset;
+      }
+   }
+
+   /// Rescales one color channel from [minimum, maximum] to [0, 255]. The math is done in
+   /// float: a uint16_t is exactly representable and the narrower lanes double the SIMD width
+   /// of the multiply-add compared to double.
+   static void _normalizeColorChannel( double minimum, double maximum, uint16_t *channel,
+                                       size_t pointCount )
+   {
+      const double cRange = maximum - minimum;
+
+      if ( ( channel == nullptr ) || !( cRange > 0.0 ) )
+      {
+         return;
+      }
+
+      const float cScale = static_cast<float>( 255.0 / cRange );
+      const float cOffset = static_cast<float>( -minimum * ( 255.0 / cRange ) + 0.5 );
+      uint16_t *E57_RESTRICT out = channel;
+
+      for ( size_t i = 0; i < pointCount; i++ )
+      {
+         out[i] = static_cast<uint16_t>( static_cast<float>( out[i] ) * cScale + cOffset );
+      }
+   }
+
+   void NormalizeColor( const ColorLimits &limits, uint16_t *colorRed, uint16_t *colorGreen,
+                        uint16_t *colorBlue, size_t pointCount )
+   {
+      _normalizeColorChannel( limits.colorRedMinimum, limits.colorRedMaximum, colorRed,
+                              pointCount );
+      _normalizeColorChannel( limits.colorGreenMinimum, limits.colorGreenMaximum, colorGreen,
+                              pointCount );
+      _normalizeColorChannel( limits.colorBlueMinimum, limits.colorBlueMaximum, colorBlue,
+                              pointCount );
+   }
+
+   template <typename COORDTYPE>
+   void ConvertSphericalToCartesian( const COORDTYPE *sphericalRange,
+                                     const COORDTYPE *sphericalAzimuth,
+                                     const COORDTYPE *sphericalElevation, COORDTYPE *cartesianX,
+                                     COORDTYPE *cartesianY, COORDTYPE *cartesianZ,
+                                     size_t pointCount )
+   {
+      const COORDTYPE *E57_RESTRICT range = sphericalRange;
+      const COORDTYPE *E57_RESTRICT azimuth = sphericalAzimuth;
+      const COORDTYPE *E57_RESTRICT elevation = sphericalElevation;
+      COORDTYPE *E57_RESTRICT x = cartesianX;
+      COORDTYPE *E57_RESTRICT y = cartesianY;
+      COORDTYPE *E57_RESTRICT z = cartesianZ;
+
+      // All three outputs from one walk over the inputs: each point's sin/cos
+      // results are reused while still in registers, and the loop has no
+      // cross-iteration dependencies, so compilers with a vector math library
+      // can batch the sincos calls.
+      for ( size_t i = 0; i < pointCount; i++ )
+      {
+         const COORDTYPE cCosElevation = std::cos( elevation[i] );
+         const COORDTYPE cRangeCosElevation = range[i] * cCosElevation;
+
+         x[i] = cRangeCosElevation * std::cos( azimuth[i] );
+         y[i] = cRangeCosElevation * std::sin( azimuth[i] );
+         z[i] = range[i] * std::sin( elevation[i] );
+      }
+   }
+
+   template <typename COORDTYPE>
+   void ConvertSphericalToCartesian( Data3DPointsData_t<COORDTYPE> &buffers, size_t pointCount )
+   {
+      if ( ( buffers.sphericalRange == nullptr ) || ( buffers.sphericalAzimuth == nullptr ) ||
+           ( buffers.sphericalElevation == nullptr ) || ( buffers.cartesianX == nullptr ) ||
+           ( buffers.cartesianY == nullptr ) || ( buffers.cartesianZ == nullptr ) )
+      {
+         return;
+      }
+
+      ConvertSphericalToCartesian( buffers.sphericalRange, buffers.sphericalAzimuth,
+                                   buffers.sphericalElevation, buffers.cartesianX,
+                                   buffers.cartesianY, buffers.cartesianZ, pointCount );
+   }
+
+   template <typename COORDTYPE>
+   void ApplyPose( const RigidBodyTransform &pose, COORDTYPE *cartesianX, COORDTYPE *cartesianY,
+                   COORDTYPE *cartesianZ, size_t pointCount )
+   {
+      const Quaternion &q = pose.rotation;
+
+      // Expand the quaternion to a rotation matrix once. The standard expansion
+      // assumes a unit quaternion; scaling by 2/norm makes it exact for the
+      // slightly-off-unit quaternions that survive a round trip through the
+      // file's double fields.
+      const double cNorm = ( q.w * q.w ) + ( q.x * q.x ) + ( q.y * q.y ) + ( q.z * q.z );
+      const double s = ( cNorm > 0.0 ) ? ( 2.0 / cNorm ) : 0.0;
+
+      // The matrix and translation are applied in COORDTYPE so the float
+      // instantiation runs with full-width float lanes.
+      const auto r00 = static_cast<COORDTYPE>( 1.0 - s * ( ( q.y * q.y ) + ( q.z * q.z ) ) );
+      const auto r01 = static_cast<COORDTYPE>( s * ( ( q.x * q.y ) - ( q.z * q.w ) ) );
+      const auto r02 = static_cast<COORDTYPE>( s * ( ( q.x * q.z ) + ( q.y * q.w ) ) );
+      const auto r10 = static_cast<COORDTYPE>( s * ( ( q.x * q.y ) + ( q.z * q.w ) ) );
+      const auto r11 = static_cast<COORDTYPE>( 1.0 - s * ( ( q.x * q.x ) + ( q.z * q.z ) ) );
+      const auto r12 = static_cast<COORDTYPE>( s * ( ( q.y * q.z ) - ( q.x * q.w ) ) );
+      const auto r20 = static_cast<COORDTYPE>( s * ( ( q.x * q.z ) - ( q.y * q.w ) ) );
+      const auto r21 = static_cast<COORDTYPE>( s * ( ( q.y * q.z ) + ( q.x * q.w ) ) );
+      const auto r22 = static_cast<COORDTYPE>( 1.0 - s * ( ( q.x * q.x ) + ( q.y * q.y ) ) );
+
+      const auto tx = static_cast<COORDTYPE>( pose.translation.x );
+      const auto ty = static_cast<COORDTYPE>( pose.translation.y );
+      const auto tz = static_cast<COORDTYPE>( pose.translation.z );
+
+      COORDTYPE *E57_RESTRICT x = cartesianX;
+      COORDTYPE *E57_RESTRICT y = cartesianY;
+      COORDTYPE *E57_RESTRICT z = cartesianZ;
+
+      for ( size_t i = 0; i < pointCount; i++ )
+      {
+         const COORDTYPE cX = x[i];
+         const COORDTYPE cY = y[i];
+         const COORDTYPE cZ = z[i];
+
+         x[i] = ( r00 * cX ) + ( r01 * cY ) + ( r02 * cZ ) + tx;
+         y[i] = ( r10 * cX ) + ( r11 * cY ) + ( r12 * cZ ) + ty;
+         z[i] = ( r20 * cX ) + ( r21 * cY ) + ( r22 * cZ ) + tz;
+      }
+   }
+
+   template <typename COORDTYPE>
+   void ApplyPose( const Data3D &data3D, Data3DPointsData_t<COORDTYPE> &buffers,
+                   size_t pointCount )
+   {
+      if ( ( buffers.cartesianX == nullptr ) || ( buffers.cartesianY == nullptr ) ||
+           ( buffers.cartesianZ == nullptr ) )
+      {
+         return;
+      }
+
+      ApplyPose( data3D.pose, buffers.cartesianX, buffers.cartesianY, buffers.cartesianZ,
+                 pointCount );
+   }
+
+   template <typename COORDTYPE>
+   void NormalizeData3DPointsData( const Data3D &data3D, Data3DPointsData_t<COORDTYPE> &buffers,
+                                   size_t pointCount )
+   {
+      if ( data3D.pointFields.intensityField )
+      {
+         NormalizeIntensity( data3D.intensityLimits, buffers.intensity, pointCount );
+      }
+
+      if ( data3D.pointFields.colorRedField || data3D.pointFields.colorGreenField ||
+           data3D.pointFields.colorBlueField )
+      {
+         NormalizeColor( data3D.colorLimits, buffers.colorRed, buffers.colorGreen,
+                         buffers.colorBlue, pointCount );
+      }
+   }
+
 #if defined( WIN32 ) || defined( _WIN32 ) || defined( WINCE )
    template struct E57_DLL Data3DPointsData_t<float>;
    template struct E57_DLL Data3DPointsData_t<double>;
+   template struct E57_DLL Data3DPointsSlab_t<float>;
+   template struct E57_DLL Data3DPointsSlab_t<double>;
+   template E57_DLL void NormalizeData3DPointsData<float>( const Data3D &,
+                                                           Data3DPointsData_t<float> &, size_t );
+   template E57_DLL void NormalizeData3DPointsData<double>( const Data3D &,
+                                                            Data3DPointsData_t<double> &, size_t );
+   template E57_DLL void ConvertSphericalToCartesian<float>( const float *, const float *,
+                                                             const float *, float *, float *,
+                                                             float *, size_t );
+   template E57_DLL void ConvertSphericalToCartesian<double>( const double *, const double *,
+                                                              const double *, double *, double *,
+                                                              double *, size_t );
+   template E57_DLL void ConvertSphericalToCartesian<float>( Data3DPointsData_t<float> &, size_t );
+   template E57_DLL void ConvertSphericalToCartesian<double>( Data3DPointsData_t<double> &,
+                                                              size_t );
+   template E57_DLL void ApplyPose<float>( const RigidBodyTransform &, float *, float *, float *,
+                                           size_t );
+   template E57_DLL void ApplyPose<double>( const RigidBodyTransform &, double *, double *,
+                                            double *, size_t );
+   template E57_DLL void ApplyPose<float>( const Data3D &, Data3DPointsData_t<float> &, size_t );
+   template E57_DLL void ApplyPose<double>( const Data3D &, Data3DPointsData_t<double> &, size_t );
 #else
    template struct Data3DPointsData_t<float>;
    template struct Data3DPointsData_t<double>;
+   template struct Data3DPointsSlab_t<float>;
+   template struct Data3DPointsSlab_t<double>;
+   template void NormalizeData3DPointsData<float>( const Data3D &, Data3DPointsData_t<float> &,
+                                                   size_t );
+   template void NormalizeData3DPointsData<double>( const Data3D &, Data3DPointsData_t<double> &,
+                                                    size_t );
+   template void ConvertSphericalToCartesian<float>( const float *, const float *, const float *,
+                                                     float *, float *, float *, size_t );
+   template void ConvertSphericalToCartesian<double>( const double *, const double *,
+                                                      const double *, double *, double *, double *,
+                                                      size_t );
+   template void ConvertSphericalToCartesian<float>( Data3DPointsData_t<float> &, size_t );
+   template void ConvertSphericalToCartesian<double>( Data3DPointsData_t<double> &, size_t );
+   template void ApplyPose<float>( const RigidBodyTransform &, float *, float *, float *, size_t );
+   template void ApplyPose<double>( const RigidBodyTransform &, double *, double *, double *,
+                                    size_t );
+   template void ApplyPose<float>( const Data3D &, Data3DPointsData_t<float> &, size_t );
+   template void ApplyPose<double>( const Data3D &, Data3DPointsData_t<double> &, size_t );
 #endif
 } // end namespace e57
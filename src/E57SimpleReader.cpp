@@ -26,8 +26,12 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include "Common.h"
+#include "DatasetReaderImpl.h"
 #include "E57SimpleReader.h"
 #include "ReaderImpl.h"
+#include "StringFunctions.h"
+#include "TraceImpl.h"
 
 namespace e57
 {
@@ -75,6 +79,12 @@ namespace e57
                                      imageHeight, imageSize, imageMaskType, imageVisualType );
    };
 
+   int64_t Reader::GetImage2DDataSize( int64_t imageIndex, Image2DProjection imageProjection,
+                                       Image2DType imageType ) const
+   {
+      return impl_->GetImage2DDataSize( imageIndex, imageProjection, imageType );
+   }
+
    int64_t Reader::ReadImage2DData( int64_t imageIndex, Image2DProjection imageProjection,
                                     Image2DType imageType, void *pBuffer, int64_t start,
                                     int64_t count ) const
@@ -88,6 +98,12 @@ namespace e57
       return static_cast<int64_t>( read );
    };
 
+   std::vector<std::future<int64_t>>
+   Reader::ReadImage2DDataAsync( const std::vector<Image2DDataRequest> &requests ) const
+   {
+      return impl_->ReadImage2DDataAsync( requests );
+   };
+
    int64_t Reader::GetData3DCount() const
    {
       return impl_->GetData3DCount();
@@ -145,4 +161,164 @@ namespace e57
    {
       return impl_->SetUpData3DPointsData( dataIndex, pointCount, buffers );
    }
+
+   template <typename COORDTYPE>
+   Data3D Data3DPointsStream_t<COORDTYPE>::_readHeader( const Reader &reader, int64_t dataIndex,
+                                                        bool convertSphericalToCartesian )
+   {
+      Data3D header;
+
+      if ( !reader.ReadData3D( dataIndex, header ) )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument, "dataIndex=" + toString( dataIndex ) );
+      }
+
+      // Enable the Cartesian fields so the buffer constructor allocates the
+      // conversion's destination arrays; the file's prototype is untouched, so
+      // the extra buffers are simply not read into.
+      if ( convertSphericalToCartesian && header.pointFields.sphericalRangeField &&
+           header.pointFields.sphericalAzimuthField && header.pointFields.sphericalElevationField )
+      {
+         header.pointFields.cartesianXField = true;
+         header.pointFields.cartesianYField = true;
+         header.pointFields.cartesianZField = true;
+      }
+
+      return header;
+   }
+
+   template <typename COORDTYPE>
+   Data3DPointsStream_t<COORDTYPE>::Data3DPointsStream_t( const Reader &reader, int64_t dataIndex,
+                                                          size_t batchSize,
+                                                          bool convertSphericalToCartesian,
+                                                          bool applyPose ) :
+      data3D_( _readHeader( reader, dataIndex, convertSphericalToCartesian ) ),
+      buffers_( data3D_, batchSize ),
+      reader_( reader.SetUpData3DPointsData( dataIndex, batchSize, buffers_ ) ),
+      convertSphericalToCartesian_( convertSphericalToCartesian ), applyPose_( applyPose )
+   {
+   }
+
+   template <typename COORDTYPE> Data3DPointsStream_t<COORDTYPE>::~Data3DPointsStream_t()
+   {
+      try
+      {
+         close();
+      }
+      catch ( ... )
+      {
+         //??? report?
+      }
+   }
+
+   template <typename COORDTYPE> uint64_t Data3DPointsStream_t<COORDTYPE>::read()
+   {
+      const uint64_t cCount = reader_.read();
+
+      E57_TRACE_SPAN_SIZED( "convert", cCount );
+
+      if ( convertSphericalToCartesian_ && ( cCount > 0 ) )
+      {
+         ConvertSphericalToCartesian( buffers_, static_cast<size_t>( cCount ) );
+      }
+
+      if ( applyPose_ && ( cCount > 0 ) )
+      {
+         ApplyPose( data3D_, buffers_, static_cast<size_t>( cCount ) );
+      }
+
+      return cCount;
+   }
+
+   template <typename COORDTYPE> void Data3DPointsStream_t<COORDTYPE>::close()
+   {
+      if ( reader_.isOpen() )
+      {
+         reader_.close();
+      }
+   }
+
+#if defined( WIN32 ) || defined( _WIN32 ) || defined( WINCE )
+   template class E57_DLL Data3DPointsStream_t<float>;
+   template class E57_DLL Data3DPointsStream_t<double>;
+#else
+   template class Data3DPointsStream_t<float>;
+   template class Data3DPointsStream_t<double>;
+#endif
+
+   DatasetReader::DatasetReader( const std::vector<ustring> &filePaths,
+                                 const DatasetReaderOptions &options ) :
+      impl_( new DatasetReaderImpl( filePaths, options ) )
+   {
+   }
+
+   bool DatasetReader::IsOpen() const
+   {
+      return impl_->IsOpen();
+   }
+
+   bool DatasetReader::Close()
+   {
+      return impl_->Close();
+   }
+
+   size_t DatasetReader::GetFileCount() const
+   {
+      return impl_->GetFileCount();
+   }
+
+   Reader DatasetReader::GetFileReader( size_t fileIndex ) const
+   {
+      return impl_->GetFileReader( fileIndex );
+   }
+
+   int64_t DatasetReader::GetData3DCount() const
+   {
+      return impl_->GetData3DCount();
+   }
+
+   bool DatasetReader::GetData3DLocation( int64_t dataIndex, size_t &fileIndex,
+                                          int64_t &localIndex ) const
+   {
+      return impl_->GetData3DLocation( dataIndex, fileIndex, localIndex );
+   }
+
+   bool DatasetReader::ReadData3D( int64_t dataIndex, Data3D &data3DHeader ) const
+   {
+      return impl_->ReadData3D( dataIndex, data3DHeader );
+   }
+
+   bool DatasetReader::GetData3DSizes( int64_t dataIndex, int64_t &rowMax, int64_t &columnMax,
+                                       int64_t &pointsSize, int64_t &groupsSize,
+                                       int64_t &countSize, bool &columnIndex ) const
+   {
+      return impl_->GetData3DSizes( dataIndex, rowMax, columnMax, pointsSize, groupsSize,
+                                    countSize, columnIndex );
+   }
+
+   bool DatasetReader::ReadData3DGroupsData( int64_t dataIndex, int64_t groupCount,
+                                             int64_t *idElementValue, int64_t *startPointIndex,
+                                             int64_t *pointCount ) const
+   {
+      return impl_->ReadData3DGroupsData( dataIndex, groupCount, idElementValue, startPointIndex,
+                                          pointCount );
+   }
+
+   CompressedVectorReader DatasetReader::SetUpData3DPointsData(
+      int64_t dataIndex, size_t pointCount, const Data3DPointsFloat &buffers ) const
+   {
+      return impl_->SetUpData3DPointsData( dataIndex, pointCount, buffers );
+   }
+
+   CompressedVectorReader DatasetReader::SetUpData3DPointsData(
+      int64_t dataIndex, size_t pointCount, const Data3DPointsDouble &buffers ) const
+   {
+      return impl_->SetUpData3DPointsData( dataIndex, pointCount, buffers );
+   }
+
+   void DatasetReader::ForEachData3D( const std::vector<int64_t> &dataIndices,
+                                      const std::function<void( int64_t dataIndex )> &job ) const
+   {
+      impl_->ForEachData3D( dataIndices, job );
+   }
 } // end namespace e57
@@ -162,6 +162,31 @@ namespace
                                   const e57::Data3DPointsFloat &inBuffers );
    template void _fillMinMaxData( e57::Data3D &ioData3DHeader,
                                   const e57::Data3DPointsDouble &inBuffers );
+
+   /// Packages the WriteData3DData() sequence as a job for the writer's internal write
+   /// thread. The header is copied since the job usually outlives the caller's call frame.
+   /// @p impl is captured raw: the jobs never outlive the WriterImpl, which drains the
+   /// queue before it is destroyed.
+   template <typename COORDTYPE>
+   std::future<int64_t> _enqueueData3DWrite(
+      e57::WriterImpl *impl, const e57::Data3D &data3DHeader,
+      std::shared_ptr<const e57::Data3DPointsData_t<COORDTYPE>> buffers )
+   {
+      return impl->EnqueueData3DWrite(
+         [impl, header = data3DHeader, buffers]() mutable -> int64_t {
+            _fillMinMaxData( header, *buffers );
+
+            const int64_t scanIndex = impl->NewData3D( header );
+
+            e57::CompressedVectorWriter dataWriter =
+               impl->SetUpData3DPointsData( scanIndex, header.pointCount, *buffers );
+
+            dataWriter.write( header.pointCount );
+            dataWriter.close();
+
+            return scanIndex;
+         } );
+   }
 }
 
 namespace e57
@@ -202,6 +227,21 @@ namespace e57
       return static_cast<int64_t>( written );
    };
 
+   std::future<int64_t> Writer::WriteImage2DDataAsync( Image2D &image2DHeader,
+                                                       Image2DType imageType,
+                                                       Image2DProjection imageProjection,
+                                                       void *pBuffer, int64_t byteCount )
+   {
+      auto *buffer = static_cast<uint8_t *>( pBuffer );
+
+      // The header write also reserves the blob's file section, so the
+      // background write below lands in its own pre-allocated range.
+      const int64_t imageIndex = impl_->NewImage2D( image2DHeader );
+
+      return impl_->WriteImage2DDataAsync( imageIndex, imageType, imageProjection, buffer,
+                                           byteCount );
+   }
+
    int64_t Writer::NewImage2D( Image2D &image2DHeader )
    {
       return impl_->NewImage2D( image2DHeader );
@@ -250,6 +290,18 @@ namespace e57
       return scanIndex;
    }
 
+   std::future<int64_t> Writer::WriteData3DDataAsync(
+      const Data3D &data3DHeader, std::shared_ptr<const Data3DPointsFloat> buffers )
+   {
+      return _enqueueData3DWrite<float>( impl_.get(), data3DHeader, std::move( buffers ) );
+   }
+
+   std::future<int64_t> Writer::WriteData3DDataAsync(
+      const Data3D &data3DHeader, std::shared_ptr<const Data3DPointsDouble> buffers )
+   {
+      return _enqueueData3DWrite<double>( impl_.get(), data3DHeader, std::move( buffers ) );
+   }
+
    int64_t Writer::NewData3D( Data3D &data3DHeader )
    {
       return impl_->NewData3D( data3DHeader );
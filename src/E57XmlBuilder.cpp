@@ -0,0 +1,1058 @@
+/*
+ * Original work Copyright 2009 - 2010 Kevin Ackley (kackley@gwi.net)
+ * Modified work Copyright 2018 - 2020 Andy Maloney <asmaloney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <cstdlib>
+
+#include "BlobNodeImpl.h"
+#include "CheckedFile.h"
+#include "CompressedVectorNodeImpl.h"
+#include "E57XmlBuilder.h"
+#include "FloatNodeImpl.h"
+#include "ImageFileImpl.h"
+#include "IntegerNodeImpl.h"
+#include "ScaledIntegerNodeImpl.h"
+#include "StringFunctions.h"
+#include "StringNodeImpl.h"
+#include "VectorNodeImpl.h"
+
+namespace
+{
+   inline int64_t convertStrToLL( const std::string &inStr )
+   {
+#if defined( _MSC_VER )
+      return _atoi64( inStr.c_str() );
+#elif defined( __GNUC__ )
+      return strtoll( inStr.c_str(), nullptr, 10 );
+#else
+#error "Need to define string to long long conversion for this compiler"
+#endif
+   }
+}
+
+namespace e57
+{
+   //=============================================================================
+   // XmlAttributes
+
+   bool XmlAttributes::isDefined( const char *qName ) const
+   {
+      for ( const auto &pair : pairs_ )
+      {
+         if ( pair.first == qName )
+         {
+            return true;
+         }
+      }
+      return false;
+   }
+
+   const ustring &XmlAttributes::get( const char *qName ) const
+   {
+      for ( const auto &pair : pairs_ )
+      {
+         if ( pair.first == qName )
+         {
+            return pair.second;
+         }
+      }
+      throw E57_EXCEPTION2( ErrorBadXMLFormat, "attributeName=" + ustring( qName ) );
+   }
+
+   //=============================================================================
+   // E57XmlBuilder::ParseInfo
+
+   E57XmlBuilder::ParseInfo::ParseInfo() :
+      nodeType( static_cast<NodeType>( 0 ) ), minimum( 0 ), maximum( 0 ), scale( 0 ), offset( 0 ),
+      precision( static_cast<FloatPrecision>( 0 ) ), floatMinimum( 0 ), floatMaximum( 0 ),
+      fileOffset( 0 ), length( 0 ), allowHeterogeneousChildren( false ), recordCount( 0 )
+   {
+   }
+
+   void E57XmlBuilder::ParseInfo::dump( int indent, std::ostream &os ) const
+   {
+      os << space( indent ) << "nodeType:       " << nodeType << std::endl;
+      os << space( indent ) << "minimum:        " << minimum << std::endl;
+      os << space( indent ) << "maximum:        " << maximum << std::endl;
+      os << space( indent ) << "scale:          " << scale << std::endl;
+      os << space( indent ) << "offset:         " << offset << std::endl;
+      os << space( indent ) << "precision:      " << precision << std::endl;
+      os << space( indent ) << "floatMinimum:   " << floatMinimum << std::endl;
+      os << space( indent ) << "floatMaximum:   " << floatMaximum << std::endl;
+      os << space( indent ) << "fileOffset:     " << fileOffset << std::endl;
+      os << space( indent ) << "length:         " << length << std::endl;
+      os << space( indent ) << "allowHeterogeneousChildren: " << allowHeterogeneousChildren
+         << std::endl;
+      os << space( indent ) << "recordCount:    " << recordCount << std::endl;
+      if ( container_ni )
+      {
+         os << space( indent ) << "container_ni:   <defined>" << std::endl;
+      }
+      else
+      {
+         os << space( indent ) << "container_ni:   <null>" << std::endl;
+      }
+      os << space( indent ) << "childText:      \"" << childText << "\"" << std::endl;
+   }
+
+   //=============================================================================
+   // E57XmlBuilder
+
+   E57XmlBuilder::E57XmlBuilder( ImageFileImplSharedPtr imf ) : imf_( std::move( imf ) )
+   {
+   }
+
+   void E57XmlBuilder::startElement( const ustring &localName, const ustring &qName,
+                                     const XmlAttributes &attributes )
+   {
+#ifdef E57_VERBOSE
+      std::cout << "startElement" << std::endl;
+      std::cout << space( 2 ) << "localName: " << localName << std::endl;
+      std::cout << space( 2 ) << "qName:     " << qName << std::endl;
+
+      for ( size_t i = 0; i < attributes.count(); i++ )
+      {
+         std::cout << space( 2 ) << "Attribute[" << i << "]" << std::endl;
+         std::cout << space( 4 ) << "qName:     " << attributes.qName( i ) << std::endl;
+         std::cout << space( 4 ) << "value:     " << attributes.value( i ) << std::endl;
+      }
+#endif
+      // Get Type attribute
+      const ustring &node_type = attributes.get( "type" );
+
+      //??? check to make sure not in primitive type (can only nest inside compound types).
+
+      ParseInfo pi;
+
+      if ( node_type == "Integer" )
+      {
+#ifdef E57_VERBOSE
+         std::cout << "got a Integer" << std::endl;
+#endif
+         //??? check validity of numeric strings
+         pi.nodeType = TypeInteger;
+
+         if ( attributes.isDefined( "minimum" ) )
+         {
+            pi.minimum = convertStrToLL( attributes.get( "minimum" ) );
+         }
+         else
+         {
+            // Not defined defined in XML, so defaults to E57_INT64_MIN
+            pi.minimum = INT64_MIN;
+         }
+
+         if ( attributes.isDefined( "maximum" ) )
+         {
+            pi.maximum = convertStrToLL( attributes.get( "maximum" ) );
+         }
+         else
+         {
+            // Not defined defined in XML, so defaults to E57_INT64_MAX
+            pi.maximum = INT64_MAX;
+         }
+
+         stack_.push( pi );
+      }
+      else if ( node_type == "ScaledInteger" )
+      {
+#ifdef E57_VERBOSE
+         std::cout << "got a ScaledInteger" << std::endl;
+#endif
+         pi.nodeType = TypeScaledInteger;
+
+         //??? check validity of numeric strings
+         if ( attributes.isDefined( "minimum" ) )
+         {
+            pi.minimum = convertStrToLL( attributes.get( "minimum" ) );
+         }
+         else
+         {
+            // Not defined defined in XML, so defaults to E57_INT64_MIN
+            pi.minimum = INT64_MIN;
+         }
+
+         if ( attributes.isDefined( "maximum" ) )
+         {
+            pi.maximum = convertStrToLL( attributes.get( "maximum" ) );
+         }
+         else
+         {
+            // Not defined defined in XML, so defaults to E57_INT64_MAX
+            pi.maximum = INT64_MAX;
+         }
+
+         if ( attributes.isDefined( "scale" ) )
+         {
+            pi.scale = strToDouble( attributes.get( "scale" ) ); //??? use exact rounding library
+         }
+         else
+         {
+            // Not defined defined in XML, so defaults to 1.0
+            pi.scale = 1.0;
+         }
+
+         if ( attributes.isDefined( "offset" ) )
+         {
+            pi.offset = strToDouble( attributes.get( "offset" ) ); //??? use exact rounding library
+         }
+         else
+         {
+            // Not defined defined in XML, so defaults to 0.0
+            pi.offset = 0.0;
+         }
+
+         stack_.push( pi );
+      }
+      else if ( node_type == "Float" )
+      {
+#ifdef E57_VERBOSE
+         std::cout << "got a Float" << std::endl;
+#endif
+         pi.nodeType = TypeFloat;
+
+         if ( attributes.isDefined( "precision" ) )
+         {
+            const ustring &precision_str = attributes.get( "precision" );
+            if ( precision_str == "single" )
+            {
+               pi.precision = PrecisionSingle;
+            }
+            else if ( precision_str == "double" )
+            {
+               pi.precision = PrecisionDouble;
+            }
+            else
+            {
+               throw E57_EXCEPTION2( ErrorBadXMLFormat, "precisionString=" + precision_str +
+                                                           " fileName=" + imf_->fileName() +
+                                                           " qName=" + qName );
+            }
+         }
+         else
+         {
+            // Not defined defined in XML, so defaults to double
+            pi.precision = PrecisionDouble;
+         }
+
+         if ( attributes.isDefined( "minimum" ) )
+         {
+            pi.floatMinimum =
+               strToDouble( attributes.get( "minimum" ) ); //??? use exact rounding library
+         }
+         else
+         {
+            // Not defined defined in XML, so defaults to E57_FLOAT_MIN or E57_DOUBLE_MIN
+            if ( pi.precision == PrecisionSingle )
+            {
+               pi.floatMinimum = FLOAT_MIN;
+            }
+            else
+            {
+               pi.floatMinimum = DOUBLE_MIN;
+            }
+         }
+
+         if ( attributes.isDefined( "maximum" ) )
+         {
+            pi.floatMaximum =
+               strToDouble( attributes.get( "maximum" ) ); //??? use exact rounding library
+         }
+         else
+         {
+            // Not defined defined in XML, so defaults to FLOAT_MAX or DOUBLE_MAX
+            if ( pi.precision == PrecisionSingle )
+            {
+               pi.floatMaximum = FLOAT_MAX;
+            }
+            else
+            {
+               pi.floatMaximum = DOUBLE_MAX;
+            }
+         }
+
+         stack_.push( pi );
+      }
+      else if ( node_type == "String" )
+      {
+#ifdef E57_VERBOSE
+         std::cout << "got a String" << std::endl;
+#endif
+         pi.nodeType = TypeString;
+
+         stack_.push( pi );
+      }
+      else if ( node_type == "Blob" )
+      {
+#ifdef E57_VERBOSE
+         std::cout << "got a Blob" << std::endl;
+#endif
+         pi.nodeType = TypeBlob;
+
+         //??? check validity of numeric strings
+
+         // fileOffset is required to be defined
+         pi.fileOffset = convertStrToLL( attributes.get( "fileOffset" ) );
+
+         // length is required to be defined
+         pi.length = convertStrToLL( attributes.get( "length" ) );
+
+         stack_.push( pi );
+      }
+      else if ( node_type == "Structure" )
+      {
+#ifdef E57_VERBOSE
+         std::cout << "got a Structure" << std::endl;
+#endif
+         pi.nodeType = TypeStructure;
+
+         // Read name space decls, if e57Root element
+         if ( localName == "e57Root" )
+         {
+            // Search attributes for namespace declarations (only allowed in E57Root structure)
+            bool gotDefault = false;
+            for ( size_t i = 0; i < attributes.count(); i++ )
+            {
+               const ustring &attQName = attributes.qName( i );
+
+               // Check if declaring the default namespace
+               if ( attQName == "xmlns" )
+               {
+#ifdef E57_VERBOSE
+                  std::cout << "declared default namespace, URI=" << attributes.value( i )
+                            << std::endl;
+#endif
+                  imf_->extensionsAdd( "", attributes.value( i ) );
+                  gotDefault = true;
+               }
+
+               // Check if declaring a namespace
+               else if ( attQName.compare( 0, 6, "xmlns:" ) == 0 )
+               {
+#ifdef E57_VERBOSE
+                  std::cout << "declared extension, prefix=" << attQName.substr( 6 )
+                            << " URI=" << attributes.value( i ) << std::endl;
+#endif
+                  imf_->extensionsAdd( attQName.substr( 6 ), attributes.value( i ) );
+               }
+            }
+
+            // If didn't declare a default namespace, have error
+            if ( !gotDefault )
+            {
+               throw E57_EXCEPTION2( ErrorBadXMLFormat,
+                                     "fileName=" + imf_->fileName() + " qName=" + qName );
+            }
+         }
+
+         // Create container now, so can hold children
+         std::shared_ptr<StructureNodeImpl> s_ni( new StructureNodeImpl( imf_ ) );
+         pi.container_ni = s_ni;
+
+         // After have Structure, check again if E57Root, if so mark attached so all children will
+         // be attached when added
+         if ( localName == "e57Root" )
+         {
+            s_ni->setAttachedRecursive();
+         }
+
+         stack_.push( pi );
+      }
+      else if ( node_type == "Vector" )
+      {
+#ifdef E57_VERBOSE
+         std::cout << "got a Vector" << std::endl;
+#endif
+         pi.nodeType = TypeVector;
+
+         if ( attributes.isDefined( "allowHeterogeneousChildren" ) )
+         {
+            int64_t i64 = convertStrToLL( attributes.get( "allowHeterogeneousChildren" ) );
+
+            if ( i64 == 0 )
+            {
+               pi.allowHeterogeneousChildren = false;
+            }
+            else if ( i64 == 1 )
+            {
+               pi.allowHeterogeneousChildren = true;
+            }
+            else
+            {
+               throw E57_EXCEPTION2( ErrorBadXMLFormat,
+                                     "allowHeterogeneousChildren=" + toString( i64 ) +
+                                        "fileName=" + imf_->fileName() + " qName=" + qName );
+            }
+         }
+         else
+         {
+            // Not defined defined in XML, so defaults to false
+            pi.allowHeterogeneousChildren = false;
+         }
+
+         // Create container now, so can hold children
+         std::shared_ptr<VectorNodeImpl> v_ni(
+            new VectorNodeImpl( imf_, pi.allowHeterogeneousChildren ) );
+         pi.container_ni = v_ni;
+
+         stack_.push( pi );
+      }
+      else if ( node_type == "CompressedVector" )
+      {
+#ifdef E57_VERBOSE
+         std::cout << "got a CompressedVector" << std::endl;
+#endif
+         pi.nodeType = TypeCompressedVector;
+
+         // fileOffset is required to be defined
+         pi.fileOffset = convertStrToLL( attributes.get( "fileOffset" ) );
+
+         // recordCount is required to be defined
+         pi.recordCount = convertStrToLL( attributes.get( "recordCount" ) );
+
+         // Create container now, so can hold children
+         std::shared_ptr<CompressedVectorNodeImpl> cv_ni( new CompressedVectorNodeImpl( imf_ ) );
+         cv_ni->setRecordCount( pi.recordCount );
+         cv_ni->setBinarySectionLogicalStart(
+            imf_->file_->physicalToLogical( pi.fileOffset ) ); //??? what if file_ is NULL?
+
+         // Start warming the section's first data packets while the rest of
+         // the document is still being parsed
+         imf_->prefetchBinarySection( cv_ni->getBinarySectionLogicalStart() );
+
+         pi.container_ni = cv_ni;
+
+         stack_.push( pi );
+      }
+      else
+      {
+         throw E57_EXCEPTION2( ErrorBadXMLFormat, "nodeType=" + node_type +
+                                                     " fileName=" + imf_->fileName() +
+                                                     " qName=" + qName );
+      }
+#ifdef E57_VERBOSE
+      pi.dump( 4 );
+#endif
+   }
+
+   void E57XmlBuilder::endElement( const ustring &qName )
+   {
+#ifdef E57_VERBOSE
+      std::cout << "endElement" << std::endl;
+#endif
+
+      // Pop the node that just ended
+      ParseInfo pi = stack_.top(); //??? really want to make a copy here?
+      stack_.pop();
+#ifdef E57_VERBOSE
+      pi.dump( 4 );
+#endif
+
+      // We should now have all the info we need to create the node
+      NodeImplSharedPtr current_ni;
+
+      switch ( pi.nodeType )
+      {
+         case TypeStructure:
+         case TypeVector:
+            current_ni = pi.container_ni;
+            break;
+         case TypeCompressedVector:
+         {
+            // Verify that both prototype and codecs child elements were defined
+            // ???
+            current_ni = pi.container_ni;
+         }
+         break;
+         case TypeInteger:
+         {
+            // Convert child text (if any) to value, else default to 0.0
+            int64_t intValue;
+            if ( pi.childText.length() > 0 )
+            {
+               intValue = convertStrToLL( pi.childText );
+            }
+            else
+            {
+               intValue = 0;
+            }
+            std::shared_ptr<IntegerNodeImpl> i_ni(
+               new IntegerNodeImpl( imf_, intValue, pi.minimum, pi.maximum ) );
+            current_ni = i_ni;
+         }
+         break;
+         case TypeScaledInteger:
+         {
+            // Convert child text (if any) to value, else default to 0.0
+            int64_t intValue;
+            if ( pi.childText.length() > 0 )
+            {
+               intValue = convertStrToLL( pi.childText );
+            }
+            else
+            {
+               intValue = 0;
+            }
+            std::shared_ptr<ScaledIntegerNodeImpl> si_ni( new ScaledIntegerNodeImpl(
+               imf_, intValue, pi.minimum, pi.maximum, pi.scale, pi.offset ) );
+            current_ni = si_ni;
+         }
+         break;
+         case TypeFloat:
+         {
+            // Convert child text (if any) to value, else default to 0.0
+            double floatValue;
+            if ( pi.childText.length() > 0 )
+            {
+               floatValue = strToDouble( pi.childText );
+            }
+            else
+            {
+               floatValue = 0.0;
+            }
+            std::shared_ptr<FloatNodeImpl> f_ni( new FloatNodeImpl(
+               imf_, floatValue, pi.precision, pi.floatMinimum, pi.floatMaximum ) );
+            current_ni = f_ni;
+         }
+         break;
+         case TypeString:
+         {
+            std::shared_ptr<StringNodeImpl> s_ni( new StringNodeImpl( imf_, pi.childText ) );
+            current_ni = s_ni;
+         }
+         break;
+         case TypeBlob:
+         {
+            std::shared_ptr<BlobNodeImpl> b_ni(
+               new BlobNodeImpl( imf_, pi.fileOffset, pi.length ) );
+            current_ni = b_ni;
+         }
+         break;
+         default:
+            throw E57_EXCEPTION2( ErrorInternal, "nodeType=" + toString( pi.nodeType ) +
+                                                    " fileName=" + imf_->fileName() +
+                                                    " qName=" + qName );
+      }
+#ifdef E57_VERBOSE
+      current_ni->dump( 4 );
+#endif
+
+      // If first node in file ended, we are all done
+      if ( stack_.empty() )
+      {
+         // Top level should be Structure
+         if ( current_ni->type() != TypeStructure )
+         {
+            throw E57_EXCEPTION2( ErrorBadXMLFormat,
+                                  "currentType=" + toString( current_ni->type() ) +
+                                     " fileName=" + imf_->fileName() + " qName=" + qName );
+         }
+         imf_->root_ = std::static_pointer_cast<StructureNodeImpl>( current_ni );
+         return;
+      }
+
+      // Get next level up node (when entered function), which should be a container.
+      NodeImplSharedPtr parent_ni = stack_.top().container_ni;
+
+      if ( !parent_ni )
+      {
+         throw E57_EXCEPTION2( ErrorBadXMLFormat,
+                               "fileName=" + imf_->fileName() + " qName=" + qName );
+      }
+
+      // Add current node into parent at top of stack
+      switch ( parent_ni->type() )
+      {
+         case TypeStructure:
+         {
+            std::shared_ptr<StructureNodeImpl> struct_ni =
+               std::static_pointer_cast<StructureNodeImpl>( parent_ni );
+
+            // Add named child to structure
+            struct_ni->set( qName, current_ni );
+         }
+         break;
+         case TypeVector:
+         {
+            std::shared_ptr<VectorNodeImpl> vector_ni =
+               std::static_pointer_cast<VectorNodeImpl>( parent_ni );
+
+            // Add unnamed child to vector
+            vector_ni->append( current_ni );
+         }
+         break;
+         case TypeCompressedVector:
+         {
+            std::shared_ptr<CompressedVectorNodeImpl> cv_ni =
+               std::static_pointer_cast<CompressedVectorNodeImpl>( parent_ni );
+
+            // n can be either prototype or codecs
+            if ( qName == "prototype" )
+            {
+               cv_ni->setPrototype( current_ni );
+            }
+            else if ( qName == "codecs" )
+            {
+               if ( current_ni->type() != TypeVector )
+               {
+                  throw E57_EXCEPTION2( ErrorBadXMLFormat,
+                                        "currentType=" + toString( current_ni->type() ) +
+                                           " fileName=" + imf_->fileName() + " qName=" + qName );
+               }
+               std::shared_ptr<VectorNodeImpl> vi =
+                  std::static_pointer_cast<VectorNodeImpl>( current_ni );
+
+               // Check VectorNode is hetero
+               if ( !vi->allowHeteroChildren() )
+               {
+                  throw E57_EXCEPTION2( ErrorBadXMLFormat,
+                                        "currentType=" + toString( current_ni->type() ) +
+                                           " fileName=" + imf_->fileName() + " qName=" + qName );
+               }
+
+               cv_ni->setCodecs( vi );
+            }
+            else
+            {
+               // Found unknown XML child element of CompressedVector, not prototype or codecs
+               throw E57_EXCEPTION2( ErrorBadXMLFormat,
+                                     +"fileName=" + imf_->fileName() + " qName=" + qName );
+            }
+         }
+         break;
+         default:
+            // Have bad XML nesting, parent should have been a container.
+            throw E57_EXCEPTION2( ErrorBadXMLFormat,
+                                  "parentType=" + toString( parent_ni->type() ) +
+                                     " fileName=" + imf_->fileName() + " qName=" + qName );
+      }
+   }
+
+   void E57XmlBuilder::characters( const char *chars, size_t length )
+   {
+#ifdef E57_VERBOSE
+      std::cout << "characters, chars=\"" << ustring( chars, length ) << "\" length=" << length
+                << std::endl;
+#endif
+
+      // Get active element
+      ParseInfo &pi = stack_.top();
+
+      // Check if child text is allowed for current E57 element type
+      switch ( pi.nodeType )
+      {
+         case TypeStructure:
+         case TypeVector:
+         case TypeCompressedVector:
+         case TypeBlob:
+         {
+            // If characters aren't whitespace, have an error, else ignore
+            ustring s( chars, length );
+            if ( s.find_first_not_of( " \t\n\r" ) != std::string::npos )
+            {
+               throw E57_EXCEPTION2( ErrorBadXMLFormat, "chars=" + s );
+            }
+         }
+         break;
+         default:
+            // Append to any previous characters
+            pi.childText.append( chars, length );
+      }
+   }
+
+   //=============================================================================
+   // E57XmlLiteParser
+
+   namespace
+   {
+      inline bool isLiteWhitespace( char c )
+      {
+         return ( c == ' ' || c == '\t' || c == '\n' || c == '\r' );
+      }
+
+      /// Append the UTF-8 encoding of a code point from a numeric character
+      /// reference. Returns false for values that aren't legal code points.
+      bool appendUtf8( ustring &out, uint32_t codePoint )
+      {
+         if ( codePoint < 0x80 )
+         {
+            out += static_cast<char>( codePoint );
+         }
+         else if ( codePoint < 0x800 )
+         {
+            out += static_cast<char>( 0xC0 | ( codePoint >> 6 ) );
+            out += static_cast<char>( 0x80 | ( codePoint & 0x3F ) );
+         }
+         else if ( codePoint < 0x10000 )
+         {
+            if ( codePoint >= 0xD800 && codePoint <= 0xDFFF )
+            {
+               return false;
+            }
+            out += static_cast<char>( 0xE0 | ( codePoint >> 12 ) );
+            out += static_cast<char>( 0x80 | ( ( codePoint >> 6 ) & 0x3F ) );
+            out += static_cast<char>( 0x80 | ( codePoint & 0x3F ) );
+         }
+         else if ( codePoint < 0x110000 )
+         {
+            out += static_cast<char>( 0xF0 | ( codePoint >> 18 ) );
+            out += static_cast<char>( 0x80 | ( ( codePoint >> 12 ) & 0x3F ) );
+            out += static_cast<char>( 0x80 | ( ( codePoint >> 6 ) & 0x3F ) );
+            out += static_cast<char>( 0x80 | ( codePoint & 0x3F ) );
+         }
+         else
+         {
+            return false;
+         }
+         return true;
+      }
+
+      /// Decode the predefined and numeric entity references in text between
+      /// @a start and @a end into @a out. Returns false on a reference the
+      /// subset doesn't define.
+      bool decodeEntities( const ustring &xml, size_t start, size_t end, ustring &out )
+      {
+         out.clear();
+
+         while ( start < end )
+         {
+            const size_t amp = xml.find( '&', start );
+            if ( amp == ustring::npos || amp >= end )
+            {
+               out.append( xml, start, end - start );
+               return true;
+            }
+
+            out.append( xml, start, amp - start );
+
+            const size_t semi = xml.find( ';', amp + 1 );
+            if ( semi == ustring::npos || semi >= end )
+            {
+               return false;
+            }
+
+            const ustring name = xml.substr( amp + 1, semi - amp - 1 );
+
+            if ( name == "amp" )
+            {
+               out += '&';
+            }
+            else if ( name == "lt" )
+            {
+               out += '<';
+            }
+            else if ( name == "gt" )
+            {
+               out += '>';
+            }
+            else if ( name == "quot" )
+            {
+               out += '"';
+            }
+            else if ( name == "apos" )
+            {
+               out += '\'';
+            }
+            else if ( name.length() > 1 && name[0] == '#' )
+            {
+               char *parseEnd = nullptr;
+               uint32_t codePoint = 0;
+
+               if ( name[1] == 'x' || name[1] == 'X' )
+               {
+                  codePoint =
+                     static_cast<uint32_t>( strtoul( name.c_str() + 2, &parseEnd, 16 ) );
+               }
+               else
+               {
+                  codePoint = static_cast<uint32_t>( strtoul( name.c_str() + 1, &parseEnd, 10 ) );
+               }
+
+               if ( *parseEnd != 0 || !appendUtf8( out, codePoint ) )
+               {
+                  return false;
+               }
+            }
+            else
+            {
+               // General entities would need a DTD, which the subset excludes
+               return false;
+            }
+
+            start = semi + 1;
+         }
+
+         return true;
+      }
+   }
+
+   E57XmlLiteParser::E57XmlLiteParser( ImageFileImplSharedPtr imf ) :
+      imf_( imf ), builder_( imf )
+   {
+   }
+
+   void E57XmlLiteParser::parse( const ustring &xml )
+   {
+      // Open element qNames, to match end tags against (the builder keeps
+      // its own stack of node state, but doesn't know tag names)
+      std::vector<ustring> openElements;
+      bool seenRoot = false;
+
+      ustring decoded; // reused decode buffer
+
+      size_t i = 0;
+
+      while ( i < xml.length() )
+      {
+         const size_t open = xml.find( '<', i );
+
+         // Text run up to the next tag (or the end of the document)
+         const size_t textEnd = ( open == ustring::npos ) ? xml.length() : open;
+         if ( textEnd > i )
+         {
+            if ( !openElements.empty() )
+            {
+               if ( !decodeEntities( xml, i, textEnd, decoded ) )
+               {
+                  throw E57_EXCEPTION2( ErrorXMLParser, "fileName=" + imf_->fileName() +
+                                                           " xmlOffset=" + toString( i ) );
+               }
+               builder_.characters( decoded.data(), decoded.length() );
+            }
+            else
+            {
+               // Outside the root element only whitespace (and the section's
+               // zero padding) is allowed
+               for ( size_t k = i; k < textEnd; ++k )
+               {
+                  if ( !isLiteWhitespace( xml[k] ) && xml[k] != 0 )
+                  {
+                     throw E57_EXCEPTION2( ErrorXMLParser, "fileName=" + imf_->fileName() +
+                                                              " xmlOffset=" + toString( k ) );
+                  }
+               }
+            }
+         }
+
+         if ( open == ustring::npos )
+         {
+            break;
+         }
+         i = open;
+
+         if ( xml.compare( i, 4, "<!--" ) == 0 )
+         {
+            const size_t end = xml.find( "-->", i + 4 );
+            if ( end == ustring::npos )
+            {
+               throw E57_EXCEPTION2( ErrorXMLParser, "fileName=" + imf_->fileName() +
+                                                        " xmlOffset=" + toString( i ) );
+            }
+            i = end + 3;
+            continue;
+         }
+
+         if ( xml.compare( i, 9, "<![CDATA[" ) == 0 )
+         {
+            const size_t end = xml.find( "]]>", i + 9 );
+            if ( end == ustring::npos || openElements.empty() )
+            {
+               throw E57_EXCEPTION2( ErrorXMLParser, "fileName=" + imf_->fileName() +
+                                                        " xmlOffset=" + toString( i ) );
+            }
+            builder_.characters( xml.data() + i + 9, end - ( i + 9 ) );
+            i = end + 3;
+            continue;
+         }
+
+         if ( xml.compare( i, 2, "<?" ) == 0 )
+         {
+            // XML declaration or processing instruction: skip. An E57 file's
+            // declaration can only specify UTF-8 or ASCII, which read the
+            // same way here.
+            const size_t end = xml.find( "?>", i + 2 );
+            if ( end == ustring::npos )
+            {
+               throw E57_EXCEPTION2( ErrorXMLParser, "fileName=" + imf_->fileName() +
+                                                        " xmlOffset=" + toString( i ) );
+            }
+            i = end + 2;
+            continue;
+         }
+
+         if ( xml.compare( i, 2, "<!" ) == 0 )
+         {
+            // DOCTYPE and friends are outside the subset
+            throw E57_EXCEPTION2( ErrorXMLParser, "fileName=" + imf_->fileName() +
+                                                     " xmlOffset=" + toString( i ) );
+         }
+
+         if ( xml.compare( i, 2, "</" ) == 0 )
+         {
+            const size_t end = xml.find( '>', i + 2 );
+            if ( end == ustring::npos || openElements.empty() )
+            {
+               throw E57_EXCEPTION2( ErrorXMLParser, "fileName=" + imf_->fileName() +
+                                                        " xmlOffset=" + toString( i ) );
+            }
+
+            size_t nameEnd = i + 2;
+            while ( nameEnd < end && !isLiteWhitespace( xml[nameEnd] ) )
+            {
+               ++nameEnd;
+            }
+
+            if ( xml.compare( i + 2, nameEnd - ( i + 2 ), openElements.back() ) != 0 )
+            {
+               // Mismatched end tag
+               throw E57_EXCEPTION2( ErrorXMLParser, "fileName=" + imf_->fileName() +
+                                                        " xmlOffset=" + toString( i ) );
+            }
+
+            builder_.endElement( openElements.back() );
+            openElements.pop_back();
+            i = end + 1;
+            continue;
+         }
+
+         // Have a start tag. Parse the element name...
+         const size_t nameStart = i + 1;
+         size_t j = nameStart;
+         while ( j < xml.length() && !isLiteWhitespace( xml[j] ) && xml[j] != '>' && xml[j] != '/' )
+         {
+            ++j;
+         }
+         if ( j == nameStart || j >= xml.length() || ( seenRoot && openElements.empty() ) )
+         {
+            throw E57_EXCEPTION2( ErrorXMLParser, "fileName=" + imf_->fileName() +
+                                                     " xmlOffset=" + toString( i ) );
+         }
+         ustring qName = xml.substr( nameStart, j - nameStart );
+
+         // ... then the attributes, up to '>' or '/>'
+         XmlAttributes attributes;
+         bool selfClosing = false;
+
+         while ( true )
+         {
+            while ( j < xml.length() && isLiteWhitespace( xml[j] ) )
+            {
+               ++j;
+            }
+            if ( j >= xml.length() )
+            {
+               throw E57_EXCEPTION2( ErrorXMLParser, "fileName=" + imf_->fileName() +
+                                                        " xmlOffset=" + toString( i ) );
+            }
+
+            if ( xml[j] == '>' )
+            {
+               ++j;
+               break;
+            }
+            if ( xml[j] == '/' && j + 1 < xml.length() && xml[j + 1] == '>' )
+            {
+               selfClosing = true;
+               j += 2;
+               break;
+            }
+
+            const size_t attNameStart = j;
+            while ( j < xml.length() && xml[j] != '=' && !isLiteWhitespace( xml[j] ) &&
+                    xml[j] != '>' )
+            {
+               ++j;
+            }
+            ustring attName = xml.substr( attNameStart, j - attNameStart );
+
+            while ( j < xml.length() && isLiteWhitespace( xml[j] ) )
+            {
+               ++j;
+            }
+            if ( attName.empty() || j >= xml.length() || xml[j] != '=' )
+            {
+               throw E57_EXCEPTION2( ErrorXMLParser, "fileName=" + imf_->fileName() +
+                                                        " xmlOffset=" + toString( j ) );
+            }
+            ++j;
+
+            while ( j < xml.length() && isLiteWhitespace( xml[j] ) )
+            {
+               ++j;
+            }
+            if ( j >= xml.length() || ( xml[j] != '"' && xml[j] != '\'' ) )
+            {
+               throw E57_EXCEPTION2( ErrorXMLParser, "fileName=" + imf_->fileName() +
+                                                        " xmlOffset=" + toString( j ) );
+            }
+
+            const char quote = xml[j];
+            const size_t valueStart = ++j;
+            const size_t valueEnd = xml.find( quote, valueStart );
+            if ( valueEnd == ustring::npos )
+            {
+               throw E57_EXCEPTION2( ErrorXMLParser, "fileName=" + imf_->fileName() +
+                                                        " xmlOffset=" + toString( valueStart ) );
+            }
+
+            if ( !decodeEntities( xml, valueStart, valueEnd, decoded ) )
+            {
+               throw E57_EXCEPTION2( ErrorXMLParser, "fileName=" + imf_->fileName() +
+                                                        " xmlOffset=" + toString( valueStart ) );
+            }
+            attributes.add( std::move( attName ), decoded );
+
+            j = valueEnd + 1;
+         }
+
+         // The local name is the qName with any namespace prefix removed
+         const size_t colon = qName.find( ':' );
+         const ustring localName =
+            ( colon == ustring::npos ) ? qName : qName.substr( colon + 1 );
+
+         builder_.startElement( localName, qName, attributes );
+         seenRoot = true;
+
+         if ( selfClosing )
+         {
+            builder_.endElement( qName );
+         }
+         else
+         {
+            openElements.push_back( std::move( qName ) );
+         }
+
+         i = j;
+      }
+
+      if ( !seenRoot || !openElements.empty() )
+      {
+         // Empty document or unclosed elements
+         throw E57_EXCEPTION2( ErrorXMLParser,
+                               "fileName=" + imf_->fileName() + " xmlLength=" + toString( i ) );
+      }
+   }
+}
@@ -0,0 +1,149 @@
+/*
+ * Original work Copyright 2009 - 2010 Kevin Ackley (kackley@gwi.net)
+ * Modified work Copyright 2018 - 2020 Andy Maloney <asmaloney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <stack>
+
+#include "Common.h"
+
+namespace e57
+{
+   /// Attributes of one start tag, as UTF-8 qName/value pairs in document
+   /// order. A parser backend fills one of these per element; the builder
+   /// looks names up by linear search, since E57 elements carry at most a
+   /// handful of attributes.
+   class XmlAttributes
+   {
+   public:
+      void add( ustring qName, ustring value )
+      {
+         pairs_.emplace_back( std::move( qName ), std::move( value ) );
+      }
+
+      void clear()
+      {
+         pairs_.clear();
+      }
+
+      bool isDefined( const char *qName ) const;
+
+      /// Value of the named attribute; throws ErrorBadXMLFormat if absent
+      const ustring &get( const char *qName ) const;
+
+      size_t count() const
+      {
+         return pairs_.size();
+      }
+
+      const ustring &qName( size_t index ) const
+      {
+         return pairs_[index].first;
+      }
+
+      const ustring &value( size_t index ) const
+      {
+         return pairs_[index].second;
+      }
+
+   private:
+      std::vector<std::pair<ustring, ustring>> pairs_;
+   };
+
+   /// Builds the node tree of an ImageFile from SAX-style parse events.
+   /// This is the backend-neutral half of XML parsing: the Xerces handler
+   /// (E57XmlParser) transcodes its callbacks and forwards them here, and
+   /// the built-in non-validating parser (E57XmlLiteParser) drives it
+   /// directly with UTF-8 text, so both produce identical trees.
+   class E57XmlBuilder
+   {
+   public:
+      explicit E57XmlBuilder( ImageFileImplSharedPtr imf );
+
+      void startElement( const ustring &localName, const ustring &qName,
+                         const XmlAttributes &attributes );
+      void endElement( const ustring &qName );
+
+      /// Child text between tags, UTF-8, possibly delivered in several pieces
+      void characters( const char *chars, size_t length );
+
+   private:
+      ImageFileImplSharedPtr imf_; /// Image file we are reading
+
+      struct ParseInfo
+      {
+         // All the fields need to remember while parsing the XML
+         // Not all fields are used at same time, depends on node type
+         // Needed because not all info is available at one time to create the
+         // node.
+         NodeType nodeType;               // used by all types
+         int64_t minimum;                 // used in Integer, ScaledInteger
+         int64_t maximum;                 // used in Integer, ScaledInteger
+         double scale;                    // used in ScaledInteger
+         double offset;                   // used in ScaledInteger
+         FloatPrecision precision;        // used in Float
+         double floatMinimum;             // used in Float
+         double floatMaximum;             // used in Float
+         int64_t fileOffset;              // used in Blob, CompressedVector
+         int64_t length;                  // used in Blob
+         bool allowHeterogeneousChildren; // used in Vector
+         int64_t recordCount;             // used in CompressedVector
+         ustring childText; // used by all types, accumulates all child text between tags
+
+         // Holds node for Structure, Vector, and CompressedVector so can append
+         // child elements
+         NodeImplSharedPtr container_ni;
+
+         ParseInfo(); // default ctor
+         void dump( int indent = 0, std::ostream &os = std::cout ) const;
+      };
+
+      std::stack<ParseInfo> stack_; /// Stores the current path in tree we are reading
+   };
+
+   /// Minimal non-validating XML parser for the subset E57 files use:
+   /// UTF-8 text, elements with quoted attributes, character data with the
+   /// predefined and numeric entity references, comments, CDATA, and
+   /// processing instructions (skipped). No DTDs, no schema validation.
+   /// Feeds an E57XmlBuilder straight from the document bytes, avoiding the
+   /// per-element UTF-16 transcoding and attribute churn of the Xerces
+   /// backend. Anything outside the subset throws ErrorXMLParser and the
+   /// caller falls back to Xerces.
+   class E57XmlLiteParser
+   {
+   public:
+      explicit E57XmlLiteParser( ImageFileImplSharedPtr imf );
+
+      /// Parse a complete document (the XML section text or a wrapped
+      /// lazy-parse fragment), building the node tree
+      void parse( const ustring &xml );
+
+   private:
+      ImageFileImplSharedPtr imf_; /// For error messages only
+      E57XmlBuilder builder_;
+   };
+}
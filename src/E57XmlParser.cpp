@@ -25,6 +25,9 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
 #include <limits>
 #include <locale>
 #include <sstream>
@@ -35,90 +38,52 @@
 #include <xercesc/util/BinInputStream.hpp>
 #include <xercesc/util/TransService.hpp>
 
-#include "BlobNodeImpl.h"
 #include "CheckedFile.h"
-#include "CompressedVectorNodeImpl.h"
 #include "E57XmlParser.h"
-#include "FloatNodeImpl.h"
 #include "ImageFileImpl.h"
-#include "IntegerNodeImpl.h"
-#include "ScaledIntegerNodeImpl.h"
 #include "StringFunctions.h"
-#include "StringNodeImpl.h"
-#include "VectorNodeImpl.h"
 
 using namespace e57;
 using namespace XERCES_CPP_NAMESPACE;
 
-// define convenient constants for the attribute names
-static const XMLCh att_minimum[] = { chLatin_m, chLatin_i, chLatin_n, chLatin_i,
-                                     chLatin_m, chLatin_u, chLatin_m, chNull };
-static const XMLCh att_maximum[] = { chLatin_m, chLatin_a, chLatin_x, chLatin_i,
-                                     chLatin_m, chLatin_u, chLatin_m, chNull };
-static const XMLCh att_scale[] = { chLatin_s, chLatin_c, chLatin_a, chLatin_l, chLatin_e, chNull };
-static const XMLCh att_offset[] = { chLatin_o, chLatin_f, chLatin_f, chLatin_s,
-                                    chLatin_e, chLatin_t, chNull };
-static const XMLCh att_precision[] = { chLatin_p, chLatin_r, chLatin_e, chLatin_c, chLatin_i,
-                                       chLatin_s, chLatin_i, chLatin_o, chLatin_n, chNull };
-static const XMLCh att_allowHeterogeneousChildren[] = {
-   chLatin_a, chLatin_l, chLatin_l, chLatin_o, chLatin_w, chLatin_H, chLatin_e,
-   chLatin_t, chLatin_e, chLatin_r, chLatin_o, chLatin_g, chLatin_e, chLatin_n,
-   chLatin_e, chLatin_o, chLatin_u, chLatin_s, chLatin_C, chLatin_h, chLatin_i,
-   chLatin_l, chLatin_d, chLatin_r, chLatin_e, chLatin_n, chNull
-};
-static const XMLCh att_fileOffset[] = { chLatin_f, chLatin_i, chLatin_l, chLatin_e,
-                                        chLatin_O, chLatin_f, chLatin_f, chLatin_s,
-                                        chLatin_e, chLatin_t, chNull };
-
-static const XMLCh att_type[] = { chLatin_t, chLatin_y, chLatin_p, chLatin_e, chNull };
-static const XMLCh att_length[] = { chLatin_l, chLatin_e, chLatin_n, chLatin_g,
-                                    chLatin_t, chLatin_h, chNull };
-static const XMLCh att_recordCount[] = { chLatin_r, chLatin_e, chLatin_c, chLatin_o,
-                                         chLatin_r, chLatin_d, chLatin_C, chLatin_o,
-                                         chLatin_u, chLatin_n, chLatin_t, chNull };
-
 static_assert( std::is_same<size_t, XMLSize_t>::value,
                "size_t and XMLSize_t should be the same type" );
 
 namespace
 {
-   inline int64_t convertStrToLL( const std::string &inStr )
-   {
-#if defined( _MSC_VER )
-      return _atoi64( inStr.c_str() );
-#elif defined( __GNUC__ )
-      return strtoll( inStr.c_str(), nullptr, 10 );
-#else
-#error "Need to define string to long long conversion for this compiler"
-#endif
-   }
-
    ustring toUString( const XMLCh *const xml_str )
    {
       ustring u_str;
       if ( ( xml_str != nullptr ) && *xml_str )
       {
+         // Element names and almost all values are plain ASCII, where UTF-16
+         // to UTF-8 is a narrowing copy. Only strings with a code unit above
+         // 0x7F go through Xerces' general transcoder (which allocates and
+         // walks the string a second time).
+         size_t length = 0;
+
+         while ( xml_str[length] && ( xml_str[length] < 0x80 ) )
+         {
+            length++;
+         }
+
+         if ( !xml_str[length] )
+         {
+            u_str.resize( length );
+
+            for ( size_t i = 0; i < length; i++ )
+            {
+               u_str[i] = static_cast<char>( xml_str[i] );
+            }
+
+            return ( u_str );
+         }
+
          TranscodeToStr UTF8Transcoder( xml_str, "UTF-8" );
          u_str = ustring( reinterpret_cast<const char *>( UTF8Transcoder.str() ) );
       }
       return ( u_str );
    }
-
-   ustring lookupAttribute( const Attributes &attributes, const XMLCh *attribute_name )
-   {
-      XMLSize_t attr_index;
-      if ( !attributes.getIndex( attribute_name, attr_index ) )
-      {
-         throw E57_EXCEPTION2( ErrorBadXMLFormat, "attributeName=" + toUString( attribute_name ) );
-      }
-      return ( toUString( attributes.getValue( attr_index ) ) );
-   }
-
-   bool isAttributeDefined( const Attributes &attributes, const XMLCh *attribute_name )
-   {
-      XMLSize_t attr_index;
-      return ( attributes.getIndex( attribute_name, attr_index ) );
-   }
 }
 
 //=============================================================================
@@ -229,70 +194,110 @@ BinInputStream *E57XmlFileInputSource::makeStream() const
 }
 
 //=============================================================================
-// E57XmlParser::ParseInfo
+// E57MemBufInputStream
 
-E57XmlParser::ParseInfo::ParseInfo() :
-   nodeType( static_cast<NodeType>( 0 ) ), minimum( 0 ), maximum( 0 ), scale( 0 ), offset( 0 ),
-   precision( static_cast<FloatPrecision>( 0 ) ), floatMinimum( 0 ), floatMaximum( 0 ),
-   fileOffset( 0 ), length( 0 ), allowHeterogeneousChildren( false ), recordCount( 0 )
+class E57MemBufInputStream : public BinInputStream
 {
-}
+public:
+   E57MemBufInputStream( const char *data, size_t length ) :
+      data_( data ), length_( length ), position_( 0 )
+   {
+   }
 
-void E57XmlParser::ParseInfo::dump( int indent, std::ostream &os ) const
-{
-   os << space( indent ) << "nodeType:       " << nodeType << std::endl;
-   os << space( indent ) << "minimum:        " << minimum << std::endl;
-   os << space( indent ) << "maximum:        " << maximum << std::endl;
-   os << space( indent ) << "scale:          " << scale << std::endl;
-   os << space( indent ) << "offset:         " << offset << std::endl;
-   os << space( indent ) << "precision:      " << precision << std::endl;
-   os << space( indent ) << "floatMinimum:   " << floatMinimum << std::endl;
-   os << space( indent ) << "floatMaximum:   " << floatMaximum << std::endl;
-   os << space( indent ) << "fileOffset:     " << fileOffset << std::endl;
-   os << space( indent ) << "length:         " << length << std::endl;
-   os << space( indent ) << "allowHeterogeneousChildren: " << allowHeterogeneousChildren
-      << std::endl;
-   os << space( indent ) << "recordCount:    " << recordCount << std::endl;
-   if ( container_ni )
+   ~E57MemBufInputStream() override = default;
+
+   E57MemBufInputStream( const E57MemBufInputStream & ) = delete;
+   E57MemBufInputStream &operator=( const E57MemBufInputStream & ) = delete;
+
+   XMLFilePos curPos() const override
    {
-      os << space( indent ) << "container_ni:   <defined>" << std::endl;
+      return ( position_ );
    }
-   else
+
+   XMLSize_t readBytes( XMLByte *toFill, XMLSize_t maxToRead ) override
    {
-      os << space( indent ) << "container_ni:   <null>" << std::endl;
+      const size_t readCount = std::min( static_cast<size_t>( maxToRead ), length_ - position_ );
+
+      memcpy( toFill, data_ + position_, readCount );
+      position_ += readCount;
+      return ( readCount );
    }
-   os << space( indent ) << "childText:      \"" << childText << "\"" << std::endl;
+
+   const XMLCh *getContentType() const override
+   {
+      return nullptr;
+   }
+
+private:
+   const char *data_;
+   size_t length_;
+   size_t position_;
+};
+
+//=============================================================================
+// E57XmlMemBufInputSource
+
+E57XmlMemBufInputSource::E57XmlMemBufInputSource( const ustring &buffer ) :
+   InputSource( "E57MemBuf", XMLPlatformUtils::fgMemoryManager ), buffer_( buffer )
+{
+}
+
+BinInputStream *E57XmlMemBufInputSource::makeStream() const
+{
+   return new E57MemBufInputStream( buffer_.data(), buffer_.length() );
 }
 
 //=============================================================================
 // E57XmlParser
 
-E57XmlParser::E57XmlParser( ImageFileImplSharedPtr imf ) : imf_( imf ), xmlReader( nullptr )
+E57XmlParser::E57XmlParser( ImageFileImplSharedPtr imf ) :
+   imf_( imf ), builder_( imf ), xmlReader( nullptr )
 {
 }
 
+namespace
+{
+   /// Initialize the Xerces platform once per process, on the first parse.
+   /// Initialize()/Terminate() per parser pays platform setup on every
+   /// ImageFile open and convoys concurrent opens on Xerces's internal init
+   /// lock, so the platform is latched up here instead and torn down at
+   /// process exit. The magic static makes concurrent first opens safe, and
+   /// a failed initialization is retried on the next open.
+   void ensurePlatformInitialized()
+   {
+      static const bool cInitialized = []() {
+         try
+         {
+            XMLPlatformUtils::Initialize();
+         }
+         catch ( const XMLException &ex )
+         {
+            // Turn parser exception into E57Exception
+            throw E57_EXCEPTION2( ErrorXMLParserInit,
+                                  "parserMessage=" +
+                                     ustring( XMLString::transcode( ex.getMessage() ) ) );
+         }
+
+         std::atexit( []() { XMLPlatformUtils::Terminate(); } );
+
+         return true;
+      }();
+
+      UNUSED( cInitialized );
+   }
+}
+
 E57XmlParser::~E57XmlParser()
 {
    delete xmlReader;
 
    xmlReader = nullptr;
-
-   XMLPlatformUtils::Terminate();
 }
 
 void E57XmlParser::init()
 {
-   // Initialize the XML4C2 system
-   try
-   {
-      XMLPlatformUtils::Initialize();
-   }
-   catch ( const XMLException &ex )
-   {
-      // Turn parser exception into E57Exception
-      throw E57_EXCEPTION2( ErrorXMLParserInit,
-                            "parserMessage=" + ustring( XMLString::transcode( ex.getMessage() ) ) );
-   }
+   // Initialize the XML4C2 system (first open only; see above)
+   ensurePlatformInitialized();
 
    xmlReader = XMLReaderFactory::createXMLReader(); //??? auto_ptr?
 
@@ -321,630 +326,381 @@ void E57XmlParser::parse( InputSource &inputSource )
 void E57XmlParser::startElement( const XMLCh *const uri, const XMLCh *const localName,
                                  const XMLCh *const qName, const Attributes &attributes )
 {
-#ifdef E57_VERBOSE
-   std::cout << "startElement" << std::endl;
-   std::cout << space( 2 ) << "URI:       " << toUString( uri ) << std::endl;
-   std::cout << space( 2 ) << "localName: " << toUString( localName ) << std::endl;
-   std::cout << space( 2 ) << "qName:     " << toUString( qName ) << std::endl;
+   UNUSED( uri );
 
-   for ( size_t i = 0; i < attributes.getLength(); i++ )
+   // Transcode the element and its attributes to UTF-8 and hand them to the
+   // builder, which does all the E57 interpretation.
+   XmlAttributes uAttributes;
+   const size_t attributeCount = attributes.getLength();
+   for ( size_t i = 0; i < attributeCount; i++ )
    {
-      std::cout << space( 2 ) << "Attribute[" << i << "]" << std::endl;
-      std::cout << space( 4 ) << "URI:       " << toUString( attributes.getURI( i ) ) << std::endl;
-      std::cout << space( 4 ) << "localName: " << toUString( attributes.getLocalName( i ) )
-                << std::endl;
-      std::cout << space( 4 ) << "qName:     " << toUString( attributes.getQName( i ) )
-                << std::endl;
-      std::cout << space( 4 ) << "value:     " << toUString( attributes.getValue( i ) )
-                << std::endl;
+      uAttributes.add( toUString( attributes.getQName( i ) ),
+                       toUString( attributes.getValue( i ) ) );
    }
-#endif
-   // Get Type attribute
-   ustring node_type = lookupAttribute( attributes, att_type );
-
-   //??? check to make sure not in primitive type (can only nest inside compound types).
-
-   ParseInfo pi;
 
-   if ( node_type == "Integer" )
-   {
-#ifdef E57_VERBOSE
-      std::cout << "got a Integer" << std::endl;
-#endif
-      //??? check validity of numeric strings
-      pi.nodeType = TypeInteger;
-
-      if ( isAttributeDefined( attributes, att_minimum ) )
-      {
-         ustring minimum_str = lookupAttribute( attributes, att_minimum );
+   builder_.startElement( toUString( localName ), toUString( qName ), uAttributes );
+}
 
-         pi.minimum = convertStrToLL( minimum_str );
-      }
-      else
-      {
-         // Not defined defined in XML, so defaults to E57_INT64_MIN
-         pi.minimum = INT64_MIN;
-      }
+void E57XmlParser::endElement( const XMLCh *const uri, const XMLCh *const localName,
+                               const XMLCh *const qName )
+{
+   UNUSED( uri );
+   UNUSED( localName );
 
-      if ( isAttributeDefined( attributes, att_maximum ) )
-      {
-         ustring maximum_str = lookupAttribute( attributes, att_maximum );
+   builder_.endElement( toUString( qName ) );
+}
 
-         pi.maximum = convertStrToLL( maximum_str );
-      }
-      else
-      {
-         // Not defined defined in XML, so defaults to E57_INT64_MAX
-         pi.maximum = INT64_MAX;
-      }
+void E57XmlParser::characters( const XMLCh *const chars, const XMLSize_t length )
+{
+   //??? use length to make ustring
+   UNUSED( length );
 
-      stack_.push( pi );
-   }
-   else if ( node_type == "ScaledInteger" )
-   {
-#ifdef E57_VERBOSE
-      std::cout << "got a ScaledInteger" << std::endl;
-#endif
-      pi.nodeType = TypeScaledInteger;
+   const ustring s = toUString( chars );
 
-      //??? check validity of numeric strings
-      if ( isAttributeDefined( attributes, att_minimum ) )
-      {
-         ustring minimum_str = lookupAttribute( attributes, att_minimum );
+   builder_.characters( s.data(), s.length() );
+}
 
-         pi.minimum = convertStrToLL( minimum_str );
-      }
-      else
-      {
-         // Not defined defined in XML, so defaults to E57_INT64_MIN
-         pi.minimum = INT64_MIN;
-      }
+void E57XmlParser::error( const SAXParseException &ex )
+{
+   throw E57_EXCEPTION2(
+      ErrorXMLParser, "systemId=" + ustring( XMLString::transcode( ex.getSystemId() ) ) +
+                         " xmlLine=" + toString( ex.getLineNumber() ) +
+                         " xmlColumn=" + toString( ex.getColumnNumber() ) +
+                         " parserMessage=" + ustring( XMLString::transcode( ex.getMessage() ) ) );
+}
 
-      if ( isAttributeDefined( attributes, att_maximum ) )
-      {
-         ustring maximum_str = lookupAttribute( attributes, att_maximum );
+void E57XmlParser::fatalError( const SAXParseException &ex )
+{
+   throw E57_EXCEPTION2(
+      ErrorXMLParser, "systemId=" + ustring( XMLString::transcode( ex.getSystemId() ) ) +
+                         " xmlLine=" + toString( ex.getLineNumber() ) +
+                         " xmlColumn=" + toString( ex.getColumnNumber() ) +
+                         " parserMessage=" + ustring( XMLString::transcode( ex.getMessage() ) ) );
+}
 
-         pi.maximum = convertStrToLL( maximum_str );
-      }
-      else
-      {
-         // Not defined defined in XML, so defaults to E57_INT64_MAX
-         pi.maximum = INT64_MAX;
-      }
+void E57XmlParser::warning( const SAXParseException &ex )
+{
+   // Don't take any action on warning from parser, just report
+   std::cerr << "**** XML parser warning: " << ustring( XMLString::transcode( ex.getMessage() ) )
+             << std::endl;
+   std::cerr << "  Debug info:" << std::endl;
+   std::cerr << "    systemId=" << XMLString::transcode( ex.getSystemId() ) << std::endl;
+   std::cerr << ",   xmlLine=" << ex.getLineNumber() << std::endl;
+   std::cerr << ",   xmlColumn=" << ex.getColumnNumber() << std::endl;
+}
 
-      if ( isAttributeDefined( attributes, att_scale ) )
-      {
-         ustring scale_str = lookupAttribute( attributes, att_scale );
-         pi.scale = strToDouble( scale_str ); //??? use exact rounding library
-      }
-      else
-      {
-         // Not defined defined in XML, so defaults to 1.0
-         pi.scale = 1.0;
-      }
+//=============================================================================
+// E57XmlSectionScanner
 
-      if ( isAttributeDefined( attributes, att_offset ) )
-      {
-         ustring offset_str = lookupAttribute( attributes, att_offset );
-         pi.offset = strToDouble( offset_str ); //??? use exact rounding library
-      }
-      else
-      {
-         // Not defined defined in XML, so defaults to 0.0
-         pi.offset = 0.0;
-      }
+namespace
+{
+   // Element name used for the renamed copy of the root start tag that wraps a
+   // deferred child during its fragment parse. Must not be "e57Root" or the
+   // parser would re-register the file's namespace declarations.
+   const char *const cLazyWrapperName = "e57LazyRoot";
 
-      stack_.push( pi );
+   inline bool isXmlWhitespace( char c )
+   {
+      return ( c == ' ' || c == '\t' || c == '\n' || c == '\r' );
    }
-   else if ( node_type == "Float" )
+
+   /// Find the '>' ending the start tag whose name ends at index i, skipping
+   /// quoted attribute values. Returns ustring::npos if the tag never ends.
+   size_t findTagEnd( const ustring &xml, size_t i, bool &selfClosing )
    {
-#ifdef E57_VERBOSE
-      std::cout << "got a Float" << std::endl;
-#endif
-      pi.nodeType = TypeFloat;
+      char quote = 0;
 
-      if ( isAttributeDefined( attributes, att_precision ) )
+      for ( ; i < xml.length(); ++i )
       {
-         ustring precision_str = lookupAttribute( attributes, att_precision );
-         if ( precision_str == "single" )
+         const char c = xml[i];
+
+         if ( quote != 0 )
          {
-            pi.precision = PrecisionSingle;
+            if ( c == quote )
+            {
+               quote = 0;
+            }
          }
-         else if ( precision_str == "double" )
+         else if ( c == '"' || c == '\'' )
          {
-            pi.precision = PrecisionDouble;
+            quote = c;
          }
-         else
+         else if ( c == '>' )
          {
-            throw E57_EXCEPTION2( ErrorBadXMLFormat, "precisionString=" + precision_str +
-                                                        " fileName=" + imf_->fileName() +
-                                                        " uri=" + toUString( uri ) +
-                                                        " localName=" + toUString( localName ) +
-                                                        " qName=" + toUString( qName ) );
+            selfClosing = ( xml[i - 1] == '/' );
+            return ( i );
          }
       }
-      else
-      {
-         // Not defined defined in XML, so defaults to double
-         pi.precision = PrecisionDouble;
-      }
 
-      if ( isAttributeDefined( attributes, att_minimum ) )
-      {
-         ustring minimum_str = lookupAttribute( attributes, att_minimum );
-         pi.floatMinimum = strToDouble( minimum_str ); //??? use exact rounding library
-      }
-      else
+      return ( ustring::npos );
+   }
+
+   /// Return the value of the named attribute within a start tag, given the
+   /// index range between the element name and the closing '>'. Returns an
+   /// empty string if the attribute is absent or the tag is malformed.
+   ustring attributeValue( const ustring &xml, size_t i, size_t tagEnd, const char *attributeName )
+   {
+      while ( i < tagEnd )
       {
-         // Not defined defined in XML, so defaults to E57_FLOAT_MIN or E57_DOUBLE_MIN
-         if ( pi.precision == PrecisionSingle )
+         while ( i < tagEnd && isXmlWhitespace( xml[i] ) )
          {
-            pi.floatMinimum = FLOAT_MIN;
+            ++i;
          }
-         else
+
+         const size_t nameStart = i;
+         while ( i < tagEnd && xml[i] != '=' && !isXmlWhitespace( xml[i] ) )
          {
-            pi.floatMinimum = DOUBLE_MIN;
+            ++i;
          }
-      }
+         const size_t nameLength = i - nameStart;
 
-      if ( isAttributeDefined( attributes, att_maximum ) )
-      {
-         ustring maximum_str = lookupAttribute( attributes, att_maximum );
-         pi.floatMaximum = strToDouble( maximum_str ); //??? use exact rounding library
-      }
-      else
-      {
-         // Not defined defined in XML, so defaults to FLOAT_MAX or DOUBLE_MAX
-         if ( pi.precision == PrecisionSingle )
+         while ( i < tagEnd && isXmlWhitespace( xml[i] ) )
          {
-            pi.floatMaximum = FLOAT_MAX;
+            ++i;
          }
-         else
+         if ( i >= tagEnd || xml[i] != '=' || nameLength == 0 )
          {
-            pi.floatMaximum = DOUBLE_MAX;
+            return ustring();
          }
-      }
+         ++i;
 
-      stack_.push( pi );
-   }
-   else if ( node_type == "String" )
-   {
-#ifdef E57_VERBOSE
-      std::cout << "got a String" << std::endl;
-#endif
-      pi.nodeType = TypeString;
-
-      stack_.push( pi );
-   }
-   else if ( node_type == "Blob" )
-   {
-#ifdef E57_VERBOSE
-      std::cout << "got a Blob" << std::endl;
-#endif
-      pi.nodeType = TypeBlob;
-
-      //??? check validity of numeric strings
-
-      // fileOffset is required to be defined
-      ustring fileOffset_str = lookupAttribute( attributes, att_fileOffset );
-
-      pi.fileOffset = convertStrToLL( fileOffset_str );
-
-      // length is required to be defined
-      ustring length_str = lookupAttribute( attributes, att_length );
-
-      pi.length = convertStrToLL( length_str );
-
-      stack_.push( pi );
-   }
-   else if ( node_type == "Structure" )
-   {
-#ifdef E57_VERBOSE
-      std::cout << "got a Structure" << std::endl;
-#endif
-      pi.nodeType = TypeStructure;
-
-      // Read name space decls, if e57Root element
-      if ( toUString( localName ) == "e57Root" )
-      {
-         // Search attributes for namespace declarations (only allowed in E57Root structure)
-         bool gotDefault = false;
-         for ( size_t i = 0; i < attributes.getLength(); i++ )
+         while ( i < tagEnd && isXmlWhitespace( xml[i] ) )
          {
-            // Check if declaring the default namespace
-            if ( toUString( attributes.getQName( i ) ) == "xmlns" )
-            {
-#ifdef E57_VERBOSE
-               std::cout << "declared default namespace, URI="
-                         << toUString( attributes.getValue( i ) ) << std::endl;
-#endif
-               imf_->extensionsAdd( "", toUString( attributes.getValue( i ) ) );
-               gotDefault = true;
-            }
-
-            // Check if declaring a namespace
-            if ( toUString( attributes.getURI( i ) ) == "http://www.w3.org/2000/xmlns/" )
-            {
-#ifdef E57_VERBOSE
-               std::cout << "declared extension, prefix="
-                         << toUString( attributes.getLocalName( i ) )
-                         << " URI=" << toUString( attributes.getValue( i ) ) << std::endl;
-#endif
-               imf_->extensionsAdd( toUString( attributes.getLocalName( i ) ),
-                                    toUString( attributes.getValue( i ) ) );
-            }
+            ++i;
+         }
+         if ( i >= tagEnd || ( xml[i] != '"' && xml[i] != '\'' ) )
+         {
+            return ustring();
          }
 
-         // If didn't declare a default namespace, have error
-         if ( !gotDefault )
+         const char quote = xml[i];
+         const size_t valueStart = ++i;
+         const size_t valueEnd = xml.find( quote, valueStart );
+         if ( valueEnd == ustring::npos || valueEnd > tagEnd )
          {
-            throw E57_EXCEPTION2( ErrorBadXMLFormat, "fileName=" + imf_->fileName() +
-                                                        " uri=" + toUString( uri ) +
-                                                        " localName=" + toUString( localName ) +
-                                                        " qName=" + toUString( qName ) );
+            return ustring();
          }
-      }
 
-      // Create container now, so can hold children
-      std::shared_ptr<StructureNodeImpl> s_ni( new StructureNodeImpl( imf_ ) );
-      pi.container_ni = s_ni;
+         if ( xml.compare( nameStart, nameLength, attributeName ) == 0 )
+         {
+            return xml.substr( valueStart, valueEnd - valueStart );
+         }
 
-      // After have Structure, check again if E57Root, if so mark attached so all children will be
-      // attached when added
-      if ( toUString( localName ) == "e57Root" )
-      {
-         s_ni->setAttachedRecursive();
+         i = valueEnd + 1;
       }
 
-      stack_.push( pi );
+      return ustring();
    }
-   else if ( node_type == "Vector" )
-   {
-#ifdef E57_VERBOSE
-      std::cout << "got a Vector" << std::endl;
-#endif
-      pi.nodeType = TypeVector;
 
-      if ( isAttributeDefined( attributes, att_allowHeterogeneousChildren ) )
+   /// Check an XML declaration (or other processing instruction) for an
+   /// encoding the byte-oriented scanner can't handle.
+   bool encodingIsUTF8( const ustring &piText )
+   {
+      const size_t encodingPos = piText.find( "encoding" );
+      if ( encodingPos == ustring::npos )
       {
-         ustring allowHetero_str = lookupAttribute( attributes, att_allowHeterogeneousChildren );
-
-         int64_t i64 = convertStrToLL( allowHetero_str );
-
-         if ( i64 == 0 )
-         {
-            pi.allowHeterogeneousChildren = false;
-         }
-         else if ( i64 == 1 )
-         {
-            pi.allowHeterogeneousChildren = true;
-         }
-         else
-         {
-            throw E57_EXCEPTION2( ErrorBadXMLFormat,
-                                  "allowHeterogeneousChildren=" + toString( i64 ) +
-                                     "fileName=" + imf_->fileName() + " uri=" + toUString( uri ) +
-                                     " localName=" + toUString( localName ) +
-                                     " qName=" + toUString( qName ) );
-         }
+         // No declared encoding defaults to UTF-8
+         return true;
       }
-      else
+
+      ustring value =
+         attributeValue( piText, encodingPos, piText.length(), "encoding" );
+      for ( auto &c : value )
       {
-         // Not defined defined in XML, so defaults to false
-         pi.allowHeterogeneousChildren = false;
+         c = static_cast<char>( tolower( static_cast<unsigned char>( c ) ) );
       }
 
-      // Create container now, so can hold children
-      std::shared_ptr<VectorNodeImpl> v_ni(
-         new VectorNodeImpl( imf_, pi.allowHeterogeneousChildren ) );
-      pi.container_ni = v_ni;
-
-      stack_.push( pi );
+      return ( value == "utf-8" );
    }
-   else if ( node_type == "CompressedVector" )
-   {
-#ifdef E57_VERBOSE
-      std::cout << "got a CompressedVector" << std::endl;
-#endif
-      pi.nodeType = TypeCompressedVector;
-
-      // fileOffset is required to be defined
-      ustring fileOffset_str = lookupAttribute( attributes, att_fileOffset );
-
-      pi.fileOffset = convertStrToLL( fileOffset_str );
-
-      // recordCount is required to be defined
-      ustring recordCount_str = lookupAttribute( attributes, att_recordCount );
-
-      pi.recordCount = convertStrToLL( recordCount_str );
-
-      // Create container now, so can hold children
-      std::shared_ptr<CompressedVectorNodeImpl> cv_ni( new CompressedVectorNodeImpl( imf_ ) );
-      cv_ni->setRecordCount( pi.recordCount );
-      cv_ni->setBinarySectionLogicalStart(
-         imf_->file_->physicalToLogical( pi.fileOffset ) ); //??? what if file_ is NULL?
-      pi.container_ni = cv_ni;
-
-      stack_.push( pi );
-   }
-   else
-   {
-      throw E57_EXCEPTION2( ErrorBadXMLFormat,
-                            "nodeType=" + node_type + " fileName=" + imf_->fileName() +
-                               " uri=" + toUString( uri ) + " localName=" + toUString( localName ) +
-                               " qName=" + toUString( qName ) );
-   }
-#ifdef E57_VERBOSE
-   pi.dump( 4 );
-#endif
 }
 
-void E57XmlParser::endElement( const XMLCh *const uri, const XMLCh *const localName,
-                               const XMLCh *const qName )
+bool E57XmlSectionScanner::scan( const ustring &xml, uint64_t sectionLogicalStart )
 {
-#ifdef E57_VERBOSE
-   std::cout << "endElement" << std::endl;
-#endif
-
-   // Pop the node that just ended
-   ParseInfo pi = stack_.top(); //??? really want to make a copy here?
-   stack_.pop();
-#ifdef E57_VERBOSE
-   pi.dump( 4 );
-#endif
+   reducedXml_.clear();
+   fragmentPrefix_.clear();
+   fragmentSuffix_.clear();
+   data3DChildren_.clear();
+   images2DChildren_.clear();
+
+   // A multi-byte encoding's byte order mark means the byte offsets computed
+   // below would be meaningless.
+   if ( xml.length() >= 2 )
+   {
+      const auto b0 = static_cast<unsigned char>( xml[0] );
+      const auto b1 = static_cast<unsigned char>( xml[1] );
+      if ( ( b0 == 0xFE && b1 == 0xFF ) || ( b0 == 0xFF && b1 == 0xFE ) )
+      {
+         return false;
+      }
+   }
 
-   // We should now have all the info we need to create the node
-   NodeImplSharedPtr current_ni;
+   size_t i = 0;
+   size_t lastCopied = 0;
+   size_t childStart = 0;
+   int depth = 0;
+   bool seenData3D = false;
+   bool seenImages2D = false;
+   std::vector<XmlByteRange> *target = nullptr;
 
-   switch ( pi.nodeType )
+   while ( i < xml.length() )
    {
-      case TypeStructure:
-      case TypeVector:
-         current_ni = pi.container_ni;
-         break;
-      case TypeCompressedVector:
+      const size_t open = xml.find( '<', i );
+      if ( open == ustring::npos )
       {
-         // Verify that both prototype and codecs child elements were defined
-         // ???
-         current_ni = pi.container_ni;
+         // Only trailing text (e.g. the section's zero padding) remains
+         break;
       }
-      break;
-      case TypeInteger:
+      i = open;
+
+      if ( xml.compare( i, 4, "<!--" ) == 0 )
       {
-         // Convert child text (if any) to value, else default to 0.0
-         int64_t intValue;
-         if ( pi.childText.length() > 0 )
-         {
-            intValue = convertStrToLL( pi.childText );
-         }
-         else
+         const size_t end = xml.find( "-->", i + 4 );
+         if ( end == ustring::npos )
          {
-            intValue = 0;
+            return false;
          }
-         std::shared_ptr<IntegerNodeImpl> i_ni(
-            new IntegerNodeImpl( imf_, intValue, pi.minimum, pi.maximum ) );
-         current_ni = i_ni;
+         i = end + 3;
+         continue;
       }
-      break;
-      case TypeScaledInteger:
+
+      if ( xml.compare( i, 9, "<![CDATA[" ) == 0 )
       {
-         // Convert child text (if any) to value, else default to 0.0
-         int64_t intValue;
-         if ( pi.childText.length() > 0 )
+         const size_t end = xml.find( "]]>", i + 9 );
+         if ( end == ustring::npos )
          {
-            intValue = convertStrToLL( pi.childText );
+            return false;
          }
-         else
+         i = end + 3;
+         continue;
+      }
+
+      if ( xml.compare( i, 2, "<?" ) == 0 )
+      {
+         const size_t end = xml.find( "?>", i + 2 );
+         if ( end == ustring::npos || !encodingIsUTF8( xml.substr( i, end + 2 - i ) ) )
          {
-            intValue = 0;
+            return false;
          }
-         std::shared_ptr<ScaledIntegerNodeImpl> si_ni( new ScaledIntegerNodeImpl(
-            imf_, intValue, pi.minimum, pi.maximum, pi.scale, pi.offset ) );
-         current_ni = si_ni;
+         i = end + 2;
+         continue;
       }
-      break;
-      case TypeFloat:
+
+      if ( xml.compare( i, 2, "<!" ) == 0 )
       {
-         // Convert child text (if any) to value, else default to 0.0
-         double floatValue;
-         if ( pi.childText.length() > 0 )
+         // DOCTYPE or other declaration: don't try to be clever
+         return false;
+      }
+
+      if ( xml.compare( i, 2, "</" ) == 0 )
+      {
+         const size_t end = xml.find( '>', i + 2 );
+         if ( end == ustring::npos || depth <= 0 )
          {
-            floatValue = strToDouble( pi.childText );
+            return false;
          }
-         else
+
+         if ( depth == 3 && target != nullptr )
+         {
+            // A deferred child ends: remember its bytes, cut them from the
+            // reduced document
+            target->push_back( { sectionLogicalStart + childStart, end + 1 - childStart } );
+            reducedXml_.append( xml, lastCopied, childStart - lastCopied );
+            lastCopied = end + 1;
+         }
+
+         --depth;
+         if ( depth == 1 )
          {
-            floatValue = 0.0;
+            target = nullptr;
          }
-         std::shared_ptr<FloatNodeImpl> f_ni(
-            new FloatNodeImpl( imf_, floatValue, pi.precision, pi.floatMinimum, pi.floatMaximum ) );
-         current_ni = f_ni;
+         i = end + 1;
+         continue;
       }
-      break;
-      case TypeString:
+
+      // Have a start tag, parse out the element name
+      const size_t nameStart = i + 1;
+      size_t j = nameStart;
+      while ( j < xml.length() && !isXmlWhitespace( xml[j] ) && xml[j] != '>' && xml[j] != '/' )
       {
-         std::shared_ptr<StringNodeImpl> s_ni( new StringNodeImpl( imf_, pi.childText ) );
-         current_ni = s_ni;
+         ++j;
       }
-      break;
-      case TypeBlob:
+      if ( j == nameStart || j >= xml.length() )
       {
-         std::shared_ptr<BlobNodeImpl> b_ni( new BlobNodeImpl( imf_, pi.fileOffset, pi.length ) );
-         current_ni = b_ni;
+         return false;
       }
-      break;
-      default:
-         throw E57_EXCEPTION2(
-            ErrorInternal, "nodeType=" + toString( pi.nodeType ) + " fileName=" + imf_->fileName() +
-                              " uri=" + toUString( uri ) + " localName=" + toUString( localName ) +
-                              " qName=" + toUString( qName ) );
-   }
-#ifdef E57_VERBOSE
-   current_ni->dump( 4 );
-#endif
+      const ustring name = xml.substr( nameStart, j - nameStart );
 
-   // If first node in file ended, we are all done
-   if ( stack_.empty() )
-   {
-      // Top level should be Structure
-      if ( current_ni->type() != TypeStructure )
+      bool selfClosing = false;
+      const size_t end = findTagEnd( xml, j, selfClosing );
+      if ( end == ustring::npos )
       {
-         throw E57_EXCEPTION2( ErrorBadXMLFormat, "currentType=" + toString( current_ni->type() ) +
-                                                     " fileName=" + imf_->fileName() +
-                                                     " uri=" + toUString( uri ) +
-                                                     " localName=" + toUString( localName ) +
-                                                     " qName=" + toUString( qName ) );
+         return false;
       }
-      imf_->root_ = std::static_pointer_cast<StructureNodeImpl>( current_ni );
-      return;
-   }
 
-   // Get next level up node (when entered function), which should be a container.
-   NodeImplSharedPtr parent_ni = stack_.top().container_ni;
+      ++depth;
 
-   if ( !parent_ni )
-   {
-      throw E57_EXCEPTION2( ErrorBadXMLFormat, "fileName=" + imf_->fileName() +
-                                                  " uri=" + toUString( uri ) +
-                                                  " localName=" + toUString( localName ) +
-                                                  " qName=" + toUString( qName ) );
-   }
-
-   // Add current node into parent at top of stack
-   switch ( parent_ni->type() )
-   {
-      case TypeStructure:
+      if ( depth == 1 )
       {
-         std::shared_ptr<StructureNodeImpl> struct_ni =
-            std::static_pointer_cast<StructureNodeImpl>( parent_ni );
-
-         // Add named child to structure
-         struct_ni->set( toUString( qName ), current_ni );
-      }
-      break;
-      case TypeVector:
-      {
-         std::shared_ptr<VectorNodeImpl> vector_ni =
-            std::static_pointer_cast<VectorNodeImpl>( parent_ni );
+         if ( selfClosing )
+         {
+            // Root element has no children, nothing to defer
+            return false;
+         }
 
-         // Add unnamed child to vector
-         vector_ni->append( current_ni );
+         // Replay the root's start tag (with its namespace declarations)
+         // around single-child fragments later, renamed so the parser doesn't
+         // treat the wrapper as a real e57Root.
+         fragmentPrefix_ = "<" + ustring( cLazyWrapperName ) + xml.substr( j, end + 1 - j );
+         fragmentSuffix_ = ustring( "</" ) + cLazyWrapperName + ">";
       }
-      break;
-      case TypeCompressedVector:
+      else if ( depth == 2 && !selfClosing )
       {
-         std::shared_ptr<CompressedVectorNodeImpl> cv_ni =
-            std::static_pointer_cast<CompressedVectorNodeImpl>( parent_ni );
-         ustring uQName = toUString( qName );
-
-         // n can be either prototype or codecs
-         if ( uQName == "prototype" )
-         {
-            cv_ni->setPrototype( current_ni );
-         }
-         else if ( uQName == "codecs" )
+         target = nullptr;
+         if ( name == "data3D" || name == "images2D" )
          {
-            if ( current_ni->type() != TypeVector )
+            bool &seen = ( name == "data3D" ) ? seenData3D : seenImages2D;
+            if ( seen )
             {
-               throw E57_EXCEPTION2(
-                  ErrorBadXMLFormat,
-                  "currentType=" + toString( current_ni->type() ) +
-                     " fileName=" + imf_->fileName() + " uri=" + toUString( uri ) +
-                     " localName=" + toUString( localName ) + " qName=" + toUString( qName ) );
+               // Duplicated element, let the real parser report the error
+               return false;
             }
-            std::shared_ptr<VectorNodeImpl> vi =
-               std::static_pointer_cast<VectorNodeImpl>( current_ni );
+            seen = true;
 
-            // Check VectorNode is hetero
-            if ( !vi->allowHeteroChildren() )
+            if ( attributeValue( xml, j, end, "type" ) == "Vector" )
             {
-               throw E57_EXCEPTION2(
-                  ErrorBadXMLFormat,
-                  "currentType=" + toString( current_ni->type() ) +
-                     " fileName=" + imf_->fileName() + " uri=" + toUString( uri ) +
-                     " localName=" + toUString( localName ) + " qName=" + toUString( qName ) );
+               target = ( name == "data3D" ) ? &data3DChildren_ : &images2DChildren_;
             }
-
-            cv_ni->setCodecs( vi );
          }
-         else
+      }
+      else if ( depth == 3 && target != nullptr )
+      {
+         childStart = i;
+         if ( selfClosing )
          {
-            // Found unknown XML child element of CompressedVector, not prototype or codecs
-            throw E57_EXCEPTION2( ErrorBadXMLFormat, +"fileName=" + imf_->fileName() +
-                                                        " uri=" + toUString( uri ) +
-                                                        " localName=" + toUString( localName ) +
-                                                        " qName=" + toUString( qName ) );
+            target->push_back( { sectionLogicalStart + childStart, end + 1 - childStart } );
+            reducedXml_.append( xml, lastCopied, childStart - lastCopied );
+            lastCopied = end + 1;
          }
       }
-      break;
-      default:
-         // Have bad XML nesting, parent should have been a container.
-         throw E57_EXCEPTION2( ErrorBadXMLFormat, "parentType=" + toString( parent_ni->type() ) +
-                                                     " fileName=" + imf_->fileName() +
-                                                     " uri=" + toUString( uri ) +
-                                                     " localName=" + toUString( localName ) +
-                                                     " qName=" + toUString( qName ) );
-   }
-}
-
-void E57XmlParser::characters( const XMLCh *const chars, const XMLSize_t length )
-{
-//??? use length to make ustring
-#ifdef E57_VERBOSE
-   std::cout << "characters, chars=\"" << toUString( chars ) << "\" length=" << length << std::endl;
-#else
-   UNUSED( length );
-#endif
 
-   // Get active element
-   ParseInfo &pi = stack_.top();
-
-   // Check if child text is allowed for current E57 element type
-   switch ( pi.nodeType )
-   {
-      case TypeStructure:
-      case TypeVector:
-      case TypeCompressedVector:
-      case TypeBlob:
+      if ( selfClosing )
       {
-         // If characters aren't whitespace, have an error, else ignore
-         ustring s = toUString( chars );
-         if ( s.find_first_not_of( " \t\n\r" ) != std::string::npos )
-         {
-            throw E57_EXCEPTION2( ErrorBadXMLFormat, "chars=" + toUString( chars ) );
-         }
+         --depth;
       }
-      break;
-      default:
-         // Append to any previous characters
-         pi.childText += toUString( chars );
+      i = end + 1;
    }
-}
 
-void E57XmlParser::error( const SAXParseException &ex )
-{
-   throw E57_EXCEPTION2(
-      ErrorXMLParser, "systemId=" + ustring( XMLString::transcode( ex.getSystemId() ) ) +
-                         " xmlLine=" + toString( ex.getLineNumber() ) +
-                         " xmlColumn=" + toString( ex.getColumnNumber() ) +
-                         " parserMessage=" + ustring( XMLString::transcode( ex.getMessage() ) ) );
-}
+   if ( depth != 0 )
+   {
+      return false;
+   }
 
-void E57XmlParser::fatalError( const SAXParseException &ex )
-{
-   throw E57_EXCEPTION2(
-      ErrorXMLParser, "systemId=" + ustring( XMLString::transcode( ex.getSystemId() ) ) +
-                         " xmlLine=" + toString( ex.getLineNumber() ) +
-                         " xmlColumn=" + toString( ex.getColumnNumber() ) +
-                         " parserMessage=" + ustring( XMLString::transcode( ex.getMessage() ) ) );
-}
+   if ( data3DChildren_.empty() && images2DChildren_.empty() )
+   {
+      // Nothing worth deferring, eager parse of the original text is simpler
+      return false;
+   }
 
-void E57XmlParser::warning( const SAXParseException &ex )
-{
-   // Don't take any action on warning from parser, just report
-   std::cerr << "**** XML parser warning: " << ustring( XMLString::transcode( ex.getMessage() ) )
-             << std::endl;
-   std::cerr << "  Debug info:" << std::endl;
-   std::cerr << "    systemId=" << XMLString::transcode( ex.getSystemId() ) << std::endl;
-   std::cerr << ",   xmlLine=" << ex.getLineNumber() << std::endl;
-   std::cerr << ",   xmlColumn=" << ex.getColumnNumber() << std::endl;
+   reducedXml_.append( xml, lastCopied, xml.length() - lastCopied );
+   return true;
 }
@@ -27,12 +27,10 @@
 
 #pragma once
 
-#include <stack>
-
 #include <xercesc/sax/InputSource.hpp>
 #include <xercesc/sax2/DefaultHandler.hpp>
 
-#include "Common.h"
+#include "E57XmlBuilder.h"
 
 using namespace XERCES_CPP_NAMESPACE;
 
@@ -45,6 +43,10 @@ namespace e57
 {
    class CheckedFile;
 
+   /// Xerces SAX2 parser backend: transcodes each callback to UTF-8 and
+   /// forwards it to an E57XmlBuilder. Slower than E57XmlLiteParser, but
+   /// validating, so it is kept as the fallback for documents the built-in
+   /// parser rejects (and as the only backend with E57_STRICT_XML_PARSER).
    class E57XmlParser : public DefaultHandler
    {
    public:
@@ -69,35 +71,7 @@ namespace e57
 
       ImageFileImplSharedPtr imf_; /// Image file we are reading
 
-      struct ParseInfo
-      {
-         // All the fields need to remember while parsing the XML
-         // Not all fields are used at same time, depends on node type
-         // Needed because not all info is available at one time to create the
-         // node.
-         NodeType nodeType;               // used by all types
-         int64_t minimum;                 // used in Integer, ScaledInteger
-         int64_t maximum;                 // used in Integer, ScaledInteger
-         double scale;                    // used in ScaledInteger
-         double offset;                   // used in ScaledInteger
-         FloatPrecision precision;        // used in Float
-         double floatMinimum;             // used in Float
-         double floatMaximum;             // used in Float
-         int64_t fileOffset;              // used in Blob, CompressedVector
-         int64_t length;                  // used in Blob
-         bool allowHeterogeneousChildren; // used in Vector
-         int64_t recordCount;             // used in CompressedVector
-         ustring childText; // used by all types, accumulates all child text between tags
-
-         // Holds node for Structure, Vector, and CompressedVector so can append
-         // child elements
-         NodeImplSharedPtr container_ni;
-
-         ParseInfo(); // default ctor
-         void dump( int indent = 0, std::ostream &os = std::cout ) const;
-      };
-
-      std::stack<ParseInfo> stack_; /// Stores the current path in tree we are reading
+      E57XmlBuilder builder_; /// Builds the node tree from transcoded SAX events
 
       SAX2XMLReader *xmlReader;
    };
@@ -119,4 +93,73 @@ namespace e57
       uint64_t logicalStart_;
       uint64_t logicalLength_;
    };
+
+   class E57XmlMemBufInputSource : public InputSource
+   {
+   public:
+      explicit E57XmlMemBufInputSource( const ustring &buffer );
+      ~E57XmlMemBufInputSource() override = default;
+
+      E57XmlMemBufInputSource( const E57XmlMemBufInputSource & ) = delete;
+      E57XmlMemBufInputSource &operator=( const E57XmlMemBufInputSource & ) = delete;
+
+      BinInputStream *makeStream() const override;
+
+   private:
+      //??? lifetime of buffer_ must be longer than this object!
+      const ustring &buffer_;
+   };
+
+   /// Single cheap pass over the text of the XML section that finds the byte
+   /// ranges of the children of the root-level /data3D and /images2D vectors,
+   /// so their subtrees can be parsed individually on first access instead of
+   /// all at once when the file is opened.
+   ///
+   /// The scanner only tracks enough XML structure (tags, comments, CDATA,
+   /// quoted attribute values) to count element nesting; anything it doesn't
+   /// expect in an E57 file makes scan() return false and the caller falls
+   /// back to parsing the whole section eagerly.
+   class E57XmlSectionScanner
+   {
+   public:
+      /// Scan the complete text of the XML section. @a sectionLogicalStart is
+      /// the logical file offset of xml[0], used to report child ranges as
+      /// absolute file offsets. Returns false if the section should be parsed
+      /// eagerly instead.
+      bool scan( const ustring &xml, uint64_t sectionLogicalStart );
+
+      /// The section text with the bytes of all deferred children removed
+      const ustring &reducedXml() const
+      {
+         return reducedXml_;
+      }
+
+      /// Copy of the root start tag (renamed, so namespace declarations stay
+      /// in scope) and matching end tag to wrap around one deferred child to
+      /// form a parseable document
+      const ustring &fragmentPrefix() const
+      {
+         return fragmentPrefix_;
+      }
+      const ustring &fragmentSuffix() const
+      {
+         return fragmentSuffix_;
+      }
+
+      const std::vector<XmlByteRange> &data3DChildren() const
+      {
+         return data3DChildren_;
+      }
+      const std::vector<XmlByteRange> &images2DChildren() const
+      {
+         return images2DChildren_;
+      }
+
+   private:
+      ustring reducedXml_;
+      ustring fragmentPrefix_;
+      ustring fragmentSuffix_;
+      std::vector<XmlByteRange> data3DChildren_;
+      std::vector<XmlByteRange> images2DChildren_;
+   };
 }
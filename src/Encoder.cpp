@@ -36,6 +36,7 @@
 #include "Packet.h"
 #include "ScaledIntegerNodeImpl.h"
 #include "SourceDestBufferImpl.h"
+#include "StreamCompression.h"
 #include "StringFunctions.h"
 
 using namespace e57;
@@ -43,7 +44,24 @@ using namespace e57;
 std::shared_ptr<Encoder> Encoder::EncoderFactory( unsigned bytestreamNumber,
                                                   std::shared_ptr<CompressedVectorNodeImpl> cVector,
                                                   std::vector<SourceDestBuffer> &sbufs,
-                                                  ustring & /*codecPath*/ )
+                                                  ustring &codecPath )
+{
+   std::shared_ptr<Encoder> encoder =
+      baseEncoderFactory( bytestreamNumber, cVector, sbufs, codecPath );
+
+   // Opt-in "lzbs" extension: compress the bytestream in blocks when the
+   // codecs vector asks for it (see StreamCompression.h)
+   if ( streamCompressionRequested( cVector.get(), sbufs.at( 0 ).pathName() ) )
+   {
+      encoder = std::shared_ptr<Encoder>( new CompressedStreamEncoder( encoder ) );
+   }
+
+   return encoder;
+}
+
+std::shared_ptr<Encoder> Encoder::baseEncoderFactory(
+   unsigned bytestreamNumber, std::shared_ptr<CompressedVectorNodeImpl> cVector,
+   std::vector<SourceDestBuffer> &sbufs, ustring & /*codecPath*/ )
 {
    //??? For now, only handle one input
    if ( sbufs.size() != 1 )
@@ -88,6 +106,16 @@ std::shared_ptr<Encoder> Encoder::EncoderFactory( unsigned bytestreamNumber,
             return encoder;
          }
 
+         // Opt-in "dlta" extension: delta-code the field when the codecs
+         // vector asks for it (see StreamCompression.h)
+         if ( streamDeltaRequested( cVector.get(), path ) )
+         {
+            std::shared_ptr<Encoder> encoder( new DeltaIntegerEncoder(
+               false, bytestreamNumber, sbuf, ini->minimum(), ini->maximum(), 1.0, 0.0 ) );
+
+            return encoder;
+         }
+
          if ( bitsPerRecord <= 8 )
          {
             std::shared_ptr<Encoder> encoder( new BitpackIntegerEncoder<uint8_t>(
@@ -143,6 +171,17 @@ std::shared_ptr<Encoder> Encoder::EncoderFactory( unsigned bytestreamNumber,
             return encoder;
          }
 
+         // Opt-in "dlta" extension: delta-code the field when the codecs
+         // vector asks for it (see StreamCompression.h)
+         if ( streamDeltaRequested( cVector.get(), path ) )
+         {
+            std::shared_ptr<Encoder> encoder(
+               new DeltaIntegerEncoder( true, bytestreamNumber, sbuf, sini->minimum(),
+                                        sini->maximum(), sini->scale(), sini->offset() ) );
+
+            return encoder;
+         }
+
          if ( bitsPerRecord <= 8 )
          {
             std::shared_ptr<Encoder> encoder( new BitpackIntegerEncoder<uint8_t>(
@@ -215,9 +254,20 @@ void Encoder::dump( int indent, std::ostream &os ) const
 BitpackEncoder::BitpackEncoder( unsigned bytestreamNumber, SourceDestBuffer &sbuf,
                                 unsigned outputMaxSize, unsigned alignmentSize ) :
    Encoder( bytestreamNumber ),
-   sourceBuffer_( sbuf.impl() ), outBuffer_( outputMaxSize ), outBufferFirst_( 0 ),
-   outBufferEnd_( 0 ), outBufferAlignmentSize_( alignmentSize ), currentRecordIndex_( 0 )
+   sourceBuffer_( sbuf.impl() ), outBufferFirst_( 0 ), outBufferEnd_( 0 ),
+   outBufferAlignmentSize_( alignmentSize ), currentRecordIndex_( 0 )
 {
+   // Lease the output buffer from the file's pool, so consecutive writers
+   // against the same file reuse each other's allocations
+   ImageFileImplSharedPtr imf( sourceBuffer_->destImageFile() );
+
+   bufferPool_ = imf->bufferPool();
+   outBuffer_ = bufferPool_->acquire( outputMaxSize );
+}
+
+BitpackEncoder::~BitpackEncoder()
+{
+   bufferPool_->release( std::move( outBuffer_ ) );
 }
 
 unsigned BitpackEncoder::sourceBufferNextIndex()
@@ -433,13 +483,13 @@ uint64_t BitpackFloatEncoder::processRecords( size_t recordCount )
       auto outp = reinterpret_cast<float *>( &outBuffer_[outBufferEnd_] );
 
       // Copy floats from sourceBuffer_ to outBuffer_
+      sourceBuffer_->getNextFloatN( outp, recordCount );
+#ifdef E57_VERBOSE
       for ( unsigned i = 0; i < recordCount; i++ )
       {
-         outp[i] = sourceBuffer_->getNextFloat();
-#ifdef E57_VERBOSE
          std::cout << "encoding float: " << outp[i] << std::endl;
-#endif
       }
+#endif
    }
    else
    {
@@ -448,13 +498,13 @@ uint64_t BitpackFloatEncoder::processRecords( size_t recordCount )
       auto outp = reinterpret_cast<double *>( &outBuffer_[outBufferEnd_] );
 
       // Copy doubles from sourceBuffer_ to outBuffer_
+      sourceBuffer_->getNextDoubleN( outp, recordCount );
+#ifdef E57_VERBOSE
       for ( unsigned i = 0; i < recordCount; i++ )
       {
-         outp[i] = sourceBuffer_->getNextDouble();
-#ifdef E57_VERBOSE
          std::cout << "encoding double: " << outp[i] << std::endl;
-#endif
       }
+#endif
    }
 
    // Update end of outBuffer
@@ -724,8 +774,140 @@ uint64_t BitpackIntegerEncoder<RegisterT>::processRecords( size_t recordCount )
    auto outp = reinterpret_cast<RegisterT *>( &outBuffer_[outBufferEnd_] );
    unsigned outTransferred = 0;
 
+   size_t recordIndex = 0;
+
+   // Fast path: when each record exactly fills the register, the packed
+   // stream is just the sequence of biased values with no shifting or carry
+   // between records. The transfer loop is then simple enough for the
+   // compiler to vectorize.
+   if ( ( registerBitsUsed_ == 0 ) && ( bitsPerRecord_ == 8 * sizeof( RegisterT ) ) )
+   {
+      constexpr size_t cChunkSize = 512;
+
+      int64_t fetched[cChunkSize];
+
+      while ( recordIndex < recordCount )
+      {
+         const size_t chunk = std::min( recordCount - recordIndex, cChunkSize );
+
+         // Fetch a whole run from the source buffer in one call
+         if ( isScaledInteger_ )
+         {
+            sourceBuffer_->getNextInt64N( fetched, chunk, scale_, offset_ );
+         }
+         else
+         {
+            sourceBuffer_->getNextInt64N( fetched, chunk );
+         }
+
+         for ( size_t j = 0; j < chunk; j++ )
+         {
+            const int64_t rawValue = fetched[j];
+
+            // Enforce min/max specification on value
+            if ( rawValue < minimum_ || maximum_ < rawValue )
+            {
+               throw E57_EXCEPTION2( ErrorValueOutOfBounds, "rawValue=" + toString( rawValue ) +
+                                                               " minimum=" + toString( minimum_ ) +
+                                                               " maximum=" + toString( maximum_ ) );
+            }
+
+#ifdef VALIDATE_BASIC
+            // Before transfer, double check address within bounds
+            if ( outTransferred >= transferMax )
+            {
+               throw E57_EXCEPTION2( ErrorInternal, "outTransferred=" + toString( outTransferred ) +
+                                                       " transferMax" + toString( transferMax ) );
+            }
+#endif
+            outp[outTransferred] =
+               static_cast<RegisterT>( static_cast<uint64_t>( rawValue - minimum_ ) &
+                                       static_cast<uint64_t>( sourceBitMask_ ) );
+            outTransferred++;
+         }
+
+         recordIndex += chunk;
+      }
+   }
+   else if ( sizeof( RegisterT ) < sizeof( uint64_t ) )
+   {
+      // Fast path for narrow fields: the bit-level carry between records is
+      // serial, so instead of vectorizing we accumulate into a 64-bit staging
+      // window and flush whole register words from its low end. This produces
+      // the identical words to the register loop below with a single
+      // well-predicted branch per record instead of a three-way carry split.
+      //
+      // (The ternary keeps the shifts below well-formed for the uint64_t
+      // instantiation, which never takes this path.)
+      const unsigned cWordBits = ( sizeof( RegisterT ) < 8 ) ? 8 * sizeof( RegisterT ) : 1;
+
+      constexpr size_t cChunkSize = 512;
+
+      int64_t fetched[cChunkSize];
+
+      uint64_t window = register_;
+      unsigned windowBits = registerBitsUsed_;
+
+      while ( recordIndex < recordCount )
+      {
+         const size_t chunk = std::min( recordCount - recordIndex, cChunkSize );
+
+         // Fetch a whole run from the source buffer in one call
+         if ( isScaledInteger_ )
+         {
+            sourceBuffer_->getNextInt64N( fetched, chunk, scale_, offset_ );
+         }
+         else
+         {
+            sourceBuffer_->getNextInt64N( fetched, chunk );
+         }
+
+         for ( size_t j = 0; j < chunk; j++ )
+         {
+            const int64_t rawValue = fetched[j];
+
+            // Enforce min/max specification on value
+            if ( rawValue < minimum_ || maximum_ < rawValue )
+            {
+               throw E57_EXCEPTION2( ErrorValueOutOfBounds, "rawValue=" + toString( rawValue ) +
+                                                               " minimum=" + toString( minimum_ ) +
+                                                               " maximum=" + toString( maximum_ ) );
+            }
+
+            const uint64_t uValue = static_cast<uint64_t>( rawValue - minimum_ ) &
+                                    static_cast<uint64_t>( sourceBitMask_ );
+
+            window |= uValue << windowBits;
+            windowBits += bitsPerRecord_;
+
+            if ( windowBits >= cWordBits )
+            {
+#ifdef VALIDATE_BASIC
+               // Before transfer, double check address within bounds
+               if ( outTransferred >= transferMax )
+               {
+                  throw E57_EXCEPTION2( ErrorInternal,
+                                        "outTransferred=" + toString( outTransferred ) +
+                                           " transferMax" + toString( transferMax ) );
+               }
+#endif
+               outp[outTransferred] = static_cast<RegisterT>( window );
+               outTransferred++;
+
+               window >>= cWordBits;
+               windowBits -= cWordBits;
+            }
+         }
+
+         recordIndex += chunk;
+      }
+
+      register_ = static_cast<RegisterT>( window );
+      registerBitsUsed_ = windowBits;
+   }
+
    // Copy bits from sourceBuffer_ to outBuffer_
-   for ( unsigned i = 0; i < recordCount; i++ )
+   for ( size_t i = recordIndex; i < recordCount; i++ )
    {
       int64_t rawValue;
 
@@ -998,3 +1180,341 @@ void ConstantIntegerEncoder::dump( int indent, std::ostream &os ) const
    sourceBuffer_->dump( indent + 4, os );
 }
 #endif
+
+//================================================================
+
+DeltaIntegerEncoder::DeltaIntegerEncoder( bool isScaledInteger, unsigned bytestreamNumber,
+                                          SourceDestBuffer &sbuf, int64_t minimum, int64_t maximum,
+                                          double scale, double offset ) :
+   Encoder( bytestreamNumber ),
+   isScaledInteger_( isScaledInteger ), minimum_( minimum ), maximum_( maximum ), scale_( scale ),
+   offset_( offset ), sourceBuffer_( sbuf.impl() ), maxOutputSize_( DATA_PACKET_MAX )
+{
+   pendingValues_.reserve( DELTA_STREAM_BLOCK_RECORDS );
+}
+
+uint64_t DeltaIntegerEncoder::processRecords( size_t recordCount )
+{
+#ifdef E57_VERBOSE
+   std::cout << "DeltaIntegerEncoder::processRecords() called, recordCount=" << recordCount
+             << std::endl;
+   dump( 4 );
+#endif
+
+   constexpr size_t cChunkSize = 512;
+   int64_t rawValues[cChunkSize];
+   size_t processed = 0;
+
+   // Stop fetching once the output backlog reaches the limit; the caller
+   // drains it into packets and calls again
+   while ( ( processed < recordCount ) && ( outBuffer_.size() - outBufferFirst_ < maxOutputSize_ ) )
+   {
+      const size_t cChunk = std::min( recordCount - processed, cChunkSize );
+
+      if ( isScaledInteger_ )
+      {
+         sourceBuffer_->getNextInt64N( rawValues, cChunk, scale_, offset_ );
+      }
+      else
+      {
+         sourceBuffer_->getNextInt64N( rawValues, cChunk );
+      }
+
+      for ( size_t i = 0; i < cChunk; ++i )
+      {
+         const int64_t cRawValue = rawValues[i];
+
+         // Enforce min/max specification on value
+         if ( cRawValue < minimum_ || maximum_ < cRawValue )
+         {
+            throw E57_EXCEPTION2( ErrorValueOutOfBounds,
+                                  "rawValue=" + toString( cRawValue ) + " minimum=" +
+                                     toString( minimum_ ) + " maximum=" + toString( maximum_ ) );
+         }
+
+         // Bias by the field minimum; wrap-safe unsigned arithmetic
+         pendingValues_.push_back( static_cast<uint64_t>( cRawValue ) -
+                                   static_cast<uint64_t>( minimum_ ) );
+
+         if ( pendingValues_.size() == DELTA_STREAM_BLOCK_RECORDS )
+         {
+            emitBlock();
+         }
+      }
+
+      processed += cChunk;
+      currentRecordIndex_ += cChunk;
+   }
+
+   return ( currentRecordIndex_ );
+}
+
+void DeltaIntegerEncoder::emitBlock()
+{
+   const size_t cRecordCount = pendingValues_.size();
+
+   if ( cRecordCount == 0 )
+   {
+      return;
+   }
+
+   const size_t cBlockStart = outBuffer_.size();
+
+   outBuffer_.resize( cBlockStart + deltaBlockBound( cRecordCount ) );
+
+   const size_t cBlockBytes =
+      packDeltaBlock( pendingValues_.data(), cRecordCount,
+                      reinterpret_cast<uint8_t *>( &outBuffer_[cBlockStart] ) );
+
+   outBuffer_.resize( cBlockStart + cBlockBytes );
+   bytesEmitted_ += cBlockBytes;
+   pendingValues_.clear();
+}
+
+unsigned DeltaIntegerEncoder::sourceBufferNextIndex()
+{
+   return ( sourceBuffer_->nextIndex() );
+}
+
+uint64_t DeltaIntegerEncoder::currentRecordIndex()
+{
+   return ( currentRecordIndex_ );
+}
+
+float DeltaIntegerEncoder::bitsPerRecord()
+{
+   // The width varies per block; report the stream's average so far
+   if ( currentRecordIndex_ == 0 )
+   {
+      return ( 0.0 );
+   }
+
+   return ( static_cast<float>( 8.0 * static_cast<double>( bytesEmitted_ ) /
+                                static_cast<double>( currentRecordIndex_ ) ) );
+}
+
+bool DeltaIntegerEncoder::registerFlushToOutput()
+{
+   // Pack the partial tail block
+   emitBlock();
+
+   return ( true );
+}
+
+size_t DeltaIntegerEncoder::outputAvailable() const
+{
+   return outBuffer_.size() - outBufferFirst_;
+}
+
+void DeltaIntegerEncoder::outputRead( char *dest, const size_t byteCount )
+{
+   if ( byteCount > outputAvailable() )
+   {
+      throw E57_EXCEPTION2( ErrorInternal, "byteCount=" + toString( byteCount ) +
+                                              " outputAvailable=" + toString( outputAvailable() ) );
+   }
+
+   memcpy( dest, &outBuffer_[outBufferFirst_], byteCount );
+   outBufferFirst_ += byteCount;
+
+   if ( outBufferFirst_ == outBuffer_.size() )
+   {
+      outBuffer_.clear();
+      outBufferFirst_ = 0;
+   }
+}
+
+void DeltaIntegerEncoder::outputClear()
+{
+   outBuffer_.clear();
+   outBufferFirst_ = 0;
+}
+
+void DeltaIntegerEncoder::sourceBufferSetNew( std::vector<SourceDestBuffer> &sbufs )
+{
+   // Verify that this encoder only has single input buffer
+   if ( sbufs.size() != 1 )
+   {
+      throw E57_EXCEPTION2( ErrorInternal, "sbufsSize=" + toString( sbufs.size() ) );
+   }
+
+   sourceBuffer_ = sbufs.at( 0 ).impl();
+}
+
+size_t DeltaIntegerEncoder::outputGetMaxSize()
+{
+   return ( maxOutputSize_ );
+}
+
+void DeltaIntegerEncoder::outputSetMaxSize( unsigned byteCount )
+{
+   maxOutputSize_ = byteCount;
+}
+
+#ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
+void DeltaIntegerEncoder::dump( int indent, std::ostream &os ) const
+{
+   Encoder::dump( indent, os );
+   os << space( indent ) << "isScaledInteger:    " << isScaledInteger_ << std::endl;
+   os << space( indent ) << "minimum:            " << minimum_ << std::endl;
+   os << space( indent ) << "maximum:            " << maximum_ << std::endl;
+   os << space( indent ) << "scale:              " << scale_ << std::endl;
+   os << space( indent ) << "offset:             " << offset_ << std::endl;
+   os << space( indent ) << "currentRecordIndex: " << currentRecordIndex_ << std::endl;
+   os << space( indent ) << "pendingValues:      " << pendingValues_.size() << std::endl;
+   os << space( indent ) << "outputAvailable:    " << outputAvailable() << std::endl;
+   os << space( indent ) << "bytesEmitted:       " << bytesEmitted_ << std::endl;
+   os << space( indent ) << "sourceBuffer:" << std::endl;
+   sourceBuffer_->dump( indent + 4, os );
+}
+#endif
+
+//================================================================
+
+CompressedStreamEncoder::CompressedStreamEncoder( std::shared_ptr<Encoder> inner ) :
+   Encoder( inner->bytestreamNumber() ), inner_( std::move( inner ) )
+{
+   // Let the wrapped encoder queue more than one block, so whole blocks
+   // keep forming even when its default output limit is near the block size
+   inner_->outputSetMaxSize( 2 * COMPRESSED_STREAM_BLOCK_SIZE );
+   rawBlock_.reserve( COMPRESSED_STREAM_BLOCK_SIZE );
+}
+
+uint64_t CompressedStreamEncoder::processRecords( size_t recordCount )
+{
+   const uint64_t cProcessed = inner_->processRecords( recordCount );
+
+   compressFromInner( false );
+
+   return cProcessed;
+}
+
+unsigned CompressedStreamEncoder::sourceBufferNextIndex()
+{
+   return inner_->sourceBufferNextIndex();
+}
+
+uint64_t CompressedStreamEncoder::currentRecordIndex()
+{
+   return inner_->currentRecordIndex();
+}
+
+float CompressedStreamEncoder::bitsPerRecord()
+{
+   return inner_->bitsPerRecord();
+}
+
+bool CompressedStreamEncoder::registerFlushToOutput()
+{
+   const bool cResult = inner_->registerFlushToOutput();
+
+   // The stream is ending: compress the partial tail block too
+   compressFromInner( true );
+
+   return cResult;
+}
+
+void CompressedStreamEncoder::compressFromInner( bool flushTail )
+{
+   while ( inner_->outputAvailable() >= COMPRESSED_STREAM_BLOCK_SIZE )
+   {
+      rawBlock_.resize( COMPRESSED_STREAM_BLOCK_SIZE );
+      inner_->outputRead( rawBlock_.data(), COMPRESSED_STREAM_BLOCK_SIZE );
+      compressAppend( reinterpret_cast<const uint8_t *>( rawBlock_.data() ),
+                      COMPRESSED_STREAM_BLOCK_SIZE );
+   }
+
+   if ( flushTail )
+   {
+      const size_t cTailCount = inner_->outputAvailable();
+
+      if ( cTailCount > 0 )
+      {
+         rawBlock_.resize( cTailCount );
+         inner_->outputRead( rawBlock_.data(), cTailCount );
+         compressAppend( reinterpret_cast<const uint8_t *>( rawBlock_.data() ), cTailCount );
+      }
+   }
+}
+
+void CompressedStreamEncoder::compressAppend( const uint8_t *raw, size_t rawCount )
+{
+   std::vector<uint8_t> compressed( compressBound( rawCount ) );
+   const size_t cCompressedCount = compressBlock( raw, rawCount, compressed.data() );
+
+   // Store incompressible blocks as-is; equal raw and stored counts tell
+   // the decoder to skip decompression
+   const bool cStoreRaw = ( cCompressedCount >= rawCount );
+   const auto cRawLength = static_cast<uint32_t>( rawCount );
+   const auto cStoredLength = static_cast<uint32_t>( cStoreRaw ? rawCount : cCompressedCount );
+
+   const size_t cHeaderStart = outBuffer_.size();
+
+   outBuffer_.resize( cHeaderStart + 2 * sizeof( uint32_t ) );
+   memcpy( &outBuffer_[cHeaderStart], &cRawLength, sizeof( cRawLength ) );
+   memcpy( &outBuffer_[cHeaderStart + sizeof( cRawLength )], &cStoredLength,
+           sizeof( cStoredLength ) );
+
+   const char *payload =
+      cStoreRaw ? reinterpret_cast<const char *>( raw ) : reinterpret_cast<const char *>( compressed.data() );
+
+   outBuffer_.insert( outBuffer_.end(), payload, payload + cStoredLength );
+}
+
+size_t CompressedStreamEncoder::outputAvailable() const
+{
+   return outBuffer_.size() - outBufferFirst_;
+}
+
+void CompressedStreamEncoder::outputRead( char *dest, size_t byteCount )
+{
+   if ( byteCount > outputAvailable() )
+   {
+      throw E57_EXCEPTION2( ErrorInternal, "byteCount=" + toString( byteCount ) +
+                                              " outputAvailable=" +
+                                              toString( outputAvailable() ) );
+   }
+
+   memcpy( dest, &outBuffer_[outBufferFirst_], byteCount );
+   outBufferFirst_ += byteCount;
+
+   if ( outBufferFirst_ == outBuffer_.size() )
+   {
+      outBuffer_.clear();
+      outBufferFirst_ = 0;
+   }
+}
+
+void CompressedStreamEncoder::outputClear()
+{
+   outBuffer_.clear();
+   outBufferFirst_ = 0;
+   inner_->outputClear();
+}
+
+void CompressedStreamEncoder::sourceBufferSetNew( std::vector<SourceDestBuffer> &sbufs )
+{
+   inner_->sourceBufferSetNew( sbufs );
+}
+
+size_t CompressedStreamEncoder::outputGetMaxSize()
+{
+   return inner_->outputGetMaxSize();
+}
+
+void CompressedStreamEncoder::outputSetMaxSize( unsigned byteCount )
+{
+   // Never below what block formation needs (see constructor)
+   inner_->outputSetMaxSize(
+      std::max( byteCount, static_cast<unsigned>( 2 * COMPRESSED_STREAM_BLOCK_SIZE ) ) );
+}
+
+#ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
+void CompressedStreamEncoder::dump( int indent, std::ostream &os ) const
+{
+   Encoder::dump( indent, os );
+   os << space( indent ) << "outputAvailable:     " << outputAvailable() << std::endl;
+   os << space( indent ) << "inner:" << std::endl;
+   inner_->dump( indent + 4, os );
+}
+#endif
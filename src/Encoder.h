@@ -27,6 +27,7 @@
 
 #pragma once
 
+#include "BufferPool.h"
 #include "Common.h"
 
 namespace e57
@@ -38,6 +39,15 @@ namespace e57
          unsigned bytestreamNumber, std::shared_ptr<CompressedVectorNodeImpl> cVector,
          std::vector<SourceDestBuffer> &sbuf, ustring &codecPath );
 
+   private:
+      /// Pick the bitpack/constant encoder for the field's prototype node;
+      /// EncoderFactory() wraps the result when the codecs vector asks for
+      /// the "lzbs" block compressor (see StreamCompression.h).
+      static std::shared_ptr<Encoder> baseEncoderFactory(
+         unsigned bytestreamNumber, std::shared_ptr<CompressedVectorNodeImpl> cVector,
+         std::vector<SourceDestBuffer> &sbuf, ustring &codecPath );
+
+   public:
       virtual ~Encoder() = default;
 
       virtual uint64_t processRecords( size_t recordCount ) = 0;
@@ -46,6 +56,11 @@ namespace e57
       virtual float bitsPerRecord() = 0;
       virtual bool registerFlushToOutput() = 0;
 
+      /// Get number of bits each record occupies in the bytestream, when
+      /// every record has the same width. Returns false for variable-width
+      /// streams (strings). Used to build the seek index.
+      virtual bool fixedRecordBits( unsigned &bits ) = 0;
+
       virtual size_t outputAvailable() const = 0; /// number of bytes that can be read
       virtual void outputRead( char *dest, size_t byteCount ) = 0; /// get data from encoder
       virtual void outputClear() = 0;
@@ -72,6 +87,8 @@ namespace e57
    class BitpackEncoder : public Encoder
    {
    public:
+      ~BitpackEncoder() override;
+
       uint64_t processRecords( size_t recordCount ) override = 0;
       unsigned sourceBufferNextIndex() override;
       uint64_t currentRecordIndex() override;
@@ -98,7 +115,10 @@ namespace e57
 
       std::shared_ptr<SourceDestBufferImpl> sourceBuffer_;
 
-      std::vector<char> outBuffer_;
+      // The output buffer is leased from the image file's pool at
+      // construction and returned by the destructor
+      std::shared_ptr<BufferPool> bufferPool_;
+      StagingBuffer outBuffer_;
       size_t outBufferFirst_;
       size_t outBufferEnd_;
       size_t outBufferAlignmentSize_;
@@ -116,6 +136,12 @@ namespace e57
       bool registerFlushToOutput() override;
       float bitsPerRecord() override;
 
+      bool fixedRecordBits( unsigned &bits ) override
+      {
+         bits = ( precision_ == PrecisionSingle ) ? 32 : 64;
+         return true;
+      }
+
 #ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
       void dump( int indent = 0, std::ostream &os = std::cout ) const override;
 #endif
@@ -134,6 +160,12 @@ namespace e57
       bool registerFlushToOutput() override;
       float bitsPerRecord() override;
 
+      // Strings are variable width
+      bool fixedRecordBits( unsigned & /*bits*/ ) override
+      {
+         return false;
+      }
+
 #ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
       void dump( int indent = 0, std::ostream &os = std::cout ) const override;
 #endif
@@ -157,6 +189,12 @@ namespace e57
       bool registerFlushToOutput() override;
       float bitsPerRecord() override;
 
+      bool fixedRecordBits( unsigned &bits ) override
+      {
+         bits = bitsPerRecord_;
+         return true;
+      }
+
 #ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
       void dump( int indent = 0, std::ostream &os = std::cout ) const override;
 #endif
@@ -183,6 +221,13 @@ namespace e57
       float bitsPerRecord() override;
       bool registerFlushToOutput() override;
 
+      // The bytestream carries no bytes at all
+      bool fixedRecordBits( unsigned &bits ) override
+      {
+         bits = 0;
+         return true;
+      }
+
       size_t outputAvailable() const override;                  /// number of bytes that can be read
       void outputRead( char *dest, size_t byteCount ) override; /// get data from encoder
       void outputClear() override;
@@ -200,4 +245,108 @@ namespace e57
       uint64_t currentRecordIndex_;
       int64_t minimum_;
    };
+
+   /// Encodes an integer or scaled integer field as zigzag deltas from the
+   /// previous record, packed in byte-aligned blocks with a per-block bit
+   /// width (see StreamCompression.h). Negotiated by EncoderFactory() from
+   /// the CompressedVector's codecs vector when the "dlta" extension is in
+   /// use. Record widths vary per block, so fixedRecordBits() reports
+   /// variable width and no seek index is built for the stream.
+   class DeltaIntegerEncoder : public Encoder
+   {
+   public:
+      DeltaIntegerEncoder( bool isScaledInteger, unsigned bytestreamNumber, SourceDestBuffer &sbuf,
+                           int64_t minimum, int64_t maximum, double scale, double offset );
+
+      uint64_t processRecords( size_t recordCount ) override;
+      unsigned sourceBufferNextIndex() override;
+      uint64_t currentRecordIndex() override;
+      float bitsPerRecord() override;
+      bool registerFlushToOutput() override;
+
+      // The per-block width makes record positions variable
+      bool fixedRecordBits( unsigned & ) override
+      {
+         return false;
+      }
+
+      size_t outputAvailable() const override;                  /// number of bytes that can be read
+      void outputRead( char *dest, size_t byteCount ) override; /// get data from encoder
+      void outputClear() override;
+
+      void sourceBufferSetNew( std::vector<SourceDestBuffer> &sbufs ) override;
+      size_t outputGetMaxSize() override;
+      void outputSetMaxSize( unsigned byteCount ) override;
+
+#ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
+      void dump( int indent = 0, std::ostream &os = std::cout ) const override;
+#endif
+
+   protected:
+      /// Pack the pending records as one block appended to outBuffer_
+      void emitBlock();
+
+      bool isScaledInteger_;
+      int64_t minimum_;
+      int64_t maximum_;
+      double scale_;
+      double offset_;
+
+      std::shared_ptr<SourceDestBufferImpl> sourceBuffer_;
+      uint64_t currentRecordIndex_ = 0;
+
+      std::vector<uint64_t> pendingValues_; // records of the open block, biased by minimum_
+      std::vector<char> outBuffer_;         // the packed block stream
+      size_t outBufferFirst_ = 0;           // read position in outBuffer_
+      size_t maxOutputSize_;
+      uint64_t bytesEmitted_ = 0; // packed bytes produced so far, for bitsPerRecord()
+   };
+
+   /// Wraps another encoder and stores its bytestream as framed,
+   /// LZ77-compressed blocks (see StreamCompression.h). Negotiated by
+   /// EncoderFactory() from the CompressedVector's codecs vector when the
+   /// "lzbs" extension is in use. Record positions are not bit addressable
+   /// in the compressed stream, so fixedRecordBits() reports variable width
+   /// and no seek index is built for the stream.
+   class CompressedStreamEncoder : public Encoder
+   {
+   public:
+      explicit CompressedStreamEncoder( std::shared_ptr<Encoder> inner );
+
+      uint64_t processRecords( size_t recordCount ) override;
+      unsigned sourceBufferNextIndex() override;
+      uint64_t currentRecordIndex() override;
+      float bitsPerRecord() override;
+      bool registerFlushToOutput() override;
+
+      // Record positions can't be computed in the compressed stream
+      bool fixedRecordBits( unsigned & ) override
+      {
+         return false;
+      }
+
+      size_t outputAvailable() const override;                  /// number of bytes that can be read
+      void outputRead( char *dest, size_t byteCount ) override; /// get data from encoder
+      void outputClear() override;
+
+      void sourceBufferSetNew( std::vector<SourceDestBuffer> &sbufs ) override;
+      size_t outputGetMaxSize() override;
+      void outputSetMaxSize( unsigned byteCount ) override;
+
+#ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
+      void dump( int indent = 0, std::ostream &os = std::cout ) const override;
+#endif
+
+   protected:
+      /// Compress the whole blocks queued in the inner encoder; a final
+      /// flush also compresses the partial tail block.
+      void compressFromInner( bool flushTail );
+      void compressAppend( const uint8_t *raw, size_t rawCount );
+
+      std::shared_ptr<Encoder> inner_;
+
+      std::vector<char> rawBlock_;  // staging for one uncompressed block
+      std::vector<char> outBuffer_; // the framed compressed stream
+      size_t outBufferFirst_ = 0;   // read position in outBuffer_
+   };
 }
@@ -355,7 +355,7 @@ FloatNode::FloatNode( const Node &n )
 }
 
 /// @cond documentNonPublic The following isn't part of the API, and isn't documented.
-FloatNode::FloatNode( std::shared_ptr<FloatNodeImpl> ni ) : impl_( ni )
+FloatNode::FloatNode( std::shared_ptr<FloatNodeImpl> ni ) : impl_( std::move( ni ) )
 {
 }
 /// @endcond
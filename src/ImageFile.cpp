@@ -30,6 +30,7 @@
 /// @file ImageFile.cpp
 
 #include "ImageFileImpl.h"
+#include "SidecarCache.h"
 
 using namespace e57;
 
@@ -90,13 +91,8 @@ void ImageFile::checkInvariant( bool doRecurse ) const
       throw E57_EXCEPTION1( ErrorInvarianceViolation );
    }
 
-   // Can't have more than one writer
-   if ( 1 < wCount )
-   {
-      throw E57_EXCEPTION1( ErrorInvarianceViolation );
-   }
-
-   // If have writer
+   // If have writers (several may be open at once; all but the first write
+   // into spill files, see CompressedVectorNode::writer)
    if ( wCount > 0 )
    {
       // Must be in write-mode
@@ -246,7 +242,8 @@ that files that meet all of the requirements for a legal ASTM E57 file format us
 ".e57". It is recommended that files that utilize the low-level E57 element data types, but do not
 have all the required element names required by ASTM E57 file format standard use the file extension
 @c "._e57".
-@param [in] mode Either "w" for writing or "r" for reading.
+@param [in] mode Either "w" for writing, "a" for appending to an existing file, or "r" for
+reading.
 @param [in] checksumPolicy The percentage of checksums we compute and verify as an int. Clamped to
 0-100.
 
@@ -258,10 +255,18 @@ Which API functions write data to the file are implementation dependent.
 Thus any API operation that stores data may fail as a result of insufficient free disk space. Read
 API operations are legal for an ImageFile opened in write mode.
 
+@par Append Mode
+In append mode, the file given by @a fname must already exist and contain a well-formed E57 file.
+The existing element tree is parsed and presented exactly as in write mode, so new scans
+(CompressedVectorNode sections, BlobNode sections) can be added next to the existing ones. The
+existing binary sections are reused untouched; only the XML section is rewritten when the file is
+closed, so appending to a large file costs far less than rewriting it. The space occupied by the
+old XML section is reclaimed for the new data.
+
 @par Read Mode
 Read mode files may be shared.
 Write API operations are not legal for an ImageFile opened in read mode (i.e. the ImageFile is
-read-only). There is no API support for appending data onto an existing E57 data file.
+read-only).
 
 @post Resulting ImageFile is in @c open state if constructor succeeds (no exception thrown).
 
@@ -285,10 +290,17 @@ CompressedVectorNode, E57Exception, E57Utilities::E57Utilities
 */
 ImageFile::ImageFile( const ustring &fname, const ustring &mode,
                       ReadChecksumPolicy checksumPolicy ) :
-   impl_( new ImageFileImpl( checksumPolicy ) )
+   impl_( ( mode == "r" ) ? ImageFileImpl::readCacheFetch( fname, checksumPolicy ) : nullptr )
 {
-   // Do second phase of construction, now that ImageFile object is complete.
-   impl_->construct2( fname, mode );
+   // A cache hit hands back the already parsed file; otherwise construct from
+   // scratch.
+   if ( !impl_ )
+   {
+      impl_ = ImageFileImplSharedPtr( new ImageFileImpl( checksumPolicy ) );
+
+      // Do second phase of construction, now that ImageFile object is complete.
+      impl_->construct2( fname, mode );
+   }
 }
 
 ImageFile::ImageFile( const char *input, const uint64_t size, ReadChecksumPolicy checksumPolicy ) :
@@ -297,6 +309,45 @@ ImageFile::ImageFile( const char *input, const uint64_t size, ReadChecksumPolicy
    impl_->construct2( input, size );
 }
 
+/*!
+@brief Open an ASTM E57 imaging data file for reading through a caller-supplied byte source.
+
+@param [in] provider Source of the file's bytes (see ReadProvider). The ImageFile keeps a
+reference until it is closed.
+@param [in] checksumPolicy The percentage of checksums we compute and verify as an int. Clamped to
+0-100.
+
+@details Every file access of the resulting read mode ImageFile is served by @a provider, so the
+file can live anywhere that answers byte-range requests - an HTTP server, an object store, an
+archive member. Page checksums are verified on the transferred bytes exactly as for a local file.
+Only the ranges actually touched are requested: opening transfers the header and the XML section
+(subtrees deferred where possible), and reading a CompressedVectorNode transfers its packets, so a
+provider over a large remote file moves a small fraction of it.
+
+Exceptions thrown by the provider's read() propagate to the API call that triggered the access.
+
+@post Resulting ImageFile is in @c open state if constructor succeeds (no exception thrown).
+
+@throw ::ErrorBadAPIArgument
+@throw ::ErrorSeekFailed
+@throw ::ErrorReadFailed
+@throw ::ErrorBadChecksum
+@throw ::ErrorBadFileSignature
+@throw ::ErrorUnknownFileVersion
+@throw ::ErrorBadFileLength
+@throw ::ErrorXMLParserInit
+@throw ::ErrorXMLParser
+@throw ::ErrorBadXMLFormat
+@throw ::ErrorInternal All objects in undocumented state
+
+@see ReadProvider, ImageFile::ImageFile( const ustring &, const ustring &, ReadChecksumPolicy )
+*/
+ImageFile::ImageFile( std::shared_ptr<ReadProvider> provider, ReadChecksumPolicy checksumPolicy ) :
+   impl_( new ImageFileImpl( checksumPolicy ) )
+{
+   impl_->construct2( std::move( provider ) );
+}
+
 /*!
 @brief Get the pre-established root StructureNode of the E57 ImageFile.
 
@@ -372,6 +423,301 @@ void ImageFile::cancel()
    impl_->cancel();
 }
 
+/*!
+@brief Write a provisional XML section and file header without closing the file.
+
+@details
+Normally the XML section is only written by ImageFile::close, so a crash during a long write leaves
+an unreadable file. This function writes a snapshot of the current node tree as an XML section at
+the start of free space and points the file header at it, making the file on disk a readable E57
+file describing everything written so far. The ImageFile stays open and writing continues normally.
+
+The snapshot is written in what is still free space: the next binary section (or the final XML
+section) overwrites it, and the file is only protected again once close or another checkpoint has
+written a fresh snapshot. Call it periodically during long writes, at points where the data written
+so far is consistent.
+
+A CompressedVectorNode that is still being written appears in the snapshot with whatever record
+count and section start its writer last recorded; use CompressedVectorWriter::checkpoint to flush
+and snapshot an in-progress vector in one step.
+
+@pre This ImageFile must be open and writable.
+
+@throw ::ErrorImageFileNotOpen
+@throw ::ErrorFileReadOnly
+@throw ::ErrorSeekFailed
+@throw ::ErrorWriteFailed
+@throw ::ErrorInternal All objects in undocumented state
+
+@see CompressedVectorWriter::checkpoint, ImageFile::close
+*/
+void ImageFile::checkpoint()
+{
+   impl_->checkpoint();
+}
+
+/*!
+@brief Set how many parsed read mode files the process-wide read cache may hold.
+
+@details
+When the capacity is non-zero, closing a read mode ImageFile parks its parsed state (node tree,
+section offsets) in a process-wide cache keyed by file path and modification time. A later
+ImageFile( fname, "r" ) of the same unchanged path reuses that state and skips re-reading the
+header and re-parsing the XML section, which helps workloads that repeatedly open and close the
+same set of files. A cached file whose modification time has changed is discarded and parsed from
+scratch.
+
+The capacity is the maximum number of files kept; the oldest entry is dropped when it is exceeded.
+The cache is disabled (capacity zero) by default, which preserves the historical behavior exactly.
+
+@param [in] fileCount Maximum number of closed files to keep cached; 0 disables the cache.
+
+@throw No E57Exceptions.
+
+@see ImageFile::readCacheClear
+*/
+void ImageFile::readCacheSetCapacity( size_t fileCount )
+{
+   ImageFileImpl::readCacheSetCapacity( fileCount );
+}
+
+/*!
+@brief Drop all entries from the process-wide read cache.
+
+@details
+Cached files release their parsed state when dropped. The configured capacity is unchanged.
+
+@throw No E57Exceptions.
+
+@see ImageFile::readCacheSetCapacity
+*/
+void ImageFile::readCacheClear()
+{
+   ImageFileImpl::readCacheClear();
+}
+
+/*!
+@brief Turn the persistent sidecar metadata cache on or off for the whole process.
+
+@details
+While enabled, opening "file.e57" for reading writes a compact binary sidecar "file.e57i" next to
+it describing the parsed outcome (namespaces and the complete node tree, with every binary section
+offset and record count). A later open of the same path - from this process or any other - that
+finds a sidecar matching the data file's length, modification time, and E57 header bytes rebuilds
+the tree from it directly, skipping the XML read and parse entirely. This helps workloads that
+open the same unchanged files over and over, such as render farms revisiting a large project.
+
+Sidecars are best effort: a missing, stale, or damaged one falls back to the normal parse and is
+rewritten, and a failure to write one (for example on read-only storage) is silently ignored. The
+sidecar format is cache state for this library version on this machine, not an interchange format.
+
+Disabled by default, since it creates files next to the user's data.
+
+@param [in] enabled true to read and write sidecar caches, false to ignore them.
+
+@throw No E57Exceptions.
+
+@see ImageFile::readCacheSetCapacity
+*/
+void ImageFile::sidecarCacheSetEnabled( bool enabled )
+{
+   SidecarCache::setEnabled( enabled );
+}
+
+/*!
+@brief Turn collection of performance counters for this ImageFile on or off.
+
+@details
+While enabled, the library counts bytes read and written, pages checksummed, packet cache hits and
+misses, and records encoded and decoded for this file; ImageFile::stats returns a snapshot. The
+counters are meant for monitoring and regression hunting, not for program logic.
+
+Collection is off by default and costs nothing while off beyond a pointer test on the affected
+paths. Enable it before creating CompressedVectorReader or CompressedVectorWriter objects to
+capture their packet cache and record counters; the byte and checksum counters follow the flag
+immediately.
+
+@param [in] enabled true to start counting, false to stop.
+
+@throw No E57Exceptions.
+
+@see ImageFile::stats
+*/
+void ImageFile::statsSetEnabled( bool enabled )
+{
+   impl_->statsSetEnabled( enabled );
+}
+
+/*!
+@brief Get a snapshot of this ImageFile's performance counters.
+
+@details
+All counters are zero until collection is turned on with ImageFile::statsSetEnabled. The XML parse
+time is the exception: it is always measured, since it is a one-time cost per file.
+
+@return An ImageFileStats value holding the counters at the time of the call.
+
+@throw No E57Exceptions.
+
+@see ImageFile::statsSetEnabled
+*/
+ImageFileStats ImageFile::stats() const
+{
+   return impl_->stats();
+}
+
+/*!
+@brief Set the packet read cache budget for this file, in megabytes.
+
+@details
+Every CompressedVectorReader keeps a cache of decoded-from-disk packets (64 KB each). The default
+budget of 2 MB suits single-stream sequential reading; interleaved multi-channel decode or random
+window reads benefit from a larger one. The budget applies to CompressedVectorReader objects
+created after this call; existing readers are unaffected.
+
+@param [in] sizeMB Cache budget per reader in megabytes; at least four packets are always kept.
+
+@throw No E57Exceptions.
+*/
+void ImageFile::packetCacheSetCapacity( size_t sizeMB )
+{
+   impl_->packetCacheSetCapacity( sizeMB );
+}
+
+/*!
+@brief Set the preferred I/O transfer unit for this file, in megabytes.
+
+@details
+E57 data packets are at most 64 KB, far below the efficient request size of cloud object stores
+and fast NVMe devices. The transfer unit controls two things: the background page writer merges
+runs of contiguous pages into device writes of up to this size, and packet read caches of
+CompressedVectorReader objects created after this call fetch this many bytes per miss, serving
+later misses inside the unit from memory. The bytes on disk are unchanged, so files stay
+spec-conformant.
+
+Writes coalesce up to 1 MB by default; reads default to one packet per miss, which suits random
+window access. Sequential scans on high-latency storage benefit from units of several megabytes.
+
+@param [in] sizeMB Transfer unit in megabytes; 0 restores the defaults.
+
+@throw No E57Exceptions.
+
+@see ImageFile::packetCacheSetCapacity
+*/
+void ImageFile::ioUnitSetSize( size_t sizeMB )
+{
+   impl_->ioUnitSetSize( sizeMB );
+}
+
+/*!
+@brief Pin the parallel decode workers of this file's readers to CPUs.
+
+@details
+Multi-channel reads decode bytestreams on a small worker pool. By default the OS is free to migrate
+those workers between cores, and on multi-socket machines that scatters them (and the memory they
+touch) across NUMA nodes, so a large share of decode traffic crosses the interconnect. With pinning
+enabled, each worker of a CompressedVectorReader created after this call is pinned to one CPU,
+round-robin over the process affinity mask, which keeps every worker - and the pages it touches
+first - resident on one node. Restrict the process affinity mask (e.g. with taskset or numactl) to
+confine the readers to a specific node.
+
+Pinning is implemented on Linux and is a silent no-op elsewhere. It is off by default, since on
+single-socket machines it only removes scheduling freedom.
+
+@param [in] pin true to pin decode workers, false to let the OS schedule them freely.
+
+@throw No E57Exceptions.
+
+@see ImageFile::ioUnitSetSize
+*/
+void ImageFile::decodeSetPinWorkers( bool pin )
+{
+   impl_->decodeSetPinWorkers( pin );
+}
+
+/*!
+@brief Tell the OS this file is read as a one-pass streaming scan.
+
+@details
+A sequential whole-file read drags the entire file through the OS page cache, evicting other
+processes' hot data, while giving this file's pages no reuse. With streaming enabled the kernel is
+advised that reads are sequential (enlarging readahead), CompressedVectorReader objects created
+after this call hint at the section range they are about to scan, and ranges the scan has finished
+with are dropped from the page cache behind it. Seeking backwards within a streaming file still
+works, but the re-read comes from the device.
+
+The hints are implemented with posix_fadvise/madvise where available and are a silent no-op
+elsewhere; they never change what is read, only cache behavior. Off by default, since files read
+more than once benefit from staying cached.
+
+@param [in] streaming true to enable the streaming cache policy, false to restore the default.
+
+@throw No E57Exceptions.
+
+@see ImageFile::ioUnitSetSize
+*/
+void ImageFile::cacheSetStreaming( bool streaming )
+{
+   impl_->cacheSetStreaming( streaming );
+}
+
+/*!
+@brief Back this file's encode/decode staging buffers with huge pages.
+
+@details
+The bytestream staging buffers of a CompressedVector transfer - one per prototype field, per open
+writer or reader - can sum to hundreds of MB on wide prototypes. In ordinary 4KB pages that working
+set costs one dTLB entry per page, and the pack/unpack loops walking it see measurable TLB miss
+rates. With this option enabled, staging buffers allocated from now on are carved from large
+anonymous mappings advised to the kernel as transparent huge page candidates (MADV_HUGEPAGE), so a
+2MB page covers what 512 small ones did.
+
+Call it before creating the CompressedVectorWriter or CompressedVectorReader whose transfers should
+benefit; buffers already allocated keep their pages. The mappings are recycled for later transfers
+on this file and released when the ImageFile closes. Implemented on Linux and a silent no-op
+elsewhere; the advice itself is best-effort, the kernel backs what it can. Off by default, since
+huge page collapse can add latency on machines where memory is fragmented.
+
+@param [in] enabled true to request huge page backing, false to restore the default.
+
+@throw No E57Exceptions.
+
+@see ImageFile::ioUnitSetSize
+*/
+void ImageFile::stagingSetHugePages( bool enabled )
+{
+   impl_->stagingSetHugePages( enabled );
+}
+
+/*!
+@brief Verify the checksum of every physical page in the file.
+
+@details
+The file is streamed once and every page CRC is recomputed and compared against the stored value,
+regardless of the checksum policy the file was opened with, so corruption can be detected up front
+(for example at ingest) instead of mid-decode. Pages are checked by @a nThreads parallel workers,
+each claiming 1 MB runs of consecutive pages, so verification proceeds at device speed.
+
+This is much faster than provoking the checks by decoding the data: no packets are decompressed and
+no element tree is consulted.
+
+@param [in] nThreads Number of verification threads, or 0 to use one per hardware thread.
+
+@return The physical byte offsets of the pages whose checksum does not match, in ascending order.
+An empty vector means every page verified clean.
+
+@pre The ImageFile must be open.
+
+@throw ::ErrorImageFileNotOpen
+@throw ::ErrorReadFailed
+@throw ::ErrorSeekFailed
+@throw ::ErrorInternal All objects in undocumented state
+*/
+std::vector<uint64_t> ImageFile::verifyChecksums( unsigned nThreads ) const
+{
+   return impl_->verifyChecksums( nThreads );
+}
+
 /*!
 @brief Test whether ImageFile is still open for accessing.
 
@@ -765,7 +1111,7 @@ bool ImageFile::operator!=( const ImageFile &imf2 ) const
 }
 
 /// @cond documentNonPublic The following isn't part of the API, and isn't documented.
-ImageFile::ImageFile( ImageFileImplSharedPtr imfi ) : impl_( imfi )
+ImageFile::ImageFile( ImageFileImplSharedPtr imfi ) : impl_( std::move( imfi ) )
 {
 }
 /// @endcond
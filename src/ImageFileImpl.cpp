@@ -25,13 +25,79 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <mutex>
+
+#include <sys/stat.h>
+
+// The binary section prefetch thread needs its own file descriptor so it
+// never disturbs the CheckedFile it is warming the page cache for.
+#if defined( __linux__ ) || defined( __APPLE__ ) || defined( __FreeBSD__ ) || \
+   defined( __NetBSD__ ) || defined( __OpenBSD__ )
+#define E57_HAVE_SECTION_PREFETCH
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #include "ImageFileImpl.h"
 #include "ASTMVersion.h"
 #include "CheckedFile.h"
+#include "CompressedVectorNodeImpl.h"
 #include "E57XmlParser.h"
+#include "SidecarCache.h"
+#include "TraceImpl.h"
 #include "StringFunctions.h"
 #include "StructureNodeImpl.h"
 
+namespace
+{
+   /// Modification time of a file in seconds, or -1 if it can't be determined.
+   /// Files without a usable time are never cached, so a failure here can't
+   /// match another failure.
+   int64_t fileModificationTime( const e57::ustring &path )
+   {
+#if defined( _MSC_VER )
+      struct _stat64 info;
+      if ( _stat64( path.c_str(), &info ) != 0 )
+      {
+         return -1;
+      }
+#else
+      struct stat info;
+      if ( stat( path.c_str(), &info ) != 0 )
+      {
+         return -1;
+      }
+#endif
+      return static_cast<int64_t>( info.st_mtime );
+   }
+
+   struct ReadCacheEntry
+   {
+      e57::ustring fileName;
+      int64_t modificationTime;
+      e57::ImageFileImplSharedPtr imf;
+   };
+
+   /// Process-wide store of recently closed read mode files, oldest first.
+   /// Leaked intentionally so cached files aren't destroyed during static
+   /// destruction in an arbitrary order.
+   struct ReadCache
+   {
+      std::mutex mutex;
+      size_t capacity = 0;
+      std::deque<ReadCacheEntry> entries;
+   };
+
+   ReadCache &readCache()
+   {
+      static ReadCache *cache = new ReadCache;
+      return *cache;
+   }
+}
+
 namespace e57
 {
    struct NameSpace
@@ -96,8 +162,8 @@ namespace e57
       // Get shared_ptr to this object
       ImageFileImplSharedPtr imf = shared_from_this();
 
-      // Accept "w" or "r" modes
-      isWriter_ = ( mode == "w" );
+      // Accept "w", "a" or "r" modes
+      isWriter_ = ( mode == "w" ) || ( mode == "a" );
 
       if ( !isWriter_ && ( mode != "r" ) )
       {
@@ -106,6 +172,61 @@ namespace e57
 
       file_ = nullptr;
 
+      // Appending
+      if ( mode == "a" )
+      {
+         try
+         {
+            // Open existing file for read/write, nothing is truncated.
+            file_ = new CheckedFile( fileName_, CheckedFile::Append, checksumPolicy );
+
+            std::shared_ptr<StructureNodeImpl> root( new StructureNodeImpl( imf ) );
+            root_ = root;
+            root_->setAttachedRecursive();
+
+            E57FileHeader header;
+            readFileHeader( file_, header );
+
+            xmlLogicalOffset_ = file_->physicalToLogical( header.xmlPhysicalOffset );
+            xmlLogicalLength_ = header.xmlLogicalLength;
+
+            // Parse the whole existing tree now; a writer can't defer
+            // subtrees because the XML section they live in is reclaimed
+            // below.
+            parseXmlSection();
+
+            // The header only points at the XML section; it need not be the
+            // last thing in the file. Reclaim its span for new binary
+            // sections (close() re-emits the XML after them) only when
+            // nothing but page padding follows it; otherwise a binary
+            // section sits beyond the XML, and new sections must start at
+            // end of file to leave it untouched.
+            const uint64_t cFileLogicalLength = file_->length( CheckedFile::Logical );
+            const uint64_t cXmlLogicalEnd = xmlLogicalOffset_ + xmlLogicalLength_;
+
+            if ( cFileLogicalLength - cXmlLogicalEnd < CheckedFile::logicalPageSize )
+            {
+               unusedLogicalStart_ = xmlLogicalOffset_;
+            }
+            else
+            {
+               unusedLogicalStart_ = cFileLogicalLength;
+            }
+
+            xmlLogicalOffset_ = 0;
+            xmlLogicalLength_ = 0;
+         }
+         catch ( ... )
+         {
+            delete file_;
+            file_ = nullptr;
+
+            throw;
+         }
+
+         return;
+      }
+
       // Writing
       if ( isWriter_ )
       {
@@ -159,18 +280,18 @@ namespace e57
 
       try
       {
-         // Create parser state, attach its event handers to the SAX2 reader
-         E57XmlParser parser( imf );
-
-         parser.init();
-
-         // Create input source (XML section of E57 file turned into a stream).
-         E57XmlFileInputSource xmlSection( file_, xmlLogicalOffset_, xmlLogicalLength_ );
-
          unusedLogicalStart_ = sizeof( E57FileHeader );
 
-         // Do the parse, building up the node tree
-         parser.parse( xmlSection );
+         // Build the node tree from the sidecar cache when a valid one
+         // exists; otherwise parse the XML section and leave a sidecar
+         // behind for the next open (see SidecarCache)
+         if ( !SidecarCache::load( imf ) )
+         {
+            // Do the parse, building up the node tree
+            parseXmlSection();
+
+            SidecarCache::store( imf );
+         }
       }
       catch ( ... )
       {
@@ -222,18 +343,66 @@ namespace e57
 
       try
       {
-         // Create parser state, attach its event handers to the SAX2 reader
-         E57XmlParser parser( imf );
+         unusedLogicalStart_ = sizeof( E57FileHeader );
+
+         // Do the parse, building up the node tree
+         parseXmlSection();
+      }
+      catch ( ... )
+      {
+         delete file_;
+         file_ = nullptr;
+
+         throw;
+      }
+   }
+
+   void ImageFileImpl::construct2( std::shared_ptr<ReadProvider> provider )
+   {
+      // Second phase of construction, now we have a well-formed ImageFile object.
+
+#ifdef E57_VERBOSE
+      std::cout << "ImageFileImpl() called, fileName=<ReadProvider> mode=r" << std::endl;
+#endif
+      unusedLogicalStart_ = sizeof( E57FileHeader );
+      fileName_ = "<ReadProvider>";
+
+      // Get shared_ptr to this object
+      ImageFileImplSharedPtr imf = shared_from_this();
+
+      isWriter_ = false;
+      file_ = nullptr;
+
+      try
+      {
+         // Open the caller-supplied source for reading.
+         file_ = new CheckedFile( std::move( provider ), checksumPolicy );
 
-         parser.init();
+         std::shared_ptr<StructureNodeImpl> root( new StructureNodeImpl( imf ) );
+         root_ = root;
+         root_->setAttachedRecursive();
 
-         // Create input source (XML section of E57 file turned into a stream).
-         E57XmlFileInputSource xmlSection( file_, xmlLogicalOffset_, xmlLogicalLength_ );
+         E57FileHeader header;
+         readFileHeader( file_, header );
 
+         xmlLogicalOffset_ = file_->physicalToLogical( header.xmlPhysicalOffset );
+         xmlLogicalLength_ = header.xmlLogicalLength;
+      }
+      catch ( ... )
+      {
+         delete file_;
+         file_ = nullptr;
+
+         throw;
+      }
+
+      try
+      {
          unusedLogicalStart_ = sizeof( E57FileHeader );
 
-         // Do the parse, building up the node tree
-         parser.parse( xmlSection );
+         // Do the parse, building up the node tree. No sidecar: the source
+         // has no filesystem path to put one next to.
+         parseXmlSection();
       }
       catch ( ... )
       {
@@ -244,6 +413,536 @@ namespace e57
       }
    }
 
+   namespace
+   {
+      /// Accumulates wall time from construction to scope exit in total
+      /// (nanoseconds), covering early returns and exceptions alike
+      class ScopedNanosecondTimer
+      {
+      public:
+         explicit ScopedNanosecondTimer( uint64_t &total ) :
+            total_( total ), start_( std::chrono::steady_clock::now() )
+         {
+         }
+
+         ~ScopedNanosecondTimer()
+         {
+            total_ += static_cast<uint64_t>( std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                std::chrono::steady_clock::now() - start_ )
+                                                .count() );
+         }
+
+         ScopedNanosecondTimer( const ScopedNanosecondTimer & ) = delete;
+         ScopedNanosecondTimer &operator=( const ScopedNanosecondTimer & ) = delete;
+
+      private:
+         uint64_t &total_;
+         const std::chrono::steady_clock::time_point start_;
+      };
+   }
+
+   void ImageFileImpl::parseXmlSection()
+   {
+      // A one-time cost per file, so always measured for ImageFile::stats()
+      ScopedNanosecondTimer timer( xmlParseNanoseconds_ );
+
+      // Read the section text once and find the byte ranges of the /data3D
+      // and /images2D entries, so those subtrees can be parsed individually
+      // on first access rather than all at once now.
+      ustring xmlSectionText( static_cast<size_t>( xmlLogicalLength_ ), 0 );
+      file_->readAt( xmlLogicalOffset_, &xmlSectionText[0], xmlSectionText.length() );
+
+      E57XmlSectionScanner scanner;
+
+      // Deferring subtrees is only safe for readers: an appending writer
+      // reclaims the XML section the deferred fragments would be read from.
+      if ( !isWriter_ && scanner.scan( xmlSectionText, xmlLogicalOffset_ ) )
+      {
+         try
+         {
+            // Parse the section text with the deferred entries cut out
+            parseXmlDocument( scanner.reducedXml() );
+
+            lazyFragmentPrefix_ = scanner.fragmentPrefix();
+            lazyFragmentSuffix_ = scanner.fragmentSuffix();
+
+            installDeferredChildren( "data3D", scanner.data3DChildren() );
+            installDeferredChildren( "images2D", scanner.images2DChildren() );
+            return;
+         }
+         catch ( E57Exception & )
+         {
+            // The reduced document didn't parse. Undo anything the partial
+            // parse registered and fall through to the eager path, which
+            // either succeeds or reports the error on the original text.
+            nameSpaces_.clear();
+            lazyFragmentPrefix_.clear();
+            lazyFragmentSuffix_.clear();
+         }
+      }
+
+      // Do the parse of the whole section, building up the node tree
+      parseXmlDocument( xmlSectionText );
+   }
+
+   void ImageFileImpl::parseXmlDocument( const ustring &xmlText )
+   {
+      E57_TRACE_SPAN_SIZED( "xmlParse", xmlText.size() );
+
+#ifndef E57_STRICT_XML_PARSER
+      // Try the built-in non-validating parser first; it handles the XML any
+      // conforming E57 writer produces without Xerces' per-element UTF-16
+      // transcoding. Documents it can't handle go to Xerces below, so save
+      // the registered namespaces in case a failed attempt got far enough to
+      // register some.
+      const std::vector<NameSpace> savedNameSpaces = nameSpaces_;
+
+      try
+      {
+         E57XmlLiteParser parser( shared_from_this() );
+
+         parser.parse( xmlText );
+         return;
+      }
+      catch ( E57Exception & )
+      {
+         nameSpaces_ = savedNameSpaces;
+      }
+#endif
+
+      // Create parser state, attach its event handers to the SAX2 reader
+      E57XmlParser parser( shared_from_this() );
+
+      parser.init();
+
+      E57XmlMemBufInputSource xmlSection( xmlText );
+
+      // Do the parse, building up the node tree
+      parser.parse( xmlSection );
+   }
+
+   void ImageFileImpl::installDeferredChildren( const ustring &elementName,
+                                                const std::vector<XmlByteRange> &ranges )
+   {
+      if ( ranges.empty() )
+      {
+         return;
+      }
+
+      // The scanner only defers children of a root-level vector with this
+      // name, so the reduced parse must have produced exactly that, empty
+      if ( !root_->isDefined( elementName ) )
+      {
+         throw E57_EXCEPTION2( ErrorInternal,
+                               "fileName=" + fileName_ + " elementName=" + elementName );
+      }
+
+      NodeImplSharedPtr ni = root_->get( elementName );
+
+      if ( ni->type() != TypeVector )
+      {
+         throw E57_EXCEPTION2( ErrorInternal,
+                               "fileName=" + fileName_ + " elementName=" + elementName );
+      }
+
+      std::static_pointer_cast<StructureNodeImpl>( ni )->setDeferredChildren( ranges );
+   }
+
+   NodeImplSharedPtr ImageFileImpl::parseLazyNode( const XmlByteRange &range )
+   {
+      ScopedNanosecondTimer timer( xmlParseNanoseconds_ );
+
+      // Wrap the node's bytes in the copy of the root start tag captured when
+      // the file was opened, so namespace declarations stay in scope, and run
+      // the regular parser on the little document.
+      ustring document = lazyFragmentPrefix_;
+      const size_t prefixLength = document.length();
+
+      document.resize( prefixLength + static_cast<size_t>( range.logicalLength ) );
+      file_->readAt( range.logicalOffset, &document[prefixLength],
+                     static_cast<size_t>( range.logicalLength ) );
+      document += lazyFragmentSuffix_;
+
+      // The parser installs the document's root element as root_ when the
+      // parse completes, so save the real root around the fragment parse.
+      std::shared_ptr<StructureNodeImpl> savedRoot = root_;
+      std::shared_ptr<StructureNodeImpl> wrapper;
+
+      try
+      {
+         parseXmlDocument( document );
+
+         wrapper = root_;
+      }
+      catch ( ... )
+      {
+         root_ = savedRoot;
+         throw;
+      }
+      root_ = savedRoot;
+
+      if ( !wrapper || wrapper->childCount() != 1 )
+      {
+         throw E57_EXCEPTION2( ErrorBadXMLFormat, "fileName=" + fileName_ );
+      }
+
+      return wrapper->get( 0 );
+   }
+
+   void ImageFileImpl::prefetchBinarySection( uint64_t sectionLogicalStart )
+   {
+#if defined( E57_HAVE_SECTION_PREFETCH )
+      // Writers don't read their sections back, and a stream buffer is
+      // already in memory
+      if ( isWriter_ || ( fileName_ == "<StreamBuffer>" ) )
+      {
+         return;
+      }
+
+      std::lock_guard<std::mutex> lock( prefetchMutex_ );
+
+      // Each section only once, even if a parse fallback replays the XML
+      if ( std::find( prefetchStarted_.begin(), prefetchStarted_.end(), sectionLogicalStart ) !=
+           prefetchStarted_.end() )
+      {
+         return;
+      }
+
+      if ( !prefetchThread_.joinable() )
+      {
+         prefetchFd_ = ::open( fileName_.c_str(), O_RDONLY );
+
+         if ( prefetchFd_ < 0 )
+         {
+            return;
+         }
+
+         prefetchThread_ = std::thread( &ImageFileImpl::binarySectionPrefetchLoop, this );
+      }
+
+      prefetchStarted_.push_back( sectionLogicalStart );
+      prefetchQueue_.push_back( sectionLogicalStart );
+
+      prefetchWake_.notify_one();
+#else
+      UNUSED( sectionLogicalStart );
+#endif
+   }
+
+   void ImageFileImpl::stopBinarySectionPrefetch()
+   {
+      if ( !prefetchThread_.joinable() )
+      {
+         return;
+      }
+
+      {
+         std::lock_guard<std::mutex> lock( prefetchMutex_ );
+         stopPrefetch_ = true;
+      }
+
+      prefetchWake_.notify_all();
+      prefetchThread_.join();
+
+#if defined( E57_HAVE_SECTION_PREFETCH )
+      if ( prefetchFd_ >= 0 )
+      {
+         ::close( prefetchFd_ );
+         prefetchFd_ = -1;
+      }
+#endif
+
+      // Leave the prefetcher restartable: a reopen() of this file parses its
+      // deferred scans lazily and queues their sections then
+      stopPrefetch_ = false;
+      prefetchQueue_.clear();
+   }
+
+   void ImageFileImpl::binarySectionPrefetchLoop()
+   {
+#if defined( E57_HAVE_SECTION_PREFETCH )
+      // The first data packets of a section: enough for a reader's first
+      // read() calls to find warm data, without dragging whole sections
+      // through the page cache. Chunks keep the stop latency bounded.
+      constexpr uint64_t cPrefetchBytes = 4 * 1024 * 1024;
+      constexpr size_t cChunkSize = 256 * 1024;
+
+      std::vector<char> scratch( cChunkSize );
+
+      std::unique_lock<std::mutex> lock( prefetchMutex_ );
+
+      while ( true )
+      {
+         prefetchWake_.wait( lock, [this] { return stopPrefetch_ || !prefetchQueue_.empty(); } );
+
+         if ( stopPrefetch_ )
+         {
+            return;
+         }
+
+         // Sections warm in the order the parse found them, which is the
+         // order a viewer typically asks for them
+         const uint64_t cSectionStart = prefetchQueue_.front();
+         prefetchQueue_.pop_front();
+
+         uint64_t pos = CheckedFile::logicalToPhysical( cSectionStart );
+         const uint64_t cEnd = pos + cPrefetchBytes;
+
+         while ( pos < cEnd )
+         {
+            if ( stopPrefetch_ )
+            {
+               return;
+            }
+
+            lock.unlock();
+
+            const ssize_t result =
+               ::pread( prefetchFd_, scratch.data(), cChunkSize, static_cast<off_t>( pos ) );
+
+            lock.lock();
+
+            if ( result <= 0 )
+            {
+               // End of file or a read problem; the foreground reads will
+               // report any real error
+               break;
+            }
+
+            pos += static_cast<uint64_t>( result );
+         }
+      }
+#endif
+   }
+
+   void ImageFileImpl::readCacheSetCapacity( size_t fileCount )
+   {
+      ReadCache &cache = readCache();
+      std::lock_guard<std::mutex> lock( cache.mutex );
+
+      cache.capacity = fileCount;
+      while ( cache.entries.size() > cache.capacity )
+      {
+         cache.entries.pop_front();
+      }
+   }
+
+   void ImageFileImpl::readCacheClear()
+   {
+      ReadCache &cache = readCache();
+      std::lock_guard<std::mutex> lock( cache.mutex );
+
+      cache.entries.clear();
+   }
+
+   ImageFileImplSharedPtr ImageFileImpl::readCacheFetch( const ustring &fileName,
+                                                         ReadChecksumPolicy policy )
+   {
+      ReadCache &cache = readCache();
+      std::lock_guard<std::mutex> lock( cache.mutex );
+
+      if ( cache.entries.empty() )
+      {
+         return nullptr;
+      }
+
+      for ( auto it = cache.entries.begin(); it != cache.entries.end(); ++it )
+      {
+         if ( it->fileName != fileName )
+         {
+            continue;
+         }
+
+         // Take the entry out of the cache in all cases: a stale entry is
+         // useless, and a borrowed one must have a single owner so two
+         // concurrent opens of the same path can't share a file position.
+         ImageFileImplSharedPtr imf = it->imf;
+         const int64_t modificationTime = it->modificationTime;
+         cache.entries.erase( it );
+
+         if ( imf->checksumPolicy != policy ||
+              fileModificationTime( fileName ) != modificationTime )
+         {
+            return nullptr;
+         }
+
+         if ( !imf->reopen() )
+         {
+            return nullptr;
+         }
+
+         return imf;
+      }
+
+      return nullptr;
+   }
+
+   void ImageFileImpl::readCacheStore()
+   {
+      // Never cache writers or memory buffer files, and only cache files
+      // whose modification time can key a later fetch
+      if ( isWriter_ || fileName_ == "<StreamBuffer>" )
+      {
+         return;
+      }
+
+      ReadCache &cache = readCache();
+      std::lock_guard<std::mutex> lock( cache.mutex );
+
+      if ( cache.capacity == 0 )
+      {
+         return;
+      }
+
+      const int64_t modificationTime = fileModificationTime( fileName_ );
+      if ( modificationTime < 0 )
+      {
+         return;
+      }
+
+      // A new entry for the same path supersedes an old one
+      for ( auto it = cache.entries.begin(); it != cache.entries.end(); ++it )
+      {
+         if ( it->fileName == fileName_ )
+         {
+            cache.entries.erase( it );
+            break;
+         }
+      }
+
+      cache.entries.push_back( { fileName_, modificationTime, shared_from_this() } );
+      while ( cache.entries.size() > cache.capacity )
+      {
+         cache.entries.pop_front();
+      }
+   }
+
+   bool ImageFileImpl::reopen()
+   {
+      if ( file_ != nullptr || isWriter_ )
+      {
+         return false;
+      }
+
+      try
+      {
+         file_ = new CheckedFile( fileName_, CheckedFile::Read, checksumPolicy );
+      }
+      catch ( E57Exception & )
+      {
+         file_ = nullptr;
+         return false;
+      }
+
+      writerCount_ = 0;
+      readerCount_ = 0;
+
+      if ( statsEnabled_ )
+      {
+         file_->setStatsData( &statsData_ );
+      }
+
+      return true;
+   }
+
+   void ImageFileImpl::statsSetEnabled( bool enabled )
+   {
+      statsEnabled_ = enabled;
+
+      if ( file_ != nullptr )
+      {
+         file_->setStatsData( enabled ? &statsData_ : nullptr );
+      }
+   }
+
+   ImageFileStats ImageFileImpl::stats() const
+   {
+      ImageFileStats snapshot;
+
+      snapshot.bytesRead = statsData_.bytesRead;
+      snapshot.bytesWritten = statsData_.bytesWritten;
+      snapshot.pagesChecksummed = statsData_.pagesChecksummed;
+      snapshot.packetCacheHits = statsData_.packetCacheHits;
+      snapshot.packetCacheMisses = statsData_.packetCacheMisses;
+      snapshot.recordsEncoded = statsData_.recordsEncoded;
+      snapshot.recordsDecoded = statsData_.recordsDecoded;
+      snapshot.recordsSynthesized = statsData_.recordsSynthesized;
+      snapshot.xmlParseSeconds = static_cast<double>( xmlParseNanoseconds_ ) * 1e-9;
+
+      // Current holdings, not counters: readers' packet caches plus this
+      // file's pooled staging buffers
+      snapshot.memoryUsedBytes = statsData_.memoryUsedBytes + bufferPool_->usedBytes();
+
+      return snapshot;
+   }
+
+   ImageFileStatsData *ImageFileImpl::statsData()
+   {
+      return statsEnabled_ ? &statsData_ : nullptr;
+   }
+
+   void ImageFileImpl::packetCacheSetCapacity( size_t sizeMB )
+   {
+      packetCacheBytes_ = sizeMB * 1024 * 1024;
+   }
+
+   std::vector<uint64_t> ImageFileImpl::verifyChecksums( unsigned nThreads )
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      return file_->verifyChecksums( nThreads );
+   }
+
+   size_t ImageFileImpl::packetCacheBytes() const
+   {
+      return packetCacheBytes_;
+   }
+
+   void ImageFileImpl::ioUnitSetSize( size_t sizeMB )
+   {
+      ioUnitBytes_ = sizeMB * 1024 * 1024;
+
+      if ( file_ != nullptr )
+      {
+         file_->setWriteCoalesceBytes( ioUnitBytes_ );
+      }
+   }
+
+   size_t ImageFileImpl::ioUnitBytes() const
+   {
+      return ioUnitBytes_;
+   }
+
+   void ImageFileImpl::decodeSetPinWorkers( bool pin )
+   {
+      decodePinWorkers_ = pin;
+   }
+
+   bool ImageFileImpl::decodePinWorkers() const
+   {
+      return decodePinWorkers_;
+   }
+
+   void ImageFileImpl::cacheSetStreaming( bool streaming )
+   {
+      cacheStreaming_ = streaming;
+
+      if ( file_ != nullptr )
+      {
+         file_->setCacheStreaming( streaming );
+      }
+   }
+
+   bool ImageFileImpl::cacheStreaming() const
+   {
+      return cacheStreaming_;
+   }
+
+   void ImageFileImpl::stagingSetHugePages( bool enabled )
+   {
+      bufferPool_->setUseHugePages( enabled );
+   }
+
    std::shared_ptr<StructureNodeImpl> ImageFileImpl::root()
    {
       checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
@@ -253,6 +952,8 @@ namespace e57
 
    void ImageFileImpl::close()
    {
+      stopBinarySectionPrefetch();
+
       // If file already closed, have nothing to do
       if ( file_ == nullptr )
       {
@@ -261,52 +962,113 @@ namespace e57
 
       if ( isWriter_ )
       {
-         // Go to end of file, note physical position
-         xmlLogicalOffset_ = unusedLogicalStart_;
-         file_->seek( xmlLogicalOffset_, CheckedFile::Logical );
-         uint64_t xmlPhysicalOffset = file_->position( CheckedFile::Physical );
+         // Sections that concurrent writers parked in spill files land now,
+         // before the XML snapshot of the tree that points at them
+         applyPendingSectionTransplants();
+
+         writeXmlSectionAndHeader();
+
+         file_->close();
+      }
+
+      delete file_;
+      file_ = nullptr;
+
+      // The parsed node tree is still intact; a later open of the same
+      // unchanged file can pick it up instead of re-parsing
+      readCacheStore();
+   }
+
+   void ImageFileImpl::writeXmlSectionAndHeader()
+   {
+      // Go to end of file, note physical position
+      xmlLogicalOffset_ = unusedLogicalStart_;
+      file_->seek( xmlLogicalOffset_, CheckedFile::Logical );
+      uint64_t xmlPhysicalOffset = file_->position( CheckedFile::Physical );
+
+      // Serialization emits many tiny writes; coalesce them so each
+      // physical page is stamped and flushed once, overlapped with the
+      // device writes by the background page writer.
+      file_->beginStreamWrite();
+
+      try
+      {
          *file_ << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
 
          //??? need to add name space attributes to e57Root
          root_->writeXml( shared_from_this(), *file_, 0, "e57Root" );
+      }
+      catch ( ... )
+      {
+         file_->endStreamWrite();
+         throw;
+      }
 
-         // Pad XML section so length is multiple of 4
-         while ( ( file_->position( CheckedFile::Logical ) - xmlLogicalOffset_ ) % 4 != 0 )
-         {
-            *file_ << " ";
-         }
+      file_->endStreamWrite();
 
-         // Note logical length
-         xmlLogicalLength_ = file_->position( CheckedFile::Logical ) - xmlLogicalOffset_;
+      // Pad XML section so length is multiple of 4
+      while ( ( file_->position( CheckedFile::Logical ) - xmlLogicalOffset_ ) % 4 != 0 )
+      {
+         *file_ << " ";
+      }
 
-         // Init header contents
-         E57FileHeader header;
+      // Note logical length
+      xmlLogicalLength_ = file_->position( CheckedFile::Logical ) - xmlLogicalOffset_;
+
+      // Init header contents
+      E57FileHeader header;
 
-         memcpy( &header.fileSignature, "ASTM-E57", 8 );
+      memcpy( &header.fileSignature, "ASTM-E57", 8 );
 
-         header.majorVersion = E57_FORMAT_MAJOR;
-         header.minorVersion = E57_FORMAT_MINOR;
-         header.filePhysicalLength = file_->length( CheckedFile::Physical );
-         header.xmlPhysicalOffset = xmlPhysicalOffset;
-         header.xmlLogicalLength = xmlLogicalLength_;
-         header.pageSize = CheckedFile::physicalPageSize;
+      header.majorVersion = E57_FORMAT_MAJOR;
+      header.minorVersion = E57_FORMAT_MINOR;
+      header.filePhysicalLength = file_->length( CheckedFile::Physical );
+      header.xmlPhysicalOffset = xmlPhysicalOffset;
+      header.xmlLogicalLength = xmlLogicalLength_;
+      header.pageSize = CheckedFile::physicalPageSize;
 #ifdef E57_VERBOSE
-         header.dump();
+      header.dump();
 #endif
 
-         // Write header at beginning of file
-         file_->seek( 0 );
-         file_->write( reinterpret_cast<char *>( &header ), sizeof( header ) );
+      // Write header at beginning of file
+      file_->seek( 0 );
+      file_->write( reinterpret_cast<char *>( &header ), sizeof( header ) );
+   }
 
-         file_->close();
+   void ImageFileImpl::checkpoint()
+   {
+      if ( file_ == nullptr )
+      {
+         throw E57_EXCEPTION2( ErrorImageFileNotOpen, "fileName=" + fileName_ );
       }
 
-      delete file_;
-      file_ = nullptr;
+      if ( !isWriter_ )
+      {
+         throw E57_EXCEPTION2( ErrorFileReadOnly, "fileName=" + fileName_ );
+      }
+
+      writeXmlSectionAndHeader();
+
+      // The snapshot is not part of the final file: the next binary section
+      // (or the final XML section) starts at unusedLogicalStart_ and
+      // overwrites it, after which close() or another checkpoint() writes a
+      // fresh one covering the newer data.
+      xmlLogicalOffset_ = 0;
+      xmlLogicalLength_ = 0;
    }
 
    void ImageFileImpl::cancel()
    {
+      stopBinarySectionPrefetch();
+
+      // Spilled sections die with this file; dropping the references here
+      // closes and unlinks each spill file (ImageFileImpl dtor)
+      {
+         std::lock_guard<std::mutex> lock( transplantMutex_ );
+
+         pendingTransplants_.clear();
+      }
+
       // If file already closed, have nothing to do
       if ( file_ == nullptr )
       {
@@ -328,6 +1090,35 @@ namespace e57
       file_ = nullptr;
    }
 
+   void ImageFileImpl::queueSectionTransplant( ImageFileImplSharedPtr spillImf,
+                                               std::shared_ptr<CompressedVectorNodeImpl> source,
+                                               std::shared_ptr<CompressedVectorNodeImpl> target )
+   {
+      std::lock_guard<std::mutex> lock( transplantMutex_ );
+
+      pendingTransplants_.push_back(
+         { std::move( spillImf ), std::move( source ), std::move( target ) } );
+   }
+
+   void ImageFileImpl::applyPendingSectionTransplants()
+   {
+      std::vector<PendingSectionTransplant> pending;
+
+      {
+         std::lock_guard<std::mutex> lock( transplantMutex_ );
+
+         pending.swap( pendingTransplants_ );
+      }
+
+      for ( PendingSectionTransplant &entry : pending )
+      {
+         entry.source->rawCopySectionTo( entry.target );
+
+         // Deletes the spill file
+         entry.spillImf->cancel();
+      }
+   }
+
    bool ImageFileImpl::isOpen() const
    {
       return ( file_ != nullptr );
@@ -368,6 +1159,8 @@ namespace e57
 
    uint64_t ImageFileImpl::allocateSpace( uint64_t byteCount, bool doExtendNow )
    {
+      std::lock_guard<std::mutex> lock( allocateMutex_ );
+
       uint64_t oldLogicalStart = unusedLogicalStart_;
 
       // Reserve space at end of file
@@ -418,6 +1211,11 @@ namespace e57
       nameSpaces_.emplace_back( prefix, uri );
    }
 
+   void ImageFileImpl::extensionsClear()
+   {
+      nameSpaces_.clear();
+   }
+
    bool ImageFileImpl::extensionsLookupPrefix( const ustring &prefix, ustring &uri ) const
    {
       checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
@@ -675,8 +1473,8 @@ namespace e57
       if ( writerCount_ < 0 )
       {
          throw E57_EXCEPTION2( ErrorInternal, "fileName=" + fileName_ +
-                                                 " writerCount=" + toString( writerCount_ ) +
-                                                 " readerCount=" + toString( readerCount_ ) );
+                                                 " writerCount=" + toString( writerCount_.load() ) +
+                                                 " readerCount=" + toString( readerCount_.load() ) );
       }
 #endif
    }
@@ -694,8 +1492,8 @@ namespace e57
       if ( readerCount_ < 0 )
       {
          throw E57_EXCEPTION2( ErrorInternal, "fileName=" + fileName_ +
-                                                 " writerCount=" + toString( writerCount_ ) +
-                                                 " readerCount=" + toString( readerCount_ ) );
+                                                 " writerCount=" + toString( writerCount_.load() ) +
+                                                 " readerCount=" + toString( readerCount_.load() ) );
       }
 #endif
    }
@@ -27,13 +27,20 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <memory>
+#include <mutex>
+#include <thread>
 
+#include "BufferPool.h"
 #include "Common.h"
 
 namespace e57
 {
    class CheckedFile;
+   class CompressedVectorNodeImpl;
 
    struct E57FileHeader;
    struct NameSpace;
@@ -45,11 +52,90 @@ namespace e57
 
       void construct2( const ustring &fileName, const ustring &mode );
       void construct2( const char *input, uint64_t size );
+      void construct2( std::shared_ptr<ReadProvider> provider );
+
+      /// Process-wide cache of parsed read mode files, keyed by path and
+      /// modification time, so reopening a recently closed file skips
+      /// re-parsing the XML section. Disabled (zero capacity) by default.
+      static void readCacheSetCapacity( size_t fileCount );
+      static void readCacheClear();
+
+      /// Returns a reopened cached file for the path, or nullptr when the
+      /// cache has no current entry for it
+      static ImageFileImplSharedPtr readCacheFetch( const ustring &fileName,
+                                                    ReadChecksumPolicy policy );
 
       std::shared_ptr<StructureNodeImpl> root();
 
+      /// Performance counters (see ImageFile::stats()). statsData() returns
+      /// the counter block to update, or nullptr while collection is
+      /// disabled; readers and writers pick it up when they are created.
+      void statsSetEnabled( bool enabled );
+      ImageFileStats stats() const;
+      ImageFileStatsData *statsData();
+
+      /// Packet read cache budget for readers of this file (see
+      /// ImageFile::packetCacheSetCapacity). packetCacheBytes() returns 0
+      /// when the default size should be used.
+      void packetCacheSetCapacity( size_t sizeMB );
+      size_t packetCacheBytes() const;
+
+      /// Preferred I/O transfer unit for this file (see
+      /// ImageFile::ioUnitSetSize). ioUnitBytes() returns 0 when reads
+      /// should stay packet-sized.
+      void ioUnitSetSize( size_t sizeMB );
+      size_t ioUnitBytes() const;
+
+      /// CPU pinning for the parallel decode workers of this file's readers
+      /// (see ImageFile::decodeSetPinWorkers). Off by default.
+      void decodeSetPinWorkers( bool pin );
+      bool decodePinWorkers() const;
+
+      /// Streaming OS page cache policy for this file's reads (see
+      /// ImageFile::cacheSetStreaming). Off by default.
+      void cacheSetStreaming( bool streaming );
+      bool cacheStreaming() const;
+
+      /// Huge page backing for the staging buffers leased from bufferPool()
+      /// (see ImageFile::stagingSetHugePages). Off by default.
+      void stagingSetHugePages( bool enabled );
+
+      /// Bulk page CRC validation (see ImageFile::verifyChecksums)
+      std::vector<uint64_t> verifyChecksums( unsigned nThreads );
+
+      /// Pool the bytestream working buffers of this file's writers and
+      /// readers lease from, so consecutive scans reuse allocations.
+      /// Shared ownership, since encoders may outlive the image file.
+      std::shared_ptr<BufferPool> bufferPool() const
+      {
+         return bufferPool_;
+      }
+
+      /// Queue the first bytes of a CompressedVector binary section for
+      /// background page cache warm-up, so the first read() of the vector
+      /// finds its data packets resident. Called as the XML parse (or a
+      /// sidecar cache load) discovers each fileOffset, overlapping data I/O
+      /// with the rest of the open. A no-op for writers, stream buffers, and
+      /// platforms without pread().
+      void prefetchBinarySection( uint64_t sectionLogicalStart );
+
       void close();
       void cancel();
+
+      /// Take ownership of a finished section a concurrent writer produced
+      /// in a spill file (see CompressedVectorNodeImpl::writer): @a source
+      /// lives in @a spillImf and is transplanted into @a target when this
+      /// file closes, after which the spill file is deleted.
+      void queueSectionTransplant( ImageFileImplSharedPtr spillImf,
+                                   std::shared_ptr<CompressedVectorNodeImpl> source,
+                                   std::shared_ptr<CompressedVectorNodeImpl> target );
+
+      /// Write a provisional XML snapshot and file header describing
+      /// everything written so far, without closing. The snapshot sits in
+      /// what is still free space, so whatever is written next reclaims it;
+      /// close() (or a later checkpoint()) supersedes it.
+      void checkpoint();
+
       bool isOpen() const;
       bool isWriter() const;
       int writerCount() const;
@@ -94,8 +180,11 @@ namespace e57
 #endif
 
    private:
+      friend class E57XmlBuilder;
       friend class E57XmlParser;
+      friend class SidecarCache;
       friend class BlobNodeImpl;
+      friend class StructureNodeImpl;
       friend class CompressedVectorWriterImpl;
       friend class CompressedVectorReaderImpl;
 
@@ -104,10 +193,56 @@ namespace e57
       void checkImageFileOpen( const char *srcFileName, int srcLineNumber,
                                const char *srcFunctionName ) const;
 
+      /// Serialize the node tree as the XML section at the start of free
+      /// space and point the file header at it. Does not advance
+      /// unusedLogicalStart_: close() stops writing afterwards, and a
+      /// checkpoint() snapshot is reclaimed by whatever is written next.
+      void writeXmlSectionAndHeader();
+
+      /// Parse the XML section of a file opened for reading, deferring the
+      /// /data3D and /images2D entries for lazy parsing when possible
+      void parseXmlSection();
+
+      /// Build the node tree from one complete XML document, trying the
+      /// built-in parser first and falling back to Xerces (unless compiled
+      /// with E57_STRICT_XML_PARSER, which always uses Xerces)
+      void parseXmlDocument( const ustring &xmlText );
+
+      /// Hand the byte ranges found by the pre-parse scan to the named
+      /// root-level vector, whose entries were cut from the parsed text
+      void installDeferredChildren( const ustring &elementName,
+                                    const std::vector<XmlByteRange> &ranges );
+
+      /// Parse the XML of a single deferred node on first access
+      NodeImplSharedPtr parseLazyNode( const XmlByteRange &range );
+
+      /// Stop the prefetch thread and close its file descriptor
+      void stopBinarySectionPrefetch();
+
+      void binarySectionPrefetchLoop();
+
+      /// Drop all registered extensions (recovery from a failed partial
+      /// parse or sidecar load)
+      void extensionsClear();
+
+      /// Offer this closed read mode file to the process-wide read cache
+      void readCacheStore();
+
+      /// Transplant the queued spill sections into this file and delete the
+      /// spill files. Runs at close(), when no writer is active: a section
+      /// landing inside a still-open writer's section would corrupt it.
+      void applyPendingSectionTransplants();
+
+      /// Open the underlying file again after close(), keeping the parsed
+      /// node tree; returns false if the file can't be opened
+      bool reopen();
+
       ustring fileName_;
       bool isWriter_;
-      int writerCount_;
-      int readerCount_;
+
+      // Atomic so readers on different threads can be closed concurrently
+      std::atomic<int> writerCount_;
+      std::atomic<int> readerCount_;
 
       ReadChecksumPolicy checksumPolicy;
 
@@ -117,9 +252,65 @@ namespace e57
       uint64_t xmlLogicalOffset_;
       uint64_t xmlLogicalLength_;
 
+      // Wrapper tags for parsing one deferred node (lazy reading), empty if
+      // the whole XML section was parsed eagerly
+      ustring lazyFragmentPrefix_;
+      ustring lazyFragmentSuffix_;
+
+      // Performance counters; XML parse time is tracked unconditionally
+      // since it is a one-time cost per file, the rest only while enabled
+      ImageFileStatsData statsData_;
+      bool statsEnabled_ = false;
+      uint64_t xmlParseNanoseconds_ = 0;
+
+      // Per-reader packet cache budget in bytes, 0 for the built-in default
+      size_t packetCacheBytes_ = 0;
+
+      // Preferred I/O transfer unit in bytes, 0 for the built-in defaults
+      size_t ioUnitBytes_ = 0;
+
+      // Pin parallel decode workers to CPUs, see decodeSetPinWorkers()
+      bool decodePinWorkers_ = false;
+
+      // Streaming page cache policy, see cacheSetStreaming()
+      bool cacheStreaming_ = false;
+
+      // Reusable bytestream buffers, see bufferPool()
+      std::shared_ptr<BufferPool> bufferPool_{ new BufferPool };
+
+      // Binary section prefetch (read mode): warms the page cache with the
+      // first bytes of each CompressedVector section the XML parse discovers,
+      // in discovery order (see prefetchBinarySection)
+      std::thread prefetchThread_;
+      std::mutex prefetchMutex_;
+      std::condition_variable prefetchWake_;
+      std::deque<uint64_t> prefetchQueue_;
+      std::vector<uint64_t> prefetchStarted_;
+      bool stopPrefetch_ = false;
+      int prefetchFd_ = -1;
+
       // Write file attributes
       uint64_t unusedLogicalStart_;
 
+      // Guards unusedLogicalStart_: a background blob write may reserve its
+      // section while a CompressedVectorWriter reserves packet space
+      std::mutex allocateMutex_;
+
+      /// A section written by a concurrent writer, parked in its spill file
+      /// until this file closes (see queueSectionTransplant)
+      struct PendingSectionTransplant
+      {
+         ImageFileImplSharedPtr spillImf;
+         std::shared_ptr<CompressedVectorNodeImpl> source;
+         std::shared_ptr<CompressedVectorNodeImpl> target;
+      };
+
+      std::vector<PendingSectionTransplant> pendingTransplants_;
+
+      // Guards pendingTransplants_: concurrent writers close on their own
+      // threads
+      std::mutex transplantMutex_;
+
       /// Bidirectional map from namespace prefix to uri
       std::vector<NameSpace> nameSpaces_;
 
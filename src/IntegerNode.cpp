@@ -315,7 +315,7 @@ IntegerNode::IntegerNode( const Node &n )
 }
 
 /// @cond documentNonPublic The following isn't part of the API, and isn't documented.
-IntegerNode::IntegerNode( std::shared_ptr<IntegerNodeImpl> ni ) : impl_( ni )
+IntegerNode::IntegerNode( std::shared_ptr<IntegerNodeImpl> ni ) : impl_( std::move( ni ) )
 {
 }
 /// @endcond
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2026 Andy Maloney <asmaloney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/// @file MemoryBudget.cpp
+
+#include "Common.h"
+
+#include "MemoryBudgetImpl.h"
+
+using namespace e57;
+
+/*!
+@brief Cap the memory the library's caches and staging buffers may hold, process-wide.
+
+@param [in] byteCount Budget in bytes for all open ImageFiles together; 0 (the default) disables
+enforcement.
+
+@details
+Every packet read cache and staging buffer pool in the process keeps the budget informed of what
+it holds. When the registered total exceeds the budget - opening another reader, pooling another
+released buffer - the shrinkable holdings (pooled staging buffers waiting for reuse) are released
+in proportion to their size until the total fits again. Memory that is active working state, like
+the packet cache entries of an open reader, is accounted but cannot be dropped, so with enough
+concurrent transfers the total can sit above the budget; it returns under it as transfers finish.
+
+Lowering the budget takes effect immediately. Per-file usage is reported through
+ImageFileStats::memoryUsedBytes (see ImageFile::stats), the process total through
+MemoryBudget::used.
+
+@throw No E57Exceptions.
+
+@see MemoryBudget::used
+*/
+void MemoryBudget::set( uint64_t byteCount )
+{
+   MemoryBudgetImpl::instance().setLimit( byteCount );
+}
+
+/*!
+@brief Returns the configured budget in bytes, or 0 when enforcement is disabled.
+
+@throw No E57Exceptions.
+*/
+uint64_t MemoryBudget::limit()
+{
+   return MemoryBudgetImpl::instance().limit();
+}
+
+/*!
+@brief Returns the bytes currently held by the library's caches and staging buffers, process-wide.
+
+@throw No E57Exceptions.
+
+@see MemoryBudget::set
+*/
+uint64_t MemoryBudget::used()
+{
+   return MemoryBudgetImpl::instance().used();
+}
@@ -0,0 +1,200 @@
+/*
+ * Copyright 2026 Andy Maloney <asmaloney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+
+#include "MemoryBudgetImpl.h"
+
+namespace e57
+{
+   MemoryBudgetImpl &MemoryBudgetImpl::instance()
+   {
+      static MemoryBudgetImpl budget;
+
+      return budget;
+   }
+
+   uint64_t MemoryBudgetImpl::addParticipant( ShrinkCallback shrink )
+   {
+      std::lock_guard<std::mutex> lock( mutex_ );
+
+      participants_.push_back( { nextId_, 0, std::move( shrink ) } );
+
+      return nextId_++;
+   }
+
+   void MemoryBudgetImpl::removeParticipant( uint64_t id )
+   {
+      std::unique_lock<std::mutex> lock( mutex_ );
+
+      // An enforce() on another thread may hold a copy of this participant's
+      // callback; wait it out so the participant can be destroyed safely.
+      shrinkDone_.wait( lock, [this] { return shrinking_ == 0; } );
+
+      for ( auto it = participants_.begin(); it != participants_.end(); ++it )
+      {
+         if ( it->id == id )
+         {
+            used_ -= std::min( used_, it->used );
+            participants_.erase( it );
+            break;
+         }
+      }
+   }
+
+   void MemoryBudgetImpl::charge( uint64_t id, uint64_t byteCount )
+   {
+      bool overLimit = false;
+
+      {
+         std::lock_guard<std::mutex> lock( mutex_ );
+
+         for ( auto &participant : participants_ )
+         {
+            if ( participant.id == id )
+            {
+               participant.used += byteCount;
+               used_ += byteCount;
+               break;
+            }
+         }
+
+         overLimit = ( limit_ > 0 ) && ( used_ > limit_ );
+      }
+
+      if ( overLimit )
+      {
+         enforce();
+      }
+   }
+
+   void MemoryBudgetImpl::release( uint64_t id, uint64_t byteCount )
+   {
+      std::lock_guard<std::mutex> lock( mutex_ );
+
+      for ( auto &participant : participants_ )
+      {
+         if ( participant.id == id )
+         {
+            const uint64_t cReleased = std::min( participant.used, byteCount );
+
+            participant.used -= cReleased;
+            used_ -= std::min( used_, cReleased );
+            break;
+         }
+      }
+   }
+
+   void MemoryBudgetImpl::setLimit( uint64_t byteCount )
+   {
+      {
+         std::lock_guard<std::mutex> lock( mutex_ );
+
+         limit_ = byteCount;
+      }
+
+      enforce();
+   }
+
+   uint64_t MemoryBudgetImpl::limit() const
+   {
+      std::lock_guard<std::mutex> lock( mutex_ );
+
+      return limit_;
+   }
+
+   uint64_t MemoryBudgetImpl::used() const
+   {
+      std::lock_guard<std::mutex> lock( mutex_ );
+
+      return used_;
+   }
+
+   void MemoryBudgetImpl::enforce()
+   {
+      // Snapshot the shrink plan under the lock, then run the callbacks
+      // unlocked so they can re-enter release().
+      std::vector<std::pair<ShrinkCallback, uint64_t>> plan;
+
+      {
+         std::lock_guard<std::mutex> lock( mutex_ );
+
+         if ( ( limit_ == 0 ) || ( used_ <= limit_ ) )
+         {
+            return;
+         }
+
+         const uint64_t cOverage = used_ - limit_;
+
+         uint64_t shrinkableUsed = 0;
+
+         for ( const auto &participant : participants_ )
+         {
+            if ( participant.shrink && ( participant.used > 0 ) )
+            {
+               shrinkableUsed += participant.used;
+            }
+         }
+
+         if ( shrinkableUsed == 0 )
+         {
+            // Everything held is active working state; nothing to drop.
+            return;
+         }
+
+         for ( const auto &participant : participants_ )
+         {
+            if ( !participant.shrink || ( participant.used == 0 ) )
+            {
+               continue;
+            }
+
+            // Proportional share of the overage, rounded up so small holders
+            // contribute too; capped at what the participant holds.
+            const uint64_t cTarget = std::min(
+               participant.used,
+               ( cOverage * participant.used + shrinkableUsed - 1 ) / shrinkableUsed );
+
+            plan.emplace_back( participant.shrink, cTarget );
+         }
+
+         ++shrinking_;
+      }
+
+      for ( auto &entry : plan )
+      {
+         entry.first( entry.second );
+      }
+
+      {
+         std::lock_guard<std::mutex> lock( mutex_ );
+
+         --shrinking_;
+      }
+
+      shrinkDone_.notify_all();
+   }
+}
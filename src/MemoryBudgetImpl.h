@@ -0,0 +1,103 @@
+/*
+ * Copyright 2026 Andy Maloney <asmaloney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace e57
+{
+   /// Process-wide ledger of the memory held by the library's caches and
+   /// staging buffers (see MemoryBudget). Participants - packet read caches,
+   /// buffer pools - register an account and keep it charged with what they
+   /// currently hold. When a charge pushes the total over the configured
+   /// limit, every participant that registered a shrink callback is asked to
+   /// release bytes in proportion to what it holds; participants whose
+   /// memory is active working state register without a callback and are
+   /// accounted only, so the budget is a target under load rather than a
+   /// hard allocation limit. Thread safe.
+   class MemoryBudgetImpl
+   {
+   public:
+      /// Asked to release up to the given number of bytes; returns how many
+      /// bytes were actually released. Invoked with no internal lock held,
+      /// so the callback may call release() on its own account.
+      using ShrinkCallback = std::function<uint64_t( uint64_t byteCount )>;
+
+      static MemoryBudgetImpl &instance();
+
+      MemoryBudgetImpl( const MemoryBudgetImpl & ) = delete;
+      MemoryBudgetImpl &operator=( const MemoryBudgetImpl & ) = delete;
+
+      /// Register a participant; pass an empty callback for account-only
+      /// participants. Returns the id used by the other calls.
+      uint64_t addParticipant( ShrinkCallback shrink );
+
+      /// Drop a participant and its accounted usage. Blocks until no shrink
+      /// callback is in flight, so the participant may be destroyed as soon
+      /// as this returns.
+      void removeParticipant( uint64_t id );
+
+      /// Grow a participant's accounted usage; may run shrink callbacks on
+      /// the calling thread when the total exceeds the limit, so the caller
+      /// must not hold a lock its own callback needs.
+      void charge( uint64_t id, uint64_t byteCount );
+
+      /// Shrink a participant's accounted usage; never runs callbacks.
+      void release( uint64_t id, uint64_t byteCount );
+
+      void setLimit( uint64_t byteCount );
+      uint64_t limit() const;
+      uint64_t used() const;
+
+   private:
+      MemoryBudgetImpl() = default;
+
+      void enforce();
+
+      struct Participant
+      {
+         uint64_t id = 0;
+         uint64_t used = 0;
+         ShrinkCallback shrink;
+      };
+
+      mutable std::mutex mutex_;
+      std::condition_variable shrinkDone_;
+      std::vector<Participant> participants_;
+      uint64_t nextId_ = 1;
+      uint64_t limit_ = 0; // 0 disables enforcement
+      uint64_t used_ = 0;
+
+      // Number of enforce() calls currently running callbacks;
+      // removeParticipant waits for it to reach zero
+      unsigned shrinking_ = 0;
+   };
+}
@@ -598,7 +598,7 @@ bool Node::operator!=( const Node &n2 ) const
 }
 
 /// @cond documentNonPublic The following isn't part of the API, and isn't documented.
-Node::Node( NodeImplSharedPtr ni ) : impl_( ni )
+Node::Node( NodeImplSharedPtr ni ) : impl_( std::move( ni ) )
 {
 }
 /// @endcond
@@ -25,6 +25,8 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <mutex>
+
 #include "NodeImpl.h"
 #include "ImageFileImpl.h"
 #include "SourceDestBufferImpl.h"
@@ -33,6 +35,117 @@
 
 using namespace e57;
 
+namespace
+{
+   // Recycling pool behind NodeImpl::operator new/delete. Blocks are carved
+   // from large slabs and bucketed by size (every NodeImpl subclass is well
+   // under cMaxPooledBytes), so the hundreds of thousands of node
+   // allocations a big XML section makes skip the general heap, and freeing
+   // a node is a free-list push. Slabs are kept for reuse by later files
+   // rather than returned to the OS.
+   constexpr size_t cBucketBytes = 32;
+   constexpr size_t cBucketCount = 16;
+   constexpr size_t cMaxPooledBytes = cBucketBytes * cBucketCount;
+   constexpr size_t cSlabBytes = 64 * 1024;
+
+   class NodeMemoryPool
+   {
+   public:
+      void *allocate( size_t byteCount )
+      {
+         const size_t bucket = ( byteCount + cBucketBytes - 1 ) / cBucketBytes;
+
+         std::lock_guard<std::mutex> lock( mutex_ );
+
+         FreeBlock *&freeList = freeLists_[bucket - 1];
+
+         if ( freeList != nullptr )
+         {
+            void *memory = freeList;
+
+            freeList = freeList->next;
+
+            return memory;
+         }
+
+         const size_t blockBytes = bucket * cBucketBytes;
+
+         if ( slabRemaining_ < blockBytes )
+         {
+            slabs_.push_back( static_cast<char *>( ::operator new( cSlabBytes ) ) );
+            slabNext_ = slabs_.back();
+            slabRemaining_ = cSlabBytes;
+         }
+
+         void *memory = slabNext_;
+
+         slabNext_ += blockBytes;
+         slabRemaining_ -= blockBytes;
+
+         return memory;
+      }
+
+      void deallocate( void *memory, size_t byteCount )
+      {
+         const size_t bucket = ( byteCount + cBucketBytes - 1 ) / cBucketBytes;
+
+         std::lock_guard<std::mutex> lock( mutex_ );
+
+         auto block = static_cast<FreeBlock *>( memory );
+
+         block->next = freeLists_[bucket - 1];
+         freeLists_[bucket - 1] = block;
+      }
+
+   private:
+      struct FreeBlock
+      {
+         FreeBlock *next;
+      };
+
+      std::mutex mutex_;
+      FreeBlock *freeLists_[cBucketCount] = {};
+      std::vector<char *> slabs_;
+      char *slabNext_ = nullptr;
+      size_t slabRemaining_ = 0;
+   };
+
+   NodeMemoryPool &nodePool()
+   {
+      // Intentionally leaked: node handles held by the API user can be
+      // destroyed after static destructors have run.
+      static auto *pool = new NodeMemoryPool;
+
+      return *pool;
+   }
+}
+
+void *NodeImpl::operator new( size_t byteCount )
+{
+   if ( byteCount > cMaxPooledBytes )
+   {
+      return ::operator new( byteCount );
+   }
+
+   return nodePool().allocate( byteCount );
+}
+
+void NodeImpl::operator delete( void *memory, size_t byteCount )
+{
+   if ( memory == nullptr )
+   {
+      return;
+   }
+
+   if ( byteCount > cMaxPooledBytes )
+   {
+      ::operator delete( memory );
+      return;
+   }
+
+   nodePool().deallocate( memory, byteCount );
+}
+
 NodeImpl::NodeImpl( ImageFileImplWeakPtr destImageFile ) :
    destImageFile_( destImageFile ), isAttached_( false )
 {
@@ -72,6 +72,14 @@ namespace e57
 
       virtual ~NodeImpl() = default;
 
+      /// Node objects are small, numerous (one per XML element) and freed in
+      /// bursts when a file closes, so all subclasses allocate from a
+      /// recycling slab pool instead of the general heap. Allocation and
+      /// release become a free-list push/pop, which speeds up both parsing
+      /// the XML section and tearing the tree down.
+      static void *operator new( size_t byteCount );
+      static void operator delete( void *memory, size_t byteCount );
+
 #ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
       virtual void dump( int indent = 0, std::ostream &os = std::cout ) const;
 #endif
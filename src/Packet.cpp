@@ -25,39 +25,25 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <climits>
 #include <cstring>
 
 #include "CheckedFile.h"
+#include "MemoryBudgetImpl.h"
 #include "Packet.h"
+#include "TraceImpl.h"
 #include "StringFunctions.h"
 
-using namespace e57;
-
-struct IndexPacket
-{
-   static constexpr unsigned MAX_ENTRIES = 2048;
-
-   const uint8_t packetType = INDEX_PACKET;
-
-   uint8_t packetFlags = 0; // flag bitfields
-   uint16_t packetLogicalLengthMinus1 = 0;
-   uint16_t entryCount = 0;
-   uint8_t indexLevel = 0;
-   uint8_t reserved1[9] = {}; // must be zero
-
-   struct IndexPacketEntry
-   {
-      uint64_t chunkRecordNumber = 0;
-      uint64_t chunkPhysicalOffset = 0;
-   } entries[MAX_ENTRIES];
-
-   void verify( unsigned bufferLength = 0, uint64_t totalRecordCount = 0,
-                uint64_t fileSize = 0 ) const;
-
-#ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
-   void dump( int indent = 0, std::ostream &os = std::cout ) const;
+// The read-ahead thread needs its own file descriptor so it never disturbs
+// the CheckedFile it is warming the page cache for.
+#if defined( __linux__ ) || defined( __APPLE__ ) || defined( __FreeBSD__ ) || \
+   defined( __NetBSD__ ) || defined( __OpenBSD__ )
+#define E57_HAVE_READ_AHEAD
+#include <fcntl.h>
+#include <unistd.h>
 #endif
-};
+
+using namespace e57;
 
 struct EmptyPacketHeader
 {
@@ -83,6 +69,121 @@ PacketReadCache::PacketReadCache( CheckedFile *cFile, unsigned packetCount ) :
    {
       throw E57_EXCEPTION2( ErrorInternal, "packetCount=" + toString( packetCount ) );
    }
+
+   // Account-only: the entries are the reader's working set and can't be
+   // dropped, but opening many readers still pressures the shrinkable pools.
+   budgetId_ = MemoryBudgetImpl::instance().addParticipant( nullptr );
+   MemoryBudgetImpl::instance().charge( budgetId_, memoryBytes() );
+}
+
+PacketReadCache::~PacketReadCache()
+{
+   stopReadAhead();
+
+   MemoryBudgetImpl::instance().removeParticipant( budgetId_ );
+}
+
+void PacketReadCache::startReadAhead( uint64_t startLogicalOffset, uint64_t endLogicalOffset )
+{
+#if defined( E57_HAVE_READ_AHEAD )
+   // Only once, and only for real files
+   if ( readAheadThread_.joinable() || ( endLogicalOffset <= startLogicalOffset ) )
+   {
+      return;
+   }
+
+   const ustring fileName = cFile_->fileName();
+
+   if ( fileName == "<StreamBuffer>" )
+   {
+      return;
+   }
+
+   readAheadFd_ = ::open( fileName.c_str(), O_RDONLY );
+
+   if ( readAheadFd_ < 0 )
+   {
+      return;
+   }
+
+   readAheadPos_ = CheckedFile::logicalToPhysical( startLogicalOffset );
+   readAheadEnd_ = CheckedFile::logicalToPhysical( endLogicalOffset );
+   consumerPos_ = readAheadPos_;
+
+   readAheadThread_ = std::thread( &PacketReadCache::readAheadLoop, this );
+#else
+   UNUSED( startLogicalOffset );
+   UNUSED( endLogicalOffset );
+#endif
+}
+
+void PacketReadCache::stopReadAhead()
+{
+   if ( !readAheadThread_.joinable() )
+   {
+      return;
+   }
+
+   {
+      std::lock_guard<std::mutex> lock( readAheadMutex_ );
+      readAheadStop_ = true;
+   }
+
+   readAheadWake_.notify_all();
+   readAheadThread_.join();
+
+#if defined( E57_HAVE_READ_AHEAD )
+   if ( readAheadFd_ >= 0 )
+   {
+      ::close( readAheadFd_ );
+      readAheadFd_ = -1;
+   }
+#endif
+}
+
+void PacketReadCache::readAheadLoop()
+{
+#if defined( E57_HAVE_READ_AHEAD )
+   // Stay at most this far ahead of the consumer so partial reads don't drag
+   // the whole section through the page cache.
+   constexpr uint64_t cWindowSize = 8 * 1024 * 1024;
+   constexpr size_t cChunkSize = 256 * 1024;
+
+   std::vector<char> scratch( cChunkSize );
+
+   std::unique_lock<std::mutex> lock( readAheadMutex_ );
+
+   while ( !readAheadStop_ && ( readAheadPos_ < readAheadEnd_ ) )
+   {
+      readAheadWake_.wait( lock, [this] {
+         return readAheadStop_ || ( readAheadPos_ < consumerPos_ + cWindowSize );
+      } );
+
+      if ( readAheadStop_ )
+      {
+         return;
+      }
+
+      const uint64_t pos = readAheadPos_;
+      const auto count = static_cast<size_t>(
+         std::min( static_cast<uint64_t>( cChunkSize ), readAheadEnd_ - pos ) );
+
+      lock.unlock();
+
+      const ssize_t result =
+         ::pread( readAheadFd_, scratch.data(), count, static_cast<off_t>( pos ) );
+
+      lock.lock();
+
+      if ( result <= 0 )
+      {
+         // Nothing more we can do; the foreground reads will report any real error.
+         return;
+      }
+
+      readAheadPos_ += static_cast<uint64_t>( result );
+   }
+#endif
 }
 
 std::unique_ptr<PacketLock> PacketReadCache::lock( uint64_t packetLogicalOffset, char *&pkt )
@@ -105,6 +206,23 @@ std::unique_ptr<PacketLock> PacketReadCache::lock( uint64_t packetLogicalOffset,
                             "packetLogicalOffset=" + toString( packetLogicalOffset ) );
    }
 
+   // Tell the read-ahead thread how far the consumer has advanced
+   if ( readAheadThread_.joinable() )
+   {
+      {
+         std::lock_guard<std::mutex> lock( readAheadMutex_ );
+
+         const uint64_t physicalOffset = CheckedFile::logicalToPhysical( packetLogicalOffset );
+
+         if ( physicalOffset > consumerPos_ )
+         {
+            consumerPos_ = physicalOffset;
+         }
+      }
+
+      readAheadWake_.notify_one();
+   }
+
    // Linear scan for matching packet offset in cache
    for ( unsigned i = 0; i < entries_.size(); ++i )
    {
@@ -116,9 +234,41 @@ std::unique_ptr<PacketLock> PacketReadCache::lock( uint64_t packetLogicalOffset,
 #ifdef E57_VERBOSE
          std::cout << "  Found matching cache entry, index=" << i << std::endl;
 #endif
+         if ( stats_ != nullptr )
+         {
+            ++stats_->packetCacheHits;
+         }
+
          // Mark entry with current useCount (keeps track of age of entry).
          entry.lastUsed_ = ++useCount_;
 
+         // A re-used entry has proven itself; move it to the protected
+         // segment (capped at half the cache, demoting the oldest protected
+         // entry when full).
+         if ( !entry.isProtected_ )
+         {
+            if ( ( protectedCount_ > 0 ) && ( protectedCount_ >= entries_.size() / 2 ) )
+            {
+               unsigned oldestProtected = 0;
+               unsigned oldestUsed = UINT_MAX;
+
+               for ( unsigned j = 0; j < entries_.size(); ++j )
+               {
+                  if ( entries_[j].isProtected_ && entries_[j].lastUsed_ < oldestUsed )
+                  {
+                     oldestProtected = j;
+                     oldestUsed = entries_[j].lastUsed_;
+                  }
+               }
+
+               entries_[oldestProtected].isProtected_ = false;
+               --protectedCount_;
+            }
+
+            entry.isProtected_ = true;
+            ++protectedCount_;
+         }
+
          // Publish buffer address to caller
          pkt = entry.buffer_;
 
@@ -133,24 +283,51 @@ std::unique_ptr<PacketLock> PacketReadCache::lock( uint64_t packetLogicalOffset,
    }
    // Get here if didn't find a match already in cache.
 
-   // Find least recently used (LRU) packet buffer
+   // Find the least recently used (LRU) probationary packet buffer; fall
+   // back to the overall LRU entry when the whole cache is protected.
    unsigned oldestEntry = 0;
-   unsigned oldestUsed = entries_.at( 0 ).lastUsed_;
+   unsigned oldestUsed = UINT_MAX;
 
    for ( unsigned i = 0; i < entries_.size(); ++i )
    {
       const auto &entry = entries_[i];
 
-      if ( entry.lastUsed_ < oldestUsed )
+      if ( !entry.isProtected_ && ( entry.lastUsed_ < oldestUsed ) )
       {
          oldestEntry = i;
          oldestUsed = entry.lastUsed_;
       }
    }
+
+   if ( oldestUsed == UINT_MAX )
+   {
+      for ( unsigned i = 0; i < entries_.size(); ++i )
+      {
+         const auto &entry = entries_[i];
+
+         if ( entry.lastUsed_ < oldestUsed )
+         {
+            oldestEntry = i;
+            oldestUsed = entry.lastUsed_;
+         }
+      }
+   }
+
+   // The incoming packet starts in the probationary segment
+   if ( entries_[oldestEntry].isProtected_ )
+   {
+      entries_[oldestEntry].isProtected_ = false;
+      --protectedCount_;
+   }
 #ifdef E57_VERBOSE
    std::cout << "  Oldest entry=" << oldestEntry << " lastUsed=" << oldestUsed << std::endl;
 #endif
 
+   if ( stats_ != nullptr )
+   {
+      ++stats_->packetCacheMisses;
+   }
+
    readPacket( oldestEntry, packetLogicalOffset );
 
    // Publish buffer address to caller
@@ -184,6 +361,8 @@ void PacketReadCache::unlock( unsigned cacheIndex )
 
 void PacketReadCache::readPacket( unsigned oldestEntry, uint64_t packetLogicalOffset )
 {
+   E57_TRACE_SPAN( "packetFetch" );
+
 #ifdef E57_VERBOSE
    std::cout << "PacketReadCache::readPacket() called, oldestEntry=" << oldestEntry
              << " packetLogicalOffset=" << packetLogicalOffset << std::endl;
@@ -193,8 +372,7 @@ void PacketReadCache::readPacket( unsigned oldestEntry, uint64_t packetLogicalOf
    // common to all packets.
    EmptyPacketHeader header;
 
-   cFile_->seek( packetLogicalOffset, CheckedFile::Logical );
-   cFile_->read( reinterpret_cast<char *>( &header ), sizeof( header ) );
+   fetchAt( packetLogicalOffset, reinterpret_cast<char *>( &header ), sizeof( header ) );
 
    // Can't verify packet header here, because it is not really an EmptyPacketHeader.
    unsigned packetLength = header.packetLogicalLengthMinus1 + 1;
@@ -208,8 +386,7 @@ void PacketReadCache::readPacket( unsigned oldestEntry, uint64_t packetLogicalOf
    auto &entry = entries_.at( oldestEntry );
 
    // Now read in whole packet into preallocated buffer_.  Note buffer is
-   cFile_->seek( packetLogicalOffset, CheckedFile::Logical );
-   cFile_->read( entry.buffer_, packetLength );
+   fetchAt( packetLogicalOffset, entry.buffer_, packetLength );
 
    // Verify that packet is good.
    switch ( header.packetType )
@@ -218,7 +395,15 @@ void PacketReadCache::readPacket( unsigned oldestEntry, uint64_t packetLogicalOf
       {
          auto dpkt = reinterpret_cast<DataPacket *>( entry.buffer_ );
 
+#if VALIDATE_DEEP
          dpkt->verify( packetLength );
+#else
+         // Only pay for the fixed-cost header checks at cache-fill time.
+         // Each bytestream's boundaries are resolved and bounds checked on
+         // first access (in getBytestream), so a selective read that skips
+         // most streams never walks their length headers at all.
+         dpkt->header.verify( packetLength );
+#endif
 #ifdef E57_VERBOSE
          std::cout << "  data packet:" << std::endl;
          dpkt->dump( 4 ); //???
@@ -258,6 +443,50 @@ void PacketReadCache::readPacket( unsigned oldestEntry, uint64_t packetLogicalOf
    entry.lastUsed_ = ++useCount_;
 }
 
+void PacketReadCache::setFetchUnit( size_t unitBytes )
+{
+   fetchUnitBytes_ = unitBytes;
+
+   // Invalidate the window; the next miss refills it at the new size.
+   fetchLength_ = 0;
+}
+
+void PacketReadCache::fetchAt( uint64_t logicalOffset, char *buf, size_t count )
+{
+   if ( fetchUnitBytes_ <= DATA_PACKET_MAX )
+   {
+      // Use the atomic positional read, so several readers (one per thread)
+      // can share the CheckedFile without racing on its cursor.
+      cFile_->readAt( logicalOffset, buf, count );
+      return;
+   }
+
+   // Refill the fetch window when the requested range isn't fully inside it
+   if ( ( logicalOffset < fetchLogicalOffset_ ) ||
+        ( logicalOffset + count > fetchLogicalOffset_ + fetchLength_ ) )
+   {
+      const uint64_t cFileLength = cFile_->length( CheckedFile::Logical );
+      const size_t readLength = static_cast<size_t>(
+         std::min<uint64_t>( fetchUnitBytes_, cFileLength - logicalOffset ) );
+
+      // Be paranoid: a range past the end of the file is a corrupt packet;
+      // let the plain read throw the usual error.
+      if ( readLength < count )
+      {
+         cFile_->readAt( logicalOffset, buf, count );
+         return;
+      }
+
+      fetchBuffer_.resize( fetchUnitBytes_ );
+      cFile_->readAt( logicalOffset, fetchBuffer_.data(), readLength );
+
+      fetchLogicalOffset_ = logicalOffset;
+      fetchLength_ = readLength;
+   }
+
+   memcpy( buf, fetchBuffer_.data() + ( logicalOffset - fetchLogicalOffset_ ), count );
+}
+
 #ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
 void PacketReadCache::dump( int indent, std::ostream &os )
 {
@@ -413,6 +642,10 @@ DataPacket::DataPacket()
    static_assert( sizeof( DataPacket ) == ( 64 * 1024 ), "Unexpected size of DataPacket" );
 }
 
+// Full layout check: walks every bytestream length header and the trailing
+// padding.  The writer runs this on each packet it builds; the reader only
+// runs it when E57_VALIDATION_LEVEL is deep, and otherwise defers per-stream
+// boundary checks to getBytestream().
 void DataPacket::verify( unsigned bufferLength ) const
 {
    //??? do all packets need versions?  how extend without breaking older
@@ -491,15 +724,18 @@ char *DataPacket::getBytestream( unsigned bytestreamNumber, unsigned &byteCount
 
    byteCount = bsbLength[bytestreamNumber];
 
-   // Double check buffer is completely within packet
+   // Check buffer is completely within packet.  On the read path this is the
+   // first time this stream's boundaries are validated (the cache-fill check
+   // is header-only), so a bad length here means a corrupt packet.
    if ( ( sizeof( DataPacketHeader ) + 2 * header.bytestreamCount + totalPreceeding + byteCount ) >
         header.packetLogicalLengthMinus1 + 1U )
    {
-      throw E57_EXCEPTION2( ErrorInternal, "bytestreamCount=" + toString( header.bytestreamCount ) +
-                                              " totalPreceeding=" + toString( totalPreceeding ) +
-                                              " byteCount=" + toString( byteCount ) +
-                                              " packetLogicalLengthMinus1=" +
-                                              toString( header.packetLogicalLengthMinus1 ) );
+      throw E57_EXCEPTION2( ErrorBadCVPacket,
+                            "bytestreamCount=" + toString( header.bytestreamCount ) +
+                               " totalPreceeding=" + toString( totalPreceeding ) +
+                               " byteCount=" + toString( byteCount ) +
+                               " packetLogicalLengthMinus1=" +
+                               toString( header.packetLogicalLengthMinus1 ) );
    }
 
    // Return start of buffer
@@ -569,9 +805,10 @@ void IndexPacket::verify( unsigned bufferLength, uint64_t totalRecordCount,
       throw E57_EXCEPTION2( ErrorBadCVPacket, "packetType=" + toString( packetType ) );
    }
 
-   // Check packetLength is at least large enough to hold header
+   // Check packetLength is at least large enough to hold header (the entries
+   // array is only as long as entryCount says, so don't require all of it)
    unsigned packetLength = packetLogicalLengthMinus1 + 1;
-   if ( packetLength < sizeof( *this ) )
+   if ( packetLength < sizeof( *this ) - sizeof( entries ) )
    {
       throw E57_EXCEPTION2( ErrorBadCVPacket, "packetLength=" + toString( packetLength ) );
    }
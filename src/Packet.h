@@ -27,7 +27,11 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 #include "Common.h"
@@ -52,10 +56,37 @@ namespace e57
    {
    public:
       PacketReadCache( CheckedFile *cFile, unsigned packetCount );
+      ~PacketReadCache();
 
       std::unique_ptr<PacketLock> lock( uint64_t packetLogicalOffset,
                                         char *&pkt ); //??? pkt could be const
 
+      /// Counter block for cache hits/misses, or nullptr to collect nothing
+      /// (see ImageFile::stats())
+      void setStatsData( ImageFileStatsData *stats )
+      {
+         stats_ = stats;
+      }
+
+      /// Start a background thread which reads the given logical range of the
+      /// file ahead of the consumer to warm the OS page cache. Misses in
+      /// lock() then hit memory instead of stalling on the device. No-op for
+      /// in-memory files or platforms without support.
+      void startReadAhead( uint64_t startLogicalOffset, uint64_t endLogicalOffset );
+
+      /// Fetch cache misses in aligned units of the given size instead of
+      /// packet by packet, serving later misses inside the unit from memory.
+      /// Sized for high-latency storage (see ImageFile::ioUnitSetSize); 0
+      /// (the default) reads one packet per miss.
+      void setFetchUnit( size_t unitBytes );
+
+      /// Bytes held by the cache entries, fixed at construction and
+      /// accounted with the process-wide memory budget
+      uint64_t memoryBytes() const
+      {
+         return static_cast<uint64_t>( entries_.size() ) * sizeof( CacheEntry );
+      }
+
 #ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
       void dump( int indent = 0, std::ostream &os = std::cout );
 #endif
@@ -73,13 +104,48 @@ namespace e57
          uint64_t logicalOffset_ = 0;
          char buffer_[DATA_PACKET_MAX]; // No need to init since it's a data buffer
          unsigned lastUsed_ = 0;
+
+         // Segmented LRU: entries start probationary and are promoted on
+         // their first re-use. Eviction prefers probationary entries, so a
+         // sequential scan (which touches each packet once) can't flush
+         // packets that are hit repeatedly, like index packets.
+         bool isProtected_ = false;
       };
 
       unsigned lockCount_ = 0;
       unsigned useCount_ = 0;
+      unsigned protectedCount_ = 0;
       CheckedFile *cFile_ = nullptr;
+      ImageFileStatsData *stats_ = nullptr;
 
       std::vector<CacheEntry> entries_;
+
+   private:
+      void fetchAt( uint64_t logicalOffset, char *buf, size_t count );
+
+      void readAheadLoop();
+      void stopReadAhead();
+
+      // Account with the process-wide memory budget (see memoryBytes)
+      uint64_t budgetId_ = 0;
+
+      // Large-unit fetch window (setFetchUnit); offsets are logical
+      size_t fetchUnitBytes_ = 0;
+      std::vector<char> fetchBuffer_;
+      uint64_t fetchLogicalOffset_ = 0;
+      size_t fetchLength_ = 0;
+
+      // Read-ahead state; offsets are physical. The thread reads its own file
+      // descriptor, staying a bounded window ahead of the last offset
+      // requested through lock().
+      std::thread readAheadThread_;
+      std::mutex readAheadMutex_;
+      std::condition_variable readAheadWake_;
+      uint64_t readAheadPos_ = 0;
+      uint64_t readAheadEnd_ = 0;
+      uint64_t consumerPos_ = 0;
+      bool readAheadStop_ = false;
+      int readAheadFd_ = -1;
    };
 
    class PacketLock
@@ -139,4 +205,30 @@ namespace e57
 
       uint8_t payload[PayloadSize]; // No need to init since it's a data buffer
    };
+
+   struct IndexPacket
+   {
+      static constexpr unsigned MAX_ENTRIES = 2048;
+
+      const uint8_t packetType = INDEX_PACKET;
+
+      uint8_t packetFlags = 0; // flag bitfields
+      uint16_t packetLogicalLengthMinus1 = 0;
+      uint16_t entryCount = 0;
+      uint8_t indexLevel = 0;
+      uint8_t reserved1[9] = {}; // must be zero
+
+      struct IndexPacketEntry
+      {
+         uint64_t chunkRecordNumber = 0;
+         uint64_t chunkPhysicalOffset = 0;
+      } entries[MAX_ENTRIES];
+
+      void verify( unsigned bufferLength = 0, uint64_t totalRecordCount = 0,
+                   uint64_t fileSize = 0 ) const;
+
+#ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
+      void dump( int indent = 0, std::ostream &os = std::cout ) const;
+#endif
+   };
 }
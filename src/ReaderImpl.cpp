@@ -26,64 +26,14 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
+
 #include "ReaderImpl.h"
 #include "Common.h"
 #include "StringFunctions.h"
 
 namespace e57
 {
-   /*!
-   @brief Reads the data out of a given image node
-
-   @param [in] image 1 of 3 projects or the visual
-   @param [in] imageType identifies the image format desired.
-   @param [out] pBuffer pointer the buffer
-   @param [out] start position in the block to start reading
-   @param [out] count size of desired chunk or buffer size
-
-   @return number of bytes read
-   */
-   size_t _readImage2DNode( const StructureNode &image, Image2DType imageType, uint8_t *pBuffer,
-                            int64_t start, size_t count )
-   {
-      size_t transferred = 0;
-
-      switch ( imageType )
-      {
-         case ImageNone:
-            return 0;
-
-         case ImageJPEG:
-            if ( image.isDefined( "jpegImage" ) )
-            {
-               BlobNode jpegImage( image.get( "jpegImage" ) );
-               jpegImage.read( pBuffer, start, count );
-               transferred = count;
-            }
-            break;
-
-         case ImagePNG:
-            if ( image.isDefined( "pngImage" ) )
-            {
-               BlobNode pngImage( image.get( "pngImage" ) );
-               pngImage.read( pBuffer, start, count );
-               transferred = count;
-            }
-            break;
-
-         case ImageMaskPNG:
-            if ( image.isDefined( "imageMask" ) )
-            {
-               BlobNode imageMask( image.get( "imageMask" ) );
-               imageMask.read( pBuffer, start, count );
-               transferred = count;
-            }
-            break;
-      }
-
-      return transferred;
-   }
-
    /*!
    @brief This function reads one of the image blobs
 
@@ -189,10 +139,14 @@ namespace e57
    }
 
    ReaderImpl::ReaderImpl( const ustring &filePath, const ReaderOptions &options ) :
-      imf_( filePath, "r", options.checksumPolicy ), root_( imf_.root() ),
+      imf_( filePath, "r", options.headerOnly ? ChecksumNone : options.checksumPolicy ), root_( imf_.root() ),
       data3D_( root_.get( "/data3D" ) ),
       images2D_( root_.isDefined( "/images2D" ) ? root_.get( "/images2D" ) : VectorNode( imf_ ) )
    {
+      if ( options.pinDecodeWorkers )
+      {
+         imf_.decodeSetPinWorkers( true );
+      }
    }
 
    ReaderImpl::~ReaderImpl()
@@ -201,6 +155,12 @@ namespace e57
       {
          Close();
       }
+
+      // Close() joins it while open; this covers a reader that never opened
+      if ( imageReadThread_.joinable() )
+      {
+         imageReadThread_.join();
+      }
    }
 
    bool ReaderImpl::IsOpen() const
@@ -215,6 +175,13 @@ namespace e57
          return false;
       }
 
+      // Let any outstanding image batch finish, so its futures are all ready
+      // before the file closes under them
+      if ( imageReadThread_.joinable() )
+      {
+         imageReadThread_.join();
+      }
+
       imf_.close();
       return true;
    }
@@ -552,65 +519,204 @@ namespace e57
    }
 
    // Reads the image data block
-   size_t ReaderImpl::ReadImage2DData( int64_t imageIndex, Image2DProjection imageProjection,
-                                       Image2DType imageType, uint8_t *pBuffer, int64_t start,
-                                       size_t count ) const
+   std::unique_ptr<BlobNode> ReaderImpl::FindImage2DBlob( int64_t imageIndex,
+                                                          Image2DProjection imageProjection,
+                                                          Image2DType imageType ) const
    {
       if ( ( imageIndex < 0 ) || ( imageIndex >= images2D_.childCount() ) )
       {
-         return 0;
+         return nullptr;
       }
 
       const StructureNode image( images2D_.get( imageIndex ) );
 
+      const char *representationName = nullptr;
+
       switch ( imageProjection )
       {
          case ProjectionNone:
-            return 0;
+            return nullptr;
 
          case ProjectionVisual:
-            if ( image.isDefined( "visualReferenceRepresentation" ) )
-            {
-               const StructureNode visualReferenceRepresentation(
-                  image.get( "visualReferenceRepresentation" ) );
-
-               return _readImage2DNode( visualReferenceRepresentation, imageType, pBuffer, start,
-                                        count );
-            }
+            representationName = "visualReferenceRepresentation";
             break;
 
          case ProjectionPinhole:
-            if ( image.isDefined( "pinholeRepresentation" ) )
-            {
-               const StructureNode pinholeRepresentation( image.get( "pinholeRepresentation" ) );
-
-               return _readImage2DNode( pinholeRepresentation, imageType, pBuffer, start, count );
-            }
+            representationName = "pinholeRepresentation";
             break;
 
          case ProjectionSpherical:
-            if ( image.isDefined( "sphericalRepresentation" ) )
-            {
-               const StructureNode sphericalRepresentation(
-                  image.get( "sphericalRepresentation" ) );
-
-               return _readImage2DNode( sphericalRepresentation, imageType, pBuffer, start, count );
-            }
+            representationName = "sphericalRepresentation";
             break;
 
          case ProjectionCylindrical:
-            if ( image.isDefined( "cylindricalRepresentation" ) )
-            {
-               const StructureNode cylindricalRepresentation(
-                  image.get( "cylindricalRepresentation" ) );
+            representationName = "cylindricalRepresentation";
+            break;
+      }
 
-               return _readImage2DNode( cylindricalRepresentation, imageType, pBuffer, start,
-                                        count );
-            }
+      if ( ( representationName == nullptr ) || !image.isDefined( representationName ) )
+      {
+         return nullptr;
+      }
+
+      const StructureNode representation( image.get( representationName ) );
+
+      const char *blobName = nullptr;
+
+      switch ( imageType )
+      {
+         case ImageNone:
+            return nullptr;
+
+         case ImageJPEG:
+            blobName = "jpegImage";
+            break;
+
+         case ImagePNG:
+            blobName = "pngImage";
+            break;
+
+         case ImageMaskPNG:
+            blobName = "imageMask";
             break;
       }
 
-      return 0;
+      if ( ( blobName == nullptr ) || !representation.isDefined( blobName ) )
+      {
+         return nullptr;
+      }
+
+      return std::unique_ptr<BlobNode>( new BlobNode( representation.get( blobName ) ) );
+   }
+
+   int64_t ReaderImpl::GetImage2DDataSize( int64_t imageIndex, Image2DProjection imageProjection,
+                                           Image2DType imageType ) const
+   {
+      std::unique_ptr<BlobNode> blob = FindImage2DBlob( imageIndex, imageProjection, imageType );
+
+      if ( !blob )
+      {
+         return 0;
+      }
+
+      return blob->byteCount();
+   }
+
+   // Clamps a blob range read to what the blob actually holds, so a fixed-size
+   // partial fetch (e.g. the first 16KB of a progressive JPEG for a preview)
+   // works on images of any size. Returns the number of bytes to read.
+   static size_t _clampBlobRead( const BlobNode &blob, int64_t start, size_t count )
+   {
+      const int64_t cByteCount = blob.byteCount();
+
+      if ( ( start < 0 ) || ( start >= cByteCount ) )
+      {
+         return 0;
+      }
+
+      return std::min( count, static_cast<size_t>( cByteCount - start ) );
+   }
+
+   size_t ReaderImpl::ReadImage2DData( int64_t imageIndex, Image2DProjection imageProjection,
+                                       Image2DType imageType, uint8_t *pBuffer, int64_t start,
+                                       size_t count ) const
+   {
+      std::unique_ptr<BlobNode> blob = FindImage2DBlob( imageIndex, imageProjection, imageType );
+
+      if ( !blob )
+      {
+         return 0;
+      }
+
+      count = _clampBlobRead( *blob, start, count );
+
+      if ( count > 0 )
+      {
+         blob->read( pBuffer, start, count );
+      }
+
+      return count;
+   }
+
+   std::vector<std::future<int64_t>>
+   ReaderImpl::ReadImage2DDataAsync( const std::vector<Image2DDataRequest> &requests ) const
+   {
+      // One batch at a time; wait out any previous batch's thread
+      if ( imageReadThread_.joinable() )
+      {
+         imageReadThread_.join();
+      }
+
+      struct PendingRead
+      {
+         std::promise<int64_t> promise;
+         std::unique_ptr<BlobNode> blob;
+         uint8_t *buffer;
+         int64_t start;
+         size_t count;
+      };
+
+      auto pending = std::make_shared<std::vector<PendingRead>>();
+      pending->reserve( requests.size() );
+
+      std::vector<std::future<int64_t>> futures;
+      futures.reserve( requests.size() );
+
+      for ( const Image2DDataRequest &request : requests )
+      {
+         PendingRead read;
+
+         read.blob = FindImage2DBlob( request.imageIndex, request.imageProjection,
+                                      request.imageType );
+         read.buffer = static_cast<uint8_t *>( request.buffer );
+         read.start = request.start;
+         read.count = static_cast<size_t>( request.count );
+
+         futures.push_back( read.promise.get_future() );
+
+         if ( !read.blob )
+         {
+            // Same answer the synchronous call gives for a representation
+            // the image doesn't carry
+            read.promise.set_value( 0 );
+            continue;
+         }
+
+         read.count = _clampBlobRead( *read.blob, read.start, read.count );
+
+         if ( read.count == 0 )
+         {
+            read.promise.set_value( 0 );
+            continue;
+         }
+
+         pending->push_back( std::move( read ) );
+      }
+
+      if ( pending->empty() )
+      {
+         return futures;
+      }
+
+      // All node resolution happened above on the caller's thread; the batch
+      // thread only calls BlobNode::read, whose one atomic bulk read is safe
+      // alongside any other reads of the file.
+      imageReadThread_ = std::thread( [pending]() {
+         for ( PendingRead &read : *pending )
+         {
+            try
+            {
+               read.blob->read( read.buffer, read.start, read.count );
+               read.promise.set_value( static_cast<int64_t>( read.count ) );
+            }
+            catch ( ... )
+            {
+               read.promise.set_exception( std::current_exception() );
+            }
+         }
+      } );
+
+      return futures;
    }
 
    bool ReaderImpl::ReadData3D( int64_t dataIndex, Data3D &data3DHeader ) const
@@ -620,8 +726,31 @@ namespace e57
          return false;
       }
 
-      data3DHeader = {};
+      if ( cachedData3DHeaders_.size() != static_cast<size_t>( data3D_.childCount() ) )
+      {
+         cachedData3DHeaders_.resize( static_cast<size_t>( data3D_.childCount() ) );
+      }
+
+      auto &cached = cachedData3DHeaders_[static_cast<size_t>( dataIndex )];
+
+      if ( !cached )
+      {
+         // Parse into a local first so a throw doesn't leave a half-filled
+         // header in the cache.
+         std::unique_ptr<Data3D> header( new Data3D );
+
+         ParseData3DHeader( dataIndex, *header );
+
+         cached = std::move( header );
+      }
+
+      data3DHeader = *cached;
 
+      return true;
+   }
+
+   void ReaderImpl::ParseData3DHeader( int64_t dataIndex, Data3D &data3DHeader ) const
+   {
       const StructureNode scan( data3D_.get( dataIndex ) );
       CompressedVectorNode points( scan.get( "points" ) );
       const StructureNode proto( points.prototype() );
@@ -1356,8 +1485,6 @@ namespace e57
          data3DHeader.pointFields.normalYField = proto.isDefined( "nor:normalY" );
          data3DHeader.pointFields.normalZField = proto.isDefined( "nor:normalZ" );
       }
-
-      return true;
    }
 
    // This function returns the size of the point data
@@ -1365,8 +1492,6 @@ namespace e57
                                     int64_t &pointsSize, int64_t &groupsSize, int64_t &countSize,
                                     bool &bColumnIndex ) const
    {
-      int64_t elementSize = 0;
-
       row = 0;
       column = 0;
       pointsSize = 0;
@@ -1379,10 +1504,42 @@ namespace e57
          return false;
       }
 
+      if ( cachedData3DSizes_.size() != static_cast<size_t>( data3D_.childCount() ) )
+      {
+         cachedData3DSizes_.resize( static_cast<size_t>( data3D_.childCount() ) );
+      }
+
+      auto &cached = cachedData3DSizes_[static_cast<size_t>( dataIndex )];
+
+      if ( !cached )
+      {
+         // Compute into a local first so a throw doesn't leave half-filled
+         // sizes in the cache.
+         std::unique_ptr<Data3DSizes> sizes( new Data3DSizes );
+
+         ParseData3DSizes( dataIndex, *sizes );
+
+         cached = std::move( sizes );
+      }
+
+      row = cached->row;
+      column = cached->column;
+      pointsSize = cached->pointsSize;
+      groupsSize = cached->groupsSize;
+      countSize = cached->countSize;
+      bColumnIndex = cached->columnIndex;
+
+      return true;
+   }
+
+   void ReaderImpl::ParseData3DSizes( int64_t dataIndex, Data3DSizes &sizes ) const
+   {
+      int64_t elementSize = 0;
+
       const StructureNode scan( data3D_.get( dataIndex ) );
       const CompressedVectorNode points( scan.get( "points" ) );
 
-      pointsSize = points.childCount();
+      sizes.pointsSize = points.childCount();
 
       if ( scan.isDefined( "indexBounds" ) )
       {
@@ -1390,14 +1547,14 @@ namespace e57
 
          if ( indexBounds.isDefined( "columnMaximum" ) )
          {
-            column = IntegerNode( indexBounds.get( "columnMaximum" ) ).value() -
-                     IntegerNode( indexBounds.get( "columnMinimum" ) ).value() + 1;
+            sizes.column = IntegerNode( indexBounds.get( "columnMaximum" ) ).value() -
+                           IntegerNode( indexBounds.get( "columnMinimum" ) ).value() + 1;
          }
 
          if ( indexBounds.isDefined( "rowMaximum" ) )
          {
-            row = IntegerNode( indexBounds.get( "rowMaximum" ) ).value() -
-                  IntegerNode( indexBounds.get( "rowMinimum" ) ).value() + 1;
+            sizes.row = IntegerNode( indexBounds.get( "rowMaximum" ) ).value() -
+                        IntegerNode( indexBounds.get( "rowMinimum" ) ).value() + 1;
          }
       }
 
@@ -1412,13 +1569,13 @@ namespace e57
 
             if ( idElementName.value() == "columnIndex" )
             {
-               bColumnIndex = true;
+               sizes.columnIndex = true;
             }
 
             const CompressedVectorNode groups( groupingByLine.get( "groups" ) );
             const StructureNode lineGroupRecord( groups.prototype() );
 
-            groupsSize = groups.childCount();
+            sizes.groupsSize = groups.childCount();
 
             if ( lineGroupRecord.isDefined( "idElementValue" ) )
             {
@@ -1426,55 +1583,53 @@ namespace e57
 
                elementSize = integerIDElementValue.maximum() - integerIDElementValue.minimum() + 1;
             }
-            else if ( bColumnIndex )
+            else if ( sizes.columnIndex )
             {
-               elementSize = column;
+               elementSize = sizes.column;
             }
             else
             {
-               elementSize = row;
+               elementSize = sizes.row;
             }
 
             if ( lineGroupRecord.isDefined( "pointCount" ) )
             {
-               countSize = IntegerNode( lineGroupRecord.get( "pointCount" ) ).maximum();
+               sizes.countSize = IntegerNode( lineGroupRecord.get( "pointCount" ) ).maximum();
             }
-            else if ( bColumnIndex )
+            else if ( sizes.columnIndex )
             {
-               countSize = row;
+               sizes.countSize = sizes.row;
             }
             else
             {
-               countSize = column;
+               sizes.countSize = sizes.column;
             }
          }
       }
 
       // if indexBounds is not given
-      if ( row == 0 )
+      if ( sizes.row == 0 )
       {
-         if ( bColumnIndex )
+         if ( sizes.columnIndex )
          {
-            row = countSize;
+            sizes.row = sizes.countSize;
          }
          else
          {
-            row = elementSize;
+            sizes.row = elementSize;
          }
       }
-      if ( column == 0 )
+      if ( sizes.column == 0 )
       {
-         if ( bColumnIndex )
+         if ( sizes.columnIndex )
          {
-            column = elementSize;
+            sizes.column = elementSize;
          }
          else
          {
-            column = countSize;
+            sizes.column = sizes.countSize;
          }
       }
-
-      return true;
    }
 
    // Reads the group data
@@ -1540,6 +1695,105 @@ namespace e57
       return true;
    }
 
+   bool ReaderImpl::DetectGridOrdering( int64_t dataIndex, const StructureNode &scan,
+                                        const CompressedVectorNode &points, int64_t &rowMinimum,
+                                        int64_t &columnMinimum, int64_t &lineLength,
+                                        bool &byColumn ) const
+   {
+      if ( !scan.isDefined( "indexBounds" ) ||
+           !scan.isDefined( "pointGroupingSchemes/groupingByLine" ) )
+      {
+         return false;
+      }
+
+      const StructureNode indexBounds( scan.get( "indexBounds" ) );
+
+      if ( !indexBounds.isDefined( "rowMinimum" ) || !indexBounds.isDefined( "rowMaximum" ) ||
+           !indexBounds.isDefined( "columnMinimum" ) || !indexBounds.isDefined( "columnMaximum" ) )
+      {
+         return false;
+      }
+
+      rowMinimum = IntegerNode( indexBounds.get( "rowMinimum" ) ).value();
+      columnMinimum = IntegerNode( indexBounds.get( "columnMinimum" ) ).value();
+
+      const int64_t cRowCount =
+         IntegerNode( indexBounds.get( "rowMaximum" ) ).value() - rowMinimum + 1;
+      const int64_t cColumnCount =
+         IntegerNode( indexBounds.get( "columnMaximum" ) ).value() - columnMinimum + 1;
+
+      if ( ( cRowCount < 1 ) || ( cColumnCount < 1 ) )
+      {
+         return false;
+      }
+
+      const StructureNode groupingByLine( scan.get( "pointGroupingSchemes/groupingByLine" ) );
+      const ustring cIdElementName = StringNode( groupingByLine.get( "idElementName" ) ).value();
+
+      int64_t lineCount = 0;
+      int64_t idMinimum = 0;
+
+      if ( cIdElementName == "columnIndex" )
+      {
+         // Each line is one column; the row index varies within a line
+         byColumn = true;
+         lineLength = cRowCount;
+         lineCount = cColumnCount;
+         idMinimum = columnMinimum;
+      }
+      else if ( cIdElementName == "rowIndex" )
+      {
+         byColumn = false;
+         lineLength = cColumnCount;
+         lineCount = cRowCount;
+         idMinimum = rowMinimum;
+      }
+      else
+      {
+         return false;
+      }
+
+      // A complete raster: every cell of the grid is a record
+      if ( points.childCount() != lineLength * lineCount )
+      {
+         return false;
+      }
+
+      const CompressedVectorNode groups( groupingByLine.get( "groups" ) );
+
+      if ( groups.childCount() != lineCount )
+      {
+         return false;
+      }
+
+      // The synthesized indexes assume the lines are complete and stored
+      // contiguously in id order; verify against the line groups. This is a
+      // decode, but of thousands of group records, not millions of points.
+      std::vector<int64_t> idElementValue( static_cast<size_t>( lineCount ) );
+      std::vector<int64_t> startPointIndex( static_cast<size_t>( lineCount ) );
+      std::vector<int64_t> pointCount( static_cast<size_t>( lineCount ) );
+
+      if ( !ReadData3DGroupsData( dataIndex, lineCount, idElementValue.data(),
+                                  startPointIndex.data(), pointCount.data() ) )
+      {
+         return false;
+      }
+
+      for ( int64_t g = 0; g < lineCount; g++ )
+      {
+         const auto cIndex = static_cast<size_t>( g );
+
+         if ( ( idElementValue[cIndex] != idMinimum + g ) ||
+              ( startPointIndex[cIndex] != g * lineLength ) ||
+              ( pointCount[cIndex] != lineLength ) )
+         {
+            return false;
+         }
+      }
+
+      return true;
+   }
+
    template <typename COORDTYPE>
    CompressedVectorReader ReaderImpl::SetUpData3DPointsData(
       int64_t dataIndex, size_t count, const Data3DPointsData_t<COORDTYPE> &buffers ) const
@@ -1550,11 +1804,58 @@ namespace e57
       CompressedVectorNode points( scan.get( "points" ) );
       const StructureNode proto( points.prototype() );
       const int64_t protoCount = proto.childCount();
+
+      // Collect the prototype field names once; they drive the buffer
+      // selection below and double as the reuse key.
+      std::vector<ustring> protoNames;
+      protoNames.reserve( static_cast<size_t>( protoCount ) );
+
+      for ( int64_t protoIndex = 0; protoIndex < protoCount; protoIndex++ )
+      {
+         protoNames.push_back( proto.get( protoIndex ).elementName() );
+      }
+
+      // Same buffers, capacity and prototype as the previous call? Reuse the
+      // SourceDestBuffers built then instead of setting them up again. A
+      // cache built with grid synthesis skipped the index channels, which is
+      // only right for the scan the raster was verified on.
+      if ( ( cachedBuffersId_ == &buffers ) && ( cachedCoordSize_ == sizeof( COORDTYPE ) ) &&
+           ( cachedCount_ == count ) && ( cachedProtoNames_ == protoNames ) &&
+           ( !cachedGridSynthesis_ || ( cachedGridDataIndex_ == dataIndex ) ) )
+      {
+         CompressedVectorReader reader = points.reader( cachedDestBuffers_ );
+
+         if ( cachedGridSynthesis_ )
+         {
+            reader.setGridSynthesis( cachedGridRowMinimum_, cachedGridColumnMinimum_,
+                                     cachedGridLineLength_, cachedGridByColumn_ );
+         }
+
+         return reader;
+      }
+
+      // Gridded fast path: when the header pins the raster down exactly, the
+      // rowIndex/columnIndex channels (two of the widest on structured
+      // scans) are not decoded at all; the reader synthesizes the indexes
+      // from the record number instead.
+      bool gridSynthesis = false;
+      int64_t gridRowMinimum = 0;
+      int64_t gridColumnMinimum = 0;
+      int64_t gridLineLength = 0;
+      bool gridByColumn = false;
+
+      if ( ( buffers.rowIndex != nullptr ) && ( buffers.columnIndex != nullptr ) &&
+           proto.isDefined( "rowIndex" ) && proto.isDefined( "columnIndex" ) )
+      {
+         gridSynthesis = DetectGridOrdering( dataIndex, scan, points, gridRowMinimum,
+                                             gridColumnMinimum, gridLineLength, gridByColumn );
+      }
+
       std::vector<SourceDestBuffer> destBuffers;
 
       for ( int64_t protoIndex = 0; protoIndex < protoCount; protoIndex++ )
       {
-         const ustring name = proto.get( protoIndex ).elementName();
+         const ustring &name = protoNames.at( static_cast<size_t>( protoIndex ) );
          const NodeType type = proto.get( protoIndex ).type();
          const bool scaled = ( type == TypeScaledInteger );
 
@@ -1688,8 +1989,36 @@ namespace e57
          }
       }
 
+      // Synthesis needs at least one decoded field to drive the read; a
+      // caller asking only for the indexes gets them decoded as before. The
+      // index buffers themselves stay in destBuffers either way - with
+      // synthesis the reader fills them arithmetically instead of building
+      // decode channels for them.
+      if ( gridSynthesis && ( destBuffers.size() <= 2 ) )
+      {
+         gridSynthesis = false;
+      }
+
       CompressedVectorReader reader = points.reader( destBuffers );
 
+      if ( gridSynthesis )
+      {
+         reader.setGridSynthesis( gridRowMinimum, gridColumnMinimum, gridLineLength,
+                                  gridByColumn );
+      }
+
+      cachedDestBuffers_ = std::move( destBuffers );
+      cachedProtoNames_ = std::move( protoNames );
+      cachedBuffersId_ = &buffers;
+      cachedCoordSize_ = sizeof( COORDTYPE );
+      cachedCount_ = count;
+      cachedGridSynthesis_ = gridSynthesis;
+      cachedGridDataIndex_ = dataIndex;
+      cachedGridRowMinimum_ = gridRowMinimum;
+      cachedGridColumnMinimum_ = gridColumnMinimum;
+      cachedGridLineLength_ = gridLineLength;
+      cachedGridByColumn_ = gridByColumn;
+
       return reader;
    }
 
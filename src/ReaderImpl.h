@@ -28,6 +28,8 @@
 
 #pragma once
 
+#include <thread>
+
 #include "E57SimpleData.h"
 #include "E57SimpleReader.h"
 
@@ -60,10 +62,16 @@ namespace e57
                             int64_t &imageSize, Image2DType &imageMaskType,
                             Image2DType &imageVisualType ) const;
 
+      int64_t GetImage2DDataSize( int64_t imageIndex, Image2DProjection imageProjection,
+                                  Image2DType imageType ) const;
+
       size_t ReadImage2DData( int64_t imageIndex, Image2DProjection imageProjection,
                               Image2DType imageType, uint8_t *pBuffer, int64_t start,
                               size_t count ) const;
 
+      std::vector<std::future<int64_t>>
+      ReadImage2DDataAsync( const std::vector<Image2DDataRequest> &requests ) const;
+
       int64_t GetData3DCount() const;
 
       bool ReadData3D( int64_t dataIndex, Data3D &data3DHeader ) const;
@@ -88,11 +96,87 @@ namespace e57
       ImageFile GetRawIMF() const;
 
    private:
+      /// Find the blob holding an image's bytes for the given projection and
+      /// format, or nullptr when the image doesn't carry that representation.
+      /// Resolves (and may lazily parse) nodes, so it runs on the caller's
+      /// thread, never on the batch read thread.
+      std::unique_ptr<BlobNode> FindImage2DBlob( int64_t imageIndex,
+                                                 Image2DProjection imageProjection,
+                                                 Image2DType imageType ) const;
+
+      /// Build a scan's Data3D header from its element tree. Called once per
+      /// scan; ReadData3D serves repeat calls from cachedData3DHeaders_.
+      void ParseData3DHeader( int64_t dataIndex, Data3D &data3DHeader ) const;
+
+      /// The values GetData3DSizes reports for one scan
+      struct Data3DSizes
+      {
+         int64_t row = 0;
+         int64_t column = 0;
+         int64_t pointsSize = 0;
+         int64_t groupsSize = 0;
+         int64_t countSize = 0;
+         bool columnIndex = false;
+      };
+
+      /// Compute a scan's sizes from its element tree. Called once per scan;
+      /// GetData3DSizes serves repeat calls from cachedData3DSizes_.
+      void ParseData3DSizes( int64_t dataIndex, Data3DSizes &sizes ) const;
+
+      /// True when a scan's header pins its raster down exactly, so rowIndex
+      /// and columnIndex can be synthesized from the record number instead of
+      /// decoded (see CompressedVectorReader::setGridSynthesis). Reads the
+      /// line groups to verify they are complete and stored contiguously in
+      /// id order.
+      bool DetectGridOrdering( int64_t dataIndex, const StructureNode &scan,
+                               const CompressedVectorNode &points, int64_t &rowMinimum,
+                               int64_t &columnMinimum, int64_t &lineLength, bool &byColumn ) const;
+
       ImageFile imf_;
       StructureNode root_;
 
       VectorNode data3D_;
 
       VectorNode images2D_;
+
+      // Reuse of point buffer setup: SetUpData3DPointsData returns the
+      // previous call's SourceDestBuffers again when the next scan has an
+      // identical prototype and the caller passes the same buffer struct at
+      // the same capacity, so a loop over many uniform scans pays the
+      // per-field setup cost once.
+      mutable std::vector<SourceDestBuffer> cachedDestBuffers_;
+      mutable std::vector<ustring> cachedProtoNames_;
+      mutable const void *cachedBuffersId_ = nullptr;
+      mutable size_t cachedCoordSize_ = 0;
+      mutable size_t cachedCount_ = 0;
+
+      // Grid synthesis decided for the cached buffers. The raster layout is
+      // per scan, so a cache built with synthesis is only reused for the
+      // same dataIndex; without synthesis the cache reuses across scans as
+      // before.
+      mutable bool cachedGridSynthesis_ = false;
+      mutable int64_t cachedGridDataIndex_ = -1;
+      mutable int64_t cachedGridRowMinimum_ = 0;
+      mutable int64_t cachedGridColumnMinimum_ = 0;
+      mutable int64_t cachedGridLineLength_ = 0;
+      mutable bool cachedGridByColumn_ = false;
+
+      // Data3D headers parsed so far, indexed by scan. Walking a scan's
+      // bounds, pose, and point-field nodes is expensive enough that callers
+      // planning work across hundreds of scans notice, so each header is
+      // built once and copied out on later ReadData3D calls. The group
+      // records themselves are only read in ReadData3DGroupsData.
+      mutable std::vector<std::unique_ptr<Data3D>> cachedData3DHeaders_;
+
+      // Scan sizes computed so far, indexed by scan. The record counts
+      // consult the binary section headers through childCount(), which is a
+      // file seek and read - the dominant cost when a planner queries the
+      // sizes of every scan of every file on network storage - so each
+      // scan's sizes are computed once.
+      mutable std::vector<std::unique_ptr<Data3DSizes>> cachedData3DSizes_;
+
+      // Background blob reads for ReadImage2DDataAsync; at most one batch
+      // thread exists at a time, joined before the next batch and in Close()
+      mutable std::thread imageReadThread_;
    }; // end Reader class
 } // end namespace e57
@@ -475,7 +475,7 @@ ScaledIntegerNode::ScaledIntegerNode( const Node &n )
 }
 
 /// @cond documentNonPublic The following isn't part of the API, and isn't documented.
-ScaledIntegerNode::ScaledIntegerNode( std::shared_ptr<ScaledIntegerNodeImpl> ni ) : impl_( ni )
+ScaledIntegerNode::ScaledIntegerNode( std::shared_ptr<ScaledIntegerNodeImpl> ni ) : impl_( std::move( ni ) )
 {
 }
 /// @endcond
@@ -25,6 +25,7 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
 #include <cmath>
 
 #include "CheckedFile.h"
@@ -175,6 +176,23 @@ namespace e57
       return ( offset_ );
    }
 
+   void ScaledIntegerNodeImpl::setMinMax( int64_t minimum, int64_t maximum )
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      if ( minimum > maximum )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument, "minimum=" + toString( minimum ) +
+                                                       " maximum=" + toString( maximum ) );
+      }
+
+      minimum_ = minimum;
+      maximum_ = maximum;
+
+      // Keep the (unused) raw value of a prototype node representable
+      value_ = std::min( std::max( value_, minimum_ ), maximum_ );
+   }
+
    void ScaledIntegerNodeImpl::checkLeavesInSet( const StringSet &pathNames,
                                                  NodeImplSharedPtr origin )
    {
@@ -60,6 +60,11 @@ namespace e57
       double scale();
       double offset();
 
+      /// Shrink the raw range to [minimum, maximum] (used by the writer's
+      /// range tightening before any record is encoded). The raw value is
+      /// clamped into the new range.
+      void setMinMax( int64_t minimum, int64_t maximum );
+
       void checkLeavesInSet( const StringSet &pathNames, NodeImplSharedPtr origin ) override;
 
       void writeXml( ImageFileImplSharedPtr imf, CheckedFile &cf, int indent,
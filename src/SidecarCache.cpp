@@ -0,0 +1,756 @@
+/*
+ * Copyright 2026 Andy Maloney <asmaloney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+#include <sys/stat.h>
+
+// This is fixed in a newer version of CRCpp.
+//    https://github.com/d-bahr/CRCpp/issues/17
+// TODO: Remove when new CRCpp is released.
+#if defined( WIN32 ) || defined( _WIN32 ) || defined( WINCE )
+// Disable warning about "conditional expression is constant".
+#pragma warning( push )
+#pragma warning( disable : 4127 )
+#endif
+#include "CRC.h"
+#if defined( WIN32 ) || defined( _WIN32 ) || defined( WINCE )
+#pragma warning( pop )
+#endif
+
+#include "SidecarCache.h"
+
+#include "BlobNodeImpl.h"
+#include "CheckedFile.h"
+#include "CompressedVectorNodeImpl.h"
+#include "FloatNodeImpl.h"
+#include "ImageFileImpl.h"
+#include "IntegerNodeImpl.h"
+#include "ScaledIntegerNodeImpl.h"
+#include "StringNodeImpl.h"
+#include "StructureNodeImpl.h"
+#include "VectorNodeImpl.h"
+
+namespace
+{
+   std::atomic<bool> sSidecarEnabled{ false };
+
+   /// Bumped on any change to the serialized layout; a sidecar with a
+   /// different version is regenerated, never interpreted
+   constexpr uint32_t cSidecarVersion = 1;
+
+   const char cSidecarMagic[8] = { 'E', '5', '7', '-', 'S', 'I', 'D', 'E' };
+
+   /// Bytes of the source file's E57 header captured for validation (the
+   /// size of E57FileHeader: signature, versions, length, XML offsets)
+   constexpr size_t cSourceHeaderBytes = 48;
+
+   /// Internal bail-out for a sidecar that can't be interpreted; never
+   /// escapes load()/store()
+   struct SidecarFormatError
+   {
+   };
+
+   e57::ustring _sidecarName( const e57::ustring &fileName )
+   {
+      return fileName + "i";
+   }
+
+   /// Length and modification time of the source file; false if it can't be
+   /// examined (then no sidecar is read or written)
+   bool _sourceFileInfo( const e57::ustring &path, uint64_t &length, int64_t &modificationTime )
+   {
+#if defined( _MSC_VER )
+      struct _stat64 info;
+      if ( _stat64( path.c_str(), &info ) != 0 )
+      {
+         return false;
+      }
+#else
+      struct stat info;
+      if ( stat( path.c_str(), &info ) != 0 )
+      {
+         return false;
+      }
+#endif
+      length = static_cast<uint64_t>( info.st_size );
+      modificationTime = static_cast<int64_t>( info.st_mtime );
+
+      return true;
+   }
+
+   /// First bytes of the source file (its E57 header), read through a
+   /// separate descriptor so the CheckedFile position is untouched
+   bool _sourceHeaderBytes( const e57::ustring &path, char *bytes )
+   {
+      FILE *file = fopen( path.c_str(), "rb" );
+
+      if ( file == nullptr )
+      {
+         return false;
+      }
+
+      const bool ok = fread( bytes, 1, cSourceHeaderBytes, file ) == cSourceHeaderBytes;
+
+      fclose( file );
+
+      return ok;
+   }
+
+   /// CRC32C over the whole sidecar payload, so a truncated or corrupted
+   /// sidecar is detected before any of it is interpreted
+   uint32_t _sidecarCRC( const char *buf, size_t size )
+   {
+      static const CRC::Parameters<crcpp_uint32, 32> sCRCParams{ 0x1EDC6F41, 0xFFFFFFFF, 0xFFFFFFFF,
+                                                                 true, true };
+
+      static const CRC::Table<crcpp_uint32, 32> sCRCTable = sCRCParams.MakeTable();
+
+      return CRC::Calculate<crcpp_uint32, 32>( buf, size, sCRCTable );
+   }
+
+   /// Appends native-endian scalars and length-prefixed strings to a buffer
+   class ByteWriter
+   {
+   public:
+      void putU8( uint8_t value )
+      {
+         buffer_.push_back( static_cast<char>( value ) );
+      }
+
+      void putU32( uint32_t value )
+      {
+         putRaw( &value, sizeof( value ) );
+      }
+
+      void putU64( uint64_t value )
+      {
+         putRaw( &value, sizeof( value ) );
+      }
+
+      void putI64( int64_t value )
+      {
+         putRaw( &value, sizeof( value ) );
+      }
+
+      void putDouble( double value )
+      {
+         putRaw( &value, sizeof( value ) );
+      }
+
+      void putString( const e57::ustring &value )
+      {
+         putU32( static_cast<uint32_t>( value.length() ) );
+         buffer_.append( value );
+      }
+
+      void putRaw( const void *bytes, size_t count )
+      {
+         buffer_.append( static_cast<const char *>( bytes ), count );
+      }
+
+      const std::string &buffer() const
+      {
+         return buffer_;
+      }
+
+   private:
+      std::string buffer_;
+   };
+
+   /// Reads the ByteWriter layout back with bounds checking; any overrun
+   /// means a damaged sidecar and throws SidecarFormatError
+   class ByteReader
+   {
+   public:
+      ByteReader( const char *data, size_t size ) : data_( data ), size_( size )
+      {
+      }
+
+      uint8_t getU8()
+      {
+         uint8_t value;
+         getRaw( &value, sizeof( value ) );
+         return value;
+      }
+
+      uint32_t getU32()
+      {
+         uint32_t value;
+         getRaw( &value, sizeof( value ) );
+         return value;
+      }
+
+      uint64_t getU64()
+      {
+         uint64_t value;
+         getRaw( &value, sizeof( value ) );
+         return value;
+      }
+
+      int64_t getI64()
+      {
+         int64_t value;
+         getRaw( &value, sizeof( value ) );
+         return value;
+      }
+
+      double getDouble()
+      {
+         double value;
+         getRaw( &value, sizeof( value ) );
+         return value;
+      }
+
+      e57::ustring getString()
+      {
+         const uint32_t cLength = getU32();
+
+         if ( cLength > size_ - pos_ )
+         {
+            throw SidecarFormatError();
+         }
+
+         e57::ustring value( data_ + pos_, cLength );
+         pos_ += cLength;
+
+         return value;
+      }
+
+      void getRaw( void *bytes, size_t count )
+      {
+         if ( count > size_ - pos_ )
+         {
+            throw SidecarFormatError();
+         }
+
+         memcpy( bytes, data_ + pos_, count );
+         pos_ += count;
+      }
+
+   private:
+      const char *data_;
+      size_t size_;
+      size_t pos_ = 0;
+   };
+}
+
+namespace e57
+{
+   namespace
+   {
+      /// Serialize one node and (recursively) its children. Walking the
+      /// children of a lazily parsed vector materializes them first, so the
+      /// sidecar always describes the complete tree.
+      void _writeNode( ByteWriter &out, const NodeImplSharedPtr &node )
+      {
+         out.putU8( static_cast<uint8_t>( node->type() ) );
+
+         switch ( node->type() )
+         {
+            case TypeStructure:
+            {
+               auto s_ni = std::static_pointer_cast<StructureNodeImpl>( node );
+
+               out.putU32( static_cast<uint32_t>( s_ni->childCount() ) );
+
+               for ( int64_t i = 0; i < s_ni->childCount(); ++i )
+               {
+                  NodeImplSharedPtr child = s_ni->get( i );
+
+                  out.putString( child->elementName() );
+                  _writeNode( out, child );
+               }
+            }
+            break;
+
+            case TypeVector:
+            {
+               auto v_ni = std::static_pointer_cast<VectorNodeImpl>( node );
+
+               out.putU8( v_ni->allowHeteroChildren() ? 1 : 0 );
+               out.putU32( static_cast<uint32_t>( v_ni->childCount() ) );
+
+               for ( int64_t i = 0; i < v_ni->childCount(); ++i )
+               {
+                  _writeNode( out, v_ni->get( i ) );
+               }
+            }
+            break;
+
+            case TypeCompressedVector:
+            {
+               auto cv_ni = std::static_pointer_cast<CompressedVectorNodeImpl>( node );
+
+               out.putU64( cv_ni->getBinarySectionLogicalStart() );
+               out.putI64( cv_ni->getRecordCount() );
+
+               const NodeImplSharedPtr cPrototype = cv_ni->getPrototype();
+               out.putU8( cPrototype ? 1 : 0 );
+               if ( cPrototype )
+               {
+                  _writeNode( out, cPrototype );
+               }
+
+               const std::shared_ptr<VectorNodeImpl> cCodecs = cv_ni->getCodecs();
+               out.putU8( cCodecs ? 1 : 0 );
+               if ( cCodecs )
+               {
+                  _writeNode( out, cCodecs );
+               }
+            }
+            break;
+
+            case TypeInteger:
+            {
+               auto i_ni = std::static_pointer_cast<IntegerNodeImpl>( node );
+
+               out.putI64( i_ni->value() );
+               out.putI64( i_ni->minimum() );
+               out.putI64( i_ni->maximum() );
+            }
+            break;
+
+            case TypeScaledInteger:
+            {
+               auto si_ni = std::static_pointer_cast<ScaledIntegerNodeImpl>( node );
+
+               out.putI64( si_ni->rawValue() );
+               out.putI64( si_ni->minimum() );
+               out.putI64( si_ni->maximum() );
+               out.putDouble( si_ni->scale() );
+               out.putDouble( si_ni->offset() );
+            }
+            break;
+
+            case TypeFloat:
+            {
+               auto f_ni = std::static_pointer_cast<FloatNodeImpl>( node );
+
+               out.putU8( static_cast<uint8_t>( f_ni->precision() ) );
+               out.putDouble( f_ni->value() );
+               out.putDouble( f_ni->minimum() );
+               out.putDouble( f_ni->maximum() );
+            }
+            break;
+
+            case TypeString:
+            {
+               auto s_ni = std::static_pointer_cast<StringNodeImpl>( node );
+
+               out.putString( s_ni->value() );
+            }
+            break;
+
+            case TypeBlob:
+            {
+               auto b_ni = std::static_pointer_cast<BlobNodeImpl>( node );
+
+               out.putU64( b_ni->getBinarySectionLogicalStart() );
+               out.putI64( b_ni->byteCount() );
+            }
+            break;
+
+            default:
+               // A node type this version doesn't know how to serialize;
+               // skip the whole sidecar rather than store a partial tree
+               throw SidecarFormatError();
+         }
+      }
+
+      /// Rebuild one node, mirroring exactly what E57XmlBuilder does when
+      /// the same node arrives from the XML section
+      NodeImplSharedPtr _readNode( ByteReader &in, const ImageFileImplSharedPtr &imf )
+      {
+         const uint8_t cType = in.getU8();
+
+         switch ( cType )
+         {
+            case TypeStructure:
+            {
+               std::shared_ptr<StructureNodeImpl> s_ni( new StructureNodeImpl( imf ) );
+
+               const uint32_t cChildCount = in.getU32();
+
+               for ( uint32_t i = 0; i < cChildCount; ++i )
+               {
+                  const ustring cName = in.getString();
+
+                  s_ni->set( cName, _readNode( in, imf ) );
+               }
+
+               return s_ni;
+            }
+
+            case TypeVector:
+            {
+               const bool cAllowHetero = in.getU8() != 0;
+
+               std::shared_ptr<VectorNodeImpl> v_ni( new VectorNodeImpl( imf, cAllowHetero ) );
+
+               const uint32_t cChildCount = in.getU32();
+
+               for ( uint32_t i = 0; i < cChildCount; ++i )
+               {
+                  v_ni->append( _readNode( in, imf ) );
+               }
+
+               return v_ni;
+            }
+
+            case TypeCompressedVector:
+            {
+               std::shared_ptr<CompressedVectorNodeImpl> cv_ni(
+                  new CompressedVectorNodeImpl( imf ) );
+
+               cv_ni->setBinarySectionLogicalStart( in.getU64() );
+               cv_ni->setRecordCount( in.getI64() );
+
+               // Same warm-up the XML builder starts as it discovers a
+               // section
+               imf->prefetchBinarySection( cv_ni->getBinarySectionLogicalStart() );
+
+               if ( in.getU8() != 0 )
+               {
+                  cv_ni->setPrototype( _readNode( in, imf ) );
+               }
+
+               if ( in.getU8() != 0 )
+               {
+                  NodeImplSharedPtr codecs = _readNode( in, imf );
+
+                  if ( codecs->type() != TypeVector )
+                  {
+                     throw SidecarFormatError();
+                  }
+
+                  cv_ni->setCodecs( std::static_pointer_cast<VectorNodeImpl>( codecs ) );
+               }
+
+               return cv_ni;
+            }
+
+            case TypeInteger:
+            {
+               const int64_t cValue = in.getI64();
+               const int64_t cMinimum = in.getI64();
+               const int64_t cMaximum = in.getI64();
+
+               return NodeImplSharedPtr( new IntegerNodeImpl( imf, cValue, cMinimum, cMaximum ) );
+            }
+
+            case TypeScaledInteger:
+            {
+               const int64_t cValue = in.getI64();
+               const int64_t cMinimum = in.getI64();
+               const int64_t cMaximum = in.getI64();
+               const double cScale = in.getDouble();
+               const double cOffset = in.getDouble();
+
+               return NodeImplSharedPtr(
+                  new ScaledIntegerNodeImpl( imf, cValue, cMinimum, cMaximum, cScale, cOffset ) );
+            }
+
+            case TypeFloat:
+            {
+               const auto cPrecision = static_cast<FloatPrecision>( in.getU8() );
+
+               if ( ( cPrecision != PrecisionSingle ) && ( cPrecision != PrecisionDouble ) )
+               {
+                  throw SidecarFormatError();
+               }
+
+               const double cValue = in.getDouble();
+               const double cMinimum = in.getDouble();
+               const double cMaximum = in.getDouble();
+
+               return NodeImplSharedPtr(
+                  new FloatNodeImpl( imf, cValue, cPrecision, cMinimum, cMaximum ) );
+            }
+
+            case TypeString:
+            {
+               return NodeImplSharedPtr( new StringNodeImpl( imf, in.getString() ) );
+            }
+
+            case TypeBlob:
+            {
+               const uint64_t cSectionStart = in.getU64();
+               const int64_t cByteCount = in.getI64();
+
+               return NodeImplSharedPtr( new BlobNodeImpl(
+                  imf, static_cast<int64_t>( CheckedFile::logicalToPhysical( cSectionStart ) ),
+                  cByteCount ) );
+            }
+
+            default:
+               throw SidecarFormatError();
+         }
+      }
+
+      /// The validation block written after the magic and version: enough to
+      /// notice any rewrite of the source file
+      void _writeValidation( ByteWriter &out, uint64_t length, int64_t modificationTime,
+                             const char *headerBytes )
+      {
+         out.putU64( length );
+         out.putI64( modificationTime );
+         out.putRaw( headerBytes, cSourceHeaderBytes );
+      }
+   }
+
+   void SidecarCache::setEnabled( bool enabled )
+   {
+      sSidecarEnabled = enabled;
+   }
+
+   bool SidecarCache::load( const ImageFileImplSharedPtr &imf )
+   {
+      if ( !sSidecarEnabled )
+      {
+         return false;
+      }
+
+      const ustring cFileName = imf->fileName();
+
+      if ( cFileName == "<StreamBuffer>" )
+      {
+         return false;
+      }
+
+      // Read the whole sidecar; they are small (metadata only)
+      std::string sidecar;
+
+      {
+         FILE *file = fopen( _sidecarName( cFileName ).c_str(), "rb" );
+
+         if ( file == nullptr )
+         {
+            return false;
+         }
+
+         char chunk[65536];
+         size_t count;
+
+         while ( ( count = fread( chunk, 1, sizeof( chunk ), file ) ) > 0 )
+         {
+            sidecar.append( chunk, count );
+         }
+
+         fclose( file );
+      }
+
+      // The CRC trailer must cover everything before it
+      if ( sidecar.length() < sizeof( cSidecarMagic ) + sizeof( uint32_t ) )
+      {
+         return false;
+      }
+
+      const size_t cPayloadLength = sidecar.length() - sizeof( uint32_t );
+
+      uint32_t storedCRC;
+      memcpy( &storedCRC, &sidecar[cPayloadLength], sizeof( storedCRC ) );
+
+      if ( storedCRC != _sidecarCRC( sidecar.data(), cPayloadLength ) )
+      {
+         return false;
+      }
+
+      if ( memcmp( sidecar.data(), cSidecarMagic, sizeof( cSidecarMagic ) ) != 0 )
+      {
+         return false;
+      }
+
+      // Everything the tree is rebuilt from must survive a damaged or stale
+      // sidecar without touching imf, so gather first and install last
+      const std::shared_ptr<StructureNodeImpl> cSavedRoot = imf->root_;
+
+      try
+      {
+         ByteReader in( sidecar.data() + sizeof( cSidecarMagic ),
+                        cPayloadLength - sizeof( cSidecarMagic ) );
+
+         if ( in.getU32() != cSidecarVersion )
+         {
+            return false;
+         }
+
+         // Compare the source file the sidecar described with the one that
+         // is open now
+         uint64_t length;
+         int64_t modificationTime;
+         char headerBytes[cSourceHeaderBytes];
+
+         if ( !_sourceFileInfo( cFileName, length, modificationTime ) ||
+              !_sourceHeaderBytes( cFileName, headerBytes ) )
+         {
+            return false;
+         }
+
+         if ( ( in.getU64() != length ) || ( in.getI64() != modificationTime ) )
+         {
+            return false;
+         }
+
+         char storedHeaderBytes[cSourceHeaderBytes];
+         in.getRaw( storedHeaderBytes, cSourceHeaderBytes );
+
+         if ( memcmp( storedHeaderBytes, headerBytes, cSourceHeaderBytes ) != 0 )
+         {
+            return false;
+         }
+
+         // Replay the namespace registrations the parse would have done
+         const uint32_t cNamespaceCount = in.getU32();
+
+         for ( uint32_t i = 0; i < cNamespaceCount; ++i )
+         {
+            const ustring cPrefix = in.getString();
+            const ustring cUri = in.getString();
+
+            imf->extensionsAdd( cPrefix, cUri );
+         }
+
+         NodeImplSharedPtr root = _readNode( in, imf );
+
+         if ( root->type() != TypeStructure )
+         {
+            throw SidecarFormatError();
+         }
+
+         imf->root_ = std::static_pointer_cast<StructureNodeImpl>( root );
+         imf->root_->setAttachedRecursive();
+
+         return true;
+      }
+      catch ( SidecarFormatError & )
+      {
+      }
+      catch ( E57Exception & )
+      {
+      }
+
+      // Leave imf exactly as a fresh parse expects it
+      imf->extensionsClear();
+      imf->root_ = cSavedRoot;
+
+      return false;
+   }
+
+   void SidecarCache::store( const ImageFileImplSharedPtr &imf )
+   {
+      if ( !sSidecarEnabled )
+      {
+         return;
+      }
+
+      const ustring cFileName = imf->fileName();
+
+      if ( cFileName == "<StreamBuffer>" )
+      {
+         return;
+      }
+
+      uint64_t length;
+      int64_t modificationTime;
+      char headerBytes[cSourceHeaderBytes];
+
+      if ( !_sourceFileInfo( cFileName, length, modificationTime ) ||
+           !_sourceHeaderBytes( cFileName, headerBytes ) )
+      {
+         return;
+      }
+
+      ByteWriter out;
+
+      out.putRaw( cSidecarMagic, sizeof( cSidecarMagic ) );
+      out.putU32( cSidecarVersion );
+
+      _writeValidation( out, length, modificationTime, headerBytes );
+
+      out.putU32( static_cast<uint32_t>( imf->extensionsCount() ) );
+
+      for ( size_t i = 0; i < imf->extensionsCount(); ++i )
+      {
+         out.putString( imf->extensionsPrefix( i ) );
+         out.putString( imf->extensionsUri( i ) );
+      }
+
+      try
+      {
+         // Walking the tree materializes any children deferred by the lazy
+         // parse, so later opens get the whole file without parsing at all
+         _writeNode( out, imf->root_ );
+      }
+      catch ( SidecarFormatError & )
+      {
+         return;
+      }
+      catch ( E57Exception & )
+      {
+         return;
+      }
+
+      const uint32_t cCRC = _sidecarCRC( out.buffer().data(), out.buffer().length() );
+
+      // Write to a temporary name and rename into place, so a concurrent
+      // open never sees a half-written sidecar
+      const ustring cSidecarName = _sidecarName( cFileName );
+      const ustring cTempName = cSidecarName + ".tmp";
+
+      FILE *file = fopen( cTempName.c_str(), "wb" );
+
+      if ( file == nullptr )
+      {
+         return;
+      }
+
+      const bool cWritten =
+         ( fwrite( out.buffer().data(), 1, out.buffer().length(), file ) ==
+           out.buffer().length() ) &&
+         ( fwrite( &cCRC, 1, sizeof( cCRC ), file ) == sizeof( cCRC ) );
+
+      const bool cClosed = fclose( file ) == 0;
+
+      if ( !cWritten || !cClosed )
+      {
+         remove( cTempName.c_str() );
+         return;
+      }
+
+#if defined( _WIN32 )
+      // rename() on Windows fails if the target exists
+      remove( cSidecarName.c_str() );
+#endif
+
+      if ( rename( cTempName.c_str(), cSidecarName.c_str() ) != 0 )
+      {
+         remove( cTempName.c_str() );
+      }
+   }
+}
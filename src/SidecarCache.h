@@ -0,0 +1,63 @@
+#pragma once
+/*
+ * Copyright 2026 Andy Maloney <asmaloney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "Common.h"
+
+namespace e57
+{
+   /// Optional sidecar metadata cache: the parsed outcome of opening
+   /// "file.e57" for reading (namespaces and the complete node tree, with
+   /// every binary section offset and record count) serialized in a compact
+   /// binary form next to the data as "file.e57i". A later open that finds a
+   /// sidecar matching the data file's length, modification time, and E57
+   /// header bytes rebuilds the tree from it directly, skipping the XML read
+   /// and parse entirely.
+   ///
+   /// Sidecars are best effort in both directions: a missing, stale,
+   /// truncated, or otherwise unusable sidecar falls back to the normal XML
+   /// parse (and is rewritten), and a failure to write one is ignored. The
+   /// format is process-local cache state, not interchange: it is
+   /// native-endian and carries a version that is bumped on any layout
+   /// change, so foreign sidecars are simply regenerated.
+   ///
+   /// Off by default since it writes files next to the user's data; see
+   /// ImageFile::sidecarCacheSetEnabled.
+   class SidecarCache
+   {
+   public:
+      static void setEnabled( bool enabled );
+
+      /// Build imf's namespaces and node tree from the sidecar of the file
+      /// it has open. Returns false when disabled, or when no usable sidecar
+      /// exists, leaving imf ready for a normal parse.
+      static bool load( const ImageFileImplSharedPtr &imf );
+
+      /// Write the sidecar describing imf's parsed tree, replacing any stale
+      /// one. Failures are ignored; the sidecar is only a cache.
+      static void store( const ImageFileImplSharedPtr &imf );
+   };
+}
@@ -96,6 +96,22 @@ The connection of the SourceDestBuffer to a CompressedVectorNode field is establ
 the pathName. There are several options to this connection: doConversion and doScaling, which are
 described in the constructor documentation.
 
+@section sourcedestbuffer_external External memory contract
+The implementation transfers values directly to/from the registered memory and never reallocates,
+resizes, or substitutes it with a temporary, so the exact physical pages the caller registered
+receive the data. Memory with special registration - CUDA-pinned staging buffers, memory registered
+with an RDMA NIC - can therefore be handed to the API directly, and decoded scans can be uploaded
+from it without an intermediate copy.
+
+More precisely, for non-string buffers a read that transfers N records writes only the bytes
+[base + i*stride, base + i*stride + sizeof(element)) for i in [0, N): bytes between strided
+elements are never touched, nothing is written past the last record transferred, and the
+implementation only ever reads back values it stored itself earlier in the same transfer (rarely,
+and one element at a time, so write-combined memory is usable). The buffer must be naturally
+aligned for its element type and the stride a multiple of that alignment; no stronger alignment is
+required or assumed. String (ustring) buffers are the exception to all of the above: they are
+vectors of variable-length strings and allocate per element.
+
 @section sourcedestbuffer_invariant Class Invariant
 A class invariant is a list of statements about an object that are always true before and after any
 operation on the object. An invariant is useful for testing correct operation of an implementation.
@@ -110,6 +126,13 @@ externally visible state for consistency and throws an exception if the invarian
 @see Node
 */
 
+/// @cond documentNonPublic The following isn't part of the API, and isn't documented.
+SourceDestBuffer::SourceDestBuffer( std::shared_ptr<SourceDestBufferImpl> sbi ) :
+   impl_( std::move( sbi ) )
+{
+}
+/// @endcond
+
 /*!
 @brief Designate buffers to transfer data to/from a CompressedVectorNode in a block.
 
@@ -26,6 +26,8 @@
  */
 
 #include <cmath>
+#include <cstring>
+#include <limits>
 
 #include "ImageFileImpl.h"
 #include "SourceDestBufferImpl.h"
@@ -278,6 +280,207 @@ template <typename T> void SourceDestBufferImpl::_setNextReal( T inValue )
    nextIndex_++;
 }
 
+template <typename T> void SourceDestBufferImpl::_setNextRealN( const T *values, size_t count )
+{
+   static_assert( std::is_same<T, double>::value || std::is_same<T, float>::value,
+                  "_setNextRealN() requires float or double type" );
+
+   /// don't checkImageFileOpen
+
+   /// Verify have room for the whole run
+   if ( ( count > capacity_ ) || ( nextIndex_ > capacity_ - count ) )
+   {
+      throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
+   }
+
+   /// Matching representation: the run is already the destination's bytes
+   if ( ( std::is_same<T, float>::value && ( memoryRepresentation_ == Real32 ) ) ||
+        ( std::is_same<T, double>::value && ( memoryRepresentation_ == Real64 ) ) )
+   {
+      const size_t cStride = stride_;
+      char *E57_RESTRICT p = &base_[nextIndex_ * cStride];
+
+      if ( cStride == sizeof( T ) )
+      {
+         memcpy( p, values, count * sizeof( T ) );
+      }
+      else
+      {
+         const T *E57_RESTRICT in = values;
+
+         for ( size_t i = 0; i < count; i++ )
+         {
+            *reinterpret_cast<T *>( p ) = in[i];
+            p += cStride;
+         }
+      }
+
+      nextIndex_ += static_cast<unsigned>( count );
+      return;
+   }
+
+   /// Widening float to double is also a tight loop; it can't lose bits
+   if ( std::is_same<T, float>::value && ( memoryRepresentation_ == Real64 ) )
+   {
+      const size_t cStride = stride_;
+      char *E57_RESTRICT p = &base_[nextIndex_ * cStride];
+      const T *E57_RESTRICT in = values;
+
+      for ( size_t i = 0; i < count; i++ )
+      {
+         *reinterpret_cast<double *>( p ) = static_cast<double>( in[i] );
+         p += cStride;
+      }
+
+      nextIndex_ += static_cast<unsigned>( count );
+      return;
+   }
+
+   /// Everything else keeps the per-element conversion path, with its range
+   /// checks
+   for ( size_t i = 0; i < count; i++ )
+   {
+      _setNextReal( values[i] );
+   }
+}
+
+void SourceDestBufferImpl::setNextFloatN( const float *values, size_t count )
+{
+   _setNextRealN( values, count );
+}
+
+void SourceDestBufferImpl::setNextDoubleN( const double *values, size_t count )
+{
+   _setNextRealN( values, count );
+}
+
+void SourceDestBufferImpl::setNextInt64Fill( int64_t value, size_t count )
+{
+   if ( count == 0 )
+   {
+      return;
+   }
+
+   /// Convert and range-check the constant once
+   setNextInt64( value );
+
+   _replicateLastElement( count - 1 );
+}
+
+void SourceDestBufferImpl::setNextInt64Fill( int64_t value, size_t count, double scale,
+                                             double offset )
+{
+   if ( count == 0 )
+   {
+      return;
+   }
+
+   /// Convert, scale, and range-check the constant once
+   setNextInt64( value, scale, offset );
+
+   _replicateLastElement( count - 1 );
+}
+
+void SourceDestBufferImpl::_replicateLastElement( size_t count )
+{
+   if ( count == 0 )
+   {
+      return;
+   }
+
+   /// don't checkImageFileOpen
+
+   /// Verify have room for the rest of the run
+   if ( ( count > capacity_ ) || ( nextIndex_ > capacity_ - count ) )
+   {
+      throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
+   }
+
+   size_t elementSize = 0;
+
+   switch ( memoryRepresentation_ )
+   {
+      case Int8:
+      case UInt8:
+      case Bool:
+         elementSize = 1;
+         break;
+      case Int16:
+      case UInt16:
+         elementSize = 2;
+         break;
+      case Int32:
+      case UInt32:
+      case Real32:
+         elementSize = 4;
+         break;
+      case Int64:
+      case Real64:
+         elementSize = 8;
+         break;
+      case UString:
+         throw E57_EXCEPTION2( ErrorExpectingNumeric, "pathName=" + pathName_ );
+   }
+
+   const char *source = &base_[( nextIndex_ - 1 ) * stride_];
+   char *p = &base_[nextIndex_ * stride_];
+
+   /// A packed one-byte representation broadcasts with a plain memset; the
+   /// wider representations use fixed-size stores the compiler vectorizes.
+   if ( ( elementSize == 1 ) && ( stride_ == 1 ) )
+   {
+      memset( p, *source, count );
+   }
+   else
+   {
+      switch ( elementSize )
+      {
+         case 1:
+            for ( size_t i = 0; i < count; i++ )
+            {
+               *p = *source;
+               p += stride_;
+            }
+            break;
+         case 2:
+         {
+            uint16_t v;
+            memcpy( &v, source, sizeof( v ) );
+            for ( size_t i = 0; i < count; i++ )
+            {
+               memcpy( p, &v, sizeof( v ) );
+               p += stride_;
+            }
+            break;
+         }
+         case 4:
+         {
+            uint32_t v;
+            memcpy( &v, source, sizeof( v ) );
+            for ( size_t i = 0; i < count; i++ )
+            {
+               memcpy( p, &v, sizeof( v ) );
+               p += stride_;
+            }
+            break;
+         }
+         case 8:
+         {
+            uint64_t v;
+            memcpy( &v, source, sizeof( v ) );
+            for ( size_t i = 0; i < count; i++ )
+            {
+               memcpy( p, &v, sizeof( v ) );
+               p += stride_;
+            }
+            break;
+         }
+      }
+   }
+
+   nextIndex_ += static_cast<unsigned>( count );
+}
+
 void SourceDestBufferImpl::checkState_() const
 {
    /// Implement checkImageFileOpen functionality for SourceDestBufferImpl ctors
@@ -303,8 +506,44 @@ void SourceDestBufferImpl::checkState_() const
       {
          throw E57_EXCEPTION2( ErrorBadBuffer, "pathName=" + pathName_ );
       }
-      //??? check base alignment, depending on CPU type
       //??? check if stride too small, positive or negative
+
+#if ( E57_VALIDATION_LEVEL == VALIDATION_DEEP )
+      /// The transfer stores assume naturally aligned elements, so check base
+      /// and stride against the element's natural alignment (the documented
+      /// external memory contract requires no more than that).
+      size_t alignment = 1;
+
+      switch ( memoryRepresentation_ )
+      {
+         case Int8:
+         case UInt8:
+         case Bool:
+            alignment = 1;
+            break;
+         case Int16:
+         case UInt16:
+            alignment = 2;
+            break;
+         case Int32:
+         case UInt32:
+         case Real32:
+            alignment = 4;
+            break;
+         case Int64:
+         case Real64:
+            alignment = 8;
+            break;
+         default:
+            break;
+      }
+
+      if ( ( reinterpret_cast<uintptr_t>( base_ ) % alignment != 0 ) ||
+           ( stride_ % alignment != 0 ) )
+      {
+         throw E57_EXCEPTION2( ErrorBadBuffer, "pathName=" + pathName_ );
+      }
+#endif
    }
    else
    {
@@ -713,6 +952,49 @@ ustring SourceDestBufferImpl::getNextString()
    return ( ( *ustrings_ )[nextIndex_++] );
 }
 
+double SourceDestBufferImpl::valueAsDouble( size_t index ) const
+{
+   /// don't checkImageFileOpen
+
+   /// Verify index is within bounds
+   if ( index >= capacity_ )
+   {
+      throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
+   }
+
+   /// Fetch value without advancing nextIndex_; no conversion or scaling is
+   /// applied, the caller interprets the value.
+   const char *p = &base_[index * stride_];
+
+   switch ( memoryRepresentation_ )
+   {
+      case Int8:
+         return static_cast<double>( *reinterpret_cast<const int8_t *>( p ) );
+      case UInt8:
+         return static_cast<double>( *reinterpret_cast<const uint8_t *>( p ) );
+      case Int16:
+         return static_cast<double>( *reinterpret_cast<const int16_t *>( p ) );
+      case UInt16:
+         return static_cast<double>( *reinterpret_cast<const uint16_t *>( p ) );
+      case Int32:
+         return static_cast<double>( *reinterpret_cast<const int32_t *>( p ) );
+      case UInt32:
+         return static_cast<double>( *reinterpret_cast<const uint32_t *>( p ) );
+      case Int64:
+         return static_cast<double>( *reinterpret_cast<const int64_t *>( p ) );
+      case Bool:
+         return ( *reinterpret_cast<const bool *>( p ) ) ? 1.0 : 0.0;
+      case Real32:
+         return static_cast<double>( *reinterpret_cast<const float *>( p ) );
+      case Real64:
+         return *reinterpret_cast<const double *>( p );
+      case UString:
+         throw E57_EXCEPTION2( ErrorExpectingNumeric, "pathName=" + pathName_ );
+      default:
+         throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
+   }
+}
+
 void SourceDestBufferImpl::setNextInt64( int64_t value )
 {
    /// don't checkImageFileOpen
@@ -939,33 +1221,894 @@ void SourceDestBufferImpl::setNextInt64( int64_t value, double scale, double off
    nextIndex_++;
 }
 
-void SourceDestBufferImpl::setNextFloat( float value )
+/// The bulk loop bodies below are pure load-convert-store: the strided buffer
+/// pointer and the run pointer are marked non-aliasing, the stride is hoisted
+/// into a local, and nextIndex_ is updated once after the loop (on a
+/// mid-run throw the transfer is in an undocumented state anyway), so the
+/// compiler can vectorize them.
+
+template <typename T>
+void SourceDestBufferImpl::_getNextIntegerN( int64_t *values, size_t count )
 {
-   _setNextReal( value );
+   const size_t cStride = stride_;
+   const char *E57_RESTRICT p = &base_[nextIndex_ * cStride];
+   int64_t *E57_RESTRICT out = values;
+
+   for ( size_t i = 0; i < count; i++ )
+   {
+      out[i] = static_cast<int64_t>( *reinterpret_cast<const T *>( p ) );
+      p += cStride;
+   }
+
+   nextIndex_ += static_cast<unsigned>( count );
 }
 
-void SourceDestBufferImpl::setNextDouble( double value )
+template <typename T>
+void SourceDestBufferImpl::_getNextScaledIntegerN( int64_t *values, size_t count, double scale,
+                                                   double offset )
 {
-   _setNextReal( value );
+   const size_t cStride = stride_;
+   const char *E57_RESTRICT p = &base_[nextIndex_ * cStride];
+   int64_t *E57_RESTRICT out = values;
+
+   for ( size_t i = 0; i < count; i++ )
+   {
+      /// Calc (x-offset)/scale rounded to nearest integer, but keep in
+      /// floating point until sure is in bounds
+      const double doubleRawValue =
+         floor( ( *reinterpret_cast<const T *>( p ) - offset ) / scale + 0.5 );
+
+      /// Make sure that value is representable in an int64_t
+      if ( doubleRawValue < INT64_MIN || INT64_MAX < doubleRawValue )
+      {
+         throw E57_EXCEPTION2( ErrorScaledValueNotRepresentable,
+                               "pathName=" + pathName_ + " value=" + toString( doubleRawValue ) );
+      }
+
+      out[i] = static_cast<int64_t>( doubleRawValue );
+      p += cStride;
+   }
+
+   nextIndex_ += static_cast<unsigned>( count );
 }
 
-void SourceDestBufferImpl::setNextString( const ustring &value )
+/// Float-native variant of _getNextScaledIntegerN<float>, used when scale and
+/// offset are exactly representable as floats. Promoting each float to double
+/// just to round it back to an integer doubles the conversion traffic and
+/// halves the SIMD lane count for no benefit: below 2^23 any float rounding of
+/// the raw value stays within the quantization noise already present in the
+/// float source data, and at or above 2^23, where float ulp reaches 1.0, the
+/// element is redone in double so results stay trustworthy over the whole
+/// int64_t range.
+void SourceDestBufferImpl::_getNextScaledIntegerFloatN( int64_t *values, size_t count, double scale,
+                                                        double offset )
 {
-   /// don't checkImageFileOpen
+   const float cFloatScale = static_cast<float>( scale );
+   const float cFloatOffset = static_cast<float>( offset );
+   constexpr float cFloatExactLimit = 8388608.0F; // 2^23, where float ulp is 1.0
 
-   if ( memoryRepresentation_ != UString )
+   const size_t cStride = stride_;
+   const char *E57_RESTRICT p = &base_[nextIndex_ * cStride];
+   int64_t *E57_RESTRICT out = values;
+
+   for ( size_t i = 0; i < count; i++ )
    {
-      throw E57_EXCEPTION2( ErrorExpectingUString, "pathName=" + pathName_ );
+      const float cValue = *reinterpret_cast<const float *>( p );
+      const float cFloatRawValue =
+         std::floor( ( cValue - cFloatOffset ) / cFloatScale + 0.5F );
+
+      if ( std::fabs( cFloatRawValue ) < cFloatExactLimit )
+      {
+         out[i] = static_cast<int64_t>( cFloatRawValue );
+      }
+      else
+      {
+         /// Rare: raw value too large for exact float math, redo in double
+         const double doubleRawValue =
+            floor( ( static_cast<double>( cValue ) - offset ) / scale + 0.5 );
+
+         /// Make sure that value is representable in an int64_t
+         if ( doubleRawValue < INT64_MIN || INT64_MAX < doubleRawValue )
+         {
+            throw E57_EXCEPTION2( ErrorScaledValueNotRepresentable,
+                                  "pathName=" + pathName_ + " value=" + toString( doubleRawValue ) );
+         }
+
+         out[i] = static_cast<int64_t>( doubleRawValue );
+      }
+
+      p += cStride;
    }
 
-   /// Verify have room.
-   if ( nextIndex_ >= capacity_ )
+   nextIndex_ += static_cast<unsigned>( count );
+}
+
+template <typename T>
+void SourceDestBufferImpl::_setNextIntegerN( const int64_t *values, size_t count )
+{
+   const auto typeMin = static_cast<int64_t>( std::numeric_limits<T>::min() );
+   const auto typeMax = static_cast<int64_t>( std::numeric_limits<T>::max() );
+
+   const size_t cStride = stride_;
+   char *E57_RESTRICT p = &base_[nextIndex_ * cStride];
+   const int64_t *E57_RESTRICT in = values;
+
+   for ( size_t i = 0; i < count; i++ )
+   {
+      const int64_t value = in[i];
+
+      if ( value < typeMin || typeMax < value )
+      {
+         throw E57_EXCEPTION2( ErrorValueNotRepresentable,
+                               "pathName=" + pathName_ + " value=" + toString( value ) );
+      }
+
+      *reinterpret_cast<T *>( p ) = static_cast<T>( value );
+      p += cStride;
+   }
+
+   nextIndex_ += static_cast<unsigned>( count );
+}
+
+template <typename T>
+void SourceDestBufferImpl::_setNextScaledIntegerN( const int64_t *values, size_t count,
+                                                   double scale, double offset )
+{
+   const auto typeMin = static_cast<double>( std::numeric_limits<T>::min() );
+   const auto typeMax = static_cast<double>( std::numeric_limits<T>::max() );
+
+   const size_t cStride = stride_;
+   char *E57_RESTRICT p = &base_[nextIndex_ * cStride];
+   const int64_t *E57_RESTRICT in = values;
+
+   for ( size_t i = 0; i < count; i++ )
+   {
+      /// Value will represented as some integer in user's buffer, so round to
+      /// nearest integer here. But keep in floating point rep until we know
+      /// that the value is representable in the user's buffer.
+      const double scaledValue = floor( in[i] * scale + offset + 0.5 );
+
+      if ( scaledValue < typeMin || typeMax < scaledValue )
+      {
+         throw E57_EXCEPTION2( ErrorScaledValueNotRepresentable,
+                               "pathName=" + pathName_ +
+                                  " scaledValue=" + toString( scaledValue ) );
+      }
+
+      *reinterpret_cast<T *>( p ) = static_cast<T>( scaledValue );
+      p += cStride;
+   }
+
+   nextIndex_ += static_cast<unsigned>( count );
+}
+
+template <typename D, typename S>
+void SourceDestBufferImpl::_getNextRealN( D *values, size_t count )
+{
+   const size_t cStride = stride_;
+   const char *E57_RESTRICT p = &base_[nextIndex_ * cStride];
+   D *E57_RESTRICT out = values;
+
+   for ( size_t i = 0; i < count; i++ )
+   {
+      out[i] = static_cast<D>( *reinterpret_cast<const S *>( p ) );
+      p += cStride;
+   }
+
+   nextIndex_ += static_cast<unsigned>( count );
+}
+
+void SourceDestBufferImpl::getNextInt64N( int64_t *values, size_t count )
+{
+   /// don't checkImageFileOpen
+
+   /// Verify whole run is within bounds
+   if ( ( count > capacity_ ) || ( nextIndex_ > capacity_ - count ) )
    {
       throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
    }
 
-   /// Assign to already initialized element in vector
-   ( *ustrings_ )[nextIndex_] = value;
+   switch ( memoryRepresentation_ )
+   {
+      case Int8:
+         _getNextIntegerN<int8_t>( values, count );
+         break;
+      case UInt8:
+         _getNextIntegerN<uint8_t>( values, count );
+         break;
+      case Int16:
+         _getNextIntegerN<int16_t>( values, count );
+         break;
+      case UInt16:
+         _getNextIntegerN<uint16_t>( values, count );
+         break;
+      case Int32:
+         _getNextIntegerN<int32_t>( values, count );
+         break;
+      case UInt32:
+         _getNextIntegerN<uint32_t>( values, count );
+         break;
+      case Int64:
+         _getNextIntegerN<int64_t>( values, count );
+         break;
+      case Bool:
+      {
+         if ( !doConversion_ )
+         {
+            throw E57_EXCEPTION2( ErrorConversionRequired, "pathName=" + pathName_ );
+         }
+
+         const char *p = &base_[nextIndex_ * stride_];
+
+         for ( size_t i = 0; i < count; i++ )
+         {
+            /// Convert bool to 0/1, all non-zero values map to 1.0
+            values[i] = ( *reinterpret_cast<const bool *>( p ) ) ? 1 : 0;
+            p += stride_;
+         }
+
+         nextIndex_ += static_cast<unsigned>( count );
+         break;
+      }
+      case Real32:
+         if ( !doConversion_ )
+         {
+            throw E57_EXCEPTION2( ErrorConversionRequired, "pathName=" + pathName_ );
+         }
+         //??? fault if get special value: NaN, NegInf...
+         _getNextIntegerN<float>( values, count );
+         break;
+      case Real64:
+         if ( !doConversion_ )
+         {
+            throw E57_EXCEPTION2( ErrorConversionRequired, "pathName=" + pathName_ );
+         }
+         //??? fault if get special value: NaN, NegInf...
+         _getNextIntegerN<double>( values, count );
+         break;
+      case UString:
+         throw E57_EXCEPTION2( ErrorExpectingNumeric, "pathName=" + pathName_ );
+      default:
+         throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
+   }
+}
+
+void SourceDestBufferImpl::getNextInt64N( int64_t *values, size_t count, double scale,
+                                          double offset )
+{
+   /// don't checkImageFileOpen
+
+   /// Incorporating the scale is optional (requested by user when constructing
+   /// the sdbuf). If the user did not request scaling, then we get raw values
+   /// from user's buffer.
+   if ( !doScaling_ )
+   {
+      /// Just return raw values.
+      getNextInt64N( values, count );
+      return;
+   }
+
+   /// Double check non-zero scale.  Going to divide by it below.
+   if ( scale == 0 )
+   {
+      throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
+   }
+
+   /// Verify whole run is within bounds
+   if ( ( count > capacity_ ) || ( nextIndex_ > capacity_ - count ) )
+   {
+      throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
+   }
+
+   switch ( memoryRepresentation_ )
+   {
+      case Int8:
+         _getNextScaledIntegerN<int8_t>( values, count, scale, offset );
+         break;
+      case UInt8:
+         _getNextScaledIntegerN<uint8_t>( values, count, scale, offset );
+         break;
+      case Int16:
+         _getNextScaledIntegerN<int16_t>( values, count, scale, offset );
+         break;
+      case UInt16:
+         _getNextScaledIntegerN<uint16_t>( values, count, scale, offset );
+         break;
+      case Int32:
+         _getNextScaledIntegerN<int32_t>( values, count, scale, offset );
+         break;
+      case UInt32:
+         _getNextScaledIntegerN<uint32_t>( values, count, scale, offset );
+         break;
+      case Int64:
+         _getNextScaledIntegerN<int64_t>( values, count, scale, offset );
+         break;
+      case Bool:
+      {
+         const char *p = &base_[nextIndex_ * stride_];
+
+         for ( size_t i = 0; i < count; i++ )
+         {
+            const int boolValue = ( *reinterpret_cast<const bool *>( p ) ) ? 1 : 0;
+            const double doubleRawValue = floor( ( boolValue - offset ) / scale + 0.5 );
+
+            /// Make sure that value is representable in an int64_t
+            if ( doubleRawValue < INT64_MIN || INT64_MAX < doubleRawValue )
+            {
+               throw E57_EXCEPTION2( ErrorScaledValueNotRepresentable,
+                                     "pathName=" + pathName_ +
+                                        " value=" + toString( doubleRawValue ) );
+            }
+
+            values[i] = static_cast<int64_t>( doubleRawValue );
+            p += stride_;
+            nextIndex_++;
+         }
+         break;
+      }
+      case Real32:
+         if ( !doConversion_ )
+         {
+            throw E57_EXCEPTION2( ErrorConversionRequired, "pathName=" + pathName_ );
+         }
+         //??? fault if get special value: NaN, NegInf...
+         if ( ( static_cast<double>( static_cast<float>( scale ) ) == scale ) &&
+              ( static_cast<double>( static_cast<float>( offset ) ) == offset ) )
+         {
+            /// Scale and offset are float-exact, so convert without double
+            /// intermediates (the common case for float point buffers)
+            _getNextScaledIntegerFloatN( values, count, scale, offset );
+         }
+         else
+         {
+            _getNextScaledIntegerN<float>( values, count, scale, offset );
+         }
+         break;
+      case Real64:
+         if ( !doConversion_ )
+         {
+            throw E57_EXCEPTION2( ErrorConversionRequired, "pathName=" + pathName_ );
+         }
+         //??? fault if get special value: NaN, NegInf...
+         _getNextScaledIntegerN<double>( values, count, scale, offset );
+         break;
+      case UString:
+         throw E57_EXCEPTION2( ErrorExpectingNumeric, "pathName=" + pathName_ );
+      default:
+         throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
+   }
+}
+
+void SourceDestBufferImpl::getNextFloatN( float *values, size_t count )
+{
+   /// don't checkImageFileOpen
+
+   /// Verify whole run is within bounds
+   if ( ( count > capacity_ ) || ( nextIndex_ > capacity_ - count ) )
+   {
+      throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
+   }
+
+   /// The conversion-required check is per run; the element loops are pure
+   /// load-convert-store
+   if ( ( memoryRepresentation_ != Real32 ) && ( memoryRepresentation_ != Real64 ) &&
+        !doConversion_ )
+   {
+      throw E57_EXCEPTION2( ErrorConversionRequired, "pathName=" + pathName_ );
+   }
+
+   switch ( memoryRepresentation_ )
+   {
+      case Int8:
+         _getNextRealN<float, int8_t>( values, count );
+         break;
+      case UInt8:
+         _getNextRealN<float, uint8_t>( values, count );
+         break;
+      case Int16:
+         _getNextRealN<float, int16_t>( values, count );
+         break;
+      case UInt16:
+         _getNextRealN<float, uint16_t>( values, count );
+         break;
+      case Int32:
+         _getNextRealN<float, int32_t>( values, count );
+         break;
+      case UInt32:
+         _getNextRealN<float, uint32_t>( values, count );
+         break;
+      case Int64:
+         _getNextRealN<float, int64_t>( values, count );
+         break;
+      case Bool:
+      {
+         const size_t cStride = stride_;
+         const char *E57_RESTRICT p = &base_[nextIndex_ * cStride];
+         float *E57_RESTRICT out = values;
+
+         for ( size_t i = 0; i < count; i++ )
+         {
+            /// Convert bool to 0/1, all non-zero values map to 1.0
+            out[i] = ( *reinterpret_cast<const bool *>( p ) ) ? 1.0F : 0.0F;
+            p += cStride;
+         }
+
+         nextIndex_ += static_cast<unsigned>( count );
+         break;
+      }
+      case Real32:
+         if ( stride_ == sizeof( float ) )
+         {
+            memcpy( values, &base_[nextIndex_ * stride_], count * sizeof( float ) );
+            nextIndex_ += static_cast<unsigned>( count );
+         }
+         else
+         {
+            _getNextRealN<float, float>( values, count );
+         }
+         break;
+      case Real64:
+      {
+         const size_t cStride = stride_;
+         const char *E57_RESTRICT p = &base_[nextIndex_ * cStride];
+         float *E57_RESTRICT out = values;
+
+         for ( size_t i = 0; i < count; i++ )
+         {
+            /// Check that exponent of user's value is not too large for single
+            /// precision number in file.
+            const double d = *reinterpret_cast<const double *>( p );
+
+            if ( d < DOUBLE_MIN || DOUBLE_MAX < d )
+            {
+               throw E57_EXCEPTION2( ErrorReal64TooLarge,
+                                     "pathName=" + pathName_ + " value=" + toString( d ) );
+            }
+
+            out[i] = static_cast<float>( d );
+            p += cStride;
+         }
+
+         nextIndex_ += static_cast<unsigned>( count );
+         break;
+      }
+      case UString:
+         throw E57_EXCEPTION2( ErrorExpectingNumeric, "pathName=" + pathName_ );
+      default:
+         throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
+   }
+}
+
+void SourceDestBufferImpl::getNextDoubleN( double *values, size_t count )
+{
+   /// don't checkImageFileOpen
+
+   /// Verify whole run is within bounds
+   if ( ( count > capacity_ ) || ( nextIndex_ > capacity_ - count ) )
+   {
+      throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
+   }
+
+   /// The conversion-required check is per run; the element loops are pure
+   /// load-convert-store
+   if ( ( memoryRepresentation_ != Real32 ) && ( memoryRepresentation_ != Real64 ) &&
+        !doConversion_ )
+   {
+      throw E57_EXCEPTION2( ErrorConversionRequired, "pathName=" + pathName_ );
+   }
+
+   switch ( memoryRepresentation_ )
+   {
+      case Int8:
+         _getNextRealN<double, int8_t>( values, count );
+         break;
+      case UInt8:
+         _getNextRealN<double, uint8_t>( values, count );
+         break;
+      case Int16:
+         _getNextRealN<double, int16_t>( values, count );
+         break;
+      case UInt16:
+         _getNextRealN<double, uint16_t>( values, count );
+         break;
+      case Int32:
+         _getNextRealN<double, int32_t>( values, count );
+         break;
+      case UInt32:
+         _getNextRealN<double, uint32_t>( values, count );
+         break;
+      case Int64:
+         _getNextRealN<double, int64_t>( values, count );
+         break;
+      case Bool:
+      {
+         const size_t cStride = stride_;
+         const char *E57_RESTRICT p = &base_[nextIndex_ * cStride];
+         double *E57_RESTRICT out = values;
+
+         for ( size_t i = 0; i < count; i++ )
+         {
+            /// Convert bool to 0/1, all non-zero values map to 1.0
+            out[i] = ( *reinterpret_cast<const bool *>( p ) ) ? 1.0 : 0.0;
+            p += cStride;
+         }
+
+         nextIndex_ += static_cast<unsigned>( count );
+         break;
+      }
+      case Real32:
+         _getNextRealN<double, float>( values, count );
+         break;
+      case Real64:
+         if ( stride_ == sizeof( double ) )
+         {
+            memcpy( values, &base_[nextIndex_ * stride_], count * sizeof( double ) );
+            nextIndex_ += static_cast<unsigned>( count );
+         }
+         else
+         {
+            _getNextRealN<double, double>( values, count );
+         }
+         break;
+      case UString:
+         throw E57_EXCEPTION2( ErrorExpectingNumeric, "pathName=" + pathName_ );
+      default:
+         throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
+   }
+}
+
+void SourceDestBufferImpl::setNextInt64N( const int64_t *values, size_t count )
+{
+   /// don't checkImageFileOpen
+
+   /// Verify have room for the whole run
+   if ( ( count > capacity_ ) || ( nextIndex_ > capacity_ - count ) )
+   {
+      throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
+   }
+
+   switch ( memoryRepresentation_ )
+   {
+      case Int8:
+         _setNextIntegerN<int8_t>( values, count );
+         break;
+      case UInt8:
+         _setNextIntegerN<uint8_t>( values, count );
+         break;
+      case Int16:
+         _setNextIntegerN<int16_t>( values, count );
+         break;
+      case UInt16:
+         _setNextIntegerN<uint16_t>( values, count );
+         break;
+      case Int32:
+         _setNextIntegerN<int32_t>( values, count );
+         break;
+      case UInt32:
+         _setNextIntegerN<uint32_t>( values, count );
+         break;
+      case Int64:
+      {
+         char *p = &base_[nextIndex_ * stride_];
+
+         for ( size_t i = 0; i < count; i++ )
+         {
+            *reinterpret_cast<int64_t *>( p ) = values[i];
+            p += stride_;
+         }
+
+         nextIndex_ += static_cast<unsigned>( count );
+         break;
+      }
+      case Bool:
+      {
+         char *p = &base_[nextIndex_ * stride_];
+
+         for ( size_t i = 0; i < count; i++ )
+         {
+            *reinterpret_cast<bool *>( p ) = ( values[i] ? false : true );
+            p += stride_;
+         }
+
+         nextIndex_ += static_cast<unsigned>( count );
+         break;
+      }
+      case Real32:
+      {
+         if ( !doConversion_ )
+         {
+            throw E57_EXCEPTION2( ErrorConversionRequired, "pathName=" + pathName_ );
+         }
+
+         char *p = &base_[nextIndex_ * stride_];
+
+         for ( size_t i = 0; i < count; i++ )
+         {
+            //??? very large integers may lose some lowest bits here. error?
+            *reinterpret_cast<float *>( p ) = static_cast<float>( values[i] );
+            p += stride_;
+         }
+
+         nextIndex_ += static_cast<unsigned>( count );
+         break;
+      }
+      case Real64:
+      {
+         if ( !doConversion_ )
+         {
+            throw E57_EXCEPTION2( ErrorConversionRequired, "pathName=" + pathName_ );
+         }
+
+         char *p = &base_[nextIndex_ * stride_];
+
+         for ( size_t i = 0; i < count; i++ )
+         {
+            *reinterpret_cast<double *>( p ) = static_cast<double>( values[i] );
+            p += stride_;
+         }
+
+         nextIndex_ += static_cast<unsigned>( count );
+         break;
+      }
+      case UString:
+         throw E57_EXCEPTION2( ErrorExpectingNumeric, "pathName=" + pathName_ );
+   }
+}
+
+void SourceDestBufferImpl::setNextInt64N( const int64_t *values, size_t count, double scale,
+                                          double offset )
+{
+   /// don't checkImageFileOpen
+
+   /// Incorporating the scale is optional (requested by user when constructing
+   /// the sdbuf). If the user did not request scaling, then we send raw values
+   /// to user's buffer.
+   if ( !doScaling_ )
+   {
+      /// Use raw value routine, then bail out.
+      setNextInt64N( values, count );
+      return;
+   }
+
+   /// Verify have room for the whole run
+   if ( ( count > capacity_ ) || ( nextIndex_ > capacity_ - count ) )
+   {
+      throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
+   }
+
+   switch ( memoryRepresentation_ )
+   {
+      case Int8:
+         _setNextScaledIntegerN<int8_t>( values, count, scale, offset );
+         break;
+      case UInt8:
+         _setNextScaledIntegerN<uint8_t>( values, count, scale, offset );
+         break;
+      case Int16:
+         _setNextScaledIntegerN<int16_t>( values, count, scale, offset );
+         break;
+      case UInt16:
+         _setNextScaledIntegerN<uint16_t>( values, count, scale, offset );
+         break;
+      case Int32:
+         _setNextScaledIntegerN<int32_t>( values, count, scale, offset );
+         break;
+      case UInt32:
+         _setNextScaledIntegerN<uint32_t>( values, count, scale, offset );
+         break;
+      case Int64:
+      {
+         char *p = &base_[nextIndex_ * stride_];
+
+         for ( size_t i = 0; i < count; i++ )
+         {
+            *reinterpret_cast<int64_t *>( p ) =
+               static_cast<int64_t>( floor( values[i] * scale + offset + 0.5 ) );
+            p += stride_;
+         }
+
+         nextIndex_ += static_cast<unsigned>( count );
+         break;
+      }
+      case Bool:
+      {
+         char *p = &base_[nextIndex_ * stride_];
+
+         for ( size_t i = 0; i < count; i++ )
+         {
+            const double scaledValue = floor( values[i] * scale + offset + 0.5 );
+
+            *reinterpret_cast<bool *>( p ) = ( scaledValue ? false : true );
+            p += stride_;
+         }
+
+         nextIndex_ += static_cast<unsigned>( count );
+         break;
+      }
+      case Real32:
+      {
+         if ( !doConversion_ )
+         {
+            throw E57_EXCEPTION2( ErrorConversionRequired, "pathName=" + pathName_ );
+         }
+
+         char *p = &base_[nextIndex_ * stride_];
+
+         for ( size_t i = 0; i < count; i++ )
+         {
+            /// Value will be stored in some floating point rep in user's
+            /// buffer, so keep full resolution here.
+            const double scaledValue = values[i] * scale + offset;
+
+            /// Check that exponent of result is not too big for single
+            /// precision float
+            if ( scaledValue < DOUBLE_MIN || DOUBLE_MAX < scaledValue )
+            {
+               throw E57_EXCEPTION2( ErrorScaledValueNotRepresentable,
+                                     "pathName=" + pathName_ +
+                                        " scaledValue=" + toString( scaledValue ) );
+            }
+
+            *reinterpret_cast<float *>( p ) = static_cast<float>( scaledValue );
+            p += stride_;
+            nextIndex_++;
+         }
+         break;
+      }
+      case Real64:
+      {
+         if ( !doConversion_ )
+         {
+            throw E57_EXCEPTION2( ErrorConversionRequired, "pathName=" + pathName_ );
+         }
+
+         char *p = &base_[nextIndex_ * stride_];
+
+         for ( size_t i = 0; i < count; i++ )
+         {
+            /// Value will be stored in some floating point rep in user's
+            /// buffer, so keep full resolution here.
+            *reinterpret_cast<double *>( p ) = values[i] * scale + offset;
+            p += stride_;
+         }
+
+         nextIndex_ += static_cast<unsigned>( count );
+         break;
+      }
+      case UString:
+         throw E57_EXCEPTION2( ErrorExpectingNumeric, "pathName=" + pathName_ );
+   }
+}
+
+bool SourceDestBufferImpl::isRawCopyCompatible( size_t elementSize, int64_t minimum,
+                                                int64_t maximum ) const
+{
+   int64_t repMin;
+   int64_t repMax;
+   size_t repSize;
+
+   switch ( memoryRepresentation_ )
+   {
+      case Int8:
+         repMin = INT8_MIN;
+         repMax = INT8_MAX;
+         repSize = sizeof( int8_t );
+         break;
+      case UInt8:
+         repMin = 0;
+         repMax = UINT8_MAX;
+         repSize = sizeof( uint8_t );
+         break;
+      case Int16:
+         repMin = INT16_MIN;
+         repMax = INT16_MAX;
+         repSize = sizeof( int16_t );
+         break;
+      case UInt16:
+         repMin = 0;
+         repMax = UINT16_MAX;
+         repSize = sizeof( uint16_t );
+         break;
+      case Int32:
+         repMin = INT32_MIN;
+         repMax = INT32_MAX;
+         repSize = sizeof( int32_t );
+         break;
+      case UInt32:
+         repMin = 0;
+         repMax = UINT32_MAX;
+         repSize = sizeof( uint32_t );
+         break;
+      case Int64:
+         repMin = INT64_MIN;
+         repMax = INT64_MAX;
+         repSize = sizeof( int64_t );
+         break;
+      default:
+         // Bool, Real32, Real64, and UString always need the conversion layer
+         return false;
+   }
+
+   return ( repSize == elementSize ) && ( repMin <= minimum ) && ( maximum <= repMax );
+}
+
+void SourceDestBufferImpl::setNextRawN( const char *source, size_t count, size_t elementSize )
+{
+   /// don't checkImageFileOpen
+
+   /// Verify have room for the whole run
+   if ( ( count > capacity_ ) || ( nextIndex_ > capacity_ - count ) )
+   {
+      throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
+   }
+
+   char *p = &base_[nextIndex_ * stride_];
+
+   if ( stride_ == elementSize )
+   {
+      /// Elements are contiguous, one copy does the whole run
+      memcpy( p, source, count * elementSize );
+   }
+   else
+   {
+      for ( size_t i = 0; i < count; i++ )
+      {
+         memcpy( p, source, elementSize );
+         p += stride_;
+         source += elementSize;
+      }
+   }
+
+   nextIndex_ += static_cast<unsigned>( count );
+}
+
+void SourceDestBufferImpl::setNextFloat( float value )
+{
+   _setNextReal( value );
+}
+
+void SourceDestBufferImpl::setNextDouble( double value )
+{
+   _setNextReal( value );
+}
+
+void SourceDestBufferImpl::setNextString( const ustring &value )
+{
+   /// don't checkImageFileOpen
+
+   if ( memoryRepresentation_ != UString )
+   {
+      throw E57_EXCEPTION2( ErrorExpectingUString, "pathName=" + pathName_ );
+   }
+
+   /// Verify have room.
+   if ( nextIndex_ >= capacity_ )
+   {
+      throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
+   }
+
+   /// Assign to already initialized element in vector
+   ( *ustrings_ )[nextIndex_] = value;
+   nextIndex_++;
+}
+
+void SourceDestBufferImpl::setNextString( const char *buf, size_t byteCount )
+{
+   /// don't checkImageFileOpen
+
+   if ( memoryRepresentation_ != UString )
+   {
+      throw E57_EXCEPTION2( ErrorExpectingUString, "pathName=" + pathName_ );
+   }
+
+   /// Verify have room.
+   if ( nextIndex_ >= capacity_ )
+   {
+      throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
+   }
+
+   /// Assign to already initialized element in vector
+   ( *ustrings_ )[nextIndex_].assign( buf, byteCount );
    nextIndex_++;
 }
 
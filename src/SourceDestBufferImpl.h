@@ -110,6 +110,48 @@ namespace e57
       void setNextDouble( double value );
       void setNextString( const ustring &value );
 
+      /// Assign the next string in place from a byte range, reusing the
+      /// destination element's capacity instead of staging a temporary
+      /// ustring. The string decoder uses this for records it can hand over
+      /// straight out of the bytestream buffer.
+      void setNextString( const char *buf, size_t byteCount );
+
+      /// Bulk variants of the accessors above: one bounds check for the whole
+      /// run and a type-specialized tight loop, instead of a per-element
+      /// switch on the memory representation.
+      void getNextInt64N( int64_t *values, size_t count );
+      void getNextInt64N( int64_t *values, size_t count, double scale, double offset );
+      void getNextFloatN( float *values, size_t count );
+      void getNextDoubleN( double *values, size_t count );
+      void setNextInt64N( const int64_t *values, size_t count );
+      void setNextInt64N( const int64_t *values, size_t count, double scale, double offset );
+
+      /// Bulk real setters: a matching representation is a single memcpy (or
+      /// a blocked strided copy); other representations fall back to the
+      /// per-element conversion path with its range checks.
+      void setNextFloatN( const float *values, size_t count );
+      void setNextDoubleN( const double *values, size_t count );
+
+      /// Fill variants for constant channels: the value is converted and
+      /// range-checked once, then the stored element bytes are broadcast
+      /// over the rest of the run.
+      void setNextInt64Fill( int64_t value, size_t count );
+      void setNextInt64Fill( int64_t value, size_t count, double scale, double offset );
+
+      /// Peek at element index as a double, without advancing nextIndex().
+      /// The tile index uses this to take coordinate bounds of the records
+      /// about to be encoded. Not valid for ustring buffers.
+      double valueAsDouble( size_t index ) const;
+
+      /// True if a packed run of elementSize-byte integer records covering
+      /// [minimum, maximum] can be copied into this buffer byte-for-byte,
+      /// without conversion, range checking, or scaling.
+      bool isRawCopyCompatible( size_t elementSize, int64_t minimum, int64_t maximum ) const;
+
+      /// Copy a run of elementSize-byte records straight into the buffer.
+      /// Only valid when isRawCopyCompatible() said so.
+      void setNextRawN( const char *source, size_t count, size_t elementSize );
+
       void checkCompatible( const std::shared_ptr<SourceDestBufferImpl> &newBuf ) const;
 
 #ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
@@ -118,6 +160,19 @@ namespace e57
 
    private:
       template <typename T> void _setNextReal( T inValue );
+      template <typename T> void _setNextRealN( const T *values, size_t count );
+      void _replicateLastElement( size_t count );
+
+      template <typename T> void _getNextIntegerN( int64_t *values, size_t count );
+      template <typename D, typename S> void _getNextRealN( D *values, size_t count );
+      template <typename T>
+      void _getNextScaledIntegerN( int64_t *values, size_t count, double scale, double offset );
+      void _getNextScaledIntegerFloatN( int64_t *values, size_t count, double scale,
+                                        double offset );
+      template <typename T> void _setNextIntegerN( const int64_t *values, size_t count );
+      template <typename T>
+      void _setNextScaledIntegerN( const int64_t *values, size_t count, double scale,
+                                   double offset );
 
       /// Common routine to check that constructor arguments were ok, throws if not
       void checkState_() const;
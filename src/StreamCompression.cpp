@@ -0,0 +1,502 @@
+/*
+ * Original work Copyright 2009 - 2010 Kevin Ackley (kackley@gwi.net)
+ * Modified work Copyright 2018 - 2020 Andy Maloney <asmaloney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "CompressedVectorNodeImpl.h"
+#include "StreamCompression.h"
+#include "StringFunctions.h"
+#include "StringNodeImpl.h"
+#include "StructureNodeImpl.h"
+#include "VectorNodeImpl.h"
+
+/// Block format (byte oriented, independent of the bitpacked content):
+/// a sequence of tokens, each a literal run followed by a back reference.
+///
+///    token byte:       literal count in the high 4 bits, match length - 4
+///                      in the low 4 bits
+///    extra counts:     a 4-bit count of 15 is extended by further bytes,
+///                      each adding 0 - 255, ending with a byte below 255
+///    literal bytes:    copied to the output as-is
+///    match offset:     2 bytes little endian, 1 - 65535 back from the
+///                      current output position; matches may overlap it
+///
+/// The last token carries only literals: decoding stops when the known raw
+/// byte count has been produced, so no offset follows them.
+
+namespace e57
+{
+   namespace
+   {
+      /// Does any codecs vector entry marked with codecElement list pathName
+      /// among its "inputs"?  Shared by the "lzbs" and "dlta" negotiations.
+      bool _codecRequested( const CompressedVectorNodeImpl *cVector, const char *codecElement,
+                            const ustring &pathName );
+   }
+
+   bool streamCompressionRequested( const CompressedVectorNodeImpl *cVector,
+                                    const ustring &pathName )
+   {
+      return _codecRequested( cVector, COMPRESSED_STREAM_CODEC, pathName );
+   }
+
+   bool streamDeltaRequested( const CompressedVectorNodeImpl *cVector, const ustring &pathName )
+   {
+      return _codecRequested( cVector, DELTA_STREAM_CODEC, pathName );
+   }
+
+   namespace
+   {
+      bool _codecRequested( const CompressedVectorNodeImpl *cVector, const char *codecElement,
+                            const ustring &pathName )
+      {
+         std::shared_ptr<VectorNodeImpl> codecs = cVector->getCodecs();
+
+         if ( !codecs )
+         {
+            return false;
+         }
+
+         const int64_t cCodecCount = codecs->childCount();
+
+         for ( int64_t codecIndex = 0; codecIndex < cCodecCount; ++codecIndex )
+         {
+            NodeImplSharedPtr entry = codecs->get( codecIndex );
+
+            if ( ( entry->type() != TypeStructure ) || !entry->isDefined( codecElement ) ||
+                 !entry->isDefined( "inputs" ) )
+            {
+               continue;
+            }
+
+            std::shared_ptr<StructureNodeImpl> entryStruct =
+               std::static_pointer_cast<StructureNodeImpl>( entry );
+            NodeImplSharedPtr inputs = entryStruct->get( "inputs" );
+
+            if ( inputs->type() != TypeVector )
+            {
+               continue;
+            }
+
+            std::shared_ptr<VectorNodeImpl> inputsVector =
+               std::static_pointer_cast<VectorNodeImpl>( inputs );
+            const int64_t cInputCount = inputsVector->childCount();
+
+            for ( int64_t inputIndex = 0; inputIndex < cInputCount; ++inputIndex )
+            {
+               NodeImplSharedPtr input = inputsVector->get( inputIndex );
+
+               if ( ( input->type() == TypeString ) &&
+                    ( std::static_pointer_cast<StringNodeImpl>( input )->value() == pathName ) )
+               {
+                  return true;
+               }
+            }
+         }
+
+         return false;
+      }
+   }
+
+   namespace
+   {
+      constexpr unsigned cHashBits = 13;
+      constexpr size_t cMinMatch = 4;
+      constexpr size_t cMaxOffset = 65535;
+
+      inline unsigned _hashSequence( uint32_t sequence )
+      {
+         return ( sequence * 2654435761U ) >> ( 32 - cHashBits );
+      }
+
+      inline uint32_t _readSequence( const uint8_t *raw, size_t index )
+      {
+         uint32_t sequence;
+
+         memcpy( &sequence, &raw[index], sizeof( sequence ) );
+         return sequence;
+      }
+
+      /// Append a count that exceeded its 4-bit field (see format above)
+      inline void _writeExtraCount( uint8_t *dest, size_t &destIndex, size_t value )
+      {
+         while ( value >= 255 )
+         {
+            dest[destIndex++] = 255;
+            value -= 255;
+         }
+
+         dest[destIndex++] = static_cast<uint8_t>( value );
+      }
+   }
+
+   size_t compressBound( size_t rawCount )
+   {
+      // All-literal worst case: one token plus extra count bytes per block
+      return rawCount + rawCount / 255 + 16;
+   }
+
+   size_t compressBlock( const uint8_t *raw, size_t rawCount, uint8_t *dest )
+   {
+      // Greedy parse: hash the 4 bytes at the cursor, probe the last
+      // position that hashed the same, and take the match if it is real and
+      // near enough; otherwise move on one byte. Positions are stored + 1 so
+      // 0 can mean empty.
+      std::vector<uint32_t> table( size_t( 1 ) << cHashBits, 0 );
+
+      size_t srcIndex = 0;
+      size_t literalStart = 0;
+      size_t destIndex = 0;
+
+      auto emitToken = [&]( size_t literalCount, size_t matchLength ) {
+         const size_t cLiteralNibble = std::min<size_t>( literalCount, 15 );
+         const size_t cMatchNibble =
+            ( matchLength > 0 ) ? std::min<size_t>( matchLength - cMinMatch, 15 ) : 0;
+
+         dest[destIndex++] = static_cast<uint8_t>( ( cLiteralNibble << 4 ) | cMatchNibble );
+
+         if ( cLiteralNibble == 15 )
+         {
+            _writeExtraCount( dest, destIndex, literalCount - 15 );
+         }
+
+         memcpy( &dest[destIndex], &raw[literalStart], literalCount );
+         destIndex += literalCount;
+      };
+
+      while ( srcIndex + cMinMatch <= rawCount )
+      {
+         const uint32_t cSequence = _readSequence( raw, srcIndex );
+         const unsigned cSlot = _hashSequence( cSequence );
+         const uint32_t cCandidate = table[cSlot];
+
+         table[cSlot] = static_cast<uint32_t>( srcIndex ) + 1;
+
+         if ( ( cCandidate != 0 ) && ( srcIndex + 1 - cCandidate <= cMaxOffset ) &&
+              ( _readSequence( raw, cCandidate - 1 ) == cSequence ) )
+         {
+            const size_t cMatchStart = cCandidate - 1;
+            size_t matchLength = cMinMatch;
+
+            while ( ( srcIndex + matchLength < rawCount ) &&
+                    ( raw[cMatchStart + matchLength] == raw[srcIndex + matchLength] ) )
+            {
+               ++matchLength;
+            }
+
+            const size_t cOffset = srcIndex - cMatchStart;
+
+            emitToken( srcIndex - literalStart, matchLength );
+
+            dest[destIndex++] = static_cast<uint8_t>( cOffset & 0xFF );
+            dest[destIndex++] = static_cast<uint8_t>( cOffset >> 8 );
+
+            if ( matchLength - cMinMatch >= 15 )
+            {
+               _writeExtraCount( dest, destIndex, matchLength - cMinMatch - 15 );
+            }
+
+            srcIndex += matchLength;
+            literalStart = srcIndex;
+         }
+         else
+         {
+            ++srcIndex;
+         }
+      }
+
+      // Trailing literals, no back reference after them. A block ending
+      // exactly on a match has no trailing token: the decoder stops once the
+      // known raw count has been produced.
+      if ( rawCount > literalStart )
+      {
+         emitToken( rawCount - literalStart, 0 );
+      }
+
+      return destIndex;
+   }
+
+   void decompressBlock( const uint8_t *source, size_t sourceCount, uint8_t *raw,
+                         size_t rawCount )
+   {
+      size_t srcIndex = 0;
+      size_t rawIndex = 0;
+
+      auto readCount = [&]( size_t nibble ) {
+         size_t value = nibble;
+
+         if ( nibble == 15 )
+         {
+            uint8_t extra;
+
+            do
+            {
+               if ( srcIndex >= sourceCount )
+               {
+                  throw E57_EXCEPTION2( ErrorBadCVPacket,
+                                        "srcIndex=" + toString( srcIndex ) +
+                                           " sourceCount=" + toString( sourceCount ) );
+               }
+
+               extra = source[srcIndex++];
+               value += extra;
+            } while ( extra == 255 );
+         }
+
+         return value;
+      };
+
+      while ( rawIndex < rawCount )
+      {
+         if ( srcIndex >= sourceCount )
+         {
+            throw E57_EXCEPTION2( ErrorBadCVPacket, "srcIndex=" + toString( srcIndex ) +
+                                                       " sourceCount=" + toString( sourceCount ) );
+         }
+
+         const uint8_t cToken = source[srcIndex++];
+         const size_t cLiteralCount = readCount( cToken >> 4 );
+
+         if ( ( srcIndex + cLiteralCount > sourceCount ) ||
+              ( rawIndex + cLiteralCount > rawCount ) )
+         {
+            throw E57_EXCEPTION2( ErrorBadCVPacket,
+                                  "literalCount=" + toString( cLiteralCount ) +
+                                     " rawIndex=" + toString( rawIndex ) );
+         }
+
+         memcpy( &raw[rawIndex], &source[srcIndex], cLiteralCount );
+         srcIndex += cLiteralCount;
+         rawIndex += cLiteralCount;
+
+         // The last token carries only literals
+         if ( rawIndex == rawCount )
+         {
+            break;
+         }
+
+         if ( srcIndex + 2 > sourceCount )
+         {
+            throw E57_EXCEPTION2( ErrorBadCVPacket, "srcIndex=" + toString( srcIndex ) +
+                                                       " sourceCount=" + toString( sourceCount ) );
+         }
+
+         const size_t cOffset =
+            source[srcIndex] | ( static_cast<size_t>( source[srcIndex + 1] ) << 8 );
+
+         srcIndex += 2;
+
+         const size_t cMatchLength = cMinMatch + readCount( cToken & 0x0F );
+
+         if ( ( cOffset == 0 ) || ( cOffset > rawIndex ) ||
+              ( rawIndex + cMatchLength > rawCount ) )
+         {
+            throw E57_EXCEPTION2( ErrorBadCVPacket, "offset=" + toString( cOffset ) +
+                                                       " matchLength=" +
+                                                       toString( cMatchLength ) );
+         }
+
+         // Byte by byte, since the match may overlap the output position
+         for ( size_t i = 0; i < cMatchLength; ++i )
+         {
+            raw[rawIndex] = raw[rawIndex - cOffset];
+            ++rawIndex;
+         }
+      }
+
+      if ( srcIndex != sourceCount )
+      {
+         throw E57_EXCEPTION2( ErrorBadCVPacket, "srcIndex=" + toString( srcIndex ) +
+                                                    " sourceCount=" + toString( sourceCount ) );
+      }
+   }
+
+   size_t deltaBlockBound( size_t recordCount )
+   {
+      // 64 bit deltas all round
+      return DELTA_STREAM_HEADER_SIZE + 8 * ( recordCount - 1 );
+   }
+
+   size_t packDeltaBlock( const uint64_t *values, size_t recordCount, uint8_t *dest )
+   {
+      // Zigzag-code the deltas (sign bit moved to the LSB, so small
+      // movements in either direction stay small) and find the block's width
+      std::vector<uint64_t> zigzags;
+      unsigned deltaBits = 0;
+
+      zigzags.reserve( recordCount - 1 );
+
+      for ( size_t i = 1; i < recordCount; ++i )
+      {
+         const auto cDelta = static_cast<int64_t>( values[i] - values[i - 1] );
+         const uint64_t cZigzag =
+            ( static_cast<uint64_t>( cDelta ) << 1 ) ^ static_cast<uint64_t>( cDelta >> 63 );
+
+         zigzags.push_back( cZigzag );
+
+         while ( ( deltaBits < 64 ) && ( cZigzag >> deltaBits ) != 0 )
+         {
+            ++deltaBits;
+         }
+      }
+
+      // Block header (see the layout in StreamCompression.h)
+      const size_t cPackedSize = ( deltaBits * ( recordCount - 1 ) + 7 ) / 8;
+      const auto cCount16 = static_cast<uint16_t>( recordCount );
+
+      memcpy( dest, &cCount16, sizeof( cCount16 ) );
+      dest[2] = static_cast<uint8_t>( deltaBits );
+      memcpy( dest + 3, &values[0], sizeof( uint64_t ) );
+      memset( dest + DELTA_STREAM_HEADER_SIZE, 0, cPackedSize );
+
+      // Pack the zigzag deltas LSB first at deltaBits each; whole bytes are
+      // flushed eagerly so at most 7 bits stay in the register
+      uint8_t *packed = dest + DELTA_STREAM_HEADER_SIZE;
+      size_t packedIndex = 0;
+      uint64_t register_ = 0;
+      unsigned registerBitsUsed = 0;
+
+      for ( const uint64_t cZigzag : zigzags )
+      {
+         if ( registerBitsUsed + deltaBits <= 64 )
+         {
+            register_ |= cZigzag << registerBitsUsed;
+            registerBitsUsed += deltaBits;
+         }
+         else
+         {
+            // The value straddles the 64 bit register: store the low part,
+            // flush, and keep the high part
+            register_ |= cZigzag << registerBitsUsed;
+            memcpy( &packed[packedIndex], &register_, sizeof( register_ ) );
+            packedIndex += sizeof( register_ );
+            register_ = cZigzag >> ( 64 - registerBitsUsed );
+            registerBitsUsed += deltaBits - 64;
+         }
+
+         while ( registerBitsUsed >= 8 )
+         {
+            packed[packedIndex++] = static_cast<uint8_t>( register_ );
+            register_ >>= 8;
+            registerBitsUsed -= 8;
+         }
+      }
+
+      if ( registerBitsUsed > 0 )
+      {
+         packed[packedIndex] = static_cast<uint8_t>( register_ );
+      }
+
+      return DELTA_STREAM_HEADER_SIZE + cPackedSize;
+   }
+
+   size_t deltaBlockByteCount( const uint8_t *header )
+   {
+      uint16_t recordCount;
+
+      memcpy( &recordCount, header, sizeof( recordCount ) );
+
+      const unsigned cDeltaBits = header[2];
+
+      // The writer never emits an empty, oversize, or overwide block
+      if ( ( recordCount == 0 ) || ( recordCount > DELTA_STREAM_BLOCK_RECORDS ) ||
+           ( cDeltaBits > 64 ) )
+      {
+         throw E57_EXCEPTION2( ErrorBadCVPacket, "recordCount=" + toString( recordCount ) +
+                                                    " deltaBits=" + toString( cDeltaBits ) );
+      }
+
+      return DELTA_STREAM_HEADER_SIZE +
+             ( cDeltaBits * ( static_cast<size_t>( recordCount ) - 1 ) + 7 ) / 8;
+   }
+
+   size_t unpackDeltaBlock( const uint8_t *source, size_t sourceCount, uint64_t *values )
+   {
+      if ( ( sourceCount < DELTA_STREAM_HEADER_SIZE ) ||
+           ( sourceCount != deltaBlockByteCount( source ) ) )
+      {
+         throw E57_EXCEPTION2( ErrorBadCVPacket, "sourceCount=" + toString( sourceCount ) );
+      }
+
+      uint16_t recordCount;
+
+      memcpy( &recordCount, source, sizeof( recordCount ) );
+
+      const unsigned cDeltaBits = source[2];
+
+      uint64_t value;
+
+      memcpy( &value, source + 3, sizeof( value ) );
+      values[0] = value;
+
+      // Zero padding so the unaligned 64 bit window loads below can't
+      // overrun the source
+      std::vector<uint8_t> packed( ( sourceCount - DELTA_STREAM_HEADER_SIZE ) + 8, 0 );
+
+      memcpy( packed.data(), source + DELTA_STREAM_HEADER_SIZE,
+              sourceCount - DELTA_STREAM_HEADER_SIZE );
+
+      const uint64_t cMask =
+         ( cDeltaBits == 64 ) ? UINT64_MAX : ( ( uint64_t( 1 ) << cDeltaBits ) - 1 );
+      size_t bitPos = 0;
+
+      for ( unsigned i = 1; i < recordCount; ++i )
+      {
+         uint64_t zigzag = 0;
+
+         if ( cDeltaBits > 0 )
+         {
+            const size_t cFirstByte = bitPos >> 3;
+            const unsigned cShift = bitPos & 7;
+            uint64_t window;
+
+            memcpy( &window, &packed[cFirstByte], sizeof( window ) );
+            zigzag = window >> cShift;
+
+            // A value straddling the 64 bit window needs its top bits from
+            // the ninth byte
+            if ( cShift + cDeltaBits > 64 )
+            {
+               zigzag |= static_cast<uint64_t>( packed[cFirstByte + 8] ) << ( 64 - cShift );
+            }
+
+            zigzag &= cMask;
+            bitPos += cDeltaBits;
+         }
+
+         // Undo the zigzag coding; wrap-safe unsigned arithmetic
+         const uint64_t cSignMask = 0 - ( zigzag & 1 );
+
+         value += ( zigzag >> 1 ) ^ cSignMask;
+         values[i] = value;
+      }
+
+      return recordCount;
+   }
+}
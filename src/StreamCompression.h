@@ -0,0 +1,130 @@
+#pragma once
+/*
+ * Original work Copyright 2009 - 2010 Kevin Ackley (kackley@gwi.net)
+ * Modified work Copyright 2018 - 2020 Andy Maloney <asmaloney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "Common.h"
+
+namespace e57
+{
+   class CompressedVectorNodeImpl;
+
+   /// Optional "lzbs" vendor extension: general-purpose compression of
+   /// bytestreams inside CompressedVector data packets.  The bitpacked
+   /// bytestream of a field is cut into blocks and each block is stored
+   /// LZ77-compressed (byte-oriented, self-contained format below), which
+   /// shrinks archived scans well beyond what bitpacking alone achieves and
+   /// cuts read I/O accordingly.  Writing is opt-in: the file must have the
+   /// extension prefix registered (ImageFile::extensionsAdd) and the
+   /// CompressedVector's codecs vector must hold an entry naming the fields
+   /// to compress (see streamCompressionRequested()).  Extension-aware
+   /// readers negotiate the decoder from the same codecs entry; other
+   /// readers reject the unknown codec instead of misreading the packets.
+
+   constexpr const char *COMPRESSED_STREAM_PREFIX = "lzbs";
+   constexpr const char *COMPRESSED_STREAM_URI =
+      "https://github.com/asmaloney/libE57Format/lzbs";
+
+   /// Element marking a codecs vector entry as using this codec.  The entry
+   /// follows the standard codec shape: a structure holding an "inputs"
+   /// vector of prototype pathnames plus this (empty) structure element.
+   constexpr const char *COMPRESSED_STREAM_CODEC = "lzbs:compressedCodec";
+
+   /// Number of bitpacked bytes compressed as one block.  Each block is
+   /// framed with its raw and stored byte counts, so a reader can stage one
+   /// decompressed block at a time; 64KB keeps that staging within a data
+   /// packet's order of magnitude while giving the compressor enough history
+   /// to find matches.
+   constexpr size_t COMPRESSED_STREAM_BLOCK_SIZE = 64 * 1024;
+
+   /// Does the codecs vector of cVector request compression of the
+   /// bytestream holding the prototype field pathName?
+   bool streamCompressionRequested( const CompressedVectorNodeImpl *cVector,
+                                    const ustring &pathName );
+
+   /// Largest possible compressBlock() output for rawCount input bytes
+   size_t compressBound( size_t rawCount );
+
+   /// Compress one block; dest must hold compressBound( rawCount ) bytes.
+   /// Returns the compressed byte count, which can exceed rawCount for
+   /// incompressible input (the encoder then stores the block raw).
+   size_t compressBlock( const uint8_t *raw, size_t rawCount, uint8_t *dest );
+
+   /// Decompress one block of exactly rawCount original bytes.
+   /// Throws ErrorBadCVPacket if source is not a well formed block.
+   void decompressBlock( const uint8_t *source, size_t sourceCount, uint8_t *raw,
+                         size_t rawCount );
+
+   /// Optional "dlta" vendor extension: delta/predictive preprocessing of
+   /// integer and scaled-integer bytestreams.  Scan-line ordered coordinates
+   /// change little between neighbouring records, so their differences need
+   /// far fewer bits than the absolute values the bitpack codec stores.
+   /// DeltaIntegerEncoder / DeltaIntegerDecoder encode each field as zigzag
+   /// deltas in byte-aligned blocks with a per-block bit width:
+   ///
+   ///    uint16 LE     record count of the block (1 - DELTA_STREAM_BLOCK_RECORDS)
+   ///    uint8         delta bit width (0 - 64)
+   ///    uint64 LE     first record of the block, biased by the field minimum
+   ///    packed bits   (count - 1) zigzag deltas, LSB first at the stated
+   ///                  width, padded to a byte boundary
+   ///
+   /// Each block restarts from an absolute value, so decoding needs no state
+   /// across blocks.  Opt-in and negotiated exactly like the "lzbs" codec
+   /// above; the two compose (delta first, then block compression).
+
+   constexpr const char *DELTA_STREAM_PREFIX = "dlta";
+   constexpr const char *DELTA_STREAM_URI = "https://github.com/asmaloney/libE57Format/dlta";
+   constexpr const char *DELTA_STREAM_CODEC = "dlta:deltaCodec";
+
+   /// Records per delta block: the 11 byte block header amortizes to under
+   /// 0.1 bits per record, while the per-block width tracks local behaviour
+   /// (edges, range jumps) instead of the whole scan's worst case.
+   constexpr size_t DELTA_STREAM_BLOCK_RECORDS = 1024;
+
+   /// Bytes of the block header above
+   constexpr size_t DELTA_STREAM_HEADER_SIZE = 2 + 1 + 8;
+
+   /// Does the codecs vector of cVector request delta preprocessing of the
+   /// bytestream holding the prototype field pathName?
+   bool streamDeltaRequested( const CompressedVectorNodeImpl *cVector, const ustring &pathName );
+
+   /// Largest possible packDeltaBlock() output for recordCount records
+   size_t deltaBlockBound( size_t recordCount );
+
+   /// Pack one block of minimum-biased values; dest must hold
+   /// deltaBlockBound( recordCount ) bytes. Returns the byte count written.
+   size_t packDeltaBlock( const uint64_t *values, size_t recordCount, uint8_t *dest );
+
+   /// Total byte count of the block whose first DELTA_STREAM_HEADER_SIZE
+   /// bytes are at header. Throws ErrorBadCVPacket if the header is not well
+   /// formed.
+   size_t deltaBlockByteCount( const uint8_t *header );
+
+   /// Unpack one complete block; values must hold DELTA_STREAM_BLOCK_RECORDS
+   /// minimum-biased values. Returns the block's record count. Throws
+   /// ErrorBadCVPacket if source is not a well formed block.
+   size_t unpackDeltaBlock( const uint8_t *source, size_t sourceCount, uint64_t *values );
+}
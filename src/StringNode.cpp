@@ -248,7 +248,7 @@ StringNode::StringNode( const Node &n )
 }
 
 /// @cond documentNonPublic The following isn't part of the API, and isn't documented.
-StringNode::StringNode( std::shared_ptr<StringNodeImpl> ni ) : impl_( ni )
+StringNode::StringNode( std::shared_ptr<StringNodeImpl> ni ) : impl_( std::move( ni ) )
 {
 }
 /// @endcond
@@ -407,7 +407,7 @@ StructureNode::StructureNode( std::weak_ptr<ImageFileImpl> fileParent ) :
 {
 }
 
-StructureNode::StructureNode( std::shared_ptr<StructureNodeImpl> ni ) : impl_( ni )
+StructureNode::StructureNode( std::shared_ptr<StructureNodeImpl> ni ) : impl_( std::move( ni ) )
 {
 }
 /// @endcond
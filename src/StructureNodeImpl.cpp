@@ -60,6 +60,10 @@ bool StructureNodeImpl::isTypeEquivalent( NodeImplSharedPtr ni )
    // Downcast to shared_ptr<StructureNodeImpl>
    std::shared_ptr<StructureNodeImpl> si( std::static_pointer_cast<StructureNodeImpl>( ni ) );
 
+   // Comparison walks both full trees
+   materializeChildren();
+   si->materializeChildren();
+
    // Same number of children?
    if ( childCount() != si->childCount() )
    {
@@ -108,10 +112,14 @@ void StructureNodeImpl::setAttachedRecursive()
    // Mark this node as attached to an ImageFile
    isAttached_ = true;
 
-   // Not a leaf node, so mark all our children
+   // Not a leaf node, so mark all our children. Deferred children are still
+   // nullptr here; they are marked when materializeChild() links them in.
    for ( auto &child : children_ )
    {
-      child->setAttachedRecursive();
+      if ( child )
+      {
+         child->setAttachedRecursive();
+      }
    }
 }
 
@@ -131,6 +139,7 @@ NodeImplSharedPtr StructureNodeImpl::get( int64_t index )
                             "this->pathName=" + this->pathName() + " index=" + toString( index ) +
                                " size=" + toString( children_.size() ) );
    }
+   materializeChild( static_cast<size_t>( index ) );
    return ( children_.at( static_cast<unsigned>( index ) ) );
 }
 
@@ -170,12 +179,37 @@ NodeImplSharedPtr StructureNodeImpl::lookup( const ustring &pathName )
       }
 
       // Find child with elementName that matches first field in path
-      unsigned i;
-      for ( i = 0; i < children_.size(); i++ )
+      auto i = static_cast<unsigned>( children_.size() ); // "not found" marker
+
+      if ( deferredChildren_.empty() )
       {
-         if ( fields.at( 0 ) == children_.at( i )->elementName() )
+         const auto indexIt = childIndex_.find( fields.at( 0 ) );
+         if ( indexIt != childIndex_.end() )
          {
-            break;
+            i = indexIt->second;
+         }
+      }
+      else
+      {
+         // A deferred (not yet parsed) child is an unnamed vector element
+         // whose element name is its index, so it can be matched without
+         // parsing it.
+         for ( i = 0; i < children_.size(); i++ )
+         {
+            if ( !children_.at( i ) )
+            {
+               if ( fields.at( 0 ) == toString( i ) )
+               {
+                  materializeChild( i );
+                  break;
+               }
+               continue;
+            }
+
+            if ( fields.at( 0 ) == children_.at( i )->elementName() )
+            {
+               break;
+            }
          }
       }
       if ( i == children_.size() )
@@ -246,6 +280,7 @@ void StructureNodeImpl::set( int64_t index64, NodeImplSharedPtr ni )
    }
 
    ni->setParent( shared_from_this(), elementName.str() );
+   childIndex_.emplace( elementName.str(), static_cast<unsigned>( children_.size() ) );
    children_.push_back( ni );
 }
 
@@ -302,23 +337,24 @@ void StructureNodeImpl::set( const std::vector<ustring> &fields, unsigned level,
       throw E57_EXCEPTION2( ErrorSetTwice, "this->pathName=" + this->pathName() + " element=/" );
    }
 
-   // Serial search for matching field name, if find match, have error since can't set twice
-   for ( auto &child : children_ )
+   // The name index below only covers materialized children
+   materializeChildren();
+
+   // Search for matching field name, if find match, have error since can't set twice
+   const auto indexIt = childIndex_.find( fields.at( level ) );
+   if ( indexIt != childIndex_.end() )
    {
-      if ( fields.at( level ) == child->elementName() )
+      if ( level == fields.size() - 1 )
       {
-         if ( level == fields.size() - 1 )
-         {
-            // Enforce "set once" policy, don't allow reset
-            throw E57_EXCEPTION2( ErrorSetTwice, "this->pathName=" + this->pathName() +
-                                                    " element=" + fields[level] );
-         }
+         // Enforce "set once" policy, don't allow reset
+         throw E57_EXCEPTION2( ErrorSetTwice,
+                               "this->pathName=" + this->pathName() + " element=" + fields[level] );
+      }
 
-         // Recurse on child
-         child->set( fields, level + 1, ni );
+      // Recurse on child
+      children_.at( indexIt->second )->set( fields, level + 1, ni );
 
-         return;
-      }
+      return;
    }
    // Didn't find matching field name, so have a new child.
 
@@ -333,6 +369,7 @@ void StructureNodeImpl::set( const std::vector<ustring> &fields, unsigned level,
    {
       // At bottom, so append node at end of children
       ni->setParent( shared_from_this(), fields.at( level ) );
+      childIndex_.emplace( fields.at( level ), static_cast<unsigned>( children_.size() ) );
       children_.push_back( ni );
    }
    else
@@ -365,11 +402,69 @@ void StructureNodeImpl::append( NodeImplSharedPtr ni )
    set( childCount(), ni );
 }
 
+void StructureNodeImpl::setDeferredChildren( const std::vector<XmlByteRange> &ranges )
+{
+   // don't checkImageFileOpen, only called while the ImageFile is being opened
+
+   // Only an empty node can take deferred children, otherwise the index-based
+   // element names of the placeholders would be wrong
+   if ( !children_.empty() )
+   {
+      throw E57_EXCEPTION2( ErrorInternal, "this->pathName=" + this->pathName() +
+                                              " size=" + toString( children_.size() ) );
+   }
+
+   children_.assign( ranges.size(), nullptr );
+   deferredChildren_ = ranges;
+}
+
+void StructureNodeImpl::materializeChild( size_t index )
+{
+   if ( deferredChildren_.empty() || children_.at( index ) )
+   {
+      return;
+   }
+
+   ImageFileImplSharedPtr imf( destImageFile_ );
+   NodeImplSharedPtr child = imf->parseLazyNode( deferredChildren_.at( index ) );
+
+   // Splice the child into the tree at its placeholder slot. This mirrors
+   // setParent(), except the child arrives already parented to the throwaway
+   // wrapper of its fragment parse, so the parent is overwritten directly.
+   // Deferred children are vector elements, so the element name is the index.
+   child->parent_ = shared_from_this();
+   child->elementName_ = toString( index );
+   if ( isAttached_ )
+   {
+      child->setAttachedRecursive();
+   }
+
+   childIndex_.emplace( child->elementName_, static_cast<unsigned>( index ) );
+   children_.at( index ) = child;
+}
+
+void StructureNodeImpl::materializeChildren()
+{
+   if ( deferredChildren_.empty() )
+   {
+      return;
+   }
+
+   for ( size_t i = 0; i < children_.size(); i++ )
+   {
+      materializeChild( i );
+   }
+
+   deferredChildren_.clear();
+}
+
 //??? use visitor?
 void StructureNodeImpl::checkLeavesInSet( const StringSet &pathNames, NodeImplSharedPtr origin )
 {
    // don't checkImageFileOpen
 
+   materializeChildren();
+
    // Not a leaf node, so check all our children
    for ( auto &child : children_ )
    {
@@ -383,6 +478,8 @@ void StructureNodeImpl::writeXml( ImageFileImplSharedPtr imf, CheckedFile &cf, i
 {
    // don't checkImageFileOpen
 
+   materializeChildren();
+
    ustring fieldName;
    if ( forcedFieldName != nullptr )
    {
@@ -460,7 +557,14 @@ void StructureNodeImpl::dump( int indent, std::ostream &os ) const
    for ( unsigned i = 0; i < children_.size(); i++ )
    {
       os << space( indent ) << "child[" << i << "]:" << std::endl;
-      children_.at( i )->dump( indent + 2, os );
+      if ( children_.at( i ) )
+      {
+         children_.at( i )->dump( indent + 2, os );
+      }
+      else
+      {
+         os << space( indent + 2 ) << "<deferred, not yet parsed>" << std::endl;
+      }
    }
 }
 #endif
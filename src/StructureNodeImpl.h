@@ -27,6 +27,8 @@
 
 #pragma once
 
+#include <unordered_map>
+
 #include "NodeImpl.h"
 
 namespace e57
@@ -60,6 +62,12 @@ namespace e57
       void writeXml( ImageFileImplSharedPtr imf, CheckedFile &cf, int indent,
                      const char *forcedFieldName = nullptr ) override;
 
+      /// Install children that exist in the file's XML section but haven't
+      /// been parsed yet (lazy reading of vector children). Each child's slot
+      /// in children_ holds a nullptr until its byte range is parsed on first
+      /// access. Only legal on an empty node.
+      void setDeferredChildren( const std::vector<XmlByteRange> &ranges );
+
 #ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
       void dump( int indent = 0, std::ostream &os = std::cout ) const override;
 #endif
@@ -69,6 +77,19 @@ namespace e57
 
       NodeImplSharedPtr lookup( const ustring &pathName ) override;
 
+      void materializeChild( size_t index );
+      void materializeChildren();
+
       std::vector<NodeImplSharedPtr> children_;
+
+      /// Index into children_ by element name, so path lookup doesn't have to
+      /// compare names linearly. Children are never removed or renamed, so
+      /// entries are only ever added. Deferred (nullptr) children are absent
+      /// until materialized.
+      std::unordered_map<ustring, unsigned> childIndex_;
+
+      /// Byte ranges of deferred children, parallel to children_; empty when
+      /// every child is materialized
+      std::vector<XmlByteRange> deferredChildren_;
    };
 }
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2026 Andy Maloney <asmaloney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/// @file TaskScheduler.cpp
+
+#include "Common.h"
+
+#include "TaskSchedulerImpl.h"
+
+using namespace e57;
+
+/*!
+@brief Run the library's parallel work on the application's own scheduler.
+
+@param [in] executor Function the library hands its tasks to, or an empty std::function to return
+to the library's own workers.
+
+@details
+By default the library starts its own worker threads (shared by every reader and writer in the
+process, see TaskScheduler::setWorkerLimit) the first time parallel work comes up. A process that
+already runs a host-wide scheduler can instead inject an executor here: from then on the library
+submits each unit of parallel work to @a executor instead of its own workers, so library work and
+application work share one view of the machine.
+
+The executor may run a task on any thread, including inline on the submitting one; it must run
+every task it accepts exactly once. Tasks are short-lived and never block waiting for other tasks,
+so they are safe to run on a bounded pool. The thread that called the library always participates
+in its own work too, so even an executor that drops tasks cannot hang a transfer - it only loses
+parallelism.
+
+Set the executor once, before heavy use; workers the library already started stay idle once an
+executor is set.
+
+@throw No E57Exceptions.
+
+@see TaskScheduler::setWorkerLimit
+*/
+void TaskScheduler::setExecutor( Executor executor )
+{
+   TaskSchedulerImpl::instance().setExecutor( std::move( executor ) );
+}
+
+/*!
+@brief Bound how many worker threads the library may start.
+
+@param [in] workerCount Maximum number of library worker threads; 0 restores the default of one
+per core beyond the calling thread.
+
+@details
+The library's workers are started lazily, on the first transfer that can use parallelism, and are
+shared by every reader and writer in the process. This sets the cap consulted at that point; call
+it before the first transfer. It also bounds how many tasks per batch are handed to an injected
+executor (see TaskScheduler::setExecutor).
+
+@throw No E57Exceptions.
+
+@see TaskScheduler::setExecutor
+*/
+void TaskScheduler::setWorkerLimit( unsigned workerCount )
+{
+   TaskSchedulerImpl::instance().setWorkerLimit( workerCount );
+}
@@ -0,0 +1,325 @@
+/*
+ * Copyright 2026 Andy Maloney <asmaloney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+
+#include "TaskSchedulerImpl.h"
+
+namespace
+{
+   // Index of this worker's own deque, or -1 on threads the scheduler does
+   // not own (library callers, injected executor threads)
+   thread_local int tlWorkerIndex = -1;
+}
+
+namespace e57
+{
+   TaskSchedulerImpl &TaskSchedulerImpl::instance()
+   {
+      static TaskSchedulerImpl scheduler;
+
+      return scheduler;
+   }
+
+   TaskSchedulerImpl::~TaskSchedulerImpl()
+   {
+      {
+         std::lock_guard<std::mutex> lock( mutex_ );
+         shutdown_ = true;
+      }
+
+      workAvailable_.notify_all();
+
+      for ( auto &worker : workers_ )
+      {
+         worker.join();
+      }
+   }
+
+   void TaskSchedulerImpl::setExecutor( Executor executor )
+   {
+      std::lock_guard<std::mutex> lock( mutex_ );
+
+      executor_ = std::move( executor );
+   }
+
+   void TaskSchedulerImpl::setWorkerLimit( unsigned workerCount )
+   {
+      std::lock_guard<std::mutex> lock( mutex_ );
+
+      workerLimit_ = workerCount;
+   }
+
+   // Requires mutex_ to be held
+   void TaskSchedulerImpl::ensureWorkersStarted()
+   {
+      if ( workersStarted_ )
+      {
+         return;
+      }
+
+      workersStarted_ = true;
+
+      // One worker per core beyond the calling thread, which participates in
+      // every batch it submits
+      const unsigned cDefaultCount = std::max( 1U, std::thread::hardware_concurrency() ) - 1;
+      const unsigned cCount = ( workerLimit_ != 0 ) ? workerLimit_ : cDefaultCount;
+
+      deques_.resize( cCount );
+      workers_.reserve( cCount );
+
+      for ( unsigned i = 0; i < cCount; ++i )
+      {
+         workers_.emplace_back( &TaskSchedulerImpl::workerLoop, this, static_cast<size_t>( i ) );
+      }
+   }
+
+   void TaskSchedulerImpl::submit( Task task )
+   {
+      Executor executor;
+
+      {
+         std::lock_guard<std::mutex> lock( mutex_ );
+
+         // A one-shot task may be the first work the scheduler ever sees
+         if ( !executor_ )
+         {
+            ensureWorkersStarted();
+         }
+
+         if ( !executor_ && !deques_.empty() )
+         {
+            // A worker queues follow-on work to its own deque; everyone else
+            // spreads round-robin over the deques
+            size_t target;
+
+            if ( ( tlWorkerIndex >= 0 ) && ( static_cast<size_t>( tlWorkerIndex ) < deques_.size() ) )
+            {
+               target = static_cast<size_t>( tlWorkerIndex );
+            }
+            else
+            {
+               target = nextDeque_++ % deques_.size();
+            }
+
+            deques_[target].push_back( std::move( task ) );
+            pendingTasks_++;
+
+            workAvailable_.notify_one();
+
+            return;
+         }
+
+         executor = executor_;
+      }
+
+      if ( executor )
+      {
+         executor( std::move( task ) );
+      }
+      else
+      {
+         // The executor was cleared between batch setup and here, and no
+         // workers exist yet; losing parallelism is fine, losing the task is
+         // not
+         task();
+      }
+   }
+
+   // Requires mutex_ to be held
+   bool TaskSchedulerImpl::stealTask( size_t thiefIndex, Task &task )
+   {
+      const size_t cDequeCount = deques_.size();
+
+      for ( size_t i = 1; i < cDequeCount; ++i )
+      {
+         auto &victim = deques_[( thiefIndex + i ) % cDequeCount];
+
+         if ( !victim.empty() )
+         {
+            task = std::move( victim.front() );
+            victim.pop_front();
+
+            return true;
+         }
+      }
+
+      return false;
+   }
+
+   void TaskSchedulerImpl::workerLoop( size_t workerIndex )
+   {
+      tlWorkerIndex = static_cast<int>( workerIndex );
+
+      std::unique_lock<std::mutex> lock( mutex_ );
+
+      while ( true )
+      {
+         workAvailable_.wait( lock, [this] { return shutdown_ || ( pendingTasks_ > 0 ); } );
+
+         if ( shutdown_ )
+         {
+            return;
+         }
+
+         Task task;
+
+         if ( !deques_[workerIndex].empty() )
+         {
+            task = std::move( deques_[workerIndex].back() );
+            deques_[workerIndex].pop_back();
+         }
+         else if ( !stealTask( workerIndex, task ) )
+         {
+            continue;
+         }
+
+         pendingTasks_--;
+
+         lock.unlock();
+
+         task();
+
+         lock.lock();
+      }
+   }
+
+   void TaskSchedulerImpl::runBatch( const std::shared_ptr<Batch> &batch )
+   {
+      while ( true )
+      {
+         const size_t cIndex = batch->nextJob++;
+
+         if ( cIndex >= batch->jobCount )
+         {
+            return;
+         }
+
+         try
+         {
+            ( *batch->job )( cIndex );
+         }
+         catch ( ... )
+         {
+            std::lock_guard<std::mutex> lock( batch->mutex );
+
+            if ( !batch->firstException )
+            {
+               batch->firstException = std::current_exception();
+            }
+         }
+
+         if ( ++batch->jobsDone == batch->jobCount )
+         {
+            // Taking the lock (empty) orders the jobsDone update before the
+            // notify, so the submitting thread cannot miss the wakeup
+            {
+               std::lock_guard<std::mutex> lock( batch->mutex );
+            }
+
+            batch->done.notify_all();
+         }
+      }
+   }
+
+   void TaskSchedulerImpl::parallelFor( size_t jobCount, const std::function<void( size_t )> &job,
+                                        size_t maxParallel )
+   {
+      if ( jobCount == 0 )
+      {
+         return;
+      }
+
+      // How many threads may work on this batch, counting the caller
+      size_t parallel = jobCount;
+
+      if ( ( maxParallel != 0 ) && ( maxParallel < parallel ) )
+      {
+         parallel = maxParallel;
+      }
+
+      size_t runnerCapacity = 0;
+
+      if ( parallel > 1 )
+      {
+         std::lock_guard<std::mutex> lock( mutex_ );
+
+         if ( executor_ )
+         {
+            // The injected executor decides where tasks run; still don't
+            // hand it more runners than there are cores to use them
+            runnerCapacity = std::max( 1U, std::thread::hardware_concurrency() ) - 1;
+
+            if ( ( workerLimit_ != 0 ) && ( workerLimit_ < runnerCapacity ) )
+            {
+               runnerCapacity = workerLimit_;
+            }
+         }
+         else
+         {
+            ensureWorkersStarted();
+            runnerCapacity = workers_.size();
+         }
+      }
+
+      const size_t cRunners = std::min( parallel - 1, runnerCapacity );
+
+      if ( cRunners == 0 )
+      {
+         for ( size_t i = 0; i < jobCount; ++i )
+         {
+            job( i );
+         }
+
+         return;
+      }
+
+      // The batch is shared so a runner that starts after this call has
+      // returned (it will find no indexes left) touches valid memory
+      std::shared_ptr<Batch> batch( new Batch );
+      batch->job = &job;
+      batch->jobCount = jobCount;
+
+      for ( size_t i = 0; i < cRunners; ++i )
+      {
+         submit( [batch] { runBatch( batch ); } );
+      }
+
+      // The calling thread takes part in the batch too
+      runBatch( batch );
+
+      {
+         std::unique_lock<std::mutex> lock( batch->mutex );
+
+         batch->done.wait( lock, [&batch] { return batch->jobsDone == batch->jobCount; } );
+      }
+
+      if ( batch->firstException )
+      {
+         std::rethrow_exception( batch->firstException );
+      }
+   }
+}
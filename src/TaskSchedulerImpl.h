@@ -0,0 +1,127 @@
+#pragma once
+/*
+ * Copyright 2026 Andy Maloney <asmaloney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace e57
+{
+   /// Process-wide scheduler the library's CPU-bound parallel paths draw
+   /// from (per-bytestream decode and encode, multi-file dataset reads), so
+   /// many open readers and writers in one process share a single bounded
+   /// set of workers instead of each starting its own and oversubscribing
+   /// the host. Dedicated I/O threads (packet read-ahead, the async page
+   /// writer, image batch reads) stay dedicated: they block on I/O and would
+   /// stall a CPU worker.
+   ///
+   /// Workers keep per-thread task deques and steal from each other when
+   /// their own runs dry. They are started lazily on first use, at most one
+   /// per core beyond the calling threads (see setWorkerLimit), and an
+   /// application can inject its own executor instead so library work runs
+   /// on the host-wide scheduler (see TaskScheduler::setExecutor).
+   ///
+   /// parallelFor() may be called from inside a job; every caller claims
+   /// jobs from its own batch, so nesting shares the workers but cannot
+   /// deadlock.
+   class TaskSchedulerImpl
+   {
+   public:
+      using Task = std::function<void()>;
+      using Executor = std::function<void( Task )>;
+
+      static TaskSchedulerImpl &instance();
+
+      ~TaskSchedulerImpl();
+
+      TaskSchedulerImpl( const TaskSchedulerImpl & ) = delete;
+      TaskSchedulerImpl &operator=( const TaskSchedulerImpl & ) = delete;
+
+      void setExecutor( Executor executor );
+      void setWorkerLimit( unsigned workerCount );
+
+      /// Run job( 0 ) .. job( jobCount - 1 ), blocking until all have
+      /// completed. The calling thread participates in running jobs, and at
+      /// most maxParallel threads work on the batch at once (0 means no
+      /// extra bound beyond the worker count). If any job throws, the first
+      /// exception is rethrown after the batch is done.
+      void parallelFor( size_t jobCount, const std::function<void( size_t )> &job,
+                        size_t maxParallel = 0 );
+
+      /// Run one task asynchronously on the workers (or hand it to the
+      /// injected executor). Used by the asynchronous read paths, where the
+      /// caller collects the result through a future instead of blocking;
+      /// parallelFor() remains the path for CPU-bound batches.
+      void submit( Task task );
+
+   private:
+      /// One parallelFor() call in flight; runner tasks and the caller claim
+      /// job indexes from it until none are left
+      struct Batch
+      {
+         const std::function<void( size_t )> *job = nullptr;
+         size_t jobCount = 0;
+         std::atomic<size_t> nextJob{ 0 };
+         std::atomic<size_t> jobsDone{ 0 };
+
+         std::mutex mutex;
+         std::condition_variable done;
+         std::exception_ptr firstException;
+      };
+
+      TaskSchedulerImpl() = default;
+
+      static void runBatch( const std::shared_ptr<Batch> &batch );
+
+      void ensureWorkersStarted();
+      void workerLoop( size_t workerIndex );
+      bool stealTask( size_t thiefIndex, Task &task );
+
+      std::mutex mutex_;
+      std::condition_variable workAvailable_;
+      Executor executor_;
+      unsigned workerLimit_ = 0; ///< 0 picks one per core at start time
+      bool workersStarted_ = false;
+      bool shutdown_ = false;
+
+      /// Tasks not yet claimed by any worker, over all deques
+      size_t pendingTasks_ = 0;
+
+      /// Round-robin target for tasks submitted from non-worker threads
+      std::atomic<size_t> nextDeque_{ 0 };
+
+      /// One task deque per worker; a worker pops its own back and steals
+      /// from the fronts of the others
+      std::vector<std::deque<Task>> deques_;
+      std::vector<std::thread> workers_;
+   };
+}
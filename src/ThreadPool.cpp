@@ -0,0 +1,224 @@
+/*
+ * Copyright 2026 Andy Maloney <asmaloney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "ThreadPool.h"
+
+#include "Common.h"
+
+#if defined( __linux__ )
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace e57
+{
+   namespace
+   {
+#if defined( __linux__ )
+      // Pin the calling thread to a single CPU, picked round-robin from the
+      // process affinity mask. A worker that stays on one CPU stays on one
+      // NUMA node, so the pages it touches first (its stack, the buffers it
+      // fills) are allocated local to it; on multi-socket machines that
+      // avoids decoding through remote memory. Failures are silently
+      // ignored - pinning is an optimization, never a requirement.
+      void pinToCpuSlot( unsigned slot )
+      {
+         cpu_set_t allowed;
+         CPU_ZERO( &allowed );
+
+         if ( sched_getaffinity( 0, sizeof( allowed ), &allowed ) != 0 )
+         {
+            return;
+         }
+
+         const int allowedCount = CPU_COUNT( &allowed );
+
+         if ( allowedCount <= 0 )
+         {
+            return;
+         }
+
+         // Slot 0 goes to the second allowed CPU: the calling thread (which
+         // also runs jobs) informally occupies the first one.
+         int wanted = static_cast<int>( ( slot + 1 ) % static_cast<unsigned>( allowedCount ) );
+
+         for ( int cpu = 0; cpu < CPU_SETSIZE; ++cpu )
+         {
+            if ( !CPU_ISSET( cpu, &allowed ) )
+            {
+               continue;
+            }
+
+            if ( wanted == 0 )
+            {
+               cpu_set_t one;
+               CPU_ZERO( &one );
+               CPU_SET( cpu, &one );
+
+               pthread_setaffinity_np( pthread_self(), sizeof( one ), &one );
+               return;
+            }
+
+            --wanted;
+         }
+      }
+#else
+      void pinToCpuSlot( unsigned slot )
+      {
+         UNUSED( slot );
+      }
+#endif
+   }
+
+   ThreadPool::ThreadPool( unsigned threadCount, bool pinThreads )
+   {
+      workers_.reserve( threadCount );
+
+      for ( unsigned i = 0; i < threadCount; ++i )
+      {
+         workers_.emplace_back( &ThreadPool::workerLoop, this,
+                                pinThreads ? static_cast<int>( i ) : -1 );
+      }
+   }
+
+   ThreadPool::~ThreadPool()
+   {
+      {
+         std::lock_guard<std::mutex> lock( mutex_ );
+         shutdown_ = true;
+      }
+
+      workAvailable_.notify_all();
+
+      for ( auto &worker : workers_ )
+      {
+         worker.join();
+      }
+   }
+
+   void ThreadPool::workerLoop( int pinSlot )
+   {
+      if ( pinSlot >= 0 )
+      {
+         pinToCpuSlot( static_cast<unsigned>( pinSlot ) );
+      }
+
+      std::unique_lock<std::mutex> lock( mutex_ );
+
+      while ( true )
+      {
+         workAvailable_.wait( lock, [this] { return shutdown_ || ( nextJob_ < jobCount_ ); } );
+
+         if ( shutdown_ )
+         {
+            return;
+         }
+
+         runJobs( lock );
+      }
+   }
+
+   // Run jobs from the current batch until none are left unclaimed.
+   // Requires mutex_ to be held; it is released while a job runs.
+   void ThreadPool::runJobs( std::unique_lock<std::mutex> &lock )
+   {
+      while ( nextJob_ < jobCount_ )
+      {
+         const size_t index = nextJob_++;
+         const std::function<void( size_t )> *job = job_;
+
+         lock.unlock();
+
+         std::exception_ptr exception;
+
+         try
+         {
+            ( *job )( index );
+         }
+         catch ( ... )
+         {
+            exception = std::current_exception();
+         }
+
+         lock.lock();
+
+         if ( exception && !firstException_ )
+         {
+            firstException_ = exception;
+         }
+
+         if ( --jobsRemaining_ == 0 )
+         {
+            batchDone_.notify_all();
+         }
+      }
+   }
+
+   void ThreadPool::parallelFor( size_t jobCount, const std::function<void( size_t )> &job )
+   {
+      if ( jobCount == 0 )
+      {
+         return;
+      }
+
+      // Not worth waking the workers (or there are none)
+      if ( ( jobCount == 1 ) || workers_.empty() )
+      {
+         for ( size_t i = 0; i < jobCount; ++i )
+         {
+            job( i );
+         }
+
+         return;
+      }
+
+      std::unique_lock<std::mutex> lock( mutex_ );
+
+      job_ = &job;
+      jobCount_ = jobCount;
+      nextJob_ = 0;
+      jobsRemaining_ = jobCount;
+      firstException_ = nullptr;
+
+      workAvailable_.notify_all();
+
+      // The calling thread takes part in the batch too.
+      runJobs( lock );
+
+      batchDone_.wait( lock, [this] { return jobsRemaining_ == 0; } );
+
+      job_ = nullptr;
+      jobCount_ = 0;
+
+      if ( firstException_ )
+      {
+         std::exception_ptr exception = firstException_;
+         firstException_ = nullptr;
+
+         std::rethrow_exception( exception );
+      }
+   }
+}
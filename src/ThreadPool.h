@@ -0,0 +1,84 @@
+#pragma once
+/*
+ * Copyright 2026 Andy Maloney <asmaloney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace e57
+{
+   /// Small fixed-size pool of worker threads used to spread independent jobs
+   /// (e.g. per-bytestream decoding) over several cores.
+   ///
+   /// Only one batch of jobs can be in flight at a time; nested calls to
+   /// parallelFor() from inside a job are not supported.
+   class ThreadPool
+   {
+   public:
+      /// @param [in] threadCount number of worker threads to start (may be 0,
+      /// in which case jobs run on the calling thread)
+      /// @param [in] pinThreads pin each worker to one CPU, round-robin over
+      /// the process affinity mask (Linux only, no-op elsewhere). Keeping a
+      /// worker resident on one CPU keeps it on one NUMA node, so the pages
+      /// it touches first stay local to it on multi-socket machines.
+      explicit ThreadPool( unsigned threadCount, bool pinThreads = false );
+      ~ThreadPool();
+
+      ThreadPool( const ThreadPool & ) = delete;
+      ThreadPool &operator=( const ThreadPool & ) = delete;
+
+      unsigned threadCount() const
+      {
+         return static_cast<unsigned>( workers_.size() );
+      }
+
+      /// Run job( 0 ) .. job( jobCount - 1 ), blocking until all have
+      /// completed. The calling thread participates in running jobs. If any
+      /// job throws, the first exception is rethrown after the batch is done.
+      void parallelFor( size_t jobCount, const std::function<void( size_t )> &job );
+
+   private:
+      void workerLoop( int pinSlot );
+      void runJobs( std::unique_lock<std::mutex> &lock );
+
+      std::mutex mutex_;
+      std::condition_variable workAvailable_;
+      std::condition_variable batchDone_;
+
+      // Current batch (all guarded by mutex_)
+      const std::function<void( size_t )> *job_ = nullptr;
+      size_t jobCount_ = 0;
+      size_t nextJob_ = 0;
+      size_t jobsRemaining_ = 0;
+      std::exception_ptr firstException_;
+
+      bool shutdown_ = false;
+      std::vector<std::thread> workers_;
+   };
+}
@@ -0,0 +1,66 @@
+#pragma once
+/*
+ * Original work Copyright 2009 - 2010 Kevin Ackley (kackley@gwi.net)
+ * Modified work Copyright 2018 - 2020 Andy Maloney <asmaloney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "Common.h"
+
+namespace e57
+{
+   /// Optional "tidx" vendor extension: a coarse spatial index over a
+   /// CompressedVector of cartesian points.  CompressedVectorWriterImpl
+   /// collects the cartesian bounds of fixed-size blocks of records while
+   /// they are written and stores them as a blob next to the vector;
+   /// CompressedVectorReaderImpl::setRegion() uses the blob to restrict a
+   /// read to the blocks whose bounds intersect a query box.  Writing the
+   /// index is opt-in: it happens only when the file has the extension
+   /// prefix registered (ImageFile::extensionsAdd).
+
+   constexpr const char *TILE_INDEX_PREFIX = "tidx";
+   constexpr const char *TILE_INDEX_URI = "https://github.com/asmaloney/libE57Format/tidx";
+
+   /// Element holding the index, added to the CompressedVector's parent
+   /// structure; its "blocks" child is a blob of TileIndexBlock entries.
+   constexpr const char *TILE_INDEX_ELEMENT = "tidx:tileIndex";
+
+   /// Number of consecutive records covered by one index block. The index
+   /// costs 64 bytes per block, and a region query delivers whole blocks, so
+   /// this trades index size against how tightly the delivered superset
+   /// hugs the query box.
+   constexpr uint64_t TILE_INDEX_BLOCK_RECORDS = 32 * 1024;
+
+   /// One index entry: the cartesian bounds (x, y, z order) of a run of
+   /// consecutive records. Stored in the blob as-is, so the layout is fixed.
+   struct TileIndexBlock
+   {
+      uint64_t recordStart = 0;
+      uint64_t recordCount = 0;
+      double minimum[3] = { 0.0, 0.0, 0.0 };
+      double maximum[3] = { 0.0, 0.0, 0.0 };
+   };
+
+   static_assert( sizeof( TileIndexBlock ) == 64, "TileIndexBlock must be packed" );
+}
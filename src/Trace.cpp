@@ -0,0 +1,82 @@
+/*
+ * Copyright 2026 Andy Maloney <asmaloney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/// @file Trace.cpp
+
+#include "Common.h"
+
+#include "TraceImpl.h"
+
+using namespace e57;
+
+/*!
+@brief Route spans to an application callback instead of a JSON file.
+
+@param [in] sink Callback invoked once per completed span, or an empty std::function to stop
+routing.
+
+@details
+The sink is called from whichever library thread finished the span, possibly several threads at
+once over the lifetime of the program (individual calls are serialized). It must not call back
+into the library.
+
+If the library was compiled without E57_ENABLE_TRACE, no spans are produced and the sink is never
+called.
+*/
+void Trace::setSink( Sink sink )
+{
+   TraceImpl::instance().setSink( std::move( sink ) );
+}
+
+/*!
+@brief Start recording spans to a chrome://tracing JSON file.
+
+@param [in] filePath Path of the JSON file to (over)write.
+
+@details
+The file holds an array of complete events and can be loaded directly into chrome://tracing or
+Perfetto. It is finished and closed by Trace::stop().
+
+@return true if recording started; false if the file could not be opened or the library was
+compiled without E57_ENABLE_TRACE.
+*/
+bool Trace::startJSON( const ustring &filePath )
+{
+#if defined( E57_ENABLE_TRACE )
+   return TraceImpl::instance().startJSON( filePath );
+#else
+   UNUSED( filePath );
+   return false;
+#endif
+}
+
+/*!
+@brief Stop recording spans and finish any open JSON file.
+*/
+void Trace::stop()
+{
+   TraceImpl::instance().stop();
+}
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2026 Andy Maloney <asmaloney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <chrono>
+#include <functional>
+#include <thread>
+
+#include "TraceImpl.h"
+
+namespace e57
+{
+   TraceImpl &TraceImpl::instance()
+   {
+      static TraceImpl trace;
+
+      return trace;
+   }
+
+   void TraceImpl::setSink( Trace::Sink sink )
+   {
+      std::lock_guard<std::mutex> lock( mutex_ );
+
+      if ( json_.is_open() )
+      {
+         json_ << "\n]\n";
+         json_.close();
+      }
+
+      sink_ = std::move( sink );
+      active_.store( static_cast<bool>( sink_ ), std::memory_order_relaxed );
+   }
+
+   bool TraceImpl::startJSON( const ustring &filePath )
+   {
+      std::lock_guard<std::mutex> lock( mutex_ );
+
+      if ( json_.is_open() )
+      {
+         json_ << "\n]\n";
+         json_.close();
+      }
+
+      sink_ = nullptr;
+
+      json_.open( filePath.c_str(), std::ios::out | std::ios::trunc );
+
+      if ( !json_.is_open() )
+      {
+         active_.store( false, std::memory_order_relaxed );
+         return false;
+      }
+
+      // chrome://tracing accepts a bare JSON array of events
+      json_ << "[";
+      firstSpan_ = true;
+
+      active_.store( true, std::memory_order_relaxed );
+
+      return true;
+   }
+
+   void TraceImpl::stop()
+   {
+      std::lock_guard<std::mutex> lock( mutex_ );
+
+      active_.store( false, std::memory_order_relaxed );
+
+      sink_ = nullptr;
+
+      if ( json_.is_open() )
+      {
+         json_ << "\n]\n";
+         json_.close();
+      }
+   }
+
+   void TraceImpl::emit( const Trace::Span &span )
+   {
+      std::lock_guard<std::mutex> lock( mutex_ );
+
+      if ( sink_ )
+      {
+         sink_( span );
+         return;
+      }
+
+      if ( !json_.is_open() )
+      {
+         return;
+      }
+
+      // Complete-event format ("ph":"X"); ts and dur are in microseconds
+      json_ << ( firstSpan_ ? "\n" : ",\n" );
+      firstSpan_ = false;
+
+      json_ << "{\"name\":\"" << span.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << span.threadId
+            << ",\"ts\":" << span.beginMicroseconds
+            << ",\"dur\":" << ( span.endMicroseconds - span.beginMicroseconds )
+            << ",\"args\":{\"detail\":" << span.detail << "}}";
+   }
+
+   uint64_t TraceImpl::nowMicroseconds()
+   {
+      const auto now = std::chrono::steady_clock::now().time_since_epoch();
+
+      return static_cast<uint64_t>(
+         std::chrono::duration_cast<std::chrono::microseconds>( now ).count() );
+   }
+
+   uint64_t TraceImpl::threadId()
+   {
+      // Stable per thread and small enough to read in the trace viewer
+      return std::hash<std::thread::id>{}( std::this_thread::get_id() ) & 0xFFFFFFu;
+   }
+}
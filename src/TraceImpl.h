@@ -0,0 +1,120 @@
+/*
+ * Copyright 2026 Andy Maloney <asmaloney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <fstream>
+#include <mutex>
+
+#include "Common.h"
+
+namespace e57
+{
+   /// Backend of the span tracing (see Trace). Spans are produced by the
+   /// E57_TRACE_SPAN macros below, which compile to nothing unless the
+   /// library is built with E57_ENABLE_TRACE; this class is tiny and always
+   /// compiled so the public Trace calls link either way. Thread safe.
+   class TraceImpl
+   {
+   public:
+      static TraceImpl &instance();
+
+      TraceImpl( const TraceImpl & ) = delete;
+      TraceImpl &operator=( const TraceImpl & ) = delete;
+
+      void setSink( Trace::Sink sink );
+      bool startJSON( const ustring &filePath );
+      void stop();
+
+      /// Cheap gate for the span macros: false means don't even read the clock
+      bool active() const
+      {
+         return active_.load( std::memory_order_relaxed );
+      }
+
+      void emit( const Trace::Span &span );
+
+      static uint64_t nowMicroseconds();
+      static uint64_t threadId();
+
+   private:
+      TraceImpl() = default;
+
+      std::mutex mutex_;
+      Trace::Sink sink_;
+      std::ofstream json_;
+      bool firstSpan_ = true;
+      std::atomic<bool> active_{ false };
+   };
+
+   /// RAII span for the E57_TRACE_SPAN macros: records the start time on
+   /// construction (when tracing is active) and emits on destruction, so a
+   /// span covers its enclosing scope even when it throws.
+   class TraceSpan
+   {
+   public:
+      explicit TraceSpan( const char *name, uint64_t detail = 0 ) :
+         name_( name ), detail_( detail )
+      {
+         if ( TraceImpl::instance().active() )
+         {
+            begin_ = TraceImpl::nowMicroseconds();
+         }
+      }
+
+      ~TraceSpan()
+      {
+         if ( begin_ != 0 )
+         {
+            TraceImpl::instance().emit( { name_, begin_, TraceImpl::nowMicroseconds(),
+                                          TraceImpl::threadId(), detail_ } );
+         }
+      }
+
+      TraceSpan( const TraceSpan & ) = delete;
+      TraceSpan &operator=( const TraceSpan & ) = delete;
+
+   private:
+      const char *name_ = nullptr;
+      uint64_t begin_ = 0;
+      uint64_t detail_ = 0;
+   };
+}
+
+// Span macros used at the instrumentation sites; name must have static
+// storage (a string literal).
+#if defined( E57_ENABLE_TRACE )
+#define E57_TRACE_CONCAT2( a, b ) a##b
+#define E57_TRACE_CONCAT( a, b ) E57_TRACE_CONCAT2( a, b )
+#define E57_TRACE_SPAN( name ) e57::TraceSpan E57_TRACE_CONCAT( e57TraceSpan_, __LINE__ )( name )
+#define E57_TRACE_SPAN_SIZED( name, detail ) \
+   e57::TraceSpan E57_TRACE_CONCAT( e57TraceSpan_, __LINE__ )( name, \
+                                                               static_cast<uint64_t>( detail ) )
+#else
+#define E57_TRACE_SPAN( name )
+#define E57_TRACE_SPAN_SIZED( name, detail )
+#endif
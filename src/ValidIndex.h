@@ -0,0 +1,68 @@
+#pragma once
+/*
+ * Original work Copyright 2009 - 2010 Kevin Ackley (kackley@gwi.net)
+ * Modified work Copyright 2018 - 2020 Andy Maloney <asmaloney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "Common.h"
+
+namespace e57
+{
+   /// Optional "vidx" vendor extension: a valid-point summary over a
+   /// CompressedVector whose prototype carries an invalid-state field.
+   /// CompressedVectorWriterImpl counts the records with invalid state 0 in
+   /// fixed-size blocks while they are written and stores the counts (plus
+   /// the total) next to the vector; CompressedVectorReaderImpl::
+   /// setValidOnly() uses them to skip the blocks that contain no valid
+   /// point, and CompressedVectorNode::validRecordCount() reports the total
+   /// without decoding anything.  Writing the summary is opt-in: it happens
+   /// only when the file has the extension prefix registered
+   /// (ImageFile::extensionsAdd).
+
+   constexpr const char *VALID_INDEX_PREFIX = "vidx";
+   constexpr const char *VALID_INDEX_URI = "https://github.com/asmaloney/libE57Format/vidx";
+
+   /// Element holding the summary, added to the CompressedVector's parent
+   /// structure; its "blocks" child is a blob of ValidIndexBlock entries and
+   /// its "validCount" child is the total number of valid records.
+   constexpr const char *VALID_INDEX_ELEMENT = "vidx:validIndex";
+
+   /// Number of consecutive records covered by one summary block. The
+   /// summary costs 24 bytes per block, and setValidOnly() skips whole
+   /// blocks, so this trades summary size against how much of a scan's
+   /// invalid padding can be skipped without decoding it.
+   constexpr uint64_t VALID_INDEX_BLOCK_RECORDS = 16 * 1024;
+
+   /// One summary entry: how many of a run of consecutive records have
+   /// invalid state 0. Stored in the blob as-is, so the layout is fixed.
+   struct ValidIndexBlock
+   {
+      uint64_t recordStart = 0;
+      uint64_t recordCount = 0;
+      uint64_t validCount = 0;
+   };
+
+   static_assert( sizeof( ValidIndexBlock ) == 24, "ValidIndexBlock must be packed" );
+}
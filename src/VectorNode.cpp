@@ -429,7 +429,7 @@ VectorNode::VectorNode( const Node &n )
 }
 
 /// @cond documentNonPublic The following isn't part of the API, and isn't documented.
-VectorNode::VectorNode( std::shared_ptr<VectorNodeImpl> ni ) : impl_( ni )
+VectorNode::VectorNode( std::shared_ptr<VectorNodeImpl> ni ) : impl_( std::move( ni ) )
 {
 }
 /// @endcond
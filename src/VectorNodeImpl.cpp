@@ -49,6 +49,10 @@ namespace e57
 
       std::shared_ptr<VectorNodeImpl> ai( std::static_pointer_cast<VectorNodeImpl>( ni ) );
 
+      // Comparison walks both full trees
+      materializeChildren();
+      ai->materializeChildren();
+
       // allowHeteroChildren must match
       if ( allowHeteroChildren_ != ai->allowHeteroChildren_ )
       {
@@ -85,6 +89,8 @@ namespace e57
       checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
       if ( !allowHeteroChildren_ )
       {
+         materializeChildren();
+
          // New node type must match all existing children
          for ( auto &child : children_ )
          {
@@ -105,6 +111,8 @@ namespace e57
    {
       // don't checkImageFileOpen
 
+      materializeChildren();
+
       ustring fieldName;
       if ( forcedFieldName != nullptr )
       {
@@ -135,7 +143,14 @@ namespace e57
       for ( unsigned i = 0; i < children_.size(); i++ )
       {
          os << space( indent ) << "child[" << i << "]:" << std::endl;
-         children_.at( i )->dump( indent + 2, os );
+         if ( children_.at( i ) )
+         {
+            children_.at( i )->dump( indent + 2, os );
+         }
+         else
+         {
+            os << space( indent + 2 ) << "<deferred, not yet parsed>" << std::endl;
+         }
       }
    }
 #endif
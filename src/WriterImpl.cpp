@@ -26,12 +26,16 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
 #include <cmath>
+#include <memory>
 
 #include "WriterImpl.h"
 
+#include "CheckedFile.h"
 #include "Common.h"
 #include "E57Version.h"
+#include "ScaledIntegerNodeImpl.h"
 
 namespace
 {
@@ -76,57 +80,102 @@ namespace
 namespace e57
 {
    /*!
-   @brief This function writes the projection image
+   @brief This function looks up the blob holding an image's encoded bytes
 
    @param image 1 of 3 projects or the visual
    @param imageType identifies the image format desired.
-   @param pBuffer pointer the buffer
-   @param start position in the block to start reading
-   @param count size of desired chunk or buffer size
+
+   @return the blob node, or nullptr when the image has no blob of that format
    */
-   static size_t _writeImage2DNode( const StructureNode &image, Image2DType imageType,
-                                    uint8_t *pBuffer, int64_t start, size_t count )
+   static std::unique_ptr<BlobNode> _findImage2DBlob( const StructureNode &image,
+                                                      Image2DType imageType )
    {
-      size_t transferred = 0;
+      const char *blobName = nullptr;
 
       switch ( imageType )
       {
          case ImageNone:
-            return 0;
+            return nullptr;
 
          case ImageJPEG:
-            if ( image.isDefined( "jpegImage" ) )
-            {
-               BlobNode jpegImage( image.get( "jpegImage" ) );
-               jpegImage.write( pBuffer, start, count );
-               transferred = count;
-            }
+            blobName = "jpegImage";
             break;
 
          case ImagePNG:
-            if ( image.isDefined( "pngImage" ) )
-            {
-               BlobNode pngImage( image.get( "pngImage" ) );
-               pngImage.write( pBuffer, start, count );
-               transferred = count;
-            }
+            blobName = "pngImage";
             break;
 
          case ImageMaskPNG:
-            if ( image.isDefined( "imageMask" ) )
-            {
-               BlobNode imageMask( image.get( "imageMask" ) );
-               imageMask.write( pBuffer, start, count );
-               transferred = count;
-            }
+            blobName = "imageMask";
+            break;
+      }
+
+      if ( ( blobName == nullptr ) || !image.isDefined( blobName ) )
+      {
+         return nullptr;
+      }
+
+      return std::unique_ptr<BlobNode>( new BlobNode( image.get( blobName ) ) );
+   }
+
+   /*!
+   @brief This function returns the element name of a projection's representation
+
+   @param imageProjection identifies the projection desired.
+
+   @return the representation's element name, or nullptr for ProjectionNone
+   */
+   static const char *_representationName( Image2DProjection imageProjection )
+   {
+      switch ( imageProjection )
+      {
+         case ProjectionNone:
             break;
+
+         case ProjectionVisual:
+            return "visualReferenceRepresentation";
+
+         case ProjectionPinhole:
+            return "pinholeRepresentation";
+
+         case ProjectionSpherical:
+            return "sphericalRepresentation";
+
+         case ProjectionCylindrical:
+            return "cylindricalRepresentation";
       }
 
-      return transferred;
+      return nullptr;
+   }
+
+   /*!
+   @brief This function writes the projection image
+
+   @param image 1 of 3 projects or the visual
+   @param imageType identifies the image format desired.
+   @param pBuffer pointer the buffer
+   @param start position in the block to start reading
+   @param count size of desired chunk or buffer size
+   */
+   static size_t _writeImage2DNode( const StructureNode &image, Image2DType imageType,
+                                    uint8_t *pBuffer, int64_t start, size_t count )
+   {
+      std::unique_ptr<BlobNode> blob = _findImage2DBlob( image, imageType );
+
+      if ( !blob )
+      {
+         return 0;
+      }
+
+      blob->write( pBuffer, start, count );
+
+      return count;
    }
 
    WriterImpl::WriterImpl( const ustring &filePath, const WriterOptions &options ) :
-      imf_( filePath, "w" ), root_( imf_.root() ), data3D_( imf_, true ), images2D_( imf_, true )
+      imf_( filePath, "w" ), root_( imf_.root() ), data3D_( imf_, true ), images2D_( imf_, true ),
+      tightenScaledIntegerRanges_( options.tightenScaledIntegerRanges ),
+      asyncQueueDepth_( std::max<size_t>( 1, options.asyncWriteQueueDepth ) )
    {
       // We are using the E57 v1.0 data format standard fieldnames.
       // The standard fieldnames are used without an extension prefix (in the default namespace).
@@ -175,6 +224,13 @@ namespace e57
 
    WriterImpl::~WriterImpl()
    {
+      drainAsyncWrites();
+
+      if ( imageWriteThread_.joinable() )
+      {
+         imageWriteThread_.join();
+      }
+
       if ( IsOpen() )
       {
          Close();
@@ -188,6 +244,15 @@ namespace e57
 
    bool WriterImpl::Close()
    {
+      // Every queued scan must be on disk before the XML section is written.
+      drainAsyncWrites();
+
+      // ... and so must a pending image blob.
+      if ( imageWriteThread_.joinable() )
+      {
+         imageWriteThread_.join();
+      }
+
       if ( !IsOpen() )
       {
          return false;
@@ -197,6 +262,86 @@ namespace e57
       return true;
    }
 
+   std::future<int64_t> WriterImpl::EnqueueData3DWrite( std::function<int64_t()> job )
+   {
+      std::unique_lock<std::mutex> lock( asyncMutex_ );
+
+      if ( !asyncThread_.joinable() )
+      {
+         asyncThread_ = std::thread( [this] { asyncWriteLoop(); } );
+      }
+
+      // Backpressure: hold the producer here until the write thread has worked the
+      // queue down below the configured depth.
+      asyncSpaceReady_.wait( lock, [this] { return asyncQueue_.size() < asyncQueueDepth_; } );
+
+      asyncQueue_.emplace_back();
+      asyncQueue_.back().work = std::move( job );
+
+      std::future<int64_t> result = asyncQueue_.back().promise.get_future();
+
+      lock.unlock();
+      asyncJobReady_.notify_one();
+
+      return result;
+   }
+
+   void WriterImpl::asyncWriteLoop()
+   {
+      for ( ;; )
+      {
+         AsyncWriteJob job;
+
+         {
+            std::unique_lock<std::mutex> lock( asyncMutex_ );
+
+            asyncJobReady_.wait( lock,
+                                 [this] { return stopAsyncWrites_ || !asyncQueue_.empty(); } );
+
+            // Only exit once the queue is drained, so a stop request still flushes
+            // every scan that was queued before it.
+            if ( asyncQueue_.empty() )
+            {
+               break;
+            }
+
+            job = std::move( asyncQueue_.front() );
+            asyncQueue_.pop_front();
+         }
+
+         asyncSpaceReady_.notify_one();
+
+         try
+         {
+            job.promise.set_value( job.work() );
+         }
+         catch ( ... )
+         {
+            job.promise.set_exception( std::current_exception() );
+         }
+      }
+   }
+
+   void WriterImpl::drainAsyncWrites()
+   {
+      {
+         std::lock_guard<std::mutex> lock( asyncMutex_ );
+
+         if ( !asyncThread_.joinable() )
+         {
+            return;
+         }
+
+         stopAsyncWrites_ = true;
+      }
+
+      asyncJobReady_.notify_one();
+      asyncThread_.join();
+
+      // Reset so a later enqueue can start a fresh thread.
+      stopAsyncWrites_ = false;
+   }
+
    int64_t WriterImpl::NewImage2D( Image2D &image2DHeader )
    {
       StructureNode image( imf_ );
@@ -427,50 +572,98 @@ namespace e57
       }
 
       const StructureNode image( images2D_.get( imageIndex ) );
+      const char *representationName = _representationName( imageProjection );
 
-      switch ( imageProjection )
+      if ( ( representationName == nullptr ) || !image.isDefined( representationName ) )
       {
-         case ProjectionNone:
-            return 0;
+         return 0;
+      }
 
-         case ProjectionVisual:
-            if ( image.isDefined( "visualReferenceRepresentation" ) )
-            {
-               StructureNode visualReferenceRepresentation(
-                  image.get( "visualReferenceRepresentation" ) );
-               return _writeImage2DNode( visualReferenceRepresentation, imageType, pBuffer, start,
-                                         count );
-            }
-            break;
+      const StructureNode representation( image.get( representationName ) );
 
-         case ProjectionPinhole:
-            if ( image.isDefined( "pinholeRepresentation" ) )
-            {
-               StructureNode pinholeRepresentation( image.get( "pinholeRepresentation" ) );
-               return _writeImage2DNode( pinholeRepresentation, imageType, pBuffer, start, count );
-            }
-            break;
+      return _writeImage2DNode( representation, imageType, pBuffer, start, count );
+   }
 
-         case ProjectionSpherical:
-            if ( image.isDefined( "sphericalRepresentation" ) )
-            {
-               StructureNode sphericalRepresentation( image.get( "sphericalRepresentation" ) );
-               return _writeImage2DNode( sphericalRepresentation, imageType, pBuffer, start,
-                                         count );
-            }
-            break;
+   std::future<int64_t> WriterImpl::WriteImage2DDataAsync( int64_t imageIndex,
+                                                           Image2DType imageType,
+                                                           Image2DProjection imageProjection,
+                                                           uint8_t *pBuffer, int64_t byteCount )
+   {
+      // One image write runs at a time: wait out the previous image before
+      // resolving the next one.
+      if ( imageWriteThread_.joinable() )
+      {
+         imageWriteThread_.join();
+      }
 
-         case ProjectionCylindrical:
-            if ( image.isDefined( "cylindricalRepresentation" ) )
-            {
-               StructureNode cylindricalRepresentation( image.get( "cylindricalRepresentation" ) );
-               return _writeImage2DNode( cylindricalRepresentation, imageType, pBuffer, start,
-                                         count );
-            }
-            break;
+      struct PendingWrite
+      {
+         std::promise<int64_t> promise;
+         std::unique_ptr<BlobNode> blob;
+         uint8_t *buffer = nullptr;
+         size_t count = 0;
+      };
+
+      auto pending = std::make_shared<PendingWrite>();
+
+      std::future<int64_t> result = pending->promise.get_future();
+
+      // Resolve the blob here on the calling thread: the node tree isn't
+      // guarded for concurrent access, so the background thread may only
+      // perform the blob's positional write.
+      if ( ( imageIndex >= 0 ) && ( imageIndex < images2D_.childCount() ) )
+      {
+         const StructureNode image( images2D_.get( imageIndex ) );
+         const char *representationName = _representationName( imageProjection );
+
+         if ( ( representationName != nullptr ) && image.isDefined( representationName ) )
+         {
+            const StructureNode representation( image.get( representationName ) );
+
+            pending->blob = _findImage2DBlob( representation, imageType );
+         }
       }
 
-      return 0;
+      pending->buffer = pBuffer;
+      pending->count = static_cast<size_t>( byteCount );
+
+      if ( !pending->blob || ( pending->count == 0 ) )
+      {
+         pending->promise.set_value( 0 );
+         return result;
+      }
+
+      // Blob writes only leave the file cursor alone where the platform has
+      // positioned-I/O primitives; elsewhere overlapping them with packet
+      // writes is unsafe, so fall back to writing before returning.
+      if ( !CheckedFile::positionedWritesSupported() )
+      {
+         try
+         {
+            pending->blob->write( pending->buffer, 0, pending->count );
+            pending->promise.set_value( static_cast<int64_t>( pending->count ) );
+         }
+         catch ( ... )
+         {
+            pending->promise.set_exception( std::current_exception() );
+         }
+
+         return result;
+      }
+
+      imageWriteThread_ = std::thread( [pending] {
+         try
+         {
+            pending->blob->write( pending->buffer, 0, pending->count );
+            pending->promise.set_value( static_cast<int64_t>( pending->count ) );
+         }
+         catch ( ... )
+         {
+            pending->promise.set_exception( std::current_exception() );
+         }
+      } );
+
+      return result;
    }
 
    int64_t WriterImpl::NewData3D( Data3D &data3DHeader )
@@ -1155,6 +1348,58 @@ namespace e57
       return pos;
    }
 
+   /*!
+   @brief Shrink one scaled-integer prototype field to the raw range its buffer actually spans.
+
+   The declared range only ever tightens, never grows, so every buffered value stays
+   representable. Fields of other types (or without a buffer) are left alone.
+
+   @param proto points prototype of the scan
+   @param fieldName prototype element to tighten
+   @param data the field's point buffer, or nullptr
+   @param count number of values in data
+   */
+   template <typename FTYPE>
+   static void _tightenScaledIntegerField( const StructureNode &proto, const ustring &fieldName,
+                                           const FTYPE *data, size_t count )
+   {
+      if ( ( data == nullptr ) || ( count == 0 ) || !proto.isDefined( fieldName ) )
+      {
+         return;
+      }
+
+      const Node fieldNode = proto.get( fieldName );
+
+      if ( fieldNode.type() != TypeScaledInteger )
+      {
+         return;
+      }
+
+      const ScaledIntegerNode field( fieldNode );
+      const double offset = field.offset();
+      const double scale = field.scale();
+
+      const auto dataMinMax = std::minmax_element( data, data + count );
+
+      // Same raw conversion as the prototype creation in NewData3D(); a
+      // negative scale swaps which end is the raw minimum
+      const auto rawA = static_cast<int64_t>( std::floor( ( *dataMinMax.first - offset ) / scale +
+                                                          .5 ) );
+      const auto rawB = static_cast<int64_t>( std::floor( ( *dataMinMax.second - offset ) / scale +
+                                                          .5 ) );
+
+      const int64_t cRawMinimum = std::max( std::min( rawA, rawB ), field.minimum() );
+      const int64_t cRawMaximum = std::min( std::max( rawA, rawB ), field.maximum() );
+
+      // Data entirely outside the declared range will fail at write time;
+      // leave the declared range in place for it
+      if ( cRawMinimum <= cRawMaximum )
+      {
+         std::static_pointer_cast<ScaledIntegerNodeImpl>( fieldNode.impl() )
+            ->setMinMax( cRawMinimum, cRawMaximum );
+      }
+   }
+
    template <typename COORDTYPE>
    CompressedVectorWriter WriterImpl::SetUpData3DPointsData(
       int64_t dataIndex, size_t count, const Data3DPointsData_t<COORDTYPE> &buffers )
@@ -1164,6 +1409,42 @@ namespace e57
       const StructureNode scan( data3D_.get( dataIndex ) );
       CompressedVectorNode points( scan.get( "points" ) );
       const StructureNode proto( points.prototype() );
+
+      // Optional minimal bit-width selection: on the scan's first setup,
+      // shrink each scaled-integer field's declared raw range to the range
+      // its buffer spans, so the bitpack codec packs fewer bits per value
+      // (see WriterOptions::tightenScaledIntegerRanges)
+      if ( tightenScaledIntegerRanges_ && ( tightenedData3D_.insert( dataIndex ).second ) )
+      {
+         _tightenScaledIntegerField( proto, "cartesianX", buffers.cartesianX, count );
+         _tightenScaledIntegerField( proto, "cartesianY", buffers.cartesianY, count );
+         _tightenScaledIntegerField( proto, "cartesianZ", buffers.cartesianZ, count );
+         _tightenScaledIntegerField( proto, "sphericalRange", buffers.sphericalRange, count );
+         _tightenScaledIntegerField( proto, "sphericalAzimuth", buffers.sphericalAzimuth, count );
+         _tightenScaledIntegerField( proto, "sphericalElevation", buffers.sphericalElevation,
+                                     count );
+         _tightenScaledIntegerField( proto, "intensity", buffers.intensity, count );
+         _tightenScaledIntegerField( proto, "timeStamp", buffers.timeStamp, count );
+      }
+
+      // The prototype field names are the reuse key for the buffer setup
+      const int64_t protoCount = proto.childCount();
+      std::vector<ustring> protoNames;
+      protoNames.reserve( static_cast<size_t>( protoCount ) );
+
+      for ( int64_t protoIndex = 0; protoIndex < protoCount; protoIndex++ )
+      {
+         protoNames.push_back( proto.get( protoIndex ).elementName() );
+      }
+
+      // Same buffers, capacity and prototype as the previous call? Reuse the
+      // SourceDestBuffers built then instead of setting them up again.
+      if ( ( cachedBuffersId_ == &buffers ) && ( cachedCoordSize_ == sizeof( COORDTYPE ) ) &&
+           ( cachedCount_ == count ) && ( cachedProtoNames_ == protoNames ) )
+      {
+         return points.writer( cachedSourceBuffers_ );
+      }
+
       std::vector<SourceDestBuffer> sourceBuffers;
 
       if ( proto.isDefined( "cartesianX" ) && ( buffers.cartesianX != nullptr ) )
@@ -1297,6 +1578,13 @@ namespace e57
       // create the writer, all buffers must be setup before this call
       CompressedVectorWriter writer = points.writer( sourceBuffers );
 
+      // Remember the setup so the next scan with the same prototype reuses it
+      cachedSourceBuffers_ = std::move( sourceBuffers );
+      cachedProtoNames_ = std::move( protoNames );
+      cachedBuffersId_ = &buffers;
+      cachedCoordSize_ = sizeof( COORDTYPE );
+      cachedCount_ = count;
+
       return writer;
    }
 
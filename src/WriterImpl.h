@@ -28,6 +28,15 @@
 
 #pragma once
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include "Common.h"
 #include "E57SimpleData.h"
 #include "E57SimpleWriter.h"
 
@@ -55,6 +64,16 @@ namespace e57
                                Image2DProjection imageProjection, uint8_t *pBuffer, int64_t start,
                                size_t count );
 
+      // Writes an image's whole blob on a background thread, so the (often
+      // large) device writes overlap point-scan writes to the same file. The
+      // blob is resolved on the calling thread; one image write runs at a
+      // time, a second submission waits for the first to finish. The
+      // returned future resolves to the number of bytes written, or to the
+      // exception the write threw.
+      std::future<int64_t> WriteImage2DDataAsync( int64_t imageIndex, Image2DType imageType,
+                                                  Image2DProjection imageProjection,
+                                                  uint8_t *pBuffer, int64_t byteCount );
+
       int64_t NewData3D( Data3D &data3DHeader );
 
       template <typename COORDTYPE>
@@ -64,6 +83,12 @@ namespace e57
       bool WriteData3DGroupsData( int64_t dataIndex, int64_t groupCount, int64_t *idElementValue,
                                   int64_t *startPointIndex, int64_t *pointCount );
 
+      // Queues a complete scan write (composed by Writer::WriteData3DDataAsync) for the
+      // internal write thread, which runs the queued jobs one at a time in submission
+      // order. Blocks while asyncWriteQueueDepth jobs are already pending. The returned
+      // future resolves to the job's scan index, or to the exception it threw.
+      std::future<int64_t> EnqueueData3DWrite( std::function<int64_t()> job );
+
       StructureNode GetRawE57Root();
 
       VectorNode GetRawData3D();
@@ -79,5 +104,53 @@ namespace e57
       VectorNode data3D_;
 
       VectorNode images2D_;
+
+      // Reuse of point buffer setup: SetUpData3DPointsData returns the
+      // previous call's SourceDestBuffers again when the next scan has an
+      // identical prototype and the caller passes the same buffer struct at
+      // the same capacity, so a loop over many uniform scans pays the
+      // per-field setup cost once.
+      std::vector<SourceDestBuffer> cachedSourceBuffers_;
+      std::vector<ustring> cachedProtoNames_;
+      const void *cachedBuffersId_ = nullptr;
+      size_t cachedCoordSize_ = 0;
+      size_t cachedCount_ = 0;
+
+      // WriterOptions::tightenScaledIntegerRanges, and the scans already
+      // tightened (each scan's ranges may only be shrunk once, before its
+      // first point is encoded)
+      bool tightenScaledIntegerRanges_ = false;
+      std::set<int64_t> tightenedData3D_;
+
+      // Runs all queued write jobs, then exits once stopAsyncWrites_ is set
+      // and the queue is empty.
+      void asyncWriteLoop();
+
+      // Waits for every queued write job to finish and stops the write
+      // thread. Called before the file is closed; safe to call with no
+      // thread running, and the thread restarts on the next enqueue.
+      void drainAsyncWrites();
+
+      // One pending scan write: the work to run on the write thread and the
+      // promise its result or exception is delivered through.
+      struct AsyncWriteJob
+      {
+         std::promise<int64_t> promise;
+         std::function<int64_t()> work;
+      };
+
+      // Bounded queue behind EnqueueData3DWrite. The write thread starts
+      // lazily on the first enqueue, so purely synchronous callers pay
+      // nothing for it.
+      std::mutex asyncMutex_;
+      std::condition_variable asyncJobReady_;
+      std::condition_variable asyncSpaceReady_;
+      std::deque<AsyncWriteJob> asyncQueue_;
+      std::thread asyncThread_;
+      bool stopAsyncWrites_ = false;
+      size_t asyncQueueDepth_ = 2;
+
+      // Background image blob write, one at a time (see WriteImage2DDataAsync)
+      std::thread imageWriteThread_;
    }; // end Writer class
 } // end namespace e57
@@ -0,0 +1,100 @@
+// libE57Format testing Copyright © 2022 Andy Maloney <asmaloney@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include <algorithm>
+
+#include "gtest/gtest.h"
+
+#include "E57Format.h"
+
+#include "Helpers.h"
+
+namespace
+{
+   // Enough records that the section spans several 64KB data packets, so
+   // seeking has to cross packet boundaries in both directions.
+   constexpr int64_t cRecordCount = 200000;
+
+   constexpr auto cFileName = "./ReaderSeek.e57";
+
+   void writeSeekFile()
+   {
+      e57::ImageFile imf( cFileName, "w" );
+
+      e57::StructureNode prototype( imf );
+      prototype.set( "i", e57::IntegerNode( imf, 0, 0, cRecordCount ) );
+
+      e57::CompressedVectorNode points( imf, prototype, e57::VectorNode( imf, true ) );
+      imf.root().set( "points", points );
+
+      std::vector<int32_t> values( 1024 );
+      std::vector<e57::SourceDestBuffer> sbufs;
+      sbufs.emplace_back( imf, "i", values.data(), values.size(), true );
+
+      e57::CompressedVectorWriter writer = points.writer( sbufs );
+
+      // Record n holds the value n, so any read position is verifiable
+      for ( int64_t first = 0; first < cRecordCount; first += 1024 )
+      {
+         const auto cBatch =
+            static_cast<size_t>( std::min<int64_t>( 1024, cRecordCount - first ) );
+
+         for ( size_t i = 0; i < cBatch; ++i )
+         {
+            values[i] = static_cast<int32_t>( first + i );
+         }
+
+         writer.write( cBatch );
+      }
+
+      writer.close();
+      imf.close();
+   }
+}
+
+TEST( ReaderSeek, MultiPacketVector )
+{
+   E57_ASSERT_NO_THROW( writeSeekFile() );
+
+   e57::ImageFile imf( cFileName, "r" );
+   e57::CompressedVectorNode points( imf.root().get( "points" ) );
+
+   ASSERT_EQ( points.childCount(), cRecordCount );
+
+   std::vector<int32_t> values( 100 );
+   std::vector<e57::SourceDestBuffer> dbufs;
+   dbufs.emplace_back( imf, "i", values.data(), values.size(), true );
+
+   e57::CompressedVectorReader reader = points.reader( dbufs );
+
+   // Reads continue from wherever the last seek/read left off; each
+   // position here lands in a different data packet than the last.
+   const int64_t cPositions[] = { 150000, 10, 80000, cRecordCount - 50, 0 };
+
+   for ( const int64_t cPosition : cPositions )
+   {
+      E57_ASSERT_NO_THROW( reader.seek( cPosition ) );
+
+      const unsigned cGotCount = reader.read();
+      const auto cExpectedCount =
+         static_cast<unsigned>( std::min<int64_t>( values.size(), cRecordCount - cPosition ) );
+
+      ASSERT_EQ( cGotCount, cExpectedCount ) << "seek to " << cPosition;
+
+      for ( unsigned i = 0; i < cGotCount; ++i )
+      {
+         ASSERT_EQ( values[i], static_cast<int32_t>( cPosition + i ) )
+            << "seek to " << cPosition;
+      }
+   }
+
+   // Seeking to the record count is legal and positions at end of data
+   E57_ASSERT_NO_THROW( reader.seek( cRecordCount ) );
+   ASSERT_EQ( reader.read(), 0u );
+
+   // One past is not
+   E57_ASSERT_THROW( reader.seek( cRecordCount + 1 ) );
+
+   reader.close();
+   imf.close();
+}
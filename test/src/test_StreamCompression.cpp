@@ -0,0 +1,209 @@
+// libE57Format testing Copyright © 2022 Andy Maloney <asmaloney@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include <random>
+
+#include "gtest/gtest.h"
+
+#include "StreamCompression.h"
+
+#include "Helpers.h"
+
+namespace
+{
+   // Compress raw with compressBlock() and hand the result through
+   // decompressBlock(), asserting the round trip reproduces the input.
+   void roundTripBlock( const std::vector<uint8_t> &raw )
+   {
+      std::vector<uint8_t> stored( e57::compressBound( raw.size() ) );
+
+      const size_t cStoredCount = e57::compressBlock( raw.data(), raw.size(), stored.data() );
+
+      ASSERT_LE( cStoredCount, stored.size() );
+
+      std::vector<uint8_t> decoded( raw.size() );
+
+      E57_ASSERT_NO_THROW(
+         e57::decompressBlock( stored.data(), cStoredCount, decoded.data(), raw.size() ) );
+
+      ASSERT_EQ( decoded, raw );
+   }
+}
+
+TEST( StreamCompression, RoundTripRepetitive )
+{
+   std::vector<uint8_t> raw( e57::COMPRESSED_STREAM_BLOCK_SIZE );
+
+   for ( size_t i = 0; i < raw.size(); ++i )
+   {
+      raw[i] = static_cast<uint8_t>( i % 37 );
+   }
+
+   roundTripBlock( raw );
+}
+
+TEST( StreamCompression, RoundTripAllZero )
+{
+   roundTripBlock( std::vector<uint8_t>( e57::COMPRESSED_STREAM_BLOCK_SIZE, 0 ) );
+}
+
+TEST( StreamCompression, RoundTripIncompressible )
+{
+   // Random bytes don't compress; the encoder must store the block raw and
+   // still round trip it.
+   std::mt19937 gen( 42 );
+   std::vector<uint8_t> raw( 4096 );
+
+   for ( uint8_t &b : raw )
+   {
+      b = static_cast<uint8_t>( gen() );
+   }
+
+   roundTripBlock( raw );
+}
+
+TEST( StreamCompression, RoundTripTinyBlocks )
+{
+   roundTripBlock( { 0x5A } );
+   roundTripBlock( { 1, 2, 3, 4, 5, 6, 7, 8 } );
+}
+
+TEST( StreamCompression, RejectsBadBlocks )
+{
+   std::vector<uint8_t> raw( 1024 );
+
+   for ( size_t i = 0; i < raw.size(); ++i )
+   {
+      raw[i] = static_cast<uint8_t>( i % 7 );
+   }
+
+   std::vector<uint8_t> stored( e57::compressBound( raw.size() ) );
+   const size_t cStoredCount = e57::compressBlock( raw.data(), raw.size(), stored.data() );
+
+   std::vector<uint8_t> decoded( raw.size() );
+
+   // Truncation anywhere in the stored block must throw, not read past the
+   // end or produce a short result.
+   for ( size_t cut : { size_t( 0 ), size_t( 1 ), cStoredCount / 2, cStoredCount - 1 } )
+   {
+      EXPECT_THROW( e57::decompressBlock( stored.data(), cut, decoded.data(), raw.size() ),
+                    e57::E57Exception )
+         << "truncated to " << cut << " of " << cStoredCount << " bytes";
+   }
+
+   // Trailing garbage after a complete block must throw too
+   std::vector<uint8_t> padded( stored.begin(), stored.begin() + cStoredCount );
+   padded.push_back( 0 );
+
+   E57_ASSERT_THROW(
+      e57::decompressBlock( padded.data(), padded.size(), decoded.data(), raw.size() ) );
+}
+
+namespace
+{
+   // Pack values with packDeltaBlock() and hand the result through
+   // deltaBlockByteCount()/unpackDeltaBlock(), asserting the round trip
+   // reproduces the input.
+   void roundTripDeltaBlock( const std::vector<uint64_t> &values )
+   {
+      std::vector<uint8_t> packed( e57::deltaBlockBound( values.size() ) );
+
+      const size_t cPackedCount =
+         e57::packDeltaBlock( values.data(), values.size(), packed.data() );
+
+      ASSERT_LE( cPackedCount, packed.size() );
+      ASSERT_EQ( e57::deltaBlockByteCount( packed.data() ), cPackedCount );
+
+      std::vector<uint64_t> decoded( e57::DELTA_STREAM_BLOCK_RECORDS );
+
+      size_t decodedCount = 0;
+      E57_ASSERT_NO_THROW(
+         decodedCount = e57::unpackDeltaBlock( packed.data(), cPackedCount, decoded.data() ) );
+
+      ASSERT_EQ( decodedCount, values.size() );
+      decoded.resize( decodedCount );
+      ASSERT_EQ( decoded, values );
+   }
+}
+
+TEST( StreamDelta, RoundTripRamp )
+{
+   // Smooth data: the typical scan-line case the codec exists for
+   std::vector<uint64_t> values( e57::DELTA_STREAM_BLOCK_RECORDS );
+
+   for ( size_t i = 0; i < values.size(); ++i )
+   {
+      values[i] = 100000 + 3 * i;
+   }
+
+   roundTripDeltaBlock( values );
+}
+
+TEST( StreamDelta, RoundTripConstant )
+{
+   // All deltas zero: the block packs to its header alone (width 0)
+   const std::vector<uint64_t> cValues( e57::DELTA_STREAM_BLOCK_RECORDS, 123456789 );
+
+   roundTripDeltaBlock( cValues );
+}
+
+TEST( StreamDelta, RoundTripRandom )
+{
+   // Worst case: deltas need the full 64 bit width
+   std::mt19937_64 gen( 42 );
+   std::vector<uint64_t> values( 500 );
+
+   for ( uint64_t &v : values )
+   {
+      v = gen();
+   }
+
+   roundTripDeltaBlock( values );
+}
+
+TEST( StreamDelta, RoundTripSingleRecord )
+{
+   roundTripDeltaBlock( { 42 } );
+}
+
+TEST( StreamDelta, RejectsBadBlocks )
+{
+   std::vector<uint64_t> values( e57::DELTA_STREAM_BLOCK_RECORDS );
+
+   for ( size_t i = 0; i < values.size(); ++i )
+   {
+      values[i] = 7 * i;
+   }
+
+   std::vector<uint8_t> packed( e57::deltaBlockBound( values.size() ) );
+   const size_t cPackedCount = e57::packDeltaBlock( values.data(), values.size(), packed.data() );
+
+   std::vector<uint64_t> decoded( e57::DELTA_STREAM_BLOCK_RECORDS );
+
+   // Source shorter than the header, or shorter than the header says
+   for ( size_t cut :
+         { size_t( 0 ), e57::DELTA_STREAM_HEADER_SIZE - 1, e57::DELTA_STREAM_HEADER_SIZE,
+           cPackedCount - 1 } )
+   {
+      EXPECT_THROW( e57::unpackDeltaBlock( packed.data(), cut, decoded.data() ),
+                    e57::E57Exception )
+         << "truncated to " << cut << " of " << cPackedCount << " bytes";
+   }
+
+   // Corrupt headers: record count 0, record count past the block limit,
+   // delta width past 64 bits
+   std::vector<uint8_t> corrupt( packed.begin(), packed.begin() + cPackedCount );
+
+   corrupt[0] = 0;
+   corrupt[1] = 0;
+   E57_ASSERT_THROW( e57::deltaBlockByteCount( corrupt.data() ) );
+
+   corrupt[0] = static_cast<uint8_t>( ( e57::DELTA_STREAM_BLOCK_RECORDS + 1 ) & 0xFF );
+   corrupt[1] = static_cast<uint8_t>( ( e57::DELTA_STREAM_BLOCK_RECORDS + 1 ) >> 8 );
+   E57_ASSERT_THROW( e57::deltaBlockByteCount( corrupt.data() ) );
+
+   corrupt[0] = packed[0];
+   corrupt[1] = packed[1];
+   corrupt[2] = 65;
+   E57_ASSERT_THROW( e57::deltaBlockByteCount( corrupt.data() ) );
+}
@@ -0,0 +1,135 @@
+// libE57Format testing Copyright © 2022 Andy Maloney <asmaloney@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include "gtest/gtest.h"
+
+#include "E57XmlBuilder.h"
+#include "ImageFileImpl.h"
+#include "StringNodeImpl.h"
+#include "StructureNodeImpl.h"
+
+#include "Helpers.h"
+
+namespace
+{
+   // The parser builds into an ImageFile; any write-mode scratch file will
+   // do. cancel() deletes it again.
+   e57::ImageFileImplSharedPtr makeScratchFile()
+   {
+      e57::ImageFileImplSharedPtr imf( new e57::ImageFileImpl( e57::ChecksumNone ) );
+
+      imf->construct2( "./XmlLiteParser-scratch.e57", "w" );
+
+      return imf;
+   }
+
+   constexpr auto cDocProlog =
+      "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+      "<e57Root type=\"Structure\" "
+      "xmlns=\"http://www.astm.org/COMMIT/E57/2010-e57-v1.0\">";
+}
+
+TEST( XmlLiteParser, WellFormedDocument )
+{
+   e57::ImageFileImplSharedPtr imf = makeScratchFile();
+   e57::E57XmlLiteParser parser( imf );
+
+   const e57::ustring cDoc =
+      e57::ustring( cDocProlog ) +
+      "<!-- a comment -->"
+      "<formatName type=\"String\"><![CDATA[ASTM E57 3D Imaging Data File]]></formatName>"
+      "<guid type='String'>A &amp; B &#65;&#x42;</guid>"
+      "<data3D type=\"Vector\" allowHeterogeneousChildren=\"1\"/>"
+      "<versionMajor type=\"Integer\">1</versionMajor>"
+      "</e57Root>";
+
+   E57_ASSERT_NO_THROW( parser.parse( cDoc ) );
+
+   ASSERT_TRUE( imf->root()->isDefined( "formatName" ) );
+   ASSERT_TRUE( imf->root()->isDefined( "data3D" ) );
+   ASSERT_TRUE( imf->root()->isDefined( "versionMajor" ) );
+
+   // Predefined and numeric entity references decode
+   const auto cGuid =
+      std::static_pointer_cast<e57::StringNodeImpl>( imf->root()->get( "guid" ) );
+
+   ASSERT_EQ( cGuid->value(), "A & B AB" );
+
+   imf->cancel();
+}
+
+TEST( XmlLiteParser, NamespaceDeclarationsBecomeExtensions )
+{
+   e57::ImageFileImplSharedPtr imf = makeScratchFile();
+   e57::E57XmlLiteParser parser( imf );
+
+   const e57::ustring cDoc =
+      "<e57Root type=\"Structure\" "
+      "xmlns=\"http://www.astm.org/COMMIT/E57/2010-e57-v1.0\" "
+      "xmlns:demo=\"https://example.com/demo\">"
+      "<demo:thing type=\"String\">hello</demo:thing>"
+      "</e57Root>";
+
+   E57_ASSERT_NO_THROW( parser.parse( cDoc ) );
+
+   e57::ustring uri;
+
+   ASSERT_TRUE( imf->extensionsLookupPrefix( "demo", uri ) );
+   ASSERT_EQ( uri, "https://example.com/demo" );
+   ASSERT_TRUE( imf->root()->isDefined( "demo:thing" ) );
+
+   imf->cancel();
+}
+
+// Anything outside the subset the parser handles must be rejected with an
+// exception (the caller then falls back to the Xerces backend), never
+// mis-parsed or crashed on.
+TEST( XmlLiteParser, MalformedDocumentsThrow )
+{
+   const e57::ustring cProlog( cDocProlog );
+
+   const e57::ustring cDocuments[] = {
+      // Empty document
+      "",
+      // Only whitespace
+      "  \n  ",
+      // Text outside the root element
+      "stray text",
+      // Truncated inside the root start tag
+      "<e57Root",
+      // Truncated inside an attribute value
+      "<e57Root type=\"Structure",
+      // Attribute value not quoted
+      "<e57Root type=Structure></e57Root>",
+      // Root element never closed
+      cProlog,
+      // Mismatched end tag
+      cProlog + "<guid type=\"String\"></oops></e57Root>",
+      // Missing the required type attribute
+      cProlog + "<guid>x</guid></e57Root>",
+      // Undefined general entity (would need a DTD)
+      cProlog + "<guid type=\"String\">&bogus;</guid></e57Root>",
+      // Numeric reference to an impossible code point
+      cProlog + "<guid type=\"String\">&#x110000;</guid></e57Root>",
+      // Truncated comment
+      cProlog + "<!-- never closed",
+      // Truncated CDATA section
+      cProlog + "<guid type=\"String\"><![CDATA[abc",
+      // Truncated processing instruction
+      cProlog + "<?pi never closed",
+      // DOCTYPE is outside the subset
+      "<!DOCTYPE e57Root>" + cProlog + "</e57Root>",
+      // A second root element
+      cProlog + "</e57Root><e57Root type=\"Structure\"/>",
+   };
+
+   for ( const e57::ustring &doc : cDocuments )
+   {
+      e57::ImageFileImplSharedPtr imf = makeScratchFile();
+      e57::E57XmlLiteParser parser( imf );
+
+      EXPECT_THROW( parser.parse( doc ), e57::E57Exception ) << "document: " << doc;
+
+      imf->cancel();
+   }
+}
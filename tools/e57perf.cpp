@@ -0,0 +1,639 @@
+// e57perf - explain the read performance of a specific E57 file
+// SPDX-License-Identifier: MIT
+//
+// Takes any E57 file and reports the properties that decide how fast it
+// reads: how the binary sections are packed (packet-size histogram, header
+// overhead), what each prototype field stores (bit width, codec, and the
+// entropy of its value deltas, which bounds what any codec could achieve),
+// the XML section size, the measured CRC verification cost, and the decode
+// throughput of every channel on this machine using the library's own
+// decoders. Use it when a customer file reads slower than expected and the
+// question is whether the file or the reader is at fault.
+//
+// Usage: e57perf <file.e57> [sampleRecords]   (default 2000000 records/field)
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "E57Format.h"
+
+// Internal headers: the section and packet walk works below the public API
+#include "CheckedFile.h"
+#include "Packet.h"
+#include "SectionHeaders.h"
+
+namespace
+{
+   using Clock = std::chrono::steady_clock;
+
+   double elapsedSeconds( const Clock::time_point &start )
+   {
+      return std::chrono::duration<double>( Clock::now() - start ).count();
+   }
+
+   /// Bits needed to store values in [minimum, maximum] (matches the
+   /// library's bitpack width selection)
+   unsigned bitsNeeded( int64_t minimum, int64_t maximum )
+   {
+      const uint64_t cRange = static_cast<uint64_t>( maximum ) - static_cast<uint64_t>( minimum );
+
+      unsigned bits = 0;
+
+      while ( ( cRange >> bits ) != 0 && bits < 64 )
+      {
+         ++bits;
+      }
+
+      return bits;
+   }
+
+   //// File-level layout ///////////////////////////////////////////////////
+
+   /// First 48 bytes of the file (same layout as the library's E57FileHeader)
+   struct RawFileHeader
+   {
+      char fileSignature[8];
+      uint32_t majorVersion;
+      uint32_t minorVersion;
+      uint64_t filePhysicalLength;
+      uint64_t xmlPhysicalOffset;
+      uint64_t xmlLogicalLength;
+      uint64_t pageSize;
+   };
+
+   constexpr size_t cHistogramBucketBytes = 4096;
+   constexpr size_t cHistogramBuckets = e57::DATA_PACKET_MAX / cHistogramBucketBytes;
+
+   struct SectionStats
+   {
+      uint64_t cvSections = 0;
+      uint64_t blobSections = 0;
+      uint64_t blobBytes = 0;
+
+      uint64_t dataPackets = 0;
+      uint64_t indexPackets = 0;
+      uint64_t emptyPackets = 0;
+
+      uint64_t dataBytes = 0;
+      uint64_t indexBytes = 0;
+      uint64_t emptyBytes = 0;
+
+      // Data packet bytes that are headers and per-bytestream lengths, not
+      // payload; high overhead means the writer flushed tiny packets
+      uint64_t dataOverheadBytes = 0;
+
+      uint64_t bytestreamTotal = 0;
+
+      // Data packet sizes in 4KB buckets
+      uint64_t histogram[cHistogramBuckets] = {};
+   };
+
+   /// Walk the packets of one compressed vector section.
+   /// sectionLogical is the offset of the section header.
+   void walkPackets( e57::CheckedFile &file, uint64_t sectionLogical, uint64_t sectionEndLogical,
+                     SectionStats &stats )
+   {
+      uint64_t offset = sectionLogical + 32; // packets follow the section header
+
+      while ( offset + 4 <= sectionEndLogical )
+      {
+         // Common 4-byte prefix of every packet type
+         struct
+         {
+            uint8_t packetType;
+            uint8_t packetFlags;
+            uint16_t packetLogicalLengthMinus1;
+         } prefix;
+
+         file.readAt( offset, reinterpret_cast<char *>( &prefix ), sizeof( prefix ) );
+
+         const uint64_t cPacketLength = prefix.packetLogicalLengthMinus1 + 1U;
+
+         if ( offset + cPacketLength > sectionEndLogical )
+         {
+            break;
+         }
+
+         switch ( prefix.packetType )
+         {
+            case e57::DATA_PACKET:
+            {
+               uint16_t bytestreamCount = 0;
+
+               file.readAt( offset + 4, reinterpret_cast<char *>( &bytestreamCount ),
+                            sizeof( bytestreamCount ) );
+
+               ++stats.dataPackets;
+               stats.dataBytes += cPacketLength;
+               stats.dataOverheadBytes += 6 + bytestreamCount * sizeof( uint16_t );
+               stats.bytestreamTotal += bytestreamCount;
+
+               const size_t cBucket = std::min<size_t>( ( cPacketLength - 1 ) / cHistogramBucketBytes,
+                                                        cHistogramBuckets - 1 );
+               ++stats.histogram[cBucket];
+            }
+            break;
+
+            case e57::INDEX_PACKET:
+               ++stats.indexPackets;
+               stats.indexBytes += cPacketLength;
+               break;
+
+            case e57::EMPTY_PACKET:
+               ++stats.emptyPackets;
+               stats.emptyBytes += cPacketLength;
+               break;
+
+            default:
+               return; // not a packet; stop rather than misreport
+         }
+
+         offset += cPacketLength;
+      }
+   }
+
+   /// Walk all binary sections between the file header and the XML section
+   void walkSections( e57::CheckedFile &file, uint64_t xmlLogicalOffset, SectionStats &stats )
+   {
+      uint64_t offset = sizeof( RawFileHeader );
+
+      while ( offset + 16 <= xmlLogicalOffset )
+      {
+         uint8_t sectionId = 0;
+
+         file.readAt( offset, reinterpret_cast<char *>( &sectionId ), 1 );
+
+         uint64_t sectionLogicalLength = 0;
+
+         file.readAt( offset + 8, reinterpret_cast<char *>( &sectionLogicalLength ),
+                      sizeof( sectionLogicalLength ) );
+
+         if ( sectionLogicalLength == 0 || offset + sectionLogicalLength > xmlLogicalOffset )
+         {
+            break; // padding or a section this tool doesn't understand
+         }
+
+         if ( sectionId == e57::COMPRESSED_VECTOR_SECTION )
+         {
+            ++stats.cvSections;
+            walkPackets( file, offset, offset + sectionLogicalLength, stats );
+         }
+         else if ( sectionId == e57::BLOB_SECTION )
+         {
+            ++stats.blobSections;
+            stats.blobBytes += sectionLogicalLength;
+         }
+         else
+         {
+            break;
+         }
+
+         // Sections are 4-byte aligned
+         offset = ( offset + sectionLogicalLength + 3 ) & ~uint64_t( 3 );
+      }
+   }
+
+   //// Per-field analysis //////////////////////////////////////////////////
+
+   constexpr size_t cBatchSize = 65536;
+   constexpr size_t cMaxSymbols = 1 << 20;
+
+   struct FieldReport
+   {
+      std::string name;
+      std::string codec;
+      unsigned storedBits = 0;
+      uint64_t sampled = 0;
+      double entropyBits = 0.0; // bits/record of the delta distribution
+      double seconds = 0.0;     // time inside reader.read() for the sample
+   };
+
+   /// Shannon entropy (bits/record) of a symbol histogram
+   double symbolEntropy( const std::unordered_map<int64_t, uint64_t> &histogram, uint64_t total )
+   {
+      if ( total == 0 )
+      {
+         return 0.0;
+      }
+
+      double entropy = 0.0;
+
+      for ( const auto &entry : histogram )
+      {
+         const double p = static_cast<double>( entry.second ) / static_cast<double>( total );
+
+         entropy -= p * std::log2( p );
+      }
+
+      return entropy;
+   }
+
+   /// Name of the codec a codecs vector entry requests for each input path.
+   /// Standard files leave the vector empty (= bitpack); extension-aware
+   /// writers add entries like "lzbs:compressedCodec".
+   std::map<std::string, std::string> codecsByPath( const e57::VectorNode &codecs )
+   {
+      std::map<std::string, std::string> result;
+
+      for ( int64_t i = 0; i < codecs.childCount(); ++i )
+      {
+         if ( codecs.get( i ).type() != e57::TypeStructure )
+         {
+            continue;
+         }
+
+         const e57::StructureNode cEntry( codecs.get( i ) );
+
+         // The codec is whichever element is not the "inputs" vector
+         std::string codecName = "?";
+
+         for ( int64_t child = 0; child < cEntry.childCount(); ++child )
+         {
+            const std::string cName = cEntry.get( child ).elementName();
+
+            if ( cName != "inputs" )
+            {
+               codecName = cName;
+            }
+         }
+
+         if ( !cEntry.isDefined( "inputs" ) )
+         {
+            continue;
+         }
+
+         const e57::VectorNode cInputs( cEntry.get( "inputs" ) );
+
+         for ( int64_t input = 0; input < cInputs.childCount(); ++input )
+         {
+            if ( cInputs.get( input ).type() == e57::TypeString )
+            {
+               result[e57::StringNode( cInputs.get( input ) ).value()] = codecName;
+            }
+         }
+      }
+
+      return result;
+   }
+
+   /// Read up to sampleCap records of one field by itself, timing the
+   /// library's decode path and measuring the entropy of the value deltas
+   /// (bit patterns for floats). Strings are reported without a sample.
+   FieldReport analyzeField( const e57::ImageFile &imf, e57::CompressedVectorNode &points,
+                             const e57::Node &protoField, const std::string &codecName,
+                             uint64_t sampleCap )
+   {
+      FieldReport report;
+
+      report.name = protoField.elementName();
+      report.codec = codecName;
+
+      const e57::NodeType cType = protoField.type();
+
+      bool isFloat = false;
+
+      switch ( cType )
+      {
+         case e57::TypeInteger:
+         {
+            const e57::IntegerNode cNode( protoField );
+
+            report.storedBits = bitsNeeded( cNode.minimum(), cNode.maximum() );
+         }
+         break;
+
+         case e57::TypeScaledInteger:
+         {
+            const e57::ScaledIntegerNode cNode( protoField );
+
+            report.storedBits = bitsNeeded( cNode.minimum(), cNode.maximum() );
+         }
+         break;
+
+         case e57::TypeFloat:
+         {
+            const e57::FloatNode cNode( protoField );
+
+            report.storedBits = ( cNode.precision() == e57::PrecisionSingle ) ? 32 : 64;
+            isFloat = true;
+         }
+         break;
+
+         default:
+            // Strings (and anything else) have no fixed width to sample
+            report.codec = "string";
+            return report;
+      }
+
+      if ( report.codec.empty() )
+      {
+         report.codec = ( report.storedBits == 0 ) ? "constant" : "bitpack";
+      }
+
+      std::vector<int64_t> intValues( cBatchSize );
+      std::vector<double> floatValues( cBatchSize );
+
+      std::vector<e57::SourceDestBuffer> dbufs;
+
+      if ( isFloat )
+      {
+         dbufs.emplace_back( imf, report.name, floatValues.data(), cBatchSize, true );
+      }
+      else
+      {
+         // Raw values: no conversion, no scaling, so the entropy reflects
+         // what is actually stored
+         dbufs.emplace_back( imf, report.name, intValues.data(), cBatchSize );
+      }
+
+      e57::CompressedVectorReader reader = points.reader( dbufs );
+
+      std::unordered_map<int64_t, uint64_t> histogram;
+      uint64_t otherSymbols = 0;
+      int64_t previous = 0;
+
+      while ( report.sampled < sampleCap )
+      {
+         const Clock::time_point start = Clock::now();
+         const unsigned cCount = reader.read();
+
+         report.seconds += elapsedSeconds( start );
+
+         if ( cCount == 0 )
+         {
+            break;
+         }
+
+         for ( unsigned i = 0; i < cCount; ++i )
+         {
+            int64_t value = 0;
+
+            if ( isFloat )
+            {
+               memcpy( &value, &floatValues[i], sizeof( value ) );
+            }
+            else
+            {
+               value = intValues[i];
+            }
+
+            const int64_t cDelta = value - previous;
+
+            previous = value;
+
+            if ( histogram.size() < cMaxSymbols || histogram.count( cDelta ) != 0 )
+            {
+               ++histogram[cDelta];
+            }
+            else
+            {
+               ++otherSymbols; // cap the histogram; entropy becomes a floor
+            }
+         }
+
+         report.sampled += cCount;
+      }
+
+      reader.close();
+
+      if ( otherSymbols > 0 )
+      {
+         histogram[INT64_MIN] += otherSymbols;
+      }
+
+      report.entropyBits = symbolEntropy( histogram, report.sampled );
+
+      return report;
+   }
+
+   //// CRC cost ////////////////////////////////////////////////////////////
+
+   /// Read the whole file through CheckedFile with the given policy;
+   /// returns elapsed seconds.
+   double timedFullRead( const e57::ustring &fileName, e57::ReadChecksumPolicy policy )
+   {
+      e57::CheckedFile file( fileName, e57::CheckedFile::Read, policy );
+
+      const uint64_t cLength = file.length( e57::CheckedFile::Logical );
+
+      constexpr size_t cChunk = 4 * 1024 * 1024;
+      std::vector<char> buffer( cChunk );
+
+      const Clock::time_point start = Clock::now();
+
+      for ( uint64_t offset = 0; offset < cLength; offset += cChunk )
+      {
+         file.readAt( offset, buffer.data(),
+                      static_cast<size_t>( std::min<uint64_t>( cChunk, cLength - offset ) ) );
+      }
+
+      const double cSeconds = elapsedSeconds( start );
+
+      file.close();
+
+      return cSeconds;
+   }
+
+   //// Report //////////////////////////////////////////////////////////////
+
+   void reportFile( const e57::ustring &fileName, uint64_t sampleCap )
+   {
+      const double cMillion = 1e6;
+
+      // Layout: header fields and section/packet walk (no CRC verification
+      // here; the CRC cost is measured separately below)
+      RawFileHeader header = {};
+
+      {
+         e57::CheckedFile file( fileName, e57::CheckedFile::Read, e57::ChecksumNone );
+
+         file.readAt( 0, reinterpret_cast<char *>( &header ), sizeof( header ) );
+
+         if ( memcmp( header.fileSignature, "ASTM-E57", 8 ) != 0 )
+         {
+            std::fprintf( stderr, "e57perf: %s is not an E57 file\n", fileName.c_str() );
+            return;
+         }
+
+         const uint64_t cXmlLogicalOffset =
+            e57::CheckedFile::physicalToLogical( header.xmlPhysicalOffset );
+
+         std::printf( "file      %s\n", fileName.c_str() );
+         std::printf( "          version %u.%u  %.1f MB physical, page size %llu\n",
+                      header.majorVersion, header.minorVersion,
+                      header.filePhysicalLength / cMillion,
+                      static_cast<unsigned long long>( header.pageSize ) );
+         std::printf( "xml       %.2f MB (%.2f%% of file)\n", header.xmlLogicalLength / cMillion,
+                      100.0 * static_cast<double>( header.xmlLogicalLength ) /
+                         static_cast<double>( header.filePhysicalLength ) );
+         std::printf( "crc       %.2f%% of file is page checksums (4 bytes / 1024-byte page)\n",
+                      100.0 * 4.0 / 1024.0 );
+
+         SectionStats stats;
+
+         walkSections( file, cXmlLogicalOffset, stats );
+
+         std::printf( "sections  %llu compressed vector, %llu blob (%.1f MB blob data)\n",
+                      static_cast<unsigned long long>( stats.cvSections ),
+                      static_cast<unsigned long long>( stats.blobSections ),
+                      stats.blobBytes / cMillion );
+
+         if ( stats.dataPackets > 0 )
+         {
+            std::printf( "packets   %llu data (%.1f MB), %llu index, %llu empty\n",
+                         static_cast<unsigned long long>( stats.dataPackets ),
+                         stats.dataBytes / cMillion,
+                         static_cast<unsigned long long>( stats.indexPackets ),
+                         static_cast<unsigned long long>( stats.emptyPackets ) );
+            std::printf( "          mean size %.1f KB, mean %.1f bytestreams, %.2f%% header overhead\n",
+                         static_cast<double>( stats.dataBytes ) /
+                            static_cast<double>( stats.dataPackets ) / 1024.0,
+                         static_cast<double>( stats.bytestreamTotal ) /
+                            static_cast<double>( stats.dataPackets ),
+                         100.0 * static_cast<double>( stats.dataOverheadBytes ) /
+                            static_cast<double>( stats.dataBytes ) );
+
+            // Small packets are the usual culprit for slow reads: each one
+            // costs a cache lookup and per-bytestream bookkeeping
+            std::printf( "          size histogram (4KB buckets):" );
+
+            for ( size_t bucket = 0; bucket < cHistogramBuckets; ++bucket )
+            {
+               if ( stats.histogram[bucket] > 0 )
+               {
+                  std::printf( " %zu-%zuK:%llu", bucket * 4, bucket * 4 + 4,
+                               static_cast<unsigned long long>( stats.histogram[bucket] ) );
+               }
+            }
+
+            std::printf( "\n" );
+         }
+
+         file.close();
+      }
+
+      // CRC verification cost, measured on this machine
+      {
+         const double cPlainSec = timedFullRead( fileName, e57::ChecksumNone );
+         const double cVerifySec = timedFullRead( fileName, e57::ChecksumAll );
+
+         std::printf( "read      no CRC %.2f GB/s, all CRC %.2f GB/s (%.1f%% slower)\n",
+                      header.filePhysicalLength / cPlainSec / 1e9,
+                      header.filePhysicalLength / cVerifySec / 1e9,
+                      100.0 * ( cVerifySec - cPlainSec ) / std::max( cPlainSec, 1e-9 ) );
+      }
+
+      // Per-scan, per-field decode analysis through the public reader
+      e57::ImageFile imf( fileName, "r" );
+
+      if ( !imf.root().isDefined( "data3D" ) )
+      {
+         imf.close();
+         return;
+      }
+
+      const e57::VectorNode cData3D( imf.root().get( "data3D" ) );
+
+      for ( int64_t scanIndex = 0; scanIndex < cData3D.childCount(); ++scanIndex )
+      {
+         const e57::StructureNode cScan( cData3D.get( scanIndex ) );
+
+         if ( !cScan.isDefined( "points" ) )
+         {
+            continue;
+         }
+
+         e57::CompressedVectorNode points( cScan.get( "points" ) );
+         const e57::StructureNode cProto( points.prototype() );
+         const e57::VectorNode cCodecs( points.codecs() );
+
+         const std::map<std::string, std::string> cCodecByPath = codecsByPath( cCodecs );
+
+         std::printf( "scan %lld  %lld records, %lld fields\n",
+                      static_cast<long long>( scanIndex ),
+                      static_cast<long long>( points.childCount() ),
+                      static_cast<long long>( cProto.childCount() ) );
+         std::printf( "  %-24s %6s  %-22s %9s %9s %9s\n", "field", "bits", "codec", "entropy",
+                      "Mrec/s", "MB/s" );
+
+         for ( int64_t field = 0; field < cProto.childCount(); ++field )
+         {
+            const e57::Node cField = cProto.get( field );
+
+            std::string codecName;
+            const auto found = cCodecByPath.find( cField.elementName() );
+
+            if ( found != cCodecByPath.end() )
+            {
+               codecName = found->second;
+            }
+
+            const FieldReport cReport =
+               analyzeField( imf, points, cField, codecName, sampleCap );
+
+            if ( cReport.sampled == 0 )
+            {
+               std::printf( "  %-24s %6u  %-22s         -         -         -\n",
+                            cReport.name.c_str(), cReport.storedBits, cReport.codec.c_str() );
+               continue;
+            }
+
+            // Encoded MB/s: how fast this channel's stored bits come out of
+            // the library's decoder on this machine
+            const double cEncodedBytes =
+               static_cast<double>( cReport.sampled ) * cReport.storedBits / 8.0;
+
+            std::printf( "  %-24s %6u  %-22s %9.2f %9.1f %9.1f\n", cReport.name.c_str(),
+                         cReport.storedBits, cReport.codec.c_str(), cReport.entropyBits,
+                         cReport.sampled / std::max( cReport.seconds, 1e-9 ) / cMillion,
+                         cEncodedBytes / std::max( cReport.seconds, 1e-9 ) / cMillion );
+         }
+      }
+
+      imf.close();
+   }
+}
+
+int main( int argc, char **argv )
+{
+   if ( argc < 2 )
+   {
+      std::fprintf( stderr, "usage: %s <file.e57> [sampleRecords]\n", argv[0] );
+      return 1;
+   }
+
+   uint64_t sampleCap = 2000000;
+
+   if ( argc > 2 )
+   {
+      sampleCap = std::strtoull( argv[2], nullptr, 10 );
+
+      if ( sampleCap == 0 )
+      {
+         std::fprintf( stderr, "usage: %s <file.e57> [sampleRecords]\n", argv[0] );
+         return 1;
+      }
+   }
+
+   try
+   {
+      reportFile( argv[1], sampleCap );
+   }
+   catch ( e57::E57Exception &ex )
+   {
+      std::fprintf( stderr, "e57perf failed: %s (%s)\n", ex.errorStr().c_str(),
+                    ex.context().c_str() );
+      return 1;
+   }
+
+   return 0;
+}
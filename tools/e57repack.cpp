@@ -0,0 +1,321 @@
+// e57repack - rewrite an E57 file with a layout optimized for streaming reads
+// SPDX-License-Identifier: MIT
+//
+// Files arrive with packets, blobs, and XML laid out in whatever order the
+// producing writer flushed them, which turns the first sequential read into a
+// seek storm. This tool rewrites a file so that reading it front to back
+// touches the file front to back: scan sections first (each one contiguous,
+// in scan order, transplanted byte-for-byte with CompressedVectorNode::
+// rawCopy so nothing is re-encoded), image blobs after them, and the XML
+// section at the end where the header points. A "lout:layout" manifest is
+// embedded in the tree listing the physical range of every binary section,
+// so a range-request reader (see ReadProvider) can prefetch exactly the
+// scans it wants without walking the tree first.
+//
+// Usage: e57repack <in.e57> <out.e57>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#define E57_INTERNAL_IMPLEMENTATION_ENABLE 1
+#include "E57Format.h"
+
+// Internal headers: section offsets and lengths live below the public API
+#include "BlobNodeImpl.h"
+#include "CheckedFile.h"
+#include "CompressedVectorNodeImpl.h"
+#include "SectionHeaders.h"
+
+namespace
+{
+   constexpr const char *cLayoutPrefix = "lout";
+   constexpr const char *cLayoutUri = "https://github.com/asmaloney/libE57Format/lout";
+
+   /// One binary section of the output file
+   struct ManifestEntry
+   {
+      std::string pathName; // of the node owning the section
+      uint64_t physicalOffset = 0;
+      uint64_t physicalLength = 0;
+   };
+
+   /// Physical byte range of a section given its logical placement
+   ManifestEntry sectionRange( const std::string &pathName, uint64_t logicalStart,
+                               uint64_t logicalLength )
+   {
+      ManifestEntry entry;
+
+      entry.pathName = pathName;
+      entry.physicalOffset = e57::CheckedFile::logicalToPhysical( logicalStart );
+      entry.physicalLength =
+         e57::CheckedFile::logicalToPhysical( logicalStart + logicalLength ) - entry.physicalOffset;
+
+      return entry;
+   }
+
+   /// Recursively copy a node into the destination file. Binary sections are
+   /// allocated in traversal order, so the caller's ordering of the root
+   /// children decides the file layout. rawSource reads compressed vector
+   /// section headers straight from the input file.
+   e57::Node copyNode( const e57::Node &source, e57::ImageFile &dest, e57::CheckedFile &rawSource,
+                       const std::string &pathName, std::vector<ManifestEntry> &manifest )
+   {
+      switch ( source.type() )
+      {
+         case e57::TypeStructure:
+         {
+            const e57::StructureNode sourceStruct( source );
+            e57::StructureNode copy( dest );
+
+            const int64_t cChildCount = sourceStruct.childCount();
+
+            for ( int64_t i = 0; i < cChildCount; ++i )
+            {
+               const e57::Node child = sourceStruct.get( i );
+
+               copy.set( child.elementName(), copyNode( child, dest, rawSource,
+                                                        pathName + "/" + child.elementName(),
+                                                        manifest ) );
+            }
+
+            return copy;
+         }
+
+         case e57::TypeVector:
+         {
+            const e57::VectorNode sourceVector( source );
+            e57::VectorNode copy( dest, sourceVector.allowHeteroChildren() );
+
+            const int64_t cChildCount = sourceVector.childCount();
+
+            for ( int64_t i = 0; i < cChildCount; ++i )
+            {
+               const e57::Node child = sourceVector.get( i );
+
+               copy.append( copyNode( child, dest, rawSource,
+                                      pathName + "/" + std::to_string( i ), manifest ) );
+            }
+
+            return copy;
+         }
+
+         case e57::TypeCompressedVector:
+         {
+            const e57::CompressedVectorNode sourceCV( source );
+            const uint64_t cSourceStart = sourceCV.impl()->getBinarySectionLogicalStart();
+
+            if ( cSourceStart == 0 )
+            {
+               // Never written; rebuild it empty from its prototype and codecs
+               return e57::CompressedVectorNode(
+                  dest, copyNode( sourceCV.prototype(), dest, rawSource, pathName, manifest ),
+                  e57::VectorNode( copyNode( sourceCV.codecs(), dest, rawSource, pathName,
+                                             manifest ) ) );
+            }
+
+            // Transplant the whole section byte-for-byte; this also rebuilds
+            // the prototype and codecs in the destination
+            e57::CompressedVectorNode copy = sourceCV.rawCopy( dest );
+
+            e57::CompressedVectorSectionHeader header;
+            rawSource.readAt( cSourceStart, reinterpret_cast<char *>( &header ),
+                              sizeof( header ) );
+
+            manifest.push_back( sectionRange( pathName,
+                                              copy.impl()->getBinarySectionLogicalStart(),
+                                              header.sectionLogicalLength ) );
+
+            return copy;
+         }
+
+         case e57::TypeBlob:
+         {
+            e57::BlobNode sourceBlob( source );
+            const int64_t cByteCount = sourceBlob.byteCount();
+
+            e57::BlobNode copy( dest, cByteCount );
+
+            constexpr size_t cChunkSize = 1 << 20;
+            std::vector<uint8_t> buffer(
+               static_cast<size_t>( std::min<int64_t>( cByteCount, cChunkSize ) ) );
+
+            for ( int64_t copied = 0; copied < cByteCount; )
+            {
+               const auto cCount =
+                  static_cast<size_t>( std::min<int64_t>( cByteCount - copied, cChunkSize ) );
+
+               sourceBlob.read( buffer.data(), copied, cCount );
+               copy.write( buffer.data(), copied, cCount );
+
+               copied += cCount;
+            }
+
+            manifest.push_back( sectionRange( pathName,
+                                              copy.impl()->getBinarySectionLogicalStart(),
+                                              sizeof( e57::BlobSectionHeader ) +
+                                                 static_cast<uint64_t>( cByteCount ) ) );
+
+            return copy;
+         }
+
+         case e57::TypeInteger:
+         {
+            const e57::IntegerNode node( source );
+            return e57::IntegerNode( dest, node.value(), node.minimum(), node.maximum() );
+         }
+
+         case e57::TypeScaledInteger:
+         {
+            const e57::ScaledIntegerNode node( source );
+            return e57::ScaledIntegerNode( dest, node.rawValue(), node.minimum(), node.maximum(),
+                                           node.scale(), node.offset() );
+         }
+
+         case e57::TypeFloat:
+         {
+            const e57::FloatNode node( source );
+            return e57::FloatNode( dest, node.value(), node.precision(), node.minimum(),
+                                   node.maximum() );
+         }
+
+         case e57::TypeString:
+         {
+            const e57::StringNode node( source );
+            return e57::StringNode( dest, node.value() );
+         }
+
+         default:
+            std::fprintf( stderr, "unsupported node type %d at %s\n",
+                          static_cast<int>( source.type() ), pathName.c_str() );
+            std::exit( EXIT_FAILURE );
+      }
+   }
+
+   /// Copy one root child if the source has it
+   void copyRootChild( const e57::StructureNode &sourceRoot, e57::StructureNode &destRoot,
+                       const e57::ustring &elementName, e57::ImageFile &dest,
+                       e57::CheckedFile &rawSource, std::vector<ManifestEntry> &manifest )
+   {
+      if ( !sourceRoot.isDefined( elementName ) )
+      {
+         return;
+      }
+
+      destRoot.set( elementName, copyNode( sourceRoot.get( elementName ), dest, rawSource,
+                                           "/" + elementName, manifest ) );
+   }
+}
+
+int main( int argc, char **argv )
+{
+   if ( argc != 3 )
+   {
+      std::fprintf( stderr, "Usage: e57repack <in.e57> <out.e57>\n" );
+      return EXIT_FAILURE;
+   }
+
+   const std::string inPath = argv[1];
+   const std::string outPath = argv[2];
+
+   try
+   {
+      e57::ImageFile source( inPath, "r" );
+
+      // Raw view of the input for section headers; the sections were already
+      // checksum-verified through the read above, don't pay for it twice
+      e57::CheckedFile rawSource( inPath, e57::CheckedFile::Read,
+                                  e57::ChecksumPolicy::ChecksumNone );
+
+      e57::ImageFile dest( outPath, "w" );
+
+      // Same extensions as the source, plus the layout manifest's
+      for ( size_t i = 0; i < source.extensionsCount(); ++i )
+      {
+         dest.extensionsAdd( source.extensionsPrefix( i ), source.extensionsUri( i ) );
+      }
+
+      if ( !dest.extensionsLookupPrefix( cLayoutPrefix ) )
+      {
+         dest.extensionsAdd( cLayoutPrefix, cLayoutUri );
+      }
+
+      const e57::StructureNode sourceRoot = source.root();
+      e57::StructureNode destRoot = dest.root();
+
+      std::vector<ManifestEntry> manifest;
+
+      // Binary sections land in copy order: scan sections first, contiguous
+      // and in scan order, then image blobs, then everything else. The XML
+      // section follows at close, so a sequential reader touches the file
+      // front to back.
+      copyRootChild( sourceRoot, destRoot, "data3D", dest, rawSource, manifest );
+      copyRootChild( sourceRoot, destRoot, "images2D", dest, rawSource, manifest );
+
+      const int64_t cRootChildCount = sourceRoot.childCount();
+
+      for ( int64_t i = 0; i < cRootChildCount; ++i )
+      {
+         const e57::Node child = sourceRoot.get( i );
+         const e57::ustring cName = child.elementName();
+
+         // Already copied above; a stale manifest is dropped, not copied
+         if ( ( cName == "data3D" ) || ( cName == "images2D" ) ||
+              ( cName == std::string( cLayoutPrefix ) + ":layout" ) )
+         {
+            continue;
+         }
+
+         destRoot.set( cName,
+                       copyNode( child, dest, rawSource, "/" + cName, manifest ) );
+      }
+
+      // Embed the manifest: the physical range of every binary section, in
+      // file order, keyed by the owning node's path
+      e57::StructureNode layout( dest );
+      e57::VectorNode sections( dest, true );
+
+      uint64_t sectionBytes = 0;
+
+      for ( const ManifestEntry &entry : manifest )
+      {
+         e57::StructureNode section( dest );
+
+         section.set( "pathName", e57::StringNode( dest, entry.pathName ) );
+         section.set( "physicalOffset",
+                      e57::IntegerNode( dest, static_cast<int64_t>( entry.physicalOffset ) ) );
+         section.set( "physicalLength",
+                      e57::IntegerNode( dest, static_cast<int64_t>( entry.physicalLength ) ) );
+
+         sections.append( section );
+         sectionBytes += entry.physicalLength;
+      }
+
+      layout.set( "sections", sections );
+      destRoot.set( std::string( cLayoutPrefix ) + ":layout", layout );
+
+      rawSource.close();
+      source.close();
+      dest.close();
+
+      // Reopen the result: verifies the rewrite parses, and leaves a sidecar
+      // metadata cache behind for the first real reader
+      e57::ImageFile check( outPath, "r" );
+      check.close();
+
+      std::printf( "%s: %zu binary sections, %.1f MB section data, manifest embedded\n",
+                   outPath.c_str(), manifest.size(),
+                   static_cast<double>( sectionBytes ) / ( 1024.0 * 1024.0 ) );
+   }
+   catch ( e57::E57Exception &ex )
+   {
+      std::fprintf( stderr, "e57repack failed: %s (%s)\n", ex.errorStr().c_str(),
+                    ex.context().c_str() );
+      return EXIT_FAILURE;
+   }
+
+   return EXIT_SUCCESS;
+}